@@ -0,0 +1,201 @@
+// Chat flood broadcast to local websocket clients
+// Starts a websocket server with simulated overlay clients on a worker thread, then floods them with overlay
+// broadcast RPCs twice: serialized and sent per client per message the way the webserver used to, and through
+// the broadcast encoder. Reports server CPU, socket sends, bytes and how long until every client had everything.
+//
+// Build first with `yarn rebuild`, then run `yarn bench`
+// Options: --clients=20 --messages=5000 --burst=20 (messages per event loop turn) --compress=0 (threshold bytes)
+
+const { Worker, isMainThread, parentPort, workerData } = require("worker_threads")
+const zlib = require("zlib")
+const { WebSocket, WebSocketServer } = require("ws")
+
+function parseArgs() {
+	const options = {
+		clients: 20,
+		messages: 5000,
+		burst: 20,
+		compress: 0,
+	}
+
+	for (const arg of process.argv.slice(2)) {
+		const [key, value] = arg.replace(/^--/, "").split("=")
+		if (key in options) options[key] = Number(value)
+	}
+
+	return options
+}
+
+//Same layout as broadcast-encoder.hh, kept inline so the bench doesn't need the TypeScript decoder
+function countFrameMessages(data) {
+	const bytes = Buffer.from(data)
+	const flags = bytes[1]
+	const count = bytes.readUInt32LE(4)
+
+	let body = bytes.subarray(8)
+	if (flags & 1) body = zlib.inflateRawSync(body)
+
+	let offset = 0
+	for (let i = 0; i < count; ++i) {
+		const length = body.readUInt32LE(offset)
+		JSON.parse(body.toString("utf8", offset + 4, offset + 4 + length))
+		offset += 4 + length
+	}
+	return count
+}
+
+function runClients() {
+	const { port, clients, framed, expected } = workerData
+	let received = 0
+	let open = 0
+
+	for (let i = 0; i < clients; ++i) {
+		const socket = new WebSocket(`ws://127.0.0.1:${port}/?overlay=bench${framed ? "&frames=1" : ""}`)
+		socket.binaryType = "arraybuffer"
+
+		socket.on("open", () => {
+			if (++open == clients) parentPort.postMessage({ type: "ready" })
+		})
+
+		socket.on("message", (data, isBinary) => {
+			if (isBinary) {
+				received += countFrameMessages(data)
+			} else {
+				JSON.parse(data.toString())
+				received += 1
+			}
+			if (received == expected) parentPort.postMessage({ type: "done" })
+		})
+	}
+}
+
+function chatMessage(i) {
+	return {
+		user: { id: `${100000 + (i % 500)}`, displayName: `Viewer${i % 500}`, color: "#8A2BE2" },
+		message: `message number ${i} PogChamp this is roughly how long a chat line is`,
+		emotes: [{ id: "305954156", start: 22, end: 29 }],
+		timestamp: Date.now(),
+	}
+}
+
+async function startRun(options, framed, send) {
+	const server = new WebSocketServer({ port: 0, host: "127.0.0.1" })
+	await new Promise((resolve) => server.on("listening", resolve))
+
+	const sockets = []
+	server.on("connection", (socket, request) => sockets.push({ socket, url: new URL(request.url, "http://localhost") }))
+
+	const expected = options.clients * options.messages
+	const worker = new Worker(__filename, {
+		workerData: { port: server.address().port, clients: options.clients, framed, expected },
+	})
+
+	let doneResolve
+	const done = new Promise((resolve) => (doneResolve = resolve))
+
+	await new Promise((resolve) => {
+		worker.on("message", (message) => {
+			if (message.type == "ready") resolve()
+			else if (message.type == "done") doneResolve()
+		})
+	})
+
+	const cpuStart = process.cpuUsage()
+	const start = performance.now()
+
+	const stats = await send(sockets, done)
+
+	const elapsed = performance.now() - start
+	const cpu = process.cpuUsage(cpuStart)
+
+	await worker.terminate()
+	for (const { socket } of sockets) socket.terminate()
+	server.close()
+
+	return { elapsed, cpuMs: (cpu.user + cpu.system) / 1000, ...stats }
+}
+
+async function flood(options, sendOne) {
+	for (let i = 0; i < options.messages; i += options.burst) {
+		for (let j = i; j < Math.min(i + options.burst, options.messages); ++j) {
+			sendOne(j)
+		}
+		await new Promise((resolve) => setImmediate(resolve))
+	}
+}
+
+async function perClient(options) {
+	return await startRun(options, false, async (sockets, done) => {
+		let sends = 0
+		let bytes = 0
+		let requestId = 0
+
+		await flood(options, (i) => {
+			const args = ["chat", chatMessage(i)]
+			for (const { socket } of sockets) {
+				//Every client got its own request id and its own JSON.stringify
+				const text = JSON.stringify({ name: "overlays_broadcast", requestId: `${requestId++}`, args })
+				socket.send(text)
+				++sends
+				bytes += text.length
+			}
+		})
+
+		await done
+		return { sends, bytes }
+	})
+}
+
+async function batched(options) {
+	const { BroadcastEncoder } = require("../src/index")
+	const encoder = new BroadcastEncoder({ compressThreshold: options.compress })
+
+	return await startRun(options, true, async (sockets, done) => {
+		for (const { socket, url } of sockets) {
+			encoder.addClient(socket, url.searchParams.get("frames") == "1")
+		}
+
+		const targets = sockets.map((s) => s.socket)
+		let requestId = 0
+
+		await flood(options, (i) => {
+			encoder.broadcast(targets, {
+				name: "overlays_broadcast",
+				requestId: `${requestId++}`,
+				args: ["chat", chatMessage(i)],
+			})
+		})
+		encoder.flush()
+
+		await done
+
+		const stats = encoder.getStats()
+		return { sends: stats.sends, bytes: stats.frameBytes, frames: stats.frames, compressed: stats.compressedFrames }
+	})
+}
+
+function report(name, result) {
+	const parts = [
+		`${result.elapsed.toFixed(1)} ms`,
+		`server cpu ${result.cpuMs.toFixed(1)} ms`,
+		`${result.sends} sends`,
+		`${(result.bytes / 1024 / 1024).toFixed(2)} MB serialized`,
+	]
+	if (result.frames != null) parts.push(`${result.frames} frames`)
+	if (result.compressed) parts.push(`${result.compressed} compressed`)
+	console.log(`${name}: ${parts.join(", ")}`)
+}
+
+async function main() {
+	const options = parseArgs()
+	console.log(`${options.clients} clients, ${options.messages} messages, ${options.burst} per turn`)
+
+	report("per client", await perClient(options))
+	report("encoder   ", await batched(options))
+}
+
+if (isMainThread) {
+	main()
+} else {
+	runClients()
+}
@@ -0,0 +1,26 @@
+{
+    "targets": [
+        {
+            "target_name": "castmate-broadcast-native",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "src/native-index.cc",
+                "src/broadcast-encoder.cc"
+            ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+        }
+    ]
+}
@@ -0,0 +1,219 @@
+#include "broadcast-encoder.hh"
+#include "castmate-native/trace.hh"
+
+#include <cstring>
+#include <map>
+
+Napi::Object broadcast_encoder::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeBroadcastEncoder", {
+        InstanceMethod("queue", &broadcast_encoder::queue),
+        InstanceMethod("flush", &broadcast_encoder::flush),
+        InstanceMethod("removeClient", &broadcast_encoder::remove_client),
+        InstanceMethod("getStats", &broadcast_encoder::get_stats),
+    });
+
+    exports.Set("NativeBroadcastEncoder", constructor);
+    return exports;
+}
+
+template<typename T>
+static void write_value(uint8_t* data, T value)
+{
+    memcpy(data, &value, sizeof(T));
+}
+
+broadcast_encoder::broadcast_encoder(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<broadcast_encoder>(info)
+{
+}
+
+//queue(payload, clientIds) returns the bytes waiting for the next flush
+Napi::Value broadcast_encoder::queue(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !(info[1].IsArray() || info[1].IsTypedArray()))
+    {
+        Napi::Error::New(env, "queue requires a payload string and an array of client ids.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (messages.size() >= UINT32_MAX)
+    {
+        Napi::Error::New(env, "Too many messages queued, flush first.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const uint32_t index = uint32_t(messages.size());
+    uint32_t client_count = 0;
+
+    auto add_client = [&](uint32_t client)
+    {
+        std::vector<uint32_t>& client_queue = queues[client];
+        //The same client listed twice still only gets the message once
+        if (!client_queue.empty() && client_queue.back() == index) return;
+        client_queue.push_back(index);
+        ++client_count;
+    };
+
+    if (info[1].IsTypedArray())
+    {
+        Napi::TypedArray typed = info[1].As<Napi::TypedArray>();
+        if (typed.TypedArrayType() != napi_uint32_array)
+        {
+            Napi::Error::New(env, "Client ids must be a Uint32Array.").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        Napi::Uint32Array ids = typed.As<Napi::Uint32Array>();
+        for (size_t i = 0; i < ids.ElementLength(); ++i)
+        {
+            add_client(ids[i]);
+        }
+    }
+    else
+    {
+        Napi::Array ids = info[1].As<Napi::Array>();
+        for (uint32_t i = 0; i < ids.Length(); ++i)
+        {
+            Napi::Value id = ids.Get(i);
+            if (!id.IsNumber()) continue;
+            add_client(id.As<Napi::Number>().Uint32Value());
+        }
+    }
+
+    if (client_count == 0)
+    {
+        return Napi::Number::New(env, double(pending_bytes));
+    }
+
+    //The one copy out of V8, every client's frame is built from this
+    messages.push_back(info[0].As<Napi::String>().Utf8Value());
+    pending_bytes += messages.back().size();
+
+    ++stats.messages;
+    stats.client_messages += client_count;
+
+    return Napi::Number::New(env, double(pending_bytes));
+}
+
+//flush() returns [{ clients: number[], frame: Buffer, messages: number }], one entry per distinct frame
+Napi::Value broadcast_encoder::flush(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    TRACE_SCOPE("broadcast flush");
+
+    struct frame_group
+    {
+        const std::vector<uint32_t>* indices;
+        std::vector<uint32_t> clients;
+    };
+
+    //Clients with identical queues share a frame. Broadcasts queue the same messages for everyone, so usually
+    //this is one group.
+    std::map<std::vector<uint32_t>, size_t> group_lookup;
+    std::vector<frame_group> groups;
+
+    for (const auto& client_queue : queues)
+    {
+        if (client_queue.second.empty()) continue;
+
+        auto found = group_lookup.find(client_queue.second);
+        if (found == group_lookup.end())
+        {
+            found = group_lookup.emplace(client_queue.second, groups.size()).first;
+            groups.push_back({ &found->first, {} });
+        }
+        groups[found->second].clients.push_back(client_queue.first);
+    }
+
+    Napi::Array result = Napi::Array::New(env, groups.size());
+
+    for (uint32_t g = 0; g < groups.size(); ++g)
+    {
+        const frame_group& group = groups[g];
+
+        size_t frame_size = broadcast_frame_header_size;
+        for (uint32_t index : *group.indices)
+        {
+            frame_size += 4 + messages[index].size();
+        }
+
+        //Handed to V8 as is, the buffer frees it once every socket is done with it
+        auto frame = new std::vector<uint8_t>(frame_size);
+        uint8_t* cursor = frame->data();
+
+        cursor[0] = broadcast_frame_version;
+        cursor[1] = 0;
+        write_value<uint16_t>(cursor + 2, 0);
+        write_value<uint32_t>(cursor + 4, uint32_t(group.indices->size()));
+        cursor += broadcast_frame_header_size;
+
+        for (uint32_t index : *group.indices)
+        {
+            const std::string& message = messages[index];
+            write_value<uint32_t>(cursor, uint32_t(message.size()));
+            memcpy(cursor + 4, message.data(), message.size());
+            cursor += 4 + message.size();
+        }
+
+        Napi::Buffer<uint8_t> buffer = Napi::Buffer<uint8_t>::New(env, frame->data(), frame->size(),
+            [](Napi::Env env, uint8_t* data, std::vector<uint8_t>* frame) { delete frame; }, frame);
+
+        Napi::Array clients = Napi::Array::New(env, group.clients.size());
+        for (uint32_t i = 0; i < group.clients.size(); ++i)
+        {
+            clients.Set(i, Napi::Number::New(env, group.clients[i]));
+        }
+
+        Napi::Object entry = Napi::Object::New(env);
+        entry.Set("clients", clients);
+        entry.Set("frame", buffer);
+        entry.Set("messages", Napi::Number::New(env, double(group.indices->size())));
+        result.Set(g, entry);
+
+        ++stats.frames;
+        stats.frame_bytes += frame_size;
+    }
+
+    ++stats.flushes;
+
+    messages.clear();
+    pending_bytes = 0;
+    //Keep the vectors around, the same clients are almost always queued for again
+    for (auto& client_queue : queues)
+    {
+        client_queue.second.clear();
+    }
+
+    return result;
+}
+
+Napi::Value broadcast_encoder::remove_client(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::Error::New(env, "removeClient requires a client id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    queues.erase(info[0].As<Napi::Number>().Uint32Value());
+    return env.Undefined();
+}
+
+Napi::Value broadcast_encoder::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("messages", Napi::Number::New(env, double(stats.messages)));
+    result.Set("clientMessages", Napi::Number::New(env, double(stats.client_messages)));
+    result.Set("flushes", Napi::Number::New(env, double(stats.flushes)));
+    result.Set("frames", Napi::Number::New(env, double(stats.frames)));
+    result.Set("frameBytes", Napi::Number::New(env, double(stats.frame_bytes)));
+    result.Set("pendingBytes", Napi::Number::New(env, double(pending_bytes)));
+    return result;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <napi.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Frame layout, little endian:
+//  u8 version, u8 flags, u16 reserved, u32 message count
+//  then per message u32 byte length and that many bytes of UTF-8 JSON
+//With the deflate flag set everything after the header is raw deflate of the message section.
+static const uint8_t broadcast_frame_version = 1;
+static const uint8_t broadcast_frame_deflate = 1;
+static const size_t broadcast_frame_header_size = 8;
+
+struct broadcast_stats
+{
+    //Messages queued, each serialized once however many clients it went to
+    uint64_t messages = 0;
+    //Messages summed over every client they were queued for
+    uint64_t client_messages = 0;
+    uint64_t flushes = 0;
+    uint64_t frames = 0;
+    uint64_t frame_bytes = 0;
+};
+
+//Collects messages for a set of clients over a flush window and turns them into one frame per client. Clients that
+//were sent exactly the same messages in the window share a single frame, so a broadcast to twenty overlays builds
+//one buffer and every socket sends it.
+class broadcast_encoder : public Napi::ObjectWrap<broadcast_encoder>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    broadcast_encoder(const Napi::CallbackInfo& info);
+
+    Napi::Value queue(const Napi::CallbackInfo& info);
+    Napi::Value flush(const Napi::CallbackInfo& info);
+    Napi::Value remove_client(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+
+private:
+    //Messages queued since the last flush
+    std::vector<std::string> messages;
+    //Per client, indices into messages in the order they were queued
+    std::unordered_map<uint32_t, std::vector<uint32_t>> queues;
+    size_t pending_bytes = 0;
+
+    broadcast_stats stats;
+};
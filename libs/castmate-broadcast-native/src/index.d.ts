@@ -0,0 +1,56 @@
+declare namespace CastmateBroadcastNative {
+	interface BroadcastSocket {
+		send(data: string | Buffer, options?: { binary?: boolean; compress?: boolean }): void
+	}
+
+	interface BroadcastEncoderOptions {
+		/** How long a message may wait for others to share its frame, 4ms by default */
+		flushMs?: number
+		/** Frames with at least this many bytes of messages are deflated, 0 (the default) never compresses */
+		compressThreshold?: number
+		/** Pending bytes that force a flush before the window is up */
+		maxPendingBytes?: number
+	}
+
+	interface BroadcastStats {
+		messages: number
+		clientMessages: number
+		flushes: number
+		frames: number
+		frameBytes: number
+		pendingBytes: number
+		/** socket.send calls, compare with clientMessages to see how much batching saved */
+		sends: number
+		compressedFrames: number
+	}
+
+	class BroadcastEncoder {
+		constructor(options?: BroadcastEncoderOptions)
+
+		flushMs: number
+		compressThreshold: number
+		maxPendingBytes: number
+
+		/** Framed clients receive binary batches, anything else keeps getting one JSON text message per message */
+		addClient(socket: BroadcastSocket, framed: boolean): void
+		removeClient(socket: BroadcastSocket): void
+
+		send(socket: BroadcastSocket, message: any): void
+		/** Serializes message once and queues it for every socket */
+		broadcast(sockets: Iterable<BroadcastSocket>, message: any): void
+		flush(): void
+
+		getStats(): BroadcastStats
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateBroadcastNative
@@ -0,0 +1,137 @@
+const bindings = require("bindings")
+const zlib = require("zlib")
+
+const native = bindings({
+	bindings: "castmate-broadcast-native",
+})
+
+//Matches broadcast-encoder.hh
+const frameHeaderSize = 8
+const deflateFlag = 1
+
+class BroadcastEncoder {
+	constructor(options = {}) {
+		this._native = new native.NativeBroadcastEncoder()
+
+		//How long a message may wait for others to share its frame
+		this.flushMs = options.flushMs ?? 4
+		//Frames with at least this many bytes of messages are deflated, 0 never compresses
+		this.compressThreshold = options.compressThreshold ?? 0
+		//Flush early rather than let a flood build one huge frame
+		this.maxPendingBytes = options.maxPendingBytes ?? 256 * 1024
+
+		this._clients = new Map()
+		this._ids = new Map()
+		this._nextId = 1
+		this._timer = undefined
+
+		this._sends = 0
+		this._compressedFrames = 0
+	}
+
+	/**
+	 * Framed clients receive binary batches, anything else keeps getting one JSON text message per message.
+	 */
+	addClient(socket, framed) {
+		if (this._ids.has(socket)) return
+
+		const id = this._nextId++
+		this._ids.set(socket, id)
+		this._clients.set(id, { socket, framed: !!framed })
+	}
+
+	removeClient(socket) {
+		const id = this._ids.get(socket)
+		if (id == null) return
+
+		this._ids.delete(socket)
+		this._clients.delete(id)
+		this._native.removeClient(id)
+	}
+
+	send(socket, message) {
+		this.broadcast([socket], message)
+	}
+
+	/**
+	 * Serializes message once and queues it for every socket
+	 */
+	broadcast(sockets, message) {
+		const payload = typeof message == "string" ? message : JSON.stringify(message)
+
+		const framedIds = []
+		for (const socket of sockets) {
+			const id = this._ids.get(socket)
+			const client = id != null ? this._clients.get(id) : undefined
+
+			if (client?.framed) {
+				framedIds.push(id)
+			} else {
+				socket.send(payload)
+				++this._sends
+			}
+		}
+
+		if (framedIds.length == 0) return
+
+		const pendingBytes = this._native.queue(payload, framedIds)
+
+		if (pendingBytes >= this.maxPendingBytes) {
+			this.flush()
+		} else if (this._timer == null) {
+			this._timer = setTimeout(() => this.flush(), this.flushMs)
+		}
+	}
+
+	flush() {
+		if (this._timer != null) {
+			clearTimeout(this._timer)
+			this._timer = undefined
+		}
+
+		for (const { clients, frame } of this._native.flush()) {
+			const data = this._compress(frame)
+
+			for (const id of clients) {
+				const client = this._clients.get(id)
+				if (!client) continue
+
+				//Already compressed if it's worth it, per socket deflate would redo the work for every client
+				client.socket.send(data, { binary: true, compress: false })
+				++this._sends
+			}
+		}
+	}
+
+	_compress(frame) {
+		if (this.compressThreshold <= 0 || frame.length - frameHeaderSize < this.compressThreshold) return frame
+
+		const body = zlib.deflateRawSync(frame.subarray(frameHeaderSize))
+		if (body.length >= frame.length - frameHeaderSize) return frame
+
+		const compressed = Buffer.allocUnsafe(frameHeaderSize + body.length)
+		frame.copy(compressed, 0, 0, frameHeaderSize)
+		compressed[1] |= deflateFlag
+		body.copy(compressed, frameHeaderSize)
+
+		++this._compressedFrames
+		return compressed
+	}
+
+	getStats() {
+		return {
+			...this._native.getStats(),
+			sends: this._sends,
+			compressedFrames: this._compressedFrames,
+		}
+	}
+}
+
+module.exports = {
+	BroadcastEncoder,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,114 @@
+// Chunk sync over a loopback socket
+// Serves a generated media file, fetches it into an empty client store, then edits the middle of it and fetches
+// again. The second fetch should only move the chunks around the edit.
+//
+// Build first with `yarn rebuild`, then run `yarn bench`
+// Options: --size=64 (MB) --edit=4096 (bytes inserted) --keep to leave the temp folder behind
+
+const fs = require("fs")
+const os = require("os")
+const path = require("path")
+const net = require("net")
+const crypto = require("crypto")
+
+const { ChunkStore, ChunkServer, ChunkClient, socketTransport } = require("../src/index")
+
+function parseArgs() {
+	const options = {
+		size: 64,
+		edit: 4096,
+		keep: false,
+	}
+
+	for (const arg of process.argv.slice(2)) {
+		const [key, value] = arg.replace(/^--/, "").split("=")
+		if (key == "size") options.size = Number(value)
+		else if (key == "edit") options.edit = Number(value)
+		else if (key == "keep") options.keep = true
+	}
+
+	return options
+}
+
+function sha256(file) {
+	return crypto.createHash("sha256").update(fs.readFileSync(file)).digest("hex")
+}
+
+async function listen(server) {
+	return new Promise((resolve) => server.listen(0, "127.0.0.1", () => resolve(server.address().port)))
+}
+
+async function connect(port) {
+	return new Promise((resolve, reject) => {
+		const socket = net.connect(port, "127.0.0.1", () => resolve(socket))
+		socket.on("error", reject)
+	})
+}
+
+async function timedFetch(client, name, source, target) {
+	const start = performance.now()
+	const result = await client.fetchFile(name, target)
+	const elapsed = performance.now() - start
+
+	const matches = sha256(source) == sha256(target)
+	console.log(
+		`${name}: ${result.fetchedChunks}/${result.chunks} chunks, ${(result.fetchedBytes / 1048576).toFixed(2)}MB ` +
+			`of ${(result.size / 1048576).toFixed(2)}MB in ${elapsed.toFixed(1)}ms ${matches ? "" : "MISMATCH"}`
+	)
+	return matches
+}
+
+async function main() {
+	const options = parseArgs()
+	const root = fs.mkdtempSync(path.join(os.tmpdir(), "castmate-chunk-bench-"))
+
+	const mediaDir = path.join(root, "media")
+	fs.mkdirSync(mediaDir)
+	const source = path.join(mediaDir, "clip.bin")
+	fs.writeFileSync(source, crypto.randomBytes(options.size * 1048576))
+
+	const serverStore = new ChunkStore(path.join(root, "server-cache"))
+	const clientStore = new ChunkStore(path.join(root, "client-cache"))
+
+	const chunkServer = new ChunkServer(serverStore, (file) => {
+		const local = path.join(mediaDir, file)
+		return path.dirname(local) == mediaDir ? local : undefined
+	})
+
+	const server = net.createServer((socket) => {
+		const send = socketTransport(socket, (message) => chunkServer.handleMessage(message, send))
+	})
+	const port = await listen(server)
+
+	const socket = await connect(port)
+	const client = new ChunkClient(clientStore, (message) => send(message))
+	const send = socketTransport(socket, (message) => client.handleMessage(message))
+
+	const target = path.join(root, "clip.out")
+	let ok = await timedFetch(client, "clip.bin", source, target)
+
+	//Unchanged, answered from the manifest alone
+	ok = (await timedFetch(client, "clip.bin", source, target)) && ok
+
+	//Insert in the middle, shifting everything after it
+	const original = fs.readFileSync(source)
+	const middle = Math.floor(original.length / 2)
+	fs.writeFileSync(source, Buffer.concat([original.subarray(0, middle), crypto.randomBytes(options.edit), original.subarray(middle)]))
+	ok = (await timedFetch(client, "clip.bin", source, target)) && ok
+
+	const refused = await client.fetchFile("../outside.bin", target).then(
+		() => false,
+		() => true
+	)
+	ok = refused && ok
+
+	console.log("client store", clientStore.getStats())
+
+	socket.destroy()
+	server.close()
+	if (!options.keep) fs.rmSync(root, { recursive: true, force: true })
+
+	process.exit(ok ? 0 : 1)
+}
+
+main()
@@ -0,0 +1,29 @@
+{
+    "targets": [
+        {
+            "target_name": "castmate-chunk-store-native",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "src/native-index.cc",
+                "src/chunk-store.cc",
+                "src/chunk-cache.cc",
+                "src/chunker.cc",
+                "src/blake3.cc"
+            ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+        }
+    ]
+}
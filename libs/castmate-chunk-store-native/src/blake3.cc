@@ -0,0 +1,279 @@
+#include "blake3.hh"
+
+#include <cstring>
+
+static const uint32_t blake3_iv[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19,
+};
+
+static const uint8_t message_schedule[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+enum blake3_flags : uint8_t
+{
+    chunk_start = 1 << 0,
+    chunk_end = 1 << 1,
+    parent = 1 << 2,
+    root = 1 << 3,
+};
+
+static const size_t block_len = 64;
+static const size_t chunk_len_bytes = 1024;
+
+static inline uint32_t rotr32(uint32_t w, uint32_t c)
+{
+    return (w >> c) | (w << (32 - c));
+}
+
+static inline uint32_t load32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline void store32(uint8_t* p, uint32_t w)
+{
+    p[0] = uint8_t(w);
+    p[1] = uint8_t(w >> 8);
+    p[2] = uint8_t(w >> 16);
+    p[3] = uint8_t(w >> 24);
+}
+
+static inline void g(uint32_t* state, size_t a, size_t b, size_t c, size_t d, uint32_t x, uint32_t y)
+{
+    state[a] = state[a] + state[b] + x;
+    state[d] = rotr32(state[d] ^ state[a], 16);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 12);
+    state[a] = state[a] + state[b] + y;
+    state[d] = rotr32(state[d] ^ state[a], 8);
+    state[c] = state[c] + state[d];
+    state[b] = rotr32(state[b] ^ state[c], 7);
+}
+
+static void compress(const uint32_t cv[8], const uint8_t block[block_len], uint8_t length, uint64_t counter, uint8_t flags, uint32_t out[16])
+{
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; ++i)
+    {
+        m[i] = load32(block + 4 * i);
+    }
+
+    uint32_t state[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        blake3_iv[0], blake3_iv[1], blake3_iv[2], blake3_iv[3],
+        uint32_t(counter), uint32_t(counter >> 32), length, flags,
+    };
+
+    for (size_t round = 0; round < 7; ++round)
+    {
+        const uint8_t* s = message_schedule[round];
+        g(state, 0, 4, 8, 12, m[s[0]], m[s[1]]);
+        g(state, 1, 5, 9, 13, m[s[2]], m[s[3]]);
+        g(state, 2, 6, 10, 14, m[s[4]], m[s[5]]);
+        g(state, 3, 7, 11, 15, m[s[6]], m[s[7]]);
+        g(state, 0, 5, 10, 15, m[s[8]], m[s[9]]);
+        g(state, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+        g(state, 2, 7, 8, 13, m[s[12]], m[s[13]]);
+        g(state, 3, 4, 9, 14, m[s[14]], m[s[15]]);
+    }
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        out[i] = state[i] ^ state[i + 8];
+        out[i + 8] = state[i + 8] ^ cv[i];
+    }
+}
+
+static void parent_cv(const uint32_t left[8], const uint32_t right[8], uint8_t flags, uint32_t out[8])
+{
+    uint8_t block[block_len];
+    for (size_t i = 0; i < 8; ++i)
+    {
+        store32(block + 4 * i, left[i]);
+        store32(block + 32 + 4 * i, right[i]);
+    }
+
+    uint32_t full[16];
+    compress(blake3_iv, block, block_len, 0, flags | parent, full);
+    memcpy(out, full, 32);
+}
+
+bool blake3_hash::operator==(const blake3_hash& other) const
+{
+    return memcmp(bytes, other.bytes, blake3_out_len) == 0;
+}
+
+std::string blake3_hash::to_hex() const
+{
+    static const char digits[] = "0123456789abcdef";
+
+    std::string hex(blake3_out_len * 2, '0');
+    for (size_t i = 0; i < blake3_out_len; ++i)
+    {
+        hex[i * 2] = digits[bytes[i] >> 4];
+        hex[i * 2 + 1] = digits[bytes[i] & 0xF];
+    }
+    return hex;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool blake3_hash::from_hex(const std::string& hex, blake3_hash& hash)
+{
+    if (hex.size() != blake3_out_len * 2) return false;
+
+    for (size_t i = 0; i < blake3_out_len; ++i)
+    {
+        const int high = hex_digit(hex[i * 2]);
+        const int low = hex_digit(hex[i * 2 + 1]);
+        if (high < 0 || low < 0) return false;
+        hash.bytes[i] = uint8_t((high << 4) | low);
+    }
+    return true;
+}
+
+blake3_hasher::blake3_hasher()
+{
+    reset_chunk(0);
+}
+
+void blake3_hasher::reset_chunk(uint64_t counter)
+{
+    memcpy(chunk.chaining_value, blake3_iv, sizeof(blake3_iv));
+    chunk.chunk_counter = counter;
+    memset(chunk.block, 0, sizeof(chunk.block));
+    chunk.block_len = 0;
+    chunk.blocks_compressed = 0;
+}
+
+size_t blake3_hasher::chunk_len() const
+{
+    return block_len * chunk.blocks_compressed + chunk.block_len;
+}
+
+void blake3_hasher::push_stack(const uint32_t cv[8])
+{
+    memcpy(cv_stack[cv_stack_len], cv, 32);
+    cv_stack_len++;
+}
+
+void blake3_hasher::add_chunk_chaining_value(uint32_t cv[8], uint64_t total_chunks)
+{
+    //Merge completed subtrees, one merge per trailing zero bit of the chunk count
+    while ((total_chunks & 1) == 0)
+    {
+        cv_stack_len--;
+        parent_cv(cv_stack[cv_stack_len], cv, 0, cv);
+        total_chunks >>= 1;
+    }
+    push_stack(cv);
+}
+
+void blake3_hasher::update(const void* data, size_t length)
+{
+    const uint8_t* input = static_cast<const uint8_t*>(data);
+
+    while (length > 0)
+    {
+        //The last chunk might be the root, only finish a chunk once more input shows up
+        if (chunk_len() == chunk_len_bytes)
+        {
+            uint32_t out[16];
+            compress(chunk.chaining_value, chunk.block, chunk.block_len, chunk.chunk_counter,
+                (chunk.blocks_compressed == 0 ? chunk_start : 0) | chunk_end, out);
+
+            uint32_t cv[8];
+            memcpy(cv, out, 32);
+            const uint64_t total_chunks = chunk.chunk_counter + 1;
+            add_chunk_chaining_value(cv, total_chunks);
+            reset_chunk(total_chunks);
+        }
+
+        //Same for blocks, the last block of a chunk gets the chunk_end flag
+        if (chunk.block_len == block_len)
+        {
+            uint32_t out[16];
+            compress(chunk.chaining_value, chunk.block, block_len, chunk.chunk_counter,
+                chunk.blocks_compressed == 0 ? chunk_start : 0, out);
+            memcpy(chunk.chaining_value, out, 32);
+            chunk.blocks_compressed++;
+            chunk.block_len = 0;
+            memset(chunk.block, 0, sizeof(chunk.block));
+        }
+
+        size_t take = block_len - chunk.block_len;
+        const size_t chunk_remaining = chunk_len_bytes - chunk_len();
+        if (take > chunk_remaining) take = chunk_remaining;
+        if (take > length) take = length;
+
+        memcpy(chunk.block + chunk.block_len, input, take);
+        chunk.block_len += uint8_t(take);
+        input += take;
+        length -= take;
+    }
+}
+
+blake3_hash blake3_hasher::finalize() const
+{
+    //Output of the current chunk, then fold the stack from the top down
+    uint32_t input_cv[8];
+    uint8_t block[block_len];
+    uint8_t length;
+    uint64_t counter;
+    uint8_t flags;
+
+    memcpy(input_cv, chunk.chaining_value, 32);
+    memcpy(block, chunk.block, block_len);
+    length = chunk.block_len;
+    counter = chunk.chunk_counter;
+    flags = (chunk.blocks_compressed == 0 ? chunk_start : 0) | chunk_end;
+
+    size_t remaining = cv_stack_len;
+    while (remaining > 0)
+    {
+        remaining--;
+
+        uint32_t out[16];
+        compress(input_cv, block, length, counter, flags, out);
+
+        for (size_t i = 0; i < 8; ++i)
+        {
+            store32(block + 4 * i, cv_stack[remaining][i]);
+            store32(block + 32 + 4 * i, out[i]);
+        }
+        memcpy(input_cv, blake3_iv, 32);
+        length = block_len;
+        counter = 0;
+        flags = parent;
+    }
+
+    uint32_t out[16];
+    compress(input_cv, block, length, counter, flags | root, out);
+
+    blake3_hash hash;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        store32(hash.bytes + 4 * i, out[i]);
+    }
+    return hash;
+}
+
+blake3_hash blake3_hasher::hash(const void* data, size_t length)
+{
+    blake3_hasher hasher;
+    hasher.update(data, length);
+    return hasher.finalize();
+}
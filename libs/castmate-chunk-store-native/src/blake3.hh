@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+//Portable BLAKE3 (unkeyed hash mode, 32 byte output). Chunk ids only need to be strong and stable across
+//machines, so this skips the SIMD paths of the reference implementation.
+
+static const size_t blake3_out_len = 32;
+
+struct blake3_hash
+{
+    uint8_t bytes[blake3_out_len];
+
+    bool operator==(const blake3_hash& other) const;
+    bool operator!=(const blake3_hash& other) const { return !(*this == other); }
+
+    std::string to_hex() const;
+    static bool from_hex(const std::string& hex, blake3_hash& hash);
+};
+
+struct blake3_hash_hasher
+{
+    size_t operator()(const blake3_hash& hash) const
+    {
+        //Already uniformly distributed
+        size_t value;
+        memcpy(&value, hash.bytes, sizeof(value));
+        return value;
+    }
+};
+
+class blake3_hasher
+{
+public:
+    blake3_hasher();
+
+    void update(const void* data, size_t length);
+    blake3_hash finalize() const;
+
+    static blake3_hash hash(const void* data, size_t length);
+
+private:
+    struct chunk_state
+    {
+        uint32_t chaining_value[8];
+        uint64_t chunk_counter;
+        uint8_t block[64];
+        uint8_t block_len;
+        uint8_t blocks_compressed;
+    };
+
+    void reset_chunk(uint64_t counter);
+    size_t chunk_len() const;
+    void push_stack(const uint32_t cv[8]);
+    void add_chunk_chaining_value(uint32_t cv[8], uint64_t total_chunks);
+
+    chunk_state chunk;
+    //One entry per level of the tree, 54 covers 2^64 bytes of input
+    uint32_t cv_stack[54][8];
+    uint8_t cv_stack_len = 0;
+};
@@ -0,0 +1,491 @@
+#include "chunk-cache.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char chunk_pack_magic[4] = { 'C', 'M', 'C', 'P' };
+static const uint8_t chunk_pack_version = 1;
+
+static const size_t pack_header_size = sizeof(chunk_pack_magic) + 1;
+static const size_t record_header_size = blake3_out_len + 4;
+
+static FILE* open_file(const std::filesystem::path& path, const char* mode)
+{
+#ifdef _WIN32
+    std::wstring wide_mode(mode, mode + strlen(mode));
+    return _wfopen(path.c_str(), wide_mode.c_str());
+#else
+    return fopen(path.c_str(), mode);
+#endif
+}
+
+static bool write_record(FILE* file, const blake3_hash& id, const uint8_t* data, uint32_t length)
+{
+    return fwrite(id.bytes, 1, blake3_out_len, file) == blake3_out_len &&
+        fwrite(&length, 1, 4, file) == 4 &&
+        fwrite(data, 1, length, file) == length;
+}
+
+chunk_cache::~chunk_cache()
+{
+    close();
+}
+
+bool chunk_cache::open(const std::string& directory, std::string& error)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    std::error_code fs_error;
+    const std::filesystem::path root = std::filesystem::u8path(directory);
+    std::filesystem::create_directories(root, fs_error);
+    if (fs_error)
+    {
+        error = "Unable to create chunk cache folder";
+        return false;
+    }
+
+    pack_path = root / "chunks.pack";
+    return open_pack(error);
+}
+
+bool chunk_cache::open_pack(std::string& error)
+{
+    std::error_code fs_error;
+    if (!std::filesystem::exists(pack_path, fs_error))
+    {
+        FILE* file = open_file(pack_path, "wb");
+        if (!file)
+        {
+            error = "Unable to create chunk pack";
+            return false;
+        }
+        fwrite(chunk_pack_magic, 1, sizeof(chunk_pack_magic), file);
+        fwrite(&chunk_pack_version, 1, 1, file);
+        fclose(file);
+    }
+
+    pack_size = std::filesystem::file_size(pack_path, fs_error);
+    if (fs_error || !map_pack())
+    {
+        error = "Unable to map chunk pack";
+        return false;
+    }
+
+    const uint8_t* data = view->data;
+    const size_t mapped_size = view->size;
+
+    if (mapped_size < pack_header_size || memcmp(data, chunk_pack_magic, sizeof(chunk_pack_magic)) != 0 ||
+        data[sizeof(chunk_pack_magic)] != chunk_pack_version)
+    {
+        unmap_pack();
+        error = "Chunk pack is corrupt";
+        return false;
+    }
+
+    index.clear();
+    chunk_bytes = 0;
+
+    uint64_t offset = pack_header_size;
+    while (offset + record_header_size <= mapped_size)
+    {
+        blake3_hash id;
+        memcpy(id.bytes, data + offset, blake3_out_len);
+        uint32_t length;
+        memcpy(&length, data + offset + blake3_out_len, 4);
+
+        if (offset + record_header_size + length > mapped_size) break;
+
+        if (index.emplace(id, location { offset + record_header_size, length }).second)
+        {
+            chunk_bytes += length;
+        }
+        offset += record_header_size + length;
+    }
+
+    if (offset != pack_size)
+    {
+        //Torn write from a crash, drop the partial record so new appends line up
+        unmap_pack();
+        std::filesystem::resize_file(pack_path, offset, fs_error);
+        if (fs_error)
+        {
+            error = "Unable to repair chunk pack";
+            return false;
+        }
+        pack_size = offset;
+        map_pack();
+    }
+
+    append_file = open_file(pack_path, "ab");
+    if (!append_file)
+    {
+        unmap_pack();
+        error = "Unable to open chunk pack for writing";
+        return false;
+    }
+
+    return true;
+}
+
+void chunk_cache::close()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    unmap_pack();
+    if (append_file) fclose(append_file);
+    append_file = nullptr;
+    index.clear();
+    chunk_bytes = 0;
+    pack_size = 0;
+}
+
+chunk_cache::pack_view::~pack_view()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+}
+
+bool chunk_cache::map_pack()
+{
+    unmap_pack();
+
+    auto mapped_view = std::make_shared<pack_view>();
+
+#ifdef _WIN32
+    //The append handle stays open, so the mapping has to share writes.
+    HANDLE file = CreateFileW(pack_path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    mapped_view->file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        return false;
+    }
+    mapped_view->size = size_t(file_size.QuadPart);
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        return false;
+    }
+    mapped_view->mapping_handle = mapping;
+
+    mapped_view->data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(pack_path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* mapped = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (mapped != MAP_FAILED)
+    {
+        mapped_view->data = static_cast<const uint8_t*>(mapped);
+        mapped_view->size = size_t(file_stat.st_size);
+    }
+#endif
+
+    if (!mapped_view->data) return false;
+
+    view = std::move(mapped_view);
+    return true;
+}
+
+void chunk_cache::unmap_pack()
+{
+    //A borrowed view stays mapped until it's returned
+    view.reset();
+}
+
+bool chunk_cache::ensure_mapped(uint64_t end)
+{
+    if (view && end <= view->size) return true;
+
+    if (append_file) fflush(append_file);
+    return map_pack() && end <= view->size;
+}
+
+std::shared_ptr<const chunk_cache::pack_view> chunk_cache::borrow_view(uint64_t end)
+{
+    if (!ensure_mapped(end)) return nullptr;
+
+    ++borrowed_views;
+    return view;
+}
+
+void chunk_cache::return_view(std::shared_ptr<const pack_view>& borrowed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        borrowed.reset();
+        --borrowed_views;
+    }
+    views_returned.notify_all();
+}
+
+bool chunk_cache::has(const blake3_hash& id) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.count(id) > 0;
+}
+
+bool chunk_cache::put(const blake3_hash& id, const uint8_t* chunk, size_t length)
+{
+    if (length > UINT32_MAX) return false;
+
+    //Hash outside the lock, it's the expensive part
+    if (blake3_hasher::hash(chunk, length) != id) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!append_file) return false;
+    if (index.count(id)) return true;
+
+    if (!write_record(append_file, id, chunk, uint32_t(length)))
+    {
+        //Whatever made it out is a torn record, open_pack trims it next time
+        return false;
+    }
+
+    index.emplace(id, location { pack_size + record_header_size, uint32_t(length) });
+    pack_size += record_header_size + length;
+    chunk_bytes += length;
+    return true;
+}
+
+bool chunk_cache::read(const blake3_hash& id, std::vector<uint8_t>& chunk)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto found = index.find(id);
+    if (found == index.end()) return false;
+
+    const location& where = found->second;
+    if (!ensure_mapped(where.offset + where.length)) return false;
+
+    //Chunk sized, fine to copy under the lock
+    chunk.assign(view->data + where.offset, view->data + where.offset + where.length);
+    return true;
+}
+
+bool chunk_cache::assemble(const std::vector<blake3_hash>& ids, const std::string& path, std::string& error)
+{
+    //Locations are copied, the index can rehash once the lock is let go
+    std::vector<location> locations;
+    locations.reserve(ids.size());
+
+    std::shared_ptr<const pack_view> source;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        uint64_t end = 0;
+        for (const blake3_hash& id : ids)
+        {
+            auto found = index.find(id);
+            if (found == index.end())
+            {
+                error = "Missing chunk " + id.to_hex();
+                return false;
+            }
+            locations.push_back(found->second);
+            end = std::max<uint64_t>(end, found->second.offset + found->second.length);
+        }
+
+        source = borrow_view(end);
+        if (!source)
+        {
+            error = "Unable to map chunk pack";
+            return false;
+        }
+    }
+
+    //Same temp and swap as the media index, a player never sees a half written file
+    const std::filesystem::path target = std::filesystem::u8path(path);
+    std::filesystem::path temp = target;
+    temp += ".tmp";
+
+    bool written = false;
+    FILE* file = open_file(temp, "wb");
+    if (file)
+    {
+        written = true;
+        for (const location& where : locations)
+        {
+            if (fwrite(source->data + where.offset, 1, where.length, file) != where.length)
+            {
+                written = false;
+                break;
+            }
+        }
+        written = fclose(file) == 0 && written;
+    }
+
+    return_view(source);
+
+    std::error_code fs_error;
+    if (!file)
+    {
+        error = "Unable to create " + path;
+        return false;
+    }
+
+    if (!written)
+    {
+        std::filesystem::remove(temp, fs_error);
+        error = "Unable to write " + path;
+        return false;
+    }
+
+    std::filesystem::rename(temp, target, fs_error);
+    if (fs_error)
+    {
+        std::filesystem::remove(temp, fs_error);
+        error = "Unable to replace " + path;
+        return false;
+    }
+    return true;
+}
+
+bool chunk_cache::compact(const chunk_id_set& keep, std::string& error)
+{
+    struct kept_chunk
+    {
+        blake3_hash id;
+        location where;
+    };
+
+    std::vector<kept_chunk> kept;
+    std::shared_ptr<const pack_view> source;
+    uint64_t copied_size = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (!append_file)
+        {
+            error = "Chunk cache isn't open";
+            return false;
+        }
+        if (compacting)
+        {
+            error = "Chunk cache is already compacting";
+            return false;
+        }
+
+        source = borrow_view(pack_size);
+        if (!source)
+        {
+            error = "Unable to map chunk pack";
+            return false;
+        }
+
+        for (const auto& entry : index)
+        {
+            if (keep.count(entry.first)) kept.push_back({ entry.first, entry.second });
+        }
+        copied_size = pack_size;
+        compacting = true;
+    }
+
+    std::filesystem::path temp = pack_path;
+    temp += ".tmp";
+
+    //The bulk of the copy, chunks put from here on are picked up below
+    FILE* file = open_file(temp, "wb");
+    bool written = file &&
+        fwrite(chunk_pack_magic, 1, sizeof(chunk_pack_magic), file) == sizeof(chunk_pack_magic) &&
+        fwrite(&chunk_pack_version, 1, 1, file) == 1;
+
+    for (const kept_chunk& chunk : kept)
+    {
+        if (!written) break;
+        written = write_record(file, chunk.id, source->data + chunk.where.offset, chunk.where.length);
+    }
+
+    return_view(source);
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    //Windows can't replace a pack that's still mapped, and an assemble could be mid copy
+    views_returned.wait(lock, [this] { return borrowed_views == 0; });
+    compacting = false;
+
+    if (!append_file)
+    {
+        if (file) fclose(file);
+        std::error_code fs_error;
+        std::filesystem::remove(temp, fs_error);
+        error = "Chunk cache was closed while compacting";
+        return false;
+    }
+
+    //Chunks put during the copy were just fetched for something, they're kept whatever keep says
+    if (written && pack_size > copied_size && ensure_mapped(pack_size))
+    {
+        for (const auto& entry : index)
+        {
+            if (!written) break;
+            if (entry.second.offset < copied_size) continue;
+
+            written = write_record(file, entry.first, view->data + entry.second.offset, entry.second.length);
+        }
+    }
+    if (file) written = fclose(file) == 0 && written;
+
+    std::error_code fs_error;
+    if (!written)
+    {
+        std::filesystem::remove(temp, fs_error);
+        error = "Unable to write compacted chunk pack";
+        return false;
+    }
+
+    //The map and append handle have to go before the pack can be replaced on Windows.
+    unmap_pack();
+    fclose(append_file);
+    append_file = nullptr;
+
+    std::filesystem::rename(temp, pack_path, fs_error);
+    if (fs_error)
+    {
+        std::filesystem::remove(temp, fs_error);
+        error = "Unable to replace chunk pack";
+        //Still reopen the old pack so the cache keeps working
+        std::string reopen_error;
+        open_pack(reopen_error);
+        return false;
+    }
+
+    return open_pack(error);
+}
+
+size_t chunk_cache::chunk_count() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return index.size();
+}
+
+uint64_t chunk_cache::stored_bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return chunk_bytes;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "blake3.hh"
+
+using chunk_id_set = std::unordered_set<blake3_hash, blake3_hash_hasher>;
+
+//Local store of chunks keyed by their BLAKE3 id. Chunks are appended to a single pack file which is memory mapped
+//for reads, the lookup table is rebuilt from the record headers on open so there's no separate index to go stale.
+//
+//Layout: "CMCP", version byte, then per chunk
+//  32 byte id, u32 length, chunk bytes
+//
+//Safe to use from several threads, every call takes the cache lock. put, has and read run on the main thread so
+//the lock is never held for file sized work: assemble and compact only take it to look chunks up and to swap the
+//pack, the copying runs against a view of the pack they keep mapped for themselves.
+class chunk_cache
+{
+public:
+    ~chunk_cache();
+
+    bool open(const std::string& directory, std::string& error);
+    void close();
+
+    bool has(const blake3_hash& id) const;
+
+    //Refuses data that doesn't hash to id, a bad peer can't poison the cache.
+    bool put(const blake3_hash& id, const uint8_t* data, size_t length);
+    bool read(const blake3_hash& id, std::vector<uint8_t>& data);
+
+    //Writes the chunks in order to path. Fails without touching path if any chunk is missing.
+    bool assemble(const std::vector<blake3_hash>& ids, const std::string& path, std::string& error);
+
+    //Rewrites the pack with only the chunks in keep.
+    bool compact(const chunk_id_set& keep, std::string& error);
+
+    size_t chunk_count() const;
+    uint64_t stored_bytes() const;
+
+private:
+    struct location
+    {
+        uint64_t offset;
+        uint32_t length;
+    };
+
+    //The pack mapped at the size it had then. Remapping after appends makes a new view, so one lent out stays
+    //valid until its borrower lets go.
+    struct pack_view
+    {
+        ~pack_view();
+
+        const uint8_t* data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        void* file_handle = nullptr;
+        void* mapping_handle = nullptr;
+#endif
+    };
+
+    bool open_pack(std::string& error);
+    bool map_pack();
+    void unmap_pack();
+    //Appended chunks land past the end of the current view
+    bool ensure_mapped(uint64_t end);
+
+    //A view covering end for use outside the lock, hand it back with return_view
+    std::shared_ptr<const pack_view> borrow_view(uint64_t end);
+    void return_view(std::shared_ptr<const pack_view>& borrowed);
+
+    std::filesystem::path pack_path;
+    FILE* append_file = nullptr;
+    uint64_t pack_size = 0;
+
+    std::shared_ptr<pack_view> view;
+    //Views lent out, Windows can't replace the pack while any of them are still mapped
+    size_t borrowed_views = 0;
+    std::condition_variable views_returned;
+    bool compacting = false;
+
+    std::unordered_map<blake3_hash, location, blake3_hash_hasher> index;
+    uint64_t chunk_bytes = 0;
+
+    mutable std::mutex mutex;
+};
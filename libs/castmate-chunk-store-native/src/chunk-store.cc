@@ -0,0 +1,267 @@
+#include "chunk-store.hh"
+
+#include "castmate-native/trace.hh"
+
+Napi::Object chunk_store::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeChunkStore", {
+        InstanceMethod("chunkFile", &chunk_store::chunk_file),
+        InstanceMethod("missing", &chunk_store::missing),
+        InstanceMethod("put", &chunk_store::put),
+        InstanceMethod("read", &chunk_store::read),
+        InstanceMethod("assemble", &chunk_store::assemble),
+        InstanceMethod("compact", &chunk_store::compact),
+        InstanceMethod("getStats", &chunk_store::get_stats),
+    });
+
+    exports.Set("NativeChunkStore", constructor);
+    return exports;
+}
+
+static bool read_id(const Napi::Value& value, blake3_hash& id)
+{
+    return value.IsString() && blake3_hash::from_hex(value.As<Napi::String>().Utf8Value(), id);
+}
+
+static bool read_ids(const Napi::Value& value, std::vector<blake3_hash>& ids)
+{
+    if (!value.IsArray()) return false;
+
+    Napi::Array array = value.As<Napi::Array>();
+    ids.resize(array.Length());
+    for (uint32_t i = 0; i < array.Length(); ++i)
+    {
+        if (!read_id(array.Get(i), ids[i])) return false;
+    }
+    return true;
+}
+
+chunk_store::chunk_store(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<chunk_store>(info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "NativeChunkStore requires a cache folder.").ThrowAsJavaScriptException();
+        return;
+    }
+
+    cache = std::make_shared<chunk_cache>();
+
+    std::string error;
+    if (!cache->open(info[0].As<Napi::String>().Utf8Value(), error))
+    {
+        cache.reset();
+        Napi::Error::New(env, error + ".").ThrowAsJavaScriptException();
+        return;
+    }
+}
+
+void chunk_store::Finalize(Napi::Env env)
+{
+    cache.reset();
+}
+
+//chunkFile(path, store, callback) calls back (err, { size, id, ids, lengths }), with store the chunks are also cached
+Napi::Value chunk_store::chunk_file(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsString() || !info[2].IsFunction())
+    {
+        Napi::Error::New(env, "chunkFile requires a path, store flag, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const bool store = info[1].ToBoolean().Value();
+
+    auto worker = new chunk_file_worker(store ? cache : nullptr, info[0].As<Napi::String>().Utf8Value(), info[2].As<Napi::Function>());
+    worker->Queue();
+    return env.Undefined();
+}
+
+//missing(ids) returns the indices of the ids that aren't cached yet
+Napi::Value chunk_store::missing(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    std::vector<blake3_hash> ids;
+    if (info.Length() < 1 || !read_ids(info[0], ids))
+    {
+        Napi::Error::New(env, "missing requires an array of chunk ids.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array result = Napi::Array::New(env);
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < ids.size(); ++i)
+    {
+        if (!cache || !cache->has(ids[i]))
+        {
+            result.Set(count++, Napi::Number::New(env, i));
+        }
+    }
+    return result;
+}
+
+//put(id, data) returns false if data doesn't hash to id
+Napi::Value chunk_store::put(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    blake3_hash id;
+    if (info.Length() < 2 || !read_id(info[0], id) || !info[1].IsTypedArray())
+    {
+        Napi::Error::New(env, "put requires a chunk id and a Uint8Array.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Uint8Array data = info[1].As<Napi::Uint8Array>();
+    return Napi::Boolean::New(env, cache && cache->put(id, data.Data(), data.ByteLength()));
+}
+
+Napi::Value chunk_store::read(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    blake3_hash id;
+    if (info.Length() < 1 || !read_id(info[0], id))
+    {
+        Napi::Error::New(env, "read requires a chunk id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::vector<uint8_t> data;
+    if (!cache || !cache->read(id, data)) return env.Undefined();
+
+    return Napi::Buffer<uint8_t>::Copy(env, data.data(), data.size());
+}
+
+//assemble(ids, path, callback) writes the chunks to path in order
+Napi::Value chunk_store::assemble(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    std::vector<blake3_hash> ids;
+    if (info.Length() < 3 || !read_ids(info[0], ids) || !info[1].IsString() || !info[2].IsFunction())
+    {
+        Napi::Error::New(env, "assemble requires chunk ids, a path, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto worker = new assemble_worker(cache, std::move(ids), info[1].As<Napi::String>().Utf8Value(), info[2].As<Napi::Function>());
+    worker->Queue();
+    return env.Undefined();
+}
+
+//compact(keepIds, callback) drops every chunk not in keepIds
+Napi::Value chunk_store::compact(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    std::vector<blake3_hash> ids;
+    if (info.Length() < 2 || !read_ids(info[0], ids) || !info[1].IsFunction())
+    {
+        Napi::Error::New(env, "compact requires the chunk ids to keep and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto worker = new compact_worker(cache, chunk_id_set(ids.begin(), ids.end()), info[1].As<Napi::Function>());
+    worker->Queue();
+    return env.Undefined();
+}
+
+Napi::Value chunk_store::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("chunks", Napi::Number::New(env, cache ? double(cache->chunk_count()) : 0));
+    stats.Set("bytes", Napi::Number::New(env, cache ? double(cache->stored_bytes()) : 0));
+    return stats;
+}
+
+///////////////////////////////WORKERS///////////////////////////////
+
+chunk_file_worker::chunk_file_worker(std::shared_ptr<chunk_cache> cache, const std::string& path, const Napi::Function& callback)
+    : AsyncWorker(callback)
+    , cache(std::move(cache))
+    , path(path)
+{
+}
+
+void chunk_file_worker::Execute()
+{
+    TRACE_SCOPE("chunk file");
+
+    chunk_callback on_chunk;
+    if (cache)
+    {
+        on_chunk = [this](const blake3_hash& id, const uint8_t* data, size_t length) {
+            cache->put(id, data, length);
+        };
+    }
+
+    std::string error;
+    if (!::chunk_file(path, manifest, error, on_chunk))
+    {
+        SetError(error);
+    }
+}
+
+void chunk_file_worker::OnOK()
+{
+    Napi::Env env = Env();
+
+    Napi::Array ids = Napi::Array::New(env, manifest.ids.size());
+    Napi::Array lengths = Napi::Array::New(env, manifest.lengths.size());
+    for (uint32_t i = 0; i < manifest.ids.size(); ++i)
+    {
+        ids.Set(i, Napi::String::New(env, manifest.ids[i].to_hex()));
+        lengths.Set(i, Napi::Number::New(env, manifest.lengths[i]));
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("size", Napi::Number::New(env, double(manifest.size)));
+    result.Set("id", Napi::String::New(env, manifest.id.to_hex()));
+    result.Set("ids", ids);
+    result.Set("lengths", lengths);
+
+    Callback().Call({ env.Null(), result });
+}
+
+assemble_worker::assemble_worker(std::shared_ptr<chunk_cache> cache, std::vector<blake3_hash>&& ids, const std::string& path, const Napi::Function& callback)
+    : AsyncWorker(callback)
+    , cache(std::move(cache))
+    , ids(std::move(ids))
+    , path(path)
+{
+}
+
+void assemble_worker::Execute()
+{
+    TRACE_SCOPE("assemble file");
+
+    std::string error;
+    if (!cache || !cache->assemble(ids, path, error))
+    {
+        SetError(cache ? error : "Chunk cache isn't open");
+    }
+}
+
+compact_worker::compact_worker(std::shared_ptr<chunk_cache> cache, chunk_id_set&& keep, const Napi::Function& callback)
+    : AsyncWorker(callback)
+    , cache(std::move(cache))
+    , keep(std::move(keep))
+{
+}
+
+void compact_worker::Execute()
+{
+    std::string error;
+    if (!cache || !cache->compact(keep, error))
+    {
+        SetError(cache ? error : "Chunk cache isn't open");
+    }
+}
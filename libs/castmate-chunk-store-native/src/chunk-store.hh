@@ -0,0 +1,74 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "chunk-cache.hh"
+#include "chunker.hh"
+
+class chunk_store : public Napi::ObjectWrap<chunk_store>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    chunk_store(const Napi::CallbackInfo& info);
+    virtual void Finalize(Napi::Env env);
+
+    Napi::Value chunk_file(const Napi::CallbackInfo& info);
+    Napi::Value missing(const Napi::CallbackInfo& info);
+    Napi::Value put(const Napi::CallbackInfo& info);
+    Napi::Value read(const Napi::CallbackInfo& info);
+    Napi::Value assemble(const Napi::CallbackInfo& info);
+    Napi::Value compact(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+
+private:
+    //Shared with in flight workers so a collected store doesn't pull the pack out from under them.
+    std::shared_ptr<chunk_cache> cache;
+};
+
+//Hashing and disk work all happen on the libuv pool, these only marshal results back.
+class chunk_file_worker : public Napi::AsyncWorker
+{
+public:
+    chunk_file_worker(std::shared_ptr<chunk_cache> cache, const std::string& path, const Napi::Function& callback);
+
+protected:
+    void Execute() override;
+    void OnOK() override;
+
+private:
+    std::shared_ptr<chunk_cache> cache;
+    std::string path;
+    file_manifest manifest;
+};
+
+class assemble_worker : public Napi::AsyncWorker
+{
+public:
+    assemble_worker(std::shared_ptr<chunk_cache> cache, std::vector<blake3_hash>&& ids, const std::string& path, const Napi::Function& callback);
+
+protected:
+    void Execute() override;
+
+private:
+    std::shared_ptr<chunk_cache> cache;
+    std::vector<blake3_hash> ids;
+    std::string path;
+};
+
+class compact_worker : public Napi::AsyncWorker
+{
+public:
+    compact_worker(std::shared_ptr<chunk_cache> cache, chunk_id_set&& keep, const Napi::Function& callback);
+
+protected:
+    void Execute() override;
+
+private:
+    std::shared_ptr<chunk_cache> cache;
+    chunk_id_set keep;
+};
@@ -0,0 +1,126 @@
+#include "chunker.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+//Normalized chunking: a stricter mask before the average size and a looser one after it keeps chunk sizes
+//bunched around the average instead of the long tail plain gear hashing gives. The average is 2^15, so the masks
+//are 15 +- 2 bits. They sit at the top of the hash since the high bits have seen the most bytes.
+static const uint64_t mask_strict = 0xFFFF800000000000ull;
+static const uint64_t mask_loose = 0xFFF8000000000000ull;
+
+struct gear_table
+{
+    uint64_t values[256];
+
+    gear_table()
+    {
+        //The table has to be identical on every machine or chunk ids won't line up, so it's generated from a
+        //fixed seed rather than random_device.
+        uint64_t state = 0x43617374'4d617465ull;
+        for (uint64_t& value : values)
+        {
+            state += 0x9E3779B97F4A7C15ull;
+            uint64_t z = state;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            value = z ^ (z >> 31);
+        }
+    }
+};
+
+static const gear_table gear;
+
+size_t content_chunker::next_boundary(const uint8_t* data, size_t length)
+{
+    if (length <= chunk_min_size) return length;
+
+    size_t limit = length < chunk_max_size ? length : chunk_max_size;
+    size_t normal = length < chunk_avg_size ? length : chunk_avg_size;
+
+    uint64_t hash = 0;
+    size_t i = chunk_min_size;
+
+    for (; i < normal; ++i)
+    {
+        hash = (hash << 1) + gear.values[data[i]];
+        if (!(hash & mask_strict)) return i + 1;
+    }
+
+    for (; i < limit; ++i)
+    {
+        hash = (hash << 1) + gear.values[data[i]];
+        if (!(hash & mask_loose)) return i + 1;
+    }
+
+    return limit;
+}
+
+//Big enough that refills are rare, and always at least one max sized chunk so a boundary is never cut short.
+static const size_t read_buffer_size = 4 * 1024 * 1024;
+
+bool chunk_file(const std::string& path, file_manifest& manifest, std::string& error, const chunk_callback& on_chunk)
+{
+#ifdef _WIN32
+    FILE* file = _wfopen(std::filesystem::u8path(path).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+    if (!file)
+    {
+        error = "Unable to open " + path;
+        return false;
+    }
+
+    manifest = file_manifest();
+
+    std::vector<uint8_t> buffer(read_buffer_size);
+    size_t start = 0;
+    size_t end = 0;
+    bool eof = false;
+
+    blake3_hasher id_hasher;
+
+    while (true)
+    {
+        if (!eof && end - start < chunk_max_size)
+        {
+            memmove(buffer.data(), buffer.data() + start, end - start);
+            end -= start;
+            start = 0;
+
+            const size_t got = fread(buffer.data() + end, 1, buffer.size() - end, file);
+            end += got;
+            if (got == 0)
+            {
+                eof = true;
+                if (ferror(file))
+                {
+                    fclose(file);
+                    error = "Unable to read " + path;
+                    return false;
+                }
+            }
+            continue;
+        }
+
+        if (start == end) break;
+
+        const size_t length = content_chunker::next_boundary(buffer.data() + start, end - start);
+        const blake3_hash id = blake3_hasher::hash(buffer.data() + start, length);
+
+        if (on_chunk) on_chunk(id, buffer.data() + start, length);
+
+        manifest.ids.push_back(id);
+        manifest.lengths.push_back(uint32_t(length));
+        manifest.size += length;
+        id_hasher.update(id.bytes, blake3_out_len);
+
+        start += length;
+    }
+
+    fclose(file);
+    manifest.id = id_hasher.finalize();
+    return true;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "blake3.hh"
+
+//FastCDC content defined chunking. Boundaries come from a gear rolling hash over the content itself, so an edit
+//in the middle of a file only changes the chunks around it and everything after it still dedupes.
+//
+//Sizes are picked so a whole chunk fits in one data channel message.
+static const size_t chunk_min_size = 8 * 1024;
+static const size_t chunk_avg_size = 32 * 1024;
+static const size_t chunk_max_size = 128 * 1024;
+
+class content_chunker
+{
+public:
+    //Length of the next chunk at the start of data. Returns length itself when length <= chunk_min_size.
+    //Callers streaming a file must pass at least chunk_max_size bytes unless they're at the end of it.
+    static size_t next_boundary(const uint8_t* data, size_t length);
+};
+
+struct file_manifest
+{
+    uint64_t size = 0;
+    //Hash of the chunk ids in order, two files with the same id have the same content
+    blake3_hash id;
+    std::vector<blake3_hash> ids;
+    std::vector<uint32_t> lengths;
+};
+
+using chunk_callback = std::function<void(const blake3_hash& id, const uint8_t* data, size_t length)>;
+
+//Streams the file through the chunker. on_chunk, if set, sees each chunk's bytes while they're still in memory.
+bool chunk_file(const std::string& path, file_manifest& manifest, std::string& error, const chunk_callback& on_chunk = nullptr);
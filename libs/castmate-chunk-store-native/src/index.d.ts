@@ -0,0 +1,84 @@
+declare namespace CastmateChunkStoreNative {
+	interface ChunkManifest {
+		size: number
+		/** BLAKE3 of the chunk ids in order, equal ids mean equal content */
+		id: string
+		/** BLAKE3 of each chunk, hex */
+		ids: string[]
+		lengths: number[]
+	}
+
+	interface ChunkStoreStats {
+		chunks: number
+		bytes: number
+	}
+
+	class ChunkStore {
+		/** Chunks live in a single memory mapped pack file in cacheDir */
+		constructor(cacheDir: string)
+
+		/** Content defined chunking on a worker thread, with store the chunks are also added to the cache */
+		chunkFile(path: string, store?: boolean): Promise<ChunkManifest>
+		/** Indices of the ids that aren't cached */
+		missing(ids: string[]): number[]
+		/** Returns false if the data doesn't hash to id */
+		put(id: string, data: Uint8Array): boolean
+		read(id: string): Buffer | undefined
+		/** Writes the chunks in order to outPath, rejects without touching outPath if any are missing */
+		assemble(ids: string[], outPath: string): Promise<void>
+		/** Rewrites the pack with only the given chunks */
+		compact(keepIds: string[]): Promise<void>
+		getStats(): ChunkStoreStats
+	}
+
+	type ChunkSend = (message: Buffer) => void | Promise<void>
+
+	class ChunkServer {
+		/** resolvePath maps a requested file to a local path, undefined refuses the request */
+		constructor(store: ChunkStore, resolvePath: (file: string) => string | undefined | Promise<string | undefined>)
+
+		/** send goes back to the peer the message came from, one server can serve many clients */
+		handleMessage(data: Uint8Array | ArrayBuffer, send: ChunkSend): Promise<void>
+	}
+
+	interface ChunkFetchResult {
+		id: string
+		/** Chunk ids of the file, for deciding what to keep when compacting */
+		ids: string[]
+		size: number
+		chunks: number
+		fetchedChunks: number
+		fetchedBytes: number
+	}
+
+	interface ChunkClientOptions {
+		/** Milliseconds without a message from the server before a request fails, defaults to 10000 */
+		timeout?: number
+	}
+
+	class ChunkClient {
+		constructor(store: ChunkStore, send: ChunkSend, options?: ChunkClientOptions)
+
+		handleMessage(data: Uint8Array | ArrayBuffer): void
+		/** Fails every outstanding request */
+		close(reason?: string): void
+
+		fetchManifest(file: string): Promise<ChunkManifest>
+		/** Brings outPath up to date with the server's copy of file, only missing chunks are transferred */
+		fetchFile(file: string, outPath: string): Promise<ChunkFetchResult>
+	}
+
+	/** Length prefixed framing over a net.Socket */
+	function socketTransport(socket: import("net").Socket, onMessage: (message: Buffer) => any): ChunkSend
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateChunkStoreNative
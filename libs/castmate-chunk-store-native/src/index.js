@@ -0,0 +1,67 @@
+const bindings = require("bindings")
+const { ChunkServer, ChunkClient, socketTransport } = require("./sync")
+
+const native = bindings({
+	bindings: "castmate-chunk-store-native",
+})
+
+class ChunkStore {
+	constructor(cacheDir) {
+		this._native = new native.NativeChunkStore(cacheDir)
+	}
+
+	chunkFile(path, store) {
+		return new Promise((resolve, reject) => {
+			this._native.chunkFile(path, !!store, (err, manifest) => {
+				if (err) return reject(err)
+				resolve(manifest)
+			})
+		})
+	}
+
+	missing(ids) {
+		return this._native.missing(ids)
+	}
+
+	put(id, data) {
+		return this._native.put(id, data)
+	}
+
+	read(id) {
+		return this._native.read(id)
+	}
+
+	assemble(ids, outPath) {
+		return new Promise((resolve, reject) => {
+			this._native.assemble(ids, outPath, (err) => {
+				if (err) return reject(err)
+				resolve()
+			})
+		})
+	}
+
+	compact(keepIds) {
+		return new Promise((resolve, reject) => {
+			this._native.compact(keepIds, (err) => {
+				if (err) return reject(err)
+				resolve()
+			})
+		})
+	}
+
+	getStats() {
+		return this._native.getStats()
+	}
+}
+
+module.exports = {
+	ChunkStore,
+	ChunkServer,
+	ChunkClient,
+	socketTransport,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,329 @@
+// Chunk sync protocol
+// Moves files between a ChunkServer and ChunkClient over any ordered, reliable message transport, a framed
+// socket or an RTC data channel. The client only asks for the chunks its store doesn't already have, so a
+// re-encoded or trimmed file only costs the chunks that actually changed.
+//
+// Every message is [u8 type][u32 request id][payload]
+
+const fs = require("fs")
+
+const MessageType = {
+	manifestRequest: 1,
+	manifest: 2,
+	chunkRequest: 3,
+	chunk: 4,
+	done: 5,
+	error: 6,
+}
+
+const headerSize = 5
+
+//Chunks per request, caps how much one transfer can queue up on a data channel (at most 4MB at the max chunk size)
+const chunkBatchSize = 32
+
+function toBuffer(data) {
+	if (Buffer.isBuffer(data)) return data
+	if (data instanceof ArrayBuffer) return Buffer.from(data)
+	return Buffer.from(data.buffer, data.byteOffset, data.byteLength)
+}
+
+function encode(type, requestId, payload) {
+	const header = Buffer.allocUnsafe(headerSize)
+	header.writeUInt8(type, 0)
+	header.writeUInt32LE(requestId, 1)
+	return payload ? Buffer.concat([header, payload]) : header
+}
+
+function decode(data) {
+	const buffer = toBuffer(data)
+	if (buffer.length < headerSize) return undefined
+
+	return {
+		type: buffer.readUInt8(0),
+		requestId: buffer.readUInt32LE(1),
+		payload: buffer.subarray(headerSize),
+	}
+}
+
+function encodeJson(type, requestId, value) {
+	return encode(type, requestId, Buffer.from(JSON.stringify(value), "utf8"))
+}
+
+class ChunkServer {
+	/**
+	 * @param store ChunkStore used to chunk served files
+	 * @param resolvePath Maps a requested file to a local path, undefined refuses the request
+	 */
+	constructor(store, resolvePath) {
+		this.store = store
+		this.resolvePath = resolvePath
+		//localPath -> { size, mtimeMs, promise }, manifests are only rebuilt when the file changes
+		this.manifests = new Map()
+	}
+
+	async handleMessage(data, send) {
+		const message = decode(data)
+		if (!message) return
+
+		try {
+			if (message.type == MessageType.manifestRequest) {
+				const entry = await this._getManifest(message.payload.toString("utf8"))
+				await send(encodeJson(MessageType.manifest, message.requestId, entry.manifest))
+			} else if (message.type == MessageType.chunkRequest) {
+				const request = JSON.parse(message.payload.toString("utf8"))
+				await this._sendChunks(message.requestId, request, send)
+			}
+		} catch (err) {
+			await send(encode(MessageType.error, message.requestId, Buffer.from(String(err?.message ?? err), "utf8")))
+		}
+	}
+
+	async _getManifest(file) {
+		const localPath = await this.resolvePath(file)
+		if (!localPath) throw new Error(`${file} isn't available`)
+
+		const stat = await fs.promises.stat(localPath)
+
+		let entry = this.manifests.get(localPath)
+		if (!entry || entry.size != stat.size || entry.mtimeMs != stat.mtimeMs) {
+			entry = {
+				size: stat.size,
+				mtimeMs: stat.mtimeMs,
+				promise: this.store.chunkFile(localPath).then((manifest) => {
+					const offsets = new Array(manifest.lengths.length)
+					let offset = 0
+					for (let i = 0; i < manifest.lengths.length; ++i) {
+						offsets[i] = offset
+						offset += manifest.lengths[i]
+					}
+					return { localPath, manifest, offsets }
+				}),
+			}
+			this.manifests.set(localPath, entry)
+			entry.promise.catch(() => this.manifests.delete(localPath))
+		}
+
+		return await entry.promise
+	}
+
+	async _sendChunks(requestId, request, send) {
+		const entry = await this._getManifest(request.file)
+		if (entry.manifest.id != request.id) throw new Error(`${request.file} changed during the transfer`)
+
+		const handle = await fs.promises.open(entry.localPath, "r")
+		try {
+			for (const index of request.indices) {
+				const length = entry.manifest.lengths[index]
+				if (length == null) throw new Error(`No chunk ${index} in ${request.file}`)
+
+				const message = Buffer.allocUnsafe(headerSize + 4 + length)
+				message.writeUInt8(MessageType.chunk, 0)
+				message.writeUInt32LE(requestId, 1)
+				message.writeUInt32LE(index, headerSize)
+
+				const { bytesRead } = await handle.read(message, headerSize + 4, length, entry.offsets[index])
+				if (bytesRead != length) throw new Error(`${request.file} changed during the transfer`)
+
+				await send(message)
+			}
+		} finally {
+			await handle.close()
+		}
+
+		await send(encode(MessageType.done, requestId))
+	}
+}
+
+class ChunkClient {
+	/**
+	 * @param store ChunkStore received chunks are cached in
+	 * @param send Sends one message to the server, may return a promise to apply backpressure
+	 */
+	constructor(store, send, options) {
+		this.store = store
+		this.send = send
+		this.timeout = options?.timeout ?? 10000
+
+		this.nextRequestId = 1
+		this.requests = new Map()
+
+		//outPath -> manifest id of what was last written there
+		this.assembled = new Map()
+		this.fetches = new Map()
+	}
+
+	handleMessage(data) {
+		const message = decode(data)
+		if (!message) return
+
+		this.requests.get(message.requestId)?.handle(message.type, message.payload)
+	}
+
+	/** Fails every outstanding request, call when the transport goes away */
+	close(reason) {
+		for (const request of this.requests.values()) {
+			request.fail(new Error(reason ?? "Chunk sync closed"))
+		}
+	}
+
+	async fetchManifest(file) {
+		return await this._request(MessageType.manifestRequest, Buffer.from(file, "utf8"), (type, payload, finish) => {
+			if (type == MessageType.manifest) finish(JSON.parse(payload.toString("utf8")))
+		})
+	}
+
+	/**
+	 * Brings outPath up to date with the server's copy of file.
+	 * Resolves to { id, ids, size, chunks, fetchedChunks, fetchedBytes }
+	 */
+	async fetchFile(file, outPath) {
+		//Prefetch and playback can ask for the same file at once
+		const existing = this.fetches.get(outPath)
+		if (existing) return await existing
+
+		const promise = this._fetchFile(file, outPath)
+		this.fetches.set(outPath, promise)
+		try {
+			return await promise
+		} finally {
+			this.fetches.delete(outPath)
+		}
+	}
+
+	async _fetchFile(file, outPath) {
+		const manifest = await this.fetchManifest(file)
+
+		const result = {
+			id: manifest.id,
+			ids: manifest.ids,
+			size: manifest.size,
+			chunks: manifest.ids.length,
+			fetchedChunks: 0,
+			fetchedBytes: 0,
+		}
+
+		if (this.assembled.get(outPath) == manifest.id && fs.existsSync(outPath)) return result
+
+		//A file can repeat a chunk, only fetch each id once
+		const wanted = new Map()
+		for (const index of this.store.missing(manifest.ids)) {
+			if (!wanted.has(manifest.ids[index])) wanted.set(manifest.ids[index], index)
+		}
+		const indices = [...wanted.values()]
+
+		for (let i = 0; i < indices.length; i += chunkBatchSize) {
+			const batch = indices.slice(i, i + chunkBatchSize)
+			result.fetchedBytes += await this._fetchChunks(file, manifest, batch)
+			result.fetchedChunks += batch.length
+		}
+
+		await this.store.assemble(manifest.ids, outPath)
+		this.assembled.set(outPath, manifest.id)
+		return result
+	}
+
+	async _fetchChunks(file, manifest, indices) {
+		const outstanding = new Set(indices)
+		let bytes = 0
+
+		const payload = Buffer.from(JSON.stringify({ file, id: manifest.id, indices }), "utf8")
+		await this._request(MessageType.chunkRequest, payload, (type, payload, finish, fail) => {
+			if (type == MessageType.chunk) {
+				const index = payload.readUInt32LE(0)
+				const data = payload.subarray(4)
+
+				if (!outstanding.has(index) || !this.store.put(manifest.ids[index], data)) {
+					fail(new Error(`Chunk ${index} of ${file} failed verification`))
+					return
+				}
+				outstanding.delete(index)
+				bytes += data.length
+			} else if (type == MessageType.done) {
+				if (outstanding.size > 0) {
+					fail(new Error(`Missing ${outstanding.size} chunks of ${file}`))
+				} else {
+					finish(bytes)
+				}
+			}
+		})
+
+		return bytes
+	}
+
+	_request(type, payload, onMessage) {
+		return new Promise((resolve, reject) => {
+			const requestId = this.nextRequestId++
+			if (this.nextRequestId > 0xffffffff) this.nextRequestId = 1
+
+			let timer = undefined
+			const armTimeout = () => {
+				clearTimeout(timer)
+				timer = setTimeout(() => fail(new Error("Chunk sync timed out")), this.timeout)
+			}
+
+			const cleanup = () => {
+				clearTimeout(timer)
+				this.requests.delete(requestId)
+			}
+			const finish = (value) => {
+				cleanup()
+				resolve(value)
+			}
+			const fail = (err) => {
+				cleanup()
+				reject(err)
+			}
+
+			this.requests.set(requestId, {
+				handle: (type, payload) => {
+					//Each message proves the server is alive, only a stall times out
+					armTimeout()
+					if (type == MessageType.error) {
+						fail(new Error(payload.toString("utf8")))
+					} else {
+						onMessage(type, payload, finish, fail)
+					}
+				},
+				fail,
+			})
+
+			armTimeout()
+			Promise.resolve(this.send(encode(type, requestId, payload))).catch(fail)
+		})
+	}
+}
+
+/**
+ * Length prefixed framing over a net.Socket. Calls onMessage with each whole message and returns a send
+ * function that waits for the socket to drain when it's backed up.
+ */
+function socketTransport(socket, onMessage) {
+	let pending = Buffer.alloc(0)
+
+	socket.on("data", (data) => {
+		pending = pending.length > 0 ? Buffer.concat([pending, data]) : data
+
+		while (pending.length >= 4) {
+			const length = pending.readUInt32LE(0)
+			if (pending.length < 4 + length) break
+
+			onMessage(pending.subarray(4, 4 + length))
+			pending = pending.subarray(4 + length)
+		}
+	})
+
+	return (message) => {
+		const header = Buffer.allocUnsafe(4)
+		header.writeUInt32LE(message.length, 0)
+		socket.write(header)
+		if (socket.write(message)) return
+
+		return new Promise((resolve) => socket.once("drain", resolve))
+	}
+}
+
+module.exports = {
+	ChunkServer,
+	ChunkClient,
+	socketTransport,
+}
@@ -1,6 +1,8 @@
-import { EmoteParsedString, EmoteSet, createEmoteRegex, parseEmotesRegex } from "castmate-schema"
+import { EmoteInfo, EmoteParsedString, EmoteSet } from "castmate-schema"
+import { EmoteMatcher, tracer } from "castmate-emotes-native"
 import { Service } from "../util/service"
 import { usePluginLogger } from "../logging/logging"
+import { registerNativeTracer } from "../util/native-tracing"
 
 export interface EmoteProvider {
 	readonly id: string
@@ -18,50 +20,94 @@ export const EmoteCache = Service(
 	class {
 		private providers = new Map<string, EmoteProvider>()
 		private emoteSets = new Map<string, EmoteSet>()
-		private matchingExpression: string | undefined = undefined
-		private thirdPartyMatching: string | undefined = undefined
+		//Aho-Corasick matchers that are updated one set at a time instead of rebuilding a regex of every emote
+		private matcher = new EmoteMatcher()
+		private thirdPartyMatcher = new EmoteMatcher()
+		private thirdPartyCount = 0
 		private inited = false
 
-		constructor() {}
+		constructor() {
+			registerNativeTracer("emotes", tracer)
+		}
 
 		registerEmoteProvider(provider: EmoteProvider) {
 			this.providers.set(provider.id, provider)
-			if (this.inited) {
-				this.updateMatcher()
+		}
+
+		private addToMatchers(key: string, set: EmoteSet) {
+			const names = Object.keys(set.emotes)
+			this.matcher.addSet(key, names)
+			if (set.provider != "twitch") {
+				this.thirdPartyMatcher.addSet(key, names)
 			}
 		}
 
-		private updateMatcher() {
-			const sets = [...this.emoteSets.values()]
-			const thirdPartySets = sets.filter((s) => s.provider != "twitch")
+		private setEmoteSet(set: EmoteSet) {
+			const key = `${set.provider}.${set.id}`
+			this.emoteSets.set(key, set)
+			this.addToMatchers(key, set)
+			this.updateThirdPartyCount()
+		}
+
+		private removeEmoteSet(key: string) {
+			if (!this.emoteSets.delete(key)) return
+			this.matcher.removeSet(key)
+			this.thirdPartyMatcher.removeSet(key)
+			this.updateThirdPartyCount()
+		}
 
-			if (sets.length > 0) {
-				this.matchingExpression = createEmoteRegex(sets)
-			} else {
-				this.matchingExpression = undefined
+		private updateThirdPartyCount() {
+			let count = 0
+			for (const set of this.emoteSets.values()) {
+				if (set.provider != "twitch") ++count
 			}
+			this.thirdPartyCount = count
+		}
 
-			if (thirdPartySets.length > 0) {
-				this.thirdPartyMatching = createEmoteRegex(thirdPartySets)
-			} else {
-				this.thirdPartyMatching = undefined
+		private findEmote(name: string) {
+			for (const emoteSet of this.emoteSets.values()) {
+				const emote: EmoteInfo | undefined = emoteSet.emotes[name]
+				if (emote) return emote
 			}
+			return undefined
+		}
+
+		private buildParsed(message: string, matches: Uint32Array, result: EmoteParsedString) {
+			let index = 0
+			for (let i = 0; i < matches.length; i += 2) {
+				const start = matches[i]
+				const end = matches[i + 1]
+
+				if (start > index) {
+					result.push({ type: "message", message: message.substring(index, start) })
+				}
+				index = end
+
+				const emote = this.findEmote(message.substring(start, end))
+				if (emote) {
+					result.push({ type: "emote", emote })
+				}
+			}
+
+			if (index < message.length) {
+				result.push({ type: "message", message: message.substring(index) })
+			}
+
+			return result
 		}
 
 		async initialize() {
 			for (const provider of this.providers.values()) {
 				provider.onSetAdded = (set) => {
-					this.emoteSets.set(`${set.provider}.${set.id}`, set)
-					this.updateMatcher()
+					this.setEmoteSet(set)
 				}
 
 				provider.onSetRemoved = (id) => {
-					this.emoteSets.delete(`${provider.id}.${id}`)
-					this.updateMatcher()
+					this.removeEmoteSet(`${provider.id}.${id}`)
 				}
 
 				provider.onSetUpdated = (set) => {
-					this.updateMatcher()
+					this.setEmoteSet(set)
 				}
 			}
 
@@ -73,15 +119,13 @@ export const EmoteCache = Service(
 
 			for (const providerSets of setList) {
 				for (const set of providerSets) {
-					this.emoteSets.set(`${set.provider}.${set.id}`, set)
+					this.setEmoteSet(set)
 				}
 			}
-
-			this.updateMatcher()
 		}
 
 		parseThirdParty(message: EmoteParsedString) {
-			if (!this.thirdPartyMatching) {
+			if (this.thirdPartyCount == 0) {
 				return message
 			}
 
@@ -90,12 +134,8 @@ export const EmoteCache = Service(
 			for (let i = 0; i < message.length; ++i) {
 				const chunk = message[i]
 				if (chunk.type == "message") {
-					const subresult = parseEmotesRegex(
-						chunk.message,
-						[...this.emoteSets.values()],
-						this.thirdPartyMatching
-					)
-					result.push(...subresult)
+					const matches = this.thirdPartyMatcher.parse(chunk.message)
+					this.buildParsed(chunk.message, matches, result)
 				} else {
 					result.push(chunk)
 				}
@@ -105,10 +145,11 @@ export const EmoteCache = Service(
 		}
 
 		parseMessage(message: string): EmoteParsedString {
-			if (!this.matchingExpression) {
+			if (this.emoteSets.size == 0) {
 				return [{ type: "message", message: message }]
 			}
-			return parseEmotesRegex(message, [...this.emoteSets.values()], this.matchingExpression)
+			const matches = this.matcher.parse(message)
+			return this.buildParsed(message, matches, [])
 		}
 	}
 )
@@ -16,6 +16,7 @@ export * from "./stream-plan/stream-plan"
 
 export * from "./util/service"
 export * from "./util/abort-utils"
+export * from "./util/native-tracing"
 export * from "./util/retry-timer"
 export * from "./util/async-cache"
 export * from "./util/events"
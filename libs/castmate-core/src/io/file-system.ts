@@ -4,6 +4,9 @@ import * as path from "path"
 import * as YAML from "yaml"
 import { BrowserWindow, IpcMainInvokeEvent, ipcMain, safeStorage } from "electron"
 import { defineIPCFunc } from "../util/electron"
+import { FileLoader, LoadResult, tracer } from "castmate-loader-native"
+import { registerNativeTracer } from "../util/native-tracing"
+import { globalLogger } from "../logging/logging"
 
 import { dialog } from "electron"
 
@@ -41,12 +44,52 @@ export async function ensureYAML<T = any>(defaultData: T, ...paths: string[]) {
 	}
 }
 
+let fileLoader: FileLoader | undefined = undefined
+
+function getFileLoader() {
+	if (!fileLoader) {
+		//Parsed files are cached by path, size and mtime so unchanged files skip the read and parse on the next start
+		fileLoader = new FileLoader(resolveProjectPath("state", "parse-cache.cmpc"), (message) =>
+			globalLogger.error("Unable to write the parse cache", message)
+		)
+		registerNativeTracer("loader", tracer)
+	}
+	return fileLoader
+}
+
+function resolveLoadResult(result: LoadResult) {
+	if (result.error) throw result.error
+	//The native side only handles the YAML castmate writes, anything fancier is left to the yaml package
+	if (result.text != null) return YAML.parse(result.text)
+	return result.data
+}
+
+export interface LoadedYAML<T = any> {
+	file: string
+	data?: T
+	error?: any
+}
+
+/**
+ * Loads a set of YAML files in parallel off the main thread. A file that fails doesn't fail the rest, its error is
+ * returned in its place.
+ */
+export async function loadManyYAML<T = any>(paths: string[]): Promise<LoadedYAML<T>[]> {
+	const results = await getFileLoader().loadMany(paths.map((p) => resolveProjectPath(p)))
+	return results.map((result) => {
+		try {
+			return { file: result.file, data: resolveLoadResult(result) as T }
+		} catch (error) {
+			return { file: result.file, error }
+		}
+	})
+}
+
 export async function loadYAML<T = any>(...paths: string[]) {
 	const fullPath = resolveProjectPath(...paths)
-	const strData = await fs.readFile(fullPath, "utf-8")
-	const data = YAML.parse(strData)
+	const [result] = await getFileLoader().loadMany([fullPath])
 
-	return data as T
+	return resolveLoadResult(result) as T
 }
 
 export async function writeYAML<T = any>(data: T, ...paths: string[]) {
@@ -89,6 +89,22 @@ export async function ffprobe(file: string): Promise<FFProbeOutput> {
 	return json as FFProbeOutput
 }
 
+//Decodes any audio ffmpeg understands to a 16 bit wav at sampleRate
+export async function ffmpegDecodeAudio(file: string, output: string, sampleRate: number, channels: number = 1) {
+	const resolvedFile = path.resolve(file)
+	const resolvedOutput = path.resolve(output)
+	await new Promise<void>((resolve, reject) => {
+		childProcess.exec(
+			`"${ffmpegPath}" -y -v quiet -i "${resolvedFile}" -vn -ac ${channels} -ar ${sampleRate} -c:a pcm_s16le "${resolvedOutput}"`,
+			{},
+			(err, stdout, stderr) => {
+				if (err) return reject(err)
+				resolve()
+			}
+		)
+	})
+}
+
 export function setupFFMpegPaths() {
 	if (app.isPackaged) {
 		const binPath = path.join(import.meta.dirname, "../../../", "ffmpeg/bin")
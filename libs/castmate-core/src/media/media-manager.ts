@@ -11,7 +11,9 @@ import { globalLogger, usePluginLogger } from "../logging/logging"
 import { WebService } from "../webserver/internal-webserver"
 import express, { Application, NextFunction, Request, Response, response, Router } from "express"
 import { coreAxios } from "../util/request-utils"
-import { ffprobe, setupFFMpegPaths } from "./ffmpeg"
+import { ffmpegDecodeAudio, ffprobe, setupFFMpegPaths } from "./ffmpeg"
+import { MediaFileInfo, MediaIndexer, tracer } from "castmate-media-native"
+import { registerNativeTracer } from "../util/native-tracing"
 //require("@ffmpeg-installer/win32-x64")
 //require("@ffprobe-installer/win32-x64")
 //Thumbnails?
@@ -23,7 +25,12 @@ export function probeMedia(file: string) {
 	return ffprobe(file)
 }
 
+export function decodeMediaAudio(file: string, output: string, sampleRate: number, channels: number = 1) {
+	return ffmpegDecodeAudio(file, output, sampleRate, channels)
+}
+
 const addOrUpdateMediaRenderer = defineCallableIPC<(metadata: MediaMetadata) => void>("media", "addMedia")
+const addMediaBatchRenderer = defineCallableIPC<(metadata: MediaMetadata[]) => void>("media", "addMediaBatch")
 const removeMediaRenderer = defineCallableIPC<(relpath: string) => void>("media", "removeMedia")
 
 export interface MediaFolder {
@@ -73,7 +80,12 @@ export const MediaManager = Service(
 
 		private mediaFiles = new Map<string, MediaMetadata>()
 
+		//Parses headers on a native worker pool and remembers the results by path, size and mtime
+		private indexer = new MediaIndexer(resolveProjectPath("state", "media-index.cmmi"))
+
 		constructor() {
+			registerNativeTracer("media", tracer)
+
 			const mediaPath = resolveProjectPath("./media")
 			this.setupFolderScanner("default", mediaPath)
 
@@ -205,7 +217,10 @@ export const MediaManager = Service(
 		private async setupFolderScanner(id: string, path: string) {
 			globalLogger.log("Scanning", path, "for media")
 			await ensureDirectory(path)
-			const watcher = chokidar.watch(path)
+			await ensureDirectory(resolveProjectPath("state"))
+
+			//The initial scan is done natively, chokidar only has to report changes after it
+			const watcher = chokidar.watch(path, { ignoreInitial: true })
 
 			watcher.on("add", (filepath, stats) => {
 				this.addMedia(id, path, filepath)
@@ -224,23 +239,88 @@ export const MediaManager = Service(
 				path,
 				watcher,
 			})
+
+			const unhandled: string[] = []
+
+			const stats = await this.indexer.scan([path], undefined, (files) => {
+				const batch: MediaMetadata[] = []
+				for (const info of files) {
+					if (!info.handled) {
+						unhandled.push(info.file)
+						continue
+					}
+
+					const metadata = this.createMetadata(id, path, info.file)
+					this.applyInfo(metadata, info)
+					this.mediaFiles.set(metadata.path, metadata)
+					batch.push(metadata)
+				}
+
+				if (batch.length > 0) {
+					addMediaBatchRenderer(batch)
+				}
+			})
+
+			logger.log("Indexed", stats.files, "media files in", stats.elapsedMs.toFixed(0), "ms,", stats.cached, "from cache")
+			if (stats.indexError) {
+				logger.error(stats.indexError)
+			}
+
+			//Formats the indexer can't parse still go through ffprobe, their results are kept for the next start.
+			if (unhandled.length > 0) {
+				for (const filepath of unhandled) {
+					await this.probeWithFFProbe(id, path, filepath)
+				}
+				if (!this.indexer.save()) {
+					logger.error("Unable to write the media index")
+				}
+			}
 		}
 
-		private async addMedia(folderId: string, root: string, filepath: string) {
+		private createMetadata(folderId: string, root: string, filepath: string): MediaMetadata {
 			const rootRelPath = pathTools.relative(root, filepath)
 			const relPath = pathTools.join(folderId, rootRelPath)
 			const normPath = normalizeMediaPath(relPath)
-			const extension = pathTools.extname(filepath)
 
-			const metadata: MediaMetadata = {
+			return {
 				folderId,
 				file: filepath,
 				path: normPath,
 				url: "",
 				name: pathTools.basename(filepath),
 			}
+		}
+
+		private applyInfo(metadata: MediaMetadata, info: MediaFileInfo) {
+			if (info.duration != null) metadata.duration = info.duration
+			if (info.width != null) metadata.width = info.width
+			if (info.height != null) metadata.height = info.height
+			if (info.image) metadata.image = true
+			if (info.audio) metadata.audio = true
+			if (info.video) metadata.video = true
+		}
+
+		private async addMedia(folderId: string, root: string, filepath: string) {
+			const info = this.indexer.probeFile(filepath)
+			if (!info?.handled) {
+				await this.probeWithFFProbe(folderId, root, filepath)
+				return
+			}
 
-			logger.log("New Media", rootRelPath, metadata)
+			const metadata = this.createMetadata(folderId, root, filepath)
+			this.applyInfo(metadata, info)
+
+			logger.log("New Media", metadata.path, metadata)
+
+			this.mediaFiles.set(metadata.path, metadata)
+			addOrUpdateMediaRenderer(metadata)
+		}
+
+		private async probeWithFFProbe(folderId: string, root: string, filepath: string) {
+			const metadata = this.createMetadata(folderId, root, filepath)
+			const extension = pathTools.extname(filepath)
+
+			logger.log("New Media", metadata.path, metadata)
 
 			//Duration
 			try {
@@ -267,10 +347,12 @@ export const MediaManager = Service(
 						}
 					}
 				}
+
+				this.indexer.remember(filepath, metadata)
 			} catch (err) {
 				logger.error("ERROR PROBING MEDIA", err)
 			}
-			this.mediaFiles.set(normPath, metadata)
+			this.mediaFiles.set(metadata.path, metadata)
 			addOrUpdateMediaRenderer(metadata)
 		}
 
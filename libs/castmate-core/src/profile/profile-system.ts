@@ -2,6 +2,7 @@ import { globalLogger } from "../logging/logging"
 import { PluginManager } from "../plugins/plugin-manager"
 import { ActionQueueManager } from "../queue-system/action-queue"
 import { ignoreReactivity } from "../reactivity/reactivity"
+import { EventList } from "../util/events"
 import { Service } from "../util/service"
 import { Profile } from "./profile"
 
@@ -18,6 +19,8 @@ export const ProfileManager = Service(
 			return this._inactiveProfiles
 		}
 
+		onProfilesChanged = new EventList<(active: readonly Profile[], inactive: readonly Profile[]) => any>()
+
 		private inited: boolean = false
 
 		async finishSetup() {
@@ -77,6 +80,7 @@ export const ProfileManager = Service(
 			this._inactiveProfiles = inactive
 
 			PluginManager.getInstance().onProfilesChanged(this._activeProfiles, this._inactiveProfiles)
+			this.onProfilesChanged.run(this._activeProfiles, this._inactiveProfiles)
 
 			this.activeProfileChange = false
 		}
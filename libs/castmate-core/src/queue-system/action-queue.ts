@@ -23,6 +23,7 @@ import { deserializeSchema, exposeSchema, serializeSchema } from "../util/ipc-sc
 import { PluginManager } from "../plugins/plugin-manager"
 import { usePluginLogger } from "../logging/logging"
 import { TriggerResult } from "./trigger"
+import { clearPreciseTimeout, setPreciseTimeout } from "../util/precise-timers"
 
 const logger = usePluginLogger("queues")
 
@@ -33,7 +34,7 @@ export class ActionQueue extends FileResource<ActionQueueConfig, ActionQueueStat
 	private runner: SequenceRunner | null = null
 	private lastCompletion: number | null = null
 	private scheduledId: string | undefined = undefined
-	private scheduler: NodeJS.Timeout | undefined = undefined
+	private scheduler: number | undefined = undefined
 
 	constructor(config?: ActionQueueConfig) {
 		super()
@@ -114,7 +115,7 @@ export class ActionQueue extends FileResource<ActionQueueConfig, ActionQueueStat
 		if (!this.scheduler) return
 
 		this.scheduledId = undefined
-		clearTimeout(this.scheduler)
+		clearPreciseTimeout(this.scheduler)
 		this.scheduler = undefined
 	}
 
@@ -200,7 +201,7 @@ export class ActionQueue extends FileResource<ActionQueueConfig, ActionQueueStat
 			remaining = Math.max(0, this.gap - diff)
 		}
 
-		this.scheduler = setTimeout(() => {
+		this.scheduler = setPreciseTimeout(() => {
 			this.scheduler = undefined
 			doRun()
 		}, remaining * 1000)
@@ -1,7 +1,7 @@
 import { Resource, ResourceBase, ResourceStorage, ResourceStorageBase } from "./resource"
 import * as fs from "fs/promises"
 import * as path from "path"
-import { ensureDirectory, loadYAML, resolveProjectPath, writeYAML } from "../io/file-system"
+import { ensureDirectory, loadManyYAML, resolveProjectPath, writeYAML } from "../io/file-system"
 import { globalLogger, usePluginLogger } from "../logging/logging"
 import { ConstructedType } from "../util/type-helpers"
 
@@ -98,15 +98,18 @@ export async function loadFileResources<T extends FileIshConstructor>(resourceCo
 	await ensureDirectory(resolvedDir)
 	const files = await fs.readdir(resolvedDir)
 
-	const fileLoadPromises = files.map(async (file) => {
+	//One native load for the whole directory, the files are read and parsed in parallel and unchanged ones come from the parse cache
+	const loaded = await loadManyYAML(files.map((file) => path.join(resolvedDir, file)))
+
+	const fileLoadPromises = files.map(async (file, i) => {
 		const id = path.basename(file, ".yaml")
 
 		logger.log("Loading", resourceConstructor.storage.name, id)
 
-		const fullFile = path.join(resolvedDir, file)
-
 		try {
-			const data = await loadYAML(fullFile)
+			const { data, error } = loaded[i]
+			if (error) throw error
+
 			const resource = new resourceConstructor()
 			//@ts-ignore
 			resource._id = id
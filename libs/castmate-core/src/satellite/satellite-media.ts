@@ -7,6 +7,12 @@ import { defineCallableIPC, defineIPCFunc } from "../util/electron"
 import { usePluginLogger } from "../logging/logging"
 import { SatelliteService } from "./satellite-service"
 import { app } from "electron"
+import { ChunkClient, ChunkServer, ChunkStore, tracer } from "castmate-chunk-store-native"
+import { isCastMate, isSatellite } from "../util/init-mode"
+import { MediaManager } from "../media/media-manager"
+import { ProfileManager } from "../profile/profile-system"
+import { Profile } from "../profile/profile"
+import { registerNativeTracer } from "../util/native-tracing"
 
 function createCacheName(remoteId: string, mediaFile: string) {
 	const ext = path.extname(mediaFile)
@@ -20,8 +26,27 @@ const rendererStartMediaRequest = defineCallableIPC<(mediaFile: string, cacheNam
 	"startMediaRequest"
 )
 
+const rendererSendChunkMessage = defineCallableIPC<(id: string, data: Uint8Array) => any>(
+	"satellite",
+	"sendChunkMessage"
+)
+
 const logger = usePluginLogger("media-cache")
 
+//Profiles change in bursts while they're being edited
+const prefetchDebounce = 2000
+
+//Media paths are stored as absolute paths in action configs, anything else can't be a media file
+function collectMediaCandidates(value: any, candidates: Set<string>) {
+	if (typeof value == "string") {
+		if (path.isAbsolute(value) && path.extname(value)) candidates.add(value)
+	} else if (Array.isArray(value)) {
+		for (const item of value) collectMediaCandidates(item, candidates)
+	} else if (value && typeof value == "object") {
+		for (const item of Object.values(value)) collectMediaCandidates(item, candidates)
+	}
+}
+
 export const SatelliteMedia = Service(
 	class {
 		private pendingRequests = new Map<
@@ -31,6 +56,18 @@ export const SatelliteMedia = Service(
 			}
 		>()
 
+		//Media is synced in content defined chunks, edited files only move the chunks that changed
+		private chunkStore: ChunkStore | undefined
+		private chunkServer: ChunkServer | undefined
+		private chunkClients = new Map<string, ChunkClient>()
+		//Peers that never answered chunk sync, they get the whole file transfer instead
+		private chunkSyncUnsupported = new Set<string>()
+
+		private activeFetches = 0
+		//Cached files being checked against CastMate's copy in the background
+		private revalidating = new Set<string>()
+		private prefetchTimeout: NodeJS.Timeout | undefined = undefined
+
 		constructor() {}
 
 		async initialize() {
@@ -46,19 +83,182 @@ export const SatelliteMedia = Service(
 
 				request.resolver.resolve(cachedFile)
 			})
+
+			try {
+				this.chunkStore = new ChunkStore(resolveProjectPath("chunkCache"))
+				registerNativeTracer("chunk-store", tracer)
+			} catch (err) {
+				logger.error("Unable to open the media chunk cache", err)
+			}
+
+			if (isCastMate() && this.chunkStore) {
+				this.chunkServer = new ChunkServer(this.chunkStore, (mediaFile) =>
+					MediaManager.getInstance().validateRemoteMediaPath(mediaFile)
+				)
+			}
+
+			defineIPCFunc("satellite", "onChunkMessage", (id: string, data: Uint8Array) => {
+				if (this.chunkServer) {
+					this.chunkServer.handleMessage(data, (message) => rendererSendChunkMessage(id, message))
+				} else {
+					this.chunkClients.get(id)?.handleMessage(data)
+				}
+			})
+
+			SatelliteService.getInstance().onDisconnected.register((id) => {
+				this.chunkClients.get(id)?.close("Satellite disconnected")
+				this.chunkClients.delete(id)
+				this.chunkSyncUnsupported.delete(id)
+			})
+
+			if (isSatellite()) {
+				SatelliteService.getInstance().registerRPC("satellite_prefetchMedia", (id: string, mediaFiles: string[]) => {
+					//Answer right away, the prefetch can take a while
+					this.prefetchMedia(mediaFiles)
+					return true
+				})
+			} else {
+				SatelliteService.getInstance().onConnection.register((id) => this.sendPrefetchList(id))
+			}
 		}
 
-		async getMediaFile(mediaFile: string) {
+		/** CastMate only, keeps satellites prefetching whatever the active profiles can play */
+		trackProfileMedia() {
+			ProfileManager.getInstance().onProfilesChanged.register(() => this.schedulePrefetch())
+		}
+
+		private schedulePrefetch() {
+			clearTimeout(this.prefetchTimeout)
+			this.prefetchTimeout = setTimeout(async () => {
+				this.prefetchTimeout = undefined
+				for (const id of SatelliteService.getInstance().getConnectionIds()) {
+					await this.sendPrefetchList(id)
+				}
+			}, prefetchDebounce)
+		}
+
+		private async collectProfileMedia(profiles: readonly Profile[]) {
+			const candidates = new Set<string>()
+			for (const profile of profiles) {
+				collectMediaCandidates(profile.config.triggers, candidates)
+			}
+
+			const media = new Array<string>()
+			for (const candidate of candidates) {
+				if (await MediaManager.getInstance().validateRemoteMediaPath(candidate)) {
+					media.push(candidate)
+				}
+			}
+			return media
+		}
+
+		private async sendPrefetchList(satelliteId: string) {
+			try {
+				const media = await this.collectProfileMedia(ProfileManager.getInstance().activeProfiles)
+				if (media.length == 0) return
+
+				await SatelliteService.getInstance().callSatelliteRPC(satelliteId, "satellite_prefetchMedia", media)
+			} catch (err) {
+				logger.error("Unable to send media prefetch list", err)
+			}
+		}
+
+		private getChunkClient(connectionId: string) {
+			if (!this.chunkStore || this.chunkSyncUnsupported.has(connectionId)) return undefined
+
+			let client = this.chunkClients.get(connectionId)
+			if (!client) {
+				client = new ChunkClient(this.chunkStore, (message) => rendererSendChunkMessage(connectionId, message))
+				this.chunkClients.set(connectionId, client)
+			}
+			return client
+		}
+
+		private getCastMateRemote() {
 			const connectionId = SatelliteService.getInstance().getCastMateConnection()
 			if (!connectionId) throw new Error("Not Connected")
 			const remoteId = SatelliteService.getInstance().getConnection(connectionId)?.remoteId
 			if (!remoteId) throw new Error("Not Connected")
 
+			return { connectionId, remoteId }
+		}
+
+		private async syncMediaFile(connectionId: string, mediaFile: string, cachedFile: string) {
+			const client = this.getChunkClient(connectionId)
+			if (!client) return undefined
+
+			this.activeFetches++
+			try {
+				const result = await client.fetchFile(mediaFile, cachedFile)
+				if (result.fetchedChunks > 0) {
+					logger.log(
+						`Synced ${mediaFile}, fetched ${result.fetchedChunks}/${result.chunks} chunks (${result.fetchedBytes} bytes)`
+					)
+				}
+				return result
+			} catch (err) {
+				if (err instanceof Error && err.message == "Chunk sync timed out") {
+					this.chunkSyncUnsupported.add(connectionId)
+				}
+				logger.error("Chunk sync failed for", mediaFile, err)
+				return undefined
+			} finally {
+				this.activeFetches--
+			}
+		}
+
+		async prefetchMedia(mediaFiles: string[]) {
+			const { connectionId, remoteId } = this.getCastMateRemote()
+
+			const keep = new Set<string>()
+			let keptBytes = 0
+			let fetchedBytes = 0
+
+			for (const mediaFile of mediaFiles) {
+				const cachedFile = path.join(app.getPath("temp"), createCacheName(remoteId, mediaFile))
+				const result = await this.syncMediaFile(connectionId, mediaFile, cachedFile)
+				if (!result) continue
+
+				for (const id of result.ids) keep.add(id)
+				keptBytes += result.size
+				fetchedBytes += result.fetchedBytes
+			}
+
+			logger.log(`Prefetched ${mediaFiles.length} media files, fetched ${fetchedBytes} bytes`)
+
+			//Drop chunks of media no profile uses anymore once they're most of the cache
+			if (this.chunkStore && this.activeFetches == 0 && this.chunkStore.getStats().bytes > keptBytes * 2) {
+				try {
+					await this.chunkStore.compact([...keep])
+				} catch (err) {
+					logger.error("Unable to compact the media chunk cache", err)
+				}
+			}
+		}
+
+		private revalidateMediaFile(connectionId: string, mediaFile: string, cachedFile: string) {
+			if (this.revalidating.has(cachedFile)) return
+			this.revalidating.add(cachedFile)
+
+			//syncMediaFile logs its own failures, the cached copy stays as it was
+			this.syncMediaFile(connectionId, mediaFile, cachedFile).finally(() => this.revalidating.delete(cachedFile))
+		}
+
+		async getMediaFile(mediaFile: string) {
+			const { connectionId, remoteId } = this.getCastMateRemote()
+
 			const cacheName = createCacheName(remoteId, mediaFile)
 
 			const cachedFile = path.join(app.getPath("temp"), cacheName)
 
+			//A cached copy plays right away rather than waiting on a manifest round trip, if the file changed on
+			//CastMate's side the next play gets the new version
 			if (fs.existsSync(cachedFile)) {
+				this.revalidateMediaFile(connectionId, mediaFile, cachedFile)
+				return cachedFile
+			}
+
+			if (await this.syncMediaFile(connectionId, mediaFile, cachedFile)) {
 				return cachedFile
 			} else {
 				logger.log("Media missing from cache, requesting...")
@@ -67,6 +67,10 @@ export const SatelliteService = Service(
 			return this.rtcConnections.get(id)
 		}
 
+		getConnectionIds() {
+			return [...this.rtcConnections.keys()]
+		}
+
 		getCastMateConnection() {
 			if (!isSatellite()) throw new Error("This is for satellite only")
 			const connection = this.rtcConnections.keys().next()
@@ -15,6 +15,7 @@ import { PubSubManager } from "./pubsub/pubsub-service"
 import { SequenceResolvers } from "./queue-system/sequence"
 import { EmoteCache } from "./emotes/emote-service"
 import { GenericLoginService } from "./util/generic-login"
+import { setupNativeTracing } from "./util/native-tracing"
 
 import { app } from "electron"
 import path from "path"
@@ -87,6 +88,7 @@ export async function initializeCastMate() {
 	await ensureDirectory(resolveProjectPath("secrets"))
 	await ensureDirectory(resolveProjectPath("state"))
 	await initializeFileSystem()
+	setupNativeTracing()
 	InfoService.initialize()
 	await InfoService.getInstance().checkInfo()
 	GenericLoginService.initialize()
@@ -97,6 +99,8 @@ export async function initializeCastMate() {
 	PubSubManager.initialize()
 	SatelliteService.initialize()
 	SatelliteResources.initialize()
+	SatelliteMedia.initialize()
+	await SatelliteMedia.getInstance().initialize()
 	SequenceResolvers.initialize()
 	EmoteCache.initialize()
 	setupStreamPlans()
@@ -123,6 +127,7 @@ export async function finializeCastMateSetup() {
 	await ActionQueue.initialize()
 	ActionQueueManager.initialize()
 	ProfileManager.initialize()
+	SatelliteMedia.getInstance().trackProfileMedia()
 	await ProfileManager.getInstance().finishSetup()
 	await EmoteCache.getInstance().initialize()
 	globalLogger.log("CastMate Init Complete")
@@ -139,6 +144,7 @@ export async function initializeCastMateSatellite() {
 	await ensureDirectory(resolveProjectPath("secrets"))
 	await ensureDirectory(resolveProjectPath("state"))
 	await initializeFileSystem()
+	setupNativeTracing()
 	//InfoService.initialize()
 	//await InfoService.getInstance().checkInfo()
 	GenericLoginService.initialize()
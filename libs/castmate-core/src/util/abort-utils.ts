@@ -1,8 +1,10 @@
+import { clearPreciseTimeout, setPreciseTimeout } from "./precise-timers"
+
 //https://www.bennadel.com/blog/4195-using-abortcontroller-to-debounce-settimeout-calls-in-javascript.htm
 export function setAbortableTimeout(callback: () => void, ms: number, signal: AbortSignal, aborted?: () => void) {
 	signal?.addEventListener("abort", handleAbort, { once: true })
 
-	const timeout = setTimeout(internalCallback, ms)
+	const timeout = setPreciseTimeout(internalCallback, ms)
 
 	function internalCallback() {
 		signal?.removeEventListener("abort", handleAbort)
@@ -10,7 +12,7 @@ export function setAbortableTimeout(callback: () => void, ms: number, signal: Ab
 	}
 
 	function handleAbort() {
-		clearTimeout(timeout)
+		clearPreciseTimeout(timeout)
 		aborted?.()
 	}
 }
@@ -0,0 +1,70 @@
+import * as fs from "fs/promises"
+import * as path from "path"
+import { shell } from "electron"
+import { ensureDirectory, resolveProjectPath } from "../io/file-system"
+import { defineIPCFunc } from "./electron"
+
+//Every addon linking castmate-native-core exports these, and each keeps its own trace buffers.
+export interface NativeTracer {
+	setTracingEnabled(enabled: boolean): void
+	dumpTrace(): string
+	clearTrace(): void
+}
+
+const tracers = new Map<string, NativeTracer>()
+let tracingEnabled = false
+
+export function registerNativeTracer(name: string, tracer: NativeTracer) {
+	tracers.set(name, tracer)
+	tracer.setTracingEnabled(tracingEnabled)
+}
+
+export function setNativeTracingEnabled(enabled: boolean) {
+	tracingEnabled = enabled
+	for (const tracer of tracers.values()) {
+		tracer.setTracingEnabled(enabled)
+	}
+}
+
+/**
+ * Merges every addon's buffers into one Chrome trace event file, open it in Perfetto next to an Electron trace.
+ * @returns the path written to
+ */
+export async function dumpNativeTrace(file?: string) {
+	const traceEvents: object[] = []
+	for (const tracer of tracers.values()) {
+		const dump = JSON.parse(tracer.dumpTrace())
+		traceEvents.push(...dump.traceEvents)
+	}
+
+	file ??= resolveProjectPath("traces", `native-${Date.now()}.json`)
+	await ensureDirectory(path.dirname(file))
+	await fs.writeFile(file, JSON.stringify({ traceEvents, displayTimeUnit: "ns" }), "utf-8")
+	return file
+}
+
+export function clearNativeTrace() {
+	for (const tracer of tracers.values()) {
+		tracer.clearTrace()
+	}
+}
+
+export function setupNativeTracing() {
+	defineIPCFunc("nativeTracing", "isEnabled", () => {
+		return tracingEnabled
+	})
+
+	//Starting drops whatever an earlier session left in the buffers so the dump only covers what was asked for
+	defineIPCFunc("nativeTracing", "start", () => {
+		clearNativeTrace()
+		setNativeTracingEnabled(true)
+	})
+
+	defineIPCFunc("nativeTracing", "stop", async () => {
+		setNativeTracingEnabled(false)
+		const file = await dumpNativeTrace()
+		clearNativeTrace()
+		shell.showItemInFolder(file)
+		return file
+	})
+}
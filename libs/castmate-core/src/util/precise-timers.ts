@@ -0,0 +1,27 @@
+import { Scheduler, tracer } from "castmate-scheduler-native"
+import { registerNativeTracer } from "./native-tracing"
+
+//Node's timers are coarse and get pushed back by a busy event loop, sequence offsets and queue gaps
+//go through the native timer wheel instead so they fire within a millisecond of when they're due.
+let scheduler: Scheduler | undefined = undefined
+
+function getScheduler() {
+	if (!scheduler) {
+		scheduler = new Scheduler()
+		registerNativeTracer("scheduler", tracer)
+	}
+	return scheduler
+}
+
+export function setPreciseTimeout(callback: (latenessMs: number) => any, ms: number) {
+	return getScheduler().setTimeout(callback, ms)
+}
+
+export function clearPreciseTimeout(handle: number | undefined) {
+	if (handle == null) return false
+	return getScheduler().clearTimeout(handle)
+}
+
+export function getPreciseTimerStats() {
+	return getScheduler().getStats()
+}
@@ -10,13 +10,14 @@ import {
 	getTypeByName,
 } from "castmate-schema"
 import { Service } from "../util/service"
-import sqlite from "better-sqlite3"
+import { ViewerDataStore, tracer } from "castmate-viewer-data-native"
 import { ensureDirectory, ensureYAML, loadYAML, resolveProjectPath, writeYAML } from "../io/file-system"
 import { deserializeSchema, exposeSchema, ipcConvertSchema, ipcParseSchema, serializeSchema } from "../util/ipc-schema"
 import { usePluginLogger } from "../logging/logging"
 import { ViewerVariable } from "castmate-schema"
 import { defineCallableIPC, defineIPCFunc } from "../util/electron"
 import { startPerfTime } from "../util/time-utils"
+import { registerNativeTracer } from "../util/native-tracing"
 
 interface SerializedViewerVariableDesc {
 	name: string
@@ -36,19 +37,14 @@ const sqlTypes: Record<string, string> = {
 	LightColor: "TEXT",
 }
 
-function escapeSql(sql: string) {
-	return sql.replace(/\'/g, "''")
-}
-
-function sqlize(value: any) {
-	if (typeof value == "number") {
-		return String(value)
-	} else if (typeof value == "string") {
-		return `'${escapeSql(value)}'`
+//Same values the old SQL literals produced, objects are stored as JSON text
+function storable(value: any) {
+	if (typeof value == "number" || typeof value == "string") {
+		return value
 	} else if (value == null) {
-		return "NULL"
+		return null
 	} else {
-		return `'${escapeSql(JSON.stringify(value))}'`
+		return JSON.stringify(value)
 	}
 }
 
@@ -59,133 +55,6 @@ export interface ViewerProvider {
 	onColumnRemoved(column: string): any
 }
 
-function createAddColumnStatement(db: sqlite.Database) {
-	return function (args: { columnName: string; columnType: string; columnDefault: any }) {
-		db.exec(`ALTER TABLE ViewerData ADD COLUMN ${args.columnName} ${args.columnType} default ${args.columnDefault}`)
-	}
-	/*
-	return db.prepare<{
-		columnName: string
-		columnType: string
-		columnDefault: any
-	}>("ALTER TABLE ViewerData ADD COLUMN @columnName @columnType default @columnDefault")
-*/
-}
-type AddColumnStatement = ReturnType<typeof createAddColumnStatement>
-
-function createCreateTableStatement(db: sqlite.Database) {
-	return db.prepare<[]>("CREATE TABLE IF NOT EXISTS ViewerData (twitch TEXT UNIQUE, twitch_name TEXT)")
-}
-type CreateTableStatement = ReturnType<typeof createCreateTableStatement>
-
-function createRemoveColumnStatement(db: sqlite.Database) {
-	return function (args: { columnName: string }) {
-		logger.log("Running", `ALTER TABLE ViewerData DROP COLUMN ${args.columnName}`)
-		db.exec(`ALTER TABLE ViewerData DROP COLUMN ${args.columnName}`)
-	}
-
-	//return db.prepare<{ columnName: string }>("ALTER TABLE ViewerData DROP COLUMN :columnName")
-}
-type RemoveTableStatement = ReturnType<typeof createRemoveColumnStatement>
-
-function createPagedQueryStatement(db: sqlite.Database) {
-	return db.prepare<{ start: number; quantity: number }>("SELECT * FROM ViewerData LIMIT :quantity OFFSET :start")
-}
-type PagedQueryStatement = ReturnType<typeof createPagedQueryStatement>
-
-function createPagedQueryOrderedStatement(db: sqlite.Database) {
-	return function (args: { start: number; quantity: number; orderBy: string; order: string }) {
-		const statement = db.prepare(
-			`SELECT * FROM ViewerData ORDER BY ${args.orderBy} ${args.order} LIMIT ${args.quantity} OFFSET ${args.start}`
-		)
-		return statement.all()
-	}
-}
-type PagedQueryOrderedStatement = ReturnType<typeof createPagedQueryOrderedStatement>
-
-function createUpdateColumnValue(db: sqlite.Database) {
-	return function (args: { provider: string; id: string; columnName: string; columnValue: any }) {
-		const query = `UPDATE ViewerData SET ${args.columnName}=${args.columnValue} WHERE ${args.provider}='${args.id}'`
-
-		logger.log("Updating w/", query)
-
-		db.exec(query)
-	}
-}
-type UpdateColumnValue = ReturnType<typeof createUpdateColumnValue>
-
-function createOffsetColumnValue(db: sqlite.Database) {
-	return function (args: { provider: string; id: string; columnName: string; columnOffset: number }) {
-		const query = `UPDATE ViewerData SET ${args.columnName}=coalesce(${args.columnName}, 0)+(${args.columnOffset}) WHERE ${args.provider}='${args.id}'`
-
-		logger.log("Updating w/", query)
-
-		db.exec(query)
-	}
-}
-type OffsetColumnValue = ReturnType<typeof createOffsetColumnValue>
-
-function createInsertWithColumnValue(db: sqlite.Database) {
-	return function (args: {
-		provider: string
-		columnName: string
-		id: string
-		displayName: string
-		columnValue: any
-	}) {
-		const query = `INSERT INTO ViewerData (${args.provider}, ${args.provider}_name, ${args.columnName}) VALUES('${
-			args.id
-		}', '${escapeSql(args.displayName)}', ${args.columnValue})`
-
-		logger.log("Insert w/", query)
-
-		db.exec(query)
-	}
-}
-type InsertColumnValue = ReturnType<typeof createInsertWithColumnValue>
-
-function createGetAllValuesStatement(db: sqlite.Database) {
-	return function (args: { provider: string; ids: string | string[] }) {
-		if (Array.isArray(args.ids)) {
-			const query = `SELECT * FROM ViewerData WHERE ${args.provider} IN (${args.ids
-				.map((id) => `'${escapeSql(id)}'`)
-				.join(",")})`
-
-			const statement = db.prepare<unknown[], Record<string, any>>(query)
-
-			return statement.get()
-		} else {
-			const query = `SELECT * FROM ViewerData WHERE ${args.provider}='${escapeSql(args.ids)}'`
-			const statement = db.prepare<unknown[], Record<string, any>>(query)
-
-			return statement.get()
-		}
-	}
-}
-
-type GetAllValuesStatement = ReturnType<typeof createGetAllValuesStatement>
-
-function createGetColumnValueStatement(db: sqlite.Database) {
-	return function (args: { provider: string; id: string; columnName: string }) {
-		const query = `SELECT ${args.columnName} FROM ViewerData WHERE ${args.provider}='${args.id}'`
-
-		logger.log("Getting Column Value w/", query)
-
-		const statement = db.prepare<unknown[], Record<string, any>>(query)
-
-		return statement.get()
-	}
-}
-
-type GetColumnValueStatement = ReturnType<typeof createGetColumnValueStatement>
-
-function createQueryNumViewers(db: sqlite.Database) {
-	//TODO: "IS THIS FAST?"
-	return db.prepare<[], { "COUNT(*)": number }>("SELECT COUNT(*) FROM ViewerData")
-}
-
-type QueryNumViewersStatement = ReturnType<typeof createQueryNumViewers>
-
 const rendererViewerDataChanged = defineCallableIPC<
 	(provider: string, id: string, varName: string, value: any) => void
 >("viewer-data", "viewerDataChanged")
@@ -200,20 +69,8 @@ const rendererColumnRemoved = defineCallableIPC<(name: string) => void>("viewer-
 
 export const ViewerData = Service(
 	class {
-		private db: sqlite.Database
-
-		private addColumnStatement: AddColumnStatement
-		private createTableStatement: CreateTableStatement
-		private removeTableStatement: RemoveTableStatement
-		private getAllValuesStatement: GetAllValuesStatement
-		private pagedQueryStatement: PagedQueryStatement
-		private pagedQueryOrderedStatement: PagedQueryOrderedStatement
-		private queryNumViewerStatement: QueryNumViewersStatement
-
-		private getValue: GetColumnValueStatement
-		private updateValue: UpdateColumnValue
-		private offsetValue: OffsetColumnValue
-		private insertValue: InsertColumnValue
+		//In memory copy of the table, writes are coalesced and flushed to SQLite in batches on a background thread
+		private store: ViewerDataStore
 
 		private _variables: ViewerVariable[] = []
 
@@ -231,7 +88,9 @@ export const ViewerData = Service(
 			await ensureDirectory(resolveProjectPath("viewer-data"))
 			const path = resolveProjectPath("viewer-data", "db.sqlite3")
 			logger.log("Creating ViewerData DB", path)
-			this.db = sqlite(path)
+			this.store = new ViewerDataStore((message) => logger.error("Viewer Data Write Failed", message))
+			registerNativeTracer("viewer-data", tracer)
+			this.store.open(path)
 		}
 
 		private async ensureColumn(variable: ViewerVariable) {
@@ -244,11 +103,7 @@ export const ViewerData = Service(
 				const defaultValue = await constructDefault(variable.schema)
 				const serializedDefault = await serializeSchema(variable.schema, defaultValue)
 
-				this.addColumnStatement({
-					columnName: variable.name,
-					columnType: sqlType,
-					columnDefault: serializedDefault,
-				})
+				this.store.addColumn(variable.name, sqlType, storable(serializedDefault))
 			} catch {}
 		}
 
@@ -320,21 +175,6 @@ export const ViewerData = Service(
 
 			await this.createDb()
 
-			this.createTableStatement = createCreateTableStatement(this.db)
-			await this.createTableStatement.run()
-
-			this.addColumnStatement = createAddColumnStatement(this.db)
-			this.removeTableStatement = createRemoveColumnStatement(this.db)
-			this.getAllValuesStatement = createGetAllValuesStatement(this.db)
-			this.pagedQueryStatement = createPagedQueryStatement(this.db)
-			this.pagedQueryOrderedStatement = createPagedQueryOrderedStatement(this.db)
-			this.queryNumViewerStatement = createQueryNumViewers(this.db)
-
-			this.getValue = createGetColumnValueStatement(this.db)
-			this.insertValue = createInsertWithColumnValue(this.db)
-			this.updateValue = createUpdateColumnValue(this.db)
-			this.offsetValue = createOffsetColumnValue(this.db)
-
 			await this.loadVariables()
 
 			defineIPCFunc("viewer-data", "getVariables", () => {
@@ -352,8 +192,7 @@ export const ViewerData = Service(
 					if (!vari) return
 
 					const serialized = await serializeSchema(vari.schema, value)
-					const sqlized = sqlize(serialized)
-					await this.updateViewerValue(provider, id, varname, value, sqlized)
+					await this.updateViewerValue(provider, id, varname, value, storable(serialized))
 				}
 			)
 
@@ -387,7 +226,7 @@ export const ViewerData = Service(
 		}
 
 		async shutdown() {
-			this.db.close()
+			this.store.close()
 		}
 
 		async addViewerVariable(name: string, schema: Schema) {
@@ -426,7 +265,7 @@ export const ViewerData = Service(
 			const idx = this.variables.findIndex((v) => v.name == name)
 			if (idx < 0) return
 
-			await this.removeTableStatement({ columnName: name })
+			this.store.removeColumn(name)
 
 			this.variables.splice(idx, 1)
 
@@ -444,14 +283,12 @@ export const ViewerData = Service(
 			}
 		}
 
-		private async updateViewerValue(provider: string, id: string, varname: string, value: any, sqlized: any) {
+		private async updateViewerValue(provider: string, id: string, varname: string, value: any, stored: any) {
 			try {
-				this.updateValue({
-					provider,
-					id,
-					columnName: varname,
-					columnValue: sqlized,
-				})
+				//Only existing viewers can be edited from the UI
+				if (!this.store.has(provider, id)) return
+
+				this.store.set(provider, id, "", varname, stored)
 
 				try {
 					await this.providers.get(provider)?.onDataChanged(id, varname, value)
@@ -473,16 +310,14 @@ export const ViewerData = Service(
 			if (!vari) return
 
 			const serialized = await serializeSchema(vari.schema, value)
-			const sqlized = sqlize(serialized)
+			const stored = storable(serialized)
+
+			if (this.store.has(provider, id)) {
+				return await this.updateViewerValue(provider, id, varname, value, stored)
+			}
 
 			try {
-				this.insertValue({
-					provider,
-					columnName: varname,
-					columnValue: sqlized,
-					id,
-					displayName,
-				})
+				this.store.set(provider, id, displayName, varname, stored)
 
 				try {
 					await this.providers.get(provider)?.onDataChanged(id, varname, value)
@@ -499,7 +334,7 @@ export const ViewerData = Service(
 					o.onNewViewerData(provider, id, defaultValue)
 				}
 			} catch (err) {
-				this.updateViewerValue(provider, id, varname, value, sqlized)
+				logger.error("Error Adding Viewer Data", id, varname, value, err)
 			}
 		}
 
@@ -517,63 +352,34 @@ export const ViewerData = Service(
 			}
 
 			try {
-				const defaultNumber = await constructDefault(vari.schema)
-				const offsetDefault = (defaultNumber ?? 0) + offset
-
-				this.insertValue({
-					provider,
-					columnName: varname,
-					columnValue: offsetDefault,
-					id,
-					displayName,
-				})
+				const inserted = !this.store.has(provider, id)
+				const value = this.store.offset(provider, id, displayName, varname, offset)
 
 				try {
-					await this.providers.get(provider)?.onDataChanged(id, varname, offsetDefault)
+					await this.providers.get(provider)?.onDataChanged(id, varname, value)
 				} catch (err) {
-					logger.error("Error Updating Provider Data", id, varname, offsetDefault, err)
-				}
-
-				const defaultValue = await this.getDefaultViewerData()
-
-				defaultValue[varname] = offsetDefault
-
-				rendererViewerDataAdded(provider, id, defaultValue)
-
-				for (const o of this.observers) {
-					o.onNewViewerData(provider, id, defaultValue as ViewerDataRow)
+					logger.error("Error Updating Provider Data", id, varname, value, err)
 				}
-			} catch (err) {
-				try {
-					const value = this.db.transaction<() => number | undefined>(() => {
-						this.offsetValue({
-							provider,
-							id,
-							columnName: varname,
-							columnOffset: offset,
-						})
 
-						const row = this.getValue({ provider, id, columnName: varname })
+				if (inserted) {
+					const defaultValue = await this.getDefaultViewerData()
 
-						return row?.[varname]
-					})()
+					defaultValue[varname] = value
 
-					logger.log("Offset Value", value)
+					rendererViewerDataAdded(provider, id, defaultValue)
 
-					try {
-						await this.providers.get(provider)?.onDataChanged(id, varname, value)
-					} catch (err) {
-						logger.error("Error Updating Provider Data", id, varname, value, err)
+					for (const o of this.observers) {
+						o.onNewViewerData(provider, id, defaultValue as ViewerDataRow)
 					}
-
+				} else {
 					rendererViewerDataChanged(provider, id, varname, value)
 
 					for (const o of this.observers) {
 						o.onViewerDataChanged(provider, id, varname, value)
 					}
-				} catch (err) {
-					logger.error("Error Offseting Viewer Data", id, varname, offset, err)
 				}
+			} catch (err) {
+				logger.error("Error Offseting Viewer Data", id, varname, offset, err)
 			}
 		}
 
@@ -591,7 +397,7 @@ export const ViewerData = Service(
 
 		async getViewerData(provider: string, id: string) {
 			try {
-				const data = await this.getAllValuesStatement({ provider, ids: id })
+				const data = this.store.get(provider, id)
 
 				if (!data) return undefined
 
@@ -610,59 +416,27 @@ export const ViewerData = Service(
 		}
 
 		async getMultipleViewerData(provider: string, ids: string[]) {
-			return await Promise.all(ids.map((id) => this.getViewerData(provider, id)))
-			//Turns out SQLITE doesn't handle array substitutions??
-			// try {
-			// 	const data = await this.getAllValuesStatement.all({ provider, ids })
-
-			// 	const result: (Record<string, any> | undefined)[] = []
-
-			// 	await Promise.allSettled(
-			// 		data.map(async (row) => {
-			// 			const idx = ids.findIndex((id) => id == row[provider])
-			// 			if (idx < 0) return
-
-			// 			const viewerData: Record<string, any> = {}
-			// 			for (const vari of this.variables) {
-			// 				const schemaType = getTypeByConstructor(vari.schema.type)
-			// 				if (!schemaType) continue
-
-			// 				const sqlized = row[vari.name]
-			// 				let desqlized: any
-
-			// 				if (typeof sqlized == "number") {
-			// 					if (vari.schema.type == Boolean) {
-			// 						desqlized = sqlized != 0
-			// 					} else {
-			// 						desqlized = sqlized
-			// 					}
-			// 				} else if (typeof sqlized == "string") {
-			// 					const sqlType = sqlTypes[schemaType.name]
-			// 					if (sqlType == "TEXT") {
-			// 						desqlized = sqlized
-			// 					} else {
-			// 						desqlized = JSON.parse(sqlized)
-			// 					}
-			// 				}
-
-			// 				const deserialized = await deserializeSchema(vari.schema, desqlized)
-			// 				const exposed = await exposeSchema(vari.schema, deserialized)
-			// 				viewerData[vari.name] = exposed
-			// 			}
-
-			// 			result[idx] = viewerData
-			// 		})
-			// 	)
-
-			// 	return result
-			// } catch (err) {
-			// 	logger.error(err, ids)
-			// 	return []
-			// }
+			const rows = this.store.getMany(provider, ids)
+
+			return await Promise.all(
+				rows.map(async (data) => {
+					if (!data) return undefined
+
+					const result: Record<string, any> = {}
+
+					for (const vari of this.variables) {
+						const deserialized = await deserializeSchema(vari.schema, data[vari.name])
+						const exposed = await exposeSchema(vari.schema, deserialized)
+						result[vari.name] = exposed
+					}
+
+					return result
+				})
+			)
 		}
 
 		async getNumRows() {
-			return this.queryNumViewerStatement.get()?.["COUNT(*)"] ?? 0
+			return this.store.count()
 		}
 
 		async getPagedViewerData(
@@ -671,21 +445,7 @@ export const ViewerData = Service(
 			sortBy: string | undefined,
 			sortOrder: number | undefined
 		) {
-			if (!sortBy) {
-				const result = this.pagedQueryStatement.all({
-					start,
-					quantity: end - start,
-				}) as Record<string, any>[]
-				return result
-			} else {
-				const result = this.pagedQueryOrderedStatement({
-					start,
-					quantity: end - start,
-					orderBy: sortBy,
-					order: sortOrder == null || sortOrder >= 0 ? "ASC" : "DESC",
-				}) as Record<string, any>[]
-				return result
-			}
+			return this.store.page(start, end, sortBy, sortOrder != null && sortOrder < 0)
 		}
 
 		observeViewerData(observer: ViewerDataObserver) {
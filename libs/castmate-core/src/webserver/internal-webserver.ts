@@ -8,7 +8,8 @@ import { EventList } from "../util/events"
 import { onLoad, onUnload } from "../plugins/plugin"
 import { initingPlugin } from "../plugins/plugin-init"
 import { RPCHandler, RPCMessage } from "castmate-ws-rpc"
-import { filterPromiseAll } from "castmate-schema"
+import { BroadcastEncoder, tracer } from "castmate-broadcast-native"
+import { registerNativeTracer } from "../util/native-tracing"
 import HttpProxy from "http-proxy"
 import os from "os"
 import cors from "cors"
@@ -50,6 +51,10 @@ export const WebService = Service(
 		private pingInterval: NodeJS.Timeout
 		private rpcs: RPCHandler = new RPCHandler()
 
+		//Everything sent to a client goes through here so it keeps its order. Clients that connect with ?frames=1
+		//get their messages batched into binary frames, see decodeBroadcastFrame in castmate-ws-rpc.
+		private broadcaster = new BroadcastEncoder({ flushMs: 4, compressThreshold: 16 * 1024 })
+
 		/**
 		 * Proxies to run in websocket upgrades
 		 */
@@ -69,6 +74,8 @@ export const WebService = Service(
 
 			this.app.use("/plugins/", this.routes)
 
+			registerNativeTracer("broadcast", tracer)
+
 			this.httpServer = http.createServer(this.app)
 			this.websocketServer = new WebSocketServer({ noServer: true }) as ExtendedServer
 
@@ -96,14 +103,14 @@ export const WebService = Service(
 					): Promise<ReturnType<T>> => {
 						return (await WebService.getInstance().rpcs.call(
 							name,
-							async (message) => {
-								await expandedSocket.send(JSON.stringify(message))
-							},
+							(message) => this.broadcaster.send(expandedSocket, message),
 							...args
 						)) as any
 					},
 				} satisfies WebSocketExtras)
 
+				this.broadcaster.addClient(expandedSocket, requestUrl.searchParams.get("frames") == "1")
+
 				expandedSocket.on("message", (rawData, isBinary) => {
 					const dataString = rawData.toString()
 
@@ -116,7 +123,7 @@ export const WebService = Service(
 
 					this.rpcs.handleMessage(
 						data as RPCMessage,
-						(msg) => expandedSocket.send(JSON.stringify(msg)),
+						(msg) => this.broadcaster.send(expandedSocket, msg),
 						expandedSocket
 					)
 
@@ -128,6 +135,7 @@ export const WebService = Service(
 				})
 
 				expandedSocket.on("close", async () => {
+					this.broadcaster.removeClient(expandedSocket)
 					this.onDisconnected.run(expandedSocket)
 				})
 
@@ -211,25 +219,39 @@ export const WebService = Service(
 			this.httpServer?.listen(newPort)
 		}
 
+		/**
+		 * Sends message to every connected client, serialized once for all of them
+		 */
 		broadcastWebsocketMessage(message: any) {
 			if (!this.websocketServer) return
 
-			for (const client of this.websocketServer.clients) {
-				client.send(message)
-			}
+			this.broadcaster.broadcast(this.websocketServer.clients, message)
 		}
 
-		async broadcastWebsocketRPC<T extends (...args: any[]) => any>(
+		/**
+		 * Calls an RPC on several clients with one request, serialized once and sent to each as the same bytes.
+		 * @returns the results from the clients that succeeded
+		 */
+		async callWebsocketRPC<T extends (...args: any[]) => any>(
+			sockets: ExtendedWebsocket[],
 			name: string,
 			...args: Parameters<T>
 		): Promise<ReturnType<T>[]> {
-			return (await filterPromiseAll(
-				this.websocketServer.clients.map((client) =>
-					this.rpcs.call(name, (data) => client.send(JSON.stringify(data)), ...args)
-				)
+			return (await this.rpcs.callMany(
+				name,
+				sockets.length,
+				(message) => this.broadcaster.broadcast(sockets, message),
+				...args
 			)) as ReturnType<T>[]
 		}
 
+		async broadcastWebsocketRPC<T extends (...args: any[]) => any>(
+			name: string,
+			...args: Parameters<T>
+		): Promise<ReturnType<T>[]> {
+			return await this.callWebsocketRPC<T>([...this.websocketServer.clients], name, ...args)
+		}
+
 		registerRPC<T extends (socket: ExtendedWebsocket, ...args: any[]) => any>(name: string, func: T) {
 			this.rpcs.handle(name, func)
 		}
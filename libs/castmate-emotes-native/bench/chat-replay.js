@@ -0,0 +1,192 @@
+// Emote tokenizer benchmark
+// Replays a chat log through the native matcher and through the `\bname\b` alternation regex it replaced,
+// and times rebuilding after an emote set changes.
+//
+// Build first with `yarn rebuild`, then run `yarn bench` (add --json for machine readable output)
+// Options: --log=chat.txt (one message per line) --emotes=sets.json (array of { provider, id, emotes })
+//          --batch=64 --iterations=5
+// Without a log or emote file a synthetic chat with a few thousand third party emotes is generated.
+
+const fs = require("fs")
+const { EmoteMatcher } = require("../src/index.js")
+
+function parseArgs() {
+	const options = {
+		log: undefined,
+		emotes: undefined,
+		batch: 64,
+		iterations: 5,
+		json: false,
+	}
+
+	for (const arg of process.argv.slice(2)) {
+		const [key, value] = arg.replace(/^--/, "").split("=")
+		if (key == "log") options.log = value
+		else if (key == "emotes") options.emotes = value
+		else if (key == "batch") options.batch = Number(value)
+		else if (key == "iterations") options.iterations = Number(value)
+		else if (key == "json") options.json = true
+	}
+
+	return options
+}
+
+//Deterministic so runs are comparable
+function makeRandom(seed) {
+	return () => {
+		seed = (seed * 1664525 + 1013904223) >>> 0
+		return seed / 0x100000000
+	}
+}
+
+function syntheticSets(random) {
+	const syllables = ["pog", "kek", "lul", "cat", "jam", "pepe", "monka", "hype", "sad", "omega", "w", "ez", "clap", "dance"]
+	const sets = []
+	for (let s = 0; s < 8; ++s) {
+		const emotes = {}
+		for (let e = 0; e < 500; ++e) {
+			let name = ""
+			const parts = 1 + Math.floor(random() * 3)
+			for (let p = 0; p < parts; ++p) {
+				const syllable = syllables[Math.floor(random() * syllables.length)]
+				name += random() < 0.5 ? syllable : syllable.toUpperCase()
+			}
+			name += e.toString(36)
+			emotes[name] = { id: `${s}-${e}` }
+		}
+		sets.push({ provider: s == 0 ? "twitch" : "7tv", id: `set${s}`, emotes })
+	}
+	return sets
+}
+
+function syntheticChat(random, names) {
+	const words = ["hello", "the", "stream", "is", "so", "good", "today", "what", "a", "play", "gg", "lol", "no", "way"]
+	const messages = []
+	for (let m = 0; m < 100000; ++m) {
+		const parts = []
+		const length = 1 + Math.floor(random() * 15)
+		for (let w = 0; w < length; ++w) {
+			parts.push(random() < 0.3 ? names[Math.floor(random() * names.length)] : words[Math.floor(random() * words.length)])
+		}
+		messages.push(parts.join(" "))
+	}
+	return messages
+}
+
+function escapeRegExp(string) {
+	return string.replace(/[.*+?^${}()|[\]\\]/g, "\\$&")
+}
+
+function buildRegex(sets) {
+	const names = sets.flatMap((s) => Object.keys(s.emotes))
+	names.sort((a, b) => b.length - a.length)
+	return new RegExp(names.map((n) => `\\b${escapeRegExp(n)}\\b`).join("|"), "g")
+}
+
+function runRegex(regex, messages) {
+	let count = 0
+	for (const message of messages) {
+		regex.lastIndex = 0
+		while (regex.exec(message) !== null) ++count
+	}
+	return count
+}
+
+function runNative(matcher, messages) {
+	let count = 0
+	for (const message of messages) {
+		count += matcher.parse(message).length / 2
+	}
+	return count
+}
+
+function runNativeBatched(matcher, messages, batchSize) {
+	let count = 0
+	for (let i = 0; i < messages.length; i += batchSize) {
+		const result = matcher.parseBatch(messages.slice(i, i + batchSize))
+		let offset = 0
+		while (offset < result.length) {
+			const matches = result[offset]
+			count += matches
+			offset += 1 + matches * 2
+		}
+	}
+	return count
+}
+
+function time(iterations, fn) {
+	let best = Infinity
+	let result
+	for (let i = 0; i < iterations; ++i) {
+		const start = process.hrtime.bigint()
+		result = fn()
+		const elapsed = Number(process.hrtime.bigint() - start) / 1e6
+		best = Math.min(best, elapsed)
+	}
+	return { ms: best, result }
+}
+
+function main() {
+	const options = parseArgs()
+	const random = makeRandom(1234)
+
+	const sets = options.emotes ? JSON.parse(fs.readFileSync(options.emotes, "utf-8")) : syntheticSets(random)
+	const names = sets.flatMap((s) => Object.keys(s.emotes))
+	const messages = options.log
+		? fs.readFileSync(options.log, "utf-8").split(/\r?\n/).filter((l) => l.length > 0)
+		: syntheticChat(random, names)
+
+	const matcher = new EmoteMatcher()
+	for (const set of sets) {
+		matcher.addSet(`${set.provider}.${set.id}`, Object.keys(set.emotes))
+	}
+
+	const regex = buildRegex(sets)
+
+	const regexRun = time(options.iterations, () => runRegex(regex, messages))
+	const nativeRun = time(options.iterations, () => runNative(matcher, messages))
+	const batchedRun = time(options.iterations, () => runNativeBatched(matcher, messages, options.batch))
+
+	//Cost of one set changing, the old path regenerated and recompiled the whole expression
+	const changed = sets[sets.length - 1]
+	const regexRebuild = time(options.iterations, () => {
+		const rebuilt = buildRegex(sets)
+		rebuilt.exec(messages[0])
+		return rebuilt
+	})
+	const nativeRebuild = time(options.iterations, () => {
+		matcher.addSet(`${changed.provider}.${changed.id}`, Object.keys(changed.emotes))
+		matcher.parse(messages[0])
+	})
+
+	const results = {
+		messages: messages.length,
+		emotes: names.length,
+		regex: { ms: regexRun.ms, matches: regexRun.result },
+		native: { ms: nativeRun.ms, matches: nativeRun.result },
+		nativeBatched: { ms: batchedRun.ms, matches: batchedRun.result },
+		regexSetUpdate: { ms: regexRebuild.ms },
+		nativeSetUpdate: { ms: nativeRebuild.ms },
+	}
+
+	if (options.json) {
+		console.log(JSON.stringify({ options, results }, null, "\t"))
+		return
+	}
+
+	const rate = (ms) => `${((messages.length / ms) * 1000).toFixed(0)} msgs/s`.padStart(16)
+	console.log(`${messages.length} messages, ${names.length} emotes`)
+	console.log(`  regex          ${results.regex.ms.toFixed(1).padStart(9)}ms ${rate(results.regex.ms)}  ${results.regex.matches} matches`)
+	console.log(`  native         ${results.native.ms.toFixed(1).padStart(9)}ms ${rate(results.native.ms)}  ${results.native.matches} matches`)
+	console.log(
+		`  native batched ${results.nativeBatched.ms.toFixed(1).padStart(9)}ms ${rate(results.nativeBatched.ms)}  ${results.nativeBatched.matches} matches`
+	)
+	console.log(`  set update     regex ${results.regexSetUpdate.ms.toFixed(2)}ms, native ${results.nativeSetUpdate.ms.toFixed(2)}ms`)
+
+	if (results.regex.matches != results.native.matches || results.native.matches != results.nativeBatched.matches) {
+		console.log("  MISMATCH between regex and native results")
+		process.exitCode = 1
+	}
+}
+
+main()
@@ -0,0 +1,231 @@
+#include "emote-automaton.hh"
+
+#include <algorithm>
+#include <deque>
+
+static const uint32_t root_node = 0;
+
+//Rebuild the trie from scratch once this many removed names are still taking up nodes.
+static const size_t compact_threshold = 4096;
+
+//Same definition of a word character as `\b` in a non unicode JS regex.
+static inline bool is_word_char(char16_t c)
+{
+    return (c >= u'a' && c <= u'z') || (c >= u'A' && c <= u'Z') || (c >= u'0' && c <= u'9') || c == u'_';
+}
+
+static inline bool is_word_boundary(const std::u16string& message, size_t index)
+{
+    const bool before = index > 0 && is_word_char(message[index - 1]);
+    const bool after = index < message.size() && is_word_char(message[index]);
+    return before != after;
+}
+
+emote_automaton::emote_automaton()
+{
+    clear();
+}
+
+void emote_automaton::clear()
+{
+    nodes.clear();
+    nodes.emplace_back();
+    children.clear();
+    children.emplace_back();
+    edges.clear();
+
+    set_names.clear();
+    set_terminals.clear();
+
+    pattern_count = 0;
+    dead_patterns = 0;
+    links_dirty = false;
+}
+
+uint32_t emote_automaton::child(uint32_t parent, char16_t c) const
+{
+    auto edge = edges.find(edge_key(parent, c));
+    return edge == edges.end() ? root_node : edge->second;
+}
+
+uint32_t emote_automaton::insert(const std::u16string& name)
+{
+    uint32_t current = root_node;
+    for (char16_t c : name)
+    {
+        uint32_t next = child(current, c);
+        if (next == root_node)
+        {
+            next = uint32_t(nodes.size());
+            nodes.emplace_back();
+            nodes.back().depth = nodes[current].depth + 1;
+            children.emplace_back();
+
+            edges.emplace(edge_key(current, c), next);
+            children[current].emplace_back(c, next);
+        }
+        current = next;
+    }
+    return current;
+}
+
+void emote_automaton::add_set(const std::string& key, const std::vector<std::u16string>& names)
+{
+    if (set_names.find(key) != set_names.end())
+    {
+        remove_set(key);
+    }
+
+    std::vector<uint32_t>& terminals = set_terminals[key];
+    std::vector<std::u16string>& stored_names = set_names[key];
+    terminals.reserve(names.size());
+    stored_names.reserve(names.size());
+
+    for (const std::u16string& name : names)
+    {
+        //Lengths are tracked in 16 bits while matching.
+        if (name.empty() || name.size() > 0xFFFF) continue;
+
+        uint32_t terminal = insert(name);
+        if (nodes[terminal].terminal_refs++ == 0)
+        {
+            ++pattern_count;
+        }
+
+        terminals.push_back(terminal);
+        stored_names.push_back(name);
+    }
+
+    links_dirty = true;
+}
+
+void emote_automaton::remove_set(const std::string& key)
+{
+    auto terminals = set_terminals.find(key);
+    if (terminals == set_terminals.end()) return;
+
+    for (uint32_t terminal : terminals->second)
+    {
+        if (--nodes[terminal].terminal_refs == 0)
+        {
+            --pattern_count;
+            ++dead_patterns;
+        }
+    }
+
+    set_terminals.erase(terminals);
+    set_names.erase(key);
+    links_dirty = true;
+
+    if (dead_patterns > compact_threshold && dead_patterns > pattern_count)
+    {
+        compact();
+    }
+}
+
+void emote_automaton::compact()
+{
+    auto names = std::move(set_names);
+    clear();
+
+    for (auto& entry : names)
+    {
+        add_set(entry.first, entry.second);
+    }
+}
+
+void emote_automaton::rebuild_links()
+{
+    std::deque<uint32_t> queue;
+
+    for (auto& edge : children[root_node])
+    {
+        nodes[edge.second].fail = root_node;
+        nodes[edge.second].output = 0;
+        queue.push_back(edge.second);
+    }
+
+    while (!queue.empty())
+    {
+        const uint32_t parent = queue.front();
+        queue.pop_front();
+
+        for (auto& edge : children[parent])
+        {
+            const char16_t c = edge.first;
+            const uint32_t current = edge.second;
+
+            uint32_t fallback = nodes[parent].fail;
+            uint32_t fail = child(fallback, c);
+            while (fail == root_node && fallback != root_node)
+            {
+                fallback = nodes[fallback].fail;
+                fail = child(fallback, c);
+            }
+
+            nodes[current].fail = fail;
+            nodes[current].output = nodes[fail].terminal_refs > 0 ? fail : nodes[fail].output;
+            queue.push_back(current);
+        }
+    }
+
+    links_dirty = false;
+}
+
+uint32_t emote_automaton::match(const std::u16string& message, std::vector<uint32_t>& matches)
+{
+    if (pattern_count == 0 || message.empty()) return 0;
+
+    if (links_dirty)
+    {
+        rebuild_links();
+    }
+
+    //Longest valid match starting at each index.
+    best_length.assign(message.size(), 0);
+
+    uint32_t state = root_node;
+    for (size_t i = 0; i < message.size(); ++i)
+    {
+        const char16_t c = message[i];
+
+        uint32_t next = child(state, c);
+        while (next == root_node && state != root_node)
+        {
+            state = nodes[state].fail;
+            next = child(state, c);
+        }
+        state = next;
+
+        const size_t end = i + 1;
+        if (!is_word_boundary(message, end)) continue;
+
+        uint32_t terminal = nodes[state].terminal_refs > 0 ? state : nodes[state].output;
+        for (; terminal != root_node; terminal = nodes[terminal].output)
+        {
+            const uint32_t length = nodes[terminal].depth;
+            const size_t start = end - length;
+            if (!is_word_boundary(message, start)) continue;
+
+            best_length[start] = std::max<uint16_t>(best_length[start], uint16_t(length));
+        }
+    }
+
+    uint32_t count = 0;
+    for (size_t i = 0; i < message.size();)
+    {
+        const uint16_t length = best_length[i];
+        if (length == 0)
+        {
+            ++i;
+            continue;
+        }
+
+        matches.push_back(uint32_t(i));
+        matches.push_back(uint32_t(i + length));
+        ++count;
+        i += length;
+    }
+
+    return count;
+}
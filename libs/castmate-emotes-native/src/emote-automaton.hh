@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+//Aho-Corasick automaton over UTF-16 code units so match offsets line up with JS string indices.
+//
+//Emote sets are added and removed individually. Adding only inserts the new names into the trie and removing only
+//drops their reference counts, the failure links are rebuilt lazily on the next match after a change.
+//That's a single BFS over the trie instead of regenerating and recompiling a regex with every emote in it.
+//
+//Matching follows the rules of the old `\bname\b` regex: a match has to start and end on a word boundary and
+//the leftmost, then longest, match wins.
+class emote_automaton
+{
+public:
+    emote_automaton();
+
+    void add_set(const std::string& key, const std::vector<std::u16string>& names);
+    void remove_set(const std::string& key);
+    void clear();
+
+    bool empty() const { return pattern_count == 0; }
+
+    //Appends [start, end) pairs of every match in the message to matches, returns the number of matches.
+    uint32_t match(const std::u16string& message, std::vector<uint32_t>& matches);
+
+private:
+    struct node
+    {
+        uint32_t fail = 0;
+        //Closest node down the failure chain that ends a pattern, 0 if none.
+        uint32_t output = 0;
+        uint32_t depth = 0;
+        //Number of sets this node ends a pattern for, names can appear in several sets.
+        uint32_t terminal_refs = 0;
+    };
+
+    uint32_t child(uint32_t parent, char16_t c) const;
+    uint32_t insert(const std::u16string& name);
+    void rebuild_links();
+    void compact();
+
+    static uint64_t edge_key(uint32_t parent, char16_t c) { return (uint64_t(parent) << 16) | c; }
+
+    std::vector<node> nodes;
+    std::unordered_map<uint64_t, uint32_t> edges;
+    //Per node children list, needed for the BFS, edges is for the hot lookup.
+    std::vector<std::vector<std::pair<char16_t, uint32_t>>> children;
+
+    //Names are kept per set so the trie can be rebuilt once removals leave too many dead branches.
+    std::unordered_map<std::string, std::vector<std::u16string>> set_names;
+    std::unordered_map<std::string, std::vector<uint32_t>> set_terminals;
+
+    size_t pattern_count = 0;
+    size_t dead_patterns = 0;
+    bool links_dirty = false;
+
+    //Scratch for match(), kept around so busy chats don't allocate per message.
+    std::vector<uint16_t> best_length;
+};
@@ -0,0 +1,130 @@
+#include "emote-matcher.hh"
+#include "castmate-native/trace.hh"
+
+#include <string>
+#include <cstring>
+
+Napi::Object emote_matcher::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeEmoteMatcher", {
+        InstanceMethod("addSet", &emote_matcher::add_set),
+        InstanceMethod("removeSet", &emote_matcher::remove_set),
+        InstanceMethod("clear", &emote_matcher::clear),
+        InstanceMethod("parse", &emote_matcher::parse),
+        InstanceMethod("parseBatch", &emote_matcher::parse_batch),
+    });
+
+    exports.Set("NativeEmoteMatcher", constructor);
+    return exports;
+}
+
+emote_matcher::emote_matcher(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<emote_matcher>(info)
+{
+}
+
+Napi::Value emote_matcher::add_set(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsArray())
+    {
+        Napi::Error::New(env, "addSet requires a key and an array of emote names.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string key = info[0].As<Napi::String>().Utf8Value();
+    Napi::Array js_names = info[1].As<Napi::Array>();
+
+    std::vector<std::u16string> names;
+    names.reserve(js_names.Length());
+    for (uint32_t i = 0; i < js_names.Length(); ++i)
+    {
+        Napi::Value name = js_names.Get(i);
+        if (!name.IsString()) continue;
+        names.push_back(name.As<Napi::String>().Utf16Value());
+    }
+
+    automaton.add_set(key, names);
+    return env.Undefined();
+}
+
+Napi::Value emote_matcher::remove_set(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "removeSet requires a key.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    automaton.remove_set(info[0].As<Napi::String>().Utf8Value());
+    return env.Undefined();
+}
+
+Napi::Value emote_matcher::clear(const Napi::CallbackInfo& info)
+{
+    automaton.clear();
+    return info.Env().Undefined();
+}
+
+Napi::Value emote_matcher::make_result(Napi::Env env)
+{
+    Napi::Uint32Array result = Napi::Uint32Array::New(env, matches.size());
+    if (!matches.empty())
+    {
+        memcpy(result.Data(), matches.data(), matches.size() * sizeof(uint32_t));
+    }
+    return result;
+}
+
+//Returns [start0, end0, start1, end1, ...]
+Napi::Value emote_matcher::parse(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "parse requires a message.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    matches.clear();
+    if (!automaton.empty())
+    {
+        automaton.match(info[0].As<Napi::String>().Utf16Value(), matches);
+    }
+
+    return make_result(env);
+}
+
+//Returns one block per message: [count, start0, end0, ..., count, ...], a single crossing for a whole batch.
+Napi::Value emote_matcher::parse_batch(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsArray())
+    {
+        Napi::Error::New(env, "parseBatch requires an array of messages.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    TRACE_SCOPE("emote parse batch");
+
+    Napi::Array messages = info[0].As<Napi::Array>();
+
+    matches.clear();
+    for (uint32_t i = 0; i < messages.Length(); ++i)
+    {
+        const size_t count_index = matches.size();
+        matches.push_back(0);
+
+        Napi::Value message = messages.Get(i);
+        if (!message.IsString() || automaton.empty()) continue;
+
+        matches[count_index] = automaton.match(message.As<Napi::String>().Utf16Value(), matches);
+    }
+
+    return make_result(env);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <napi.h>
+
+#include <vector>
+
+#include "emote-automaton.hh"
+
+//JS facing wrapper around emote_automaton. Results come back as flat Uint32Arrays of [start, end) offsets
+//instead of arrays of objects so a busy chat doesn't create garbage per emote.
+class emote_matcher : public Napi::ObjectWrap<emote_matcher>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    emote_matcher(const Napi::CallbackInfo& info);
+
+    Napi::Value add_set(const Napi::CallbackInfo& info);
+    Napi::Value remove_set(const Napi::CallbackInfo& info);
+    Napi::Value clear(const Napi::CallbackInfo& info);
+
+    Napi::Value parse(const Napi::CallbackInfo& info);
+    Napi::Value parse_batch(const Napi::CallbackInfo& info);
+
+private:
+    Napi::Value make_result(Napi::Env env);
+
+    emote_automaton automaton;
+
+    //Scratch, reused between calls.
+    std::vector<uint32_t> matches;
+};
@@ -0,0 +1,32 @@
+declare namespace CastmateEmotesNative {
+	class EmoteMatcher {
+		constructor()
+
+		/** Adds or replaces a set of emote names, only the changed set is touched */
+		addSet(key: string, names: string[]): void
+		removeSet(key: string): void
+		clear(): void
+
+		/**
+		 * Finds emote names surrounded by word boundaries, leftmost then longest wins.
+		 * @returns [start0, end0, start1, end1, ...] in UTF-16 offsets
+		 */
+		parse(message: string): Uint32Array
+		/**
+		 * Same as parse for many messages in a single call.
+		 * @returns [count, start0, end0, ...] for each message in order
+		 */
+		parseBatch(messages: string[]): Uint32Array
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateEmotesNative
@@ -0,0 +1,37 @@
+const bindings = require("bindings")
+
+const native = bindings({
+	bindings: "castmate-emotes-native",
+})
+
+class EmoteMatcher {
+	constructor() {
+		this._native = new native.NativeEmoteMatcher()
+	}
+
+	addSet(key, names) {
+		return this._native.addSet(key, names)
+	}
+	removeSet(key) {
+		return this._native.removeSet(key)
+	}
+	clear() {
+		return this._native.clear()
+	}
+
+	parse(message) {
+		return this._native.parse(message)
+	}
+	parseBatch(messages) {
+		return this._native.parseBatch(messages)
+	}
+}
+
+module.exports = {
+	EmoteMatcher,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
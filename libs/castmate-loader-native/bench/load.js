@@ -0,0 +1,124 @@
+// Profile loading, cold and warm
+// Writes a folder of generated profiles, then loads them three ways: with the yaml package one file at a time the
+// way castmate-core used to, with an empty parse cache, and again with the cache the cold run left behind.
+//
+// Build first with `yarn rebuild`, then run `yarn bench`
+// Options: --files=200 --triggers=40 (per profile) --keep to leave the temp folder behind
+
+const fs = require("fs")
+const os = require("os")
+const path = require("path")
+
+const { FileLoader } = require("../src/index")
+
+function parseArgs() {
+	const options = {
+		files: 200,
+		triggers: 40,
+		keep: false,
+	}
+
+	for (const arg of process.argv.slice(2)) {
+		const [key, value] = arg.replace(/^--/, "").split("=")
+		if (key == "files") options.files = Number(value)
+		else if (key == "triggers") options.triggers = Number(value)
+		else if (key == "keep") options.keep = true
+	}
+
+	return options
+}
+
+//Roughly the shape of a saved profile, a map of triggers each holding a small sequence of actions
+function makeProfile(index, triggers) {
+	const lines = [`name: Profile ${index}`, `activationMode: toggle`, `conditions:`, `  operator: and`, `  operands: []`, `triggers:`]
+	for (let t = 0; t < triggers; ++t) {
+		lines.push(`  - id: trigger${index}x${t}`)
+		lines.push(`    plugin: twitch`)
+		lines.push(`    trigger: chat`)
+		lines.push(`    config:`)
+		lines.push(`      message: "!command${t}"`)
+		lines.push(`      match: startsWith`)
+		lines.push(`      cooldown: ${t * 0.5}`)
+		lines.push(`    sequence:`)
+		lines.push(`      actions:`)
+		for (let a = 0; a < 3; ++a) {
+			lines.push(`        - id: action${t}x${a}`)
+			lines.push(`          plugin: sound`)
+			lines.push(`          action: playSound`)
+			lines.push(`          config:`)
+			lines.push(`            sound: sounds/effect-${a}.mp3`)
+			lines.push(`            volume: ${50 + a * 10}`)
+			lines.push(`            startSec: 0`)
+			lines.push(`            enabled: true`)
+		}
+	}
+	return lines.join("\n") + "\n"
+}
+
+async function loadWithYamlPackage(paths) {
+	let YAML
+	try {
+		YAML = require("yaml")
+	} catch {
+		return undefined
+	}
+
+	const start = performance.now()
+	for (const file of paths) {
+		YAML.parse(await fs.promises.readFile(file, "utf-8"))
+	}
+	return performance.now() - start
+}
+
+async function timeLoad(cachePath, paths) {
+	const loader = new FileLoader(cachePath)
+	const start = performance.now()
+	const results = await loader.loadMany(paths)
+	const elapsed = performance.now() - start
+	return { elapsed, results, stats: loader.getStats() }
+}
+
+async function main() {
+	const options = parseArgs()
+	const dir = fs.mkdtempSync(path.join(os.tmpdir(), "castmate-loader-bench-"))
+	const cachePath = path.join(dir, "parse-cache.cmpc")
+
+	const paths = []
+	let bytes = 0
+	for (let i = 0; i < options.files; ++i) {
+		const file = path.join(dir, `profile-${i}.yaml`)
+		const text = makeProfile(i, options.triggers)
+		fs.writeFileSync(file, text)
+		bytes += text.length
+		paths.push(file)
+	}
+
+	console.log(`${options.files} profiles, ${(bytes / 1024 / 1024).toFixed(2)} MB`)
+
+	const yamlTime = await loadWithYamlPackage(paths)
+	if (yamlTime != null) {
+		console.log(`yaml package: ${yamlTime.toFixed(1)} ms`)
+	} else {
+		console.log(`yaml package: not installed, skipped`)
+	}
+
+	const cold = await timeLoad(cachePath, paths)
+	console.log(`native cold:  ${cold.elapsed.toFixed(1)} ms`, cold.stats)
+
+	const warm = await timeLoad(cachePath, paths)
+	console.log(`native warm:  ${warm.elapsed.toFixed(1)} ms`, warm.stats)
+
+	const mismatched = cold.results.filter((r, i) => JSON.stringify(r.data) != JSON.stringify(warm.results[i].data))
+	if (mismatched.length > 0) {
+		console.log(`${mismatched.length} files differ between the cold and warm loads`)
+		process.exitCode = 1
+	}
+
+	if (options.keep) {
+		console.log(`Left in ${dir}`)
+	} else {
+		fs.rmSync(dir, { recursive: true, force: true })
+	}
+}
+
+main()
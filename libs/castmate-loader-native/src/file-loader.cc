@@ -0,0 +1,312 @@
+#include "file-loader.hh"
+#include "yaml-json.hh"
+#include "castmate-native/trace.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+
+struct file_loader::load_request
+{
+    std::vector<std::string> paths;
+    //Only ever holds one drain, finished results are collected in pending until it runs
+    js_call_dispatcher events;
+    std::chrono::steady_clock::time_point start;
+    std::atomic<uint32_t> remaining { 0 };
+
+    //Finished results wait here until the JS thread takes them, at most one drain is queued at a time
+    std::mutex mutex;
+    std::vector<file_load_result> pending;
+    bool posted = false;
+    file_load_stats stats;
+
+    //JS thread only
+    size_t delivered = 0;
+};
+
+Napi::Object file_loader::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeFileLoader", {
+        InstanceMethod("loadMany", &file_loader::load_many),
+        InstanceMethod("getStats", &file_loader::get_stats),
+    });
+
+    exports.Set("NativeFileLoader", constructor);
+    return exports;
+}
+
+static Napi::Object make_js_stats(Napi::Env env, const file_load_stats& stats)
+{
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("files", Napi::Number::New(env, stats.files));
+    result.Set("cached", Napi::Number::New(env, stats.cached));
+    result.Set("parsed", Napi::Number::New(env, stats.parsed));
+    result.Set("fallback", Napi::Number::New(env, stats.fallback));
+    result.Set("failed", Napi::Number::New(env, stats.failed));
+    result.Set("elapsedMs", Napi::Number::New(env, stats.elapsed_ms));
+    if (!stats.cache_error.empty()) result.Set("cacheError", Napi::String::New(env, stats.cache_error));
+    return result;
+}
+
+static Napi::Object make_js_result(Napi::Env env, const std::string& file, const file_load_result& result)
+{
+    Napi::Object js_result = Napi::Object::New(env);
+    js_result.Set("index", Napi::Number::New(env, result.index));
+    js_result.Set("file", Napi::String::New(env, file));
+
+    if (!result.error.empty())
+    {
+        js_result.Set("error", Napi::String::New(env, result.error));
+        if (!result.code.empty()) js_result.Set("code", Napi::String::New(env, result.code));
+    }
+    else if (result.fallback)
+    {
+        js_result.Set("text", Napi::String::New(env, result.text));
+    }
+    else
+    {
+        js_result.Set("json", Napi::String::New(env, result.json));
+        js_result.Set("cached", Napi::Boolean::New(env, result.cached));
+    }
+
+    return js_result;
+}
+
+//One read sized from the stat, then whatever is left if the file grew in between.
+static bool read_file(const std::string& file, uint64_t size, std::string& text)
+{
+#ifdef _WIN32
+    FILE* handle = _wfopen(std::filesystem::u8path(file).c_str(), L"rb");
+#else
+    FILE* handle = fopen(file.c_str(), "rb");
+#endif
+    if (!handle) return false;
+
+    text.resize(size_t(size));
+    text.resize(fread(text.data(), 1, text.size(), handle));
+
+    char buffer[4096];
+    size_t read;
+    while ((read = fread(buffer, 1, sizeof(buffer), handle)) > 0)
+    {
+        text.append(buffer, read);
+    }
+
+    const bool failed = ferror(handle) != 0;
+    fclose(handle);
+    return !failed;
+}
+
+file_loader::file_loader(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<file_loader>(info)
+{
+    std::string cache_path;
+    if (info.Length() > 0 && info[0].IsString())
+    {
+        cache_path = info[0].As<Napi::String>().Utf8Value();
+    }
+    cache = std::make_unique<parse_cache>(std::move(cache_path));
+}
+
+void file_loader::Finalize(Napi::Env env)
+{
+    //Runs everything already queued before joining
+    pool.reset();
+}
+
+//loadMany(paths, emit) emits ("batch", results[]) as files finish then ("done", stats)
+Napi::Value file_loader::load_many(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction())
+    {
+        Napi::Error::New(env, "loadMany requires an array of paths and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Function callback = info[1].As<Napi::Function>();
+    Napi::Array paths = info[0].As<Napi::Array>();
+
+    if (paths.Length() == 0)
+    {
+        //Nothing would ever finish to send done
+        callback.Call({ Napi::String::New(env, "done"), make_js_stats(env, file_load_stats()) });
+        return env.Undefined();
+    }
+
+    auto request = new load_request();
+    request->start = std::chrono::steady_clock::now();
+
+    request->paths.reserve(paths.Length());
+    for (uint32_t i = 0; i < paths.Length(); ++i)
+    {
+        Napi::Value path = paths.Get(i);
+        request->paths.push_back(path.IsString() ? path.As<Napi::String>().Utf8Value() : std::string());
+    }
+
+    request->remaining = uint32_t(request->paths.size());
+    request->stats.files = uint32_t(request->paths.size());
+    request->events.open(env, callback, "FileLoaderTSFN", 2);
+
+    if (!pool)
+    {
+        pool = std::make_unique<work_pool>();
+    }
+
+    for (uint32_t i = 0; i < request->paths.size(); ++i)
+    {
+        pool->submit([this, request, i] { load_file(request, i); });
+    }
+
+    return env.Undefined();
+}
+
+void file_loader::load_file(load_request* request, uint32_t index)
+{
+    TRACE_SCOPE("load file");
+
+    const std::string& file = request->paths[index];
+
+    file_load_result result;
+    result.index = index;
+
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    if (!stat_file(file, size, mtime))
+    {
+        std::error_code error;
+        const bool exists = std::filesystem::exists(std::filesystem::u8path(file), error);
+        result.code = exists ? "EISDIR" : "ENOENT";
+        result.error = std::string(exists ? "EISDIR: illegal operation on a directory, read '" : "ENOENT: no such file or directory, open '") + file + "'";
+        finish_file(request, std::move(result));
+        return;
+    }
+
+    if (cache->lookup(file, size, mtime, result.json))
+    {
+        result.cached = true;
+        finish_file(request, std::move(result));
+        return;
+    }
+
+    std::string text;
+    if (!read_file(file, size, text))
+    {
+        result.code = "EIO";
+        result.error = "EIO: unable to read '" + file + "'";
+        finish_file(request, std::move(result));
+        return;
+    }
+
+    {
+        TRACE_SCOPE("convert yaml");
+        if (yaml_to_json(text, result.json))
+        {
+            cache->store(file, size, mtime, result.json);
+        }
+        else
+        {
+            result.fallback = true;
+            result.text = std::move(text);
+        }
+    }
+
+    finish_file(request, std::move(result));
+}
+
+void file_loader::finish_file(load_request* request, file_load_result&& result)
+{
+    //The last file out writes the cache, so done is only sent once it's on disk
+    std::string cache_error;
+    if (request->remaining.fetch_sub(1) == 1 && !cache->save(cache_error))
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex);
+        ++cache_save_failures;
+    }
+
+    auto drain = [request](Napi::Env env, Napi::Function js_callback)
+    {
+        std::vector<file_load_result> batch;
+        file_load_stats stats;
+        {
+            std::lock_guard<std::mutex> lock(request->mutex);
+            batch.swap(request->pending);
+            request->posted = false;
+            stats = request->stats;
+        }
+
+        request->delivered += batch.size();
+        const bool done = request->delivered == request->paths.size();
+
+        //env might be null if the tsfn is aborted
+        if (env != nullptr && js_callback != nullptr)
+        {
+            Napi::Array results = Napi::Array::New(env, batch.size());
+            for (uint32_t i = 0; i < batch.size(); ++i)
+            {
+                results.Set(i, make_js_result(env, request->paths[batch[i].index], batch[i]));
+            }
+            js_callback.Call({ Napi::String::New(env, "batch"), results });
+
+            if (done)
+            {
+                stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - request->start).count();
+                js_callback.Call({ Napi::String::New(env, "done"), make_js_stats(env, stats) });
+            }
+        }
+
+        if (done)
+        {
+            //Only releases the TSFN, the dispatcher's state outlives this call
+            delete request;
+        }
+    };
+
+    {
+        std::lock_guard<std::mutex> stats_lock(stats_mutex);
+        if (!result.error.empty()) ++totals.failed;
+        else if (result.fallback) ++totals.fallback;
+        else if (result.cached) ++totals.cached;
+        else ++totals.parsed;
+        ++totals.files;
+    }
+
+    //Held over the call so the drain can't finish the request and free it while this thread is still using it
+    std::lock_guard<std::mutex> lock(request->mutex);
+    if (!result.error.empty()) ++request->stats.failed;
+    else if (result.fallback) ++request->stats.fallback;
+    else if (result.cached) ++request->stats.cached;
+    else ++request->stats.parsed;
+    if (!cache_error.empty()) request->stats.cache_error = std::move(cache_error);
+
+    request->pending.push_back(std::move(result));
+    if (!request->posted)
+    {
+        request->posted = true;
+        request->events.post(drain);
+    }
+}
+
+Napi::Value file_loader::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    file_load_stats stats;
+    uint32_t save_failures;
+    {
+        std::lock_guard<std::mutex> lock(stats_mutex);
+        stats = totals;
+        save_failures = cache_save_failures;
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("files", Napi::Number::New(env, stats.files));
+    result.Set("cached", Napi::Number::New(env, stats.cached));
+    result.Set("parsed", Napi::Number::New(env, stats.parsed));
+    result.Set("fallback", Napi::Number::New(env, stats.fallback));
+    result.Set("failed", Napi::Number::New(env, stats.failed));
+    result.Set("cacheEntries", Napi::Number::New(env, double(cache->size())));
+    result.Set("cacheSaveFailures", Napi::Number::New(env, save_failures));
+    return result;
+}
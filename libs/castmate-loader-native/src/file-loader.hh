@@ -0,0 +1,66 @@
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "parse-cache.hh"
+#include "castmate-native/work-pool.hh"
+#include "castmate-native/event-dispatcher.hh"
+
+struct file_load_result
+{
+    uint32_t index = 0;
+    //Set when the file converted or came from the cache
+    std::string json;
+    //The file's text when it needs the yaml package, see yaml_to_json
+    std::string text;
+    bool fallback = false;
+    std::string error;
+    std::string code;
+    bool cached = false;
+};
+
+struct file_load_stats
+{
+    uint32_t files = 0;
+    uint32_t cached = 0;
+    uint32_t parsed = 0;
+    uint32_t fallback = 0;
+    uint32_t failed = 0;
+    double elapsed_ms = 0;
+    //Set when the parse cache couldn't be written back, the loads themselves still succeeded
+    std::string cache_error;
+};
+
+//Reads and converts YAML and JSON files to JSON text on a pool of threads, answering unchanged files from a
+//persistent cache without touching them. Results go back to JS in batches as they finish.
+class file_loader : public Napi::ObjectWrap<file_loader>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    file_loader(const Napi::CallbackInfo& info);
+    virtual void Finalize(Napi::Env env);
+
+    Napi::Value load_many(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+
+private:
+    struct load_request;
+
+    void load_file(load_request* request, uint32_t index);
+    void finish_file(load_request* request, file_load_result&& result);
+
+    std::unique_ptr<work_pool> pool;
+    std::unique_ptr<parse_cache> cache;
+
+    //Totals over every loadMany
+    std::mutex stats_mutex;
+    file_load_stats totals;
+    uint32_t cache_save_failures = 0;
+};
@@ -0,0 +1,50 @@
+declare namespace CastmateLoaderNative {
+	interface LoadResult {
+		file: string
+		/** The parsed file, when it was converted natively or came from the cache */
+		data?: any
+		/** The file's text when it uses YAML the native side leaves to the yaml package, anchors, tags and the like */
+		text?: string
+		/** Read failures carry the same code fs would, ENOENT for a missing file */
+		error?: Error & { code?: string }
+		/** Answered from the parse cache without reading the file */
+		cached?: boolean
+	}
+
+	interface LoaderStats {
+		files: number
+		cached: number
+		parsed: number
+		fallback: number
+		failed: number
+		cacheEntries: number
+		/** Times the parse cache couldn't be written back after a loadMany */
+		cacheSaveFailures: number
+	}
+
+	class FileLoader {
+		/**
+		 * Converted files are kept in cachePath keyed by path, size and mtime. onCacheError is told when the cache
+		 * couldn't be written back, the files themselves still loaded.
+		 */
+		constructor(cachePath?: string, onCacheError?: (message: string) => any)
+
+		/**
+		 * Reads and parses YAML or JSON files on a pool of threads. onBatch sees results as they finish,
+		 * the promise resolves with every result in the order of paths.
+		 */
+		loadMany(paths: string[], onBatch?: (results: LoadResult[]) => void): Promise<LoadResult[]>
+		getStats(): LoaderStats
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateLoaderNative
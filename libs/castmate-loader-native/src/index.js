@@ -0,0 +1,67 @@
+const bindings = require("bindings")
+
+const native = bindings({
+	bindings: "castmate-loader-native",
+})
+
+function toResult(result) {
+	if (result.error != null) {
+		const error = new Error(result.error)
+		error.code = result.code
+		return { file: result.file, error }
+	}
+
+	//Left to the yaml package
+	if (result.text != null) {
+		return { file: result.file, text: result.text }
+	}
+
+	try {
+		return { file: result.file, data: JSON.parse(result.json), cached: result.cached }
+	} catch (err) {
+		return { file: result.file, error: err }
+	}
+}
+
+class FileLoader {
+	constructor(cachePath, onCacheError) {
+		this._native = new native.NativeFileLoader(cachePath)
+		this._onCacheError = onCacheError
+	}
+
+	loadMany(paths, onBatch) {
+		return new Promise((resolve, reject) => {
+			const results = new Array(paths.length)
+			try {
+				this._native.loadMany(paths, (event, payload) => {
+					if (event == "batch") {
+						const batch = payload.map((result) => {
+							const converted = toResult(result)
+							results[result.index] = converted
+							return converted
+						})
+						onBatch?.(batch)
+					} else if (event == "done") {
+						if (payload.cacheError) this._onCacheError?.(payload.cacheError)
+						resolve(results)
+					}
+				})
+			} catch (err) {
+				reject(err)
+			}
+		})
+	}
+
+	getStats() {
+		return this._native.getStats()
+	}
+}
+
+module.exports = {
+	FileLoader,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,30 @@
+#include <napi.h>
+
+#include "file-loader.hh"
+#include "castmate-native/trace-bindings.hh"
+
+
+class instance_data
+{
+public:
+    instance_data(Napi::Env env)
+    {
+    }
+
+    ~instance_data() {
+
+    }
+};
+
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
+    //New up some instance data, it will be deleted when the module is unloaded.
+    env.SetInstanceData<instance_data>(new instance_data(env));
+
+    file_loader::init(env, exports);
+    trace_init(env, exports);
+
+    return exports;
+}
+
+NODE_API_MODULE(castmate_loader_native, Init)
@@ -0,0 +1,223 @@
+#include "parse-cache.hh"
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <filesystem>
+
+static const char parse_cache_magic[4] = { 'C', 'M', 'P', 'C' };
+static const uint8_t parse_cache_version = 1;
+
+template<typename T>
+static T read_value(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static void write_value(std::vector<uint8_t>& buffer, T value)
+{
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+static FILE* open_file(const std::filesystem::path& path, bool write)
+{
+#ifdef _WIN32
+    return _wfopen(path.c_str(), write ? L"wb" : L"rb");
+#else
+    return fopen(path.c_str(), write ? "wb" : "rb");
+#endif
+}
+
+bool stat_file(const std::string& file, uint64_t& size, int64_t& mtime)
+{
+    std::error_code error;
+    std::filesystem::directory_entry entry(std::filesystem::u8path(file), error);
+    if (error || !entry.is_regular_file(error)) return false;
+
+    size = entry.file_size(error);
+    if (error) return false;
+    mtime = int64_t(entry.last_write_time(error).time_since_epoch().count());
+    return !error;
+}
+
+parse_cache::parse_cache(std::string path)
+    : path(std::move(path))
+{
+}
+
+void parse_cache::load_locked()
+{
+    if (loaded) return;
+    loaded = true;
+
+    if (path.empty()) return;
+
+    FILE* file = open_file(std::filesystem::u8path(path), false);
+    if (!file) return;
+
+    std::vector<uint8_t> data;
+    if (fseek(file, 0, SEEK_END) == 0)
+    {
+        const long length = ftell(file);
+        if (length > 0)
+        {
+            data.resize(size_t(length));
+            fseek(file, 0, SEEK_SET);
+            if (fread(data.data(), 1, data.size(), file) != data.size()) data.clear();
+        }
+    }
+    fclose(file);
+
+    const size_t header_size = sizeof(parse_cache_magic) + 1 + 4;
+    if (data.size() < header_size || memcmp(data.data(), parse_cache_magic, sizeof(parse_cache_magic)) != 0 ||
+        data[sizeof(parse_cache_magic)] != parse_cache_version)
+    {
+        return;
+    }
+
+    const uint8_t* cursor = data.data() + sizeof(parse_cache_magic) + 1;
+    const uint8_t* end = data.data() + data.size();
+    const uint32_t count = read_value<uint32_t>(cursor);
+    cursor += 4;
+
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (end - cursor < 2) break;
+        const uint16_t path_length = read_value<uint16_t>(cursor);
+        cursor += 2;
+
+        if (size_t(end - cursor) < size_t(path_length) + 8 + 8 + 4) break;
+        std::string file(reinterpret_cast<const char*>(cursor), path_length);
+        cursor += path_length;
+
+        parse_cache_entry entry;
+        entry.size = read_value<uint64_t>(cursor);
+        entry.mtime = read_value<int64_t>(cursor + 8);
+        const uint32_t json_length = read_value<uint32_t>(cursor + 16);
+        cursor += 20;
+
+        if (size_t(end - cursor) < json_length) break;
+        entry.json.assign(reinterpret_cast<const char*>(cursor), json_length);
+        cursor += json_length;
+
+        entries.emplace(std::move(file), std::move(entry));
+    }
+}
+
+bool parse_cache::lookup(const std::string& file, uint64_t size, int64_t mtime, std::string& json)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    load_locked();
+
+    auto entry = entries.find(file);
+    if (entry == entries.end()) return false;
+
+    entry->second.seen = true;
+    if (entry->second.size != size || entry->second.mtime != mtime) return false;
+
+    json = entry->second.json;
+    return true;
+}
+
+void parse_cache::store(const std::string& file, uint64_t size, int64_t mtime, std::string json)
+{
+    if (file.size() > 0xFFFF || json.size() > 0xFFFFFFFF) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    load_locked();
+
+    parse_cache_entry& entry = entries[file];
+    entry.size = size;
+    entry.mtime = mtime;
+    entry.json = std::move(json);
+    entry.seen = true;
+    dirty = true;
+}
+
+size_t parse_cache::size()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    load_locked();
+    return entries.size();
+}
+
+bool parse_cache::save(std::string& error_message)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!dirty || path.empty()) return true;
+
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+        std::error_code error;
+        if (!it->second.seen && !std::filesystem::exists(std::filesystem::u8path(it->first), error))
+        {
+            it = entries.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+
+    size_t total = sizeof(parse_cache_magic) + 1 + 4;
+    for (const auto& entry : entries)
+    {
+        total += 2 + entry.first.size() + 8 + 8 + 4 + entry.second.json.size();
+    }
+
+    std::vector<uint8_t> buffer;
+    buffer.reserve(total);
+
+    buffer.insert(buffer.end(), parse_cache_magic, parse_cache_magic + sizeof(parse_cache_magic));
+    buffer.push_back(parse_cache_version);
+    write_value<uint32_t>(buffer, uint32_t(entries.size()));
+
+    for (const auto& entry : entries)
+    {
+        write_value<uint16_t>(buffer, uint16_t(entry.first.size()));
+        buffer.insert(buffer.end(), entry.first.begin(), entry.first.end());
+        write_value<uint64_t>(buffer, entry.second.size);
+        write_value<int64_t>(buffer, entry.second.mtime);
+        write_value<uint32_t>(buffer, uint32_t(entry.second.json.size()));
+        buffer.insert(buffer.end(), entry.second.json.begin(), entry.second.json.end());
+    }
+
+    //Write next to the old cache and swap it in so a crash never leaves half a cache behind.
+    const std::filesystem::path target = std::filesystem::u8path(path);
+    std::filesystem::path temp = target;
+    temp += ".tmp";
+
+    std::error_code error;
+    std::filesystem::create_directories(target.parent_path(), error);
+
+    FILE* file = open_file(temp, true);
+    if (!file)
+    {
+        error_message = "Unable to open " + temp.u8string();
+        return false;
+    }
+
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    fclose(file);
+    if (!written)
+    {
+        error_message = "Unable to write " + temp.u8string();
+        return false;
+    }
+
+    std::filesystem::rename(temp, target, error);
+    if (error)
+    {
+        error_message = "Unable to replace " + path + ": " + error.message();
+        return false;
+    }
+
+    dirty = false;
+    return true;
+}
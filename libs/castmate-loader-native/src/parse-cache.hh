@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <mutex>
+#include <unordered_map>
+
+struct parse_cache_entry
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    std::string json;
+    //Looked up or stored since the cache was opened
+    bool seen = false;
+};
+
+//Persistent cache of converted files keyed by path, size and mtime, so a warm start never reads or parses a file
+//that hasn't changed. The whole cache is read in one go the first time it's needed. Safe to use from any thread.
+//
+//Layout: "CMPC", version byte, u32 count, then per entry
+//  u16 path length, path bytes, u64 size, i64 mtime, u32 json length, json bytes
+class parse_cache
+{
+public:
+    explicit parse_cache(std::string path);
+
+    //Only returns entries whose size and mtime still match.
+    bool lookup(const std::string& file, uint64_t size, int64_t mtime, std::string& json);
+    void store(const std::string& file, uint64_t size, int64_t mtime, std::string json);
+
+    //Writes the cache back if anything changed. Entries that weren't seen this run are dropped if their file is gone.
+    //On failure error says which step failed.
+    bool save(std::string& error);
+
+    size_t size();
+
+private:
+    void load_locked();
+
+    std::string path;
+
+    std::mutex mutex;
+    bool loaded = false;
+    bool dirty = false;
+    std::unordered_map<std::string, parse_cache_entry> entries;
+};
+
+//Size and mtime as the cache keys them
+bool stat_file(const std::string& file, uint64_t& size, int64_t& mtime);
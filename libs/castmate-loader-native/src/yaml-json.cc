@@ -0,0 +1,1073 @@
+#include "yaml-json.hh"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <unordered_set>
+
+//Deeper than anything real, keeps a hostile file from blowing the worker's stack
+static const int max_depth = 512;
+
+static bool is_blank(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+static bool is_flow_indicator(char c)
+{
+    return c == ',' || c == '[' || c == ']' || c == '{' || c == '}';
+}
+
+static bool is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static bool is_hex(char c)
+{
+    return is_digit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static bool is_octal(char c)
+{
+    return c >= '0' && c <= '7';
+}
+
+static int hex_value(char c)
+{
+    if (is_digit(c)) return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    return c - 'A' + 10;
+}
+
+static void append_utf8(std::string& out, uint32_t code_point)
+{
+    if (code_point < 0x80)
+    {
+        out += char(code_point);
+    }
+    else if (code_point < 0x800)
+    {
+        out += char(0xC0 | (code_point >> 6));
+        out += char(0x80 | (code_point & 0x3F));
+    }
+    else if (code_point < 0x10000)
+    {
+        out += char(0xE0 | (code_point >> 12));
+        out += char(0x80 | ((code_point >> 6) & 0x3F));
+        out += char(0x80 | (code_point & 0x3F));
+    }
+    else
+    {
+        out += char(0xF0 | (code_point >> 18));
+        out += char(0x80 | ((code_point >> 12) & 0x3F));
+        out += char(0x80 | ((code_point >> 6) & 0x3F));
+        out += char(0x80 | (code_point & 0x3F));
+    }
+}
+
+static void append_json_string(std::string& out, std::string_view text)
+{
+    static const char hex_digits[] = "0123456789abcdef";
+
+    out += '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (uint8_t(c) < 0x20)
+            {
+                out += "\\u00";
+                out += hex_digits[uint8_t(c) >> 4];
+                out += hex_digits[uint8_t(c) & 0xF];
+            }
+            else
+            {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+enum class scalar_kind
+{
+    string,
+    null,
+    boolean,
+    number,
+    //.inf and .nan, which JSON can't hold
+    unrepresentable,
+};
+
+static bool all_of(std::string_view text, bool (*pred)(char))
+{
+    if (text.empty()) return false;
+    for (char c : text)
+    {
+        if (!pred(c)) return false;
+    }
+    return true;
+}
+
+static bool is_core_float(std::string_view text)
+{
+    //[-+]?(\.[0-9]+|[0-9]+(\.[0-9]*)?)([eE][-+]?[0-9]+)?
+    size_t i = 0;
+    if (i < text.size() && (text[i] == '-' || text[i] == '+')) ++i;
+
+    size_t int_digits = 0;
+    while (i < text.size() && is_digit(text[i])) { ++i; ++int_digits; }
+
+    size_t frac_digits = 0;
+    if (i < text.size() && text[i] == '.')
+    {
+        ++i;
+        while (i < text.size() && is_digit(text[i])) { ++i; ++frac_digits; }
+    }
+    if (int_digits == 0 && frac_digits == 0) return false;
+
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E'))
+    {
+        ++i;
+        if (i < text.size() && (text[i] == '-' || text[i] == '+')) ++i;
+        size_t exp_digits = 0;
+        while (i < text.size() && is_digit(text[i])) { ++i; ++exp_digits; }
+        if (exp_digits == 0) return false;
+    }
+
+    return i == text.size();
+}
+
+//YAML 1.2 core schema, the yaml package's default
+static scalar_kind resolve_plain(std::string_view text, double& number)
+{
+    if (text.empty() || text == "~" || text == "null" || text == "Null" || text == "NULL") return scalar_kind::null;
+    if (text == "true" || text == "True" || text == "TRUE") return scalar_kind::boolean;
+    if (text == "false" || text == "False" || text == "FALSE") return scalar_kind::boolean;
+
+    const char first = text[0];
+    if (!is_digit(first) && first != '-' && first != '+' && first != '.') return scalar_kind::string;
+
+    if (text.size() > 2 && text[0] == '0' && (text[1] == 'o' || text[1] == 'x'))
+    {
+        const int base = text[1] == 'o' ? 8 : 16;
+        std::string_view digits = text.substr(2);
+        if (!all_of(digits, base == 8 ? is_octal : is_hex)) return scalar_kind::string;
+
+        number = 0;
+        for (char c : digits) number = number * base + hex_value(c);
+        return scalar_kind::number;
+    }
+
+    if (is_core_float(text))
+    {
+        //strtod would stop at the first character it doesn't like, the check above means it won't meet one
+        std::string terminated(text);
+        number = strtod(terminated.c_str(), nullptr);
+        return scalar_kind::number;
+    }
+
+    std::string_view unsigned_text = text;
+    if (first == '-' || first == '+') unsigned_text = text.substr(1);
+    if (unsigned_text == ".inf" || unsigned_text == ".Inf" || unsigned_text == ".INF") return scalar_kind::unrepresentable;
+    if (text == ".nan" || text == ".NaN" || text == ".NAN") return scalar_kind::unrepresentable;
+
+    return scalar_kind::string;
+}
+
+static void append_number(std::string& out, double number)
+{
+    char buffer[32];
+    auto result = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    out.append(buffer, result.ptr - buffer);
+}
+
+namespace
+{
+
+class yaml_json_converter
+{
+public:
+    yaml_json_converter(std::string_view text, std::string& out)
+        : p(text.data())
+        , end(text.data() + text.size())
+        , line_start(text.data())
+        , out(out)
+    {
+    }
+
+    bool convert();
+
+private:
+    const char* p;
+    const char* end;
+    const char* line_start;
+    std::string& out;
+    int depth = 0;
+
+    struct depth_guard
+    {
+        depth_guard(int& depth) : depth(depth) { ++depth; }
+        ~depth_guard() { --depth; }
+        int& depth;
+    };
+
+    bool eof() const { return p >= end; }
+    int column() const { return int(p - line_start); }
+    bool blank_or_break_at(const char* q) const { return q >= end || is_blank(*q) || *q == '\n'; }
+    bool is_sequence_entry() const { return p < end && *p == '-' && blank_or_break_at(p + 1); }
+
+    void skip_blanks()
+    {
+        while (p < end && is_blank(*p)) ++p;
+    }
+
+    void skip_line()
+    {
+        while (p < end && *p != '\n') ++p;
+    }
+
+    void next_line()
+    {
+        ++p;
+        line_start = p;
+    }
+
+    bool at_document_marker() const
+    {
+        return column() == 0 && end - p >= 3 && (memcmp(p, "---", 3) == 0 || memcmp(p, "...", 3) == 0) &&
+            blank_or_break_at(p + 3);
+    }
+
+    //Skips blanks and a trailing comment, true if nothing else is left on the line. Leaves the line break.
+    bool at_line_end()
+    {
+        skip_blanks();
+        if (p < end && *p == '#') skip_line();
+        return p >= end || *p == '\n';
+    }
+
+    bool skip_to_content();
+    bool skip_flow_space();
+
+    bool parse_block_node(int parent_indent, bool after_key, bool sequence_at_parent);
+    bool parse_block_mapping(int indent);
+    bool parse_block_sequence(int indent);
+    bool parse_block_scalar(int parent_indent);
+    bool parse_scalar(int parent_indent);
+
+    bool is_mapping_key_line() const;
+    bool parse_mapping_key(std::string& key);
+    bool read_plain_line(std::string& value);
+    bool parse_quoted(std::string& value);
+    bool parse_escape(std::string& value);
+    void fold_quoted_breaks(std::string& value, bool escaped);
+
+    bool parse_flow_node();
+    bool parse_flow_sequence();
+    bool parse_flow_mapping();
+    bool read_flow_plain(std::string& value);
+
+    bool emit_plain(std::string_view text);
+    bool check_plain_key(std::string_view text);
+};
+
+}
+
+bool yaml_json_converter::convert()
+{
+    if (end - p >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+    {
+        p += 3;
+        line_start = p;
+    }
+
+    if (!skip_to_content()) return false;
+    if (!eof() && *p == '%') return false;
+
+    if (!eof() && at_document_marker())
+    {
+        if (*p == '.') return false;
+        p += 3;
+        if (!at_line_end() || !skip_to_content()) return false;
+    }
+
+    //The yaml package has its own idea of what an empty document is, let it decide
+    if (eof() || at_document_marker()) return false;
+
+    if (!parse_block_node(-1, false, false)) return false;
+    if (!skip_to_content()) return false;
+
+    if (!eof())
+    {
+        if (!at_document_marker() || *p != '.') return false;
+        p += 3;
+        if (!at_line_end() || !skip_to_content()) return false;
+        if (!eof()) return false;
+    }
+
+    return true;
+}
+
+//Moves to the next character that isn't a blank, a comment or a line break
+bool yaml_json_converter::skip_to_content()
+{
+    bool crossed_line = false;
+    while (true)
+    {
+        skip_blanks();
+        if (p >= end) return true;
+
+        if (*p == '#')
+        {
+            skip_line();
+            continue;
+        }
+
+        if (*p == '\n')
+        {
+            next_line();
+            crossed_line = true;
+            continue;
+        }
+
+        //Tabs can't indent
+        if (crossed_line && memchr(line_start, '\t', p - line_start)) return false;
+        return true;
+    }
+}
+
+bool yaml_json_converter::parse_block_node(int parent_indent, bool after_key, bool sequence_at_parent)
+{
+    depth_guard guard(depth);
+    if (depth > max_depth) return false;
+
+    skip_blanks();
+    if (at_line_end())
+    {
+        //The value is on the following lines, or it's empty
+        if (!skip_to_content()) return false;
+
+        const bool nested = column() > parent_indent || (sequence_at_parent && column() == parent_indent && is_sequence_entry());
+        if (eof() || at_document_marker() || !nested)
+        {
+            out += "null";
+            return true;
+        }
+        after_key = false;
+    }
+
+    const char c = *p;
+    if (c == '&' || c == '*' || c == '!' || c == '%' || c == '@' || c == '`') return false;
+    if (c == '?' && blank_or_break_at(p + 1)) return false;
+
+    if (is_sequence_entry())
+    {
+        //a: - b isn't YAML
+        if (after_key) return false;
+        return parse_block_sequence(column());
+    }
+
+    if (c == '|' || c == '>') return parse_block_scalar(parent_indent);
+
+    if (c == '[' || c == '{')
+    {
+        if (!parse_flow_node()) return false;
+        //Anything else on the line, including a : making this a key, is more than we handle
+        return at_line_end();
+    }
+
+    if (!after_key && is_mapping_key_line()) return parse_block_mapping(column());
+
+    return parse_scalar(parent_indent);
+}
+
+bool yaml_json_converter::parse_block_mapping(int indent)
+{
+    std::unordered_set<std::string> keys;
+    bool first = true;
+
+    out += '{';
+    while (true)
+    {
+        std::string key;
+        if (!parse_mapping_key(key)) return false;
+        //The yaml package rejects duplicate keys
+        if (!keys.insert(key).second) return false;
+
+        if (!first) out += ',';
+        first = false;
+
+        append_json_string(out, key);
+        out += ':';
+
+        //A sequence may sit at the same indent as its key
+        if (!parse_block_node(indent, true, true)) return false;
+
+        if (!skip_to_content()) return false;
+        if (eof() || at_document_marker() || column() < indent) break;
+        if (column() > indent) return false;
+    }
+    out += '}';
+
+    return true;
+}
+
+bool yaml_json_converter::parse_block_sequence(int indent)
+{
+    bool first = true;
+
+    out += '[';
+    while (true)
+    {
+        //Past the -
+        ++p;
+
+        if (!first) out += ',';
+        first = false;
+
+        if (!parse_block_node(indent, false, false)) return false;
+
+        if (!skip_to_content()) return false;
+        if (eof() || at_document_marker() || column() < indent) break;
+        if (column() > indent) return false;
+        //The rest of a mapping this sequence was the value of
+        if (!is_sequence_entry()) break;
+    }
+    out += ']';
+
+    return true;
+}
+
+bool yaml_json_converter::parse_block_scalar(int parent_indent)
+{
+    const bool folded = *p == '>';
+    ++p;
+
+    enum { clip, strip, keep } chomping = clip;
+    for (int i = 0; i < 2 && p < end; ++i)
+    {
+        if (*p == '-') chomping = strip;
+        else if (*p == '+') chomping = keep;
+        //Explicit indentation indicators are rare enough to leave to the yaml package
+        else if (is_digit(*p)) return false;
+        else break;
+        ++p;
+    }
+
+    if (!blank_or_break_at(p) || !at_line_end()) return false;
+    if (p < end) next_line();
+
+    //The first non-empty line sets the indentation
+    int indent = -1;
+    int max_empty_indent = 0;
+    for (const char* scan = p; scan < end;)
+    {
+        const char* text = scan;
+        while (text < end && *text == ' ') ++text;
+
+        if (text < end && *text != '\n')
+        {
+            indent = int(text - scan);
+            break;
+        }
+
+        max_empty_indent = std::max(max_empty_indent, int(text - scan));
+        scan = text + 1;
+    }
+
+    std::string value;
+
+    if (indent <= parent_indent || indent < 0)
+    {
+        if (chomping == keep) return false;
+        append_json_string(out, value);
+        return true;
+    }
+    if (max_empty_indent > indent) return false;
+
+    std::string_view previous;
+    bool has_content = false;
+    //Before the first line these are leading empty lines, which are kept as they are
+    int empty_lines = 0;
+    bool final_break = false;
+
+    while (p < end)
+    {
+        const char* text = p;
+        while (text < end && *text == ' ' && text - p < indent) ++text;
+        const int spaces = int(text - p);
+
+        const bool empty = text >= end || *text == '\n';
+        if (!empty && spaces < indent) break;
+        if (indent == 0 && at_document_marker()) break;
+
+        const char* line_end = text;
+        while (line_end < end && *line_end != '\n') ++line_end;
+
+        if (empty)
+        {
+            ++empty_lines;
+        }
+        else
+        {
+            std::string_view line(text, line_end - text);
+
+            if (has_content)
+            {
+                const bool spaced = is_blank(previous[0]) || is_blank(line[0]);
+                if (!folded || spaced)
+                {
+                    value.append(empty_lines + 1, '\n');
+                }
+                else if (empty_lines > 0)
+                {
+                    value.append(empty_lines, '\n');
+                }
+                else
+                {
+                    value += ' ';
+                }
+            }
+            else
+            {
+                value.append(empty_lines, '\n');
+            }
+
+            value.append(line);
+            previous = line;
+            has_content = true;
+            empty_lines = 0;
+        }
+
+        p = line_end;
+        final_break = p < end;
+        if (p < end) next_line();
+    }
+
+    if (chomping == clip && final_break) value += '\n';
+    if (chomping == keep) value.append((final_break ? 1 : 0) + empty_lines, '\n');
+
+    append_json_string(out, value);
+    return true;
+}
+
+bool yaml_json_converter::parse_scalar(int parent_indent)
+{
+    const char c = *p;
+
+    if (c == '"' || c == '\'')
+    {
+        std::string value;
+        if (!parse_quoted(value)) return false;
+        if (!at_line_end()) return false;
+
+        append_json_string(out, value);
+        return true;
+    }
+
+    if (is_flow_indicator(c) || c == '#') return false;
+
+    std::string value;
+    if (!read_plain_line(value)) return false;
+
+    //Plain scalars carry on over lines indented past their parent, folding the breaks
+    while (true)
+    {
+        const char* saved = p;
+        const char* saved_line = line_start;
+
+        skip_blanks();
+        if (p >= end || *p != '\n') break;
+
+        int breaks = 0;
+        while (p < end && *p == '\n')
+        {
+            next_line();
+            ++breaks;
+            skip_blanks();
+        }
+
+        if (p >= end || *p == '#' || at_document_marker() || column() <= parent_indent)
+        {
+            p = saved;
+            line_start = saved_line;
+            break;
+        }
+
+        if (breaks == 1) value += ' ';
+        else value.append(breaks - 1, '\n');
+
+        if (!read_plain_line(value)) return false;
+    }
+
+    return emit_plain(value);
+}
+
+bool yaml_json_converter::is_mapping_key_line() const
+{
+    const char* q = p;
+
+    if (*q == '"' || *q == '\'')
+    {
+        const char quote = *q++;
+        while (true)
+        {
+            if (q >= end || *q == '\n') return false;
+            if (quote == '"' && *q == '\\')
+            {
+                q += 2;
+                continue;
+            }
+            if (*q == quote)
+            {
+                if (quote == '\'' && q + 1 < end && q[1] == '\'')
+                {
+                    q += 2;
+                    continue;
+                }
+                ++q;
+                break;
+            }
+            ++q;
+        }
+
+        while (q < end && is_blank(*q)) ++q;
+        return q < end && *q == ':' && blank_or_break_at(q + 1);
+    }
+
+    for (; q < end && *q != '\n'; ++q)
+    {
+        if (*q == ':' && blank_or_break_at(q + 1)) return true;
+        if (*q == '#' && q > p && is_blank(q[-1])) return false;
+    }
+
+    return false;
+}
+
+bool yaml_json_converter::parse_mapping_key(std::string& key)
+{
+    if (eof() || !is_mapping_key_line()) return false;
+
+    const char c = *p;
+    if ((c == '-' || c == '?' || c == ':') && blank_or_break_at(p + 1)) return false;
+    if (is_flow_indicator(c) || c == '#' || c == '&' || c == '*' || c == '!' || c == '|' || c == '>' ||
+        c == '%' || c == '@' || c == '`')
+    {
+        return false;
+    }
+
+    if (c == '"' || c == '\'')
+    {
+        if (!parse_quoted(key)) return false;
+        skip_blanks();
+    }
+    else
+    {
+        const char* start = p;
+        while (!(*p == ':' && blank_or_break_at(p + 1))) ++p;
+
+        const char* key_end = p;
+        while (key_end > start && is_blank(key_end[-1])) --key_end;
+        key.assign(start, key_end - start);
+
+        if (!check_plain_key(key)) return false;
+    }
+
+    //Past the :
+    ++p;
+    return true;
+}
+
+//Keys become property names. Anything that wouldn't stringify back to the same text is left to the yaml package.
+bool yaml_json_converter::check_plain_key(std::string_view text)
+{
+    double number;
+    const scalar_kind kind = resolve_plain(text, number);
+    if (kind == scalar_kind::string) return true;
+    if (kind != scalar_kind::number) return false;
+
+    //Canonical integers stringify to themselves
+    std::string_view digits = text[0] == '-' ? text.substr(1) : text;
+    if (!all_of(digits, is_digit) || (digits == "0" && text[0] == '-')) return false;
+    if (digits.size() > 1 && digits[0] == '0') return false;
+    return digits.size() <= 15;
+}
+
+bool yaml_json_converter::read_plain_line(std::string& value)
+{
+    const char* start = p;
+    while (p < end && *p != '\n')
+    {
+        //A second key on the line
+        if (*p == ':' && blank_or_break_at(p + 1)) return false;
+        if (*p == '#' && p > start && is_blank(p[-1])) break;
+        ++p;
+    }
+
+    const char* text_end = p;
+    while (text_end > start && is_blank(text_end[-1])) --text_end;
+    value.append(start, text_end - start);
+    return true;
+}
+
+bool yaml_json_converter::parse_quoted(std::string& value)
+{
+    const char quote = *p++;
+
+    while (true)
+    {
+        if (p >= end) return false;
+        const char c = *p;
+
+        if (c == quote)
+        {
+            if (quote == '\'' && p + 1 < end && p[1] == '\'')
+            {
+                value += '\'';
+                p += 2;
+                continue;
+            }
+            ++p;
+            return true;
+        }
+
+        if (quote == '"' && c == '\\')
+        {
+            ++p;
+            if (!parse_escape(value)) return false;
+            continue;
+        }
+
+        if (is_blank(c) || c == '\n')
+        {
+            //Blanks before a line break are dropped, the break folds
+            const char* start = p;
+            skip_blanks();
+            if (p < end && *p == '\n')
+            {
+                fold_quoted_breaks(value, false);
+                continue;
+            }
+            value.append(start, p - start);
+            continue;
+        }
+
+        value += c;
+        ++p;
+    }
+}
+
+bool yaml_json_converter::parse_escape(std::string& value)
+{
+    if (p >= end) return false;
+    const char c = *p++;
+
+    int hex_digits = 0;
+    switch (c)
+    {
+    case '0': value += '\0'; return true;
+    case 'a': value += '\a'; return true;
+    case 'b': value += '\b'; return true;
+    case 't': case '\t': value += '\t'; return true;
+    case 'n': value += '\n'; return true;
+    case 'v': value += '\v'; return true;
+    case 'f': value += '\f'; return true;
+    case 'r': value += '\r'; return true;
+    case 'e': value += '\x1B'; return true;
+    case ' ': value += ' '; return true;
+    case '"': value += '"'; return true;
+    case '/': value += '/'; return true;
+    case '\\': value += '\\'; return true;
+    case 'N': append_utf8(value, 0x85); return true;
+    case '_': append_utf8(value, 0xA0); return true;
+    case 'L': append_utf8(value, 0x2028); return true;
+    case 'P': append_utf8(value, 0x2029); return true;
+    case 'x': hex_digits = 2; break;
+    case 'u': hex_digits = 4; break;
+    case 'U': hex_digits = 8; break;
+    case '\n':
+        --p;
+        fold_quoted_breaks(value, true);
+        return true;
+    default:
+        return false;
+    }
+
+    if (end - p < hex_digits) return false;
+
+    uint32_t code_point = 0;
+    for (int i = 0; i < hex_digits; ++i)
+    {
+        if (!is_hex(p[i])) return false;
+        code_point = code_point * 16 + hex_value(p[i]);
+    }
+    p += hex_digits;
+
+    //JSON style escaped pairs, the yaml package joins them too
+    if (hex_digits == 4 && code_point >= 0xD800 && code_point <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u')
+    {
+        uint32_t low = 0;
+        for (int i = 2; i < 6; ++i)
+        {
+            if (!is_hex(p[i])) return false;
+            low = low * 16 + hex_value(p[i]);
+        }
+
+        if (low >= 0xDC00 && low <= 0xDFFF)
+        {
+            code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+            p += 6;
+        }
+    }
+
+    //Lone surrogate halves can't go through UTF-8
+    if (code_point > 0x10FFFF || (code_point >= 0xD800 && code_point <= 0xDFFF)) return false;
+    append_utf8(value, code_point);
+    return true;
+}
+
+//At a line break inside a quoted scalar. One break is a space, each empty line after it a newline, and an escaped
+//break joins the lines with nothing at all.
+void yaml_json_converter::fold_quoted_breaks(std::string& value, bool escaped)
+{
+    int breaks = 0;
+    while (p < end && *p == '\n')
+    {
+        next_line();
+        ++breaks;
+        skip_blanks();
+    }
+
+    if (escaped) value.append(breaks - 1, '\n');
+    else if (breaks == 1) value += ' ';
+    else value.append(breaks - 1, '\n');
+}
+
+bool yaml_json_converter::skip_flow_space()
+{
+    while (p < end)
+    {
+        if (is_blank(*p))
+        {
+            ++p;
+        }
+        else if (*p == '\n')
+        {
+            next_line();
+        }
+        else if (*p == '#' && (p == line_start || is_blank(p[-1])))
+        {
+            skip_line();
+        }
+        else
+        {
+            return true;
+        }
+    }
+    return true;
+}
+
+bool yaml_json_converter::parse_flow_node()
+{
+    depth_guard guard(depth);
+    if (depth > max_depth) return false;
+
+    if (!skip_flow_space() || eof()) return false;
+
+    const char c = *p;
+    if (c == '[') return parse_flow_sequence();
+    if (c == '{') return parse_flow_mapping();
+
+    if (c == '"' || c == '\'')
+    {
+        std::string value;
+        if (!parse_quoted(value)) return false;
+        append_json_string(out, value);
+        return true;
+    }
+
+    if (c == '&' || c == '*' || c == '!' || c == '?' || c == '%' || c == '@' || c == '`' || c == '#' || c == '|' ||
+        c == '>' || is_flow_indicator(c))
+    {
+        return false;
+    }
+
+    std::string value;
+    if (!read_flow_plain(value)) return false;
+    return emit_plain(value);
+}
+
+bool yaml_json_converter::parse_flow_sequence()
+{
+    ++p;
+    out += '[';
+
+    bool first = true;
+    while (true)
+    {
+        if (!skip_flow_space() || eof()) return false;
+        if (*p == ']') break;
+
+        if (!first) out += ',';
+        first = false;
+
+        if (!parse_flow_node()) return false;
+
+        if (!skip_flow_space() || eof()) return false;
+        if (*p == ',')
+        {
+            ++p;
+            continue;
+        }
+        //Including implicit single pair mappings, [a: b]
+        if (*p != ']') return false;
+    }
+
+    ++p;
+    out += ']';
+    return true;
+}
+
+bool yaml_json_converter::parse_flow_mapping()
+{
+    ++p;
+    out += '{';
+
+    std::unordered_set<std::string> keys;
+    bool first = true;
+    while (true)
+    {
+        if (!skip_flow_space() || eof()) return false;
+        if (*p == '}') break;
+
+        std::string key;
+        if (*p == '"' || *p == '\'')
+        {
+            if (!parse_quoted(key)) return false;
+        }
+        else
+        {
+            if (*p == '?' || *p == '[' || *p == '{' || *p == '&' || *p == '*' || *p == '!') return false;
+            if (!read_flow_plain(key) || !check_plain_key(key)) return false;
+        }
+        if (!keys.insert(key).second) return false;
+
+        if (!first) out += ',';
+        first = false;
+
+        append_json_string(out, key);
+        out += ':';
+
+        if (!skip_flow_space() || eof() || *p != ':') return false;
+        ++p;
+
+        if (!skip_flow_space() || eof()) return false;
+        if (*p == ',' || *p == '}')
+        {
+            out += "null";
+        }
+        else if (!parse_flow_node())
+        {
+            return false;
+        }
+
+        if (!skip_flow_space() || eof()) return false;
+        if (*p == ',')
+        {
+            ++p;
+            continue;
+        }
+        if (*p != '}') return false;
+    }
+
+    ++p;
+    out += '}';
+    return true;
+}
+
+//Plain scalars inside flow collections, kept to one line
+bool yaml_json_converter::read_flow_plain(std::string& value)
+{
+    const char* start = p;
+    while (p < end && *p != '\n' && !is_flow_indicator(*p))
+    {
+        if (*p == ':' && (blank_or_break_at(p + 1) || (p + 1 < end && is_flow_indicator(p[1])))) break;
+        if (*p == '#' && p > start && is_blank(p[-1])) break;
+        ++p;
+    }
+
+    const char* text_end = p;
+    while (text_end > start && is_blank(text_end[-1])) --text_end;
+    if (text_end == start) return false;
+
+    value.assign(start, text_end - start);
+    return true;
+}
+
+bool yaml_json_converter::emit_plain(std::string_view text)
+{
+    double number = 0;
+    switch (resolve_plain(text, number))
+    {
+    case scalar_kind::null:
+        out += "null";
+        return true;
+    case scalar_kind::boolean:
+        out += text[0] == 't' || text[0] == 'T' ? "true" : "false";
+        return true;
+    case scalar_kind::number:
+        if (!std::isfinite(number)) return false;
+        append_number(out, number);
+        return true;
+    case scalar_kind::unrepresentable:
+        return false;
+    default:
+        append_json_string(out, text);
+        return true;
+    }
+}
+
+bool yaml_to_json(std::string_view yaml, std::string& json)
+{
+    json.clear();
+    json.reserve(yaml.size() + yaml.size() / 4);
+
+    //Every line break becomes \n up front so nothing else has to care about \r
+    std::string normalized;
+    if (memchr(yaml.data(), '\r', yaml.size()))
+    {
+        normalized.reserve(yaml.size());
+        for (size_t i = 0; i < yaml.size(); ++i)
+        {
+            if (yaml[i] == '\r')
+            {
+                normalized += '\n';
+                if (i + 1 < yaml.size() && yaml[i + 1] == '\n') ++i;
+            }
+            else
+            {
+                normalized += yaml[i];
+            }
+        }
+        yaml = normalized;
+    }
+
+    yaml_json_converter converter(yaml, json);
+    if (!converter.convert())
+    {
+        json.clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+declare namespace CastmateMediaNative {
+	interface MediaFileInfo {
+		/** The scanned folder this file was found in, empty for probeFile */
+		root: string
+		file: string
+		/** False when the headers weren't in a format the indexer parses, fall back to ffprobe */
+		handled: boolean
+		image: boolean
+		audio: boolean
+		video: boolean
+		/** Seconds */
+		duration?: number
+		width?: number
+		height?: number
+		/** Answered from the persistent index without touching the file */
+		cached: boolean
+	}
+
+	interface MediaScanOptions {
+		/** Defaults to the number of cores */
+		threads?: number
+		/** Files per onBatch call, defaults to 128 */
+		batchSize?: number
+	}
+
+	interface MediaScanStats {
+		files: number
+		cached: number
+		probed: number
+		elapsedMs: number
+		/** Set when the index couldn't be written back, the scan's results are still complete */
+		indexError?: string
+	}
+
+	class MediaIndexer {
+		/** The index is keyed by path, size and mtime, unchanged files are answered from it on the next scan */
+		constructor(indexPath: string)
+
+		/** Walks the folders on a worker pool, resolves once every batch has been delivered and the index is saved */
+		scan(roots: string[], options: MediaScanOptions | undefined, onBatch: (files: MediaFileInfo[]) => any): Promise<MediaScanStats>
+		cancel(): void
+
+		probeFile(path: string): MediaFileInfo | undefined
+		/** Stores the result of a fallback probe in the index */
+		remember(path: string, info: Pick<MediaFileInfo, "image" | "audio" | "video" | "duration" | "width" | "height">): void
+		/** @returns false if the index couldn't be written */
+		save(): boolean
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateMediaNative
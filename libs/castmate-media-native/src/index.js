@@ -0,0 +1,52 @@
+const bindings = require("bindings")
+
+const native = bindings({
+	bindings: "castmate-media-native",
+})
+
+class MediaIndexer {
+	constructor(indexPath) {
+		this._native = new native.NativeMediaIndexer(indexPath)
+	}
+
+	scan(roots, options, onBatch) {
+		return new Promise((resolve, reject) => {
+			try {
+				this._native.scan(roots, options ?? {}, (event, payload) => {
+					if (event == "batch") {
+						onBatch(payload)
+					} else if (event == "done") {
+						resolve(payload)
+					}
+				})
+			} catch (err) {
+				reject(err)
+			}
+		})
+	}
+
+	cancel() {
+		return this._native.cancel()
+	}
+
+	probeFile(path) {
+		return this._native.probeFile(path)
+	}
+
+	remember(path, info) {
+		return this._native.remember(path, info)
+	}
+
+	save() {
+		return this._native.save()
+	}
+}
+
+module.exports = {
+	MediaIndexer,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,219 @@
+#include "media-index.hh"
+
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+
+static const char media_index_magic[4] = { 'C', 'M', 'M', 'I' };
+static const uint8_t media_index_version = 1;
+
+//size + mtime + flags + duration + width + height
+static const size_t entry_fixed_size = 8 + 8 + 1 + 8 + 4 + 4;
+
+enum media_index_flags : uint8_t
+{
+    flag_handled = 1 << 0,
+    flag_image = 1 << 1,
+    flag_audio = 1 << 2,
+    flag_video = 1 << 3,
+};
+
+template<typename T>
+static T read_value(const uint8_t* data)
+{
+    T value;
+    memcpy(&value, data, sizeof(T));
+    return value;
+}
+
+template<typename T>
+static void write_value(std::vector<uint8_t>& buffer, T value)
+{
+    const size_t offset = buffer.size();
+    buffer.resize(offset + sizeof(T));
+    memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+media_index::~media_index()
+{
+    close();
+}
+
+bool media_index::open(const std::string& path)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileW(std::filesystem::u8path(path).c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+    size = size_t(file_size.QuadPart);
+
+    HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        close();
+        return false;
+    }
+    mapping_handle = mapping;
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = size_t(file_stat.st_size);
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped != MAP_FAILED)
+    {
+        data = static_cast<const uint8_t*>(mapped);
+    }
+#endif
+
+    if (!data)
+    {
+        close();
+        return false;
+    }
+
+    if (size < sizeof(media_index_magic) + 5 || memcmp(data, media_index_magic, sizeof(media_index_magic)) != 0 ||
+        data[sizeof(media_index_magic)] != media_index_version)
+    {
+        close();
+        return false;
+    }
+
+    const uint8_t* cursor = data + sizeof(media_index_magic) + 1;
+    const uint8_t* end = data + size;
+    const uint32_t count = read_value<uint32_t>(cursor);
+    cursor += 4;
+
+    entries.reserve(count);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (cursor + 2 > end) break;
+        const uint16_t path_length = read_value<uint16_t>(cursor);
+        cursor += 2;
+
+        if (cursor + path_length + entry_fixed_size > end) break;
+        entries.emplace(std::string_view(reinterpret_cast<const char*>(cursor), path_length), cursor + path_length);
+        cursor += path_length + entry_fixed_size;
+    }
+
+    return true;
+}
+
+void media_index::close()
+{
+    entries.clear();
+
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+}
+
+bool media_index::lookup(const std::string& file, uint64_t file_size, int64_t mtime, media_info& info) const
+{
+    auto entry = entries.find(std::string_view(file));
+    if (entry == entries.end()) return false;
+
+    const uint8_t* fixed = entry->second;
+    if (read_value<uint64_t>(fixed) != file_size || read_value<int64_t>(fixed + 8) != mtime) return false;
+
+    const uint8_t flags = fixed[16];
+    info.handled = flags & flag_handled;
+    info.image = flags & flag_image;
+    info.audio = flags & flag_audio;
+    info.video = flags & flag_video;
+    info.duration = read_value<double>(fixed + 17);
+    info.width = read_value<uint32_t>(fixed + 25);
+    info.height = read_value<uint32_t>(fixed + 29);
+    return true;
+}
+
+bool media_index::write(const std::string& path, const std::unordered_map<std::string, media_index_entry>& index_entries)
+{
+    std::vector<uint8_t> buffer;
+    buffer.reserve(16 + index_entries.size() * (64 + entry_fixed_size));
+
+    buffer.insert(buffer.end(), media_index_magic, media_index_magic + sizeof(media_index_magic));
+    buffer.push_back(media_index_version);
+    write_value<uint32_t>(buffer, 0);
+
+    uint32_t count = 0;
+    for (const auto& entry : index_entries)
+    {
+        if (entry.first.size() > 0xFFFF) continue;
+
+        const media_info& info = entry.second.info;
+        uint8_t flags = 0;
+        if (info.handled) flags |= flag_handled;
+        if (info.image) flags |= flag_image;
+        if (info.audio) flags |= flag_audio;
+        if (info.video) flags |= flag_video;
+
+        write_value<uint16_t>(buffer, uint16_t(entry.first.size()));
+        buffer.insert(buffer.end(), entry.first.begin(), entry.first.end());
+        write_value<uint64_t>(buffer, entry.second.size);
+        write_value<int64_t>(buffer, entry.second.mtime);
+        buffer.push_back(flags);
+        write_value<double>(buffer, info.duration);
+        write_value<uint32_t>(buffer, info.width);
+        write_value<uint32_t>(buffer, info.height);
+        ++count;
+    }
+    memcpy(buffer.data() + sizeof(media_index_magic) + 1, &count, sizeof(count));
+
+    //Write next to the old index and swap it in so a crash never leaves half an index behind.
+    const std::filesystem::path target = std::filesystem::u8path(path);
+    std::filesystem::path temp = target;
+    temp += ".tmp";
+
+#ifdef _WIN32
+    FILE* file = _wfopen(temp.c_str(), L"wb");
+#else
+    FILE* file = fopen(temp.c_str(), "wb");
+#endif
+    if (!file) return false;
+
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    fclose(file);
+    if (!written) return false;
+
+    std::error_code error;
+    std::filesystem::rename(temp, target, error);
+    return !error;
+}
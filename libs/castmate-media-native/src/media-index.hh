@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+
+#include "media-probe.hh"
+
+struct media_index_entry
+{
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    media_info info;
+};
+
+//Persistent cache of probe results keyed by path, size and mtime. The file is memory mapped and only the
+//lookup table is built on open, entries are decoded when they're hit.
+//
+//Layout: "CMMI", version byte, u32 count, then per entry
+//  u16 path length, path bytes, u64 size, i64 mtime, u8 flags, f64 duration, u32 width, u32 height
+class media_index
+{
+public:
+    ~media_index();
+
+    bool open(const std::string& path);
+    void close();
+
+    //Only returns entries whose size and mtime still match.
+    bool lookup(const std::string& file, uint64_t size, int64_t mtime, media_info& info) const;
+
+    static bool write(const std::string& path, const std::unordered_map<std::string, media_index_entry>& entries);
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+
+    //Points at the fixed size part of each entry, right after its path
+    std::unordered_map<std::string_view, const uint8_t*> entries;
+};
@@ -0,0 +1,325 @@
+#include "media-indexer.hh"
+
+#include <algorithm>
+#include <iterator>
+
+//In batches, which hold batchSize results each
+static const size_t scan_event_capacity = 32;
+
+Napi::Object media_indexer::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeMediaIndexer", {
+        InstanceMethod("scan", &media_indexer::scan),
+        InstanceMethod("cancel", &media_indexer::cancel),
+        InstanceMethod("probeFile", &media_indexer::probe_file),
+        InstanceMethod("remember", &media_indexer::remember),
+        InstanceMethod("save", &media_indexer::save),
+    });
+
+    exports.Set("NativeMediaIndexer", constructor);
+    return exports;
+}
+
+static Napi::Object make_js_info(Napi::Env env, const std::string& root, const std::string& file, const media_info& info, bool cached)
+{
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("root", Napi::String::New(env, root));
+    result.Set("file", Napi::String::New(env, file));
+    result.Set("handled", Napi::Boolean::New(env, info.handled));
+    result.Set("image", Napi::Boolean::New(env, info.image));
+    result.Set("audio", Napi::Boolean::New(env, info.audio));
+    result.Set("video", Napi::Boolean::New(env, info.video));
+    if (info.duration >= 0) result.Set("duration", Napi::Number::New(env, info.duration));
+    if (info.width > 0) result.Set("width", Napi::Number::New(env, info.width));
+    if (info.height > 0) result.Set("height", Napi::Number::New(env, info.height));
+    result.Set("cached", Napi::Boolean::New(env, cached));
+    return result;
+}
+
+//Compared component by component so "media" doesn't claim "media-old", and "a/./b" or mixed slashes still match
+static bool is_under_roots(const std::string& file, const std::vector<std::filesystem::path>& roots)
+{
+    const std::filesystem::path path = std::filesystem::u8path(file).lexically_normal();
+    for (const std::filesystem::path& root : roots)
+    {
+        auto root_part = root.begin();
+        auto path_part = path.begin();
+        for (; root_part != root.end() && path_part != path.end(); ++root_part, ++path_part)
+        {
+            //A trailing separator on the root normalizes to an empty last component
+            if (root_part->empty() || *root_part != *path_part) break;
+        }
+        if (root_part == root.end() || (root_part->empty() && std::next(root_part) == root.end())) return true;
+    }
+    return false;
+}
+
+static bool stat_file(const std::string& file, uint64_t& size, int64_t& mtime)
+{
+    std::error_code error;
+    std::filesystem::directory_entry entry(std::filesystem::u8path(file), error);
+    if (error || !entry.is_regular_file(error)) return false;
+
+    size = entry.file_size(error);
+    if (error) return false;
+    mtime = media_file_mtime(entry, error);
+    return !error;
+}
+
+media_indexer::media_indexer(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<media_indexer>(info)
+{
+    if (info.Length() > 0 && info[0].IsString())
+    {
+        index_path = info[0].As<Napi::String>().Utf8Value();
+    }
+}
+
+void media_indexer::Finalize(Napi::Env env)
+{
+    joining = true;
+    scanner.cancel();
+    if (scan_thread.joinable())
+    {
+        scan_thread.join();
+    }
+}
+
+//scan(roots, { threads, batchSize }, emit) emits ("batch", results[]) as files are found then ("done", stats)
+Napi::Value media_indexer::scan(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsArray() || !info[2].IsFunction())
+    {
+        Napi::Error::New(env, "scan requires an array of folders, options, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (scanning)
+    {
+        Napi::Error::New(env, "A media scan is already running.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (scan_thread.joinable())
+    {
+        //Only the last events of a finished scan can be left, nobody waited for them if they're still queued
+        joining = true;
+        scan_thread.join();
+        joining = false;
+    }
+
+    media_scan_options options;
+
+    Napi::Array roots = info[0].As<Napi::Array>();
+    for (uint32_t i = 0; i < roots.Length(); ++i)
+    {
+        Napi::Value root = roots.Get(i);
+        if (root.IsString()) options.roots.push_back(root.As<Napi::String>().Utf8Value());
+    }
+
+    if (info[1].IsObject())
+    {
+        Napi::Object config = info[1].As<Napi::Object>();
+        if (config.Get("threads").IsNumber()) options.threads = config.Get("threads").As<Napi::Number>().Uint32Value();
+        if (config.Get("batchSize").IsNumber()) options.batch_size = std::max(1u, config.Get("batchSize").As<Napi::Number>().Uint32Value());
+    }
+
+    events.open(env, info[2].As<Napi::Function>(), "MediaIndexerTSFN", scan_event_capacity);
+    scanner.reset_cancel();
+
+    {
+        std::lock_guard<std::mutex> lock(known_mutex);
+        stored_during_scan.clear();
+    }
+
+    scanning = true;
+    scan_thread = std::thread(&media_indexer::scan_thread_main, this, std::move(options));
+    return env.Undefined();
+}
+
+void media_indexer::scan_thread_main(media_scan_options options)
+{
+    media_index index;
+    if (!index_path.empty())
+    {
+        index.open(index_path);
+    }
+
+    std::unordered_map<std::string, media_index_entry> seen;
+
+    const auto stop_waiting = [this] { return joining.load(); };
+
+    media_scan_stats stats = scanner.run(options, index, [this, &seen, &stop_waiting](std::vector<media_scan_result>&& batch) {
+        for (const auto& result : batch)
+        {
+            seen[result.file] = { result.size, result.mtime, result.info };
+        }
+
+        auto js_thread_callback = [data = std::move(batch)](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            Napi::Array results = Napi::Array::New(env, data.size());
+            for (uint32_t i = 0; i < data.size(); ++i)
+            {
+                const media_scan_result& result = data[i];
+                results.Set(i, make_js_info(env, result.root, result.file, result.info, result.cached));
+            }
+
+            js_callback.Call({ Napi::String::New(env, "batch"), results });
+        };
+
+        events.post_wait(js_thread_callback, stop_waiting);
+    });
+
+    //The map has to go before the file can be replaced on Windows.
+    index.close();
+
+    //Deleted files drop out of the index here, but only from the folders this scan walked
+    std::vector<std::filesystem::path> scanned_roots;
+    for (const std::string& root : options.roots)
+    {
+        scanned_roots.push_back(std::filesystem::u8path(root).lexically_normal());
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(known_mutex);
+
+        //A cancelled walk didn't reach everything, so nothing it missed can be called deleted
+        if (!stats.cancelled)
+        {
+            for (auto entry = known.begin(); entry != known.end();)
+            {
+                const bool missing = seen.find(entry->first) == seen.end()
+                    && stored_during_scan.find(entry->first) == stored_during_scan.end()
+                    && is_under_roots(entry->first, scanned_roots);
+                entry = missing ? known.erase(entry) : std::next(entry);
+            }
+        }
+
+        for (auto& entry : seen)
+        {
+            if (stored_during_scan.find(entry.first) != stored_during_scan.end()) continue;
+            known[entry.first] = std::move(entry.second);
+        }
+        stored_during_scan.clear();
+    }
+
+    //The scan's results are still good without the index, JS is told so it can log why the next start is slow
+    std::string index_error;
+    if (!index_path.empty() && !save_index())
+    {
+        index_error = "Unable to write media index " + index_path;
+    }
+
+    scanning = false;
+
+    auto js_thread_callback = [stats, index_error](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        Napi::Object js_stats = Napi::Object::New(env);
+        js_stats.Set("files", Napi::Number::New(env, stats.files));
+        js_stats.Set("cached", Napi::Number::New(env, stats.cached));
+        js_stats.Set("probed", Napi::Number::New(env, stats.probed));
+        js_stats.Set("elapsedMs", Napi::Number::New(env, stats.elapsed_ms));
+        if (!index_error.empty()) js_stats.Set("indexError", Napi::String::New(env, index_error));
+
+        js_callback.Call({ Napi::String::New(env, "done"), js_stats });
+    };
+
+    events.post_wait(js_thread_callback, stop_waiting);
+    //Nothing else posts until the next scan joins this thread and opens it again
+    events.close();
+}
+
+Napi::Value media_indexer::cancel(const Napi::CallbackInfo& info)
+{
+    scanner.cancel();
+    return info.Env().Undefined();
+}
+
+//probeFile(path) for files that change after the scan, answered from the index when nothing changed.
+Napi::Value media_indexer::probe_file(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "probeFile requires a path.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::string file = info[0].As<Napi::String>().Utf8Value();
+
+    media_index_entry entry;
+    if (!stat_file(file, entry.size, entry.mtime)) return env.Undefined();
+
+    {
+        std::lock_guard<std::mutex> lock(known_mutex);
+        auto existing = known.find(file);
+        if (existing != known.end() && existing->second.size == entry.size && existing->second.mtime == entry.mtime)
+        {
+            return make_js_info(env, "", file, existing->second.info, true);
+        }
+    }
+
+    entry.info = probe_media_file(std::filesystem::u8path(file));
+
+    {
+        std::lock_guard<std::mutex> lock(known_mutex);
+        known[file] = entry;
+        if (scanning) stored_during_scan.insert(file);
+    }
+
+    return make_js_info(env, "", file, entry.info, false);
+}
+
+//remember(path, info) stores what a fallback probe found so the next start doesn't have to redo it.
+Napi::Value media_indexer::remember(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsObject())
+    {
+        Napi::Error::New(env, "remember requires a path and media info.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::string file = info[0].As<Napi::String>().Utf8Value();
+    Napi::Object js_info = info[1].As<Napi::Object>();
+
+    media_index_entry entry;
+    if (!stat_file(file, entry.size, entry.mtime)) return env.Undefined();
+
+    entry.info.handled = true;
+    entry.info.image = js_info.Get("image").ToBoolean().Value();
+    entry.info.audio = js_info.Get("audio").ToBoolean().Value();
+    entry.info.video = js_info.Get("video").ToBoolean().Value();
+    if (js_info.Get("duration").IsNumber()) entry.info.duration = js_info.Get("duration").As<Napi::Number>().DoubleValue();
+    if (js_info.Get("width").IsNumber()) entry.info.width = js_info.Get("width").As<Napi::Number>().Uint32Value();
+    if (js_info.Get("height").IsNumber()) entry.info.height = js_info.Get("height").As<Napi::Number>().Uint32Value();
+
+    std::lock_guard<std::mutex> lock(known_mutex);
+    known[file] = entry;
+    if (scanning) stored_during_scan.insert(file);
+    return env.Undefined();
+}
+
+Napi::Value media_indexer::save(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (index_path.empty()) return Napi::Boolean::New(env, false);
+    return Napi::Boolean::New(env, save_index());
+}
+
+bool media_indexer::save_index()
+{
+    std::lock_guard<std::mutex> lock(known_mutex);
+    return media_index::write(index_path, known);
+}
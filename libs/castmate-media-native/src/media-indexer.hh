@@ -0,0 +1,50 @@
+#pragma once
+
+#include <napi.h>
+
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "castmate-native/event-dispatcher.hh"
+
+#include "media-index.hh"
+#include "media-scanner.hh"
+
+class media_indexer : public Napi::ObjectWrap<media_indexer>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    media_indexer(const Napi::CallbackInfo& info);
+    virtual void Finalize(Napi::Env env);
+
+    Napi::Value scan(const Napi::CallbackInfo& info);
+    Napi::Value cancel(const Napi::CallbackInfo& info);
+    Napi::Value probe_file(const Napi::CallbackInfo& info);
+    Napi::Value remember(const Napi::CallbackInfo& info);
+    Napi::Value save(const Napi::CallbackInfo& info);
+
+private:
+    void scan_thread_main(media_scan_options options);
+    bool save_index();
+
+    std::string index_path;
+
+    std::thread scan_thread;
+    std::atomic<bool> scanning { false };
+    //Opened per scan with its callback. Batches can't be dropped, the scan waits on JS instead.
+    js_call_dispatcher events;
+    //Set while the JS thread joins the scan thread, which mustn't wait on JS then
+    std::atomic<bool> joining { false };
+    media_scanner scanner;
+
+    //Everything seen by the last scan plus later probes, written back as the next index.
+    std::mutex known_mutex;
+    std::unordered_map<std::string, media_index_entry> known;
+    //Files probeFile or remember stored while a scan was running, newer than anything the scan found for them
+    std::unordered_set<std::string> stored_during_scan;
+};
@@ -0,0 +1,790 @@
+#include "media-probe.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+//Most containers keep what we need up front, only MP4 can push it further than this.
+static const size_t header_read_size = 64 * 1024;
+static const uint64_t max_atom_read_size = 64ull * 1024 * 1024;
+
+class media_reader
+{
+public:
+    explicit media_reader(const std::filesystem::path& path)
+        : stream(path, std::ios::binary)
+    {
+        if (stream)
+        {
+            stream.seekg(0, std::ios::end);
+            file_size = uint64_t(stream.tellg());
+            stream.seekg(0, std::ios::beg);
+        }
+    }
+
+    bool is_open() const { return bool(stream); }
+    uint64_t size() const { return file_size; }
+
+    //Reads up to count bytes at offset, returns how many were read
+    size_t read(uint64_t offset, void* buffer, size_t count)
+    {
+        if (offset >= file_size) return 0;
+        count = size_t(std::min<uint64_t>(count, file_size - offset));
+
+        stream.clear();
+        stream.seekg(std::streamoff(offset));
+        stream.read(static_cast<char*>(buffer), std::streamsize(count));
+        return size_t(stream.gcount());
+    }
+
+    bool read_exact(uint64_t offset, void* buffer, size_t count)
+    {
+        return read(offset, buffer, count) == count;
+    }
+
+    std::vector<uint8_t> read_block(uint64_t offset, size_t count)
+    {
+        std::vector<uint8_t> result(count);
+        result.resize(read(offset, result.data(), count));
+        return result;
+    }
+
+private:
+    std::ifstream stream;
+    uint64_t file_size = 0;
+};
+
+static uint16_t be16(const uint8_t* p) { return uint16_t((p[0] << 8) | p[1]); }
+static uint32_t be32(const uint8_t* p) { return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]; }
+static uint64_t be64(const uint8_t* p) { return (uint64_t(be32(p)) << 32) | be32(p + 4); }
+static uint16_t le16(const uint8_t* p) { return uint16_t(p[0] | (p[1] << 8)); }
+static uint32_t le24(const uint8_t* p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16); }
+static uint32_t le32(const uint8_t* p) { return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24); }
+static uint64_t le64(const uint8_t* p) { return uint64_t(le32(p)) | (uint64_t(le32(p + 4)) << 32); }
+
+static bool starts_with(const std::vector<uint8_t>& data, size_t offset, const char* text)
+{
+    const size_t length = strlen(text);
+    return data.size() >= offset + length && memcmp(data.data() + offset, text, length) == 0;
+}
+
+///////////////////////////////IMAGES///////////////////////////////
+
+static media_info probe_png(media_reader& reader, const std::vector<uint8_t>& head)
+{
+    media_info info;
+    if (head.size() < 24 || !starts_with(head, 12, "IHDR")) return info;
+
+    info.handled = true;
+    info.image = true;
+    info.width = be32(head.data() + 16);
+    info.height = be32(head.data() + 20);
+
+    //APNG keeps its frame delays in fcTL chunks, walk the chunk headers to add them up.
+    uint64_t offset = 8;
+    bool animated = false;
+    double duration = 0;
+    uint8_t chunk[8];
+    while (reader.read_exact(offset, chunk, sizeof(chunk)))
+    {
+        const uint32_t length = be32(chunk);
+        if (memcmp(chunk + 4, "acTL", 4) == 0)
+        {
+            animated = true;
+        }
+        else if (memcmp(chunk + 4, "fcTL", 4) == 0)
+        {
+            uint8_t delay[4];
+            if (reader.read_exact(offset + 8 + 20, delay, sizeof(delay)))
+            {
+                const uint16_t numerator = be16(delay);
+                const uint16_t denominator = be16(delay + 2);
+                duration += double(numerator) / (denominator == 0 ? 100 : denominator);
+            }
+        }
+        else if (memcmp(chunk + 4, "IDAT", 4) == 0 && !animated)
+        {
+            break;
+        }
+        else if (memcmp(chunk + 4, "IEND", 4) == 0)
+        {
+            break;
+        }
+        offset += uint64_t(length) + 12;
+    }
+
+    if (animated && duration > 0)
+    {
+        info.duration = duration;
+    }
+    return info;
+}
+
+static media_info probe_jpeg(media_reader& reader)
+{
+    media_info info;
+    info.handled = true;
+    info.image = true;
+
+    uint64_t offset = 2;
+    uint8_t marker[9];
+    while (reader.read_exact(offset, marker, 4))
+    {
+        if (marker[0] != 0xFF) break;
+
+        const uint8_t type = marker[1];
+        //Padding
+        if (type == 0xFF)
+        {
+            ++offset;
+            continue;
+        }
+
+        const uint16_t length = be16(marker + 2);
+        const bool start_of_frame = type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC;
+        if (start_of_frame)
+        {
+            if (reader.read_exact(offset, marker, sizeof(marker)))
+            {
+                info.height = be16(marker + 5);
+                info.width = be16(marker + 7);
+            }
+            break;
+        }
+        //Start of scan, the headers are over
+        if (type == 0xDA) break;
+
+        offset += 2 + length;
+    }
+    return info;
+}
+
+static bool skip_gif_sub_blocks(media_reader& reader, uint64_t& offset)
+{
+    uint8_t size;
+    while (reader.read_exact(offset, &size, 1))
+    {
+        offset += 1 + size;
+        if (size == 0) return true;
+    }
+    return false;
+}
+
+static media_info probe_gif(media_reader& reader, const std::vector<uint8_t>& head)
+{
+    media_info info;
+    if (head.size() < 13) return info;
+
+    info.handled = true;
+    info.width = le16(head.data() + 6);
+    info.height = le16(head.data() + 8);
+
+    uint64_t offset = 13;
+    const uint8_t packed = head[10];
+    if (packed & 0x80)
+    {
+        offset += 3ull << ((packed & 0x07) + 1);
+    }
+
+    uint32_t frames = 0;
+    uint32_t delay_centiseconds = 0;
+    uint8_t block[10];
+    while (reader.read_exact(offset, block, 1))
+    {
+        if (block[0] == 0x21)
+        {
+            if (!reader.read_exact(offset, block, 8)) break;
+            //Graphic control extension holds the frame delay
+            if (block[1] == 0xF9)
+            {
+                delay_centiseconds += le16(block + 4);
+            }
+            offset += 2;
+            if (!skip_gif_sub_blocks(reader, offset)) break;
+        }
+        else if (block[0] == 0x2C)
+        {
+            if (!reader.read_exact(offset, block, 10)) break;
+            ++frames;
+            offset += 10;
+            if (block[9] & 0x80)
+            {
+                offset += 3ull << ((block[9] & 0x07) + 1);
+            }
+            //LZW minimum code size
+            offset += 1;
+            if (!skip_gif_sub_blocks(reader, offset)) break;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (frames > 1)
+    {
+        info.video = true;
+        info.duration = delay_centiseconds / 100.0;
+    }
+    else
+    {
+        info.image = true;
+    }
+    return info;
+}
+
+static media_info probe_bmp(const std::vector<uint8_t>& head)
+{
+    media_info info;
+    if (head.size() < 26) return info;
+
+    info.handled = true;
+    info.image = true;
+    info.width = uint32_t(std::abs(int32_t(le32(head.data() + 18))));
+    info.height = uint32_t(std::abs(int32_t(le32(head.data() + 22))));
+    return info;
+}
+
+static media_info probe_webp(media_reader& reader, const std::vector<uint8_t>& head)
+{
+    media_info info;
+    if (head.size() < 30) return info;
+
+    info.handled = true;
+
+    if (starts_with(head, 12, "VP8 "))
+    {
+        info.width = le16(head.data() + 26) & 0x3FFF;
+        info.height = le16(head.data() + 28) & 0x3FFF;
+    }
+    else if (starts_with(head, 12, "VP8L"))
+    {
+        const uint8_t* bits = head.data() + 21;
+        info.width = 1 + (uint32_t(bits[0]) | (uint32_t(bits[1] & 0x3F) << 8));
+        info.height = 1 + ((uint32_t(bits[1]) >> 6) | (uint32_t(bits[2]) << 2) | (uint32_t(bits[3] & 0x0F) << 10));
+    }
+    else if (starts_with(head, 12, "VP8X"))
+    {
+        const bool animated = head[20] & 0x02;
+        info.width = 1 + le24(head.data() + 24);
+        info.height = 1 + le24(head.data() + 27);
+
+        if (animated)
+        {
+            //Sum the ANMF frame durations
+            uint64_t offset = 12;
+            double duration = 0;
+            uint8_t chunk[24];
+            while (reader.read_exact(offset, chunk, 8))
+            {
+                const uint32_t length = le32(chunk + 4);
+                if (memcmp(chunk, "ANMF", 4) == 0 && reader.read_exact(offset, chunk, sizeof(chunk)))
+                {
+                    duration += le24(chunk + 8 + 12) / 1000.0;
+                }
+                offset += 8 + length + (length & 1);
+            }
+
+            info.video = true;
+            info.duration = duration;
+            return info;
+        }
+    }
+    else
+    {
+        info.handled = false;
+        return info;
+    }
+
+    info.image = true;
+    return info;
+}
+
+///////////////////////////////AUDIO///////////////////////////////
+
+static media_info probe_wav(media_reader& reader)
+{
+    media_info info;
+
+    uint64_t offset = 12;
+    uint32_t byte_rate = 0;
+    uint8_t chunk[16];
+    while (reader.read_exact(offset, chunk, 8))
+    {
+        const uint32_t length = le32(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0 && reader.read_exact(offset + 8, chunk, sizeof(chunk)))
+        {
+            byte_rate = le32(chunk + 8);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (byte_rate == 0) break;
+
+            //Streams that were never finalized report a bogus length
+            const uint64_t data_size = std::min<uint64_t>(length, reader.size() - offset - 8);
+            info.handled = true;
+            info.audio = true;
+            info.duration = double(data_size) / byte_rate;
+            break;
+        }
+        offset += 8 + length + (length & 1);
+    }
+    return info;
+}
+
+static media_info probe_mp3(media_reader& reader, const std::vector<uint8_t>& head)
+{
+    static const uint16_t bitrates_v1_l3[16] = { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0 };
+    static const uint16_t bitrates_v2_l3[16] = { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0 };
+    static const uint32_t sample_rates[3] = { 44100, 48000, 32000 };
+
+    media_info info;
+
+    uint64_t audio_start = 0;
+    if (starts_with(head, 0, "ID3") && head.size() >= 10)
+    {
+        const uint32_t tag_size = (uint32_t(head[6] & 0x7F) << 21) | (uint32_t(head[7] & 0x7F) << 14) |
+            (uint32_t(head[8] & 0x7F) << 7) | uint32_t(head[9] & 0x7F);
+        audio_start = 10 + tag_size + ((head[5] & 0x10) ? 10 : 0);
+    }
+
+    std::vector<uint8_t> frame = reader.read_block(audio_start, header_read_size);
+    size_t sync = 0;
+    while (sync + 4 <= frame.size() && !(frame[sync] == 0xFF && (frame[sync + 1] & 0xE0) == 0xE0))
+    {
+        ++sync;
+    }
+    if (sync + 4 > frame.size()) return info;
+
+    const uint8_t* header = frame.data() + sync;
+    const uint8_t version = (header[1] >> 3) & 0x03; //3 = MPEG1, 2 = MPEG2, 0 = MPEG2.5
+    const uint8_t layer = (header[1] >> 1) & 0x03; //1 = Layer III
+    const uint8_t bitrate_index = header[2] >> 4;
+    const uint8_t rate_index = (header[2] >> 2) & 0x03;
+    const bool mono = (header[3] >> 6) == 3;
+
+    if (version == 1 || layer != 1 || rate_index == 3) return info;
+
+    uint32_t sample_rate = sample_rates[rate_index];
+    if (version == 2) sample_rate /= 2;
+    if (version == 0) sample_rate /= 4;
+
+    const uint32_t samples_per_frame = version == 3 ? 1152 : 576;
+    const uint32_t bitrate = (version == 3 ? bitrates_v1_l3 : bitrates_v2_l3)[bitrate_index] * 1000;
+
+    info.handled = true;
+    info.audio = true;
+
+    //VBR files carry a frame count in a Xing/Info or VBRI header inside the first frame
+    const size_t side_info = version == 3 ? (mono ? 17 : 32) : (mono ? 9 : 17);
+    const size_t xing = sync + 4 + side_info;
+    if (xing + 12 <= frame.size() && (starts_with(frame, xing, "Xing") || starts_with(frame, xing, "Info")))
+    {
+        const uint32_t flags = be32(frame.data() + xing + 4);
+        if (flags & 0x01)
+        {
+            info.duration = double(be32(frame.data() + xing + 8)) * samples_per_frame / sample_rate;
+            return info;
+        }
+    }
+
+    const size_t vbri = sync + 4 + 32;
+    if (vbri + 18 <= frame.size() && starts_with(frame, vbri, "VBRI"))
+    {
+        info.duration = double(be32(frame.data() + vbri + 14)) * samples_per_frame / sample_rate;
+        return info;
+    }
+
+    if (bitrate > 0)
+    {
+        info.duration = double(reader.size() - audio_start - sync) * 8 / bitrate;
+    }
+    return info;
+}
+
+static media_info probe_ogg(media_reader& reader, const std::vector<uint8_t>& head)
+{
+    media_info info;
+    if (head.size() < 28) return info;
+
+    const size_t packet = 27 + head[26];
+    uint32_t sample_rate = 0;
+    uint32_t pre_skip = 0;
+
+    if (head.size() >= packet + 16 && head[packet] == 0x01 && starts_with(head, packet + 1, "vorbis"))
+    {
+        sample_rate = le32(head.data() + packet + 12);
+    }
+    else if (head.size() >= packet + 12 && starts_with(head, packet, "OpusHead"))
+    {
+        //Opus granule positions are always at 48kHz
+        sample_rate = 48000;
+        pre_skip = le16(head.data() + packet + 10);
+    }
+    else
+    {
+        //Theora and friends need a real probe
+        return info;
+    }
+
+    if (sample_rate == 0) return info;
+
+    //The last page's granule position is the total sample count
+    const uint64_t tail_size = std::min<uint64_t>(reader.size(), header_read_size);
+    std::vector<uint8_t> tail = reader.read_block(reader.size() - tail_size, size_t(tail_size));
+    for (size_t i = tail.size() >= 14 ? tail.size() - 14 : 0; i-- > 0;)
+    {
+        if (tail[i] == 'O' && starts_with(tail, i, "OggS"))
+        {
+            const uint64_t granule = le64(tail.data() + i + 6);
+            info.handled = true;
+            info.audio = true;
+            info.duration = double(granule > pre_skip ? granule - pre_skip : 0) / sample_rate;
+            break;
+        }
+    }
+    return info;
+}
+
+///////////////////////////////MP4///////////////////////////////
+
+struct mp4_state
+{
+    double duration = -1;
+    bool audio = false;
+    bool video = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    //Per track while walking a trak
+    uint32_t track_width = 0;
+    uint32_t track_height = 0;
+    bool track_video = false;
+};
+
+static void walk_mp4_atoms(const uint8_t* data, size_t size, mp4_state& state)
+{
+    size_t offset = 0;
+    while (offset + 8 <= size)
+    {
+        uint64_t atom_size = be32(data + offset);
+        const uint8_t* type = data + offset + 4;
+        size_t header = 8;
+
+        if (atom_size == 1)
+        {
+            if (offset + 16 > size) return;
+            atom_size = be64(data + offset + 8);
+            header = 16;
+        }
+        else if (atom_size == 0)
+        {
+            atom_size = size - offset;
+        }
+
+        if (atom_size < header || atom_size > size - offset) return;
+
+        const uint8_t* body = data + offset + header;
+        const size_t body_size = size_t(atom_size - header);
+
+        if (memcmp(type, "mvhd", 4) == 0 && body_size >= 32)
+        {
+            const bool long_version = body[0] == 1;
+            const uint32_t timescale = be32(body + (long_version ? 20 : 12));
+            const uint64_t duration = long_version ? be64(body + 24) : be32(body + 16);
+            if (timescale > 0) state.duration = double(duration) / timescale;
+        }
+        else if (memcmp(type, "trak", 4) == 0)
+        {
+            state.track_width = 0;
+            state.track_height = 0;
+            state.track_video = false;
+
+            walk_mp4_atoms(body, body_size, state);
+
+            if (state.track_video && state.width == 0)
+            {
+                state.width = state.track_width;
+                state.height = state.track_height;
+            }
+        }
+        else if (memcmp(type, "tkhd", 4) == 0 && body_size >= 84)
+        {
+            //Width and height are 16.16 fixed point at the end of the track header
+            const size_t dimensions = body[0] == 1 ? 88 : 76;
+            if (body_size >= dimensions + 8)
+            {
+                state.track_width = be32(body + dimensions) >> 16;
+                state.track_height = be32(body + dimensions + 4) >> 16;
+            }
+        }
+        else if (memcmp(type, "mdia", 4) == 0)
+        {
+            walk_mp4_atoms(body, body_size, state);
+        }
+        else if (memcmp(type, "hdlr", 4) == 0 && body_size >= 12)
+        {
+            if (memcmp(body + 8, "vide", 4) == 0)
+            {
+                state.video = true;
+                state.track_video = true;
+            }
+            else if (memcmp(body + 8, "soun", 4) == 0)
+            {
+                state.audio = true;
+            }
+        }
+
+        offset += size_t(atom_size);
+    }
+}
+
+static media_info probe_mp4(media_reader& reader)
+{
+    media_info info;
+
+    //moov can be at the start or at the end of the file, only read that atom
+    uint64_t offset = 0;
+    uint8_t header[16];
+    while (reader.read_exact(offset, header, 8))
+    {
+        uint64_t atom_size = be32(header);
+        uint64_t header_size = 8;
+        if (atom_size == 1)
+        {
+            if (!reader.read_exact(offset, header, 16)) break;
+            atom_size = be64(header + 8);
+            header_size = 16;
+        }
+        else if (atom_size == 0)
+        {
+            atom_size = reader.size() - offset;
+        }
+        if (atom_size < header_size) break;
+
+        if (memcmp(header + 4, "moov", 4) == 0)
+        {
+            if (atom_size > max_atom_read_size) break;
+
+            std::vector<uint8_t> moov = reader.read_block(offset + header_size, size_t(atom_size - header_size));
+            mp4_state state;
+            walk_mp4_atoms(moov.data(), moov.size(), state);
+
+            info.handled = state.duration >= 0;
+            info.audio = state.audio;
+            info.video = state.video;
+            info.duration = state.duration;
+            info.width = state.width;
+            info.height = state.height;
+            break;
+        }
+
+        offset += atom_size;
+    }
+    return info;
+}
+
+///////////////////////////////MATROSKA///////////////////////////////
+
+static const uint32_t ebml_segment = 0x18538067;
+static const uint32_t ebml_info = 0x1549A966;
+static const uint32_t ebml_timecode_scale = 0x2AD7B1;
+static const uint32_t ebml_duration = 0x4489;
+static const uint32_t ebml_tracks = 0x1654AE6B;
+static const uint32_t ebml_track_entry = 0xAE;
+static const uint32_t ebml_track_type = 0x83;
+static const uint32_t ebml_video = 0xE0;
+static const uint32_t ebml_pixel_width = 0xB0;
+static const uint32_t ebml_pixel_height = 0xBA;
+static const uint32_t ebml_cluster = 0x1F43B675;
+
+static const uint64_t ebml_unknown_size = ~0ull;
+
+static bool read_ebml_id(const uint8_t* data, size_t size, size_t& offset, uint32_t& id)
+{
+    if (offset >= size || data[offset] == 0) return false;
+
+    size_t length = 1;
+    while (length <= 4 && !(data[offset] & (0x80 >> (length - 1)))) ++length;
+    if (length > 4 || offset + length > size) return false;
+
+    id = 0;
+    for (size_t i = 0; i < length; ++i) id = (id << 8) | data[offset + i];
+    offset += length;
+    return true;
+}
+
+static bool read_ebml_size(const uint8_t* data, size_t size, size_t& offset, uint64_t& value)
+{
+    if (offset >= size || data[offset] == 0) return false;
+
+    size_t length = 1;
+    while (length <= 8 && !(data[offset] & (0x80 >> (length - 1)))) ++length;
+    if (length > 8 || offset + length > size) return false;
+
+    value = data[offset] & (0xFF >> length);
+    bool all_ones = value == (0xFFu >> length);
+    for (size_t i = 1; i < length; ++i)
+    {
+        value = (value << 8) | data[offset + i];
+        all_ones = all_ones && data[offset + i] == 0xFF;
+    }
+    offset += length;
+    if (all_ones) value = ebml_unknown_size;
+    return true;
+}
+
+static uint64_t ebml_uint(const uint8_t* data, size_t size)
+{
+    uint64_t value = 0;
+    for (size_t i = 0; i < size && i < 8; ++i) value = (value << 8) | data[i];
+    return value;
+}
+
+static double ebml_float(const uint8_t* data, size_t size)
+{
+    if (size == 4)
+    {
+        uint32_t bits = be32(data);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    if (size == 8)
+    {
+        uint64_t bits = be64(data);
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    return 0;
+}
+
+struct matroska_state
+{
+    uint64_t timecode_scale = 1000000;
+    double duration = -1;
+    bool audio = false;
+    bool video = false;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    bool reached_clusters = false;
+};
+
+static void walk_ebml(const uint8_t* data, size_t size, matroska_state& state)
+{
+    size_t offset = 0;
+    while (offset < size && !state.reached_clusters)
+    {
+        uint32_t id;
+        uint64_t element_size;
+        if (!read_ebml_id(data, size, offset, id) || !read_ebml_size(data, size, offset, element_size)) return;
+
+        if (id == ebml_cluster)
+        {
+            state.reached_clusters = true;
+            return;
+        }
+
+        //Only the segment is allowed an unknown size, it runs to the end of what we read
+        const size_t body_size = element_size == ebml_unknown_size ? size - offset : size_t(std::min<uint64_t>(element_size, size - offset));
+        const uint8_t* body = data + offset;
+
+        switch (id)
+        {
+        case ebml_segment:
+        case ebml_info:
+        case ebml_tracks:
+        case ebml_track_entry:
+        case ebml_video:
+            walk_ebml(body, body_size, state);
+            break;
+        case ebml_timecode_scale:
+            state.timecode_scale = ebml_uint(body, body_size);
+            break;
+        case ebml_duration:
+            state.duration = ebml_float(body, body_size);
+            break;
+        case ebml_track_type:
+        {
+            const uint64_t type = ebml_uint(body, body_size);
+            if (type == 1) state.video = true;
+            if (type == 2) state.audio = true;
+            break;
+        }
+        case ebml_pixel_width:
+            if (state.width == 0) state.width = uint32_t(ebml_uint(body, body_size));
+            break;
+        case ebml_pixel_height:
+            if (state.height == 0) state.height = uint32_t(ebml_uint(body, body_size));
+            break;
+        }
+
+        offset += body_size;
+    }
+}
+
+static media_info probe_matroska(media_reader& reader)
+{
+    media_info info;
+
+    //Info and Tracks come before the first cluster in anything written by a sane muxer
+    std::vector<uint8_t> head = reader.read_block(0, 1024 * 1024);
+
+    matroska_state state;
+    walk_ebml(head.data(), head.size(), state);
+
+    //Live recordings without a duration need ffprobe to work it out
+    if (state.duration < 0) return info;
+
+    info.handled = true;
+    info.audio = state.audio;
+    info.video = state.video;
+    info.duration = state.duration * double(state.timecode_scale) / 1e9;
+    info.width = state.width;
+    info.height = state.height;
+    return info;
+}
+
+///////////////////////////////DISPATCH///////////////////////////////
+
+media_info probe_media_file(const std::filesystem::path& path)
+{
+    media_info info;
+
+    media_reader reader(path);
+    if (!reader.is_open()) return info;
+
+    std::vector<uint8_t> head = reader.read_block(0, 64);
+    if (head.size() < 4) return info;
+
+    static const uint8_t png_signature[8] = { 0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A };
+
+    if (head.size() >= 8 && memcmp(head.data(), png_signature, 8) == 0) return probe_png(reader, head);
+    if (head[0] == 0xFF && head[1] == 0xD8) return probe_jpeg(reader);
+    if (starts_with(head, 0, "GIF8")) return probe_gif(reader, head);
+    if (starts_with(head, 0, "BM")) return probe_bmp(head);
+    if (starts_with(head, 0, "RIFF") && starts_with(head, 8, "WEBP")) return probe_webp(reader, head);
+    if (starts_with(head, 0, "RIFF") && starts_with(head, 8, "WAVE")) return probe_wav(reader);
+    if (starts_with(head, 0, "OggS")) return probe_ogg(reader, reader.read_block(0, 512));
+    if (starts_with(head, 4, "ftyp") || starts_with(head, 4, "moov") || starts_with(head, 4, "free") ||
+        starts_with(head, 4, "mdat") || starts_with(head, 4, "wide"))
+    {
+        return probe_mp4(reader);
+    }
+    if (be32(head.data()) == 0x1A45DFA3) return probe_matroska(reader);
+    if (starts_with(head, 0, "ID3") || (head[0] == 0xFF && (head[1] & 0xE0) == 0xE0)) return probe_mp3(reader, head);
+
+    //SVGs are text, there's nothing to learn from the header.
+    std::string extension = path.extension().u8string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return char(tolower(c)); });
+    if (extension == ".svg")
+    {
+        info.handled = true;
+        info.image = true;
+    }
+
+    return info;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <filesystem>
+
+//What the header parsers could learn about a file without decoding it.
+struct media_info
+{
+    //False when the format isn't one we parse, the caller should fall back to ffprobe.
+    bool handled = false;
+
+    bool image = false;
+    bool audio = false;
+    bool video = false;
+
+    //Seconds, negative when unknown
+    double duration = -1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+//Reads just the headers (and for a few formats the tail) of a media file.
+//Covers PNG/APNG, JPEG, GIF, BMP, WebP, SVG, WAV, MP3, Ogg Vorbis/Opus, MP4/MOV and WebM/Matroska.
+media_info probe_media_file(const std::filesystem::path& path);
@@ -0,0 +1,151 @@
+#include "media-scanner.hh"
+#include "castmate-native/trace.hh"
+
+#include <algorithm>
+#include <thread>
+
+//Files per task, small enough to balance a big folder and large enough to keep the queue quiet.
+static const size_t files_per_task = 32;
+
+int64_t media_file_mtime(const std::filesystem::directory_entry& entry, std::error_code& error)
+{
+    return int64_t(entry.last_write_time(error).time_since_epoch().count());
+}
+
+media_scan_stats media_scanner::run(const media_scan_options& scan_options, const media_index& scan_index, batch_callback callback)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    options = &scan_options;
+    index = &scan_index;
+    on_batch = std::move(callback);
+    last_flush = start;
+    file_count = 0;
+    cached_count = 0;
+
+    uint32_t thread_count = options->threads;
+    if (thread_count == 0)
+    {
+        //Header parsing is mostly waiting on the disk, a few more threads than cores helps on cold caches.
+        thread_count = std::max(2u, std::thread::hardware_concurrency());
+    }
+
+    if (!pool || pool->size() != thread_count)
+    {
+        pool = std::make_unique<work_pool>(thread_count);
+    }
+
+    for (size_t i = 0; i < options->roots.size(); ++i)
+    {
+        std::filesystem::path root_path = std::filesystem::u8path(options->roots[i]);
+        pool->submit([this, i, root_path] { scan_directory(i, root_path); });
+    }
+
+    //Directory tasks submit their subfolders and file chunks, this only returns once all of them ran
+    pool->wait_idle();
+
+    flush_results();
+
+    media_scan_stats stats;
+    stats.files = file_count;
+    stats.cached = cached_count;
+    stats.probed = stats.files - stats.cached;
+    stats.cancelled = cancelled;
+    stats.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+void media_scanner::scan_directory(size_t root, const std::filesystem::path& directory)
+{
+    if (cancelled) return;
+
+    std::error_code error;
+    std::filesystem::directory_iterator iterator(directory, std::filesystem::directory_options::skip_permission_denied, error);
+    if (error) return;
+
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : iterator)
+    {
+        if (cancelled) return;
+
+        std::error_code entry_error;
+        if (entry.is_directory(entry_error))
+        {
+            std::filesystem::path subdirectory = entry.path();
+            pool->submit([this, root, subdirectory] { scan_directory(root, subdirectory); });
+        }
+        else if (entry.is_regular_file(entry_error))
+        {
+            files.push_back(entry.path());
+            if (files.size() >= files_per_task)
+            {
+                pool->submit([this, root, chunk = std::move(files)] { scan_files(root, chunk); });
+                files.clear();
+            }
+        }
+    }
+
+    //Finish the remainder here rather than bouncing it through the pool
+    if (!files.empty())
+    {
+        scan_files(root, files);
+    }
+}
+
+void media_scanner::scan_files(size_t root, const std::vector<std::filesystem::path>& files)
+{
+    TRACE_SCOPE("media scan files");
+
+    for (const auto& file : files)
+    {
+        if (cancelled) return;
+
+        std::error_code error;
+        std::filesystem::directory_entry entry(file, error);
+        if (error) continue;
+
+        media_scan_result result;
+        result.root = options->roots[root];
+        result.file = file.u8string();
+        result.size = entry.file_size(error);
+        if (error) continue;
+        result.mtime = media_file_mtime(entry, error);
+        if (error) continue;
+
+        if (index->lookup(result.file, result.size, result.mtime, result.info))
+        {
+            result.cached = true;
+            ++cached_count;
+        }
+        else
+        {
+            result.info = probe_media_file(file);
+        }
+
+        ++file_count;
+        push_result(std::move(result));
+    }
+}
+
+void media_scanner::push_result(media_scan_result result)
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    results.push_back(std::move(result));
+
+    const auto now = std::chrono::steady_clock::now();
+    if (results.size() >= options->batch_size || now - last_flush >= std::chrono::milliseconds(options->batch_interval_ms))
+    {
+        last_flush = now;
+        on_batch(std::move(results));
+        results = std::vector<media_scan_result>();
+    }
+}
+
+void media_scanner::flush_results()
+{
+    std::lock_guard<std::mutex> lock(result_mutex);
+    if (results.empty()) return;
+
+    on_batch(std::move(results));
+    results = std::vector<media_scan_result>();
+}
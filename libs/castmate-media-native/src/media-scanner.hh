@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+
+#include "castmate-native/work-pool.hh"
+
+#include "media-probe.hh"
+#include "media-index.hh"
+
+struct media_scan_result
+{
+    std::string root;
+    //UTF-8, absolute
+    std::string file;
+    uint64_t size = 0;
+    int64_t mtime = 0;
+    media_info info;
+    bool cached = false;
+};
+
+struct media_scan_stats
+{
+    uint32_t files = 0;
+    uint32_t cached = 0;
+    uint32_t probed = 0;
+    double elapsed_ms = 0;
+    //The walk stopped early, files that weren't reached may still exist
+    bool cancelled = false;
+};
+
+struct media_scan_options
+{
+    std::vector<std::string> roots;
+    uint32_t threads = 0;
+    uint32_t batch_size = 128;
+    uint32_t batch_interval_ms = 50;
+};
+
+//Walks media folders on a work_pool. Directories and chunks of files are both tasks, so a single huge folder still
+//spreads across every thread. Files whose size and mtime match the index are answered from it, everything else gets
+//its headers parsed. Results are handed out in batches.
+class media_scanner
+{
+public:
+    using batch_callback = std::function<void(std::vector<media_scan_result>&&)>;
+
+    media_scan_stats run(const media_scan_options& options, const media_index& index, batch_callback on_batch);
+    void cancel() { cancelled = true; }
+    //Called before starting a scan, a cancel only applies to the scan it was meant for
+    void reset_cancel() { cancelled = false; }
+
+private:
+    void scan_directory(size_t root, const std::filesystem::path& directory);
+    void scan_files(size_t root, const std::vector<std::filesystem::path>& files);
+    void push_result(media_scan_result result);
+    void flush_results();
+
+    const media_scan_options* options = nullptr;
+    const media_index* index = nullptr;
+    batch_callback on_batch;
+    std::atomic<bool> cancelled { false };
+
+    //Kept between scans, remade only when a scan asks for a different thread count
+    std::unique_ptr<work_pool> pool;
+
+    std::mutex result_mutex;
+    std::vector<media_scan_result> results;
+    std::chrono::steady_clock::time_point last_flush;
+
+    std::atomic<uint32_t> file_count { 0 };
+    std::atomic<uint32_t> cached_count { 0 };
+};
+
+int64_t media_file_mtime(const std::filesystem::directory_entry& entry, std::error_code& error);
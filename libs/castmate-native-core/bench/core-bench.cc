@@ -0,0 +1,353 @@
+//Benchmarks for the native core primitives, compared against the plain std:: versions the addons used before.
+//Run through `yarn bench`, options: --events=N --producers=N --tasks=N
+
+#include "castmate-native/ring-buffer.hh"
+#include "castmate-native/event-arena.hh"
+#include "castmate-native/work-pool.hh"
+#include "castmate-native/trace.hh"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//Set when a benchmark loses or corrupts events, the run then exits non-zero
+static bool bench_failed = false;
+
+struct bench_options
+{
+    size_t events = 2000000;
+    size_t producers = 4;
+    size_t tasks = 200000;
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char* name, size_t count, double seconds)
+{
+    printf("  %-36s %10.2f M/s  %8.1f ns/op\n", name, count / seconds / 1e6, seconds * 1e9 / count);
+}
+
+//Roughly the size of an input event
+struct bench_event
+{
+    uint64_t time;
+    uint32_t code;
+    uint32_t flags;
+};
+
+static void bench_spsc(const bench_options& options)
+{
+    spsc_ring<bench_event> ring(4096);
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread producer([&] {
+        for (size_t i = 0; i < options.events; ++i)
+        {
+            bench_event event { i, uint32_t(i), 0 };
+            while (!ring.try_push(std::move(event))) std::this_thread::yield();
+        }
+    });
+
+    bench_event event;
+    uint64_t checksum = 0;
+    for (size_t received = 0; received < options.events;)
+    {
+        if (ring.try_pop(event))
+        {
+            checksum += event.time;
+            ++received;
+        }
+        else
+        {
+            //Don't starve the producers on small machines
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+
+    report("spsc_ring", options.events, seconds_since(start));
+    if (checksum != uint64_t(options.events) * (options.events - 1) / 2)
+    {
+        printf("  spsc_ring checksum mismatch!\n");
+        bench_failed = true;
+    }
+}
+
+template <typename Queue>
+static double run_mpsc(Queue& queue, const bench_options& options, uint64_t& checksum)
+{
+    const size_t per_producer = options.events / options.producers;
+    const size_t total = per_producer * options.producers;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < options.producers; ++p)
+    {
+        producers.emplace_back([&, p] {
+            for (size_t i = 0; i < per_producer; ++i)
+            {
+                bench_event event { 1, uint32_t(p), 0 };
+                while (!queue.try_push(std::move(event))) std::this_thread::yield();
+            }
+        });
+    }
+
+    bench_event event;
+    checksum = 0;
+    for (size_t received = 0; received < total;)
+    {
+        if (queue.try_pop(event))
+        {
+            checksum += event.time;
+            ++received;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    for (std::thread& producer : producers) producer.join();
+    return seconds_since(start);
+}
+
+//What every TSFN call boils down to, a locked unbounded queue.
+struct locked_queue
+{
+    std::mutex mutex;
+    std::deque<bench_event> events;
+
+    bool try_push(bench_event&& event)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(event);
+        return true;
+    }
+
+    bool try_pop(bench_event& event)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (events.empty()) return false;
+        event = events.front();
+        events.pop_front();
+        return true;
+    }
+};
+
+static void bench_mpsc(const bench_options& options)
+{
+    const size_t total = options.events / options.producers * options.producers;
+    uint64_t checksum;
+
+    mpsc_ring<bench_event> ring(4096);
+    report("mpsc_ring", total, run_mpsc(ring, options, checksum));
+    if (checksum != total)
+    {
+        printf("  mpsc_ring lost events!\n");
+        bench_failed = true;
+    }
+
+    locked_queue locked;
+    report("mutex + deque", total, run_mpsc(locked, options, checksum));
+}
+
+//A payload shaped like a controller report: a device id and a handful of changes.
+struct bench_payload
+{
+    char device_id[48];
+    float values[8];
+};
+
+static void bench_arena(const bench_options& options)
+{
+    //Allocate on one thread, free on another, like capture thread -> JS thread.
+    const size_t total = options.events;
+
+    {
+        event_arena arena;
+        spsc_ring<bench_payload*> ring(4096);
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&] {
+            for (size_t i = 0; i < total; ++i)
+            {
+                bench_payload* payload = arena.create<bench_payload>();
+                payload->values[0] = float(i);
+                while (!ring.try_push(std::move(payload))) std::this_thread::yield();
+            }
+        });
+
+        bench_payload* payload;
+        for (size_t received = 0; received < total;)
+        {
+            if (ring.try_pop(payload))
+            {
+                event_arena::destroy(payload);
+                ++received;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        report("event_arena cross thread", total, seconds_since(start));
+        printf("  %-36s %10zu chunks\n", "event_arena footprint", arena.chunk_count());
+    }
+
+    {
+        spsc_ring<bench_payload*> ring(4096);
+
+        auto start = std::chrono::steady_clock::now();
+        std::thread producer([&] {
+            for (size_t i = 0; i < total; ++i)
+            {
+                bench_payload* payload = new bench_payload();
+                payload->values[0] = float(i);
+                while (!ring.try_push(std::move(payload))) std::this_thread::yield();
+            }
+        });
+
+        bench_payload* payload;
+        for (size_t received = 0; received < total;)
+        {
+            if (ring.try_pop(payload))
+            {
+                delete payload;
+                ++received;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+
+        report("new/delete cross thread", total, seconds_since(start));
+    }
+}
+
+static uint64_t busy_work(uint64_t seed)
+{
+    uint64_t x = seed | 1;
+    for (int i = 0; i < 2000; ++i)
+    {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+    }
+    return x;
+}
+
+static void bench_pool(const bench_options& options)
+{
+    std::atomic<uint64_t> sink { 0 };
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.tasks; ++i)
+    {
+        sink += busy_work(i);
+    }
+    const double serial = seconds_since(start);
+    report("serial", options.tasks, serial);
+
+    work_pool pool;
+
+    //Flat submission from outside the pool
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.tasks; ++i)
+    {
+        pool.submit([i, &sink] { sink += busy_work(i); });
+    }
+    pool.wait_idle();
+    const double flat = seconds_since(start);
+    report("work_pool flat", options.tasks, flat);
+
+    //Nested, one task fans out into the rest so every other worker has to steal
+    start = std::chrono::steady_clock::now();
+    const size_t fan_out = 64;
+    pool.submit([&] {
+        for (size_t group = 0; group < options.tasks / fan_out; ++group)
+        {
+            pool.submit([&, group] {
+                for (size_t i = 0; i < fan_out; ++i)
+                {
+                    sink += busy_work(group * fan_out + i);
+                }
+            });
+        }
+    });
+    pool.wait_idle();
+    const double nested = seconds_since(start);
+    report("work_pool stolen", options.tasks / fan_out * fan_out, nested);
+
+    printf("  %-36s %10zu threads, %.1fx flat, %.1fx stolen\n", "work_pool speedup", pool.size(), serial / flat, serial / nested);
+}
+
+static void bench_trace(const bench_options& options)
+{
+    uint64_t sink = 0;
+
+    set_trace_enabled(false);
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.events; ++i)
+    {
+        TRACE_SCOPE("bench scope");
+        sink += i;
+    }
+    report("TRACE_SCOPE disabled", options.events, seconds_since(start));
+
+    set_trace_enabled(true);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < options.events; ++i)
+    {
+        TRACE_SCOPE("bench scope");
+        sink += i;
+    }
+    report("TRACE_SCOPE enabled", options.events, seconds_since(start));
+    set_trace_enabled(false);
+
+    start = std::chrono::steady_clock::now();
+    const size_t json_size = trace_dump_json().size();
+    printf("  %-36s %10.2f ms  %8zu KB\n", "dump", seconds_since(start) * 1000, json_size / 1024);
+    trace_clear();
+
+    if (sink == 0) printf("\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const char* arg = argv[i];
+        if (strncmp(arg, "--events=", 9) == 0) options.events = strtoull(arg + 9, nullptr, 10);
+        else if (strncmp(arg, "--producers=", 12) == 0) options.producers = std::max<size_t>(1, strtoull(arg + 12, nullptr, 10));
+        else if (strncmp(arg, "--tasks=", 8) == 0) options.tasks = strtoull(arg + 8, nullptr, 10);
+    }
+
+    printf("Ring buffers, %zu events\n", options.events);
+    bench_spsc(options);
+    bench_mpsc(options);
+
+    printf("Payload allocation, %zu events\n", options.events);
+    bench_arena(options);
+
+    printf("Tracing, %zu scopes\n", options.events);
+    bench_trace(options);
+
+    printf("Thread pool, %zu tasks\n", options.tasks);
+    bench_pool(options);
+
+    return bench_failed ? 1 : 0;
+}
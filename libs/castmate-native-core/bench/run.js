@@ -0,0 +1,15 @@
+// Runs the native core benchmarks, build first with `yarn rebuild`
+// Options are passed through: --events=2000000 --producers=4 --tasks=200000
+
+const path = require("path")
+const { spawnSync } = require("child_process")
+
+const executable = process.platform == "win32" ? "castmate-native-core-bench.exe" : "castmate-native-core-bench"
+const binary = path.join(__dirname, "..", "build", "Release", executable)
+
+const result = spawnSync(binary, process.argv.slice(2), { stdio: "inherit" })
+if (result.error) {
+	console.error(`Unable to run ${binary}: ${result.error.message}`)
+	process.exit(1)
+}
+process.exit(result.status ?? 0)
@@ -0,0 +1,90 @@
+{
+    "targets": [
+        {
+            # Linked into every CastMate addon, pull it in with
+            # "dependencies": [ "<!(node -p \"require('castmate-native-core').gyp\")" ]
+            "target_name": "castmate-native-core",
+            "type": "static_library",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "src/errors.cc",
+                "src/event-arena.cc",
+                "src/trace.cc",
+                "src/trace-bindings.cc",
+                "src/work-pool.cc"
+            ],
+            "include_dirs": [
+                "include",
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ],
+            "direct_dependent_settings": {
+                "include_dirs": [ "include" ]
+            }
+        },
+        {
+            # Plain executable, no node involved, so it runs anywhere the library builds.
+            "target_name": "castmate-native-core-bench",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17", "-O2" ],
+            "sources": [ "bench/core-bench.cc" ],
+            "dependencies": [ "castmate-native-core" ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        },
+        {
+            "target_name": "castmate-native-core-test",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [ "test/core-test.cc" ],
+            "dependencies": [ "castmate-native-core" ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        },
+        {
+            # event_dispatcher needs a ThreadSafeFunction, so it's tested from node through this addon
+            "target_name": "castmate-native-core-test-addon",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [ "test/dispatcher-test.cc" ],
+            "dependencies": [ "castmate-native-core" ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS" ]
+        }
+    ]
+}
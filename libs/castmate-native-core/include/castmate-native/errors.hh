@@ -0,0 +1,21 @@
+#pragma once
+
+#include <napi.h>
+
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+//Throws a JS error and hands back undefined so bindings can `return throw_js_error(env, "...");`
+Napi::Value throw_js_error(Napi::Env env, const std::string& message);
+
+#ifdef _WIN32
+//"FAILURE(0x80070005): message : Access is denied."
+std::string format_hresult(HRESULT result, const std::string& message);
+
+//Both return true if result is a failure. The first throws into JS, the offthread one can only log.
+bool error_handler(HRESULT result, const std::string& message, const Napi::Env& env);
+bool error_handler_offthread(HRESULT result, const std::string& message);
+#endif
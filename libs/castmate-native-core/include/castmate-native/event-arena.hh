@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+//Bump allocator for event payloads that are built on a capture thread and freed on the JS thread.
+//
+//One thread allocates, any thread releases. Allocations are carved out of fixed size chunks, each chunk counts
+//its live allocations and goes back on the free list once the last one is released. Event payloads die in
+//roughly the order they were made, so chunks recycle steadily and the capture thread stops touching the heap.
+//
+//The arena has to outlive everything allocated from it.
+class event_arena
+{
+public:
+    explicit event_arena(size_t chunk_size = 64 * 1024);
+    ~event_arena();
+
+    event_arena(const event_arena&) = delete;
+    event_arena& operator=(const event_arena&) = delete;
+
+    //Allocating thread only
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    //Any thread
+    static void release(void* ptr);
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    template <typename T>
+    static void destroy(T* ptr)
+    {
+        if (!ptr) return;
+        ptr->~T();
+        release(ptr);
+    }
+
+    size_t chunk_count() const { return chunks.size(); }
+
+private:
+    struct chunk
+    {
+        event_arena* owner;
+        //Live allocations plus one while it's the chunk being allocated from
+        std::atomic<uint32_t> live;
+        size_t capacity;
+        size_t used;
+
+        uint8_t* data() { return reinterpret_cast<uint8_t*>(this + 1); }
+    };
+
+    chunk* acquire_chunk(size_t min_capacity);
+    void retire(chunk* retired);
+    void recycle(chunk* recycled);
+
+    const size_t chunk_size;
+    chunk* current = nullptr;
+
+    //Every chunk ever made, freed in the destructor
+    std::vector<chunk*> chunks;
+
+    std::mutex free_mutex;
+    std::vector<chunk*> free_chunks;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "ring-buffer.hh"
+#include "event-arena.hh"
+#include "trace.hh"
+
+#include <string>
+
+//Bounded, batching replacement for calling ThreadSafeFunction::NonBlockingCall per event.
+//
+//Any thread can post. Events go into a fixed size MPSC ring and at most one TSFN call is ever in flight, that call
+//drains up to max_batch events on the JS thread. A burst of input becomes a handful of event loop turns instead of
+//one per event, and when JS falls behind the ring fills up and new events are dropped and counted rather than
+//queueing without limit.
+//
+//Payloads too big to carry in the event itself can come out of arena(), it lives as long as the queued events do.
+//
+//Stop every producer before close(). The shared state is freed by the TSFN finalizer once the last batch ran.
+template <typename Event>
+class event_dispatcher
+{
+public:
+    using deliver_fn = std::function<void(Napi::Env env, Napi::Function js_callback, Event& event)>;
+
+    event_dispatcher() = default;
+    ~event_dispatcher() { close(); }
+
+    event_dispatcher(const event_dispatcher&) = delete;
+    event_dispatcher& operator=(const event_dispatcher&) = delete;
+
+    void open(Napi::Env env, Napi::Function callback, const char* name, size_t capacity, deliver_fn deliver, size_t max_batch = 256)
+    {
+        close();
+
+        state = new shared_state(capacity, std::move(deliver), max_batch);
+        state->trace_queue_delay = trace_intern(std::string(name) + " queue delay");
+        state->trace_batch = trace_intern(std::string(name) + " batch");
+        state->trace_depth = trace_intern(std::string(name) + " depth");
+        state->tsfn = Napi::ThreadSafeFunction::New(env,
+            callback,
+            name,
+            0,
+            1,
+            state,
+            [](Napi::Env env, void* data, shared_state* context) { delete context; },
+            (void*)nullptr
+        );
+    }
+
+    void close()
+    {
+        if (!state) return;
+
+        state->tsfn.Release();
+        state = nullptr;
+    }
+
+    bool is_open() const { return state != nullptr; }
+
+    //Any thread. Returns false if the event was dropped.
+    bool post(Event&& event)
+    {
+        shared_state* s = state;
+        if (!s) return false;
+
+        if (!s->queue.try_push(std::move(event)))
+        {
+            s->dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        //Pairs with the fence in drain(), either we see the drain has finished or it sees this event.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s->schedule();
+        return true;
+    }
+
+    //Any thread. For producers that can't lose events, waits for the JS thread to make room instead of dropping.
+    //stop() is polled while waiting so a producer being shut down from the JS thread doesn't wait on itself.
+    //Returns false if stop() gave up on the event.
+    template <typename StopFn>
+    bool post_wait(Event&& event, StopFn&& stop)
+    {
+        shared_state* s = state;
+        if (!s) return false;
+
+        while (!s->queue.try_push(std::move(event)))
+        {
+            if (stop()) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        s->schedule();
+        return true;
+    }
+
+    void ref(Napi::Env env) { if (state) state->tsfn.Ref(env); }
+    void unref(Napi::Env env) { if (state) state->tsfn.Unref(env); }
+
+    uint64_t dropped() const { return state ? state->dropped.load(std::memory_order_relaxed) : 0; }
+    //Drains that delivered anything, and the most events one of them delivered
+    uint64_t batches() const { return state ? state->batches.load(std::memory_order_relaxed) : 0; }
+    size_t largest_batch() const { return state ? state->largest_batch.load(std::memory_order_relaxed) : 0; }
+
+    //Only one thread may allocate from it, see event_arena. Only valid while open.
+    event_arena& arena() { return state->payloads; }
+
+private:
+    struct shared_state
+    {
+        shared_state(size_t capacity, deliver_fn deliver, size_t max_batch)
+            : queue(capacity)
+            , deliver(std::move(deliver))
+            , max_batch(max_batch)
+        {
+        }
+
+        void schedule()
+        {
+            if (scheduled.exchange(true, std::memory_order_seq_cst)) return;
+
+            if (trace_enabled()) scheduled_ns.store(trace_now_ns(), std::memory_order_relaxed);
+
+            if (tsfn.NonBlockingCall(this, &shared_state::drain) != napi_ok)
+            {
+                scheduled.store(false, std::memory_order_release);
+            }
+        }
+
+        static void drain(Napi::Env env, Napi::Function js_callback, shared_state* s)
+        {
+            //Taken before clearing scheduled so the next schedule() can't have overwritten it yet
+            const uint64_t scheduled_at = s->scheduled_ns.exchange(0, std::memory_order_relaxed);
+            s->scheduled.store(false, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            Event event;
+
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr)
+            {
+                while (s->queue.try_pop(event)) {}
+                return;
+            }
+
+            const bool tracing = trace_enabled();
+            if (tracing)
+            {
+                //How long the batch sat in the TSFN queue waiting for the event loop
+                const uint64_t now = trace_now_ns();
+                if (scheduled_at && scheduled_at < now)
+                {
+                    trace_record(trace_record_type::complete, s->trace_queue_delay, double(now - scheduled_at), scheduled_at);
+                }
+                trace_record(trace_record_type::counter, s->trace_depth, double(s->queue.size_approx()));
+                trace_record(trace_record_type::begin, s->trace_batch);
+            }
+
+            size_t delivered = 0;
+            while (delivered < s->max_batch && s->queue.try_pop(event))
+            {
+                s->deliver(env, js_callback, event);
+                ++delivered;
+            }
+
+            if (tracing) trace_record(trace_record_type::end, s->trace_batch);
+
+            if (delivered > 0)
+            {
+                s->batches.fetch_add(1, std::memory_order_relaxed);
+                if (delivered > s->largest_batch.load(std::memory_order_relaxed))
+                {
+                    s->largest_batch.store(delivered, std::memory_order_relaxed);
+                }
+            }
+
+            //Yield back to the event loop between full batches instead of starving it.
+            if (delivered == s->max_batch && s->queue.size_approx() > 0)
+            {
+                s->schedule();
+            }
+        }
+
+        Napi::ThreadSafeFunction tsfn;
+        mpsc_ring<Event> queue;
+        event_arena payloads;
+        deliver_fn deliver;
+        const size_t max_batch;
+        std::atomic<bool> scheduled { false };
+        std::atomic<uint64_t> dropped { 0 };
+        //Only written by drain() on the JS thread
+        std::atomic<uint64_t> batches { 0 };
+        std::atomic<size_t> largest_batch { 0 };
+
+        //Written by whichever producer scheduled the drain, read by the drain it scheduled
+        std::atomic<uint64_t> scheduled_ns { 0 };
+        uint32_t trace_queue_delay = 0;
+        uint32_t trace_batch = 0;
+        uint32_t trace_depth = 0;
+    };
+
+    shared_state* state = nullptr;
+};
+
+//Most addons just want to run a lambda on the JS thread.
+using js_call = std::function<void(Napi::Env env, Napi::Function js_callback)>;
+
+class js_call_dispatcher : public event_dispatcher<js_call>
+{
+public:
+    void open(Napi::Env env, Napi::Function callback, const char* name, size_t capacity = 4096)
+    {
+        event_dispatcher<js_call>::open(env, callback, name, capacity,
+            [](Napi::Env env, Napi::Function js_callback, js_call& call) {
+                call(env, js_callback);
+                call = nullptr;
+            });
+    }
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+//Fixed capacity lock free queues for handing events between threads. Capacity is rounded up to a power of two
+//and neither queue ever allocates after construction, a full queue rejects the push instead of growing.
+
+//Producer and consumer indices live on separate cache lines so the two threads don't fight over one.
+static constexpr size_t ring_cache_line = 64;
+
+inline size_t ring_capacity(size_t requested)
+{
+    size_t capacity = 2;
+    while (capacity < requested)
+    {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+//One producer thread, one consumer thread.
+template <typename T>
+class spsc_ring
+{
+public:
+    explicit spsc_ring(size_t capacity)
+        : mask(ring_capacity(capacity) - 1)
+        , slots(new T[mask + 1])
+    {
+    }
+
+    spsc_ring(const spsc_ring&) = delete;
+    spsc_ring& operator=(const spsc_ring&) = delete;
+
+    bool try_push(T&& value)
+    {
+        const size_t head = write_index.load(std::memory_order_relaxed);
+        if (head - cached_read > mask)
+        {
+            cached_read = read_index.load(std::memory_order_acquire);
+            if (head - cached_read > mask) return false;
+        }
+
+        slots[head & mask] = std::move(value);
+        write_index.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        const size_t tail = read_index.load(std::memory_order_relaxed);
+        if (tail == cached_write)
+        {
+            cached_write = write_index.load(std::memory_order_acquire);
+            if (tail == cached_write) return false;
+        }
+
+        value = std::move(slots[tail & mask]);
+        read_index.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t size_approx() const
+    {
+        return write_index.load(std::memory_order_relaxed) - read_index.load(std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    const size_t mask;
+    std::unique_ptr<T[]> slots;
+
+    //Producer side
+    alignas(ring_cache_line) std::atomic<size_t> write_index { 0 };
+    size_t cached_read = 0;
+
+    //Consumer side
+    alignas(ring_cache_line) std::atomic<size_t> read_index { 0 };
+    size_t cached_write = 0;
+};
+
+//Any number of producer threads, one consumer thread. Each slot carries a sequence number so producers
+//claim a slot with a single CAS and the consumer can tell a claimed slot from a published one.
+template <typename T>
+class mpsc_ring
+{
+public:
+    explicit mpsc_ring(size_t capacity)
+        : mask(ring_capacity(capacity) - 1)
+        , cells(new cell[mask + 1])
+    {
+        for (size_t i = 0; i <= mask; ++i)
+        {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    mpsc_ring(const mpsc_ring&) = delete;
+    mpsc_ring& operator=(const mpsc_ring&) = delete;
+
+    bool try_push(T&& value)
+    {
+        size_t position = write_index.load(std::memory_order_relaxed);
+        cell* target;
+        while (true)
+        {
+            target = &cells[position & mask];
+            const size_t sequence = target->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = intptr_t(sequence) - intptr_t(position);
+
+            if (diff == 0)
+            {
+                if (write_index.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+            }
+            else if (diff < 0)
+            {
+                //The consumer hasn't freed this slot yet, we're full.
+                return false;
+            }
+            else
+            {
+                position = write_index.load(std::memory_order_relaxed);
+            }
+        }
+
+        target->value = std::move(value);
+        target->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_pop(T& value)
+    {
+        const size_t position = read_index.load(std::memory_order_relaxed);
+        cell& target = cells[position & mask];
+
+        if (target.sequence.load(std::memory_order_acquire) != position + 1) return false;
+
+        value = std::move(target.value);
+        target.sequence.store(position + mask + 1, std::memory_order_release);
+        read_index.store(position + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    size_t size_approx() const
+    {
+        const size_t written = write_index.load(std::memory_order_relaxed);
+        const size_t read = read_index.load(std::memory_order_relaxed);
+        return written > read ? written - read : 0;
+    }
+
+    size_t capacity() const { return mask + 1; }
+
+private:
+    struct cell
+    {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    const size_t mask;
+    std::unique_ptr<cell[]> cells;
+
+    alignas(ring_cache_line) std::atomic<size_t> write_index { 0 };
+    alignas(ring_cache_line) std::atomic<size_t> read_index { 0 };
+};
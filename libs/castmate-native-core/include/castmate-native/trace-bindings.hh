@@ -0,0 +1,6 @@
+#pragma once
+
+#include <napi.h>
+
+//Adds setTracingEnabled(bool), dumpTrace() -> string and clearTrace() to an addon's exports
+void trace_init(Napi::Env env, Napi::Object exports);
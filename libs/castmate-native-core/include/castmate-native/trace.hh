@@ -0,0 +1,94 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+//Tracing for the native addons, dumped as Chrome trace event JSON so it opens in Perfetto or chrome://tracing.
+//
+//Every thread that records gets its own fixed size ring of records, the oldest records are overwritten when it
+//wraps. Recording never locks or allocates after a thread's first record, and while tracing is off a scope costs a
+//single relaxed load. Define CASTMATE_DISABLE_TRACING to compile the macros out entirely.
+//
+//Timestamps come from the monotonic clock Chromium uses for its own traces, so a dump lines up with an
+//Electron trace taken at the same time.
+//
+//Each addon links its own copy of the core, so each one keeps and dumps its own buffers.
+
+enum class trace_record_type : uint8_t
+{
+    begin,
+    end,
+    counter,
+    instant,
+    //A span recorded after the fact, value is the duration in nanoseconds
+    complete,
+};
+
+extern std::atomic<bool> trace_enabled_flag;
+
+inline bool trace_enabled()
+{
+    return trace_enabled_flag.load(std::memory_order_relaxed);
+}
+
+void set_trace_enabled(bool enabled);
+
+uint64_t trace_now_ns();
+
+//Maps a name to a small id, names are stored once and records only carry the id. Call once per call site.
+uint32_t trace_intern(const std::string& name);
+
+void trace_record(trace_record_type type, uint32_t name, double value = 0, uint64_t time_ns = 0);
+
+//Labels the calling thread in the dump
+void trace_set_thread_name(const std::string& name);
+
+//{"traceEvents":[...]} with every buffered record
+std::string trace_dump_json();
+void trace_clear();
+
+class trace_scope
+{
+public:
+    explicit trace_scope(uint32_t name)
+        : name(name)
+        , active(trace_enabled())
+    {
+        if (active) trace_record(trace_record_type::begin, name);
+    }
+
+    ~trace_scope()
+    {
+        if (active) trace_record(trace_record_type::end, name);
+    }
+
+    trace_scope(const trace_scope&) = delete;
+    trace_scope& operator=(const trace_scope&) = delete;
+
+private:
+    uint32_t name;
+    bool active;
+};
+
+#ifndef CASTMATE_DISABLE_TRACING
+
+#define CASTMATE_TRACE_CONCAT_INNER(a, b) a##b
+#define CASTMATE_TRACE_CONCAT(a, b) CASTMATE_TRACE_CONCAT_INNER(a, b)
+#define CASTMATE_TRACE_NAME(name) []() { static const uint32_t id = trace_intern(name); return id; }()
+
+//Spans the rest of the enclosing block
+#define TRACE_SCOPE(name) trace_scope CASTMATE_TRACE_CONCAT(trace_scope_, __LINE__)(CASTMATE_TRACE_NAME(name))
+#define TRACE_COUNTER(name, value) do { if (trace_enabled()) trace_record(trace_record_type::counter, CASTMATE_TRACE_NAME(name), double(value)); } while (0)
+#define TRACE_INSTANT(name) do { if (trace_enabled()) trace_record(trace_record_type::instant, CASTMATE_TRACE_NAME(name)); } while (0)
+//A span that started at start_ns, possibly on another thread, and ends now
+#define TRACE_COMPLETE(name, start_ns) do { if (trace_enabled()) { const uint64_t trace_end_ns = trace_now_ns(); trace_record(trace_record_type::complete, CASTMATE_TRACE_NAME(name), double(trace_end_ns - (start_ns)), (start_ns)); } } while (0)
+
+#else
+
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_COUNTER(name, value) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_COMPLETE(name, start_ns) do {} while (0)
+
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Fixed size thread pool with a task deque per worker.
+//
+//Workers take their own newest task first so work they spawn stays hot in cache, and steal the oldest task from
+//another worker when they run dry. Tasks submitted from outside the pool are spread round robin.
+class work_pool
+{
+public:
+    using task = std::function<void()>;
+
+    //0 uses one thread per core
+    explicit work_pool(size_t thread_count = 0);
+    //Finishes everything already submitted before joining
+    ~work_pool();
+
+    work_pool(const work_pool&) = delete;
+    work_pool& operator=(const work_pool&) = delete;
+
+    void submit(task work);
+
+    //Blocks until every submitted task, including ones submitted by tasks, has run.
+    void wait_idle();
+
+    size_t size() const { return threads.size(); }
+
+private:
+    struct worker_queue
+    {
+        std::mutex mutex;
+        std::deque<task> tasks;
+    };
+
+    bool pop_local(size_t index, task& work);
+    bool steal(size_t thief, task& work);
+    void worker_main(size_t index);
+
+    std::vector<std::unique_ptr<worker_queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex wake_mutex;
+    std::condition_variable wake_cv;
+    std::condition_variable idle_cv;
+    bool stopping = false;
+
+    //Tasks sitting in a deque
+    std::atomic<size_t> queued { 0 };
+    //Tasks submitted but not yet finished
+    std::atomic<size_t> outstanding { 0 };
+    std::atomic<size_t> next_queue { 0 };
+};
@@ -1,19 +1,22 @@
-#include <napi.h>
+#include "castmate-native/errors.hh"
 
-#include <string>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
 
+#ifdef _WIN32
 #include <comdef.h>
+#endif
 
-bool error_handler(HRESULT result, const std::string& message, const Napi::Env& env)
+Napi::Value throw_js_error(Napi::Env env, const std::string& message)
 {
-    if (SUCCEEDED(result))
-    {
-        return false;
-    }
+    Napi::Error::New(env, message).ThrowAsJavaScriptException();
+    return env.Undefined();
+}
 
+#ifdef _WIN32
+std::string format_hresult(HRESULT result, const std::string& message)
+{
     std::stringstream ss;
 
     ss << "FAILURE(";
@@ -25,26 +28,28 @@ bool error_handler(HRESULT result, const std::string& message, const Napi::Env&
     _com_error err(result);
     ss << err.ErrorMessage();
 
-    Napi::Error::New(env, ss.str()).ThrowAsJavaScriptException();
-    return true;
+    return ss.str();
 }
 
-bool error_handler_offthread(HRESULT result, const std::string& message)
+bool error_handler(HRESULT result, const std::string& message, const Napi::Env& env)
 {
     if (SUCCEEDED(result))
     {
         return false;
     }
 
-    std::stringstream ss;
+    Napi::Error::New(env, format_hresult(result, message)).ThrowAsJavaScriptException();
+    return true;
+}
 
-    ss << "FAILURE(";
-    // Hresults are searchable via hex...
-    ss << "0x" << std::uppercase << std::setfill('0') << std::setw(8) << std::hex << result;
-    ss << "): ";
-    ss << message << " : ";
+bool error_handler_offthread(HRESULT result, const std::string& message)
+{
+    if (SUCCEEDED(result))
+    {
+        return false;
+    }
 
-    _com_error err(result);
-    ss << err.ErrorMessage();
+    std::cout << format_hresult(result, message) << std::endl;
     return true;
-}
\ No newline at end of file
+}
+#endif
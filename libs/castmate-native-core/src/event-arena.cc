@@ -0,0 +1,110 @@
+#include "castmate-native/event-arena.hh"
+
+#include <algorithm>
+
+//Every allocation is preceded by a pointer back to its chunk so release() doesn't need the arena.
+static const size_t allocation_header = sizeof(void*);
+
+static uintptr_t align_up(uintptr_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~uintptr_t(alignment - 1);
+}
+
+event_arena::event_arena(size_t chunk_size)
+    : chunk_size(chunk_size)
+{
+}
+
+event_arena::~event_arena()
+{
+    for (chunk* c : chunks)
+    {
+        c->~chunk();
+        ::operator delete(c);
+    }
+}
+
+event_arena::chunk* event_arena::acquire_chunk(size_t min_capacity)
+{
+    {
+        std::lock_guard<std::mutex> lock(free_mutex);
+        for (size_t i = 0; i < free_chunks.size(); ++i)
+        {
+            chunk* candidate = free_chunks[i];
+            if (candidate->capacity < min_capacity) continue;
+
+            free_chunks[i] = free_chunks.back();
+            free_chunks.pop_back();
+
+            candidate->used = 0;
+            candidate->live.store(1, std::memory_order_relaxed);
+            return candidate;
+        }
+    }
+
+    const size_t capacity = std::max(chunk_size, min_capacity);
+    chunk* created = new (::operator new(sizeof(chunk) + capacity)) chunk();
+    created->owner = this;
+    created->live.store(1, std::memory_order_relaxed);
+    created->capacity = capacity;
+    created->used = 0;
+    chunks.push_back(created);
+    return created;
+}
+
+void event_arena::retire(chunk* retired)
+{
+    //Drop the allocator's own reference, whoever brings it to zero recycles it.
+    if (retired->live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        recycle(retired);
+    }
+}
+
+void event_arena::recycle(chunk* recycled)
+{
+    std::lock_guard<std::mutex> lock(free_mutex);
+    free_chunks.push_back(recycled);
+}
+
+void* event_arena::allocate(size_t size, size_t alignment)
+{
+    if (alignment < alignof(void*)) alignment = alignof(void*);
+
+    if (current)
+    {
+        const uintptr_t base = reinterpret_cast<uintptr_t>(current->data());
+        const uintptr_t start = align_up(base + current->used + allocation_header, alignment);
+        if (start + size <= base + current->capacity)
+        {
+            current->used = start + size - base;
+            current->live.fetch_add(1, std::memory_order_relaxed);
+
+            reinterpret_cast<chunk**>(start)[-1] = current;
+            return reinterpret_cast<void*>(start);
+        }
+
+        retire(current);
+    }
+
+    current = acquire_chunk(size + allocation_header + alignment);
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(current->data());
+    const uintptr_t start = align_up(base + allocation_header, alignment);
+    current->used = start + size - base;
+    current->live.fetch_add(1, std::memory_order_relaxed);
+
+    reinterpret_cast<chunk**>(start)[-1] = current;
+    return reinterpret_cast<void*>(start);
+}
+
+void event_arena::release(void* ptr)
+{
+    if (!ptr) return;
+
+    chunk* owner_chunk = reinterpret_cast<chunk**>(ptr)[-1];
+    if (owner_chunk->live.fetch_sub(1, std::memory_order_acq_rel) == 1)
+    {
+        owner_chunk->owner->recycle(owner_chunk);
+    }
+}
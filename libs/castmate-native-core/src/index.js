@@ -0,0 +1,9 @@
+const path = require("path")
+
+const root = path.relative(".", path.join(__dirname, ".."))
+
+//Used from binding.gyp the same way as node-addon-api
+module.exports = {
+	include: `"${path.join(__dirname, "..", "include")}"`,
+	gyp: path.join(root, "binding.gyp:castmate-native-core"),
+}
@@ -0,0 +1,34 @@
+#include "castmate-native/trace-bindings.hh"
+#include "castmate-native/trace.hh"
+
+static Napi::Value set_tracing_enabled(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsBoolean())
+    {
+        Napi::Error::New(env, "setTracingEnabled requires a boolean.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    set_trace_enabled(info[0].As<Napi::Boolean>().Value());
+    return env.Undefined();
+}
+
+static Napi::Value dump_trace(const Napi::CallbackInfo& info)
+{
+    return Napi::String::New(info.Env(), trace_dump_json());
+}
+
+static Napi::Value clear_trace(const Napi::CallbackInfo& info)
+{
+    trace_clear();
+    return info.Env().Undefined();
+}
+
+void trace_init(Napi::Env env, Napi::Object exports)
+{
+    exports.Set("setTracingEnabled", Napi::Function::New(env, set_tracing_enabled, "setTracingEnabled"));
+    exports.Set("dumpTrace", Napi::Function::New(env, dump_trace, "dumpTrace"));
+    exports.Set("clearTrace", Napi::Function::New(env, clear_trace, "clearTrace"));
+}
@@ -0,0 +1,293 @@
+#include "castmate-native/trace.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+std::atomic<bool> trace_enabled_flag { false };
+
+//Per thread, 24 bytes a record
+static const size_t trace_buffer_records = 32768;
+
+struct trace_entry
+{
+    uint64_t time_ns;
+    double value;
+    uint32_t name;
+    trace_record_type type;
+};
+
+struct trace_buffer
+{
+    uint64_t thread_id;
+    std::string thread_name;
+    std::unique_ptr<trace_entry[]> entries { new trace_entry[trace_buffer_records] };
+    //Total records ever written, the slot is head % trace_buffer_records
+    std::atomic<uint64_t> head { 0 };
+    //Records before this were cleared
+    std::atomic<uint64_t> dump_from { 0 };
+    std::atomic<bool> alive { true };
+};
+
+//Only touched when a thread records for the first time, when interning and when dumping
+static std::mutex registry_mutex;
+static std::vector<std::shared_ptr<trace_buffer>> buffers;
+static std::vector<std::string> names;
+static std::unordered_map<std::string, uint32_t> name_ids;
+
+static uint64_t current_thread_id()
+{
+#ifdef _WIN32
+    return GetCurrentThreadId();
+#elif defined(__linux__)
+    return uint64_t(syscall(SYS_gettid));
+#else
+    return uint64_t(std::hash<std::thread::id>()(std::this_thread::get_id()));
+#endif
+}
+
+static uint64_t current_process_id()
+{
+#ifdef _WIN32
+    return GetCurrentProcessId();
+#else
+    return uint64_t(getpid());
+#endif
+}
+
+struct thread_trace_slot
+{
+    std::shared_ptr<trace_buffer> buffer;
+
+    ~thread_trace_slot()
+    {
+        //Keep the records around for the next dump, trace_clear drops it.
+        if (buffer) buffer->alive = false;
+    }
+
+    trace_buffer& get()
+    {
+        if (!buffer)
+        {
+            buffer = std::make_shared<trace_buffer>();
+            buffer->thread_id = current_thread_id();
+
+            std::lock_guard<std::mutex> lock(registry_mutex);
+            buffers.push_back(buffer);
+        }
+        return *buffer;
+    }
+};
+
+static thread_local thread_trace_slot thread_slot;
+
+void set_trace_enabled(bool enabled)
+{
+    trace_enabled_flag.store(enabled, std::memory_order_relaxed);
+}
+
+uint64_t trace_now_ns()
+{
+#ifdef _WIN32
+    //Chromium's TimeTicks, steady_clock is QPC too but goes through a slower conversion
+    static const int64_t frequency = [] {
+        LARGE_INTEGER f;
+        QueryPerformanceFrequency(&f);
+        return f.QuadPart;
+    }();
+
+    LARGE_INTEGER counter;
+    QueryPerformanceCounter(&counter);
+    return uint64_t(counter.QuadPart / frequency) * 1000000000ull + uint64_t(counter.QuadPart % frequency) * 1000000000ull / frequency;
+#else
+    return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+uint32_t trace_intern(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    auto existing = name_ids.find(name);
+    if (existing != name_ids.end()) return existing->second;
+
+    const uint32_t id = uint32_t(names.size());
+    names.push_back(name);
+    name_ids.emplace(name, id);
+    return id;
+}
+
+void trace_record(trace_record_type type, uint32_t name, double value, uint64_t time_ns)
+{
+    trace_buffer& buffer = thread_slot.get();
+
+    const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+    trace_entry& entry = buffer.entries[head % trace_buffer_records];
+    entry.time_ns = time_ns ? time_ns : trace_now_ns();
+    entry.value = value;
+    entry.name = name;
+    entry.type = type;
+    buffer.head.store(head + 1, std::memory_order_release);
+}
+
+void trace_set_thread_name(const std::string& name)
+{
+    trace_buffer& buffer = thread_slot.get();
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    buffer.thread_name = name;
+}
+
+static void append_json_string(std::string& json, const std::string& value)
+{
+    json += '"';
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': json += "\\\""; break;
+        case '\\': json += "\\\\"; break;
+        case '\n': json += "\\n"; break;
+        case '\r': json += "\\r"; break;
+        case '\t': json += "\\t"; break;
+        default:
+            if (uint8_t(c) < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                json += escaped;
+            }
+            else
+            {
+                json += c;
+            }
+        }
+    }
+    json += '"';
+}
+
+//Trace event timestamps are microseconds, keep the nanoseconds as decimals.
+static void append_microseconds(std::string& json, uint64_t ns)
+{
+    char formatted[32];
+    snprintf(formatted, sizeof(formatted), "%llu.%03llu", (unsigned long long)(ns / 1000), (unsigned long long)(ns % 1000));
+    json += formatted;
+}
+
+static const char* phase_for(trace_record_type type)
+{
+    switch (type)
+    {
+    case trace_record_type::begin: return "B";
+    case trace_record_type::end: return "E";
+    case trace_record_type::counter: return "C";
+    case trace_record_type::instant: return "i";
+    case trace_record_type::complete: return "X";
+    }
+    return "i";
+}
+
+std::string trace_dump_json()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    const std::string pid = std::to_string(current_process_id());
+
+    std::string json = "{\"traceEvents\":[";
+    bool first = true;
+    std::vector<trace_entry> snapshot;
+
+    for (const auto& buffer : buffers)
+    {
+        const std::string tid = std::to_string(buffer->thread_id);
+        const std::string prefix = "{\"pid\":" + pid + ",\"tid\":" + tid + ",";
+
+        if (!buffer->thread_name.empty())
+        {
+            if (!first) json += ',';
+            first = false;
+            json += prefix + "\"ph\":\"M\",\"name\":\"thread_name\",\"args\":{\"name\":";
+            append_json_string(json, buffer->thread_name);
+            json += "}}";
+        }
+
+        //The owning thread keeps writing while we copy, anything it may have lapped in the meantime is dropped.
+        const uint64_t head = buffer->head.load(std::memory_order_acquire);
+        const uint64_t start = std::max(head > trace_buffer_records ? head - trace_buffer_records : 0, buffer->dump_from.load());
+
+        snapshot.clear();
+        for (uint64_t i = start; i < head; ++i)
+        {
+            snapshot.push_back(buffer->entries[i % trace_buffer_records]);
+        }
+
+        const uint64_t head_after = buffer->head.load(std::memory_order_acquire);
+        const uint64_t overwritten = head_after > trace_buffer_records ? head_after - trace_buffer_records : 0;
+        const size_t skip = overwritten > start ? size_t(std::min<uint64_t>(overwritten - start, snapshot.size())) : 0;
+
+        for (size_t i = skip; i < snapshot.size(); ++i)
+        {
+            const trace_entry& entry = snapshot[i];
+            if (entry.name >= names.size()) continue;
+
+            if (!first) json += ',';
+            first = false;
+
+            json += prefix + "\"ph\":\"" + phase_for(entry.type) + "\",\"ts\":";
+            append_microseconds(json, entry.time_ns);
+            json += ",\"name\":";
+            append_json_string(json, names[entry.name]);
+
+            switch (entry.type)
+            {
+            case trace_record_type::counter:
+                json += ",\"args\":{\"value\":" + std::to_string(entry.value) + "}";
+                break;
+            case trace_record_type::instant:
+                json += ",\"s\":\"t\"";
+                break;
+            case trace_record_type::complete:
+                json += ",\"dur\":";
+                append_microseconds(json, uint64_t(entry.value));
+                break;
+            default:
+                break;
+            }
+
+            json += '}';
+        }
+    }
+
+    json += "],\"displayTimeUnit\":\"ns\"}";
+    return json;
+}
+
+void trace_clear()
+{
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    std::vector<std::shared_ptr<trace_buffer>> kept;
+    for (auto& buffer : buffers)
+    {
+        if (!buffer->alive) continue;
+
+        //Only the owning thread writes head, so just remember where the dump starts from now.
+        buffer->dump_from = buffer->head.load(std::memory_order_acquire);
+        kept.push_back(buffer);
+    }
+    buffers = std::move(kept);
+}
@@ -0,0 +1,126 @@
+#include "castmate-native/work-pool.hh"
+
+#include <algorithm>
+
+//Lets submit() from inside a task push onto the calling worker's own deque.
+static thread_local const work_pool* current_pool = nullptr;
+static thread_local size_t current_worker = 0;
+
+work_pool::work_pool(size_t thread_count)
+{
+    if (thread_count == 0)
+    {
+        thread_count = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    queues.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        queues.push_back(std::make_unique<worker_queue>());
+    }
+
+    threads.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        threads.emplace_back(&work_pool::worker_main, this, i);
+    }
+}
+
+work_pool::~work_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+        stopping = true;
+    }
+    wake_cv.notify_all();
+
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void work_pool::submit(task work)
+{
+    const size_t index = current_pool == this
+        ? current_worker
+        : next_queue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+
+    //Counted before the push so a worker can't pop it and take queued below zero.
+    outstanding.fetch_add(1, std::memory_order_relaxed);
+    queued.fetch_add(1, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(queues[index]->mutex);
+        queues[index]->tasks.push_back(std::move(work));
+    }
+
+    //Taking the lock orders this against a worker checking queued right before it sleeps.
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex);
+    }
+    wake_cv.notify_one();
+}
+
+void work_pool::wait_idle()
+{
+    std::unique_lock<std::mutex> lock(wake_mutex);
+    idle_cv.wait(lock, [this] { return outstanding.load(std::memory_order_acquire) == 0; });
+}
+
+bool work_pool::pop_local(size_t index, task& work)
+{
+    worker_queue& queue = *queues[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+
+    work = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool work_pool::steal(size_t thief, task& work)
+{
+    for (size_t offset = 1; offset < queues.size(); ++offset)
+    {
+        worker_queue& victim = *queues[(thief + offset) % queues.size()];
+
+        std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+        if (!lock.owns_lock() || victim.tasks.empty()) continue;
+
+        work = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+void work_pool::worker_main(size_t index)
+{
+    current_pool = this;
+    current_worker = index;
+
+    task work;
+    while (true)
+    {
+        if (pop_local(index, work) || steal(index, work))
+        {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            work();
+            work = nullptr;
+
+            if (outstanding.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                std::lock_guard<std::mutex> lock(wake_mutex);
+                idle_cv.notify_all();
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex);
+        //A steal can miss a task behind a contended try_lock, queued says whether there's really nothing left.
+        if (queued.load(std::memory_order_acquire) > 0) continue;
+        if (stopping) break;
+
+        wake_cv.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+    }
+}
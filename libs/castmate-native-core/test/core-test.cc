@@ -0,0 +1,477 @@
+//Unit tests for the native core primitives, no node involved.
+//Run through `yarn test`, exits non-zero if anything fails. Options: --filter=name
+
+#include "castmate-native/ring-buffer.hh"
+#include "castmate-native/event-arena.hh"
+#include "castmate-native/work-pool.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                                   \
+    do                                                          \
+    {                                                           \
+        if (!(condition))                                       \
+        {                                                       \
+            printf("  FAILED %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            ++failures;                                         \
+            return;                                             \
+        }                                                       \
+    } while (0)
+
+//Spins until the condition holds, false after a few seconds so a broken primitive fails instead of hanging
+template <typename Condition>
+static bool wait_for(Condition condition)
+{
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition())
+    {
+        if (std::chrono::steady_clock::now() > deadline) return false;
+        std::this_thread::yield();
+    }
+    return true;
+}
+
+//Rings
+
+template <typename Ring>
+static void check_single_thread(Ring& ring)
+{
+    size_t value = 0;
+    CHECK(!ring.try_pop(value), "pop from an empty ring succeeded");
+
+    for (size_t i = 0; i < ring.capacity(); ++i)
+    {
+        CHECK(ring.try_push(size_t(i)), "push %zu of %zu rejected", i, ring.capacity());
+    }
+    CHECK(!ring.try_push(size_t(999)), "push to a full ring succeeded");
+    CHECK(ring.size_approx() == ring.capacity(), "size %zu when full", ring.size_approx());
+
+    for (size_t i = 0; i < ring.capacity(); ++i)
+    {
+        CHECK(ring.try_pop(value) && value == i, "popped %zu, expected %zu", value, i);
+    }
+    CHECK(!ring.try_pop(value), "pop from a drained ring succeeded");
+    CHECK(ring.size_approx() == 0, "size %zu when drained", ring.size_approx());
+
+    //Uneven batches so the indices wrap the slots at every offset
+    size_t pushed = 0;
+    size_t popped = 0;
+    for (size_t round = 0; round < 1000; ++round)
+    {
+        const size_t batch = 1 + round % ring.capacity();
+        for (size_t i = 0; i < batch; ++i)
+        {
+            CHECK(ring.try_push(size_t(pushed)), "push rejected at %zu after wrapping", pushed);
+            ++pushed;
+        }
+        for (size_t i = 0; i < batch; ++i)
+        {
+            CHECK(ring.try_pop(value) && value == popped, "popped %zu after wrapping, expected %zu", value, popped);
+            ++popped;
+        }
+    }
+}
+
+static void test_ring_capacity()
+{
+    CHECK(ring_capacity(0) == 2, "capacity 0 rounds to %zu", ring_capacity(0));
+    CHECK(ring_capacity(2) == 2, "capacity 2 rounds to %zu", ring_capacity(2));
+    CHECK(ring_capacity(5) == 8, "capacity 5 rounds to %zu", ring_capacity(5));
+    CHECK(ring_capacity(4096) == 4096, "capacity 4096 rounds to %zu", ring_capacity(4096));
+
+    spsc_ring<int> spsc(100);
+    CHECK(spsc.capacity() == 128, "spsc capacity %zu", spsc.capacity());
+    mpsc_ring<int> mpsc(3);
+    CHECK(mpsc.capacity() == 4, "mpsc capacity %zu", mpsc.capacity());
+}
+
+static void test_spsc_single_thread()
+{
+    spsc_ring<size_t> ring(8);
+    check_single_thread(ring);
+}
+
+static void test_spsc_move_only()
+{
+    spsc_ring<std::unique_ptr<int>> ring(4);
+    CHECK(ring.try_push(std::make_unique<int>(7)), "push rejected");
+
+    std::unique_ptr<int> value;
+    CHECK(ring.try_pop(value) && value && *value == 7, "value didn't survive the ring");
+}
+
+static void test_spsc_threaded_order()
+{
+    const size_t count = 2000000;
+    spsc_ring<size_t> ring(64);
+
+    std::thread producer([&] {
+        for (size_t i = 0; i < count; ++i)
+        {
+            while (!ring.try_push(size_t(i))) std::this_thread::yield();
+        }
+    });
+
+    size_t expected = 0;
+    size_t value;
+    bool in_order = true;
+    const bool finished = wait_for([&] {
+        while (ring.try_pop(value))
+        {
+            if (value != expected) in_order = false;
+            ++expected;
+        }
+        return expected == count;
+    });
+    producer.join();
+
+    CHECK(finished, "only %zu of %zu arrived", expected, count);
+    CHECK(in_order, "values arrived out of order");
+}
+
+static void test_mpsc_single_thread()
+{
+    mpsc_ring<size_t> ring(8);
+    check_single_thread(ring);
+}
+
+static void test_mpsc_threaded_order()
+{
+    const size_t producers = 4;
+    const size_t per_producer = 500000;
+    mpsc_ring<size_t> ring(256);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < per_producer; ++i)
+            {
+                while (!ring.try_push((p << 32) | i)) std::this_thread::yield();
+            }
+        });
+    }
+
+    //Producers interleave, but each one's values have to come out in the order it pushed them
+    std::vector<size_t> next(producers, 0);
+    size_t received = 0;
+    bool in_order = true;
+    size_t value;
+    const bool finished = wait_for([&] {
+        while (ring.try_pop(value))
+        {
+            const size_t p = value >> 32;
+            if (p >= producers || (value & 0xFFFFFFFF) != next[p]) in_order = false;
+            else ++next[p];
+            ++received;
+        }
+        return received == producers * per_producer;
+    });
+    for (std::thread& thread : threads) thread.join();
+
+    CHECK(finished, "only %zu of %zu arrived", received, producers * per_producer);
+    CHECK(in_order, "a producer's values arrived out of order or twice");
+}
+
+static void test_mpsc_full_under_contention()
+{
+    const size_t producers = 4;
+    mpsc_ring<size_t> ring(1000);
+
+    //Nobody pops, so exactly capacity pushes can win however the producers race
+    std::atomic<size_t> accepted { 0 };
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < ring.capacity(); ++i)
+            {
+                if (ring.try_push(size_t(p))) ++accepted;
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+
+    CHECK(accepted == ring.capacity(), "%zu pushes accepted into %zu slots", accepted.load(), ring.capacity());
+
+    size_t value;
+    size_t drained = 0;
+    while (ring.try_pop(value)) ++drained;
+    CHECK(drained == ring.capacity(), "drained %zu", drained);
+    CHECK(ring.try_push(size_t(0)), "push rejected after draining");
+}
+
+//Event arena
+
+struct tracked_payload
+{
+    static std::atomic<int> alive;
+
+    uint64_t values[5];
+
+    explicit tracked_payload(uint64_t seed)
+    {
+        for (uint64_t& value : values) value = seed;
+        ++alive;
+    }
+    ~tracked_payload() { --alive; }
+};
+std::atomic<int> tracked_payload::alive { 0 };
+
+static void test_arena_alignment()
+{
+    event_arena arena(1024);
+
+    std::vector<void*> allocations;
+    for (size_t i = 0; i < 200; ++i)
+    {
+        const size_t alignment = size_t(1) << (i % 7);
+        void* ptr = arena.allocate(1 + i % 40, alignment);
+        CHECK(reinterpret_cast<uintptr_t>(ptr) % std::max(alignment, alignof(void*)) == 0, "allocation %zu misaligned", i);
+        memset(ptr, int(i), 1 + i % 40);
+        allocations.push_back(ptr);
+    }
+
+    //Nothing overlapped, every allocation still holds what was written to it
+    for (size_t i = 0; i < allocations.size(); ++i)
+    {
+        const uint8_t* bytes = static_cast<const uint8_t*>(allocations[i]);
+        for (size_t b = 0; b < 1 + i % 40; ++b)
+        {
+            CHECK(bytes[b] == uint8_t(i), "allocation %zu was overwritten", i);
+        }
+    }
+
+    for (void* ptr : allocations) event_arena::release(ptr);
+}
+
+static void test_arena_recycles_chunks()
+{
+    event_arena arena(4096);
+
+    //Payloads freed in roughly the order they were made, the same few chunks go round
+    std::vector<tracked_payload*> live;
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        live.push_back(arena.create<tracked_payload>(i));
+        if (live.size() > 64)
+        {
+            CHECK(live.front()->values[4] == i - 64, "payload corrupted");
+            event_arena::destroy(live.front());
+            live.erase(live.begin());
+        }
+    }
+    CHECK(arena.chunk_count() <= 3, "%zu chunks for a steady window of 64 payloads", arena.chunk_count());
+
+    for (tracked_payload* payload : live) event_arena::destroy(payload);
+    CHECK(tracked_payload::alive == 0, "%d payloads never destroyed", tracked_payload::alive.load());
+}
+
+static void test_arena_large_allocation()
+{
+    event_arena arena(256);
+
+    void* large = arena.allocate(10000, 64);
+    CHECK(reinterpret_cast<uintptr_t>(large) % 64 == 0, "large allocation misaligned");
+    memset(large, 0xAB, 10000);
+
+    void* small = arena.allocate(16);
+    memset(small, 0xCD, 16);
+    CHECK(static_cast<uint8_t*>(large)[9999] == 0xAB, "large allocation overwritten");
+
+    event_arena::release(large);
+    event_arena::release(small);
+}
+
+static void test_arena_cross_thread_release()
+{
+    event_arena arena(2048);
+    spsc_ring<tracked_payload*> ring(128);
+    const size_t count = 200000;
+
+    //Built on one thread and released on another, the way capture threads hand payloads to JS
+    bool corrupted = false;
+    std::thread consumer([&] {
+        size_t received = 0;
+        tracked_payload* payload;
+        while (received < count)
+        {
+            if (!ring.try_pop(payload))
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            if (payload->values[0] != received) corrupted = true;
+            event_arena::destroy(payload);
+            ++received;
+        }
+    });
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        tracked_payload* payload = arena.create<tracked_payload>(i);
+        while (!ring.try_push(std::move(payload))) std::this_thread::yield();
+    }
+    consumer.join();
+
+    CHECK(!corrupted, "payloads arrived corrupted or out of order");
+    CHECK(tracked_payload::alive == 0, "%d payloads never destroyed", tracked_payload::alive.load());
+    CHECK(arena.chunk_count() < 100, "%zu chunks, released chunks aren't being reused", arena.chunk_count());
+}
+
+//Work pool
+
+static void test_pool_runs_everything()
+{
+    const size_t count = 100000;
+    std::vector<std::atomic<uint32_t>> runs(count);
+    for (auto& run : runs) run.store(0);
+
+    {
+        work_pool pool(4);
+        CHECK(pool.size() == 4, "%zu threads", pool.size());
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            pool.submit([&runs, i] { ++runs[i]; });
+        }
+        pool.wait_idle();
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        CHECK(runs[i] == 1, "task %zu ran %u times", i, runs[i].load());
+    }
+}
+
+static void test_pool_nested_submit()
+{
+    std::atomic<size_t> leaves { 0 };
+    work_pool pool(3);
+
+    //wait_idle has to cover tasks submitted by tasks
+    for (size_t i = 0; i < 100; ++i)
+    {
+        pool.submit([&] {
+            for (size_t j = 0; j < 100; ++j)
+            {
+                pool.submit([&] { ++leaves; });
+            }
+        });
+    }
+    pool.wait_idle();
+
+    CHECK(leaves == 10000, "%zu of 10000 nested tasks ran", leaves.load());
+}
+
+static void test_pool_stealing()
+{
+    const size_t children = 64;
+    work_pool pool(4);
+
+    std::mutex mutex;
+    std::set<std::thread::id> child_threads;
+    std::thread::id parent_thread;
+    std::atomic<size_t> finished { 0 };
+    bool all_finished = false;
+
+    //Children go onto the parent's own deque and the parent stays busy until they're done, only steals can run them
+    pool.submit([&] {
+        parent_thread = std::this_thread::get_id();
+        for (size_t i = 0; i < children; ++i)
+        {
+            pool.submit([&] {
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    child_threads.insert(std::this_thread::get_id());
+                }
+                std::this_thread::sleep_for(std::chrono::microseconds(200));
+                ++finished;
+            });
+        }
+        all_finished = wait_for([&] { return finished == children; });
+    });
+    pool.wait_idle();
+
+    CHECK(all_finished, "only %zu of %zu children ran while their worker was busy", finished.load(), children);
+    CHECK(child_threads.count(parent_thread) == 0, "a child ran on the busy worker");
+    CHECK(child_threads.size() >= 2, "children were only stolen by %zu worker", child_threads.size());
+}
+
+static void test_pool_destructor_drains()
+{
+    std::atomic<size_t> ran { 0 };
+    {
+        work_pool pool(2);
+        for (size_t i = 0; i < 1000; ++i)
+        {
+            pool.submit([&] { ++ran; });
+        }
+    }
+    CHECK(ran == 1000, "%zu of 1000 tasks ran before the pool joined", ran.load());
+}
+
+struct test_case
+{
+    const char* name;
+    void (*run)();
+};
+
+static const test_case tests[] = {
+    { "ring capacity", test_ring_capacity },
+    { "spsc single thread", test_spsc_single_thread },
+    { "spsc move only", test_spsc_move_only },
+    { "spsc threaded order", test_spsc_threaded_order },
+    { "mpsc single thread", test_mpsc_single_thread },
+    { "mpsc threaded order", test_mpsc_threaded_order },
+    { "mpsc full under contention", test_mpsc_full_under_contention },
+    { "arena alignment", test_arena_alignment },
+    { "arena recycles chunks", test_arena_recycles_chunks },
+    { "arena large allocation", test_arena_large_allocation },
+    { "arena cross thread release", test_arena_cross_thread_release },
+    { "pool runs everything", test_pool_runs_everything },
+    { "pool nested submit", test_pool_nested_submit },
+    { "pool stealing", test_pool_stealing },
+    { "pool destructor drains", test_pool_destructor_drains },
+};
+
+int main(int argc, char** argv)
+{
+    const char* filter = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--filter=", 9) == 0) filter = argv[i] + 9;
+    }
+
+    int failed_tests = 0;
+    for (const test_case& test : tests)
+    {
+        if (filter && !strstr(test.name, filter)) continue;
+
+        printf("%s\n", test.name);
+        const int before = failures;
+        test.run();
+        if (failures != before) ++failed_tests;
+    }
+
+    if (failed_tests)
+    {
+        printf("%d failed\n", failed_tests);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+//Test addon for event_dispatcher, it needs a real ThreadSafeFunction so it can't live in core-test.
+//Driven by test/dispatcher.js.
+
+#include <napi.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "castmate-native/event-dispatcher.hh"
+
+struct test_event
+{
+    uint32_t producer = 0;
+    uint32_t sequence = 0;
+};
+
+//new DispatcherTest(callback, capacity, maxBatch), callback(producer, sequence) once per delivered event
+class dispatcher_test : public Napi::ObjectWrap<dispatcher_test>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports)
+    {
+        Napi::Function constructor = DefineClass(env, "DispatcherTest", {
+            InstanceMethod("postBurst", &dispatcher_test::post_burst),
+            InstanceMethod("postWaiting", &dispatcher_test::post_waiting),
+            InstanceMethod("joinWaiting", &dispatcher_test::join_waiting),
+            InstanceMethod("getStats", &dispatcher_test::get_stats),
+            InstanceMethod("close", &dispatcher_test::close),
+        });
+
+        exports.Set("DispatcherTest", constructor);
+        return exports;
+    }
+
+    dispatcher_test(const Napi::CallbackInfo& info)
+        : Napi::ObjectWrap<dispatcher_test>(info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 3 || !info[0].IsFunction() || !info[1].IsNumber() || !info[2].IsNumber())
+        {
+            Napi::Error::New(env, "DispatcherTest requires a callback, a capacity and a batch size.").ThrowAsJavaScriptException();
+            return;
+        }
+
+        dispatcher.open(env, info[0].As<Napi::Function>(), "DispatcherTest", info[1].As<Napi::Number>().Uint32Value(),
+            [](Napi::Env env, Napi::Function js_callback, test_event& event) {
+                js_callback.Call({ Napi::Number::New(env, event.producer), Napi::Number::New(env, event.sequence) });
+            },
+            info[2].As<Napi::Number>().Uint32Value());
+    }
+
+    //postBurst(producers, perProducer) posts from that many threads and only returns once they're all done, so
+    //nothing can be drained while the burst is going in. Returns how many posts were accepted.
+    Napi::Value post_burst(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+        {
+            Napi::Error::New(env, "postBurst requires a producer count and an event count.").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        const uint32_t producers = info[0].As<Napi::Number>().Uint32Value();
+        const uint32_t per_producer = info[1].As<Napi::Number>().Uint32Value();
+
+        std::atomic<uint32_t> accepted { 0 };
+        std::vector<std::thread> threads;
+        for (uint32_t p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([this, p, per_producer, &accepted] {
+                for (uint32_t i = 0; i < per_producer; ++i)
+                {
+                    if (dispatcher.post({ p, i })) ++accepted;
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+
+        return Napi::Number::New(env, accepted.load());
+    }
+
+    //postWaiting(producers, perProducer) posts with post_wait from background threads and returns straight away,
+    //so the JS thread is free to drain. joinWaiting() returns how many were accepted once they're done.
+    Napi::Value post_waiting(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+
+        if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+        {
+            Napi::Error::New(env, "postWaiting requires a producer count and an event count.").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        const uint32_t producers = info[0].As<Napi::Number>().Uint32Value();
+        const uint32_t per_producer = info[1].As<Napi::Number>().Uint32Value();
+
+        waiting_accepted = 0;
+        for (uint32_t p = 0; p < producers; ++p)
+        {
+            waiting_threads.emplace_back([this, p, per_producer] {
+                for (uint32_t i = 0; i < per_producer; ++i)
+                {
+                    if (dispatcher.post_wait({ p, i }, [this] { return stop_waiting.load(); })) ++waiting_accepted;
+                }
+            });
+        }
+
+        return env.Undefined();
+    }
+
+    Napi::Value join_waiting(const Napi::CallbackInfo& info)
+    {
+        for (std::thread& thread : waiting_threads) thread.join();
+        waiting_threads.clear();
+        return Napi::Number::New(info.Env(), waiting_accepted.load());
+    }
+
+    Napi::Value get_stats(const Napi::CallbackInfo& info)
+    {
+        Napi::Env env = info.Env();
+
+        Napi::Object result = Napi::Object::New(env);
+        result.Set("dropped", Napi::Number::New(env, double(dispatcher.dropped())));
+        result.Set("batches", Napi::Number::New(env, double(dispatcher.batches())));
+        result.Set("largestBatch", Napi::Number::New(env, double(dispatcher.largest_batch())));
+        return result;
+    }
+
+    Napi::Value close(const Napi::CallbackInfo& info)
+    {
+        stop_waiting = true;
+        for (std::thread& thread : waiting_threads) thread.join();
+        waiting_threads.clear();
+        dispatcher.close();
+        return info.Env().Undefined();
+    }
+
+private:
+    event_dispatcher<test_event> dispatcher;
+
+    std::vector<std::thread> waiting_threads;
+    std::atomic<uint32_t> waiting_accepted { 0 };
+    std::atomic<bool> stop_waiting { false };
+};
+
+Napi::Object Init(Napi::Env env, Napi::Object exports)
+{
+    return dispatcher_test::init(env, exports);
+}
+
+NODE_API_MODULE(NODE_GYP_MODULE_NAME, Init)
@@ -0,0 +1,134 @@
+// Tests event_dispatcher through the test addon, run by test/run.js after core-test
+
+const path = require("path")
+
+const { DispatcherTest } = require(path.join(__dirname, "..", "build", "Release", "castmate-native-core-test-addon.node"))
+
+let failed = 0
+
+function check(condition, message) {
+	if (!condition) {
+		console.log(`  FAILED: ${message}`)
+		failed++
+	}
+	return condition
+}
+
+//Resolves once count events arrived, or after a few seconds so a lost event fails instead of hanging
+function waitForEvents(received, count) {
+	const deadline = Date.now() + 5000
+	return new Promise((resolve) => {
+		const poll = () => {
+			if (received.length >= count || Date.now() > deadline) return resolve()
+			setTimeout(poll, 1)
+		}
+		poll()
+	})
+}
+
+function createDispatcher(capacity, maxBatch) {
+	const received = []
+	const dispatcher = new DispatcherTest((producer, sequence) => received.push([producer, sequence]), capacity, maxBatch)
+	return { dispatcher, received }
+}
+
+function checkOrder(received, producers) {
+	const next = new Array(producers).fill(0)
+	for (const [producer, sequence] of received) {
+		if (!check(sequence == next[producer], `producer ${producer} sent ${sequence}, expected ${next[producer]}`)) {
+			return
+		}
+		next[producer]++
+	}
+}
+
+async function testBoundedDrop() {
+	console.log("dispatcher bounded drop")
+
+	//The JS thread is blocked for the whole burst, so the ring takes exactly its capacity and drops the rest
+	const { dispatcher, received } = createDispatcher(64, 16)
+	const accepted = dispatcher.postBurst(1, 1000)
+	check(accepted == 64, `${accepted} accepted into 64 slots`)
+
+	await waitForEvents(received, 64)
+	await new Promise((resolve) => setTimeout(resolve, 20))
+
+	const stats = dispatcher.getStats()
+	check(received.length == 64, `${received.length} delivered`)
+	check(stats.dropped == 936, `${stats.dropped} dropped`)
+	checkOrder(received, 1)
+
+	dispatcher.close()
+}
+
+async function testBatchDrain() {
+	console.log("dispatcher batch drain")
+
+	const { dispatcher, received } = createDispatcher(4096, 256)
+	const accepted = dispatcher.postBurst(4, 1000)
+	check(accepted == 4000, `${accepted} of 4000 accepted with room for them all`)
+
+	await waitForEvents(received, 4000)
+
+	//A backlog drains in full batches, yielding to the event loop between them
+	const stats = dispatcher.getStats()
+	check(received.length == 4000, `${received.length} of 4000 delivered`)
+	check(stats.dropped == 0, `${stats.dropped} dropped`)
+	check(stats.largestBatch == 256, `largest batch ${stats.largestBatch}, expected 256`)
+	check(stats.batches >= Math.ceil(4000 / 256), `${stats.batches} batches`)
+	checkOrder(received, 4)
+
+	dispatcher.close()
+}
+
+async function testSteadyPosting() {
+	console.log("dispatcher steady posting")
+
+	//Small bursts with the event loop free in between, nothing should be dropped or held back
+	const { dispatcher, received } = createDispatcher(128, 32)
+	for (let i = 0; i < 50; ++i) {
+		dispatcher.postBurst(2, 10)
+		await waitForEvents(received, (i + 1) * 20)
+	}
+
+	const stats = dispatcher.getStats()
+	check(received.length == 1000, `${received.length} of 1000 delivered`)
+	check(stats.dropped == 0, `${stats.dropped} dropped`)
+	check(stats.largestBatch <= 32, `largest batch ${stats.largestBatch} over the limit of 32`)
+
+	dispatcher.close()
+	check(dispatcher.postBurst(1, 10) == 0, "posts accepted after close")
+}
+
+async function testPostWait() {
+	console.log("dispatcher post wait")
+
+	//Far more than fits, producers have to wait on the JS thread instead of dropping
+	const { dispatcher, received } = createDispatcher(64, 16)
+	dispatcher.postWaiting(2, 2000)
+	await waitForEvents(received, 4000)
+
+	const accepted = dispatcher.joinWaiting()
+	const stats = dispatcher.getStats()
+	check(accepted == 4000, `${accepted} of 4000 accepted`)
+	check(received.length == 4000, `${received.length} of 4000 delivered`)
+	check(stats.dropped == 0, `${stats.dropped} dropped`)
+	checkOrder(received, 2)
+
+	dispatcher.close()
+}
+
+async function main() {
+	await testBoundedDrop()
+	await testBatchDrain()
+	await testSteadyPosting()
+	await testPostWait()
+
+	if (failed) {
+		console.log(`${failed} failed`)
+		process.exit(1)
+	}
+	console.log("passed")
+}
+
+main()
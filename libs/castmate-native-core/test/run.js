@@ -0,0 +1,21 @@
+// Runs the native core tests, build first with `yarn rebuild`
+// Options are passed through to core-test: --filter=name
+
+const path = require("path")
+const { spawnSync } = require("child_process")
+
+const executable = process.platform == "win32" ? "castmate-native-core-test.exe" : "castmate-native-core-test"
+const binary = path.join(__dirname, "..", "build", "Release", executable)
+
+function run(command, args) {
+	const result = spawnSync(command, args, { stdio: "inherit" })
+	if (result.error) {
+		console.error(`Unable to run ${command}: ${result.error.message}`)
+		return 1
+	}
+	return result.status ?? 1
+}
+
+//The dispatcher needs a real event loop, it's tested through an addon in its own node process
+const status = run(binary, process.argv.slice(2)) || run(process.execPath, [path.join(__dirname, "dispatcher.js")])
+process.exit(status)
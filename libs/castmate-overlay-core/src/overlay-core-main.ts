@@ -8,3 +8,4 @@ export * from "./util/stylesheets"
 export * from "./util/animation-util"
 export * from "./util/widget-util"
 export * from "./util/bridge"
+export * from "./util/audio-stream"
@@ -0,0 +1,171 @@
+//Player for the sound plugin's mix stream, see MixStreamService. Frames are an 8 byte header (sequence u32,
+//frame count u16, channels u8, flags u8) then one Opus packet at 48kHz. Players without a WebCodecs Opus decoder ask
+//for the PCM fallback instead, where the header is followed by interleaved 16 bit little endian samples.
+
+const streamSampleRate = 48000
+const streamChannels = 2
+const headerSize = 8
+const resyncFlag = 1
+const opusFlag = 2
+
+const opusConfig: AudioDecoderConfig = {
+	codec: "opus",
+	sampleRate: streamSampleRate,
+	numberOfChannels: streamChannels,
+}
+
+//How far behind live the timeline starts, frames arrive every 20ms give or take the sender's timer
+const streamLatencySec = 0.08
+
+export interface AudioStreamConnection {
+	close(): void
+}
+
+async function canDecodeOpus() {
+	if (typeof AudioDecoder == "undefined") return false
+	try {
+		const support = await AudioDecoder.isConfigSupported(opusConfig)
+		return support.supported == true
+	} catch {
+		return false
+	}
+}
+
+/**
+ * Plays a mix stream until closed, reconnecting if the connection drops. Frames are scheduled back to back on one
+ * WebAudio timeline, the timeline restarts after the stream idles or frames were dropped.
+ */
+export function connectAudioStream(url: string): AudioStreamConnection {
+	let socket: WebSocket | undefined = undefined
+	let context: AudioContext | undefined = undefined
+	let decoder: AudioDecoder | undefined = undefined
+	let nextTime = 0
+	let lastSequence = -1
+	let closed = false
+
+	//Timestamps of Opus chunks that start a new timeline, looked up again once they've been decoded
+	const resyncTimestamps = new Set<number>()
+
+	function schedule(buffer: AudioBuffer, resync: boolean) {
+		if (!context) return
+
+		if (resync || nextTime < context.currentTime) {
+			nextTime = context.currentTime + streamLatencySec
+		}
+
+		const source = context.createBufferSource()
+		source.buffer = buffer
+		source.connect(context.destination)
+		source.start(nextTime)
+
+		nextTime += buffer.duration
+	}
+
+	function playDecoded(data: AudioData) {
+		const resync = resyncTimestamps.delete(data.timestamp)
+
+		if (context) {
+			const buffer = context.createBuffer(data.numberOfChannels, data.numberOfFrames, data.sampleRate)
+			for (let c = 0; c < data.numberOfChannels; ++c) {
+				data.copyTo(buffer.getChannelData(c), { planeIndex: c, format: "f32-planar" })
+			}
+			schedule(buffer, resync)
+		}
+
+		data.close()
+	}
+
+	function createDecoder() {
+		const created = new AudioDecoder({
+			output: playDecoded,
+			error(err) {
+				console.error("Mix stream decode failed", err)
+				//A closed decoder can't be reused, the next frame creates a new one and starts a new timeline
+				if (decoder === created) decoder = undefined
+				lastSequence = -1
+			},
+		})
+		created.configure(opusConfig)
+		return created
+	}
+
+	function playFrame(data: ArrayBuffer) {
+		if (data.byteLength < headerSize) return
+
+		const view = new DataView(data)
+		const sequence = view.getUint32(0, true)
+		const frames = view.getUint16(4, true)
+		const channels = view.getUint8(6)
+		const flags = view.getUint8(7)
+
+		if (frames == 0 || channels == 0) return
+
+		const opus = (flags & opusFlag) != 0
+		if (opus ? data.byteLength == headerSize : data.byteLength < headerSize + frames * channels * 2) return
+
+		context ??= new AudioContext({ sampleRate: streamSampleRate })
+
+		const resync = (flags & resyncFlag) != 0 || sequence != lastSequence + 1
+		lastSequence = sequence
+
+		if (opus) {
+			decoder ??= createDecoder()
+
+			const timestamp = Math.round((sequence * frames * 1000000) / streamSampleRate)
+			if (resync) {
+				//Only grows if a decoder hands back different timestamps, the timeline check in schedule still applies
+				if (resyncTimestamps.size > 16) resyncTimestamps.clear()
+				resyncTimestamps.add(timestamp)
+			}
+
+			decoder.decode(new EncodedAudioChunk({ type: "key", timestamp, data: new Uint8Array(data, headerSize) }))
+			return
+		}
+
+		const buffer = context.createBuffer(channels, frames, streamSampleRate)
+		const samples = new Int16Array(data, headerSize, frames * channels)
+		for (let c = 0; c < channels; ++c) {
+			const channelData = buffer.getChannelData(c)
+			for (let i = 0; i < frames; ++i) {
+				channelData[i] = samples[i * channels + c] / 32768
+			}
+		}
+
+		schedule(buffer, resync)
+	}
+
+	function connect(codec: "opus" | "pcm") {
+		const streamUrl = new URL(url)
+		if (codec == "pcm") streamUrl.searchParams.set("codec", "pcm")
+
+		socket = new WebSocket(streamUrl)
+		socket.binaryType = "arraybuffer"
+
+		socket.addEventListener("message", (ev) => {
+			if (!(ev.data instanceof ArrayBuffer)) return
+			playFrame(ev.data)
+		})
+
+		socket.addEventListener("close", () => {
+			if (closed) return
+			setTimeout(() => {
+				if (!closed) connect(codec)
+			}, 1000)
+		})
+	}
+
+	canDecodeOpus().then((opus) => {
+		if (!closed) connect(opus ? "opus" : "pcm")
+	})
+
+	return {
+		close() {
+			closed = true
+			socket?.close()
+			if (decoder?.state != "closed") decoder?.close()
+			decoder = undefined
+			context?.close()
+			context = undefined
+		},
+	}
+}
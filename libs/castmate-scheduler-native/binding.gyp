@@ -0,0 +1,49 @@
+{
+    "targets": [
+        {
+            "target_name": "castmate-scheduler-native",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "src/native-index.cc",
+                "src/scheduler.cc",
+                "src/timer-wheel.cc"
+            ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "conditions": [
+                ["OS=='win'", {
+                    "libraries": [ "winmm.lib" ]
+                }]
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+        },
+        {
+            # Plain executable, no node involved, so the wheel can be tested anywhere it builds.
+            "target_name": "castmate-scheduler-native-test",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "test/timer-wheel-test.cc",
+                "src/timer-wheel.cc"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            }
+        }
+    ]
+}
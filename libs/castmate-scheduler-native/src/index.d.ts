@@ -0,0 +1,34 @@
+declare namespace CastmateSchedulerNative {
+	interface SchedulerStats {
+		/** Timers still waiting in the wheel */
+		pending: number
+		fired: number
+		averageLatenessUs: number
+		maxLatenessUs: number
+	}
+
+	class Scheduler {
+		constructor()
+
+		/** Runs callback after delayMs, it's passed how late it fired in milliseconds. Returns a handle for clearTimeout */
+		setTimeout(callback: (latenessMs: number) => any, delayMs: number): number
+		/** Returns false if the timer already ran or was cleared */
+		clearTimeout(handle: number): boolean
+		/** Resolves with the lateness in milliseconds, rejects with the signal's reason if it's aborted first */
+		sleep(delayMs: number, signal?: AbortSignal): Promise<number>
+		/** Milliseconds on the scheduler's monotonic clock */
+		now(): number
+		getStats(): SchedulerStats
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateSchedulerNative
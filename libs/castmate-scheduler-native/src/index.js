@@ -0,0 +1,76 @@
+const bindings = require("bindings")
+
+const native = bindings({
+	bindings: "castmate-scheduler-native",
+})
+
+class Scheduler {
+	constructor() {
+		this._callbacks = new Map()
+		this._native = new native.NativeScheduler((batch) => {
+			//One throwing callback mustn't strand the rest of the batch, their handles are already gone natively
+			const errors = []
+			for (let i = 0; i < batch.length; i += 2) {
+				const callback = this._callbacks.get(batch[i])
+				if (!callback) continue
+				this._callbacks.delete(batch[i])
+				try {
+					callback(batch[i + 1] / 1000)
+				} catch (err) {
+					errors.push(err)
+				}
+			}
+
+			if (errors.length == 1) throw errors[0]
+			if (errors.length > 1) throw new AggregateError(errors, `${errors.length} timer callbacks threw`)
+		})
+	}
+
+	setTimeout(callback, delayMs) {
+		const handle = this._native.schedule(delayMs)
+		this._callbacks.set(handle, callback)
+		return handle
+	}
+
+	clearTimeout(handle) {
+		//Dropping the callback is what guarantees it won't run, even if the timer already fired and is in flight
+		if (!this._callbacks.delete(handle)) return false
+		this._native.cancel(handle)
+		return true
+	}
+
+	sleep(delayMs, signal) {
+		return new Promise((resolve, reject) => {
+			if (signal?.aborted) return reject(signal.reason)
+
+			const onAbort = () => {
+				this.clearTimeout(handle)
+				reject(signal.reason)
+			}
+
+			const handle = this.setTimeout((latenessMs) => {
+				signal?.removeEventListener("abort", onAbort)
+				resolve(latenessMs)
+			}, delayMs)
+
+			signal?.addEventListener("abort", onAbort, { once: true })
+		})
+	}
+
+	now() {
+		return this._native.now() / 1000
+	}
+
+	getStats() {
+		return this._native.getStats()
+	}
+}
+
+module.exports = {
+	Scheduler,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,272 @@
+#include "scheduler.hh"
+#include "castmate-native/trace.hh"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+//The last stretch before a deadline is spun instead of slept, OS sleeps overshoot by about a timer period.
+#ifdef _WIN32
+static const int64_t spin_margin_us = 1000;
+#else
+static const int64_t spin_margin_us = 200;
+#endif
+
+//In wakeups, each carries every timer that expired in it
+static const size_t expired_event_capacity = 1024;
+
+Napi::Object scheduler::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeScheduler", {
+        InstanceMethod("schedule", &scheduler::schedule),
+        InstanceMethod("cancel", &scheduler::cancel),
+        InstanceMethod("now", &scheduler::now),
+        InstanceMethod("getStats", &scheduler::get_stats),
+    });
+
+    exports.Set("NativeScheduler", constructor);
+    return exports;
+}
+
+scheduler::scheduler(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<scheduler>(info)
+    , epoch(std::chrono::steady_clock::now())
+    , wheel(0)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsFunction())
+    {
+        Napi::Error::New(env, "NativeScheduler requires a callback.").ThrowAsJavaScriptException();
+        return;
+    }
+
+    events.open(env, info[0].As<Napi::Function>(), "SchedulerTSFN", expired_event_capacity);
+    //Only hold the process open while timers are pending, like setTimeout.
+    events.unref(env);
+
+    timer_thread = std::thread(&scheduler::thread_main, this);
+}
+
+void scheduler::Finalize(Napi::Env env)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+    }
+    cv.notify_one();
+
+    if (timer_thread.joinable())
+    {
+        timer_thread.join();
+    }
+
+    events.close();
+}
+
+int64_t scheduler::now_us() const
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+//1ms system timer resolution costs power machine wide, so it's only held while timers are pending.
+static void set_high_resolution(bool& active, bool wanted)
+{
+    if (active == wanted) return;
+    active = wanted;
+
+#ifdef _WIN32
+    if (wanted)
+    {
+        timeBeginPeriod(1);
+    }
+    else
+    {
+        timeEndPeriod(1);
+    }
+#endif
+}
+
+void scheduler::thread_main()
+{
+    bool high_resolution = false;
+
+    std::vector<timer_wheel::expired_timer> expired;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (running)
+    {
+        const int64_t wakeup = wheel.next_wakeup_us();
+        if (wakeup < 0)
+        {
+            set_high_resolution(high_resolution, false);
+            sleeping_until = INT64_MAX;
+            cv.wait(lock);
+            continue;
+        }
+
+        set_high_resolution(high_resolution, true);
+
+        int64_t now = now_us();
+        if (now < wakeup - spin_margin_us)
+        {
+            //Woken early by a new timer or by the timeout, either way recheck what's next
+            sleeping_until = wakeup;
+            cv.wait_until(lock, epoch + std::chrono::microseconds(wakeup - spin_margin_us));
+            continue;
+        }
+
+        if (now < wakeup)
+        {
+            lock.unlock();
+            while ((now = now_us()) < wakeup)
+            {
+                std::this_thread::yield();
+            }
+            lock.lock();
+        }
+
+        sleeping_until = -1;
+        wheel.advance(now, expired);
+        if (expired.empty()) continue;
+
+        std::vector<double> data;
+        data.reserve(expired.size() * 2);
+        for (const auto& timer : expired)
+        {
+            data.push_back(double(timer.handle));
+            data.push_back(double(timer.lateness_us));
+
+            total_lateness_us += uint64_t(timer.lateness_us);
+            int64_t previous_max = max_lateness_us;
+            while (timer.lateness_us > previous_max && !max_lateness_us.compare_exchange_weak(previous_max, timer.lateness_us)) {}
+        }
+        fired += expired.size();
+        expired.clear();
+
+        auto js_thread_callback = [this, data = std::move(data)](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            TRACE_SCOPE("timer batch");
+
+            Napi::Float64Array batch = Napi::Float64Array::New(env, data.size());
+            std::copy(data.begin(), data.end(), batch.Data());
+
+            timer_delivered(env, data.size() / 2);
+            js_callback.Call({ batch });
+        };
+
+        //Unlocked while JS catches up, it may be calling schedule or cancel
+        lock.unlock();
+        events.post_wait(js_thread_callback, [this] { return !running; });
+        lock.lock();
+    }
+
+    set_high_resolution(high_resolution, false);
+}
+
+void scheduler::timer_delivered(Napi::Env env, size_t count)
+{
+    js_pending -= std::min(js_pending, count);
+    if (js_pending == 0)
+    {
+        events.unref(env);
+    }
+}
+
+//schedule(delayMs) -> handle
+Napi::Value scheduler::schedule(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::Error::New(env, "schedule requires a delay.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const double delay_ms = std::max(0.0, info[0].As<Napi::Number>().DoubleValue());
+    const int64_t deadline = now_us() + int64_t(delay_ms * 1000);
+
+    uint64_t handle;
+    bool wake = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        handle = wheel.insert(deadline);
+        wake = sleeping_until < 0 || deadline < sleeping_until;
+    }
+
+    if (handle == timer_wheel::invalid_handle)
+    {
+        Napi::Error::New(env, "Too many pending timers.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (wake)
+    {
+        cv.notify_one();
+    }
+
+    if (js_pending++ == 0)
+    {
+        events.ref(env);
+    }
+
+    return Napi::Number::New(env, double(handle));
+}
+
+//cancel(handle) -> false if it already fired or was cancelled
+Napi::Value scheduler::cancel(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::Error::New(env, "cancel requires a handle.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const uint64_t handle = uint64_t(info[0].As<Napi::Number>().DoubleValue());
+
+    bool cancelled;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = wheel.cancel(handle);
+    }
+
+    if (cancelled)
+    {
+        timer_delivered(env, 1);
+    }
+
+    return Napi::Boolean::New(env, cancelled);
+}
+
+//Microseconds on the scheduler's clock
+Napi::Value scheduler::now(const Napi::CallbackInfo& info)
+{
+    return Napi::Number::New(info.Env(), double(now_us()));
+}
+
+Napi::Value scheduler::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    size_t pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending = wheel.size();
+    }
+
+    const uint64_t fired_count = fired;
+
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("pending", Napi::Number::New(env, double(pending)));
+    stats.Set("fired", Napi::Number::New(env, double(fired_count)));
+    stats.Set("averageLatenessUs", Napi::Number::New(env, fired_count > 0 ? double(total_lateness_us) / fired_count : 0));
+    stats.Set("maxLatenessUs", Napi::Number::New(env, double(max_lateness_us.load())));
+    return stats;
+}
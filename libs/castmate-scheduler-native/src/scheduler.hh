@@ -0,0 +1,57 @@
+#pragma once
+
+#include <napi.h>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "castmate-native/event-dispatcher.hh"
+
+#include "timer-wheel.hh"
+
+//Timer wheel driven by its own thread. Every timer that expires in one wakeup goes to JS in a single
+//call as a Float64Array of [handle, latenessUs, ...] pairs.
+class scheduler : public Napi::ObjectWrap<scheduler>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    scheduler(const Napi::CallbackInfo& info);
+    virtual void Finalize(Napi::Env env);
+
+    Napi::Value schedule(const Napi::CallbackInfo& info);
+    Napi::Value cancel(const Napi::CallbackInfo& info);
+    Napi::Value now(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+
+private:
+    int64_t now_us() const;
+    void thread_main();
+    void timer_delivered(Napi::Env env, size_t count);
+
+    //Expired timers can't be dropped, the thread waits for room instead
+    js_call_dispatcher events;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    timer_wheel wheel;
+    //Earliest deadline the thread is currently sleeping towards
+    int64_t sleeping_until = -1;
+    //Written under mutex, also read without it while waiting on events
+    std::atomic<bool> running { true };
+    std::thread timer_thread;
+
+    //Timers JS still expects a call for, the dispatcher only keeps the process alive while there are some.
+    size_t js_pending = 0;
+
+    std::atomic<uint64_t> fired { 0 };
+    std::atomic<uint64_t> total_lateness_us { 0 };
+    std::atomic<int64_t> max_lateness_us { 0 };
+};
@@ -0,0 +1,240 @@
+#include "timer-wheel.hh"
+
+#include <algorithm>
+#include <cstdint>
+
+static const int64_t tick_us = 1000;
+
+//Rounded up so a timer is never collected before its deadline.
+static uint64_t tick_for(int64_t time_us)
+{
+    return time_us <= 0 ? 0 : uint64_t((time_us + tick_us - 1) / tick_us);
+}
+
+timer_wheel::timer_wheel(int64_t now_us)
+    : current_tick(uint64_t(std::max<int64_t>(0, now_us) / tick_us))
+{
+    for (uint32_t i = 0; i < level_count; ++i)
+    {
+        levels[i].heads.assign(slot_count(i), no_node);
+        levels[i].occupied.assign((slot_count(i) + 63) / 64, 0);
+    }
+}
+
+uint32_t timer_wheel::slot_shift(uint32_t level_index) const
+{
+    return level_index == 0 ? 0 : level0_bits + (level_index - 1) * level_bits;
+}
+
+uint64_t timer_wheel::insert(int64_t deadline_us)
+{
+    uint32_t index;
+    if (!free_nodes.empty())
+    {
+        index = free_nodes.back();
+        free_nodes.pop_back();
+    }
+    else
+    {
+        index = uint32_t(nodes.size());
+        //Handles only have room for 24 bits of index
+        if (index >= (1u << 24) - 1) return invalid_handle;
+        nodes.emplace_back();
+    }
+
+    node& timer = nodes[index];
+    timer.deadline_us = deadline_us;
+    timer.tick = std::max(tick_for(deadline_us), current_tick);
+
+    link(index);
+    ++count;
+    return make_handle(index, timer.generation);
+}
+
+bool timer_wheel::cancel(uint64_t handle)
+{
+    if (handle == invalid_handle) return false;
+
+    const uint32_t index = uint32_t(handle & 0xFFFFFF) - 1;
+    const uint32_t generation = uint32_t(handle >> 24);
+    if (index >= nodes.size()) return false;
+
+    node& timer = nodes[index];
+    if (timer.generation != generation || timer.level == level_count) return false;
+
+    unlink(index);
+    ++timer.generation;
+    free_nodes.push_back(index);
+    --count;
+    return true;
+}
+
+void timer_wheel::link(uint32_t index)
+{
+    node& timer = nodes[index];
+    //A timer cascaded after its tick goes straight into the level 0 slot that's collected next
+    if (timer.tick < current_tick) timer.tick = current_tick;
+    const uint64_t delta = timer.tick - current_tick;
+
+    uint32_t level_index = 0;
+    while (level_index + 1 < level_count && delta >= (uint64_t(1) << slot_shift(level_index + 1)))
+    {
+        ++level_index;
+    }
+
+    uint64_t slot_tick = timer.tick;
+    //Beyond the top level, park in its furthest slot and cascade again when it comes around
+    const uint64_t top_range = uint64_t(1) << (slot_shift(level_count - 1) + level_bits);
+    if (level_index == level_count - 1 && delta >= top_range)
+    {
+        slot_tick = current_tick + top_range - (uint64_t(1) << slot_shift(level_index));
+    }
+
+    const uint32_t slot = uint32_t((slot_tick >> slot_shift(level_index)) & (slot_count(level_index) - 1));
+
+    level& target = levels[level_index];
+    timer.level = uint16_t(level_index);
+    timer.slot = uint16_t(slot);
+    timer.prev = no_node;
+    timer.next = target.heads[slot];
+    if (timer.next != no_node) nodes[timer.next].prev = index;
+    target.heads[slot] = index;
+    target.occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void timer_wheel::unlink(uint32_t index)
+{
+    node& timer = nodes[index];
+    level& source = levels[timer.level];
+
+    if (timer.prev != no_node)
+    {
+        nodes[timer.prev].next = timer.next;
+    }
+    else
+    {
+        source.heads[timer.slot] = timer.next;
+    }
+    if (timer.next != no_node) nodes[timer.next].prev = timer.prev;
+
+    if (source.heads[timer.slot] == no_node)
+    {
+        source.occupied[timer.slot / 64] &= ~(uint64_t(1) << (timer.slot % 64));
+    }
+
+    timer.level = uint16_t(level_count);
+    timer.prev = no_node;
+    timer.next = no_node;
+}
+
+void timer_wheel::cascade(uint32_t level_index)
+{
+    level& source = levels[level_index];
+    const uint32_t slot = uint32_t((current_tick >> slot_shift(level_index)) & (slot_count(level_index) - 1));
+
+    uint32_t index = source.heads[slot];
+    source.heads[slot] = no_node;
+    source.occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+
+    while (index != no_node)
+    {
+        const uint32_t next = nodes[index].next;
+        link(index);
+        index = next;
+    }
+}
+
+void timer_wheel::advance(int64_t now_us, std::vector<expired_timer>& expired)
+{
+    const uint64_t target_tick = uint64_t(std::max<int64_t>(0, now_us) / tick_us);
+
+    while (current_tick <= target_tick)
+    {
+        //Whenever a lower level wraps, pull the matching slot of the level above down into it
+        for (uint32_t i = 1; i < level_count; ++i)
+        {
+            if ((current_tick & ((uint64_t(1) << slot_shift(i)) - 1)) != 0) break;
+            cascade(i);
+        }
+
+        level& wheel = levels[0];
+        const uint32_t slot = uint32_t(current_tick & (level0_slots - 1));
+
+        uint32_t index = wheel.heads[slot];
+        while (index != no_node)
+        {
+            node& timer = nodes[index];
+            const uint32_t next = timer.next;
+
+            //Cascades can leave a timer from a later turn in this slot
+            if (timer.tick <= current_tick)
+            {
+                const uint64_t handle = make_handle(index, timer.generation);
+                const int64_t lateness = now_us - timer.deadline_us;
+
+                unlink(index);
+                ++timer.generation;
+                free_nodes.push_back(index);
+                --count;
+
+                expired.push_back({ handle, std::max<int64_t>(0, lateness) });
+            }
+            index = next;
+        }
+
+        if (current_tick == target_tick) break;
+
+        //Skip straight to the next slot that has anything to do
+        const int64_t wakeup = next_wakeup_us();
+        uint64_t next_tick = wakeup < 0 ? target_tick : uint64_t(wakeup / tick_us);
+        if (next_tick <= current_tick) next_tick = current_tick + 1;
+        current_tick = std::min(next_tick, target_tick);
+    }
+}
+
+int32_t timer_wheel::next_occupied(uint32_t level_index, uint32_t first_offset) const
+{
+    const level& wheel = levels[level_index];
+    const uint32_t slots = slot_count(level_index);
+    const uint32_t start = uint32_t((current_tick >> slot_shift(level_index)) & (slots - 1));
+
+    for (uint32_t offset = first_offset; offset < slots + first_offset; ++offset)
+    {
+        const uint32_t slot = (start + offset) & (slots - 1);
+        const uint64_t word = wheel.occupied[slot / 64];
+        if (word == 0)
+        {
+            //Jump to the next word
+            offset += 63 - (slot % 64);
+            continue;
+        }
+        if (word & (uint64_t(1) << (slot % 64))) return int32_t(offset);
+    }
+    return -1;
+}
+
+int64_t timer_wheel::next_wakeup_us() const
+{
+    if (count == 0) return -1;
+
+    uint64_t tick = UINT64_MAX;
+
+    const int32_t distance = next_occupied(0, 0);
+    if (distance >= 0)
+    {
+        tick = current_tick + uint64_t(distance);
+    }
+
+    //A cascade can be due before the next level 0 timer, advance must not step over its boundary
+    for (uint32_t i = 1; i < level_count; ++i)
+    {
+        //The current slot was cascaded when the wheel entered it, anything linked there since is a whole turn out,
+        //so it's searched last
+        const int32_t level_distance = next_occupied(i, 1);
+        if (level_distance < 0) continue;
+
+        const uint64_t slot_index = (current_tick >> slot_shift(i)) + uint64_t(level_distance);
+        tick = std::min(tick, slot_index << slot_shift(i));
+    }
+    return int64_t(tick) * tick_us;
+}
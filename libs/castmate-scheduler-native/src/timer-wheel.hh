@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Hierarchical timer wheel with 1ms ticks. Level 0 has 256 slots of one tick, each level above has 64 slots that
+//each span a whole turn of the level below, so four levels reach about 18.6 hours before timers park in the last
+//slot and get re-cascaded. Timers live in a slab and sit in an intrusive list per slot, insert and cancel are O(1).
+//
+//Handles pack the slab index with a generation so a stale handle can never cancel a reused slot.
+class timer_wheel
+{
+public:
+    static constexpr uint64_t invalid_handle = 0;
+
+    struct expired_timer
+    {
+        uint64_t handle;
+        //How long after its deadline the timer was collected
+        int64_t lateness_us;
+    };
+
+    explicit timer_wheel(int64_t now_us);
+
+    uint64_t insert(int64_t deadline_us);
+    bool cancel(uint64_t handle);
+
+    //Collects every timer due at now_us, cascading higher levels as the wheel turns.
+    void advance(int64_t now_us, std::vector<expired_timer>& expired);
+
+    //Earliest time something might need to happen, either a timer or a cascade. -1 if the wheel is empty.
+    int64_t next_wakeup_us() const;
+
+    size_t size() const { return count; }
+
+private:
+    static constexpr uint32_t level0_bits = 8;
+    static constexpr uint32_t level_bits = 6;
+    static constexpr uint32_t level_count = 4;
+    static constexpr uint32_t level0_slots = 1 << level0_bits;
+    static constexpr uint32_t level_slots = 1 << level_bits;
+    static constexpr uint32_t no_node = 0xFFFFFFFF;
+
+    struct node
+    {
+        int64_t deadline_us = 0;
+        uint64_t tick = 0;
+        uint32_t prev = no_node;
+        uint32_t next = no_node;
+        uint32_t generation = 1;
+        //Level and slot this node is linked into, level_count when it's free
+        uint16_t level = level_count;
+        uint16_t slot = 0;
+    };
+
+    struct level
+    {
+        std::vector<uint32_t> heads;
+        //One bit per occupied slot so finding the next timer doesn't scan empty slots
+        std::vector<uint64_t> occupied;
+    };
+
+    static uint64_t make_handle(uint32_t index, uint32_t generation) { return (uint64_t(generation) << 24) | (index + 1); }
+
+    uint32_t slot_shift(uint32_t level_index) const;
+    uint32_t slot_count(uint32_t level_index) const { return level_index == 0 ? level0_slots : level_slots; }
+
+    void link(uint32_t index);
+    void unlink(uint32_t index);
+    void cascade(uint32_t level_index);
+    //Distance in slots from the current position to the next occupied slot of a level, searching from first_offset
+    //and wrapping back round, -1 if empty
+    int32_t next_occupied(uint32_t level_index, uint32_t first_offset) const;
+
+    std::vector<node> nodes;
+    std::vector<uint32_t> free_nodes;
+    level levels[level_count];
+
+    uint64_t current_tick;
+    size_t count = 0;
+};
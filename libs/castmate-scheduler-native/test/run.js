@@ -0,0 +1,15 @@
+// Runs the native timer wheel test, build first with `yarn rebuild`
+// Options are passed through: --seed=1 --rounds=200000
+
+const path = require("path")
+const { spawnSync } = require("child_process")
+
+const executable = process.platform == "win32" ? "castmate-scheduler-native-test.exe" : "castmate-scheduler-native-test"
+const binary = path.join(__dirname, "..", "build", "Release", executable)
+
+const result = spawnSync(binary, process.argv.slice(2), { stdio: "inherit" })
+if (result.error) {
+	console.error(`Unable to run ${binary}: ${result.error.message}`)
+	process.exit(1)
+}
+process.exit(result.status ?? 1)
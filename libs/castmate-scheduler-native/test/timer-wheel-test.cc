@@ -0,0 +1,197 @@
+//Randomized test of the timer wheel against a plain map of deadlines.
+//Run through `yarn test`, options: --seed=N --rounds=N
+
+#include "../src/timer-wheel.hh"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <vector>
+
+static const int64_t tick_us = 1000;
+//Past the top level of the wheel, so parked timers get cascaded more than once
+static const int64_t max_delay_us = int64_t(3) << 36;
+
+static int failures = 0;
+
+#define CHECK(condition, ...)                                   \
+    do                                                          \
+    {                                                           \
+        if (!(condition))                                       \
+        {                                                       \
+            printf("  FAILED %s:%d: ", __FILE__, __LINE__);     \
+            printf(__VA_ARGS__);                                \
+            printf("\n");                                       \
+            ++failures;                                         \
+            return;                                             \
+        }                                                       \
+    } while (0)
+
+static int64_t due_tick(int64_t deadline_us)
+{
+    return deadline_us <= 0 ? 0 : (deadline_us + tick_us - 1) / tick_us;
+}
+
+struct model
+{
+    timer_wheel wheel;
+    std::map<uint64_t, int64_t> deadlines;
+    int64_t now = 0;
+
+    explicit model(int64_t start_us) : wheel(start_us), now(start_us) {}
+};
+
+//Mostly short timers with a long tail, the way overlays and actions use them
+static int64_t random_delay(std::mt19937_64& rng)
+{
+    switch (rng() % 6)
+    {
+    case 0: return int64_t(rng() % 2000);
+    case 1: return int64_t(rng() % 300000);
+    case 2: return int64_t(rng() % 20000000);
+    case 3: return int64_t(rng() % 4000000000);
+    case 4: return int64_t(rng() % uint64_t(max_delay_us));
+    default: return -int64_t(rng() % 5000);
+    }
+}
+
+static void check_advance(model& m, int64_t now_us)
+{
+    std::vector<timer_wheel::expired_timer> expired;
+    m.wheel.advance(now_us, expired);
+    m.now = now_us;
+
+    for (const auto& timer : expired)
+    {
+        auto found = m.deadlines.find(timer.handle);
+        CHECK(found != m.deadlines.end(), "handle %llu fired but isn't live", (unsigned long long)timer.handle);
+        CHECK(due_tick(found->second) <= now_us / tick_us, "deadline %lld fired early at %lld", (long long)found->second, (long long)now_us);
+        CHECK(timer.lateness_us == std::max<int64_t>(0, now_us - found->second), "lateness %lld for deadline %lld at %lld",
+            (long long)timer.lateness_us, (long long)found->second, (long long)now_us);
+        m.deadlines.erase(found);
+    }
+
+    for (const auto& live : m.deadlines)
+    {
+        CHECK(due_tick(live.second) > now_us / tick_us, "deadline %lld missed at %lld", (long long)live.second, (long long)now_us);
+    }
+
+    CHECK(m.wheel.size() == m.deadlines.size(), "size %zu, expected %zu", m.wheel.size(), m.deadlines.size());
+}
+
+static void check_wakeup(model& m)
+{
+    const int64_t wakeup = m.wheel.next_wakeup_us();
+    if (m.deadlines.empty())
+    {
+        CHECK(wakeup == -1, "empty wheel wakes at %lld", (long long)wakeup);
+        return;
+    }
+
+    int64_t earliest = INT64_MAX;
+    for (const auto& live : m.deadlines)
+    {
+        earliest = std::min(earliest, due_tick(live.second) * tick_us);
+    }
+    CHECK(wakeup >= 0 && wakeup <= std::max(earliest, m.now), "wakes at %lld, first deadline is due at %lld",
+        (long long)wakeup, (long long)earliest);
+}
+
+static void test_cascade_boundary()
+{
+    printf("cascade boundary\n");
+
+    model m(250000);
+    m.deadlines[m.wheel.insert(300000)] = 300000;
+    m.deadlines[m.wheel.insert(506000)] = 506000;
+
+    //Driven the way the scheduler thread does, straight from wakeup to wakeup
+    for (int steps = 0; steps < 100 && !m.deadlines.empty(); ++steps)
+    {
+        check_wakeup(m);
+        if (failures) return;
+        check_advance(m, std::max(m.now, m.wheel.next_wakeup_us()));
+        if (failures) return;
+    }
+    CHECK(m.deadlines.empty(), "%zu timers never fired", m.deadlines.size());
+}
+
+static void test_random(uint64_t seed, size_t rounds)
+{
+    printf("random, seed %llu\n", (unsigned long long)seed);
+
+    std::mt19937_64 rng(seed);
+    model m(int64_t(rng() % 1000000000));
+
+    for (size_t round = 0; round < rounds; ++round)
+    {
+        const uint32_t op = rng() % 10;
+        if (op < 4)
+        {
+            const int64_t deadline = m.now + random_delay(rng);
+            const uint64_t handle = m.wheel.insert(deadline);
+            CHECK(handle != timer_wheel::invalid_handle, "insert failed");
+            CHECK(m.deadlines.count(handle) == 0, "handle %llu handed out twice", (unsigned long long)handle);
+            m.deadlines[handle] = deadline;
+        }
+        else if (op < 6 && !m.deadlines.empty())
+        {
+            auto victim = m.deadlines.begin();
+            std::advance(victim, rng() % m.deadlines.size());
+            CHECK(m.wheel.cancel(victim->first), "cancel of a live timer failed");
+            CHECK(!m.wheel.cancel(victim->first), "second cancel succeeded");
+            m.deadlines.erase(victim);
+        }
+        else if (op < 8)
+        {
+            //Woken late or early by the condition variable
+            check_advance(m, m.now + int64_t(rng() % 3) * int64_t(rng() % 400000));
+        }
+        else
+        {
+            const int64_t wakeup = m.wheel.next_wakeup_us();
+            check_advance(m, wakeup < 0 ? m.now + 1000 : std::max(m.now, wakeup));
+        }
+        if (failures) return;
+
+        check_wakeup(m);
+        if (failures) return;
+    }
+
+    //Everything left has to come out in a bounded number of wakeups
+    for (size_t steps = 0; steps < 1000000 && !m.deadlines.empty(); ++steps)
+    {
+        check_advance(m, std::max(m.now, m.wheel.next_wakeup_us()));
+        if (failures) return;
+    }
+    CHECK(m.deadlines.empty(), "%zu timers never fired", m.deadlines.size());
+}
+
+int main(int argc, char** argv)
+{
+    uint64_t seed = 1;
+    size_t rounds = 200000;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (strncmp(argv[i], "--seed=", 7) == 0) seed = strtoull(argv[i] + 7, nullptr, 10);
+        else if (strncmp(argv[i], "--rounds=", 9) == 0) rounds = size_t(strtoull(argv[i] + 9, nullptr, 10));
+    }
+
+    test_cascade_boundary();
+    for (uint64_t i = 0; i < 8 && !failures; ++i)
+    {
+        test_random(seed + i, rounds);
+    }
+
+    if (failures)
+    {
+        printf("%d failed\n", failures);
+        return 1;
+    }
+    printf("passed\n");
+    return 0;
+}
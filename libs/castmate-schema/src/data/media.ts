@@ -34,6 +34,8 @@ export interface MediaMetadata {
 	file: string
 	url: string
 	duration?: number
+	width?: number
+	height?: number
 	folderId: string
 	name: string
 }
@@ -36,6 +36,12 @@ export const useMediaStore = defineStore("media", () => {
 			mediaMap.value[metadata.path] = metadata
 		})
 
+		handleIpcMessage("media", "addMediaBatch", (event, metadata: MediaMetadata[]) => {
+			for (const media of metadata) {
+				mediaMap.value[media.path] = media
+			}
+		})
+
 		handleIpcMessage("media", "removeMedia", (event, path: string) => {
 			console.log("Removing", path)
 			delete mediaMap.value[path]
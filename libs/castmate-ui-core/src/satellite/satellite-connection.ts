@@ -85,6 +85,7 @@ const satelliteOnStateChange = useIpcCaller<(id: string, state: ConnectionState)
 )
 const satelliteOnDeleted = useIpcCaller<(id: string) => any>("satellite", "onConnectionDeleted")
 const satelliteOnControlMessage = useIpcCaller<(id: string, data: object) => any>("satellite", "onControlMessage")
+const satelliteOnChunkMessage = useIpcCaller<(id: string, data: Uint8Array) => any>("satellite", "onChunkMessage")
 
 const triggerRefreshConnections = useIpcCaller<() => any>("dashboards", "refreshConnections")
 
@@ -96,11 +97,18 @@ interface PendingMediaRequest {
 	onDone: (state: "success" | "error") => any
 }
 
+//Data channels error out once more than 16MB is buffered, chunk sync messages wait below this instead
+const chunkChannelHighWater = 4 * 1024 * 1024
+const chunkChannelLowWater = 1024 * 1024
+
 class SatelliteConnection {
 	connection: RTCPeerConnection
 	id: string
 	state: ConnectionState = "connecting"
 	controlChannel?: RTCDataChannel
+	//Binary media chunk sync, the protocol itself runs in main and this is only relayed
+	chunkChannel?: RTCDataChannel
+	chunkSendQueue = markRaw(new Array<Uint8Array>())
 	mediaRequests = new Map<string, PendingMediaRequest>()
 
 	constructor(public remoteService: SatelliteConnectionService, public remoteId: string, public dashId: string) {
@@ -118,6 +126,39 @@ class SatelliteConnection {
 		return connection
 	}
 
+	attachChunkChannel(channel: RTCDataChannel) {
+		this.chunkChannel = markRaw(channel)
+		this.chunkChannel.binaryType = "arraybuffer"
+		this.chunkChannel.bufferedAmountLowThreshold = chunkChannelLowWater
+
+		this.chunkChannel.onmessage = (ev) => {
+			satelliteOnChunkMessage(this.id, new Uint8Array(ev.data as ArrayBuffer))
+		}
+
+		this.chunkChannel.onopen = () => {
+			this.flushChunkMessages()
+		}
+
+		this.chunkChannel.onbufferedamountlow = () => {
+			this.flushChunkMessages()
+		}
+	}
+
+	sendChunkMessage(data: Uint8Array) {
+		this.chunkSendQueue.push(data)
+		this.flushChunkMessages()
+	}
+
+	flushChunkMessages() {
+		const channel = this.chunkChannel
+		if (!channel || channel.readyState != "open") return
+
+		while (this.chunkSendQueue.length > 0 && channel.bufferedAmount < chunkChannelHighWater) {
+			const data = this.chunkSendQueue.shift()
+			if (data) channel.send(data)
+		}
+	}
+
 	async handleIceCandidate(candidate: SatelliteConnectionICECandidate) {
 		const candidateObj = new RTCIceCandidate(candidate.candidate)
 
@@ -205,6 +246,8 @@ export const useSatelliteConnection = defineStore("satellite-connection", () =>
 				}
 
 				checkIfFullyConnected()
+			} else if (ev.channel.label == "chunkSync") {
+				self.attachChunkChannel(ev.channel)
 			} else if (ev.channel.label.startsWith("media:")) {
 				//Media requests
 				const filename = ev.channel.label.substring(6)
@@ -293,6 +336,8 @@ export const useSatelliteConnection = defineStore("satellite-connection", () =>
 			}
 		}
 
+		self.attachChunkChannel(self.connection.createDataChannel("chunkSync"))
+
 		self.connection.onicecandidate = async (ev) => {
 			if (!ev.candidate) return
 
@@ -433,6 +478,12 @@ export const useSatelliteConnection = defineStore("satellite-connection", () =>
 			console.log("SEND RTC", connection?.controlChannel, id, data)
 			connection?.controlChannel?.send(data)
 		})
+
+		handleIpcMessage("satellite", "sendChunkMessage", async (event, id: string, data: Uint8Array) => {
+			const connection = connections.value.find((c) => c.id == id)
+			if (!connection?.chunkChannel) return
+			connection.sendChunkMessage(data)
+		})
 	}
 
 	async function connectToCastMate(request: SatelliteConnectionRequestConfig) {
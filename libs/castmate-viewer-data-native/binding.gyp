@@ -0,0 +1,33 @@
+{
+    "variables": {
+        # Link the same SQLite amalgamation better-sqlite3 builds so both agree on the file format and WAL behaviour.
+        "better_sqlite3_dir": "<!(node -p \"require('path').dirname(require.resolve('better-sqlite3/package.json'))\")",
+    },
+    "targets": [
+        {
+            "target_name": "castmate-viewer-data-native",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [
+                "src/native-index.cc",
+                "src/viewer-data-interface.cc",
+                "src/viewer-store.cc",
+                "src/viewer-writer.cc"
+            ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")",
+                "<(better_sqlite3_dir)/deps/sqlite3.gyp:sqlite3"
+            ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17" ]
+                }
+            },
+            'defines': [ 'NAPI_DISABLE_CPP_EXCEPTIONS' ],
+        }
+    ]
+}
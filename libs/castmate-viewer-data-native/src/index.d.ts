@@ -0,0 +1,43 @@
+declare namespace CastmateViewerDataNative {
+	/** Values as they're stored in SQLite, variables are serialized before they get here */
+	type StoredValue = number | string | null
+
+	type StoredRow = Record<string, StoredValue>
+
+	class ViewerDataStore {
+		/** onError is called with SQLite errors from the background writer */
+		constructor(onError?: (message: string) => void)
+
+		/** Opens the database and loads the ViewerData table into memory */
+		open(path: string): void
+		/** Writes anything still pending and closes the database */
+		close(): void
+
+		/** @returns false if the column already exists */
+		addColumn(name: string, sqlType: string, defaultValue: StoredValue): boolean
+		removeColumn(name: string): boolean
+
+		has(provider: string, id: string): boolean
+		/** @returns true if the viewer didn't exist and was inserted */
+		set(provider: string, id: string, displayName: string, column: string, value: StoredValue): boolean
+		/** Offsets a number column, new viewers start from the column default. Repeated offsets are folded into one write. */
+		offset(provider: string, id: string, displayName: string, column: string, offset: number): number
+
+		get(provider: string, id: string): StoredRow | undefined
+		getMany(provider: string, ids: string[]): (StoredRow | undefined)[]
+		count(): number
+		/** Rows [start, end), optionally ordered by a column, served from memory */
+		page(start: number, end: number, sortBy?: string, descending?: boolean): StoredRow[]
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
+}
+
+export = CastmateViewerDataNative
@@ -0,0 +1,57 @@
+const bindings = require("bindings")
+
+const native = bindings({
+	bindings: "castmate-viewer-data-native",
+})
+
+class ViewerDataStore {
+	constructor(onError) {
+		this._native = new native.NativeViewerData(onError)
+	}
+
+	open(path) {
+		return this._native.open(path)
+	}
+	close() {
+		return this._native.close()
+	}
+
+	addColumn(name, type, defaultValue) {
+		return this._native.addColumn(name, type, defaultValue)
+	}
+	removeColumn(name) {
+		return this._native.removeColumn(name)
+	}
+
+	has(provider, id) {
+		return this._native.has(provider, id)
+	}
+	set(provider, id, displayName, column, value) {
+		return this._native.set(provider, id, displayName, column, value)
+	}
+	offset(provider, id, displayName, column, offset) {
+		return this._native.offset(provider, id, displayName, column, offset)
+	}
+
+	get(provider, id) {
+		return this._native.get(provider, id)
+	}
+	getMany(provider, ids) {
+		return this._native.getMany(provider, ids)
+	}
+	count() {
+		return this._native.count()
+	}
+	page(start, end, sortBy, descending) {
+		return this._native.page(start, end, sortBy, descending)
+	}
+}
+
+module.exports = {
+	ViewerDataStore,
+	tracer: {
+		setTracingEnabled: native.setTracingEnabled,
+		dumpTrace: native.dumpTrace,
+		clearTrace: native.clearTrace,
+	},
+}
@@ -0,0 +1,370 @@
+#include "viewer-data-interface.hh"
+
+#include <string>
+#include <iostream>
+#include <algorithm>
+
+Napi::Object viewer_data_interface::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeViewerData", {
+        InstanceMethod("open", &viewer_data_interface::open),
+        InstanceMethod("close", &viewer_data_interface::close),
+        InstanceMethod("addColumn", &viewer_data_interface::add_column),
+        InstanceMethod("removeColumn", &viewer_data_interface::remove_column),
+        InstanceMethod("has", &viewer_data_interface::has),
+        InstanceMethod("set", &viewer_data_interface::set),
+        InstanceMethod("offset", &viewer_data_interface::offset),
+        InstanceMethod("get", &viewer_data_interface::get),
+        InstanceMethod("getMany", &viewer_data_interface::get_many),
+        InstanceMethod("count", &viewer_data_interface::count),
+        InstanceMethod("page", &viewer_data_interface::page),
+    });
+
+    exports.Set("NativeViewerData", constructor);
+    return exports;
+}
+
+static bool to_viewer_value(const Napi::Value& js_value, viewer_value& value)
+{
+    if (js_value.IsNumber())
+    {
+        value = viewer_value::make_real(js_value.As<Napi::Number>().DoubleValue());
+        return true;
+    }
+    if (js_value.IsString())
+    {
+        value = viewer_value::make_text(js_value.As<Napi::String>().Utf8Value());
+        return true;
+    }
+    if (js_value.IsBoolean())
+    {
+        value = viewer_value::make_real(js_value.As<Napi::Boolean>().Value() ? 1 : 0);
+        return true;
+    }
+    if (js_value.IsNull() || js_value.IsUndefined())
+    {
+        value = viewer_value();
+        return true;
+    }
+    return false;
+}
+
+static Napi::Value to_js_value(Napi::Env env, const viewer_value& value)
+{
+    switch (value.kind)
+    {
+    case viewer_value_kind::real:
+        return Napi::Number::New(env, value.real);
+    case viewer_value_kind::text:
+        return Napi::String::New(env, value.text);
+    default:
+        return env.Null();
+    }
+}
+
+viewer_data_interface::viewer_data_interface(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<viewer_data_interface>(info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() > 0 && info[0].IsFunction())
+    {
+        //A failing disk reports every batch, past this they're dropped until JS catches up
+        errors.open(env, info[0].As<Napi::Function>(), "ViewerDataErrorTSFN", 64);
+        //Errors are rare, don't let the callback keep the process alive.
+        errors.unref(env);
+    }
+}
+
+void viewer_data_interface::Finalize(Napi::Env env)
+{
+    writer.close();
+    errors.close();
+}
+
+bool viewer_data_interface::check_open(Napi::Env env)
+{
+    if (!opened)
+    {
+        Napi::Error::New(env, "Viewer data isn't open.").ThrowAsJavaScriptException();
+    }
+    return opened;
+}
+
+Napi::Value viewer_data_interface::open(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "open requires a path.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (opened)
+    {
+        Napi::Error::New(env, "Viewer data is already open.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string error;
+    if (!writer.open(info[0].As<Napi::String>().Utf8Value(), store, error))
+    {
+        writer.close();
+        Napi::Error::New(env, "Unable to open viewer data: " + error).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    writer.start(store.queue(), [this](const std::string& message) {
+        errors.post([message](Napi::Env env, Napi::Function js_callback) {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            js_callback.Call({ Napi::String::New(env, message) });
+        });
+    });
+
+    opened = true;
+    return env.Undefined();
+}
+
+Napi::Value viewer_data_interface::close(const Napi::CallbackInfo& info)
+{
+    writer.close();
+    opened = false;
+    return info.Env().Undefined();
+}
+
+//addColumn(name, sqlType, default) -> false if it already exists
+Napi::Value viewer_data_interface::add_column(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    viewer_value default_value;
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !to_viewer_value(info[2], default_value))
+    {
+        Napi::Error::New(env, "addColumn requires a name, a type, and a default value.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool added = store.add_column(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value(), default_value);
+    return Napi::Boolean::New(env, added);
+}
+
+Napi::Value viewer_data_interface::remove_column(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "removeColumn requires a name.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    return Napi::Boolean::New(env, store.remove_column(info[0].As<Napi::String>().Utf8Value()));
+}
+
+Napi::Value viewer_data_interface::has(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString())
+    {
+        Napi::Error::New(env, "has requires a provider and an id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int32_t row = store.find_row(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value());
+    return Napi::Boolean::New(env, row >= 0);
+}
+
+//set(provider, id, displayName, column, value) -> true if the viewer was inserted
+Napi::Value viewer_data_interface::set(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    viewer_value value;
+    if (info.Length() < 5 || !info[0].IsString() || !info[1].IsString() || !info[2].IsString() || !info[3].IsString() ||
+        !to_viewer_value(info[4], value))
+    {
+        Napi::Error::New(env, "set requires a provider, an id, a display name, a column, and a value.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::string provider = info[0].As<Napi::String>().Utf8Value();
+    const std::string id = info[1].As<Napi::String>().Utf8Value();
+
+    const int32_t column = store.column_index(info[3].As<Napi::String>().Utf8Value());
+    if (column < 0)
+    {
+        Napi::Error::New(env, "Unknown viewer variable.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    bool inserted = false;
+    int32_t row = store.find_row(provider, id);
+    if (row < 0)
+    {
+        row = store.insert_row(provider, id, info[2].As<Napi::String>().Utf8Value());
+        if (row < 0)
+        {
+            Napi::Error::New(env, "Unknown viewer provider " + provider + ".").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        inserted = true;
+    }
+
+    store.set_value(row, column, provider, id, value);
+    return Napi::Boolean::New(env, inserted);
+}
+
+//offset(provider, id, displayName, column, offset) -> the new value. New viewers start from the column's default.
+Napi::Value viewer_data_interface::offset(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 5 || !info[0].IsString() || !info[1].IsString() || !info[2].IsString() || !info[3].IsString() ||
+        !info[4].IsNumber())
+    {
+        Napi::Error::New(env, "offset requires a provider, an id, a display name, a column, and an offset.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::string provider = info[0].As<Napi::String>().Utf8Value();
+    const std::string id = info[1].As<Napi::String>().Utf8Value();
+
+    const int32_t column = store.column_index(info[3].As<Napi::String>().Utf8Value());
+    if (column < 0)
+    {
+        Napi::Error::New(env, "Unknown viewer variable.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int32_t row = store.find_row(provider, id);
+    if (row < 0)
+    {
+        row = store.insert_row(provider, id, info[2].As<Napi::String>().Utf8Value());
+        if (row < 0)
+        {
+            Napi::Error::New(env, "Unknown viewer provider " + provider + ".").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    //Same as coalesce(column, 0) + offset
+    viewer_value current = store.get_value(row, column);
+    const double base = current.kind == viewer_value_kind::real ? current.real : 0;
+    const double result = base + info[4].As<Napi::Number>().DoubleValue();
+
+    store.set_value(row, column, provider, id, viewer_value::make_real(result));
+    return Napi::Number::New(env, result);
+}
+
+Napi::Object viewer_data_interface::make_row(Napi::Env env, uint32_t row)
+{
+    Napi::Object result = Napi::Object::New(env);
+    const auto& columns = store.get_columns();
+    for (uint32_t i = 0; i < columns.size(); ++i)
+    {
+        result.Set(columns[i].name, to_js_value(env, store.get_value(row, i)));
+    }
+    return result;
+}
+
+Napi::Value viewer_data_interface::get(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsString())
+    {
+        Napi::Error::New(env, "get requires a provider and an id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    int32_t row = store.find_row(info[0].As<Napi::String>().Utf8Value(), info[1].As<Napi::String>().Utf8Value());
+    if (row < 0) return env.Undefined();
+
+    return make_row(env, row);
+}
+
+Napi::Value viewer_data_interface::get_many(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsArray())
+    {
+        Napi::Error::New(env, "getMany requires a provider and an array of ids.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::string provider = info[0].As<Napi::String>().Utf8Value();
+    Napi::Array ids = info[1].As<Napi::Array>();
+
+    Napi::Array result = Napi::Array::New(env, ids.Length());
+    for (uint32_t i = 0; i < ids.Length(); ++i)
+    {
+        Napi::Value id = ids.Get(i);
+        int32_t row = id.IsString() ? store.find_row(provider, id.As<Napi::String>().Utf8Value()) : -1;
+        result.Set(i, row < 0 ? env.Undefined() : make_row(env, row));
+    }
+    return result;
+}
+
+Napi::Value viewer_data_interface::count(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    return Napi::Number::New(env, double(store.row_count()));
+}
+
+//page(start, end, sortBy?, descending?)
+Napi::Value viewer_data_interface::page(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    if (!check_open(env)) return env.Undefined();
+
+    if (info.Length() < 2 || !info[0].IsNumber() || !info[1].IsNumber())
+    {
+        Napi::Error::New(env, "page requires a start and an end.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const int64_t start = std::max<int64_t>(0, info[0].As<Napi::Number>().Int64Value());
+    const int64_t end = std::min<int64_t>(int64_t(store.row_count()), info[1].As<Napi::Number>().Int64Value());
+
+    page_rows.clear();
+    if (info.Length() > 2 && info[2].IsString())
+    {
+        const int32_t column = store.column_index(info[2].As<Napi::String>().Utf8Value());
+        if (column < 0)
+        {
+            Napi::Error::New(env, "Unknown sort column.").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+
+        const bool descending = info.Length() > 3 && info[3].ToBoolean().Value();
+        store.ordered_rows(column, descending, size_t(start), size_t(std::max(start, end)), page_rows);
+    }
+    else
+    {
+        for (int64_t row = start; row < end; ++row)
+        {
+            page_rows.push_back(uint32_t(row));
+        }
+    }
+
+    Napi::Array result = Napi::Array::New(env, page_rows.size());
+    for (uint32_t i = 0; i < page_rows.size(); ++i)
+    {
+        result.Set(i, make_row(env, page_rows[i]));
+    }
+    return result;
+}
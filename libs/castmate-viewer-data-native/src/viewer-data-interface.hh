@@ -0,0 +1,46 @@
+#pragma once
+
+#include <napi.h>
+
+#include "castmate-native/event-dispatcher.hh"
+
+#include "viewer-store.hh"
+#include "viewer-writer.hh"
+
+class viewer_data_interface : public Napi::ObjectWrap<viewer_data_interface>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    viewer_data_interface(const Napi::CallbackInfo& info);
+    virtual void Finalize(Napi::Env env);
+
+    Napi::Value open(const Napi::CallbackInfo& info);
+    Napi::Value close(const Napi::CallbackInfo& info);
+
+    Napi::Value add_column(const Napi::CallbackInfo& info);
+    Napi::Value remove_column(const Napi::CallbackInfo& info);
+
+    Napi::Value has(const Napi::CallbackInfo& info);
+    Napi::Value set(const Napi::CallbackInfo& info);
+    Napi::Value offset(const Napi::CallbackInfo& info);
+
+    Napi::Value get(const Napi::CallbackInfo& info);
+    Napi::Value get_many(const Napi::CallbackInfo& info);
+    Napi::Value count(const Napi::CallbackInfo& info);
+    Napi::Value page(const Napi::CallbackInfo& info);
+
+private:
+    bool check_open(Napi::Env env);
+    Napi::Object make_row(Napi::Env env, uint32_t row);
+
+    //Write errors from the writer thread, only open if a callback was given
+    js_call_dispatcher errors;
+
+    viewer_store store;
+    viewer_writer writer;
+    bool opened = false;
+
+    //Scratch for page()
+    std::vector<uint32_t> page_rows;
+};
@@ -0,0 +1,337 @@
+#include "viewer-store.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+int compare_viewer_values(const viewer_value& a, const viewer_value& b)
+{
+    if (a.kind != b.kind) return int(a.kind) < int(b.kind) ? -1 : 1;
+
+    switch (a.kind)
+    {
+    case viewer_value_kind::real:
+        return a.real < b.real ? -1 : (a.real > b.real ? 1 : 0);
+    case viewer_value_kind::text:
+        return a.text.compare(b.text);
+    default:
+        return 0;
+    }
+}
+
+///////////////////////////////QUEUE///////////////////////////////
+
+void viewer_write_queue::push_insert(uint32_t row, viewer_write write)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    pending_rows[row] = pending.size();
+    pending.push_back(std::move(write));
+
+    if (pending.size() >= flush_threshold) cv.notify_one();
+}
+
+void viewer_write_queue::push_update(uint32_t row, uint32_t column, viewer_write write)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto insert = pending_rows.find(row);
+    if (insert != pending_rows.end())
+    {
+        for (auto& cell : pending[insert->second].row)
+        {
+            if (cell.first == write.column)
+            {
+                cell.second = std::move(write.value);
+                return;
+            }
+        }
+    }
+
+    auto cell = pending_cells.find(cell_key(row, column));
+    if (cell != pending_cells.end())
+    {
+        pending[cell->second].value = std::move(write.value);
+        return;
+    }
+
+    pending_cells[cell_key(row, column)] = pending.size();
+    pending.push_back(std::move(write));
+
+    if (pending.size() >= flush_threshold) cv.notify_one();
+}
+
+void viewer_write_queue::push_schema(viewer_write write)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    //Column indices shift and writes after this have to land after it, so nothing folds across a schema change.
+    pending_cells.clear();
+    pending_rows.clear();
+    pending.push_back(std::move(write));
+}
+
+bool viewer_write_queue::take(std::vector<viewer_write>& batch, uint32_t wait_ms)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    cv.wait_for(lock, std::chrono::milliseconds(wait_ms), [this] {
+        return stopping || pending.size() >= flush_threshold;
+    });
+
+    batch.clear();
+    std::swap(batch, pending);
+    pending_cells.clear();
+    pending_rows.clear();
+
+    return !stopping;
+}
+
+void viewer_write_queue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cv.notify_one();
+}
+
+///////////////////////////////COLUMN///////////////////////////////
+
+viewer_value viewer_column::get(uint32_t row) const
+{
+    viewer_value result;
+    result.kind = kinds[row];
+    if (result.kind == viewer_value_kind::real)
+    {
+        result.real = reals[row];
+    }
+    else if (result.kind == viewer_value_kind::text)
+    {
+        result.text = texts[row];
+    }
+    return result;
+}
+
+void viewer_column::set(uint32_t row, const viewer_value& value)
+{
+    kinds[row] = value.kind;
+    reals[row] = value.real;
+
+    if (value.kind == viewer_value_kind::text)
+    {
+        if (texts.size() < kinds.size()) texts.resize(kinds.size());
+        texts[row] = value.text;
+    }
+    else if (row < texts.size())
+    {
+        texts[row].clear();
+    }
+}
+
+void viewer_column::push(const viewer_value& value)
+{
+    kinds.push_back(value.kind);
+    reals.push_back(value.real);
+    if (value.kind == viewer_value_kind::text || !texts.empty())
+    {
+        texts.resize(kinds.size());
+        texts.back() = value.text;
+    }
+}
+
+///////////////////////////////STORE///////////////////////////////
+
+void viewer_store::load_column(const std::string& name, const viewer_value& default_value)
+{
+    viewer_column column;
+    column.name = name;
+    column.default_value = default_value;
+    columns.push_back(std::move(column));
+}
+
+void viewer_store::load_row(const std::vector<viewer_value>& values)
+{
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        columns[i].push(i < values.size() ? values[i] : viewer_value());
+    }
+    ++rows;
+}
+
+int32_t viewer_store::column_index(const std::string& name) const
+{
+    for (size_t i = 0; i < columns.size(); ++i)
+    {
+        if (columns[i].name == name) return int32_t(i);
+    }
+    return -1;
+}
+
+bool viewer_store::add_column(const std::string& name, const std::string& type, const viewer_value& default_value)
+{
+    if (column_index(name) >= 0) return false;
+
+    viewer_column column;
+    column.name = name;
+    column.default_value = default_value;
+    column.kinds.reserve(rows);
+    column.reals.reserve(rows);
+    for (size_t i = 0; i < rows; ++i)
+    {
+        column.push(default_value);
+    }
+    columns.push_back(std::move(column));
+
+    viewer_write write;
+    write.kind = viewer_write_kind::add_column;
+    write.column = name;
+    write.column_type = type;
+    write.value = default_value;
+    writes.push_schema(std::move(write));
+    return true;
+}
+
+bool viewer_store::remove_column(const std::string& name)
+{
+    int32_t index = column_index(name);
+    if (index < 0) return false;
+
+    columns.erase(columns.begin() + index);
+    indexes.erase(name);
+
+    viewer_write write;
+    write.kind = viewer_write_kind::drop_column;
+    write.column = name;
+    writes.push_schema(std::move(write));
+    return true;
+}
+
+std::unordered_map<std::string, uint32_t>* viewer_store::get_index(const std::string& provider)
+{
+    auto existing = indexes.find(provider);
+    if (existing != indexes.end()) return &existing->second;
+
+    int32_t column = column_index(provider);
+    if (column < 0) return nullptr;
+
+    auto& index = indexes[provider];
+    index.reserve(rows);
+
+    const viewer_column& ids = columns[column];
+    for (uint32_t row = 0; row < rows; ++row)
+    {
+        if (ids.kinds[row] == viewer_value_kind::text)
+        {
+            index.emplace(ids.texts[row], row);
+        }
+    }
+    return &index;
+}
+
+int32_t viewer_store::find_row(const std::string& provider, const std::string& id)
+{
+    auto index = get_index(provider);
+    if (!index) return -1;
+
+    auto row = index->find(id);
+    return row == index->end() ? -1 : int32_t(row->second);
+}
+
+int32_t viewer_store::insert_row(const std::string& provider, const std::string& id, const std::string& display_name)
+{
+    auto index = get_index(provider);
+    if (!index) return -1;
+
+    const int32_t id_column = column_index(provider);
+    const int32_t name_column = column_index(provider + "_name");
+
+    const uint32_t row = uint32_t(rows++);
+
+    viewer_write write;
+    write.kind = viewer_write_kind::insert_row;
+    write.row.reserve(columns.size());
+
+    for (int32_t i = 0; i < int32_t(columns.size()); ++i)
+    {
+        viewer_column& column = columns[i];
+
+        viewer_value value = column.default_value;
+        if (i == id_column)
+        {
+            value = viewer_value::make_text(id);
+        }
+        else if (i == name_column)
+        {
+            value = viewer_value::make_text(display_name);
+        }
+
+        column.push(value);
+        write.row.emplace_back(column.name, std::move(value));
+    }
+
+    index->emplace(id, row);
+
+    writes.push_insert(row, std::move(write));
+    return int32_t(row);
+}
+
+void viewer_store::set_value(uint32_t row, uint32_t column, const std::string& provider, const std::string& id, const viewer_value& value)
+{
+    viewer_column& target = columns[column];
+    target.set(row, value);
+
+    //Rare, but an id column changing makes its index stale.
+    indexes.erase(target.name);
+
+    viewer_write write;
+    write.kind = viewer_write_kind::update_cell;
+    write.key_column = provider;
+    write.key = id;
+    write.column = target.name;
+    write.value = value;
+    writes.push_update(row, column, std::move(write));
+}
+
+void viewer_store::ordered_rows(uint32_t column, bool descending, size_t start, size_t end, std::vector<uint32_t>& result)
+{
+    result.clear();
+    end = std::min(end, rows);
+    if (start >= end) return;
+
+    std::vector<uint32_t> order(rows);
+    for (uint32_t i = 0; i < rows; ++i) order[i] = i;
+
+    const viewer_column& sort_column = columns[column];
+    auto compare = [&sort_column, descending](uint32_t a, uint32_t b) {
+        const viewer_value_kind kind_a = sort_column.kinds[a];
+        const viewer_value_kind kind_b = sort_column.kinds[b];
+
+        int comparison;
+        if (kind_a != kind_b)
+        {
+            comparison = int(kind_a) < int(kind_b) ? -1 : 1;
+        }
+        else if (kind_a == viewer_value_kind::real)
+        {
+            const double real_a = sort_column.reals[a];
+            const double real_b = sort_column.reals[b];
+            comparison = real_a < real_b ? -1 : (real_a > real_b ? 1 : 0);
+        }
+        else if (kind_a == viewer_value_kind::text)
+        {
+            comparison = sort_column.texts[a].compare(sort_column.texts[b]);
+        }
+        else
+        {
+            comparison = 0;
+        }
+
+        if (comparison == 0) return a < b;
+        return descending ? comparison > 0 : comparison < 0;
+    };
+
+    //Only the rows up to the end of the page need to be in order.
+    std::partial_sort(order.begin(), order.begin() + end, order.end(), compare);
+    result.assign(order.begin() + start, order.begin() + end);
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+
+#include "viewer-value.hh"
+
+enum class viewer_write_kind : uint8_t
+{
+    insert_row,
+    update_cell,
+    add_column,
+    drop_column,
+};
+
+//One pending change to the database, fully materialized so the writer thread never touches the store.
+struct viewer_write
+{
+    viewer_write_kind kind;
+
+    //Provider column and id identifying the row for update_cell
+    std::string key_column;
+    std::string key;
+
+    //Target column for update_cell, add_column and drop_column
+    std::string column;
+    //New value for update_cell, default for add_column
+    viewer_value value;
+    //SQL type for add_column
+    std::string column_type;
+
+    //Every column of a new row for insert_row
+    std::vector<std::pair<std::string, viewer_value>> row;
+};
+
+//Changes waiting for the writer thread. Repeated writes to the same cell fold into one entry, and writes to a row
+//that hasn't been inserted yet fold into its insert, so a "give everyone points" loop turns into one statement per
+//viewer no matter how many times it ran.
+class viewer_write_queue
+{
+public:
+    void push_insert(uint32_t row, viewer_write write);
+    void push_update(uint32_t row, uint32_t column, viewer_write write);
+    void push_schema(viewer_write write);
+
+    //Swaps everything pending into batch, blocks up to wait_ms if there's nothing yet or until stop() is called.
+    bool take(std::vector<viewer_write>& batch, uint32_t wait_ms);
+    void stop();
+
+    size_t flush_threshold = 1024;
+
+private:
+    static uint64_t cell_key(uint32_t row, uint32_t column) { return (uint64_t(row) << 32) | column; }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    std::vector<viewer_write> pending;
+    std::unordered_map<uint64_t, size_t> pending_cells;
+    std::unordered_map<uint32_t, size_t> pending_rows;
+};
+
+struct viewer_column
+{
+    std::string name;
+    viewer_value default_value;
+
+    //Columnar storage, one slot per row. Most variables are numbers so those stay in a dense double array and the
+    //string array is only grown once a column actually holds text.
+    std::vector<viewer_value_kind> kinds;
+    std::vector<double> reals;
+    std::vector<std::string> texts;
+
+    viewer_value get(uint32_t row) const;
+    void set(uint32_t row, const viewer_value& value);
+    void push(const viewer_value& value);
+};
+
+//In memory copy of the ViewerData table. All reads are served from here; writes land here first and are queued
+//for the writer thread. Only ever touched from the JS thread.
+class viewer_store
+{
+public:
+    viewer_write_queue& queue() { return writes; }
+
+    //Used while loading, doesn't queue any writes.
+    void load_column(const std::string& name, const viewer_value& default_value);
+    void load_row(const std::vector<viewer_value>& values);
+
+    int32_t column_index(const std::string& name) const;
+    const std::vector<viewer_column>& get_columns() const { return columns; }
+    size_t row_count() const { return rows; }
+
+    bool add_column(const std::string& name, const std::string& type, const viewer_value& default_value);
+    bool remove_column(const std::string& name);
+
+    //-1 if the provider column doesn't exist or the id isn't there
+    int32_t find_row(const std::string& provider, const std::string& id);
+    //Returns -1 if the provider has no column
+    int32_t insert_row(const std::string& provider, const std::string& id, const std::string& display_name);
+
+    viewer_value get_value(uint32_t row, uint32_t column) const { return columns[column].get(row); }
+    void set_value(uint32_t row, uint32_t column, const std::string& provider, const std::string& id, const viewer_value& value);
+
+    //Row indices for [start, end) of the table ordered by a column, ties keep table order like SQLite's rowid scan.
+    void ordered_rows(uint32_t column, bool descending, size_t start, size_t end, std::vector<uint32_t>& result);
+
+private:
+    std::unordered_map<std::string, uint32_t>* get_index(const std::string& provider);
+
+    std::vector<viewer_column> columns;
+    size_t rows = 0;
+
+    //Hash index on (provider, id), built the first time a provider is used.
+    std::unordered_map<std::string, std::unordered_map<std::string, uint32_t>> indexes;
+
+    viewer_write_queue writes;
+};
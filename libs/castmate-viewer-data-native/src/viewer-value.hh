@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+//A single SQLite value as the viewer data table stores it. Variables are serialized in JS before they get here,
+//so everything is either a number, a string, or null.
+enum class viewer_value_kind : uint8_t
+{
+    null_value,
+    real,
+    text,
+};
+
+struct viewer_value
+{
+    viewer_value_kind kind = viewer_value_kind::null_value;
+    double real = 0;
+    std::string text;
+
+    static viewer_value make_real(double value)
+    {
+        viewer_value result;
+        result.kind = viewer_value_kind::real;
+        result.real = value;
+        return result;
+    }
+
+    static viewer_value make_text(std::string value)
+    {
+        viewer_value result;
+        result.kind = viewer_value_kind::text;
+        result.text = std::move(value);
+        return result;
+    }
+
+    bool is_null() const { return kind == viewer_value_kind::null_value; }
+};
+
+//Same ordering SQLite uses for mixed columns: NULL, then numbers, then text by byte value.
+int compare_viewer_values(const viewer_value& a, const viewer_value& b);
@@ -0,0 +1,331 @@
+#include "viewer-writer.hh"
+#include "castmate-native/trace.hh"
+
+#include <cstdlib>
+#include <iostream>
+
+static std::string quote_identifier(const std::string& name)
+{
+    std::string result = "\"";
+    for (char c : name)
+    {
+        if (c == '"') result += '"';
+        result += c;
+    }
+    result += '"';
+    return result;
+}
+
+static std::string quote_literal(const viewer_value& value)
+{
+    switch (value.kind)
+    {
+    case viewer_value_kind::real:
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.17g", value.real);
+        return buffer;
+    }
+    case viewer_value_kind::text:
+    {
+        std::string result = "'";
+        for (char c : value.text)
+        {
+            if (c == '\'') result += '\'';
+            result += c;
+        }
+        result += '\'';
+        return result;
+    }
+    default:
+        return "NULL";
+    }
+}
+
+//PRAGMA table_info reports defaults as the SQL text they were declared with.
+static viewer_value parse_default(const char* text)
+{
+    if (!text) return viewer_value();
+
+    std::string literal = text;
+    if (literal.empty() || literal == "NULL" || literal == "null") return viewer_value();
+
+    if (literal.front() == '\'' && literal.size() >= 2 && literal.back() == '\'')
+    {
+        std::string unquoted;
+        for (size_t i = 1; i + 1 < literal.size(); ++i)
+        {
+            unquoted += literal[i];
+            if (literal[i] == '\'' && literal[i + 1] == '\'') ++i;
+        }
+        return viewer_value::make_text(unquoted);
+    }
+
+    char* end = nullptr;
+    double real = strtod(literal.c_str(), &end);
+    if (end && *end == '\0') return viewer_value::make_real(real);
+
+    return viewer_value::make_text(literal);
+}
+
+static viewer_value read_column(sqlite3_stmt* statement, int column)
+{
+    switch (sqlite3_column_type(statement, column))
+    {
+    case SQLITE_INTEGER:
+    case SQLITE_FLOAT:
+        return viewer_value::make_real(sqlite3_column_double(statement, column));
+    case SQLITE_TEXT:
+    case SQLITE_BLOB:
+    {
+        const char* text = static_cast<const char*>(sqlite3_column_blob(statement, column));
+        return viewer_value::make_text(std::string(text ? text : "", sqlite3_column_bytes(statement, column)));
+    }
+    default:
+        return viewer_value();
+    }
+}
+
+static void bind_value(sqlite3_stmt* statement, int index, const viewer_value& value)
+{
+    switch (value.kind)
+    {
+    case viewer_value_kind::real:
+        sqlite3_bind_double(statement, index, value.real);
+        break;
+    case viewer_value_kind::text:
+        sqlite3_bind_text(statement, index, value.text.data(), int(value.text.size()), SQLITE_TRANSIENT);
+        break;
+    default:
+        sqlite3_bind_null(statement, index);
+        break;
+    }
+}
+
+viewer_writer::~viewer_writer()
+{
+    close();
+}
+
+bool viewer_writer::open(const std::string& path, viewer_store& store, std::string& error)
+{
+    if (sqlite3_open_v2(path.c_str(), &db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_NOMUTEX, nullptr) != SQLITE_OK)
+    {
+        error = db ? sqlite3_errmsg(db) : "Unable to open database";
+        sqlite3_close(db);
+        db = nullptr;
+        return false;
+    }
+
+    //WAL lets a batch commit with a single fsync and keeps readers from blocking the writer.
+    exec("PRAGMA journal_mode=WAL");
+    exec("PRAGMA synchronous=NORMAL");
+
+    if (!exec("CREATE TABLE IF NOT EXISTS ViewerData (twitch TEXT UNIQUE, twitch_name TEXT)"))
+    {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+
+    return load(store, error);
+}
+
+bool viewer_writer::load(viewer_store& store, std::string& error)
+{
+    sqlite3_stmt* info = nullptr;
+    if (sqlite3_prepare_v2(db, "PRAGMA table_info(ViewerData)", -1, &info, nullptr) != SQLITE_OK)
+    {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+
+    while (sqlite3_step(info) == SQLITE_ROW)
+    {
+        const char* name = reinterpret_cast<const char*>(sqlite3_column_text(info, 1));
+        const char* default_text = reinterpret_cast<const char*>(sqlite3_column_text(info, 4));
+        store.load_column(name ? name : "", parse_default(default_text));
+    }
+    sqlite3_finalize(info);
+
+    sqlite3_stmt* rows = nullptr;
+    if (sqlite3_prepare_v2(db, "SELECT * FROM ViewerData ORDER BY rowid", -1, &rows, nullptr) != SQLITE_OK)
+    {
+        error = sqlite3_errmsg(db);
+        return false;
+    }
+
+    const int column_count = sqlite3_column_count(rows);
+    std::vector<viewer_value> values(column_count);
+    while (sqlite3_step(rows) == SQLITE_ROW)
+    {
+        for (int i = 0; i < column_count; ++i)
+        {
+            values[i] = read_column(rows, i);
+        }
+        store.load_row(values);
+    }
+    sqlite3_finalize(rows);
+
+    return true;
+}
+
+void viewer_writer::start(viewer_write_queue& write_queue, std::function<void(const std::string&)> error_callback)
+{
+    queue = &write_queue;
+    on_error = std::move(error_callback);
+    writer_thread = std::thread(&viewer_writer::writer_thread_main, this);
+}
+
+void viewer_writer::close()
+{
+    if (writer_thread.joinable())
+    {
+        queue->stop();
+        writer_thread.join();
+    }
+
+    clear_statements();
+
+    if (db)
+    {
+        sqlite3_close(db);
+        db = nullptr;
+    }
+}
+
+void viewer_writer::writer_thread_main()
+{
+    std::vector<viewer_write> batch;
+    bool running = true;
+    while (running)
+    {
+        running = queue->take(batch, flush_interval_ms);
+        if (!batch.empty())
+        {
+            write_batch(batch);
+        }
+    }
+}
+
+void viewer_writer::write_batch(const std::vector<viewer_write>& batch)
+{
+    TRACE_SCOPE("viewer data write batch");
+
+    if (!exec("BEGIN"))
+    {
+        report_error("Unable to begin viewer data transaction");
+        return;
+    }
+
+    for (const viewer_write& write : batch)
+    {
+        if (!run_write(write))
+        {
+            report_error("Viewer data write to " + write.column + " failed");
+        }
+    }
+
+    if (!exec("COMMIT"))
+    {
+        report_error("Unable to commit viewer data");
+        exec("ROLLBACK");
+    }
+}
+
+bool viewer_writer::run_write(const viewer_write& write)
+{
+    switch (write.kind)
+    {
+    case viewer_write_kind::add_column:
+    {
+        //Schema changes invalidate the cached statements.
+        clear_statements();
+        std::string sql = "ALTER TABLE ViewerData ADD COLUMN " + quote_identifier(write.column) + " " + write.column_type +
+            " DEFAULT " + quote_literal(write.value);
+        return exec(sql.c_str());
+    }
+    case viewer_write_kind::drop_column:
+    {
+        clear_statements();
+        std::string sql = "ALTER TABLE ViewerData DROP COLUMN " + quote_identifier(write.column);
+        return exec(sql.c_str());
+    }
+    case viewer_write_kind::update_cell:
+    {
+        sqlite3_stmt* statement = get_statement(
+            "UPDATE ViewerData SET " + quote_identifier(write.column) + "=? WHERE " + quote_identifier(write.key_column) + "=?");
+        if (!statement) return false;
+
+        bind_value(statement, 1, write.value);
+        sqlite3_bind_text(statement, 2, write.key.data(), int(write.key.size()), SQLITE_TRANSIENT);
+        const int result = sqlite3_step(statement);
+        sqlite3_reset(statement);
+        return result == SQLITE_DONE;
+    }
+    case viewer_write_kind::insert_row:
+    {
+        //Rows all have the same columns between schema changes, so this is one cached statement too.
+        std::string sql = "INSERT INTO ViewerData (";
+        std::string placeholders;
+        for (size_t i = 0; i < write.row.size(); ++i)
+        {
+            if (i > 0)
+            {
+                sql += ",";
+                placeholders += ",";
+            }
+            sql += quote_identifier(write.row[i].first);
+            placeholders += "?";
+        }
+        sql += ") VALUES(" + placeholders + ")";
+
+        sqlite3_stmt* statement = get_statement(sql);
+        if (!statement) return false;
+
+        for (size_t i = 0; i < write.row.size(); ++i)
+        {
+            bind_value(statement, int(i + 1), write.row[i].second);
+        }
+        const int result = sqlite3_step(statement);
+        sqlite3_reset(statement);
+        return result == SQLITE_DONE;
+    }
+    }
+    return false;
+}
+
+sqlite3_stmt* viewer_writer::get_statement(const std::string& sql)
+{
+    auto cached = statements.find(sql);
+    if (cached != statements.end()) return cached->second;
+
+    sqlite3_stmt* statement = nullptr;
+    if (sqlite3_prepare_v3(db, sql.c_str(), int(sql.size()), SQLITE_PREPARE_PERSISTENT, &statement, nullptr) != SQLITE_OK)
+    {
+        return nullptr;
+    }
+
+    statements.emplace(sql, statement);
+    return statement;
+}
+
+void viewer_writer::clear_statements()
+{
+    for (auto& entry : statements)
+    {
+        sqlite3_finalize(entry.second);
+    }
+    statements.clear();
+}
+
+bool viewer_writer::exec(const char* sql)
+{
+    return sqlite3_exec(db, sql, nullptr, nullptr, nullptr) == SQLITE_OK;
+}
+
+void viewer_writer::report_error(const std::string& context)
+{
+    std::string message = context + ": " + sqlite3_errmsg(db);
+    std::cout << message << std::endl;
+    if (on_error) on_error(message);
+}
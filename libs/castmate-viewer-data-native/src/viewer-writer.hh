@@ -0,0 +1,45 @@
+#pragma once
+
+#include <sqlite3.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <unordered_map>
+
+#include "viewer-store.hh"
+
+//Owns the SQLite connection. Loads the table into a viewer_store on open, then drains the store's write queue
+//on a background thread, one transaction per batch with prepared statements cached by their SQL.
+class viewer_writer
+{
+public:
+    ~viewer_writer();
+
+    bool open(const std::string& path, viewer_store& store, std::string& error);
+    void start(viewer_write_queue& queue, std::function<void(const std::string&)> on_error);
+    //Writes anything still pending before closing the database.
+    void close();
+
+    uint32_t flush_interval_ms = 100;
+
+private:
+    bool load(viewer_store& store, std::string& error);
+
+    void writer_thread_main();
+    void write_batch(const std::vector<viewer_write>& batch);
+    bool run_write(const viewer_write& write);
+
+    sqlite3_stmt* get_statement(const std::string& sql);
+    void clear_statements();
+    bool exec(const char* sql);
+    void report_error(const std::string& context);
+
+    sqlite3* db = nullptr;
+    viewer_write_queue* queue = nullptr;
+    std::thread writer_thread;
+    std::function<void(const std::string&)> on_error;
+
+    std::unordered_map<std::string, sqlite3_stmt*> statements;
+};
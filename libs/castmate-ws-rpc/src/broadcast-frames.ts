@@ -0,0 +1,75 @@
+//Decoder for the binary frames castmate-broadcast-native batches websocket messages into. Frames are an 8 byte
+//header (version u8, flags u8, reserved u16, message count u32) then per message a u32 byte length and UTF-8 JSON,
+//all little endian. With the deflate flag set everything after the header is raw deflate.
+
+const frameHeaderSize = 8
+const frameVersion = 1
+const deflateFlag = 1
+
+async function inflateRaw(data: Uint8Array) {
+	const stream = new Blob([data]).stream().pipeThrough(new DecompressionStream("deflate-raw"))
+	return new Uint8Array(await new Response(stream).arrayBuffer())
+}
+
+function toBytes(data: ArrayBuffer | ArrayBufferView) {
+	if (data instanceof ArrayBuffer) return new Uint8Array(data)
+	return new Uint8Array(data.buffer, data.byteOffset, data.byteLength)
+}
+
+/**
+ * Splits a frame back into the JSON text of each message, in the order they were sent
+ */
+export async function decodeBroadcastFrame(data: ArrayBuffer | ArrayBufferView): Promise<string[]> {
+	const bytes = toBytes(data)
+	if (bytes.byteLength < frameHeaderSize) return []
+
+	const header = new DataView(bytes.buffer, bytes.byteOffset, frameHeaderSize)
+	if (header.getUint8(0) != frameVersion) return []
+
+	const flags = header.getUint8(1)
+	const count = header.getUint32(4, true)
+
+	let body = bytes.subarray(frameHeaderSize)
+	if (flags & deflateFlag) {
+		body = await inflateRaw(body)
+	}
+
+	const view = new DataView(body.buffer, body.byteOffset, body.byteLength)
+	const decoder = new TextDecoder()
+	const messages = new Array<string>()
+
+	let offset = 0
+	for (let i = 0; i < count; ++i) {
+		if (offset + 4 > body.byteLength) break
+		const length = view.getUint32(offset, true)
+		offset += 4
+
+		if (offset + length > body.byteLength) break
+		messages.push(decoder.decode(body.subarray(offset, offset + length)))
+		offset += length
+	}
+
+	return messages
+}
+
+/**
+ * Takes a socket's messages as they arrive, text or frames, and hands on each message's JSON text in order.
+ * Compressed frames decode asynchronously so everything after one waits for it.
+ */
+export function createBroadcastReader(onMessage: (text: string) => any) {
+	let pending: Promise<void> = Promise.resolve()
+
+	return (data: string | ArrayBuffer | ArrayBufferView) => {
+		pending = pending.then(async () => {
+			if (typeof data == "string") {
+				onMessage(data)
+				return
+			}
+
+			for (const message of await decodeBroadcastFrame(data)) {
+				onMessage(message)
+			}
+		})
+		pending = pending.catch((err) => console.error("Broadcast Frame Error", err))
+	}
+}
@@ -1,6 +1,7 @@
 import { WebSocket } from "ws"
 import { customAlphabet } from "nanoid/non-secure"
 import { DelayedResolver, createDelayedResolver } from "castmate-schema"
+import { createBroadcastReader } from "./broadcast-frames"
 
 const idGen = customAlphabet("abcdefghijklmnop0123456789", 10)
 
@@ -25,14 +26,34 @@ interface RequestMessage {
 export type RPCMessage = ResponseMessage | RequestMessage
 type Sender = (data: RPCMessage) => any
 
+interface OutstandingMultiCall {
+	remaining: number
+	results: any[]
+	resolver: DelayedResolver<any[]>
+}
+
 export class RPCHandler {
 	private outstandingCalls: Record<string, DelayedResolver<any>> = {}
+	private outstandingMultiCalls: Record<string, OutstandingMultiCall> = {}
 	private handlers: Record<string, (id: string, sender: Sender, ...args: any[]) => any> = {}
 
 	constructor() {}
 
 	async handleMessage(data: RPCMessage, sender: (data: RPCMessage) => any, ...preArgs: any[]) {
 		if ("responseId" in data) {
+			const multiCall = this.outstandingMultiCalls[data.responseId]
+			if (multiCall) {
+				if (!("failed" in data)) {
+					multiCall.results.push(data.result)
+				}
+				multiCall.remaining -= 1
+				if (multiCall.remaining <= 0) {
+					delete this.outstandingMultiCalls[data.responseId]
+					multiCall.resolver.resolve(multiCall.results)
+				}
+				return
+			}
+
 			const outstandingCall = this.outstandingCalls[data.responseId]
 			if (!outstandingCall) {
 				return
@@ -106,6 +127,31 @@ export class RPCHandler {
 
 		return resolver.promise
 	}
+
+	/**
+	 * Makes the same call on several remotes with a single request, so a broadcaster can serialize it once and send
+	 * every remote the same bytes. Resolves with the results of the remotes that succeeded once all have answered.
+	 */
+	callMany(name: string, remoteCount: number, sender: (message: RPCMessage) => any, ...args: any[]) {
+		const resolver = createDelayedResolver<any[]>()
+
+		if (remoteCount <= 0) {
+			resolver.resolve([])
+			return resolver.promise
+		}
+
+		const data = {
+			name,
+			requestId: idGen(),
+			args: [...args],
+		}
+
+		this.outstandingMultiCalls[data.requestId] = { remaining: remoteCount, results: [], resolver }
+
+		sender(data)
+
+		return resolver.promise
+	}
 }
 
 export class RPCWebSocket {
@@ -113,17 +159,23 @@ export class RPCWebSocket {
 	private sender = (message: RPCMessage) => this.socket.send(JSON.stringify(message))
 
 	constructor(private socket: WebSocket) {
-		this.socket.onmessage = async (event) => {
-			let data = undefined
-			if (typeof event.data != "string") return
+		//Broadcasts can arrive batched into binary frames
+		this.socket.binaryType = "arraybuffer"
 
+		const reader = createBroadcastReader((text) => {
+			let data = undefined
 			try {
-				data = JSON.parse(event.data)
+				data = JSON.parse(text)
 			} catch {
 				return
 			}
 
 			this.handler.handleMessage(data, this.sender)
+		})
+
+		this.socket.onmessage = async (event) => {
+			if (typeof event.data != "string" && !(event.data instanceof ArrayBuffer)) return
+			reader(event.data)
 		}
 	}
 
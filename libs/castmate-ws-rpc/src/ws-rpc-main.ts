@@ -1 +1,2 @@
 export * from "./rpc-socket"
+export * from "./broadcast-frames"
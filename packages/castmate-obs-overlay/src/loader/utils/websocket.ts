@@ -1,8 +1,8 @@
 import { defineStore } from "pinia"
 import { ComputedRef, MaybeRefOrGetter, computed, ref, toValue } from "vue"
-import { RPCHandler, RPCMessage } from "castmate-ws-rpc"
+import { RPCHandler, RPCMessage, createBroadcastReader } from "castmate-ws-rpc"
 import { OverlayConfig } from "castmate-plugin-overlays-shared"
-import { CastMateBridgeImplementation, useOverlaySoundPlayer } from "castmate-overlay-core"
+import { CastMateBridgeImplementation, connectAudioStream, useOverlaySoundPlayer } from "castmate-overlay-core"
 import { ViewerDataRow, ViewerDataObserver, IPCSchema } from "castmate-schema"
 import { ipcParseSchema } from "./ipc-schema"
 
@@ -28,9 +28,22 @@ export const useWebsocketBridge = defineStore("websocket-bridge", () => {
 
 	const sender = (data: RPCMessage) => websocket?.send(JSON.stringify(data))
 
+	const reader = createBroadcastReader((text) => {
+		let data: RPCMessage | undefined = undefined
+		try {
+			data = JSON.parse(text)
+		} catch {
+			return
+		}
+
+		rpcs.handleMessage(data as RPCMessage, sender)
+	})
+
 	function connect() {
 		console.log("Connecting To ", `ws://${window.location.host}?overlay=${overlayId.value}`)
-		websocket = new WebSocket(`ws://${window.location.host}?overlay=${overlayId.value}`)
+		//frames=1 asks for messages batched into binary frames
+		websocket = new WebSocket(`ws://${window.location.host}?overlay=${overlayId.value}&frames=1`)
+		websocket.binaryType = "arraybuffer"
 
 		websocket.addEventListener("error", (err) => {
 			console.error("WebSocket Error:", err)
@@ -45,16 +58,8 @@ export const useWebsocketBridge = defineStore("websocket-bridge", () => {
 		})
 
 		websocket.addEventListener("message", (ev) => {
-			let data: RPCMessage | undefined = undefined
-			if (typeof ev.data != "string") return
-
-			try {
-				data = JSON.parse(ev.data)
-			} catch {
-				return
-			}
-
-			rpcs.handleMessage(data as RPCMessage, sender)
+			if (typeof ev.data != "string" && !(ev.data instanceof ArrayBuffer)) return
+			reader(ev.data)
 		})
 	}
 
@@ -269,6 +274,9 @@ export const useWebsocketBridge = defineStore("websocket-bridge", () => {
 
 	async function initialize() {
 		connect()
+
+		//While this is connected overlay sounds arrive already mixed instead of through overlays_playAudio
+		connectAudioStream(`ws://${window.location.host}/sound/stream?bus=overlay.${overlayId.value}`)
 	}
 
 	return {
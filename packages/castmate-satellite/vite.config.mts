@@ -38,6 +38,9 @@ export default defineConfig({
 							"discord.js",
 							"castmate-plugin-sound-native",
 							"castmate-plugin-input-native",
+							"castmate-broadcast-native",
+							"castmate-chunk-store-native",
+							"castmate-loader-native",
 							"node-screenshots",
 							"better-sqlite3",
 						],
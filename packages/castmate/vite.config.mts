@@ -40,6 +40,13 @@ export default defineConfig({
 							"discord.js",
 							"castmate-plugin-sound-native",
 							"castmate-plugin-input-native",
+							"castmate-emotes-native",
+							"castmate-viewer-data-native",
+							"castmate-media-native",
+							"castmate-scheduler-native",
+							"castmate-broadcast-native",
+							"castmate-chunk-store-native",
+							"castmate-loader-native",
 							"node-screenshots",
 							"better-sqlite3",
 							"@azure/web-pubsub-client",
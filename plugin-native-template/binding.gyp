@@ -5,6 +5,9 @@
             "cflags!": [ "-fno-exceptions" ],
             "cflags_cc!": [ "-fno-exceptions" ],
             "sources": [ "src/native-index.cc" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
             "include_dirs": [
                 "<!@(node -p \"require('node-addon-api').include\")"
             ],
@@ -1,17 +1,33 @@
 #include <napi.h>
-#include <uv.h> //ABI Stability questions go here...
 
+#include "castmate-native/errors.hh"
+#include "castmate-native/event-dispatcher.hh"
+#include "castmate-native/trace-bindings.hh"
 
-Napi::Object Init(Napi::Env env, Napi::Object exports) {  
+
+class instance_data
+{
+public:
+    instance_data(Napi::Env env)
+    {
+    }
+
+    ~instance_data() {
+
+    }
+};
+
+
+Napi::Object Init(Napi::Env env, Napi::Object exports) {
     //New up some instance data, it will be deleted when the module is unloaded.
     env.SetInstanceData<instance_data>(new instance_data(env));
 
-    audio_input::init(env, exports);
-    speech_engine::init(env, exports);
-    command_grammar::init(env, exports);
-    speech_recognizer::init(env, exports);
+    //Register the addon's ObjectWraps here, ie my_interface::init(env, exports);
+    //Events from native threads should go through a js_call_dispatcher rather than a raw ThreadSafeFunction,
+    //and anything worth timing can be wrapped in TRACE_SCOPE("name").
+    trace_init(env, exports);
 
     return exports;
 }
 
-NODE_API_MODULE(ms_speech_native, Init)
\ No newline at end of file
+NODE_API_MODULE(castmate_plugin_{{name}}_native, Init)
@@ -0,0 +1,48 @@
+import { defineSetting, onLoad, onSettingChanged } from "castmate-core"
+import { InputDevice, InputInterface } from "castmate-plugin-input-native"
+
+function hex4(value: number) {
+	return value.toString(16).toUpperCase().padStart(4, "0")
+}
+
+function getDeviceName(device: InputDevice) {
+	if (device.id == "injected") return "Injected Input"
+
+	const type = device.type == "hid" ? "Controller" : device.type == "mouse" ? "Mouse" : "Keyboard"
+	return `${type} ${hex4(device.vendorId)}:${hex4(device.productId)}`
+}
+
+export function setupDeviceFilter(inputInterface: InputInterface) {
+	async function getDeviceEnum() {
+		return inputInterface.getInputDevices().map((device) => ({ value: device.id, name: getDeviceName(device) }))
+	}
+
+	const allowedDevices = defineSetting("allowedDevices", {
+		type: Array,
+		name: "Only Listen To Devices",
+		items: { type: String, name: "Device", required: true, enum: getDeviceEnum },
+		required: true,
+		default: [],
+	})
+
+	const ignoredDevices = defineSetting("ignoredDevices", {
+		type: Array,
+		name: "Ignore Devices",
+		items: { type: String, name: "Device", required: true, enum: getDeviceEnum },
+		required: true,
+		default: [],
+	})
+
+	function updateDeviceFilter() {
+		//An empty allow list lets every device through
+		inputInterface.setDeviceFilter({ allow: [...allowedDevices.value], deny: [...ignoredDevices.value] })
+	}
+
+	onLoad(() => {
+		updateDeviceFilter()
+	})
+
+	onSettingChanged([allowedDevices, ignoredDevices], () => {
+		updateDeviceFilter()
+	})
+}
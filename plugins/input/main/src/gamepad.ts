@@ -1,5 +1,14 @@
-import { Resource, ResourceRegistry, ResourceStorage, definePluginResource, onLoad } from "castmate-core"
+import {
+	Resource,
+	ResourceRegistry,
+	ResourceStorage,
+	defineTrigger,
+	definePluginResource,
+	onLoad,
+	onProfilesChanged,
+} from "castmate-core"
 import { GamepadConfig } from "castmate-plugin-input-shared"
+import { InputInterface } from "castmate-plugin-input-native"
 
 export class GamepadResource extends Resource<GamepadConfig> {
 	static storage = new ResourceStorage<GamepadResource>("Gamepad")
@@ -8,3 +17,48 @@ export class GamepadResource extends Resource<GamepadConfig> {
 export function setupGamepad() {
 	definePluginResource(GamepadResource)
 }
+
+export function setupControllerTriggers(inputInterface: InputInterface) {
+	const controllerButton = defineTrigger({
+		id: "controllerButton",
+		name: "Controller Button",
+		icon: "mdi mdi-controller",
+		config: {
+			type: Object,
+			properties: {
+				button: { type: Number, name: "Button", required: true, default: 1, min: 1 },
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				button: { type: Number, required: true, default: 1 },
+				device: { type: String, required: true, default: "" },
+			},
+		},
+		async handle(config, context) {
+			return config.button == context.button
+		},
+	})
+
+	inputInterface.on("controller-button-pressed", (deviceId, button) => {
+		controllerButton({ button, device: deviceId })
+	})
+
+	onProfilesChanged((activeProfiles, inactiveProfiles) => {
+		let hasControllerTriggers = false
+
+		for (const profile of activeProfiles) {
+			for (const trigger of profile.iterTriggers(controllerButton)) {
+				hasControllerTriggers = true
+			}
+		}
+
+		//Controllers poll constantly, only listen to them when something cares
+		if (hasControllerTriggers) {
+			inputInterface.startControllerEvents()
+		} else {
+			inputInterface.stopControllerEvents()
+		}
+	})
+}
@@ -56,6 +56,32 @@ export function setupKeyboard(inputInterface: InputInterface) {
 		},
 	})
 
+	defineAction({
+		id: "typeText",
+		name: "Type Text",
+		icon: "mdi mdi-keyboard-outline",
+		description: "Types text into whatever has focus",
+		config: {
+			type: Object,
+			properties: {
+				text: { type: String, name: "Text", required: true, default: "", template: true, multiLine: true },
+				cps: {
+					type: Number,
+					name: "Characters Per Second",
+					description: "0 types everything at once",
+					required: true,
+					default: 0,
+					min: 0,
+					max: 1000,
+				},
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			//One native call per string, the pacing happens natively
+			await inputInterface.typeText(config.text, config.cps, abortSignal)
+		},
+	})
+
 	const keyboardShortcut = defineTrigger({
 		id: "keyboardShortcut",
 		name: "Keyboard Shortcut",
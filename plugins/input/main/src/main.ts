@@ -1,9 +1,12 @@
-import { defineAction, defineTrigger, onLoad, onUnload, definePlugin } from "castmate-core"
+import { defineAction, defineTrigger, onLoad, onUnload, definePlugin, registerNativeTracer } from "castmate-core"
 
 import { setupKeyboard } from "./keyboard"
-import { InputInterface } from "castmate-plugin-input-native"
+import { InputInterface, tracer } from "castmate-plugin-input-native"
 
 import { setupMouse } from "./mouse"
+import { setupRecording } from "./recording"
+import { setupControllerTriggers } from "./gamepad"
+import { setupDeviceFilter } from "./devices"
 
 export default definePlugin(
 	{
@@ -15,16 +18,21 @@ export default definePlugin(
 	},
 	() => {
 		const inputInterface = new InputInterface()
+		registerNativeTracer("input", tracer)
 
 		onLoad(() => {
 			inputInterface.startEvents()
 		})
 
 		onUnload(() => {
+			inputInterface.stopRecording()
 			inputInterface.stopEvents()
 		})
 
+		setupDeviceFilter(inputInterface)
 		setupKeyboard(inputInterface)
 		setupMouse(inputInterface)
+		setupRecording(inputInterface)
+		setupControllerTriggers(inputInterface)
 	}
 )
@@ -1,6 +1,23 @@
-import { abortableSleep, defineAction } from "castmate-core"
+import {
+	abortableSleep,
+	defineAction,
+	defineSetting,
+	defineTrigger,
+	onProfilesChanged,
+	onSettingChanged,
+} from "castmate-core"
 import { InputInterface, MouseButton } from "castmate-plugin-input-native"
-import { Duration } from "castmate-schema"
+import { Duration, Range } from "castmate-schema"
+
+type MouseDirection = "Left" | "Right" | "Up" | "Down"
+
+function getMouseDirection(dx: number, dy: number): MouseDirection {
+	if (Math.abs(dx) > Math.abs(dy)) {
+		return dx > 0 ? "Right" : "Left"
+	}
+	//Raw mouse deltas are in screen space, positive y is down
+	return dy > 0 ? "Down" : "Up"
+}
 
 export function setupMouse(inputInterface: InputInterface) {
 	defineAction({
@@ -34,4 +51,120 @@ export function setupMouse(inputInterface: InputInterface) {
 			inputInterface.simulateMouseUp(config.button as MouseButton)
 		},
 	})
+	const flickSpeed = defineSetting("flickSpeed", {
+		type: Number,
+		name: "Mouse Flick Speed",
+		unit: "counts/s",
+		required: true,
+		default: 5000,
+		min: 0,
+	})
+
+	const mouseFlick = defineTrigger({
+		id: "mouseFlick",
+		name: "Mouse Flick",
+		icon: "mdi mdi-mouse-move-vertical",
+		config: {
+			type: Object,
+			properties: {
+				direction: {
+					type: String,
+					name: "Direction",
+					enum: ["Any", "Left", "Right", "Up", "Down"],
+					required: true,
+					default: "Any",
+				},
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				direction: { type: String, required: true, default: "Right" },
+				velocity: { type: Number, required: true, default: 5000 },
+			},
+		},
+		async handle(config, context) {
+			return config.direction == "Any" || config.direction == context.direction
+		},
+	})
+
+	const mouseScroll = defineTrigger({
+		id: "mouseScroll",
+		name: "Mouse Scroll",
+		icon: "mdi mdi-mouse-move-vertical",
+		config: {
+			type: Object,
+			properties: {
+				direction: {
+					type: String,
+					name: "Direction",
+					enum: ["Up", "Down", "Left", "Right"],
+					required: true,
+					default: "Up",
+				},
+				ticks: { type: Range, name: "Ticks", required: true, default: {} },
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				direction: { type: String, required: true, default: "Up" },
+				ticks: { type: Number, required: true, default: 1 },
+			},
+		},
+		async handle(config, context) {
+			if (config.direction != context.direction) return false
+			return Range.inRange(config.ticks, context.ticks)
+		},
+	})
+
+	inputInterface.on("mouse-flick", (velocity, dx, dy) => {
+		mouseFlick({ direction: getMouseDirection(dx, dy), velocity })
+	})
+
+	inputInterface.on("mouse-wheel", (vertical, horizontal) => {
+		if (vertical != 0) {
+			mouseScroll({ direction: vertical > 0 ? "Up" : "Down", ticks: Math.abs(vertical) })
+		}
+		if (horizontal != 0) {
+			mouseScroll({ direction: horizontal > 0 ? "Right" : "Left", ticks: Math.abs(horizontal) })
+		}
+	})
+
+	let hasFlickTriggers = false
+	let hasScrollTriggers = false
+
+	function updateMouseEvents() {
+		if (!hasFlickTriggers && !hasScrollTriggers) {
+			inputInterface.stopMouseEvents()
+			return
+		}
+
+		//Only ask the native side for what's actually used so unused reports never leave the input thread
+		inputInterface.startMouseEvents({
+			flushInterval: hasScrollTriggers ? 50 : 0,
+			wheelThreshold: 0,
+			flickVelocity: hasFlickTriggers ? flickSpeed.value : 0,
+		})
+	}
+
+	onSettingChanged(flickSpeed, () => {
+		updateMouseEvents()
+	})
+
+	onProfilesChanged((activeProfiles, inactiveProfiles) => {
+		hasFlickTriggers = false
+		hasScrollTriggers = false
+
+		for (const profile of activeProfiles) {
+			for (const trigger of profile.iterTriggers(mouseFlick)) {
+				hasFlickTriggers = true
+			}
+			for (const trigger of profile.iterTriggers(mouseScroll)) {
+				hasScrollTriggers = true
+			}
+		}
+
+		updateMouseEvents()
+	})
 }
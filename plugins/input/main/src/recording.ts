@@ -0,0 +1,76 @@
+import { defineAction, ensureDirectory, onLoad, resolveProjectPath, usePluginLogger } from "castmate-core"
+import { InputInterface } from "castmate-plugin-input-native"
+import * as path from "path"
+
+const logger = usePluginLogger("input")
+
+//Names come straight from action config, they may only name a file inside input-recordings
+function getRecordingPath(name: string) {
+	const bareName = path.win32.basename(name) == name && path.posix.basename(name) == name
+	if (!name || name == "." || name == ".." || !bareName) {
+		logger.error("Invalid recording name", name)
+		return undefined
+	}
+	return resolveProjectPath("input-recordings", `${name}.cmir`)
+}
+
+export function setupRecording(inputInterface: InputInterface) {
+	onLoad(async () => {
+		await ensureDirectory(resolveProjectPath("input-recordings"))
+	})
+
+	defineAction({
+		id: "startInputRecording",
+		name: "Start Input Recording",
+		description: "Records keyboard and mouse input until stopped",
+		icon: "mdi mdi-record-rec",
+		config: {
+			type: Object,
+			properties: {
+				recording: { type: String, name: "Recording Name", required: true, default: "Recording" },
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			const file = getRecordingPath(config.recording)
+			if (!file) return
+			inputInterface.startRecording(file)
+		},
+	})
+
+	defineAction({
+		id: "stopInputRecording",
+		name: "Stop Input Recording",
+		icon: "mdi mdi-stop",
+		config: {
+			type: Object,
+			properties: {},
+		},
+		async invoke(config, contextData, abortSignal) {
+			inputInterface.stopRecording()
+		},
+	})
+
+	defineAction({
+		id: "replayInputRecording",
+		name: "Replay Input Recording",
+		description: "Replays recorded keyboard and mouse input",
+		icon: "mdi mdi-play",
+		config: {
+			type: Object,
+			properties: {
+				recording: { type: String, name: "Recording Name", required: true, default: "Recording" },
+				speed: { type: Number, name: "Speed", required: true, default: 1, min: 0.1, max: 10, step: 0.1 },
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			const file = getRecordingPath(config.recording)
+			if (!file) return
+
+			try {
+				await inputInterface.replay(file, config.speed, abortSignal)
+			} catch (err) {
+				logger.error("Failed to replay", config.recording, err)
+			}
+		},
+	})
+}
@@ -0,0 +1,159 @@
+// Input pipeline latency benchmark
+// Measures capture -> TSFN enqueue -> JS dispatch -> listener for synthetic key events
+// while the event loop is kept busy, so regressions in the event path show up as latency or lost throughput.
+//
+// Build first with `yarn rebuild`, then run `yarn bench` (add --json for machine readable output)
+// Options: --rates=1000,5000,20000 --duration=5 --busy=4 --busy-interval=16
+
+const bindings = require("bindings")
+
+const { NativeInputInterface } = bindings({
+	bindings: "castmate-plugin-input-native-bench",
+})
+
+function parseArgs() {
+	const options = {
+		rates: [1000, 5000, 20000],
+		duration: 5,
+		busy: 4,
+		busyInterval: 16,
+		json: false,
+	}
+
+	for (const arg of process.argv.slice(2)) {
+		const [key, value] = arg.replace(/^--/, "").split("=")
+		if (key == "rates") options.rates = value.split(",").map(Number)
+		else if (key == "duration") options.duration = Number(value)
+		else if (key == "busy") options.busy = Number(value)
+		else if (key == "busy-interval") options.busyInterval = Number(value)
+		else if (key == "json") options.json = true
+	}
+
+	return options
+}
+
+function percentile(sorted, p) {
+	if (sorted.length == 0) return NaN
+	const index = Math.min(sorted.length - 1, Math.ceil((p / 100) * sorted.length) - 1)
+	return sorted[Math.max(0, index)]
+}
+
+function summarize(samples, count) {
+	const sorted = samples.subarray(0, count).sort()
+	return {
+		p50: percentile(sorted, 50),
+		p99: percentile(sorted, 99),
+		p999: percentile(sorted, 99.9),
+		max: sorted[sorted.length - 1],
+	}
+}
+
+function busyWait(ms) {
+	const end = performance.now() + ms
+	while (performance.now() < end) {}
+}
+
+function runRate(rate, options) {
+	return new Promise((resolve) => {
+		const total = Math.round(rate * options.duration)
+
+		const enqueue = new Float64Array(total)
+		const dispatch = new Float64Array(total)
+		const listener = new Float64Array(total)
+		const endToEnd = new Float64Array(total)
+
+		let received = 0
+		let firstCapture = 0
+		let lastListener = 0
+
+		let native = null
+		const emit = (event, vkCode, deviceId, captureUs, enqueueUs, dispatchUs) => {
+			if (event != "key-pressed" && event != "key-released") return
+			const listenerUs = native.benchmarkNow()
+
+			if (received == 0) firstCapture = captureUs
+			lastListener = listenerUs
+
+			enqueue[received] = enqueueUs - captureUs
+			dispatch[received] = dispatchUs - enqueueUs
+			listener[received] = listenerUs - dispatchUs
+			endToEnd[received] = listenerUs - captureUs
+			received++
+
+			if (received == total) finish()
+		}
+
+		native = new NativeInputInterface(emit)
+
+		//Simulate a main thread that's busy with other plugins
+		const busyTimer = setInterval(() => busyWait(options.busy), options.busyInterval)
+
+		//Give stragglers a generous window before calling events lost
+		const timeout = setTimeout(finish, options.duration * 1000 * 2 + 2000)
+
+		let finished = false
+		function finish() {
+			if (finished) return
+			finished = true
+
+			clearInterval(busyTimer)
+			clearTimeout(timeout)
+			native.stopSyntheticEvents()
+
+			//Events the dispatcher's ring had no room for, these never reach the listener
+			const stats = native.benchmarkStats()
+
+			const elapsedS = (lastListener - firstCapture) / 1000000
+			resolve({
+				rate,
+				sent: total,
+				received,
+				dropped: stats.dropped,
+				batches: stats.batches,
+				largestBatch: stats.largestBatch,
+				throughput: elapsedS > 0 ? received / elapsedS : 0,
+				captureToEnqueue: summarize(enqueue, received),
+				enqueueToDispatch: summarize(dispatch, received),
+				dispatchToListener: summarize(listener, received),
+				endToEnd: summarize(endToEnd, received),
+			})
+		}
+
+		native.startSyntheticEvents(rate, total)
+	})
+}
+
+function formatStage(name, stats) {
+	const us = (v) => `${v.toFixed(0)}us`.padStart(9)
+	return `  ${name.padEnd(22)} p50 ${us(stats.p50)}  p99 ${us(stats.p99)}  p99.9 ${us(stats.p999)}  max ${us(stats.max)}`
+}
+
+async function main() {
+	const options = parseArgs()
+	const results = []
+
+	for (const rate of options.rates) {
+		const result = await runRate(rate, options)
+		results.push(result)
+
+		if (!options.json) {
+			console.log(
+				`${rate} events/s: received ${result.received}/${result.sent}, dropped ${result.dropped}, ${result.throughput.toFixed(0)} events/s`
+			)
+			console.log(`  ${result.batches} dispatches, largest ${result.largestBatch} events`)
+			console.log(formatStage("capture -> enqueue", result.captureToEnqueue))
+			console.log(formatStage("enqueue -> dispatch", result.enqueueToDispatch))
+			console.log(formatStage("dispatch -> listener", result.dispatchToListener))
+			console.log(formatStage("end to end", result.endToEnd))
+		}
+	}
+
+	if (options.json) {
+		console.log(JSON.stringify({ options, results }, null, "\t"))
+	}
+
+	//The addon's TSFN keeps the loop alive until it's collected
+	process.exit(0)
+}
+
+main()
@@ -1,14 +1,36 @@
 {
+    "variables": {
+        "input_sources": [ "src/native-index.cc", "src/input-interface.cc", "src/mouse-tracker.cc", "src/input-devices.cc", "src/input-recording.cc", "src/input-replay.cc", "src/input-typer.cc", "src/controller-filter.cc", "src/hid-controller.cc" ],
+    },
     "targets": [
         {
             "target_name": "castmate-plugin-input-native",
             "cflags!": [ "-fno-exceptions" ],
             "cflags_cc!": [ "-fno-exceptions" ],
-            "sources": [ "src/native-index.cc", "src/input-interface.cc" ],
+            "sources": [ "<@(input_sources)" ],
+            "libraries": [ "winmm.lib", "hid.lib" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
             "include_dirs": [
                 "<!@(node -p \"require('node-addon-api').include\")"
             ],
             "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS=1" ],
+        },
+        {
+            # Same addon with stage timestamps and a synthetic event source, used by bench/latency.js
+            "target_name": "castmate-plugin-input-native-bench",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "sources": [ "<@(input_sources)" ],
+            "libraries": [ "winmm.lib", "hid.lib" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "include_dirs": [
+                "<!@(node -p \"require('node-addon-api').include\")"
+            ],
+            "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS=1", "CASTMATE_INPUT_BENCHMARK=1" ],
         }
     ]
-}
\ No newline at end of file
+}
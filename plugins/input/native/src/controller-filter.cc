@@ -0,0 +1,111 @@
+#include "controller-filter.hh"
+
+#include <cmath>
+
+double axis_filter::apply_deadzone(double deadzone, double normalized)
+{
+    const double magnitude = std::fabs(normalized);
+    if (magnitude <= deadzone) return 0;
+    if (deadzone >= 1) return 0;
+
+    //Rescale so the output still covers the full range right outside the deadzone.
+    const double scaled = std::fmin((magnitude - deadzone) / (1 - deadzone), 1.0);
+    return normalized < 0 ? -scaled : scaled;
+}
+
+double axis_filter::quantize(uint32_t steps, double value)
+{
+    if (steps == 0) return value;
+    return std::round(value * steps) / steps;
+}
+
+bool axis_filter::update(const axis_filter_config& config, double normalized, double& filtered)
+{
+    const double value = quantize(config.steps, apply_deadzone(config.deadzone, normalized));
+
+    if (has_last)
+    {
+        if (value == last) return false;
+
+        //Always let an axis settle back to exactly 0 so a released stick never reads as slightly held.
+        if (value != 0 && std::fabs(value - last) < config.hysteresis) return false;
+    }
+
+    has_last = true;
+    last = value;
+    filtered = value;
+    return true;
+}
+
+void controller_state::set_axis_count(size_t count)
+{
+    axes.resize(count);
+}
+
+void controller_state::update_buttons(const std::bitset<max_controller_buttons>& pressed, std::vector<controller_change>& changes)
+{
+    const std::bitset<max_controller_buttons> changed = pressed ^ buttons;
+    if (changed.none()) return;
+
+    for (size_t i = 0; i < max_controller_buttons; ++i)
+    {
+        if (!changed[i]) continue;
+
+        controller_change change;
+        change.type = pressed[i] ? controller_change::kind::button_pressed : controller_change::kind::button_released;
+        change.index = uint32_t(i);
+        change.value = pressed[i] ? 1 : 0;
+        changes.push_back(change);
+    }
+
+    buttons = pressed;
+}
+
+void controller_state::update_axis(const axis_filter_config& config, size_t axis, double normalized, std::vector<controller_change>& changes)
+{
+    if (axis >= axes.size()) return;
+
+    double filtered;
+    if (!axes[axis].update(config, normalized, filtered)) return;
+
+    controller_change change;
+    change.type = controller_change::kind::axis;
+    change.index = uint32_t(axis);
+    change.value = filtered;
+    changes.push_back(change);
+}
+
+void controller_state::update_hat(size_t hat, int32_t direction, std::vector<controller_change>& changes)
+{
+    if (hat >= hats.size())
+    {
+        hats.resize(hat + 1, -1);
+    }
+
+    if (hats[hat] == direction) return;
+    hats[hat] = direction;
+
+    controller_change change;
+    change.type = controller_change::kind::hat;
+    change.index = uint32_t(hat);
+    change.value = direction;
+    changes.push_back(change);
+}
+
+const char* controller_axis_name(uint16_t usage)
+{
+    switch (usage)
+    {
+    case 0x30: return "x";
+    case 0x31: return "y";
+    case 0x32: return "z";
+    case 0x33: return "rx";
+    case 0x34: return "ry";
+    case 0x35: return "rz";
+    case 0x36: return "slider";
+    case 0x37: return "dial";
+    case 0x38: return "wheel";
+    case 0x39: return "hat";
+    }
+    return "unknown";
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <bitset>
+#include <string>
+#include <vector>
+
+//Controllers report their full state at 250-1000hz even when nothing moved, and analog sticks jitter constantly.
+//The filters reduce that to button edges and axis moves that are actually worth a JS event.
+
+struct axis_filter_config
+{
+    //Fraction of the axis range around center that reads as 0.
+    double deadzone = 0.1;
+    //An axis has to move at least this far (in normalized units) from the last emitted value to emit again.
+    double hysteresis = 0.02;
+    //Number of steps the 0-1 magnitude is quantized to, 0 leaves the value continuous.
+    uint32_t steps = 100;
+};
+
+class axis_filter
+{
+public:
+    //Takes a normalized -1 to 1 value, returns true with the filtered value if it should be emitted.
+    bool update(const axis_filter_config& config, double normalized, double& filtered);
+    void reset() { has_last = false; last = 0; }
+
+    static double apply_deadzone(double deadzone, double normalized);
+    static double quantize(uint32_t steps, double value);
+
+private:
+    bool has_last = false;
+    double last = 0;
+};
+
+static const size_t max_controller_buttons = 128;
+
+struct controller_change
+{
+    enum class kind : uint8_t
+    {
+        button_pressed,
+        button_released,
+        axis,
+        hat,
+    };
+
+    kind type;
+    uint32_t index;
+    double value;
+};
+
+class controller_state
+{
+public:
+    void set_axis_count(size_t count);
+
+    //Compares a full button snapshot against the last one and appends the edges.
+    void update_buttons(const std::bitset<max_controller_buttons>& pressed, std::vector<controller_change>& changes);
+    void update_axis(const axis_filter_config& config, size_t axis, double normalized, std::vector<controller_change>& changes);
+    //Hats are directions 0-7 clockwise from up or -1 when centered, they don't get filtered.
+    void update_hat(size_t hat, int32_t direction, std::vector<controller_change>& changes);
+
+private:
+    std::bitset<max_controller_buttons> buttons;
+    std::vector<axis_filter> axes;
+    std::vector<int32_t> hats;
+};
+
+//Name for a generic desktop page (0x01) usage, ie "x", "ry", "slider"
+const char* controller_axis_name(uint16_t usage);
@@ -0,0 +1,158 @@
+#include "hid-controller.hh"
+
+#include <algorithm>
+
+//Generic Desktop X, Y, Z, Rx, Ry, Rz, Slider, Dial and Wheel, then the hat switch. Nothing else on the page is a
+//controller input, and some devices declare value ranges spanning the whole page.
+static const USAGE first_axis_usage = 0x30;
+static const USAGE hat_switch_usage = 0x39;
+
+static PHIDP_PREPARSED_DATA as_preparsed(std::vector<uint8_t>& preparsed)
+{
+    return reinterpret_cast<PHIDP_PREPARSED_DATA>(preparsed.data());
+}
+
+bool hid_controller::init(HANDLE device_handle)
+{
+    UINT preparsed_size = 0;
+    if (GetRawInputDeviceInfoA(device_handle, RIDI_PREPARSEDDATA, nullptr, &preparsed_size) != 0 || preparsed_size == 0) {
+        return false;
+    }
+
+    preparsed.resize(preparsed_size);
+    if (GetRawInputDeviceInfoA(device_handle, RIDI_PREPARSEDDATA, preparsed.data(), &preparsed_size) == (UINT)-1) {
+        return false;
+    }
+
+    if (HidP_GetCaps(as_preparsed(preparsed), &caps) != HIDP_STATUS_SUCCESS) {
+        return false;
+    }
+
+    //Buttons
+    if (caps.NumberInputButtonCaps > 0) {
+        std::vector<HIDP_BUTTON_CAPS> button_caps(caps.NumberInputButtonCaps);
+        USHORT button_caps_count = caps.NumberInputButtonCaps;
+        if (HidP_GetButtonCaps(HidP_Input, button_caps.data(), &button_caps_count, as_preparsed(preparsed)) == HIDP_STATUS_SUCCESS) {
+            max_buttons = HidP_MaxUsageListLength(HidP_Input, HID_USAGE_PAGE_BUTTON, as_preparsed(preparsed));
+        }
+    }
+
+    //Axes and hats
+    if (caps.NumberInputValueCaps > 0) {
+        std::vector<HIDP_VALUE_CAPS> value_caps(caps.NumberInputValueCaps);
+        USHORT value_caps_count = caps.NumberInputValueCaps;
+        if (HidP_GetValueCaps(HidP_Input, value_caps.data(), &value_caps_count, as_preparsed(preparsed)) != HIDP_STATUS_SUCCESS) {
+            return false;
+        }
+
+        size_t hat_count = 0;
+        for (USHORT i = 0; i < value_caps_count; ++i) {
+            const HIDP_VALUE_CAPS& cap = value_caps[i];
+            if (cap.UsagePage != HID_USAGE_PAGE_GENERIC) continue;
+
+            //A field wider than 32 bits can't be read with HidP_GetUsageValue anyway
+            if (cap.BitSize == 0 || cap.BitSize > 32) continue;
+
+            const USAGE usage_min = std::max<USAGE>(cap.IsRange ? cap.Range.UsageMin : cap.NotRange.Usage, first_axis_usage);
+            const USAGE usage_max = std::min<USAGE>(cap.IsRange ? cap.Range.UsageMax : cap.NotRange.Usage, hat_switch_usage);
+
+            //Only the axis usages are kept, so a 0..0xFFFF range is 10 entries rather than 65536 reads per report
+            for (uint32_t usage_index = usage_min; usage_index <= usage_max; ++usage_index) {
+                const USAGE usage = USAGE(usage_index);
+
+                value_input input;
+                input.usage_page = cap.UsagePage;
+                input.usage = usage;
+                input.logical_min = cap.LogicalMin;
+                input.logical_max = cap.LogicalMax;
+                input.bit_size = cap.BitSize;
+                input.is_hat = usage == hat_switch_usage;
+
+                //Some devices report an unsigned range with a bogus logical max.
+                if (input.logical_max <= input.logical_min && input.bit_size < 32) {
+                    input.logical_min = 0;
+                    //In 64 bits, shifting a 32 bit 1 by 31 overflows
+                    input.logical_max = LONG((int64_t(1) << input.bit_size) - 1);
+                }
+
+                if (input.is_hat) {
+                    input.slot = hat_count++;
+                } else {
+                    input.slot = axis_usages.size();
+                    axis_usages.push_back(usage);
+                }
+
+                values.push_back(input);
+            }
+        }
+    }
+
+    state.set_axis_count(axis_usages.size());
+    return true;
+}
+
+const char* hid_controller::axis_name(uint32_t axis) const
+{
+    if (axis >= axis_usages.size()) return "unknown";
+    return controller_axis_name(axis_usages[axis]);
+}
+
+void hid_controller::handle_input(const RAWHID& hid, const axis_filter_config& config, std::vector<controller_change>& changes)
+{
+    //A single WM_INPUT can carry several reports if they arrived faster than we read them.
+    for (DWORD i = 0; i < hid.dwCount; ++i) {
+        PCHAR report = (PCHAR)(hid.bRawData + i * hid.dwSizeHid);
+        handle_report(report, hid.dwSizeHid, config, changes);
+    }
+}
+
+void hid_controller::handle_report(PCHAR report, ULONG report_size, const axis_filter_config& config, std::vector<controller_change>& changes)
+{
+    PHIDP_PREPARSED_DATA preparsed_data = as_preparsed(preparsed);
+
+    if (max_buttons > 0) {
+        USAGE usages[max_controller_buttons];
+        ULONG usage_count = max_controller_buttons;
+        if (HidP_GetUsages(HidP_Input, HID_USAGE_PAGE_BUTTON, 0, usages, &usage_count, preparsed_data, report, report_size) == HIDP_STATUS_SUCCESS) {
+            std::bitset<max_controller_buttons> pressed;
+            for (ULONG i = 0; i < usage_count; ++i) {
+                //Button usages are 1 based
+                if (usages[i] >= 1 && usages[i] <= max_controller_buttons) {
+                    pressed[usages[i] - 1] = true;
+                }
+            }
+            state.update_buttons(pressed, changes);
+        }
+    }
+
+    for (const value_input& input : values) {
+        ULONG raw_value = 0;
+        if (HidP_GetUsageValue(HidP_Input, input.usage_page, 0, input.usage, &raw_value, preparsed_data, report, report_size) != HIDP_STATUS_SUCCESS) {
+            continue;
+        }
+
+        LONG value = static_cast<LONG>(raw_value);
+        if (input.logical_min < 0 && input.bit_size < 32) {
+            //Sign extend signed fields
+            const LONG sign_bit = 1L << (input.bit_size - 1);
+            value = (value ^ sign_bit) - sign_bit;
+        }
+
+        if (input.is_hat) {
+            int32_t direction = -1;
+            if (value >= input.logical_min && value <= input.logical_max) {
+                direction = value - input.logical_min;
+                //4 way hats skip the diagonals
+                if (input.logical_max - input.logical_min == 3) direction *= 2;
+            }
+            state.update_hat(input.slot, direction, changes);
+            continue;
+        }
+
+        const double range = double(input.logical_max) - double(input.logical_min);
+        if (range <= 0) continue;
+
+        const double normalized = ((double(value) - input.logical_min) / range) * 2.0 - 1.0;
+        state.update_axis(config, input.slot, normalized, changes);
+    }
+}
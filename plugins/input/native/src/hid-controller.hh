@@ -0,0 +1,44 @@
+#pragma once
+
+#include <windows.h>
+#include <hidusage.h>
+#include <hidpi.h>
+
+#include <vector>
+
+#include "controller-filter.hh"
+
+//A joystick or gamepad seen through raw input. The preparsed HID data is fetched once per device
+//so each report only costs a few HidP lookups.
+class hid_controller
+{
+public:
+    bool init(HANDLE device_handle);
+
+    void handle_input(const RAWHID& hid, const axis_filter_config& config, std::vector<controller_change>& changes);
+
+    const char* axis_name(uint32_t axis) const;
+
+private:
+    void handle_report(PCHAR report, ULONG report_size, const axis_filter_config& config, std::vector<controller_change>& changes);
+
+    struct value_input
+    {
+        USAGE usage_page;
+        USAGE usage;
+        LONG logical_min;
+        LONG logical_max;
+        USHORT bit_size;
+        bool is_hat;
+        //Index into the axis or hat list depending on is_hat
+        size_t slot;
+    };
+
+    std::vector<uint8_t> preparsed;
+    HIDP_CAPS caps = {0};
+    std::vector<value_input> values;
+    std::vector<USAGE> axis_usages;
+    ULONG max_buttons = 0;
+
+    controller_state state;
+};
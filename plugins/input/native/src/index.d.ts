@@ -4,8 +4,65 @@ declare namespace CastmatePluginInputNative {
 	type MouseButton = "left" | "right" | "middle" | "mouse4" | "mouse5"
 
 	interface InputInterfaceEvents {
-		"key-pressed": (vkCode: number) => void | Promise<void>
-		"key-released": (vkCode: number) => void | Promise<void>
+		"key-pressed": (vkCode: number, deviceId: string) => void | Promise<void>
+		"key-released": (vkCode: number, deviceId: string) => void | Promise<void>
+		/** Buttons are numbered from 1 */
+		"controller-button-pressed": (deviceId: string, button: number) => void | Promise<void>
+		"controller-button-released": (deviceId: string, button: number) => void | Promise<void>
+		/** Axis value is -1 to 1 after the deadzone and quantization are applied */
+		"controller-axis-changed": (deviceId: string, axis: ControllerAxis, value: number) => void | Promise<void>
+		/** Direction is 0-7 clockwise from up, -1 when centered */
+		"controller-hat-changed": (deviceId: string, hat: number, direction: number) => void | Promise<void>
+		"input-device-added": (deviceId: string, type: InputDeviceType) => void | Promise<void>
+		"input-device-removed": (deviceId: string) => void | Promise<void>
+		"mouse-moved": (dx: number, dy: number) => void | Promise<void>
+		/** Wheel movement in ticks, positive vertical is away from the user, positive horizontal is right */
+		"mouse-wheel": (vertical: number, horizontal: number) => void | Promise<void>
+		"mouse-flick": (velocity: number, dx: number, dy: number) => void | Promise<void>
+	}
+
+	type InputDeviceType = "keyboard" | "mouse" | "hid"
+
+	interface InputDevice {
+		/** Stable across restarts, injected input uses the id "injected" */
+		id: string
+		type: InputDeviceType
+		vendorId: number
+		productId: number
+	}
+
+	interface DeviceFilter {
+		/** If set only these devices are let through */
+		allow?: string[]
+		deny?: string[]
+		/** Restrict a device to only these vkCodes */
+		keys?: Record<string, number[]>
+	}
+
+	type ControllerAxis = "x" | "y" | "z" | "rx" | "ry" | "rz" | "slider" | "dial" | "wheel" | "unknown"
+
+	interface ControllerEventConfig {
+		/** Fraction of the axis around center that reads as 0, defaults to 0.1 */
+		deadzone?: number
+		/** How far an axis has to move from the last emitted value to emit again, defaults to 0.02 */
+		hysteresis?: number
+		/** Number of steps axis values are quantized to, 0 disables, defaults to 100 */
+		steps?: number
+	}
+
+	interface MouseEventConfig {
+		/** How often in ms accumulated motion and wheel movement is emitted, 0 only emits on thresholds */
+		flushInterval?: number
+		/** Emit motion as soon as this many counts have accumulated */
+		moveThreshold?: number
+		/** Emit wheel movement as soon as this many ticks have accumulated, defaults to 1 */
+		wheelThreshold?: number
+		/** Minimum counts per second over the flick window to emit mouse-flick, 0 disables flicks */
+		flickVelocity?: number
+		/** Window in ms that flick velocity is measured over, defaults to 100 */
+		flickWindow?: number
+		/** Minimum ms between flicks, defaults to 250 */
+		flickCooldown?: number
 	}
 
 	class InputInterface extends Events.EventEmitter {
@@ -14,11 +71,38 @@ declare namespace CastmatePluginInputNative {
 		simulateMouseDown(button: MouseButton): void
 		simulateMouseUp(button: MouseButton): void
 
-		isKeyDown(key: number): boolean
+		/** Without a deviceId checks if any allowed device is holding the key */
+		isKeyDown(key: number, deviceId?: string): boolean
+
+		/**
+		 * Records keys, mouse motion, buttons and wheel to a compact binary log until stopRecording is called. The mouse is
+		 * captured while recording even without startMouseEvents.
+		 */
+		startRecording(path: string): void
+		stopRecording(): void
+		/** Plays a recording back, resolves when it finishes or the signal aborts it */
+		replay(path: string, speed: number, abortSignal?: AbortSignal): Promise<void>
+
+		/**
+		 * Types text at cps characters per second, 0 types it all at once. Newlines press Enter and tabs press Tab.
+		 * Resolves with how many characters were typed, nothing more is typed once the signal aborts.
+		 */
+		typeText(text: string, cps: number, abortSignal?: AbortSignal): Promise<number>
+
+		getInputDevices(): InputDevice[]
+		setDeviceFilter(filter: DeviceFilter): void
 
 		startEvents(): void
 		stopEvents(): void
 
+		/** Can be called before startEvents, mouse events start once it has been */
+		startMouseEvents(config?: MouseEventConfig): void
+		stopMouseEvents(): void
+
+		/** Can be called before startEvents, controller events start once it has been */
+		startControllerEvents(config?: ControllerEventConfig): void
+		stopControllerEvents(): void
+
 		on<U extends keyof InputInterfaceEvents>(event: U, listener: InputInterfaceEvents[U]): this
 
 		once<U extends keyof InputInterfaceEvents>(event: U, listener: InputInterfaceEvents[U]): this
@@ -27,6 +111,15 @@ declare namespace CastmatePluginInputNative {
 
 		emit<U extends keyof InputInterfaceEvents>(event: U, ...args: Parameters<InputInterfaceEvents[U]>): boolean
 	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
 }
 
 export = CastmatePluginInputNative
@@ -1,9 +1,17 @@
 const bindings = require("bindings")
 const EventEmitter = require("events")
 
-const { NativeInputInterface } = bindings({
+const native = bindings({
 	bindings: "castmate-plugin-input-native",
 })
+const { NativeInputInterface } = native
+
+//Native tracing, see castmate-native-core/include/castmate-native/trace.hh
+const tracer = {
+	setTracingEnabled: native.setTracingEnabled,
+	dumpTrace: native.dumpTrace,
+	clearTrace: native.clearTrace,
+}
 
 class InputInterface extends EventEmitter {
 	constructor() {
@@ -32,9 +40,69 @@ class InputInterface extends EventEmitter {
 		return this._native.stopEvents(...args)
 	}
 
+	startMouseEvents(...args) {
+		return this._native.startMouseEvents(...args)
+	}
+	stopMouseEvents(...args) {
+		return this._native.stopMouseEvents(...args)
+	}
+
 	isKeyDown(...args) {
 		return this._native.isKeyDown(...args)
 	}
+
+	startControllerEvents(...args) {
+		return this._native.startControllerEvents(...args)
+	}
+	stopControllerEvents(...args) {
+		return this._native.stopControllerEvents(...args)
+	}
+
+	startRecording(...args) {
+		return this._native.startRecording(...args)
+	}
+	stopRecording(...args) {
+		return this._native.stopRecording(...args)
+	}
+
+	replay(path, speed, abortSignal) {
+		return new Promise((resolve, reject) => {
+			try {
+				const id = this._native.replay(path, speed, () => {
+					abortSignal?.removeEventListener("abort", onAbort)
+					resolve()
+				})
+				const onAbort = () => this._native.stopReplay(id)
+				abortSignal?.addEventListener("abort", onAbort)
+				if (abortSignal?.aborted) onAbort()
+			} catch (err) {
+				reject(err)
+			}
+		})
+	}
+
+	typeText(text, cps, abortSignal) {
+		return new Promise((resolve, reject) => {
+			try {
+				const id = this._native.typeText(text, cps, (typed) => {
+					abortSignal?.removeEventListener("abort", onAbort)
+					resolve(typed)
+				})
+				const onAbort = () => this._native.stopTyping(id)
+				abortSignal?.addEventListener("abort", onAbort)
+				if (abortSignal?.aborted) onAbort()
+			} catch (err) {
+				reject(err)
+			}
+		})
+	}
+
+	getInputDevices(...args) {
+		return this._native.getInputDevices(...args)
+	}
+	setDeviceFilter(...args) {
+		return this._native.setDeviceFilter(...args)
+	}
 }
 
-module.exports = { InputInterface }
+module.exports = { InputInterface, tracer }
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+
+//Monotonic microseconds shared by everything in the input pipeline so timestamps from different stages compare.
+inline uint64_t input_now_us()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,78 @@
+#include "input-devices.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+const char* input_device_type_name(input_device_type type)
+{
+    switch (type)
+    {
+    case input_device_type::keyboard:
+        return "keyboard";
+    case input_device_type::mouse:
+        return "mouse";
+    case input_device_type::hid:
+        return "hid";
+    }
+    return "unknown";
+}
+
+void device_filter::apply(input_device& device) const
+{
+    device.allowed = true;
+    if (!allow.empty() && allow.find(device.id) == allow.end())
+    {
+        device.allowed = false;
+    }
+    if (deny.find(device.id) != deny.end())
+    {
+        device.allowed = false;
+    }
+
+    auto subset = key_subsets.find(device.id);
+    device.has_key_subset = subset != key_subsets.end();
+    device.key_subset = device.has_key_subset ? subset->second : std::bitset<256>();
+
+    //Keys held when a device gets filtered out would never see their release.
+    if (!device.allowed)
+    {
+        device.key_states.reset();
+    }
+    else if (device.has_key_subset)
+    {
+        device.key_states &= device.key_subset;
+    }
+}
+
+std::string normalize_device_id(const std::string& path)
+{
+    std::string result = path;
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return std::tolower(c); });
+    return result;
+}
+
+static bool parse_hex_field(const std::string& lower_path, const char* field, uint16_t& value)
+{
+    size_t pos = lower_path.find(field);
+    if (pos == std::string::npos) return false;
+
+    pos += strlen(field);
+    if (pos + 4 > lower_path.size()) return false;
+
+    std::string hex = lower_path.substr(pos, 4);
+    char* end = nullptr;
+    unsigned long parsed = strtoul(hex.c_str(), &end, 16);
+    if (end != hex.c_str() + 4) return false;
+
+    value = static_cast<uint16_t>(parsed);
+    return true;
+}
+
+void parse_device_vid_pid(const std::string& path, uint16_t& vendor_id, uint16_t& product_id)
+{
+    std::string lower_path = normalize_device_id(path);
+    parse_hex_field(lower_path, "vid_", vendor_id);
+    parse_hex_field(lower_path, "pid_", product_id);
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <bitset>
+#include <unordered_map>
+#include <unordered_set>
+
+//Input that was injected (SendInput etc) doesn't come from a physical device.
+static const char* const injected_device_id = "injected";
+
+enum class input_device_type
+{
+    keyboard,
+    mouse,
+    hid,
+};
+
+const char* input_device_type_name(input_device_type type);
+
+struct input_device
+{
+    //Stable across restarts and reconnects to the same port.
+    //On windows this is the lower cased raw input device interface path.
+    std::string id;
+    input_device_type type = input_device_type::keyboard;
+    uint16_t vendor_id = 0;
+    uint16_t product_id = 0;
+
+    //Filter results are cached on the device so the input thread doesn't do lookups per event.
+    bool allowed = true;
+    bool has_key_subset = false;
+    std::bitset<256> key_subset;
+
+    std::bitset<256> key_states;
+};
+
+class device_filter
+{
+public:
+    //If not empty only these devices are allowed through.
+    std::unordered_set<std::string> allow;
+    std::unordered_set<std::string> deny;
+    //Devices in here only let the listed keys through.
+    std::unordered_map<std::string, std::bitset<256>> key_subsets;
+
+    void apply(input_device& device) const;
+
+    bool accepts_key(const input_device& device, uint32_t vkcode) const
+    {
+        if (!device.allowed) return false;
+        if (vkcode > 255) return false;
+        if (device.has_key_subset && !device.key_subset[vkcode]) return false;
+        return true;
+    }
+};
+
+std::string normalize_device_id(const std::string& path);
+//Pulls VID_xxxx and PID_xxxx out of a device path, leaves them untouched if they aren't there.
+void parse_device_vid_pid(const std::string& path, uint16_t& vendor_id, uint16_t& product_id);
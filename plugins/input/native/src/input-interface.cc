@@ -1,8 +1,11 @@
 #include "input-interface.hh"
+#include "input-clock.hh"
+#include "castmate-native/trace.hh"
 
 #include <windows.h>
 
 #include <string>
+#include <vector>
 #include <sstream>
 #include <iomanip>
 #include <iostream>
@@ -16,7 +19,25 @@ Napi::Object input_interface::init(Napi::Env env, Napi::Object exports)
         InstanceMethod("simulateMouseUp", &input_interface::simulate_mouse_up),
         InstanceMethod("startEvents", &input_interface::start_events),
         InstanceMethod("stopEvents", &input_interface::stop_events),
+        InstanceMethod("startMouseEvents", &input_interface::start_mouse_events),
+        InstanceMethod("stopMouseEvents", &input_interface::stop_mouse_events),
         InstanceMethod("isKeyDown", &input_interface::is_key_down),
+        InstanceMethod("startControllerEvents", &input_interface::start_controller_events),
+        InstanceMethod("stopControllerEvents", &input_interface::stop_controller_events),
+        InstanceMethod("startRecording", &input_interface::start_recording),
+        InstanceMethod("stopRecording", &input_interface::stop_recording),
+        InstanceMethod("replay", &input_interface::replay),
+        InstanceMethod("stopReplay", &input_interface::stop_replay),
+        InstanceMethod("typeText", &input_interface::type_text),
+        InstanceMethod("stopTyping", &input_interface::stop_typing),
+        InstanceMethod("getInputDevices", &input_interface::get_input_devices),
+        InstanceMethod("setDeviceFilter", &input_interface::set_device_filter),
+#ifdef CASTMATE_INPUT_BENCHMARK
+        InstanceMethod("startSyntheticEvents", &input_interface::start_synthetic_events),
+        InstanceMethod("stopSyntheticEvents", &input_interface::stop_synthetic_events),
+        InstanceMethod("benchmarkNow", &input_interface::benchmark_now),
+        InstanceMethod("benchmarkStats", &input_interface::benchmark_stats),
+#endif
     });
 
     exports.Set("NativeInputInterface", constructor);
@@ -25,27 +46,35 @@ Napi::Object input_interface::init(Napi::Env env, Napi::Object exports)
 
 void input_interface::Finalize(Napi::Env env)
 {
-    tsfn.Release();
-}
+#ifdef CASTMATE_INPUT_BENCHMARK
+    synthetic_running = false;
+    if (synthetic_thread.joinable()) {
+        synthetic_thread.join();
+    }
+#endif
 
-static void finalizer(Napi::Env env, void* data, input_interface* context)
-{
+    recorder.stop();
+
+    for (auto& entry : replays) {
+        entry.second->cancel();
+    }
+    replays.clear();
 
+    for (auto& entry : typers) {
+        entry.second->cancel();
+    }
+    typers.clear();
+
+    events.close();
 }
 
 input_interface::input_interface(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<input_interface>(info)
     , emit(info[0].As<Napi::Function>())
-    , tsfn(Napi::ThreadSafeFunction::New(info.Env(),
-        emit,
-        "InputInterfaceEmitTSFN",
-        0,
-        1,
-        this,
-        finalizer,
-        (void*)nullptr
-    ))
 {
+    //Typing, mouse motion and controllers can burst well past what JS drains per tick, batch them through one call.
+    events.open(info.Env(), emit, "InputInterfaceEmitTSFN", input_event_capacity);
+
     memset(key_states, 0, sizeof(key_states));
 }
 
@@ -142,63 +171,398 @@ Napi::Value input_interface::simulate_mouse_up(const Napi::CallbackInfo& info)
 
 ///EVENTS
 
-void input_interface::handle_key_event(uint32_t vkcode, bool pressed)
+//Bounded so a stalled event loop drops input instead of queueing it forever.
+static const size_t input_event_capacity = 8192;
+
+void input_interface::release_controller_batch(controller_batch* batch)
+{
+    event_arena::release(const_cast<char*>(batch->device_id));
+    event_arena::release(batch->changes);
+    event_arena::release(batch->axis_names);
+    event_arena::destroy(batch);
+}
+
+void input_interface::emit_key_event(const char* event_name, uint32_t vkcode, const std::string& device_id, uint64_t capture_us)
+{
+#ifdef CASTMATE_INPUT_BENCHMARK
+    const uint64_t enqueue_us = input_now_us();
+#endif
+
+    auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+#ifdef CASTMATE_INPUT_BENCHMARK
+        //The benchmark build tacks each stage's timestamp onto the event.
+        const uint64_t dispatch_us = input_now_us();
+        js_callback.Call({
+            Napi::String::New(env, event_name),
+            Napi::Number::New(env, vkcode),
+            Napi::String::New(env, device_id),
+            Napi::Number::New(env, double(capture_us)),
+            Napi::Number::New(env, double(enqueue_us)),
+            Napi::Number::New(env, double(dispatch_us))
+        });
+#else
+        js_callback.Call({Napi::String::New(env, event_name), Napi::Number::New(env, vkcode), Napi::String::New(env, device_id) });
+#endif
+    };
+
+    events.post(js_thread_callback);
+}
+
+void input_interface::update_global_key_state(uint32_t vkcode)
+{
+    bool held = false;
+    for (auto& entry : devices) {
+        if (entry.second.key_states[vkcode]) {
+            held = true;
+            break;
+        }
+    }
+    key_states[vkcode] = held;
+}
+
+void input_interface::handle_key_event(HANDLE device_handle, uint32_t vkcode, bool pressed, uint64_t capture_us)
 {
     //std::cout << "Key event " << vkcode << " " << pressed << std::endl;
-    const bool was_pressed = key_states[vkcode];
+    input_device* device = get_device(device_handle);
+
+    //Filtered here so events from ignored devices never get queued for JS.
+    if (!filter.accepts_key(*device, vkcode)) return;
+
+    const bool was_pressed = device->key_states[vkcode];
+    if (pressed == was_pressed) return;
+
+    device->key_states[vkcode] = pressed;
+
+    recorder.record(pressed ? input_record_type::key_down : input_record_type::key_up, vkcode);
+
     if (pressed) {
         key_states[vkcode] = true;
-        if (!was_pressed) {
+        emit_key_event("key-pressed", vkcode, device->id, capture_us);
+    }
+    else {
+        //Only released globally once no other device is holding it.
+        update_global_key_state(vkcode);
+        emit_key_event("key-released", vkcode, device->id, capture_us);
+    }
+}
+
+static bool get_raw_device_info(HANDLE device_handle, input_device& device)
+{
+    UINT name_size = 0;
+    if (GetRawInputDeviceInfoA(device_handle, RIDI_DEVICENAME, nullptr, &name_size) != 0 || name_size == 0) {
+        return false;
+    }
+
+    std::string name(name_size, '\0');
+    if (GetRawInputDeviceInfoA(device_handle, RIDI_DEVICENAME, &name[0], &name_size) == (UINT)-1) {
+        return false;
+    }
+    name.resize(strlen(name.c_str()));
+
+    RID_DEVICE_INFO info = {0};
+    info.cbSize = sizeof(RID_DEVICE_INFO);
+    UINT info_size = sizeof(RID_DEVICE_INFO);
+    if (GetRawInputDeviceInfoA(device_handle, RIDI_DEVICEINFO, &info, &info_size) == (UINT)-1) {
+        return false;
+    }
+
+    device.id = normalize_device_id(name);
 
+    if (info.dwType == RIM_TYPEKEYBOARD) {
+        device.type = input_device_type::keyboard;
+        parse_device_vid_pid(name, device.vendor_id, device.product_id);
+    } else if (info.dwType == RIM_TYPEMOUSE) {
+        device.type = input_device_type::mouse;
+        parse_device_vid_pid(name, device.vendor_id, device.product_id);
+    } else {
+        device.type = input_device_type::hid;
+        device.vendor_id = static_cast<uint16_t>(info.hid.dwVendorId);
+        device.product_id = static_cast<uint16_t>(info.hid.dwProductId);
+    }
+
+    return true;
+}
+
+input_device* input_interface::get_device(HANDLE device_handle)
+{
+    auto existing = devices.find(device_handle);
+    if (existing != devices.end()) return &existing->second;
+
+    input_device device;
+    if (device_handle == NULL || !get_raw_device_info(device_handle, device)) {
+        device.id = injected_device_id;
+    }
+    filter.apply(device);
+
+    return &devices.emplace(device_handle, std::move(device)).first->second;
+}
+
+void input_interface::handle_device_change(HANDLE device_handle, bool added)
+{
+    if (added) {
+        input_device* device = get_device(device_handle);
+        std::string device_id = device->id;
+        std::string type = input_device_type_name(device->type);
+
+        auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            js_callback.Call({Napi::String::New(env, "input-device-added"), Napi::String::New(env, device_id), Napi::String::New(env, type) });
+        };
+        events.post(js_thread_callback);
+        return;
+    }
+
+    auto existing = devices.find(device_handle);
+    if (existing == devices.end()) return;
+
+    std::string device_id = existing->second.id;
+    std::bitset<256> held = existing->second.key_states;
+    devices.erase(existing);
+    controllers.erase(device_handle);
+
+    //Release anything the unplugged device was holding.
+    for (uint32_t vkcode = 0; vkcode < 256; ++vkcode) {
+        if (!held[vkcode]) continue;
+
+        update_global_key_state(vkcode);
+        emit_key_event("key-released", vkcode, device_id, input_now_us());
+    }
+
+    auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({Napi::String::New(env, "input-device-removed"), Napi::String::New(env, device_id) });
+    };
+    events.post(js_thread_callback);
+}
+
+//RI_MOUSE_* down and up flags, indexed by input_mouse_button
+static const USHORT raw_mouse_button_flags[input_mouse_button_count][2] = {
+    { RI_MOUSE_LEFT_BUTTON_DOWN, RI_MOUSE_LEFT_BUTTON_UP },
+    { RI_MOUSE_RIGHT_BUTTON_DOWN, RI_MOUSE_RIGHT_BUTTON_UP },
+    { RI_MOUSE_MIDDLE_BUTTON_DOWN, RI_MOUSE_MIDDLE_BUTTON_UP },
+    { RI_MOUSE_BUTTON_4_DOWN, RI_MOUSE_BUTTON_4_UP },
+    { RI_MOUSE_BUTTON_5_DOWN, RI_MOUSE_BUTTON_5_UP },
+};
+
+void input_interface::handle_mouse_event(HANDLE device_handle, const RAWMOUSE& raw_mouse)
+{
+    if (!get_device(device_handle)->allowed) return;
+
+    const uint64_t now = input_now_us();
+    bool needs_flush = false;
+
+    //Absolute reports come from tablets and remote desktop sessions, they don't carry relative deltas.
+    if (!(raw_mouse.usFlags & MOUSE_MOVE_ABSOLUTE) && (raw_mouse.lLastX != 0 || raw_mouse.lLastY != 0))
+    {
+        recorder.record(input_record_type::mouse_move, raw_mouse.lLastX, raw_mouse.lLastY);
+        if (mouse_events_enabled) needs_flush |= mouse.add_motion(raw_mouse.lLastX, raw_mouse.lLastY, now);
+
+        mouse_flick flick;
+        if (mouse_events_enabled && mouse.check_flick(now, flick))
+        {
             auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
             {
                 //env might be null if the tsfn is aborted
                 if (env == nullptr || js_callback == nullptr) return;
 
-                //std::cout << "Emitting key-pressed " << vkcode << std::endl;
+                js_callback.Call({
+                    Napi::String::New(env, "mouse-flick"),
+                    Napi::Number::New(env, flick.velocity),
+                    Napi::Number::New(env, flick.dx),
+                    Napi::Number::New(env, flick.dy)
+                });
+            };
+            events.post(js_thread_callback);
+        }
+    }
+
+    //A single report can carry several transitions, downs are recorded before ups.
+    for (uint32_t button = 0; button < input_mouse_button_count; ++button)
+    {
+        if (raw_mouse.usButtonFlags & raw_mouse_button_flags[button][0])
+        {
+            recorder.record(input_record_type::mouse_down, button);
+        }
+    }
+    for (uint32_t button = 0; button < input_mouse_button_count; ++button)
+    {
+        if (raw_mouse.usButtonFlags & raw_mouse_button_flags[button][1])
+        {
+            recorder.record(input_record_type::mouse_up, button);
+        }
+    }
+
+    //usButtonData is a signed wheel delta stored in an unsigned field.
+    if (raw_mouse.usButtonFlags & RI_MOUSE_WHEEL)
+    {
+        recorder.record(input_record_type::mouse_wheel, static_cast<SHORT>(raw_mouse.usButtonData), 0);
+        if (mouse_events_enabled) needs_flush |= mouse.add_wheel(static_cast<SHORT>(raw_mouse.usButtonData), 0);
+    }
+    if (raw_mouse.usButtonFlags & RI_MOUSE_HWHEEL)
+    {
+        recorder.record(input_record_type::mouse_wheel, 0, static_cast<SHORT>(raw_mouse.usButtonData));
+        if (mouse_events_enabled) needs_flush |= mouse.add_wheel(0, static_cast<SHORT>(raw_mouse.usButtonData));
+    }
+
+    if (needs_flush)
+    {
+        flush_mouse();
+    }
+}
 
-                js_callback.Call({Napi::String::New(env, "key-pressed"), Napi::Number::New(env, vkcode) });
+void input_interface::flush_mouse()
+{
+    mouse_motion motion;
+    if (mouse.take_motion(motion))
+    {
+        auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
 
-            };
+            js_callback.Call({ Napi::String::New(env, "mouse-moved"), Napi::Number::New(env, motion.dx), Napi::Number::New(env, motion.dy) });
+        };
+        events.post(js_thread_callback);
+    }
+
+    mouse_wheel wheel;
+    if (mouse.take_wheel(wheel))
+    {
+        auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            js_callback.Call({ Napi::String::New(env, "mouse-wheel"), Napi::Number::New(env, wheel.vertical), Napi::Number::New(env, wheel.horizontal) });
+        };
+        events.post(js_thread_callback);
+    }
+}
+
+void input_interface::handle_controller_event(HANDLE device_handle, const RAWHID& hid)
+{
+    if (!get_device(device_handle)->allowed) return;
 
-             //std::cout << "Queuing key-pressed " << vkcode << std::endl;
-            tsfn.NonBlockingCall(js_thread_callback);
+    auto existing = controllers.find(device_handle);
+    if (existing == controllers.end()) {
+        std::unique_ptr<hid_controller> controller = std::make_unique<hid_controller>();
+        if (!controller->init(device_handle)) {
+            controller.reset();
         }
+        existing = controllers.emplace(device_handle, std::move(controller)).first;
     }
-    else {
-        key_states[vkcode] = false;
-        if (was_pressed) {
-            auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
-            {
-                //env might be null if the tsfn is aborted
-                if (env == nullptr || js_callback == nullptr) return;
 
-                //std::cout << "Emitting key-released " << vkcode << std::endl;
+    hid_controller* controller = existing->second.get();
+    if (!controller) return;
 
-                js_callback.Call({Napi::String::New(env, "key-released"), Napi::Number::New(env, vkcode) });
+    controller_changes.clear();
+    controller->handle_input(hid, controller_config, controller_changes);
+    if (controller_changes.empty()) return;
 
-            };
+    //Everything that changed in this message goes to JS in a single call. Controllers report at up to 1000hz
+    //so the payload comes out of the dispatcher's arena instead of the heap.
+    event_arena& arena = events.arena();
+    controller_batch* batch = arena.create<controller_batch>();
+    const std::string& device_id = get_device(device_handle)->id;
+    char* device_id_copy = static_cast<char*>(arena.allocate(device_id.size() + 1, 1));
+    memcpy(device_id_copy, device_id.c_str(), device_id.size() + 1);
+    batch->device_id = device_id_copy;
+    batch->count = controller_changes.size();
+    batch->changes = static_cast<controller_change*>(arena.allocate(sizeof(controller_change) * batch->count, alignof(controller_change)));
+    batch->axis_names = static_cast<const char**>(arena.allocate(sizeof(const char*) * batch->count, alignof(const char*)));
+    for (size_t i = 0; i < batch->count; ++i) {
+        const controller_change& change = controller_changes[i];
+        batch->changes[i] = change;
+        batch->axis_names[i] = change.type == controller_change::kind::axis ? controller->axis_name(change.index) : nullptr;
+    }
 
-            //std::cout << "Queuing key-released " << vkcode << std::endl;
-            tsfn.NonBlockingCall(js_thread_callback);
+    auto js_thread_callback = [batch](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted, the arena goes away with the dispatcher then
+        if (env == nullptr || js_callback == nullptr) return;
+
+        Napi::String js_device_id = Napi::String::New(env, batch->device_id);
+
+        for (size_t i = 0; i < batch->count; ++i) {
+            const controller_change& change = batch->changes[i];
+            switch (change.type) {
+            case controller_change::kind::button_pressed:
+                js_callback.Call({ Napi::String::New(env, "controller-button-pressed"), js_device_id, Napi::Number::New(env, change.index + 1) });
+                break;
+            case controller_change::kind::button_released:
+                js_callback.Call({ Napi::String::New(env, "controller-button-released"), js_device_id, Napi::Number::New(env, change.index + 1) });
+                break;
+            case controller_change::kind::axis:
+                js_callback.Call({ Napi::String::New(env, "controller-axis-changed"), js_device_id, Napi::String::New(env, batch->axis_names[i]), Napi::Number::New(env, change.value) });
+                break;
+            case controller_change::kind::hat:
+                js_callback.Call({ Napi::String::New(env, "controller-hat-changed"), js_device_id, Napi::Number::New(env, change.index), Napi::Number::New(env, change.value) });
+                break;
+            }
         }
+
+        release_controller_batch(batch);
+    };
+
+    if (!events.post(js_thread_callback)) {
+        release_controller_batch(batch);
     }
 }
 
+static const UINT_PTR mouse_flush_timer_id = 1;
+
 static LRESULT CALLBACK event_proc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     input_interface* input = reinterpret_cast<input_interface*>(GetWindowLongPtr(hwnd, GWLP_USERDATA));
     if (uMsg == WM_INPUT) {
-        RAWINPUT input_buffer;
-		unsigned int buffsize = sizeof(RAWINPUT);
-		GetRawInputData(reinterpret_cast<HRAWINPUT> (lParam), RID_INPUT, &input_buffer, &buffsize,sizeof(RAWINPUTHEADER));
+        TRACE_SCOPE("raw input");
+
+        //HID reports don't fit in a RAWINPUT, so size the buffer from the message.
+        static std::vector<uint8_t> input_data;
+		unsigned int buffsize = 0;
+		GetRawInputData(reinterpret_cast<HRAWINPUT> (lParam), RID_INPUT, NULL, &buffsize, sizeof(RAWINPUTHEADER));
+        if (input_data.size() < buffsize) {
+            input_data.resize(buffsize);
+        }
+		if (GetRawInputData(reinterpret_cast<HRAWINPUT> (lParam), RID_INPUT, input_data.data(), &buffsize, sizeof(RAWINPUTHEADER)) == (UINT)-1) {
+            return DefWindowProc(hwnd, uMsg, wParam, lParam);
+        }
+        const RAWINPUT& input_buffer = *reinterpret_cast<RAWINPUT*>(input_data.data());
 
         if (input_buffer.header.dwType == RIM_TYPEKEYBOARD)
         {
             //Keyboard input!
             //std::cout << "Key: " << std::hex << input_buffer.data.keyboard.VKey << ": " << input_buffer.data.keyboard.Flags << std::endl;
-            input->handle_key_event(input_buffer.data.keyboard.VKey, !(input_buffer.data.keyboard.Flags & RI_KEY_BREAK));
+            input->handle_key_event(input_buffer.header.hDevice, input_buffer.data.keyboard.VKey, !(input_buffer.data.keyboard.Flags & RI_KEY_BREAK), input_now_us());
+        }
+        else if (input_buffer.header.dwType == RIM_TYPEMOUSE)
+        {
+            input->handle_mouse_event(input_buffer.header.hDevice, input_buffer.data.mouse);
         }
+        else if (input_buffer.header.dwType == RIM_TYPEHID)
+        {
+            input->handle_controller_event(input_buffer.header.hDevice, input_buffer.data.hid);
+        }
+    }
+    else if (uMsg == WM_INPUT_DEVICE_CHANGE && input)
+    {
+        input->handle_device_change(reinterpret_cast<HANDLE>(lParam), wParam == GIDC_ARRIVAL);
+        return 0;
+    }
+    else if (uMsg == WM_TIMER && wParam == mouse_flush_timer_id && input)
+    {
+        input->flush_mouse();
+        return 0;
     }
     return DefWindowProc(hwnd, uMsg, wParam, lParam);
 }
@@ -241,17 +605,119 @@ Napi::Value input_interface::start_events(const Napi::CallbackInfo& info)
         std::cout << "Failed to register raw input devices" << std::endl;
     }
 
+    //Mouse, controller and recording requests made before the window existed start now.
+    update_mouse_registration();
+    update_controller_registration();
+
     return info.Env().Undefined();
 }
 
 Napi::Value input_interface::stop_events(const Napi::CallbackInfo& info)
 {
+    stop_mouse_events(info);
+    stop_controller_events(info);
+
     CloseWindow(input_window);
     input_window = NULL;
+    update_mouse_registration();
 
     return info.Env().Undefined();
 }
 
+static mouse_config get_mouse_config(Napi::Object config_obj)
+{
+    mouse_config config;
+
+    if (config_obj.Has("flushInterval")) {
+        config.flush_interval_ms = config_obj.Get("flushInterval").As<Napi::Number>().Uint32Value();
+    }
+    if (config_obj.Has("moveThreshold")) {
+        config.move_threshold = config_obj.Get("moveThreshold").As<Napi::Number>().Int32Value();
+    }
+    if (config_obj.Has("wheelThreshold")) {
+        config.wheel_threshold = config_obj.Get("wheelThreshold").As<Napi::Number>().Int32Value();
+    }
+    if (config_obj.Has("flickVelocity")) {
+        config.flick_velocity = config_obj.Get("flickVelocity").As<Napi::Number>().DoubleValue();
+    }
+    if (config_obj.Has("flickWindow")) {
+        config.flick_window_ms = config_obj.Get("flickWindow").As<Napi::Number>().Uint32Value();
+    }
+    if (config_obj.Has("flickCooldown")) {
+        config.flick_cooldown_ms = config_obj.Get("flickCooldown").As<Napi::Number>().Uint32Value();
+    }
+
+    return config;
+}
+
+Napi::Value input_interface::start_mouse_events(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    mouse_config config;
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        config = get_mouse_config(info[0].As<Napi::Object>());
+    }
+
+    //Restarting just reconfigures, drop whatever was accumulated under the old config.
+    mouse.configure(config);
+    mouse_flush_interval_ms = config.flush_interval_ms;
+
+    //Before startEvents this only keeps the config, start_events registers the mouse.
+    mouse_events_enabled = true;
+    update_mouse_registration();
+    update_mouse_timer();
+
+    return env.Undefined();
+}
+
+Napi::Value input_interface::stop_mouse_events(const Napi::CallbackInfo& info)
+{
+    if (!mouse_events_enabled) return info.Env().Undefined();
+
+    mouse_events_enabled = false;
+    mouse.reset();
+    update_mouse_timer();
+
+    //Stays registered while a recording still wants the mouse.
+    update_mouse_registration();
+
+    return info.Env().Undefined();
+}
+
+void input_interface::update_mouse_registration()
+{
+    const bool wanted = input_window && (mouse_events_enabled || recorder.is_recording());
+    if (wanted == mouse_registered) return;
+
+    RAWINPUTDEVICE raw_devices[1];
+
+    //Mouse
+    raw_devices[0].usUsagePage = 0x01; //Page
+    raw_devices[0].usUsage = 0x02; //Mouse
+    raw_devices[0].dwFlags = wanted ? RIDEV_INPUTSINK : RIDEV_REMOVE;
+    raw_devices[0].hwndTarget = wanted ? input_window : NULL;
+
+    if (!RegisterRawInputDevices(raw_devices, 1, sizeof(RAWINPUTDEVICE))) {
+        std::cout << (wanted ? "Failed to register raw mouse device" : "Failed to unregister raw mouse device") << std::endl;
+        if (wanted) return;
+    }
+
+    mouse_registered = wanted;
+    update_mouse_timer();
+}
+
+void input_interface::update_mouse_timer()
+{
+    if (!input_window) return;
+
+    KillTimer(input_window, mouse_flush_timer_id);
+    if (mouse_events_enabled && mouse_registered && mouse_flush_interval_ms > 0)
+    {
+        SetTimer(input_window, mouse_flush_timer_id, mouse_flush_interval_ms, NULL);
+    }
+}
 
 Napi::Value input_interface::is_key_down(const Napi::CallbackInfo& info)
 {
@@ -259,6 +725,394 @@ Napi::Value input_interface::is_key_down(const Napi::CallbackInfo& info)
 
     if (vkcode > 255) return Napi::Boolean::New(info.Env(), false);
 
+    if (info.Length() > 1 && info[1].IsString()) {
+        std::string device_id = info[1].As<Napi::String>().Utf8Value();
+        for (auto& entry : devices) {
+            if (entry.second.id == device_id) {
+                return Napi::Boolean::New(info.Env(), (bool)entry.second.key_states[vkcode]);
+            }
+        }
+        return Napi::Boolean::New(info.Env(), false);
+    }
+
     return Napi::Boolean::New(info.Env(), key_states[vkcode]);
 }
 
+///CONTROLLERS
+
+Napi::Value input_interface::start_controller_events(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    axis_filter_config config;
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        Napi::Object config_obj = info[0].As<Napi::Object>();
+        if (config_obj.Has("deadzone")) {
+            config.deadzone = config_obj.Get("deadzone").As<Napi::Number>().DoubleValue();
+        }
+        if (config_obj.Has("hysteresis")) {
+            config.hysteresis = config_obj.Get("hysteresis").As<Napi::Number>().DoubleValue();
+        }
+        if (config_obj.Has("steps")) {
+            config.steps = config_obj.Get("steps").As<Napi::Number>().Uint32Value();
+        }
+    }
+    controller_config = config;
+
+    //New filter settings start from a clean slate so every axis reports its filtered position once.
+    controllers.clear();
+
+    //Before startEvents this only keeps the config, start_events registers the controllers.
+    controller_events_enabled = true;
+    update_controller_registration();
+
+    return env.Undefined();
+}
+
+Napi::Value input_interface::stop_controller_events(const Napi::CallbackInfo& info)
+{
+    controller_events_enabled = false;
+    update_controller_registration();
+    controllers.clear();
+
+    return info.Env().Undefined();
+}
+
+void input_interface::update_controller_registration()
+{
+    const bool wanted = input_window && controller_events_enabled;
+    if (wanted == controllers_registered) return;
+
+    RAWINPUTDEVICE raw_devices[2];
+
+    //Joystick
+    raw_devices[0].usUsagePage = 0x01; //Page
+    raw_devices[0].usUsage = 0x04; //Joystick
+    raw_devices[0].dwFlags = wanted ? RIDEV_INPUTSINK | RIDEV_DEVNOTIFY : RIDEV_REMOVE;
+    raw_devices[0].hwndTarget = wanted ? input_window : NULL;
+
+    //Gamepad
+    raw_devices[1].usUsagePage = 0x01; //Page
+    raw_devices[1].usUsage = 0x05; //Gamepad
+    raw_devices[1].dwFlags = wanted ? RIDEV_INPUTSINK | RIDEV_DEVNOTIFY : RIDEV_REMOVE;
+    raw_devices[1].hwndTarget = wanted ? input_window : NULL;
+
+    if (!RegisterRawInputDevices(raw_devices, 2, sizeof(RAWINPUTDEVICE))) {
+        std::cout << (wanted ? "Failed to register raw controller devices" : "Failed to unregister raw controller devices") << std::endl;
+        if (wanted) return;
+    }
+
+    controllers_registered = wanted;
+}
+
+///RECORDING
+
+Napi::Value input_interface::start_recording(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "startRecording requires a path.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    if (!recorder.start(path))
+    {
+        Napi::Error::New(env, "Unable to open " + path + " for recording.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    //Mouse input is recorded even when no mouse trigger is listening.
+    update_mouse_registration();
+
+    return env.Undefined();
+}
+
+Napi::Value input_interface::stop_recording(const Napi::CallbackInfo& info)
+{
+    recorder.stop();
+    update_mouse_registration();
+    return info.Env().Undefined();
+}
+
+void input_interface::reap_replays()
+{
+    for (auto it = replays.begin(); it != replays.end();) {
+        if (it->second->is_finished()) {
+            it = replays.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+Napi::Value input_interface::replay(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsString() || !info[2].IsFunction())
+    {
+        Napi::Error::New(env, "replay requires a path, a speed, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    reap_replays();
+
+    std::string path = info[0].As<Napi::String>().Utf8Value();
+    double speed = info[1].IsNumber() ? info[1].As<Napi::Number>().DoubleValue() : 1.0;
+    if (!(speed > 0))
+    {
+        Napi::Error::New(env, "replay speed must be greater than 0.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto replay = std::make_unique<input_replay>(speed);
+
+    std::string error;
+    if (!replay->open(path, error))
+    {
+        Napi::Error::New(env, error + ": " + path).ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    replay->start(Napi::ThreadSafeFunction::New(env, info[2].As<Napi::Function>(), "InputReplayDoneTSFN", 0, 1));
+
+    uint32_t id = next_replay_id++;
+    replays[id] = std::move(replay);
+
+    return Napi::Number::New(env, id);
+}
+
+Napi::Value input_interface::stop_replay(const Napi::CallbackInfo& info)
+{
+    uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+
+    auto replay = replays.find(id);
+    if (replay != replays.end()) {
+        //The done callback still fires once the replay thread lets go of its held keys.
+        replay->second->cancel();
+    }
+
+    return info.Env().Undefined();
+}
+
+void input_interface::reap_typers()
+{
+    for (auto it = typers.begin(); it != typers.end();) {
+        if (it->second->is_finished()) {
+            it = typers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+Napi::Value input_interface::type_text(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsString() || !info[2].IsFunction())
+    {
+        Napi::Error::New(env, "typeText requires text, a rate, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    reap_typers();
+
+    //0 types the whole string at once
+    double cps = info[1].IsNumber() ? info[1].As<Napi::Number>().DoubleValue() : 0.0;
+    if (!(cps >= 0))
+    {
+        Napi::Error::New(env, "typeText rate can't be negative.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto typer = std::make_unique<input_typer>(info[0].As<Napi::String>().Utf16Value(), cps);
+    typer->start(Napi::ThreadSafeFunction::New(env, info[2].As<Napi::Function>(), "InputTyperDoneTSFN", 0, 1));
+
+    uint32_t id = next_typer_id++;
+    typers[id] = std::move(typer);
+
+    return Napi::Number::New(env, id);
+}
+
+Napi::Value input_interface::stop_typing(const Napi::CallbackInfo& info)
+{
+    uint32_t id = info[0].As<Napi::Number>().Uint32Value();
+
+    auto typer = typers.find(id);
+    if (typer != typers.end()) {
+        //Nothing more is typed once this returns, the done callback still reports how far it got.
+        typer->second->cancel();
+    }
+
+    return info.Env().Undefined();
+}
+
+#ifdef CASTMATE_INPUT_BENCHMARK
+///SYNTHETIC EVENTS
+//In memory backend for the latency benchmark, stands in for the raw input window so it runs under plain node.
+
+Napi::Value input_interface::start_synthetic_events(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    const double rate = info[0].As<Napi::Number>().DoubleValue();
+    const uint32_t count = info[1].As<Napi::Number>().Uint32Value();
+    if (!(rate > 0))
+    {
+        Napi::Error::New(env, "startSyntheticEvents rate must be greater than 0.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    stop_synthetic_events(info);
+
+    synthetic_running = true;
+    synthetic_thread = std::thread([this, rate, count]()
+    {
+        const auto start = std::chrono::steady_clock::now();
+        const double interval_us = 1000000.0 / rate;
+
+        for (uint32_t i = 0; i < count && synthetic_running; ++i) {
+            //Scheduled against the start time so the offered load doesn't sag when a sleep overshoots.
+            std::this_thread::sleep_until(start + std::chrono::microseconds(uint64_t(i * interval_us)));
+
+            //Alternate press and release across A-Z so every event is an edge that reaches JS.
+            const uint32_t vkcode = 0x41 + (i / 2) % 26;
+            handle_key_event(NULL, vkcode, (i % 2) == 0, input_now_us());
+        }
+        synthetic_running = false;
+    });
+
+    return env.Undefined();
+}
+
+Napi::Value input_interface::stop_synthetic_events(const Napi::CallbackInfo& info)
+{
+    synthetic_running = false;
+    if (synthetic_thread.joinable()) {
+        synthetic_thread.join();
+    }
+    return info.Env().Undefined();
+}
+
+Napi::Value input_interface::benchmark_now(const Napi::CallbackInfo& info)
+{
+    return Napi::Number::New(info.Env(), double(input_now_us()));
+}
+
+Napi::Value input_interface::benchmark_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("dropped", Napi::Number::New(env, double(events.dropped())));
+    result.Set("batches", Napi::Number::New(env, double(events.batches())));
+    result.Set("largestBatch", Napi::Number::New(env, double(events.largest_batch())));
+    return result;
+}
+#endif
+
+Napi::Value input_interface::get_input_devices(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    UINT device_count = 0;
+    if (GetRawInputDeviceList(nullptr, &device_count, sizeof(RAWINPUTDEVICELIST)) != 0) {
+        Napi::Error::New(env, "Unable to get raw input device count").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::vector<RAWINPUTDEVICELIST> device_list(device_count);
+    if (device_count > 0) {
+        device_count = GetRawInputDeviceList(device_list.data(), &device_count, sizeof(RAWINPUTDEVICELIST));
+        if (device_count == (UINT)-1) {
+            Napi::Error::New(env, "Unable to get raw input device list").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+    }
+
+    Napi::Array result = Napi::Array::New(env);
+    int result_count = 0;
+    for (UINT i = 0; i < device_count; ++i) {
+        input_device device;
+        if (!get_raw_device_info(device_list[i].hDevice, device)) continue;
+
+        Napi::Object device_obj = Napi::Object::New(env);
+        device_obj.Set("id", Napi::String::New(env, device.id));
+        device_obj.Set("type", Napi::String::New(env, input_device_type_name(device.type)));
+        device_obj.Set("vendorId", Napi::Number::New(env, device.vendor_id));
+        device_obj.Set("productId", Napi::Number::New(env, device.product_id));
+
+        result[result_count++] = device_obj;
+    }
+
+    return result;
+}
+
+static void read_device_id_set(Napi::Object config_obj, const char* key, std::unordered_set<std::string>& result)
+{
+    if (!config_obj.Has(key)) return;
+
+    Napi::Array ids = config_obj.Get(key).As<Napi::Array>();
+    for (uint32_t i = 0; i < ids.Length(); ++i) {
+        result.insert(normalize_device_id(ids.Get(i).As<Napi::String>().Utf8Value()));
+    }
+}
+
+Napi::Value input_interface::set_device_filter(const Napi::CallbackInfo& info)
+{
+    device_filter new_filter;
+
+    if (info.Length() > 0 && info[0].IsObject()) {
+        Napi::Object config_obj = info[0].As<Napi::Object>();
+
+        read_device_id_set(config_obj, "allow", new_filter.allow);
+        read_device_id_set(config_obj, "deny", new_filter.deny);
+
+        if (config_obj.Has("keys")) {
+            Napi::Object keys_obj = config_obj.Get("keys").As<Napi::Object>();
+            Napi::Array device_ids = keys_obj.GetPropertyNames();
+            for (uint32_t i = 0; i < device_ids.Length(); ++i) {
+                Napi::Value device_id = device_ids.Get(i);
+                Napi::Array keys = keys_obj.Get(device_id).As<Napi::Array>();
+
+                std::bitset<256> subset;
+                for (uint32_t k = 0; k < keys.Length(); ++k) {
+                    uint32_t vkcode = keys.Get(k).As<Napi::Number>().Uint32Value();
+                    if (vkcode < 256) subset[vkcode] = true;
+                }
+                new_filter.key_subsets[normalize_device_id(device_id.As<Napi::String>().Utf8Value())] = subset;
+            }
+        }
+    }
+
+    filter = std::move(new_filter);
+
+    //Refresh the cached filter results, anything no longer allowed loses its held keys.
+    std::vector<std::pair<std::string, std::bitset<256>>> released;
+    for (auto& entry : devices) {
+        std::bitset<256> held = entry.second.key_states;
+        filter.apply(entry.second);
+
+        held &= ~entry.second.key_states;
+        if (held.any()) released.emplace_back(entry.second.id, held);
+    }
+
+    for (uint32_t vkcode = 0; vkcode < 256; ++vkcode) {
+        update_global_key_state(vkcode);
+    }
+
+    //Same as an unplug, JS has to see the release or key-held triggers stay stuck.
+    const uint64_t now = input_now_us();
+    for (const auto& device : released) {
+        for (uint32_t vkcode = 0; vkcode < 256; ++vkcode) {
+            if (device.second[vkcode]) emit_key_event("key-released", vkcode, device.first, now);
+        }
+    }
+
+    return info.Env().Undefined();
+}
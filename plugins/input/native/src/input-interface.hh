@@ -1,6 +1,22 @@
 #include <napi.h>
 #include <windows.h>
 
+#include <string>
+#include <unordered_map>
+#include <memory>
+#include <thread>
+#include <atomic>
+
+#include "mouse-tracker.hh"
+#include "input-devices.hh"
+#include "input-recording.hh"
+#include "input-replay.hh"
+#include "input-typer.hh"
+#include "controller-filter.hh"
+#include "hid-controller.hh"
+
+#include "castmate-native/event-dispatcher.hh"
+
 class input_interface : public Napi::ObjectWrap<input_interface>
 {
 public:
@@ -17,15 +33,93 @@ public:
     Napi::Value start_events(const Napi::CallbackInfo& info);
     Napi::Value stop_events(const Napi::CallbackInfo& info);
 
+    Napi::Value start_mouse_events(const Napi::CallbackInfo& info);
+    Napi::Value stop_mouse_events(const Napi::CallbackInfo& info);
+
     Napi::Value is_key_down(const Napi::CallbackInfo& info);
 
-    void handle_key_event(uint32_t vkcode, bool pressed);
+    Napi::Value start_controller_events(const Napi::CallbackInfo& info);
+    Napi::Value stop_controller_events(const Napi::CallbackInfo& info);
+
+    Napi::Value start_recording(const Napi::CallbackInfo& info);
+    Napi::Value stop_recording(const Napi::CallbackInfo& info);
+    Napi::Value replay(const Napi::CallbackInfo& info);
+    Napi::Value stop_replay(const Napi::CallbackInfo& info);
+
+    Napi::Value type_text(const Napi::CallbackInfo& info);
+    Napi::Value stop_typing(const Napi::CallbackInfo& info);
+
+#ifdef CASTMATE_INPUT_BENCHMARK
+    Napi::Value start_synthetic_events(const Napi::CallbackInfo& info);
+    Napi::Value stop_synthetic_events(const Napi::CallbackInfo& info);
+    Napi::Value benchmark_now(const Napi::CallbackInfo& info);
+    Napi::Value benchmark_stats(const Napi::CallbackInfo& info);
+#endif
+
+    Napi::Value get_input_devices(const Napi::CallbackInfo& info);
+    Napi::Value set_device_filter(const Napi::CallbackInfo& info);
+
+    void handle_key_event(HANDLE device_handle, uint32_t vkcode, bool pressed, uint64_t capture_us);
+    void handle_mouse_event(HANDLE device_handle, const RAWMOUSE& mouse);
+    void flush_mouse();
+    void update_mouse_registration();
+    void update_mouse_timer();
+    void handle_controller_event(HANDLE device_handle, const RAWHID& hid);
+
+    void handle_device_change(HANDLE device_handle, bool added);
 
     void Finalize(Napi::Env env) override;
 private:
     HWND input_window = 0;
     Napi::Function emit;
-    Napi::ThreadSafeFunction tsfn;
+    js_call_dispatcher events;
+
+    input_device* get_device(HANDLE device_handle);
+    void update_global_key_state(uint32_t vkcode);
+    void emit_key_event(const char* event_name, uint32_t vkcode, const std::string& device_id, uint64_t capture_us);
 
+    //Any allowed device has the key down.
     bool key_states[256];
+
+    //Keyed by the raw input handle, which is only valid while the device is connected.
+    std::unordered_map<HANDLE, input_device> devices;
+    device_filter filter;
+
+    input_recorder recorder;
+    uint32_t next_replay_id = 1;
+    std::unordered_map<uint32_t, std::unique_ptr<input_replay>> replays;
+    void reap_replays();
+
+    uint32_t next_typer_id = 1;
+    std::unordered_map<uint32_t, std::unique_ptr<input_typer>> typers;
+    void reap_typers();
+
+    //Controller events can be asked for before startEvents, they're registered once the window exists.
+    bool controller_events_enabled = false;
+    bool controllers_registered = false;
+    void update_controller_registration();
+    axis_filter_config controller_config;
+    //Null entries are devices that couldn't be parsed, kept so we don't retry on every report.
+    std::unordered_map<HANDLE, std::unique_ptr<hid_controller>> controllers;
+    std::vector<controller_change> controller_changes;
+
+    struct controller_batch
+    {
+        const char* device_id;
+        size_t count;
+        controller_change* changes;
+        const char** axis_names;
+    };
+    static void release_controller_batch(controller_batch* batch);
+
+#ifdef CASTMATE_INPUT_BENCHMARK
+    std::thread synthetic_thread;
+    std::atomic<bool> synthetic_running { false };
+#endif
+
+    //Raw mouse input is registered while JS wants mouse events or a recording is running.
+    bool mouse_registered = false;
+    bool mouse_events_enabled = false;
+    uint32_t mouse_flush_interval_ms = 0;
+    mouse_tracker mouse;
 };
@@ -0,0 +1,290 @@
+#include "input-recording.hh"
+#include "input-clock.hh"
+
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char input_recording_magic[4] = { 'C', 'M', 'I', 'R' };
+
+//Flush at least this often so a crash loses very little of a recording.
+static const auto writer_flush_interval = std::chrono::milliseconds(250);
+
+void write_varint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        buffer.push_back(uint8_t(value) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(uint8_t(value));
+}
+
+bool read_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7)
+    {
+        if (data >= end) return false;
+
+        uint8_t byte = *data++;
+        value |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+///////////////////////////////RECORDER///////////////////////////////
+
+input_recorder::~input_recorder()
+{
+    stop();
+}
+
+bool input_recorder::start(const std::string& path)
+{
+    stop();
+
+    file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    fwrite(input_recording_magic, 1, sizeof(input_recording_magic), file);
+    fwrite(&input_recording_version, 1, 1, file);
+
+    start_us = input_now_us();
+    last_us = start_us;
+    stopping = false;
+    pending.clear();
+
+    writer_thread = std::thread(&input_recorder::writer_thread_main, this);
+    recording = true;
+    return true;
+}
+
+void input_recorder::stop()
+{
+    if (!writer_thread.joinable()) return;
+
+    recording = false;
+    {
+        std::lock_guard<std::mutex> lock(buffer_mutex);
+        stopping = true;
+    }
+    buffer_cv.notify_one();
+    writer_thread.join();
+
+    fclose(file);
+    file = nullptr;
+}
+
+void input_recorder::record(input_record_type type, int32_t a, int32_t b)
+{
+    if (!recording) return;
+
+    const uint64_t now = input_now_us();
+
+    std::lock_guard<std::mutex> lock(buffer_mutex);
+
+    write_varint(pending, now - last_us);
+    last_us = now;
+
+    pending.push_back(uint8_t(type));
+
+    switch (type)
+    {
+    case input_record_type::key_down:
+    case input_record_type::key_up:
+    case input_record_type::mouse_down:
+    case input_record_type::mouse_up:
+        write_varint(pending, uint32_t(a));
+        break;
+    case input_record_type::mouse_move:
+    case input_record_type::mouse_wheel:
+        write_varint(pending, zigzag_encode(a));
+        write_varint(pending, zigzag_encode(b));
+        break;
+    }
+}
+
+void input_recorder::writer_thread_main()
+{
+    //Double buffered, the input thread keeps appending to pending while this thread writes.
+    std::vector<uint8_t> writing;
+
+    std::unique_lock<std::mutex> lock(buffer_mutex);
+    while (true)
+    {
+        buffer_cv.wait_for(lock, writer_flush_interval, [this] { return stopping; });
+
+        writing.clear();
+        std::swap(writing, pending);
+        const bool done = stopping;
+
+        lock.unlock();
+        if (!writing.empty())
+        {
+            fwrite(writing.data(), 1, writing.size(), file);
+            fflush(file);
+        }
+        lock.lock();
+
+        if (done) break;
+    }
+}
+
+///////////////////////////////FILE///////////////////////////////
+
+input_recording_file::~input_recording_file()
+{
+    close();
+}
+
+bool input_recording_file::open(const std::string& path, std::string& error)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        error = "Unable to open recording";
+        return false;
+    }
+    file_handle = file;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        error = "Recording is empty";
+        close();
+        return false;
+    }
+    size = size_t(file_size.QuadPart);
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping)
+    {
+        error = "Unable to map recording";
+        close();
+        return false;
+    }
+    mapping_handle = mapping;
+
+    data = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        error = "Unable to open recording";
+        return false;
+    }
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        error = "Recording is empty";
+        return false;
+    }
+    size = size_t(file_stat.st_size);
+
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapped != MAP_FAILED)
+    {
+        madvise(mapped, size, MADV_SEQUENTIAL);
+        data = static_cast<const uint8_t*>(mapped);
+    }
+#endif
+
+    if (!data)
+    {
+        error = "Unable to map recording";
+        close();
+        return false;
+    }
+
+    if (size < sizeof(input_recording_magic) + 1 || memcmp(data, input_recording_magic, sizeof(input_recording_magic)) != 0)
+    {
+        error = "Not an input recording";
+        close();
+        return false;
+    }
+
+    if (data[sizeof(input_recording_magic)] > input_recording_version)
+    {
+        error = "Recording was made by a newer version";
+        close();
+        return false;
+    }
+
+    cursor = data + sizeof(input_recording_magic) + 1;
+    time_us = 0;
+    return true;
+}
+
+void input_recording_file::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+    cursor = nullptr;
+    size = 0;
+}
+
+bool input_recording_file::next(input_record& record)
+{
+    if (!data) return false;
+
+    const uint8_t* end = data + size;
+    const uint8_t* read = cursor;
+
+    uint64_t delta;
+    if (!read_varint(read, end, delta)) return false;
+    if (read >= end) return false;
+
+    record.type = input_record_type(*read++);
+
+    uint64_t a = 0;
+    uint64_t b = 0;
+    switch (record.type)
+    {
+    case input_record_type::key_down:
+    case input_record_type::key_up:
+    case input_record_type::mouse_down:
+    case input_record_type::mouse_up:
+        if (!read_varint(read, end, a)) return false;
+        record.a = int32_t(a);
+        record.b = 0;
+        break;
+    case input_record_type::mouse_move:
+    case input_record_type::mouse_wheel:
+        if (!read_varint(read, end, a)) return false;
+        if (!read_varint(read, end, b)) return false;
+        record.a = int32_t(zigzag_decode(a));
+        record.b = int32_t(zigzag_decode(b));
+        break;
+    default:
+        return false;
+    }
+
+    cursor = read;
+    time_us += delta;
+    record.time_us = time_us;
+    return true;
+}
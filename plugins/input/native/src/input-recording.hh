@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+//Recording file layout
+//  header: "CMIR" magic, uint8 version
+//  records: varint time delta in microseconds since the previous record, uint8 type, type specific payload
+//    key_down / key_up: varint vkcode
+//    mouse_move: zigzag varint dx, zigzag varint dy
+//    mouse_wheel: zigzag varint vertical units, zigzag varint horizontal units
+//    mouse_down / mouse_up: varint input_mouse_button (version 2)
+//Most records are 3-4 bytes so hours of input stay small, and the reader never needs more than one record in memory.
+
+static const uint8_t input_recording_version = 2;
+
+enum class input_record_type : uint8_t
+{
+    key_down = 0,
+    key_up = 1,
+    mouse_move = 2,
+    mouse_wheel = 3,
+    mouse_down = 4,
+    mouse_up = 5,
+};
+
+enum class input_mouse_button : uint8_t
+{
+    left = 0,
+    right = 1,
+    middle = 2,
+    x1 = 3,
+    x2 = 4,
+};
+static const uint32_t input_mouse_button_count = 5;
+
+struct input_record
+{
+    //Time since the start of the recording in microseconds.
+    uint64_t time_us = 0;
+    input_record_type type = input_record_type::key_down;
+    int32_t a = 0;
+    int32_t b = 0;
+};
+
+void write_varint(std::vector<uint8_t>& buffer, uint64_t value);
+bool read_varint(const uint8_t*& data, const uint8_t* end, uint64_t& value);
+
+inline uint64_t zigzag_encode(int64_t value) { return (uint64_t(value) << 1) ^ uint64_t(value >> 63); }
+inline int64_t zigzag_decode(uint64_t value) { return int64_t(value >> 1) ^ -int64_t(value & 1); }
+
+//Events are encoded straight into a buffer on the input thread, a writer thread swaps the buffer out and does the file IO.
+class input_recorder
+{
+public:
+    ~input_recorder();
+
+    bool start(const std::string& path);
+    void stop();
+    bool is_recording() const { return recording; }
+
+    void record(input_record_type type, int32_t a, int32_t b = 0);
+
+private:
+    void writer_thread_main();
+
+    FILE* file = nullptr;
+    std::atomic<bool> recording { false };
+    bool stopping = false;
+
+    uint64_t start_us = 0;
+    uint64_t last_us = 0;
+
+    std::mutex buffer_mutex;
+    std::condition_variable buffer_cv;
+    std::vector<uint8_t> pending;
+    std::thread writer_thread;
+};
+
+//Read only view of a recording file mapped into memory, pages are only faulted in as playback reaches them.
+class input_recording_file
+{
+public:
+    ~input_recording_file();
+
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    //Walks records in order, returns false at the end of the file or on a corrupt record.
+    bool next(input_record& record);
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const uint8_t* cursor = nullptr;
+    uint64_t time_us = 0;
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
@@ -0,0 +1,190 @@
+#include "input-replay.hh"
+
+#include <windows.h>
+#include <timeapi.h>
+
+//Waits are done on the condition variable until this close to the deadline, then spun out.
+static const auto spin_margin = std::chrono::microseconds(1500);
+
+input_replay::input_replay(double speed)
+    : speed(speed)
+{
+}
+
+input_replay::~input_replay()
+{
+    cancel();
+    if (replay_thread.joinable()) {
+        replay_thread.join();
+    }
+}
+
+bool input_replay::open(const std::string& path, std::string& error)
+{
+    return file.open(path, error);
+}
+
+void input_replay::start(Napi::ThreadSafeFunction done)
+{
+    done_tsfn = done;
+    replay_thread = std::thread(&input_replay::thread_main, this);
+}
+
+void input_replay::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(cancel_mutex);
+        cancelled = true;
+    }
+    cancel_cv.notify_all();
+}
+
+bool input_replay::wait_until(std::chrono::steady_clock::time_point deadline)
+{
+    {
+        std::unique_lock<std::mutex> lock(cancel_mutex);
+        if (cancel_cv.wait_until(lock, deadline - spin_margin, [this] { return cancelled.load(); })) {
+            return false;
+        }
+    }
+
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (cancelled) return false;
+        std::this_thread::yield();
+    }
+
+    return !cancelled;
+}
+
+static void send_key(uint32_t vkcode, bool down)
+{
+    INPUT input = {0};
+    input.type = INPUT_KEYBOARD;
+    input.ki.wVk = static_cast<WORD>(vkcode);
+    input.ki.dwFlags = down ? 0 : KEYEVENTF_KEYUP;
+    SendInput(1, &input, sizeof(input));
+}
+
+static void send_mouse_button(uint32_t button, bool down)
+{
+    INPUT input = {0};
+    input.type = INPUT_MOUSE;
+
+    switch (input_mouse_button(button))
+    {
+    case input_mouse_button::left:
+        input.mi.dwFlags = down ? MOUSEEVENTF_LEFTDOWN : MOUSEEVENTF_LEFTUP;
+        break;
+    case input_mouse_button::right:
+        input.mi.dwFlags = down ? MOUSEEVENTF_RIGHTDOWN : MOUSEEVENTF_RIGHTUP;
+        break;
+    case input_mouse_button::middle:
+        input.mi.dwFlags = down ? MOUSEEVENTF_MIDDLEDOWN : MOUSEEVENTF_MIDDLEUP;
+        break;
+    case input_mouse_button::x1:
+        input.mi.dwFlags = down ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+        input.mi.mouseData = XBUTTON1;
+        break;
+    case input_mouse_button::x2:
+        input.mi.dwFlags = down ? MOUSEEVENTF_XDOWN : MOUSEEVENTF_XUP;
+        input.mi.mouseData = XBUTTON2;
+        break;
+    default:
+        return;
+    }
+
+    SendInput(1, &input, sizeof(input));
+}
+
+void input_replay::inject(const input_record& record)
+{
+    switch (record.type)
+    {
+    case input_record_type::key_down:
+        if (record.a < 256) held_keys[record.a] = true;
+        send_key(record.a, true);
+        break;
+    case input_record_type::key_up:
+        if (record.a < 256) held_keys[record.a] = false;
+        send_key(record.a, false);
+        break;
+    case input_record_type::mouse_down:
+    case input_record_type::mouse_up:
+    {
+        const bool down = record.type == input_record_type::mouse_down;
+        if (uint32_t(record.a) < input_mouse_button_count) held_buttons[record.a] = down;
+        send_mouse_button(record.a, down);
+        break;
+    }
+    case input_record_type::mouse_move:
+    {
+        INPUT input = {0};
+        input.type = INPUT_MOUSE;
+        input.mi.dx = record.a;
+        input.mi.dy = record.b;
+        input.mi.dwFlags = MOUSEEVENTF_MOVE;
+        SendInput(1, &input, sizeof(input));
+        break;
+    }
+    case input_record_type::mouse_wheel:
+    {
+        INPUT inputs[2] = {0};
+        UINT count = 0;
+        if (record.a != 0) {
+            inputs[count].type = INPUT_MOUSE;
+            inputs[count].mi.mouseData = record.a;
+            inputs[count].mi.dwFlags = MOUSEEVENTF_WHEEL;
+            ++count;
+        }
+        if (record.b != 0) {
+            inputs[count].type = INPUT_MOUSE;
+            inputs[count].mi.mouseData = record.b;
+            inputs[count].mi.dwFlags = MOUSEEVENTF_HWHEEL;
+            ++count;
+        }
+        if (count > 0) SendInput(count, inputs, sizeof(INPUT));
+        break;
+    }
+    }
+}
+
+void input_replay::thread_main()
+{
+    //Default timer resolution is ~15ms which is far too coarse for combos.
+    timeBeginPeriod(1);
+
+    const auto start = std::chrono::steady_clock::now();
+
+    input_record record;
+    while (file.next(record)) {
+        const auto deadline = start + std::chrono::microseconds(uint64_t(record.time_us / speed));
+        if (!wait_until(deadline)) break;
+
+        inject(record);
+    }
+
+    //Don't leave keys or buttons stuck down if we were cancelled mid combo.
+    for (uint32_t vkcode = 0; vkcode < 256; ++vkcode) {
+        if (held_keys[vkcode]) send_key(vkcode, false);
+    }
+    held_keys.reset();
+    for (uint32_t button = 0; button < input_mouse_button_count; ++button) {
+        if (held_buttons[button]) send_mouse_button(button, false);
+    }
+    held_buttons.reset();
+
+    timeEndPeriod(1);
+
+    file.close();
+
+    done_tsfn.BlockingCall([](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({});
+    });
+    done_tsfn.Release();
+
+    finished = true;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <napi.h>
+
+#include <bitset>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "input-recording.hh"
+
+//Plays a recording back through SendInput on its own thread.
+//Every record is scheduled against the replay's start time rather than the previous record,
+//so sleep overshoot never accumulates over a long recording.
+class input_replay
+{
+public:
+    input_replay(double speed);
+    ~input_replay();
+
+    bool open(const std::string& path, std::string& error);
+
+    //done is called on the JS thread once the replay finishes or is cancelled.
+    void start(Napi::ThreadSafeFunction done);
+    void cancel();
+    bool is_finished() const { return finished; }
+
+private:
+    void thread_main();
+    bool wait_until(std::chrono::steady_clock::time_point deadline);
+    void inject(const input_record& record);
+
+    input_recording_file file;
+    double speed;
+
+    std::thread replay_thread;
+    std::mutex cancel_mutex;
+    std::condition_variable cancel_cv;
+    std::atomic<bool> cancelled { false };
+    std::atomic<bool> finished { false };
+
+    Napi::ThreadSafeFunction done_tsfn;
+
+    //Keys pressed by the replay, released if the replay is cut short.
+    std::bitset<256> held_keys;
+    std::bitset<input_mouse_button_count> held_buttons;
+};
@@ -0,0 +1,154 @@
+#include "input-typer.hh"
+
+#include <timeapi.h>
+
+#include <algorithm>
+
+static INPUT unicode_input(char16_t unit, bool down)
+{
+    INPUT input = {0};
+    input.type = INPUT_KEYBOARD;
+    input.ki.wScan = static_cast<WORD>(unit);
+    input.ki.dwFlags = KEYEVENTF_UNICODE | (down ? 0 : KEYEVENTF_KEYUP);
+    return input;
+}
+
+static INPUT vk_input(WORD vkcode, bool down)
+{
+    INPUT input = {0};
+    input.type = INPUT_KEYBOARD;
+    input.ki.wVk = vkcode;
+    input.ki.dwFlags = down ? 0 : KEYEVENTF_KEYUP;
+    return input;
+}
+
+static bool is_high_surrogate(char16_t unit) { return unit >= 0xD800 && unit <= 0xDBFF; }
+static bool is_low_surrogate(char16_t unit) { return unit >= 0xDC00 && unit <= 0xDFFF; }
+
+input_typer::input_typer(const std::u16string& text, double cps)
+    : cps(cps)
+{
+    inputs.reserve(text.size() * 2);
+    character_ends.reserve(text.size());
+
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char16_t unit = text[i];
+
+        if (unit == u'\r' || unit == u'\n') {
+            //Apps treat a unicode newline inconsistently, Enter is what a person would press. \r\n is one Enter.
+            if (unit == u'\r' && i + 1 < text.size() && text[i + 1] == u'\n') ++i;
+            inputs.push_back(vk_input(VK_RETURN, true));
+            inputs.push_back(vk_input(VK_RETURN, false));
+        } else if (unit == u'\t') {
+            inputs.push_back(vk_input(VK_TAB, true));
+            inputs.push_back(vk_input(VK_TAB, false));
+        } else if (is_high_surrogate(unit)) {
+            if (i + 1 >= text.size() || !is_low_surrogate(text[i + 1])) continue;
+            //Both halves go down before either comes up so the pair reaches the window as adjacent WM_CHARs.
+            const char16_t low = text[++i];
+            inputs.push_back(unicode_input(unit, true));
+            inputs.push_back(unicode_input(low, true));
+            inputs.push_back(unicode_input(unit, false));
+            inputs.push_back(unicode_input(low, false));
+        } else if (is_low_surrogate(unit)) {
+            continue;
+        } else {
+            inputs.push_back(unicode_input(unit, true));
+            inputs.push_back(unicode_input(unit, false));
+        }
+
+        character_ends.push_back(inputs.size());
+    }
+}
+
+input_typer::~input_typer()
+{
+    cancel();
+    if (typer_thread.joinable()) {
+        typer_thread.join();
+    }
+}
+
+void input_typer::start(Napi::ThreadSafeFunction done)
+{
+    done_tsfn = done;
+    typer_thread = std::thread(&input_typer::thread_main, this);
+}
+
+void input_typer::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(cancel_mutex);
+        cancelled = true;
+    }
+    cancel_cv.notify_all();
+}
+
+bool input_typer::wait_until(std::chrono::steady_clock::time_point deadline)
+{
+    std::unique_lock<std::mutex> lock(cancel_mutex);
+    return !cancel_cv.wait_until(lock, deadline, [this] { return cancelled.load(); });
+}
+
+size_t input_typer::send_characters(size_t first, size_t last)
+{
+    const size_t begin = first == 0 ? 0 : character_ends[first - 1];
+    const size_t end = character_ends[last - 1];
+
+    UINT sent;
+    {
+        //Sending under the cancel lock means nothing is typed once cancel() has returned.
+        std::lock_guard<std::mutex> lock(cancel_mutex);
+        if (cancelled) return 0;
+        sent = SendInput(static_cast<UINT>(end - begin), &inputs[begin], sizeof(INPUT));
+    }
+
+    //SendInput only comes up short when something blocks injection, count what got through whole.
+    const auto typed_end = std::upper_bound(character_ends.begin() + first, character_ends.begin() + last, begin + sent);
+    return static_cast<size_t>(typed_end - character_ends.begin()) - first;
+}
+
+void input_typer::thread_main()
+{
+    const size_t count = character_count();
+    size_t typed = 0;
+
+    if (count > 0 && !(cps > 0)) {
+        typed = send_characters(0, count);
+    } else if (count > 0) {
+        //Default timer resolution is ~15ms, which would clump anything faster than ~60 cps.
+        timeBeginPeriod(1);
+
+        //Character n is due at n / cps after the start, so a late wake never slows the overall rate.
+        const auto start = std::chrono::steady_clock::now();
+        const auto due_time = [&](size_t index) {
+            return start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(index / cps));
+        };
+
+        while (typed < count) {
+            if (!wait_until(due_time(typed))) break;
+
+            //Everything that came due while we slept goes out together.
+            const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            const size_t due = std::clamp(static_cast<size_t>(elapsed * cps) + 1, typed + 1, count);
+
+            const size_t sent = send_characters(typed, due);
+            typed += sent;
+            if (typed < due) break;
+        }
+
+        timeEndPeriod(1);
+    }
+
+    done_tsfn.BlockingCall([typed](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({ Napi::Number::New(env, static_cast<double>(typed)) });
+    });
+    done_tsfn.Release();
+
+    finished = true;
+}
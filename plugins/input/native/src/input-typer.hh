@@ -0,0 +1,50 @@
+#pragma once
+
+#include <napi.h>
+#include <windows.h>
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+//Types a string through KEYEVENTF_UNICODE SendInput on its own thread.
+//The whole string is turned into input events up front, characters are only ever sent whole so a cancel
+//between two of them can't leave a key down. Characters that came due together go out in one SendInput.
+class input_typer
+{
+public:
+    //cps of 0 or less types everything in a single SendInput.
+    input_typer(const std::u16string& text, double cps);
+    ~input_typer();
+
+    //done is called on the JS thread with the number of characters typed once it finishes or is cancelled.
+    void start(Napi::ThreadSafeFunction done);
+    void cancel();
+    bool is_finished() const { return finished; }
+
+    size_t character_count() const { return character_ends.size(); }
+
+private:
+    void thread_main();
+    bool wait_until(std::chrono::steady_clock::time_point deadline);
+    //Sends characters [first, last), returns how many made it into the input stream.
+    size_t send_characters(size_t first, size_t last);
+
+    double cps;
+
+    std::vector<INPUT> inputs;
+    //One past the last INPUT of each character.
+    std::vector<size_t> character_ends;
+
+    std::thread typer_thread;
+    std::mutex cancel_mutex;
+    std::condition_variable cancel_cv;
+    std::atomic<bool> cancelled { false };
+    std::atomic<bool> finished { false };
+
+    Napi::ThreadSafeFunction done_tsfn;
+};
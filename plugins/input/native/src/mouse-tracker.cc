@@ -0,0 +1,138 @@
+#include "mouse-tracker.hh"
+
+#include <cmath>
+#include <cstdlib>
+
+//Windows reports wheel movement in multiples of WHEEL_DELTA per detent.
+static constexpr int32_t wheel_units_per_tick = 120;
+
+void mouse_tracker::configure(const mouse_config& new_config)
+{
+    config = new_config;
+    reset();
+}
+
+void mouse_tracker::reset()
+{
+    pending_motion = mouse_motion();
+    pending_wheel_vertical = 0;
+    pending_wheel_horizontal = 0;
+
+    sample_start = 0;
+    sample_count = 0;
+    window_dx = 0;
+    window_dy = 0;
+    last_flick_us = 0;
+}
+
+void mouse_tracker::push_sample(const sample& s)
+{
+    if (sample_count == max_samples)
+    {
+        const sample& oldest = samples[sample_start];
+        window_dx -= oldest.dx;
+        window_dy -= oldest.dy;
+        sample_start = (sample_start + 1) % max_samples;
+        --sample_count;
+    }
+
+    samples[(sample_start + sample_count) % max_samples] = s;
+    ++sample_count;
+    window_dx += s.dx;
+    window_dy += s.dy;
+}
+
+void mouse_tracker::expire_samples(uint64_t time_us)
+{
+    const uint64_t window_us = uint64_t(config.flick_window_ms) * 1000;
+    while (sample_count > 0)
+    {
+        const sample& oldest = samples[sample_start];
+        if (time_us - oldest.time_us <= window_us) break;
+
+        window_dx -= oldest.dx;
+        window_dy -= oldest.dy;
+        sample_start = (sample_start + 1) % max_samples;
+        --sample_count;
+    }
+}
+
+bool mouse_tracker::add_motion(int32_t dx, int32_t dy, uint64_t time_us)
+{
+    if (config.flick_velocity > 0)
+    {
+        push_sample({ time_us, dx, dy });
+    }
+
+    //Nothing would ever take the motion, don't let it pile up.
+    if (config.flush_interval_ms == 0 && config.move_threshold <= 0) return false;
+
+    pending_motion.dx += dx;
+    pending_motion.dy += dy;
+
+    if (config.move_threshold <= 0) return false;
+
+    //Manhattan distance is plenty for a flush threshold and avoids a sqrt per report.
+    return std::abs(pending_motion.dx) + std::abs(pending_motion.dy) >= config.move_threshold;
+}
+
+bool mouse_tracker::add_wheel(int32_t vertical_units, int32_t horizontal_units)
+{
+    if (config.flush_interval_ms == 0 && config.wheel_threshold <= 0) return false;
+
+    pending_wheel_vertical += vertical_units;
+    pending_wheel_horizontal += horizontal_units;
+
+    if (config.wheel_threshold <= 0) return false;
+
+    const int32_t threshold_units = config.wheel_threshold * wheel_units_per_tick;
+    return std::abs(pending_wheel_vertical) >= threshold_units || std::abs(pending_wheel_horizontal) >= threshold_units;
+}
+
+bool mouse_tracker::check_flick(uint64_t time_us, mouse_flick& flick)
+{
+    if (config.flick_velocity <= 0 || config.flick_window_ms == 0) return false;
+
+    expire_samples(time_us);
+    if (sample_count == 0) return false;
+
+    if (last_flick_us != 0 && time_us - last_flick_us < uint64_t(config.flick_cooldown_ms) * 1000) return false;
+
+    const double window_s = config.flick_window_ms / 1000.0;
+    const double distance = std::sqrt(double(window_dx) * window_dx + double(window_dy) * window_dy);
+    const double velocity = distance / window_s;
+
+    if (velocity < config.flick_velocity) return false;
+
+    flick.velocity = velocity;
+    flick.dx = int32_t(window_dx);
+    flick.dy = int32_t(window_dy);
+
+    //Start a fresh window so the same motion can't be reported again once the cooldown is over.
+    last_flick_us = time_us;
+    sample_start = 0;
+    sample_count = 0;
+    window_dx = 0;
+    window_dy = 0;
+    return true;
+}
+
+bool mouse_tracker::take_motion(mouse_motion& motion)
+{
+    if (pending_motion.dx == 0 && pending_motion.dy == 0) return false;
+
+    motion = pending_motion;
+    pending_motion = mouse_motion();
+    return true;
+}
+
+bool mouse_tracker::take_wheel(mouse_wheel& wheel)
+{
+    if (pending_wheel_vertical == 0 && pending_wheel_horizontal == 0) return false;
+
+    wheel.vertical = double(pending_wheel_vertical) / wheel_units_per_tick;
+    wheel.horizontal = double(pending_wheel_horizontal) / wheel_units_per_tick;
+    pending_wheel_vertical = 0;
+    pending_wheel_horizontal = 0;
+    return true;
+}
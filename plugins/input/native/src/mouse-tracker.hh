@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <array>
+
+//Mice can report at 1000-8000hz, far too often to hand every report to JS.
+//The tracker accumulates raw reports on the input thread and only hands back
+//coalesced motion, whole wheel ticks, and detected flick gestures.
+
+struct mouse_config
+{
+    //How often accumulated motion and wheel ticks are flushed, 0 disables the periodic flush.
+    uint32_t flush_interval_ms = 0;
+    //Flush motion immediately once the accumulated distance reaches this many counts, 0 disables.
+    int32_t move_threshold = 0;
+    //Flush the wheel immediately once this many whole ticks have accumulated, 0 disables.
+    int32_t wheel_threshold = 1;
+
+    //Minimum velocity in counts per second over the flick window to report a flick, 0 disables.
+    double flick_velocity = 0;
+    uint32_t flick_window_ms = 100;
+    //Minimum time between two reported flicks so one fast swipe doesn't fire repeatedly.
+    uint32_t flick_cooldown_ms = 250;
+};
+
+struct mouse_motion
+{
+    int32_t dx = 0;
+    int32_t dy = 0;
+};
+
+struct mouse_wheel
+{
+    //Wheel deltas in ticks, fractional for high resolution wheels.
+    double vertical = 0;
+    double horizontal = 0;
+};
+
+struct mouse_flick
+{
+    double velocity = 0;
+    int32_t dx = 0;
+    int32_t dy = 0;
+};
+
+class mouse_tracker
+{
+public:
+    void configure(const mouse_config& new_config);
+    const mouse_config& get_config() const { return config; }
+
+    void reset();
+
+    //Returns true if the move threshold was crossed and motion should be flushed now.
+    bool add_motion(int32_t dx, int32_t dy, uint64_t time_us);
+    //Returns true if the wheel threshold was crossed and the wheel should be flushed now.
+    bool add_wheel(int32_t vertical_units, int32_t horizontal_units);
+
+    //Returns true and fills flick if the samples currently in the window form a flick.
+    bool check_flick(uint64_t time_us, mouse_flick& flick);
+
+    //Takes the accumulated motion, returns false if there was nothing to take.
+    bool take_motion(mouse_motion& motion);
+    //Takes the accumulated wheel movement converted to ticks.
+    bool take_wheel(mouse_wheel& wheel);
+
+private:
+    struct sample
+    {
+        uint64_t time_us;
+        int32_t dx;
+        int32_t dy;
+    };
+
+    void push_sample(const sample& s);
+    void expire_samples(uint64_t time_us);
+
+    mouse_config config;
+
+    mouse_motion pending_motion;
+    int32_t pending_wheel_vertical = 0;
+    int32_t pending_wheel_horizontal = 0;
+
+    //Ring of recent samples inside the flick window, with running sums so velocity is O(1).
+    //At 8000hz a 100ms window is 800 samples, if the ring fills the oldest sample is dropped early.
+    static constexpr size_t max_samples = 1024;
+    std::array<sample, max_samples> samples;
+    size_t sample_start = 0;
+    size_t sample_count = 0;
+    int64_t window_dx = 0;
+    int64_t window_dy = 0;
+
+    uint64_t last_flick_us = 0;
+};
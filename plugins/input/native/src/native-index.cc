@@ -6,6 +6,7 @@
 #include <iostream>
 
 #include "input-interface.hh"
+#include "castmate-native/trace-bindings.hh"
 
 
 class instance_data
@@ -26,6 +27,7 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
     env.SetInstanceData<instance_data>(new instance_data(env));
 
     input_interface::init(env, exports);
+    trace_init(env, exports);
 
     return exports;
 }
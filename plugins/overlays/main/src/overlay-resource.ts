@@ -29,7 +29,7 @@ import { setupConfigEval } from "./config-evaluation"
 import { OverlayWebsocketService } from "./websocket-bridge"
 import { OBSConnection } from "castmate-plugin-obs-main"
 
-import { SoundOutput } from "castmate-plugin-sound-main"
+import { MixStreamService, SoundOutput } from "castmate-plugin-sound-main"
 
 const logger = usePluginLogger("overlays")
 
@@ -134,6 +134,13 @@ export class OverlaySoundOutput extends SoundOutput<OverlaySoundConfig> {
 		volume: number,
 		abortSignal: AbortSignal
 	): Promise<boolean> {
+		//Overlay pages listening to the mix stream all hear one native mix in sync instead of each fetching the file
+		const streamBus = `overlay.${this.config.overlayId}`
+		if (MixStreamService.getInstance().hasListeners(streamBus)) {
+			await MixStreamService.getInstance().playFile(streamBus, file, startSec, endSec, volume, abortSignal)
+			return true
+		}
+
 		const playId = nanoid()
 
 		abortSignal.onabort = () =>
@@ -16,6 +16,7 @@ import {
 	MediaManager,
 	ViewerData,
 	ipcConvertSchema,
+	WebService,
 } from "castmate-core"
 import { OverlayConfig } from "castmate-plugin-overlays-shared"
 import { Overlay } from "./overlay-resource"
@@ -75,9 +76,11 @@ export const OverlayWebsocketService = Service(
 					sockets: [socket],
 					evaluator: await createOverlayEvaluator(overlay.config, async (resolvedConfig) => {
 						if (!openData) return
-						for (const socket of openData.sockets) {
-							await socket.call<(config: OverlayConfig) => any>("overlays_setConfig", resolvedConfig)
-						}
+						await WebService.getInstance().callWebsocketRPC<(config: OverlayConfig) => any>(
+							openData.sockets,
+							"overlays_setConfig",
+							resolvedConfig
+						)
 					}),
 				}
 
@@ -222,15 +225,15 @@ export const OverlayWebsocketService = Service(
 				const openSockets = this.openOverlays.get(overlay.id)
 				if (!openSockets) return []
 
-				const calls = openSockets.sockets.map((s) => s.call("overlays_widgetRPC", widgetId, rpcId, ...args))
+				//logger.log("Calling", widgetId, rpcId, "on", openSockets.sockets.length, "sockets")
 
-				//logger.log("Calling", widgetId, rpcId, "on", calls.length, "sockets")
-
-				const results = await Promise.allSettled(calls)
-
-				const successes = results.filter((r): r is PromiseFulfilledResult<any> => r.status == "fulfilled")
-
-				return successes.map((s) => s.value as ReturnType<T>)
+				return (await WebService.getInstance().callWebsocketRPC(
+					openSockets.sockets,
+					"overlays_widgetRPC",
+					widgetId,
+					rpcId,
+					...args
+				)) as ReturnType<T>[]
 			}
 
 			return []
@@ -269,12 +272,16 @@ export const OverlayWebsocketService = Service(
 
 			if (!remoteMediaName) return playId
 
-			const calls = openSockets.sockets.map((s) =>
-				s.call("overlays_playAudio", remoteMediaName, playId, startSec, endSec, volume)
+			await WebService.getInstance().callWebsocketRPC(
+				openSockets.sockets,
+				"overlays_playAudio",
+				remoteMediaName,
+				playId,
+				startSec,
+				endSec,
+				volume
 			)
 
-			await Promise.allSettled(calls)
-
 			return playId
 		}
 
@@ -287,19 +294,18 @@ export const OverlayWebsocketService = Service(
 
 			if (!openSockets) return playId
 
-			const calls = openSockets.sockets.map((s) => s.call("overlays_cancelAudio", playId))
-
-			await Promise.allSettled(calls)
+			await WebService.getInstance().callWebsocketRPC(openSockets.sockets, "overlays_cancelAudio", playId)
 		}
 
 		async sendOverlayMessage(messageId: string, ...args: any[]) {
-			const calls = new Array<Promise<any>>()
+			const sockets = new Array<ExtendedWebsocket>()
 
 			for (const [id, overlay] of this.openOverlays) {
-				calls.push(...overlay.sockets.map((s) => s.call("overlays_broadcast", messageId, ...args)))
+				sockets.push(...overlay.sockets)
 			}
 
-			await Promise.allSettled(calls)
+			//One request for every overlay, chat floods would otherwise serialize each message once per socket
+			await WebService.getInstance().callWebsocketRPC(sockets, "overlays_broadcast", messageId, ...args)
 		}
 
 		handleWidgetRPC(id: string, func: WidgetRPCHandler) {
@@ -0,0 +1,74 @@
+import { decodeMediaAudio, ensureDirectory } from "castmate-core"
+import { app } from "electron"
+import * as path from "path"
+import * as fs from "fs"
+import * as crypto from "crypto"
+import { readWavFormat, WavFormat } from "castmate-plugin-sound-native"
+
+function decodeCachePath() {
+	return path.join(app.getPath("temp"), "castmate-decoded")
+}
+
+const decodeStats = {
+	/** Sources that were already in an accepted format and used as is */
+	passthrough: 0,
+	cached: 0,
+	decoded: 0,
+}
+
+export function getDecodeStats() {
+	return { ...decodeStats }
+}
+
+function exactFormat(sampleRate: number, channels: number) {
+	return (format: WavFormat) =>
+		format.sampleRate == sampleRate && format.channels == channels && format.bitsPerSample == 16
+}
+
+/**
+ * Decodes a media file to a 16 bit wav at the given rate and channel count for the native side.
+ * Each version of a file is only decoded once. A wav source that accepts says the native side can already take is
+ * returned unchanged, by default that's an exact match of rate, channels and 16 bit.
+ */
+export async function decodeCached(
+	file: string,
+	sampleRate: number,
+	channels: number = 1,
+	accepts: (format: WavFormat) => boolean = exactFormat(sampleRate, channels)
+) {
+	const stat = await fs.promises.stat(file)
+
+	if (path.extname(file).toLowerCase() == ".wav") {
+		//Only the header is read, a source that isn't plain PCM comes back undefined and goes through ffmpeg
+		const format = readWavFormat(file)
+		if (format && accepts(format)) {
+			decodeStats.passthrough++
+			return file
+		}
+	}
+
+	const key = crypto
+		.createHash("sha1")
+		.update(file)
+		.update("\0")
+		.update(String(stat.mtimeMs))
+		.update("\0")
+		.update(`${sampleRate}x${channels}`)
+		.digest("hex")
+
+	await ensureDirectory(decodeCachePath())
+	const decoded = path.join(decodeCachePath(), `${key}.wav`)
+
+	try {
+		await fs.promises.access(decoded)
+		decodeStats.cached++
+		return decoded
+	} catch {}
+
+	//Decoded beside the cache then renamed in, a failed decode never leaves a partial entry
+	const partial = `${decoded}.partial.wav`
+	await decodeMediaAudio(file, partial, sampleRate, channels)
+	await fs.promises.rename(partial, decoded)
+	decodeStats.decoded++
+	return decoded
+}
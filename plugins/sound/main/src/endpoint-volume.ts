@@ -0,0 +1,153 @@
+import { defineAction, defineState, onLoad, onUnload, usePluginLogger } from "castmate-core"
+import { Toggle } from "castmate-schema"
+import { AudioDeviceInterface } from "castmate-plugin-sound-native"
+
+const logger = usePluginLogger("sound")
+
+export function setupEndpointVolume() {
+	const systemVolume = defineState("systemVolume", { type: Number, name: "System Volume" })
+	const systemMuted = defineState("systemMuted", { type: Boolean, name: "System Muted" })
+	const micVolume = defineState("micVolume", { type: Number, name: "Microphone Volume" })
+	const micMuted = defineState("micMuted", { type: Boolean, name: "Microphone Muted" })
+
+	let deviceInterface: AudioDeviceInterface | undefined
+	let outputId: string | undefined
+	let inputId: string | undefined
+
+	function watch(deviceId: string | undefined, volume: typeof systemVolume, muted: typeof systemMuted) {
+		if (!deviceInterface || !deviceId) return
+
+		try {
+			const state = deviceInterface.watchEndpoint(deviceId)
+			volume.value = Math.round(state.volume * 100)
+			muted.value = state.muted
+		} catch (err) {
+			logger.error("Unable to watch endpoint volume", deviceId, err)
+		}
+	}
+
+	function unwatch(deviceId: string | undefined) {
+		if (!deviceInterface || !deviceId) return
+		deviceInterface.unwatchEndpoint(deviceId)
+	}
+
+	onLoad(() => {
+		deviceInterface = new AudioDeviceInterface()
+
+		//Windows notifies on change, nothing here polls
+		deviceInterface.on("endpoint-volume-changed", (deviceId, volume, muted) => {
+			if (deviceId == outputId) {
+				systemVolume.value = Math.round(volume * 100)
+				systemMuted.value = muted
+			}
+			if (deviceId == inputId) {
+				micVolume.value = Math.round(volume * 100)
+				micMuted.value = muted
+			}
+		})
+
+		deviceInterface.on("default-output-changed", (type, device) => {
+			if (type != "main") return
+			unwatch(outputId)
+			outputId = device?.id
+			watch(outputId, systemVolume, systemMuted)
+		})
+
+		deviceInterface.on("default-input-changed", (type, device) => {
+			if (type != "main") return
+			unwatch(inputId)
+			inputId = device?.id
+			watch(inputId, micVolume, micMuted)
+		})
+
+		outputId = deviceInterface.getDefaultOutput("main")?.id
+		inputId = deviceInterface.getDefaultInput("main")?.id
+		watch(outputId, systemVolume, systemMuted)
+		watch(inputId, micVolume, micMuted)
+	})
+
+	onUnload(() => {
+		unwatch(outputId)
+		unwatch(inputId)
+		deviceInterface = undefined
+	})
+
+	function setMuted(deviceId: string | undefined, current: boolean, muted: Toggle) {
+		if (!deviceInterface || !deviceId) return
+		deviceInterface.setEndpointMute(deviceId, muted == "toggle" ? !current : muted)
+	}
+
+	defineAction({
+		id: "systemVolume",
+		name: "Set System Volume",
+		icon: "mdi mdi-volume-high",
+		description: "Changes the volume of the default output device",
+		config: {
+			type: Object,
+			properties: {
+				volume: {
+					type: Number,
+					name: "Volume",
+					required: true,
+					default: 100,
+					slider: true,
+					min: 0,
+					max: 100,
+					template: true,
+				},
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			if (!deviceInterface || !outputId) return
+			deviceInterface.setEndpointVolume(outputId, config.volume / 100)
+		},
+	})
+
+	defineAction({
+		id: "systemMute",
+		name: "Mute System",
+		icon: "mdi mdi-volume-off",
+		description: "Mutes or unmutes the default output device",
+		config: {
+			type: Object,
+			properties: {
+				muted: {
+					type: Toggle,
+					name: "Muted",
+					required: true,
+					default: true,
+					template: true,
+					trueIcon: "mdi mdi-volume-off",
+					falseIcon: "mdi mdi-volume-high",
+				},
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			setMuted(outputId, systemMuted.value ?? false, config.muted)
+		},
+	})
+
+	defineAction({
+		id: "micMute",
+		name: "Mute Microphone",
+		icon: "mdi mdi-microphone-off",
+		description: "Mutes or unmutes the default input device",
+		config: {
+			type: Object,
+			properties: {
+				muted: {
+					type: Toggle,
+					name: "Muted",
+					required: true,
+					default: true,
+					template: true,
+					trueIcon: "mdi mdi-microphone-off",
+					falseIcon: "mdi mdi-microphone",
+				},
+			},
+		},
+		async invoke(config, contextData, abortSignal) {
+			setMuted(inputId, micMuted.value ?? false, config.muted)
+		},
+	})
+}
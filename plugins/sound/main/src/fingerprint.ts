@@ -0,0 +1,158 @@
+import {
+	defineSetting,
+	defineTrigger,
+	onLoad,
+	onUnload,
+	onProfilesChanged,
+	onSettingChanged,
+	usePluginLogger,
+	MediaManager,
+} from "castmate-core"
+import { MediaFile } from "castmate-schema"
+import { AudioDeviceInterface, AudioFingerprinter } from "castmate-plugin-sound-native"
+import { decodeCached } from "./decode-cache"
+
+const logger = usePluginLogger("sound")
+
+//Fingerprints only look at 4kHz and down, decoding clips to 8kHz up front keeps the native side to plain wav
+const fingerprintSampleRate = 8000
+
+export function setupFingerprint() {
+	const fingerprintInput = defineSetting("soundHeardInput", {
+		type: String,
+		name: "Sound Recognition Input",
+		enum: ["Default Input", "Communications Input", "Default Output (Loopback)"],
+		required: true,
+		default: "Default Output (Loopback)",
+	})
+
+	const soundHeard = defineTrigger({
+		id: "soundHeard",
+		name: "Sound Heard",
+		icon: "mdi mdi-ear-hearing",
+		description: "A known sound was recognized in the input, or in what's playing with loopback",
+		config: {
+			type: Object,
+			properties: {
+				sound: { type: MediaFile, name: "Sound", required: true, default: "", sound: true },
+				minConfidence: {
+					type: Number,
+					name: "Minimum Confidence",
+					slider: true,
+					min: 0,
+					max: 100,
+					required: true,
+					default: 20,
+				},
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				sound: { type: MediaFile, required: true, default: "", sound: true },
+				confidence: { type: Number, required: true, default: 100 },
+			},
+		},
+		async handle(config, context) {
+			if (config.sound != context.sound) return false
+			return context.confidence >= config.minConfidence
+		},
+	})
+
+	let fingerprinter: AudioFingerprinter | undefined
+	let deviceInterface: AudioDeviceInterface | undefined
+	let clipKey = ""
+
+	function getDevice() {
+		if (fingerprintInput.value == "Default Output (Loopback)") return { device: "main", loopback: true }
+		return { device: fingerprintInput.value == "Communications Input" ? "chat" : "main", loopback: false }
+	}
+
+	function updateCapture() {
+		if (!fingerprinter) return
+
+		//Nothing is captured unless a profile is listening for a sound
+		if (!clipKey) {
+			fingerprinter.stop()
+			return
+		}
+
+		const { device, loopback } = getDevice()
+		fingerprinter.start(device, { loopback })
+	}
+
+	async function updateClips(sounds: string[]) {
+		if (!fingerprinter) return
+
+		const clips: { id: string; file: string }[] = []
+		for (const sound of sounds) {
+			const media = MediaManager.getInstance().getMedia(sound)
+			if (!media) continue
+
+			try {
+				//Any 16 bit wav is downmixed and resampled natively, only other formats need ffmpeg
+				const file = await decodeCached(media.file, fingerprintSampleRate, 1, (f) => f.bitsPerSample == 16)
+				clips.push({ id: sound, file })
+			} catch (err) {
+				logger.error("Unable to decode", sound, "for recognition", err)
+			}
+		}
+
+		try {
+			await fingerprinter.setClips(clips)
+		} catch (err) {
+			logger.error("Unable to fingerprint sounds", err)
+		}
+	}
+
+	onLoad(() => {
+		fingerprinter = new AudioFingerprinter()
+		deviceInterface = new AudioDeviceInterface()
+
+		fingerprinter.on("match", (clipId, confidence, latencyMs) => {
+			soundHeard({ sound: clipId, confidence: Math.round(confidence * 100) })
+		})
+
+		fingerprinter.on("error", (message) => {
+			logger.error("Sound recognition capture stopped", message)
+		})
+
+		deviceInterface.on("default-input-changed", (type) => {
+			const { device, loopback } = getDevice()
+			if (!loopback && type == device) updateCapture()
+		})
+
+		deviceInterface.on("default-output-changed", (type) => {
+			const { device, loopback } = getDevice()
+			if (loopback && type == device) updateCapture()
+		})
+	})
+
+	onUnload(() => {
+		fingerprinter?.stop()
+		fingerprinter = undefined
+	})
+
+	onSettingChanged(fingerprintInput, () => {
+		updateCapture()
+	})
+
+	onProfilesChanged(async (activeProfiles, inactiveProfiles) => {
+		const sounds = new Set<string>()
+
+		for (const profile of activeProfiles) {
+			for (const trigger of profile.iterTriggers(soundHeard)) {
+				if (trigger.config.sound) sounds.add(trigger.config.sound)
+			}
+		}
+
+		//Only re-fingerprint when the set of sounds actually changed
+		const sorted = [...sounds].sort()
+		const key = sorted.join("\0")
+		if (key == clipKey) return
+		clipKey = key
+
+		if (sorted.length > 0) await updateClips(sorted)
+		updateCapture()
+	})
+}
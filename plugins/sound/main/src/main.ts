@@ -6,14 +6,22 @@ import {
 	defineSetting,
 	definePluginResource,
 	probeMedia,
+	registerNativeTracer,
+	defineIPCFunc,
 } from "castmate-core"
 import { MediaManager } from "castmate-core"
 import { Duration, MediaFile } from "castmate-schema"
 import { RendererSoundPlayer } from "./renderer-sound-player"
-import { AudioDeviceInterface } from "castmate-plugin-sound-native"
+import { AudioDeviceInterface, tracer } from "castmate-plugin-sound-native"
 import { SoundOutput, setupOutput } from "./output"
 import { TTSVoice, setupTTS } from "./tts"
 import { setupSplitters } from "./splitter"
+import { setupVoiceActivity } from "./voice-activity"
+import { setupFingerprint } from "./fingerprint"
+import { setupMixStream } from "./mix-stream"
+import { setupEndpointVolume } from "./endpoint-volume"
+import { getDecodeStats } from "./decode-cache"
+import * as fs from "fs"
 
 export default definePlugin(
 	{
@@ -34,9 +42,17 @@ export default definePlugin(
 			default: 100,
 		})
 
+		registerNativeTracer("sound", tracer)
+
 		setupOutput()
 		setupSplitters()
 		setupTTS()
+		setupVoiceActivity()
+		setupFingerprint()
+		setupMixStream()
+		setupEndpointVolume()
+
+		defineIPCFunc("sound", "getDecodeStats", () => getDecodeStats())
 
 		defineAction({
 			id: "sound",
@@ -121,10 +137,25 @@ export default definePlugin(
 				},
 			},
 			async invoke(config, contextData, abortSignal) {
-				const voiceFile = await config.voice?.generate(config.text)
-				if (!voiceFile) return
+				const generation = config.voice?.generateSegmented(config.text)
+				if (!generation) return
 				const globalFactor = globalVolume.value / 100
 
+				//Long messages start playing after their first sentence instead of after the whole thing
+				const played = await config.output.playSegments(
+					generation.segments,
+					config.volume * globalFactor,
+					abortSignal
+				)
+
+				const voiceFile = await generation.joined
+
+				for (const segment of generation.segmentFiles) {
+					if (segment != voiceFile) fs.promises.rm(segment, { force: true }).catch(() => {})
+				}
+
+				if (played || !voiceFile) return
+
 				const probeInfo = await probeMedia(voiceFile)
 
 				let duration = probeInfo.format.duration as number | string | undefined
@@ -154,3 +185,4 @@ export default definePlugin(
 )
 
 export { SoundOutput }
+export { MixStreamService } from "./mix-stream"
@@ -0,0 +1,215 @@
+import {
+	ExtendedWebsocket,
+	Service,
+	onLoad,
+	onUnload,
+	onWebsocketConnection,
+	onWebsocketDisconnect,
+	usePluginLogger,
+} from "castmate-core"
+import { MixStream } from "castmate-plugin-sound-native"
+import { decodeCached } from "./decode-cache"
+
+const logger = usePluginLogger("sound")
+
+//Listeners connect to ws://host/sound/stream?bus=<id>, adding &codec=pcm if they can't decode Opus
+const streamPath = "/sound/stream"
+
+type StreamCodec = "opus" | "pcm"
+
+//Set in the frame header's flags byte on Opus frames
+const opusFrameFlag = 2
+
+//About 200ms of 20ms frames, Opus ones average 320 bytes at 128kbps with some room for variable bitrate peaks.
+//A client this far behind skips frames until it catches up.
+const maxClientBufferedBytes: Record<StreamCodec, number> = {
+	opus: 10 * 480,
+	pcm: 10 * 3848,
+}
+//A client that hasn't caught up in this long is disconnected, it reconnects and starts fresh
+const maxClientDroppingMs = 3000
+
+interface StreamClient {
+	socket: ExtendedWebsocket
+	codec: StreamCodec
+	droppingSince?: number
+	droppedFrames: number
+}
+
+interface StreamBus {
+	stream: MixStream
+	clients: StreamClient[]
+	playing: Map<number, () => void>
+	//Set while the native side can't encode Opus and sends PCM frames to every listener instead
+	opusFailed: boolean
+}
+
+/**
+ * Mixes sounds natively and streams the mix to websocket listeners, so any number of overlays play a sound in sync
+ * from a single decode and a single encode.
+ */
+export const MixStreamService = Service(
+	class {
+		private buses = new Map<string, StreamBus>()
+		private socketBuses = new Map<ExtendedWebsocket, string>()
+		private nextPlayId = 1
+
+		/** True if any client is listening to the bus, otherwise playing into it would go unheard */
+		hasListeners(busId: string) {
+			return (this.buses.get(busId)?.clients.length ?? 0) > 0
+		}
+
+		addClient(socket: ExtendedWebsocket, busId: string, codec: StreamCodec) {
+			let bus = this.buses.get(busId)
+			if (!bus) {
+				bus = this.createBus()
+				this.buses.set(busId, bus)
+			}
+
+			bus.clients.push({ socket, codec, droppedFrames: 0 })
+			this.socketBuses.set(socket, busId)
+
+			//Encoding only runs while someone listens, and only into the codecs they asked for
+			this.updateCodecs(bus)
+			bus.stream.start()
+			logger.log("Mix stream listener connected", busId, codec, bus.clients.length)
+		}
+
+		removeClient(socket: ExtendedWebsocket) {
+			const busId = this.socketBuses.get(socket)
+			if (busId == null) return
+			this.socketBuses.delete(socket)
+
+			const bus = this.buses.get(busId)
+			if (!bus) return
+
+			const idx = bus.clients.findIndex((c) => c.socket === socket)
+			if (idx >= 0) bus.clients.splice(idx, 1)
+
+			if (bus.clients.length == 0) {
+				bus.stream.stop()
+			} else {
+				this.updateCodecs(bus)
+			}
+		}
+
+		private updateCodecs(bus: StreamBus) {
+			bus.stream.setCodecs(
+				bus.clients.some((c) => c.codec == "opus"),
+				bus.clients.some((c) => c.codec == "pcm")
+			)
+		}
+
+		private createBus(): StreamBus {
+			const bus: StreamBus = {
+				stream: new MixStream(),
+				clients: [],
+				playing: new Map(),
+				opusFailed: false,
+			}
+
+			bus.stream.on("frame", (frame) => {
+				const now = Date.now()
+				const codec: StreamCodec = (frame[7] & opusFrameFlag) != 0 ? "opus" : "pcm"
+				//Players go by the frame's flags, so Opus listeners can play the PCM fallback too
+				if (codec == "opus") bus.opusFailed = false
+				for (const client of bus.clients) {
+					if (client.codec != codec && !(codec == "pcm" && bus.opusFailed)) continue
+
+					//ws queues per socket, bufferedAmount is that queue. Every socket is sent the same buffer.
+					if (client.socket.bufferedAmount > maxClientBufferedBytes[codec]) {
+						client.droppedFrames++
+						client.droppingSince ??= now
+						if (now - client.droppingSince > maxClientDroppingMs) {
+							logger.log("Dropping slow mix stream listener", client.droppedFrames, "frames behind")
+							client.socket.terminate()
+						}
+						continue
+					}
+
+					client.droppingSince = undefined
+					client.socket.send(frame, { binary: true })
+				}
+			})
+
+			bus.stream.on("encode-error", (message) => {
+				logger.error("Mix stream", message)
+				bus.opusFailed = true
+			})
+
+			bus.stream.on("voice-end", (id) => {
+				const resolve = bus.playing.get(id)
+				bus.playing.delete(id)
+				resolve?.()
+			})
+
+			return bus
+		}
+
+		/** Plays a file into the bus, resolves once it has played out or is aborted */
+		async playFile(
+			busId: string,
+			file: string,
+			startSec: number,
+			endSec: number,
+			volume: number,
+			abortSignal: AbortSignal
+		) {
+			const bus = this.buses.get(busId)
+			if (!bus) return
+
+			//The bus upmixes mono itself, so 48kHz mono or stereo sources play without a decode
+			const decoded = await decodeCached(
+				file,
+				48000,
+				2,
+				(f) => f.sampleRate == 48000 && f.bitsPerSample == 16 && f.channels <= 2
+			)
+			if (abortSignal.aborted) return
+
+			const id = this.nextPlayId++
+			const ended = new Promise<void>((resolve) => bus.playing.set(id, resolve))
+			abortSignal.addEventListener("abort", () => bus.stream.cancel(id), { once: true })
+
+			try {
+				await bus.stream.play(id, decoded, startSec, endSec, volume)
+			} catch (err) {
+				logger.error("Unable to play", file, "into the mix stream", err)
+				bus.playing.delete(id)
+				return
+			}
+
+			await ended
+		}
+
+		shutdown() {
+			for (const bus of this.buses.values()) {
+				bus.stream.stop()
+			}
+		}
+	}
+)
+
+export function setupMixStream() {
+	onLoad(() => {
+		MixStreamService.initialize()
+	})
+
+	onUnload(() => {
+		MixStreamService.getInstance().shutdown()
+	})
+
+	onWebsocketConnection((socket, url) => {
+		if (url.pathname != streamPath) return
+
+		const busId = url.searchParams.get("bus")
+		if (!busId) return
+
+		const codec = url.searchParams.get("codec") == "pcm" ? "pcm" : "opus"
+		MixStreamService.getInstance().addClient(socket, busId, codec)
+	})
+
+	onWebsocketDisconnect((socket) => {
+		MixStreamService.getInstance().removeClient(socket)
+	})
+}
@@ -11,7 +11,7 @@ import {
 	defineSatelliteResourceSlotHandler,
 	SatelliteMedia,
 } from "castmate-core"
-import { AudioDevice, AudioDeviceInterface } from "castmate-plugin-sound-native"
+import { AudioDevice, AudioDeviceInterface, EndpointFormat } from "castmate-plugin-sound-native"
 import { defineCallableIPC, defineIPCRPC } from "castmate-core/src/util/electron"
 import { RendererSoundPlayer } from "./renderer-sound-player"
 import { nanoid } from "nanoid/non-secure"
@@ -25,6 +25,14 @@ export class SoundOutput<
 		console.error("Don't enter here!")
 		return false
 	}
+
+	/**
+	 * Plays files back to back as they arrive without gaps between them.
+	 * Returns false if this output can't, the caller should play the joined file instead.
+	 */
+	async playSegments(segments: AsyncIterable<string>, volume: number, abortSignal: AbortSignal) {
+		return false
+	}
 }
 
 interface SystemSoundOutputConfig extends SoundOutputConfig {
@@ -35,6 +43,9 @@ interface SystemSoundOutputConfig extends SoundOutputConfig {
 }
 
 export class SystemSoundOutput extends SoundOutput<SystemSoundOutputConfig> {
+	/** The device's mix format, segments are scheduled at its rate so the renderer doesn't resample twice */
+	mixFormat?: EndpointFormat
+
 	constructor(mediaDevice: AudioDevice | "chat" | "main", defaultDevice?: AudioDevice) {
 		super()
 		if (typeof mediaDevice == "string") {
@@ -52,6 +63,7 @@ export class SystemSoundOutput extends SoundOutput<SystemSoundOutputConfig> {
 						: `Communications - ${defaultDevice.name}`,
 				webId: id,
 			}
+			this.mixFormat = defaultDevice.format
 		} else {
 			this._id = `system.${mediaDevice.id}`
 			this._config = {
@@ -60,6 +72,7 @@ export class SystemSoundOutput extends SoundOutput<SystemSoundOutputConfig> {
 				deviceId: mediaDevice.id,
 				name: mediaDevice.name,
 			}
+			this.mixFormat = mediaDevice.format
 
 			this.queryWebId()
 		}
@@ -81,6 +94,8 @@ export class SystemSoundOutput extends SoundOutput<SystemSoundOutputConfig> {
 	async setDefault(device: AudioDevice) {
 		if (device.state != "active" || device.type != "output") throw new Error("Default Device Invalid")
 
+		this.mixFormat = device.format
+
 		await this.applyConfig({
 			name: this.id == "system.default" ? `Default - ${device.name}` : `Communications - ${device.name}`,
 		})
@@ -100,7 +115,20 @@ export class SystemSoundOutput extends SoundOutput<SystemSoundOutputConfig> {
 			endSec,
 			volume,
 			this.config.webId,
-			abortSignal
+			abortSignal,
+			this.id
+		)
+		return true
+	}
+
+	async playSegments(segments: AsyncIterable<string>, volume: number, abortSignal: AbortSignal): Promise<boolean> {
+		if (!this.config.webId) return false
+		await RendererSoundPlayer.getInstance().playSegments(
+			segments,
+			volume,
+			this.config.webId,
+			abortSignal,
+			this.mixFormat?.sampleRate
 		)
 		return true
 	}
@@ -238,6 +266,8 @@ export function setupOutput() {
 				if (device.state != "active") {
 					await SoundOutput.storage.remove(existing.id)
 				} else {
+					//Sent when the format changes in the sound control panel too
+					;(existing as SystemSoundOutput).mixFormat = device.format
 					await existing.applyConfig({
 						name: device.name,
 					})
@@ -1,25 +1,78 @@
 import { Service } from "castmate-core"
 import { defineCallableIPC, defineIPCFunc } from "castmate-core/src/util/electron"
 import { nanoid } from "nanoid/non-secure"
+import { LatencyStats } from "castmate-plugin-sound-native"
 
 const playSoundInRenderer = defineCallableIPC<
 	(id: string, file: string, startSec: number, endSec: number, volume: number, sinkId: string) => void
 >("sound", "playSoundInRenderer")
 
+const startSegmentsInRenderer = defineCallableIPC<
+	(id: string, volume: number, sinkId: string, sampleRate?: number) => void
+>("sound", "startSegmentsInRenderer")
+const appendSegmentInRenderer = defineCallableIPC<(id: string, file: string) => void>(
+	"sound",
+	"appendSegmentInRenderer"
+)
+const endSegmentsInRenderer = defineCallableIPC<(id: string) => void>("sound", "endSegmentsInRenderer")
+
 const abortSoundInRenderer = defineCallableIPC<(id: string) => string>("sound", "abortSoundInRenderer")
 
 interface PlayingSound {
 	resolve(): void
+	outputId: string
+	requestedAt: number
+}
+
+//Stage timestamps from the renderer, high resolution epoch milliseconds like preciseNow()
+export interface RendererPlayTimings {
+	received: number
+	loaded: number
+	playRequested: number
+	playing: number
+}
+
+//performance.now() is per process, offsetting by timeOrigin makes main and renderer timestamps comparable.
+function preciseNow() {
+	return performance.timeOrigin + performance.now()
 }
 
 export const RendererSoundPlayer = Service(
 	class {
 		private playingSounds = new Map<string, PlayingSound>()
+		private latency = new LatencyStats()
 
 		constructor() {
 			defineIPCFunc("sound", "soundFinishedInRenderer", (id: string) => {
 				this.resolveSound(id)
 			})
+
+			defineIPCFunc("sound", "soundStartedInRenderer", (id: string, timings: RendererPlayTimings) => {
+				this.recordLatency(id, timings)
+			})
+
+			defineIPCFunc("sound", "getLatencyStats", () => this.getLatencyStats())
+			defineIPCFunc("sound", "resetLatencyStats", (outputId?: string) => this.resetLatencyStats(outputId))
+		}
+
+		private recordLatency(id: string, timings: RendererPlayTimings) {
+			const playing = this.playingSounds.get(id)
+			if (!playing) return
+
+			//Chromium decodes and resamples inside the media pipeline, that time lands in load and start.
+			this.latency.record(playing.outputId, "ipc", timings.received - playing.requestedAt)
+			this.latency.record(playing.outputId, "load", timings.loaded - timings.received)
+			this.latency.record(playing.outputId, "start", timings.playing - timings.playRequested)
+			this.latency.record(playing.outputId, "total", timings.playing - playing.requestedAt)
+		}
+
+		/** Time from a play request to the output actually playing, per output and stage, in milliseconds */
+		getLatencyStats() {
+			return this.latency.getStats()
+		}
+
+		resetLatencyStats(outputId?: string) {
+			this.latency.reset(outputId)
 		}
 
 		private resolveSound(id: string) {
@@ -30,12 +83,22 @@ export const RendererSoundPlayer = Service(
 
 		//TODO: Will this get stuck if you manage to close the window during a sound playing?
 
-		playSound(file: string, startSec: number, endSec: number, volume: number, sinkId: string, abort: AbortSignal) {
+		playSound(
+			file: string,
+			startSec: number,
+			endSec: number,
+			volume: number,
+			sinkId: string,
+			abort: AbortSignal,
+			outputId: string = sinkId
+		) {
 			return new Promise((resolve, reject) => {
 				const id = nanoid()
 
 				this.playingSounds.set(id, {
 					resolve: () => resolve(undefined),
+					outputId,
+					requestedAt: preciseNow(),
 				})
 
 				playSoundInRenderer(id, file, startSec, endSec, volume, sinkId)
@@ -50,5 +113,50 @@ export const RendererSoundPlayer = Service(
 				)
 			})
 		}
+
+		//Segments are scheduled on a single WebAudio timeline in the renderer so they join without gaps.
+		//No latency is recorded, the time to the first segment is synthesis, not the output.
+		playSegments(
+			segments: AsyncIterable<string>,
+			volume: number,
+			sinkId: string,
+			abort: AbortSignal,
+			sampleRate?: number
+		) {
+			return new Promise((resolve) => {
+				const id = nanoid()
+
+				this.playingSounds.set(id, {
+					resolve: () => resolve(undefined),
+					outputId: sinkId,
+					requestedAt: preciseNow(),
+				})
+
+				startSegmentsInRenderer(id, volume, sinkId, sampleRate)
+
+				abort.addEventListener(
+					"abort",
+					() => {
+						abortSoundInRenderer(id)
+						this.resolveSound(id)
+					},
+					{ once: true }
+				)
+
+				const feed = async () => {
+					try {
+						for await (const file of segments) {
+							if (abort.aborted) return
+							appendSegmentInRenderer(id, file)
+						}
+					} finally {
+						endSegmentsInRenderer(id)
+					}
+				}
+
+				//Generation errors surface through the caller's joined promise
+				feed().catch(() => {})
+			})
+		}
 	}
 )
@@ -11,9 +11,11 @@ import {
 import { TTSVoiceConfig, TTSVoiceProviderConfig } from "castmate-plugin-sound-shared"
 import { Schema, SchemaType, declareSchema } from "castmate-schema"
 import { nanoid } from "nanoid/non-secure"
-import { OsTTSInterface, OsTTSVoice } from "castmate-plugin-sound-native"
+import { OsTTSInterface, OsTTSVoice, stretchWav } from "castmate-plugin-sound-native"
 import { app } from "electron"
 import * as path from "path"
+import * as fs from "fs"
+import * as crypto from "crypto"
 
 export class TTSVoiceProvider<
 	ExtendedProviderConfig extends TTSVoiceProviderConfig = TTSVoiceProviderConfig
@@ -25,6 +27,62 @@ export class TTSVoiceProvider<
 	}
 
 	async generate(text: string, voiceConfig: any, filename: string) {}
+
+	/**
+	 * Generates speech as a series of files that play back to back, onSegment is called in playback order.
+	 * Returns the segments joined into a single file. Providers that can't segment produce one segment.
+	 */
+	async generateSegmented(
+		text: string,
+		voiceConfig: any,
+		fileBase: string,
+		onSegment: (file: string) => any
+	): Promise<string | undefined> {
+		const filename = `${fileBase}.wav`
+		await this.generate(text, voiceConfig, filename)
+		onSegment(filename)
+		return filename
+	}
+}
+
+//Hands segment files to a consumer as they're generated
+class SegmentQueue implements AsyncIterable<string> {
+	private files: string[] = []
+	private done = false
+	private wake: (() => void) | undefined
+
+	push(file: string) {
+		this.files.push(file)
+		this.wake?.()
+	}
+
+	end() {
+		this.done = true
+		this.wake?.()
+	}
+
+	async *[Symbol.asyncIterator]() {
+		let next = 0
+		while (true) {
+			if (next < this.files.length) {
+				yield this.files[next++]
+			} else if (this.done) {
+				return
+			} else {
+				await new Promise<void>((resolve) => (this.wake = resolve))
+				this.wake = undefined
+			}
+		}
+	}
+}
+
+export interface TTSSegmentedGeneration {
+	/** Segment files in playback order, available as soon as each is synthesized */
+	segments: AsyncIterable<string>
+	/** Every segment file generated, valid once joined settles */
+	segmentFiles: string[]
+	/** The whole message in one file, for outputs that can't play segments back to back */
+	joined: Promise<string | undefined>
 }
 
 export class TTSVoice extends FileResource<TTSVoiceConfig> {
@@ -59,26 +117,89 @@ export class TTSVoice extends FileResource<TTSVoiceConfig> {
 		await provider.generate(text, this.config.providerConfig, filename)
 		return filename
 	}
+
+	generateSegmented(text: string): TTSSegmentedGeneration | undefined {
+		const provider = TTSVoiceProvider.storage.getById(this.config.voiceProvider)
+		if (!provider) return undefined
+
+		const queue = new SegmentQueue()
+		const segmentFiles: string[] = []
+
+		const joined = (async () => {
+			const cachePath = path.join(app.getPath("temp"), "castmate-tts")
+			await ensureDirectory(cachePath)
+
+			try {
+				return await provider.generateSegmented(
+					text,
+					this.config.providerConfig,
+					path.join(cachePath, nanoid()),
+					(file) => {
+						segmentFiles.push(file)
+						queue.push(file)
+					}
+				)
+			} finally {
+				queue.end()
+			}
+		})()
+
+		return { segments: queue, segmentFiles, joined }
+	}
 }
 
-function escapeXml(unsafe: string) {
-	return unsafe.replace(/[<>&'"]/g, (c) => {
-		switch (c) {
-			case "<":
-				return "&lt;"
-			case ">":
-				return "&gt;"
-			case "&":
-				return "&amp;"
-			case "'":
-				return "&apos;"
-			case '"':
-				return "&quot;"
-		}
-		return c
+//Neutral syntheses keyed by voice and text, every rate and pitch variant is rendered from these
+function neutralCachePath() {
+	return path.join(app.getPath("temp"), "castmate-tts", "neutral")
+}
+
+const neutralCacheLimit = 256
+
+async function pruneNeutralCache() {
+	const dir = neutralCachePath()
+	const files = await fs.promises.readdir(dir)
+	if (files.length <= neutralCacheLimit) return
+
+	const stats = await Promise.all(
+		files.map(async (file) => ({ file, mtime: (await fs.promises.stat(path.join(dir, file))).mtimeMs }))
+	)
+	stats.sort((a, b) => b.mtime - a.mtime)
+
+	for (const old of stats.slice(neutralCacheLimit)) {
+		await fs.promises.rm(path.join(dir, old.file), { force: true })
+	}
+}
+
+function stretchWavFile(input: string, output: string, rate: number, semitones: number) {
+	return new Promise<void>((resolve, reject) => {
+		stretchWav(input, output, rate, semitones, (err) => {
+			if (err) return reject(err)
+			resolve()
+		})
 	})
 }
 
+//SAPI's rate steps are about 3x per 10, pitch steps map +-10 onto +-an octave
+function voiceSpeed(voiceConfig: OSTTSVoiceConfigData) {
+	return Math.pow(3, (voiceConfig.rate ?? 0) / 10)
+}
+
+function voiceSemitones(voiceConfig: OSTTSVoiceConfigData) {
+	return (voiceConfig.pitch ?? 0) * 1.2
+}
+
+function isNeutral(voiceConfig: OSTTSVoiceConfigData) {
+	return !voiceConfig.rate && !voiceConfig.pitch
+}
+
+async function renderVoiceVariant(neutral: string, filename: string, voiceConfig: OSTTSVoiceConfigData) {
+	if (isNeutral(voiceConfig)) {
+		await fs.promises.copyFile(neutral, filename)
+	} else {
+		await stretchWavFile(neutral, filename, voiceSpeed(voiceConfig), voiceSemitones(voiceConfig))
+	}
+}
+
 const OSTTSVoiceConfigSchema = declareSchema({
 	type: Object,
 	properties: {
@@ -112,15 +233,95 @@ export class OSTTSVoiceProvider extends TTSVoiceProvider {
 		})
 	}
 
+	private speakSegmented(text: string, fileBase: string, id: string, onSegment: (file: string) => any) {
+		return new Promise<string>((resolve, reject) => {
+			const queued = this.os_interface.speakSegmented(text, fileBase, id, 0, (...args) => {
+				if (args[0] == "segment") {
+					onSegment(args[2])
+				} else if (args[0] == "done") {
+					resolve(args[2])
+				} else {
+					reject(new Error(args[1]))
+				}
+			})
+
+			if (!queued) reject(new Error(`Unknown voice ${id}`))
+		})
+	}
+
+	private neutralFile(text: string) {
+		const key = crypto.createHash("sha1").update(this.config.providerId).update("\0").update(text).digest("hex")
+		return path.join(neutralCachePath(), `${key}.wav`)
+	}
+
+	//Written beside the cache then renamed in, so a concurrent or failed synthesis never leaves a partial entry
+	private async cacheNeutral(generated: string, neutral: string) {
+		try {
+			await fs.promises.rename(generated, neutral)
+		} catch (err) {
+			//Lost a race with the same message, the entry that won is just as good
+			await fs.promises.rm(generated, { force: true })
+			if (!fs.existsSync(neutral)) throw err
+		}
+		pruneNeutralCache().catch(() => {})
+	}
+
+	async generateSegmented(
+		text: string,
+		voiceConfig: OSTTSVoiceConfigData,
+		fileBase: string,
+		onSegment: (file: string) => any
+	) {
+		const neutral = this.neutralFile(text)
+		if (fs.existsSync(neutral)) {
+			//Rendering a variant of the whole message is far faster than synthesizing its first sentence
+			return await super.generateSegmented(text, voiceConfig, fileBase, onSegment)
+		}
+
+		const neutralBase = path.join(neutralCachePath(), nanoid())
+
+		//Stretches run one at a time so segments still arrive in order
+		let stretching = Promise.resolve()
+		const neutralSegments: string[] = []
+
+		const joinedNeutral = await this.speakSegmented(text, neutralBase, this.config.providerId, (file) => {
+			if (isNeutral(voiceConfig)) {
+				onSegment(file)
+				return
+			}
+
+			neutralSegments.push(file)
+			const stretched = `${fileBase}-${neutralSegments.length - 1}.wav`
+			stretching = stretching.then(async () => {
+				await stretchWavFile(file, stretched, voiceSpeed(voiceConfig), voiceSemitones(voiceConfig))
+				onSegment(stretched)
+			})
+		})
+
+		try {
+			await stretching
+		} finally {
+			for (const file of neutralSegments) {
+				fs.promises.rm(file, { force: true }).catch(() => {})
+			}
+		}
+
+		await this.cacheNeutral(joinedNeutral, neutral)
+
+		const filename = `${fileBase}.wav`
+		await renderVoiceVariant(neutral, filename, voiceConfig)
+		return filename
+	}
+
 	async generate(text: string, voiceConfig: OSTTSVoiceConfigData, filename: string) {
-		const SAPIXml = `<rate absspeed="${voiceConfig.rate ?? 0}">
-		<pitch absmiddle="${voiceConfig.pitch ?? 0}>
-			${escapeXml(text)}
-		</pitch>
-		</rate>
-		`
+		const neutral = this.neutralFile(text)
+		if (!fs.existsSync(neutral)) {
+			const generated = path.join(neutralCachePath(), `${nanoid()}.wav`)
+			await this.speakToFile(text, generated, this.config.providerId)
+			await this.cacheNeutral(generated, neutral)
+		}
 
-		await this.speakToFile(text, filename, this.config.providerId)
+		await renderVoiceVariant(neutral, filename, voiceConfig)
 	}
 
 	getVoiceConfigSchema(): Schema | undefined {
@@ -151,7 +352,8 @@ export function setupTTS() {
 	}
 
 	onLoad(async () => {
-		ensureDirectory(path.join(app.getPath("temp"), "castmate-tts"))
+		await ensureDirectory(path.join(app.getPath("temp"), "castmate-tts"))
+		await ensureDirectory(neutralCachePath())
 		logger.log(`TTS Cache Path: `, path.join(app.getPath("temp"), "castmate-tts"))
 
 		await getOsVoices()
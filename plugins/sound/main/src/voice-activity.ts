@@ -0,0 +1,167 @@
+import {
+	defineSetting,
+	defineTrigger,
+	onLoad,
+	onUnload,
+	onProfilesChanged,
+	onSettingChanged,
+	usePluginLogger,
+} from "castmate-core"
+import { Range } from "castmate-schema"
+import { AudioDeviceInterface, VoiceActivityDetector } from "castmate-plugin-sound-native"
+
+const logger = usePluginLogger("sound")
+
+export function setupVoiceActivity() {
+	const voiceInput = defineSetting("voiceActivityInput", {
+		type: String,
+		name: "Voice Activity Input",
+		enum: ["Default Input", "Communications Input"],
+		required: true,
+		default: "Default Input",
+	})
+
+	const voiceHangover = defineSetting("voiceActivityHangover", {
+		type: Number,
+		name: "Voice Activity Hangover",
+		unit: "ms",
+		required: true,
+		default: 400,
+		min: 100,
+		max: 2000,
+	})
+
+	const speechStarted = defineTrigger({
+		id: "speechStarted",
+		name: "Speech Started",
+		icon: "mdi mdi-account-voice",
+		description: "Someone started talking into the input",
+		config: {
+			type: Object,
+			properties: {
+				minConfidence: {
+					type: Number,
+					name: "Minimum Confidence",
+					slider: true,
+					min: 0,
+					max: 100,
+					required: true,
+					default: 50,
+				},
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				confidence: { type: Number, required: true, default: 100 },
+			},
+		},
+		async handle(config, context) {
+			return context.confidence >= config.minConfidence
+		},
+	})
+
+	const speechEnded = defineTrigger({
+		id: "speechEnded",
+		name: "Speech Ended",
+		icon: "mdi mdi-account-voice-off",
+		description: "The input went quiet after someone talked",
+		config: {
+			type: Object,
+			properties: {
+				minConfidence: {
+					type: Number,
+					name: "Minimum Confidence",
+					slider: true,
+					min: 0,
+					max: 100,
+					required: true,
+					default: 50,
+				},
+				duration: { type: Range, name: "Duration (s)", required: true, default: {} },
+			},
+		},
+		context: {
+			type: Object,
+			properties: {
+				confidence: { type: Number, required: true, default: 100 },
+				duration: { type: Number, required: true, default: 1 },
+			},
+		},
+		async handle(config, context) {
+			if (context.confidence < config.minConfidence) return false
+			return Range.inRange(config.duration, context.duration)
+		},
+	})
+
+	let detector: VoiceActivityDetector | undefined
+	let deviceInterface: AudioDeviceInterface | undefined
+	let hasTriggers = false
+
+	function getDevice() {
+		return voiceInput.value == "Communications Input" ? "chat" : "main"
+	}
+
+	function updateCapture() {
+		if (!detector) return
+
+		//Nothing is captured unless a profile is listening for speech
+		if (!hasTriggers) {
+			detector.stop()
+			return
+		}
+
+		detector.start(getDevice(), { hangoverMs: voiceHangover.value })
+	}
+
+	onLoad(() => {
+		detector = new VoiceActivityDetector()
+		deviceInterface = new AudioDeviceInterface()
+
+		detector.on("speech-start", (confidence) => {
+			speechStarted({ confidence: Math.round(confidence * 100) })
+		})
+
+		detector.on("speech-end", (confidence, durationMs) => {
+			speechEnded({ confidence: Math.round(confidence * 100), duration: durationMs / 1000 })
+		})
+
+		detector.on("error", (message) => {
+			logger.error("Voice activity capture stopped", message)
+		})
+
+		deviceInterface.on("default-input-changed", (type) => {
+			if (type == getDevice()) updateCapture()
+		})
+
+		updateCapture()
+	})
+
+	onUnload(() => {
+		detector?.stop()
+		detector = undefined
+	})
+
+	onSettingChanged(voiceInput, () => {
+		updateCapture()
+	})
+
+	onSettingChanged(voiceHangover, () => {
+		updateCapture()
+	})
+
+	onProfilesChanged((activeProfiles, inactiveProfiles) => {
+		hasTriggers = false
+
+		for (const profile of activeProfiles) {
+			for (const trigger of profile.iterTriggers(speechStarted)) {
+				hasTriggers = true
+			}
+			for (const trigger of profile.iterTriggers(speechEnded)) {
+				hasTriggers = true
+			}
+		}
+
+		updateCapture()
+	})
+}
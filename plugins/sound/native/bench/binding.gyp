@@ -0,0 +1,113 @@
+{
+    "targets": [
+        {
+            # The addon is Windows only, these build the TTS pieces on their own so they can be measured anywhere.
+            # Build with `yarn bench:build`
+            "target_name": "castmate-sound-tts-bench",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17", "-O2" ],
+            "sources": [
+                "tts-bench.cc",
+                "../src/tts-segmenter.cc",
+                "../src/tts-pipeline.cc"
+            ],
+            "include_dirs": [ "../src" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17", "/utf-8" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        },
+        {
+            "target_name": "castmate-sound-stretch-bench",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17", "-O2" ],
+            "sources": [
+                "stretch-bench.cc",
+                "../src/time-stretch.cc",
+                "../src/tts-pipeline.cc"
+            ],
+            "include_dirs": [ "../src" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17", "/utf-8" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        },
+        {
+            "target_name": "castmate-sound-vad-bench",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17", "-O2" ],
+            "sources": [
+                "vad-bench.cc",
+                "../src/voice-activity.cc",
+                "../src/power-spectrum.cc",
+                "../src/tts-pipeline.cc"
+            ],
+            "include_dirs": [ "../src" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17", "/utf-8" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        },
+        {
+            "target_name": "castmate-sound-fingerprint-bench",
+            "type": "executable",
+            "cflags!": [ "-fno-exceptions" ],
+            "cflags_cc!": [ "-fno-exceptions" ],
+            "cflags_cc": [ "-std=c++17", "-O2" ],
+            "sources": [
+                "fingerprint-bench.cc",
+                "../src/audio-fingerprint.cc",
+                "../src/power-spectrum.cc",
+                "../src/voice-activity.cc",
+                "../src/tts-pipeline.cc"
+            ],
+            "include_dirs": [ "../src" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")"
+            ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17", "/utf-8" ]
+                }
+            },
+            "conditions": [
+                ["OS!='win'", {
+                    "libraries": [ "-lpthread" ]
+                }]
+            ]
+        }
+    ]
+}
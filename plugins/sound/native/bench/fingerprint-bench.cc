@@ -0,0 +1,428 @@
+// Audio fingerprint index build cost, matching throughput and accuracy with hundreds of registered clips.
+//
+// Replay: --clips=dir --input=stream.wav
+//   Registers every 16 bit wav in dir, then feeds the stream through in 10ms packets like the capture thread and
+//   prints each match.
+// Synthetic (no --input): registers --clips=300 generated jingles at 44.1kHz and plays some of them into a 48kHz
+//   stream over noise, speech and unregistered jingles at several SNRs. Seeded, exits non zero below the floors.
+//   Below 0dB a clip needs more of itself heard before enough landmarks agree, so the latency floor only applies from
+//   0dB up. Lowering --min-matches under the default lets jingles sharing a couple of notes with a clip match it.
+//
+// Options: --seconds=300 --min-matches=26 --threads=4
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "castmate-native/work-pool.hh"
+
+#include "audio-fingerprint.hh"
+#include "voice-activity.hh"
+#include "tts-pipeline.hh"
+
+#include "synth-voice.hh"
+
+using bench_clock = std::chrono::steady_clock;
+
+static double elapsed_ms(bench_clock::time_point since)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - since).count();
+}
+
+//Notes with a few harmonics and a plucked envelope, chords now and then and a noise hit on some beats.
+//Only depends on time so the same seed gives the same jingle at any sample rate.
+static std::vector<float> synth_jingle(uint32_t sample_rate, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+
+    const double seconds = 1.5 + 4.5 * unit(random);
+    std::vector<float> out(size_t(seconds * sample_rate), 0.0f);
+
+    double t = 0;
+    while (t < seconds - 0.05)
+    {
+        const double length = 0.08 + 0.3 * unit(random);
+        const int voices = unit(random) < 0.3 ? 2 : 1;
+        for (int v = 0; v < voices; ++v)
+        {
+            //Semitones over 200Hz up to about 2kHz
+            const double f0 = 200.0 * std::pow(2.0, std::floor(unit(random) * 40.0) / 12.0);
+            const int harmonics = 2 + int(unit(random) * 3);
+            const double amplitude = 0.15 + 0.15 * unit(random);
+
+            const size_t begin = size_t(t * sample_rate);
+            const size_t end = std::min(out.size(), size_t((t + length) * sample_rate));
+            for (size_t i = begin; i < end; ++i)
+            {
+                const double local = double(i - begin) / sample_rate;
+                const double envelope = std::min(1.0, local * 200.0) * std::exp(-local * 6.0);
+                double sample = 0;
+                for (int h = 1; h <= harmonics; ++h)
+                {
+                    if (f0 * h > 3800.0) break;
+                    sample += std::sin(2.0 * pi * f0 * h * local) / h;
+                }
+                out[i] += float(sample * envelope * amplitude);
+            }
+        }
+
+        if (unit(random) < 0.25)
+        {
+            std::mt19937 hit(seed * 131 + uint32_t(t * 1000));
+            std::normal_distribution<float> noise(0.0f, 0.1f);
+            const size_t begin = size_t(t * sample_rate);
+            const size_t end = std::min(out.size(), begin + sample_rate / 20);
+            for (size_t i = begin; i < end; ++i)
+            {
+                out[i] += noise(hit) * float(std::exp(-double(i - begin) / sample_rate * 60.0));
+            }
+        }
+
+        t += length;
+    }
+    return out;
+}
+
+static double rms(const float* samples, size_t count)
+{
+    double sum = 0;
+    for (size_t i = 0; i < count; ++i) sum += double(samples[i]) * samples[i];
+    return std::sqrt(sum / std::max<size_t>(1, count));
+}
+
+struct placement
+{
+    uint32_t clip;
+    uint64_t start_sample;
+};
+
+struct stream_scene
+{
+    std::vector<float> audio;
+    std::vector<placement> placed;
+};
+
+//Registered clips and unregistered jingles over pink noise with speech now and then, each clip is scaled so it sits
+//snr_db over the background around it
+static stream_scene make_stream(uint32_t sample_rate, double seconds, size_t clip_count, double snr_db, uint32_t seed)
+{
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::normal_distribution<float> white(0.0f, 1.0f);
+
+    stream_scene scene;
+    scene.audio.assign(size_t(seconds * sample_rate), 0.0f);
+
+    //Voss style pink noise is plenty here, a one pole lowpass over white
+    float pink = 0;
+    for (float& sample : scene.audio)
+    {
+        pink = pink * 0.97f + white(random) * 0.03f;
+        sample = pink * 0.5f + white(random) * 0.01f;
+    }
+
+    const std::vector<float> voice = synth_voice(sample_rate, 8.0, 0);
+    for (double at = unit(random) * 10.0; at + 8.0 < seconds; at += 20.0 + unit(random) * 20.0)
+    {
+        const size_t begin = size_t(at * sample_rate);
+        for (size_t i = 0; i < voice.size(); ++i) scene.audio[begin + i] += voice[i] * 2.0f;
+    }
+
+    const double background = rms(scene.audio.data(), scene.audio.size());
+
+    //Alternate registered clips and unregistered jingles with gaps between
+    double at = 1.0 + unit(random);
+    bool registered = true;
+    while (true)
+    {
+        const uint32_t clip = registered ? uint32_t(unit(random) * clip_count) : 100000 + uint32_t(unit(random) * 100000);
+        const std::vector<float> jingle = synth_jingle(sample_rate, clip + 1);
+        if (at + double(jingle.size()) / sample_rate + 1.0 > seconds) break;
+
+        const float gain = float(background * std::pow(10.0, snr_db / 20.0) / std::max(1e-9, rms(jingle.data(), jingle.size())));
+        const size_t begin = size_t(at * sample_rate);
+        for (size_t i = 0; i < jingle.size(); ++i) scene.audio[begin + i] += jingle[i] * gain;
+
+        if (registered) scene.placed.push_back({ clip, begin });
+
+        at += double(jingle.size()) / sample_rate + 1.0 + 3.0 * unit(random);
+        registered = !registered;
+    }
+    return scene;
+}
+
+static std::vector<float> load_mono_wav(const std::string& path, uint32_t& sample_rate, std::string& error)
+{
+    tts_audio_format format;
+    std::vector<uint8_t> pcm;
+    if (!read_wav_file(path, format, pcm, error)) return {};
+    if (format.bits_per_sample != 16 || format.channels == 0)
+    {
+        error = "Only 16 bit wav files are supported";
+        return {};
+    }
+
+    const size_t frames = pcm.size() / 2 / format.channels;
+    std::vector<float> interleaved(frames * format.channels);
+    for (size_t i = 0; i < interleaved.size(); ++i)
+    {
+        interleaved[i] = float(int16_t(pcm[i * 2] | (pcm[i * 2 + 1] << 8))) / 32768.0f;
+    }
+    std::vector<float> mono(frames);
+    vad_downmix(interleaved.data(), frames, format.channels, mono.data());
+
+    sample_rate = format.sample_rate;
+    return mono;
+}
+
+struct clip_audio
+{
+    std::string name;
+    std::vector<float> samples;
+    uint32_t sample_rate;
+};
+
+//Extracts every clip on a work_pool like the addon's index build, then adds them in order
+static void build_index(const std::vector<clip_audio>& clips, work_pool& pool, fingerprint_index& index)
+{
+    std::vector<std::vector<fingerprint_landmark>> landmarks(clips.size());
+    std::vector<uint32_t> frames(clips.size());
+
+    for (size_t i = 0; i < clips.size(); ++i)
+    {
+        pool.submit([&, i]() {
+            landmarks[i] = fingerprint_extractor::extract(clips[i].samples.data(), clips[i].samples.size(), clips[i].sample_rate);
+            frames[i] = uint32_t(clips[i].samples.size() * fingerprint_sample_rate / clips[i].sample_rate / fingerprint_hop);
+        });
+    }
+    pool.wait_idle();
+
+    for (size_t i = 0; i < clips.size(); ++i)
+    {
+        index.add_clip(landmarks[i], frames[i]);
+    }
+    index.finish();
+}
+
+struct run_result
+{
+    std::vector<fingerprint_match> matches;
+    double cpu_ms = 0;
+    double worst_packet_ms = 0;
+};
+
+static run_result run_matcher(const fingerprint_index& index, const std::vector<float>& stream, uint32_t sample_rate, const fingerprint_config& config)
+{
+    run_result result;
+    fingerprint_matcher matcher(index, sample_rate, config);
+
+    const size_t packet = sample_rate / 100;
+    for (size_t start = 0; start < stream.size(); start += packet)
+    {
+        const auto packet_start = bench_clock::now();
+        matcher.process(stream.data() + start, std::min(packet, stream.size() - start), result.matches);
+        const double ms = elapsed_ms(packet_start);
+        result.cpu_ms += ms;
+        result.worst_packet_ms = std::max(result.worst_packet_ms, ms);
+    }
+    return result;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* name, const std::string& detail)
+{
+    printf("  %s %-12s %s\n", ok ? "PASS" : "FAIL", name, detail.c_str());
+    if (!ok) ++failures;
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path;
+    std::string clips_path;
+    size_t clip_count = 300;
+    double seconds = 300;
+    size_t threads = 4;
+    fingerprint_config config;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) arg = arg.substr(2);
+
+        const size_t equals = arg.find('=');
+        const std::string key = arg.substr(0, equals);
+        const std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        if (key == "input") input_path = value;
+        else if (key == "clips")
+        {
+            if (!value.empty() && std::isdigit(static_cast<unsigned char>(value[0]))) clip_count = std::stoul(value);
+            else clips_path = value;
+        }
+        else if (key == "seconds") seconds = std::stod(value);
+        else if (key == "threads") threads = std::max<size_t>(1, std::stoul(value));
+        else if (key == "min-matches") config.min_matches = uint32_t(std::stoul(value));
+    }
+
+    std::vector<clip_audio> clips;
+    if (!clips_path.empty())
+    {
+        for (const auto& entry : std::filesystem::directory_iterator(clips_path))
+        {
+            if (entry.path().extension() != ".wav") continue;
+
+            clip_audio clip;
+            std::string error;
+            clip.name = entry.path().filename().string();
+            clip.samples = load_mono_wav(entry.path().string(), clip.sample_rate, error);
+            if (clip.samples.empty())
+            {
+                fprintf(stderr, "Skipping %s: %s\n", clip.name.c_str(), error.c_str());
+                continue;
+            }
+            clips.push_back(std::move(clip));
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < clip_count; ++i)
+        {
+            clips.push_back({ "jingle " + std::to_string(i), synth_jingle(44100, uint32_t(i + 1)), 44100 });
+        }
+    }
+
+    double clip_seconds = 0;
+    for (const clip_audio& clip : clips) clip_seconds += double(clip.samples.size()) / clip.sample_rate;
+
+    //Started before the clock so thread creation isn't counted
+    work_pool pool(threads);
+
+    fingerprint_index index;
+    const auto build_start = bench_clock::now();
+    build_index(clips, pool, index);
+    const double build_ms = elapsed_ms(build_start);
+
+    printf("index\n");
+    printf("  %zu clips, %.0fs of audio, built in %.0fms on %zu threads (%.0fx realtime per thread)\n",
+        clips.size(), clip_seconds, build_ms, threads, clip_seconds * 1000.0 / (build_ms * threads));
+    printf("  %zu landmarks, %.1f per second of clip, %.2fMB\n",
+        index.landmark_count(), index.landmark_count() / std::max(1.0, clip_seconds), index.memory_bytes() / 1048576.0);
+
+    if (!input_path.empty())
+    {
+        uint32_t sample_rate = 0;
+        std::string error;
+        const std::vector<float> stream = load_mono_wav(input_path, sample_rate, error);
+        if (stream.empty())
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+
+        printf("replay %s, %.1fs at %uHz\n", input_path.c_str(), double(stream.size()) / sample_rate, sample_rate);
+        const run_result result = run_matcher(index, stream, sample_rate, config);
+        for (const fingerprint_match& match : result.matches)
+        {
+            printf("  %9.3fs  %-32s started %9.3fs  confidence %.2f\n", double(match.detected_sample) / sample_rate,
+                clips[match.clip].name.c_str(), double(match.start_sample) / sample_rate, match.confidence);
+        }
+
+        const double stream_seconds = double(stream.size()) / sample_rate;
+        printf("  %.1fx realtime, %.3f%% of a core, worst 10ms packet %.2fms\n",
+            stream_seconds * 1000.0 / result.cpu_ms, result.cpu_ms / (stream_seconds * 10.0), result.worst_packet_ms);
+        return 0;
+    }
+
+    struct case_result
+    {
+        const char* name;
+        double snr;
+        double min_recall;
+    };
+
+    //Clip level over the background around it
+    static const case_result cases[] = {
+        { "clean 20dB", 20, 0.98 },
+        { "10dB", 10, 0.95 },
+        { "0dB", 0, 0.80 },
+        { "-5dB", -5, 0.5 },
+    };
+
+    const uint32_t stream_rate = 48000;
+    printf("matching, %.0fs 48kHz streams against clips registered at 44.1kHz\n", seconds);
+
+    for (const case_result& c : cases)
+    {
+        const stream_scene scene = make_stream(stream_rate, seconds, clips.size(), c.snr, 7);
+        const run_result result = run_matcher(index, scene.audio, stream_rate, config);
+
+        size_t found = 0;
+        std::vector<double> latencies;
+        std::vector<bool> used(result.matches.size(), false);
+        for (const placement& placed : scene.placed)
+        {
+            for (size_t m = 0; m < result.matches.size(); ++m)
+            {
+                const fingerprint_match& match = result.matches[m];
+                const double start_error = std::abs(double(match.start_sample) - double(placed.start_sample)) / stream_rate;
+                if (used[m] || match.clip != placed.clip || start_error > 0.05) continue;
+
+                used[m] = true;
+                ++found;
+                latencies.push_back(double(match.detected_sample - placed.start_sample) * 1000.0 / stream_rate);
+                break;
+            }
+        }
+        const size_t false_matches = size_t(std::count(used.begin(), used.end(), false));
+
+        std::sort(latencies.begin(), latencies.end());
+        const double p50 = latencies.empty() ? 0 : latencies[latencies.size() / 2];
+        const double p90 = latencies.empty() ? 0 : latencies[latencies.size() * 9 / 10];
+        const double recall = scene.placed.empty() ? 1.0 : double(found) / double(scene.placed.size());
+
+        printf("  %-10s recall %5.1f%% (%zu/%zu)  false matches %zu  latency p50 %5.0fms p90 %5.0fms  %6.1fx realtime  %.3f%% of a core  worst packet %.2fms\n",
+            c.name, recall * 100.0, found, scene.placed.size(), false_matches, p50, p90,
+            seconds * 1000.0 / result.cpu_ms, result.cpu_ms / (seconds * 10.0), result.worst_packet_ms);
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "recall %.1f%%, %zu false", recall * 100.0, false_matches);
+        check(recall >= c.min_recall && false_matches == 0, c.name, detail);
+        if (c.snr >= 0)
+        {
+            snprintf(detail, sizeof(detail), "p90 %.0fms", p90);
+            check(p90 <= 1500.0, "latency", detail);
+        }
+    }
+
+    //The threaded path has to find the same clips as the direct one
+    {
+        const stream_scene scene = make_stream(stream_rate, 60.0, clips.size(), 10, 11);
+        const run_result direct = run_matcher(index, scene.audio, stream_rate, config);
+
+        std::mutex found_mutex;
+        std::vector<fingerprint_match> threaded;
+        fingerprint_worker worker(index, stream_rate, config, [&](const fingerprint_match& match) {
+            std::lock_guard<std::mutex> lock(found_mutex);
+            threaded.push_back(match);
+        }, 60000);
+
+        const size_t packet = stream_rate / 100;
+        for (size_t start = 0; start < scene.audio.size(); start += packet)
+        {
+            worker.push(scene.audio.data() + start, std::min(packet, scene.audio.size() - start));
+        }
+        worker.drain();
+
+        char detail[128];
+        snprintf(detail, sizeof(detail), "%zu matches threaded, %zu direct", threaded.size(), direct.matches.size());
+        check(threaded.size() == direct.matches.size(), "worker", detail);
+    }
+
+    return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,25 @@
+// Runs one of the native benchmarks, build first with `yarn bench:build`
+//   yarn bench tts --backend=espeak|synthetic --voice=en --threads=4 --runs=5 --text="..."
+//   yarn bench stretch --input=speech.wav --write=dir --seconds=30
+//   yarn bench vad --input=mic.wav --labels=mic.txt --frame-ms=10 --features
+//   yarn bench fingerprint --clips=300 --seconds=300 --threads=4 --min-matches=26
+//   yarn bench fingerprint --clips=dir --input=stream.wav
+// The overlay mix stream is measured from the outside with a websocket client, see stream-client.js
+
+const path = require("path")
+const { spawnSync } = require("child_process")
+
+const benches = ["tts", "stretch", "vad", "fingerprint"]
+
+const args = process.argv.slice(2)
+const bench = benches.includes(args[0]) ? args.shift() : "tts"
+
+const executable = `castmate-sound-${bench}-bench${process.platform == "win32" ? ".exe" : ""}`
+const binary = path.join(__dirname, "build", "Release", executable)
+
+const result = spawnSync(binary, args, { stdio: "inherit" })
+if (result.error) {
+	console.error(`Unable to run ${binary}: ${result.error.message}`)
+	process.exit(1)
+}
+process.exit(result.status ?? 0)
@@ -0,0 +1,79 @@
+// Listens to a mix stream like an overlay would and reports what arrives, CastMate has to be running
+//   node bench/stream-client.js --bus=overlay.<overlayId> --port=8181 --seconds=30
+//   Several clients at once: --clients=20
+//   The PCM fallback instead of Opus: --codec=pcm, peak level is only measured for PCM
+
+const WebSocket = globalThis.WebSocket ?? require("ws")
+
+const options = { bus: "", port: 8181, seconds: 30, clients: 1, codec: "opus" }
+for (const arg of process.argv.slice(2)) {
+	const match = /^--([^=]+)=(.*)$/.exec(arg)
+	if (!match || !(match[1] in options)) {
+		console.error(`Unknown argument ${arg}`)
+		process.exit(1)
+	}
+	options[match[1]] = typeof options[match[1]] == "number" ? Number(match[2]) : match[2]
+}
+
+if (!options.bus) {
+	console.error("--bus is required, overlays listen on overlay.<overlayId>")
+	process.exit(1)
+}
+
+function percentile(sorted, p) {
+	if (sorted.length == 0) return 0
+	return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))]
+}
+
+function listen(index) {
+	const stats = { frames: 0, bytes: 0, gaps: 0, resyncs: 0, peak: 0, intervals: [], lastSequence: -1, lastArrival: 0 }
+	const codec = options.codec == "pcm" ? "&codec=pcm" : ""
+	const socket = new WebSocket(`ws://localhost:${options.port}/sound/stream?bus=${encodeURIComponent(options.bus)}${codec}`)
+	socket.binaryType = "arraybuffer"
+
+	socket.addEventListener("message", (ev) => {
+		const data = ev.data instanceof ArrayBuffer ? ev.data : ev.data.buffer.slice(ev.data.byteOffset, ev.data.byteOffset + ev.data.byteLength)
+		const view = new DataView(data)
+		const sequence = view.getUint32(0, true)
+		const frames = view.getUint16(4, true)
+		const channels = view.getUint8(6)
+		const flags = view.getUint8(7)
+
+		const now = performance.now()
+		if (flags & 1) {
+			stats.resyncs++
+		} else if (stats.lastArrival > 0) {
+			stats.intervals.push(now - stats.lastArrival)
+		}
+		if (stats.lastSequence >= 0 && sequence != stats.lastSequence + 1) stats.gaps++
+		stats.lastSequence = sequence
+		stats.lastArrival = now
+
+		if (!(flags & 2)) {
+			const samples = new Int16Array(data, 8, frames * channels)
+			for (const sample of samples) stats.peak = Math.max(stats.peak, Math.abs(sample) / 32768)
+		}
+
+		stats.frames++
+		stats.bytes += data.byteLength
+	})
+
+	socket.addEventListener("error", (err) => console.error(`client ${index}: ${err.message ?? err}`))
+
+	return { socket, stats }
+}
+
+const listeners = Array.from({ length: options.clients }, (_, i) => listen(i))
+
+setTimeout(() => {
+	for (const [i, { socket, stats }] of listeners.entries()) {
+		const sorted = stats.intervals.sort((a, b) => a - b)
+		console.log(
+			`client ${i}: ${stats.frames} frames ${(stats.bytes / 1024).toFixed(0)}KB ` +
+				`gaps ${stats.gaps} resyncs ${stats.resyncs} peak ${(20 * Math.log10(Math.max(stats.peak, 1e-6))).toFixed(1)}dBFS ` +
+				`arrival p50 ${percentile(sorted, 0.5).toFixed(1)}ms p99 ${percentile(sorted, 0.99).toFixed(1)}ms max ${(sorted.at(-1) ?? 0).toFixed(1)}ms`
+		)
+		socket.close()
+	}
+	process.exit(0)
+}, options.seconds * 1000)
@@ -0,0 +1,241 @@
+// Time-stretch and pitch-shift CPU cost per voice, plus quality checks on speech-like audio.
+//
+// Without --input a synthetic voice is used: glottal pulses through vowel formants with pauses between syllables.
+// Quality checks exit non zero on failure:
+//   passthrough  rate 1 and pitch 0 is bit exact
+//   duration     output length is input length / rate
+//   pitch        a steady vowel's f0 follows the pitch shift and ignores the rate
+//   phase        a sine keeps a flat envelope, joins that don't line up in phase cancel and dip
+//
+// Options: --input=speech.wav (16 bit mono) --write=dir (writes each variant) --seconds=30
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "time-stretch.hh"
+#include "tts-pipeline.hh"
+
+#include "synth-voice.hh"
+
+using bench_clock = std::chrono::steady_clock;
+
+struct variant
+{
+    double rate;
+    double semitones;
+};
+
+static const variant variants[] = {
+    { 1.0, 0 }, { 1.5, 0 }, { 0.75, 0 }, { 1.0, 4 }, { 1.0, -4 }, { 1.3, 3 }, { 0.8, -2 },
+};
+
+static std::vector<float> run_stretch(const std::vector<float>& input, uint32_t sample_rate, double rate, double semitones)
+{
+    time_stretch stretcher(sample_rate);
+    stretcher.set_rate(rate);
+    stretcher.set_pitch_semitones(semitones);
+
+    std::vector<float> output;
+    output.reserve(size_t(input.size() / rate) + 4096);
+    for (size_t start = 0; start < input.size(); start += 4096)
+    {
+        stretcher.process(input.data() + start, std::min<size_t>(4096, input.size() - start), output);
+    }
+    stretcher.flush(output);
+    return output;
+}
+
+//Autocorrelation pitch over the middle of the signal
+static double estimate_f0(const std::vector<float>& signal, uint32_t sample_rate)
+{
+    const size_t window = sample_rate / 5;
+    const size_t start = signal.size() / 2 - window / 2;
+    const size_t min_lag = sample_rate / 500;
+    const size_t max_lag = sample_rate / 50;
+
+    double best = -1e30;
+    size_t best_lag = min_lag;
+    for (size_t lag = min_lag; lag <= max_lag; ++lag)
+    {
+        const double score = time_stretch_dot(signal.data() + start, signal.data() + start + lag, window);
+        if (score > best)
+        {
+            best = score;
+            best_lag = lag;
+        }
+    }
+
+    //Parabolic refinement between neighbouring lags
+    const double l = time_stretch_dot(signal.data() + start, signal.data() + start + best_lag - 1, window);
+    const double r = time_stretch_dot(signal.data() + start, signal.data() + start + best_lag + 1, window);
+    const double denom = l - 2.0 * best + r;
+    const double shift = denom != 0 ? 0.5 * (l - r) / denom : 0;
+    return sample_rate / (double(best_lag) + shift);
+}
+
+//Smallest over largest RMS of windows a whole number of periods long, 1 is a perfectly flat envelope
+static double envelope_flatness(const std::vector<float>& signal, double period, size_t skip)
+{
+    const size_t window = size_t(std::lround(period * 3));
+    double smallest = 1e30;
+    double largest = 0;
+    for (size_t start = skip; start + window + skip < signal.size(); start += window / 4)
+    {
+        const double rms = std::sqrt(time_stretch_dot(signal.data() + start, signal.data() + start, window) / window);
+        smallest = std::min(smallest, rms);
+        largest = std::max(largest, rms);
+    }
+    return largest > 0 ? smallest / largest : 0;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* name, const std::string& detail)
+{
+    printf("  %s %-12s %s\n", ok ? "PASS" : "FAIL", name, detail.c_str());
+    if (!ok) ++failures;
+}
+
+static std::string format(const char* fmt, double a, double b, double c = 0)
+{
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), fmt, a, b, c);
+    return buffer;
+}
+
+static void quality_checks(uint32_t sample_rate)
+{
+    printf("quality\n");
+
+    const std::vector<float> voice = synth_voice(sample_rate, 4.0, 0);
+    const std::vector<float> identity = run_stretch(voice, sample_rate, 1.0, 0);
+    check(identity == voice, "passthrough", identity == voice ? "bit exact" : "output differs");
+
+    for (const variant& v : variants)
+    {
+        const std::vector<float> out = run_stretch(voice, sample_rate, v.rate, v.semitones);
+        const double expected = voice.size() / v.rate;
+        check(std::abs(double(out.size()) - expected) <= 1.0,
+            "duration", format("rate %.2f pitch %+.0f: %.0f samples", v.rate, v.semitones, double(out.size())));
+    }
+
+    //Steady 120Hz vowel so the estimate isn't chasing the intonation
+    const std::vector<float> steady = synth_voice(sample_rate, 4.0, 120.0);
+    for (const variant& v : variants)
+    {
+        const std::vector<float> out = run_stretch(steady, sample_rate, v.rate, v.semitones);
+        const double expected = 120.0 * std::pow(2.0, v.semitones / 12.0);
+        const double f0 = estimate_f0(out, sample_rate);
+        check(std::abs(f0 - expected) / expected < 0.03,
+            "pitch", format("rate %.2f pitch %+.0f: %.1fHz", v.rate, v.semitones, f0) + format(" expected %.1fHz", expected, 0));
+    }
+
+    std::vector<float> sine(sample_rate * 2);
+    for (size_t i = 0; i < sine.size(); ++i)
+    {
+        sine[i] = float(0.5 * std::sin(2.0 * pi * 220.0 * double(i) / sample_rate));
+    }
+    for (const variant& v : variants)
+    {
+        const std::vector<float> out = run_stretch(sine, sample_rate, v.rate, v.semitones);
+        const double period = sample_rate / (220.0 * std::pow(2.0, v.semitones / 12.0));
+        const double flatness = envelope_flatness(out, period, sample_rate / 20);
+        check(flatness > 0.95, "phase", format("rate %.2f pitch %+.0f: envelope flatness %.3f", v.rate, v.semitones, flatness));
+    }
+}
+
+static void write_variant(const std::string& dir, const std::vector<float>& samples, uint32_t sample_rate, const variant& v)
+{
+    std::vector<int16_t> pcm(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        pcm[i] = int16_t(std::clamp(std::lround(samples[i] * 32768.0f), -32768L, 32767L));
+    }
+
+    char name[128];
+    snprintf(name, sizeof(name), "/stretch-r%.2f-p%+.0f.wav", v.rate, v.semitones);
+    wav_writer::write_file(dir + name, { sample_rate, 1, 16 },
+        std::vector<uint8_t>(reinterpret_cast<const uint8_t*>(pcm.data()), reinterpret_cast<const uint8_t*>(pcm.data() + pcm.size())));
+}
+
+int main(int argc, char** argv)
+{
+    std::string input_path;
+    std::string write_dir;
+    double seconds = 30;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) arg = arg.substr(2);
+
+        const size_t equals = arg.find('=');
+        const std::string key = arg.substr(0, equals);
+        const std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        if (key == "input") input_path = value;
+        else if (key == "write") write_dir = value;
+        else if (key == "seconds") seconds = std::stod(value);
+    }
+
+    uint32_t sample_rate = 22050;
+    std::vector<float> speech;
+
+    if (!input_path.empty())
+    {
+        tts_audio_format format;
+        std::vector<uint8_t> pcm;
+        std::string error;
+        if (!read_wav_file(input_path, format, pcm, error))
+        {
+            fprintf(stderr, "%s\n", error.c_str());
+            return 1;
+        }
+        if (format.channels != 1 || format.bits_per_sample != 16)
+        {
+            fprintf(stderr, "Only 16 bit mono wav files are supported\n");
+            return 1;
+        }
+
+        sample_rate = format.sample_rate;
+        speech.resize(pcm.size() / 2);
+        for (size_t i = 0; i < speech.size(); ++i)
+        {
+            speech[i] = float(int16_t(pcm[i * 2] | (pcm[i * 2 + 1] << 8))) / 32768.0f;
+        }
+    }
+    else
+    {
+        speech = synth_voice(sample_rate, seconds, 0);
+    }
+
+    const double input_seconds = double(speech.size()) / sample_rate;
+    printf("cpu per voice, %.1fs of %s at %uHz\n", input_seconds, input_path.empty() ? "synthetic speech" : input_path.c_str(), sample_rate);
+
+    for (const variant& v : variants)
+    {
+        //Best of three, the first run pays for page faults
+        double best_ms = 1e30;
+        std::vector<float> out;
+        for (int run = 0; run < 3; ++run)
+        {
+            const auto start = bench_clock::now();
+            out = run_stretch(speech, sample_rate, v.rate, v.semitones);
+            best_ms = std::min(best_ms, std::chrono::duration<double, std::milli>(bench_clock::now() - start).count());
+        }
+
+        const double output_seconds = double(out.size()) / sample_rate;
+        printf("  rate %.2f pitch %+3.0f   %8.2fms   %7.1fx realtime   %5.2f%% of a core per playing voice\n",
+            v.rate, v.semitones, best_ms, output_seconds * 1000.0 / best_ms, best_ms / (output_seconds * 10.0));
+
+        if (!write_dir.empty()) write_variant(write_dir, out, sample_rate, v);
+    }
+
+    quality_checks(22050);
+
+    return failures > 0 ? 1 : 0;
+}
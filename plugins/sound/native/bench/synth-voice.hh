@@ -0,0 +1,56 @@
+#pragma once
+
+//Speech-like test signal shared by the benches, no recordings ship with the repo
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+static const double pi = 3.14159265358979323846;
+
+//Glottal pulses through two pole resonators at rough /a/ /i/ /u/ formants, four syllables a second with a short
+//pause after each. An f0_base of 0 gives a gently wandering intonation instead of a fixed pitch.
+inline std::vector<float> synth_voice(uint32_t sample_rate, double seconds, double f0_base)
+{
+    static const double vowels[3][3] = { { 730, 1090, 2440 }, { 270, 2290, 3010 }, { 300, 870, 2240 } };
+
+    std::vector<float> out(size_t(seconds * sample_rate), 0.0f);
+    double phase = 0;
+    double state[3][2] = {};
+
+    const size_t syllable = sample_rate / 4;
+    for (size_t i = 0; i < out.size(); ++i)
+    {
+        const size_t index = i / syllable;
+        const size_t within = i % syllable;
+        //Last fifth of every syllable is a pause
+        if (within > syllable * 4 / 5)
+        {
+            out[i] = 0;
+            continue;
+        }
+
+        const double f0 = f0_base == 0 ? 110.0 + 20.0 * std::sin(double(i) / sample_rate * 2.0) : f0_base;
+        phase += f0 / sample_rate;
+        double excitation = 0;
+        if (phase >= 1.0)
+        {
+            phase -= 1.0;
+            excitation = 1.0;
+        }
+
+        const double* formants = vowels[index % 3];
+        double sample = 0;
+        for (int f = 0; f < 3; ++f)
+        {
+            const double r = 0.97;
+            const double theta = 2.0 * pi * formants[f] / sample_rate;
+            const double y = excitation + 2.0 * r * std::cos(theta) * state[f][0] - r * r * state[f][1];
+            state[f][1] = state[f][0];
+            state[f][0] = y;
+            sample += y / (f + 1);
+        }
+        out[i] = float(sample * 0.02);
+    }
+    return out;
+}
@@ -0,0 +1,288 @@
+// TTS time to first audio and total wall time, one Speak of the whole message against the segmented pipeline.
+//
+// Backends:
+//   espeak     one espeak-ng process per segment (each is its own voice instance), Linux and macOS
+//   synthetic  fixed startup cost plus a per character cost, for machines without a voice installed
+//
+// Options: --backend=espeak|synthetic --voice=en --threads=0 --runs=5 --text="..."
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+extern char** environ;
+#endif
+
+#include "tts-pipeline.hh"
+#include "tts-segmenter.hh"
+
+using bench_clock = std::chrono::steady_clock;
+
+static const char* default_text =
+    "Thank you so much for the five hundred bits! I have been saving up for this for weeks, and I finally get to say it "
+    "on stream: you are all absolutely incredible. Please keep being kind to each other in chat, and remember to drink "
+    "some water tonight. Also, the streamer still owes me a rematch from last Tuesday; I have not forgotten, and I "
+    "will be back to collect. Good luck on the next run, you have got this!";
+
+struct bench_options
+{
+    std::string backend = "espeak";
+    std::string voice = "en";
+    std::string text = default_text;
+    size_t threads = 0;
+    int runs = 5;
+};
+
+static std::wstring widen(const std::string& text)
+{
+    //Bench input is ASCII
+    return std::wstring(text.begin(), text.end());
+}
+
+static std::string narrow(const std::wstring& text)
+{
+    std::string result;
+    result.reserve(text.size());
+    for (wchar_t c : text) result.push_back(c < 0x80 ? char(c) : '?');
+    return result;
+}
+
+class synthetic_backend : public tts_backend
+{
+public:
+    bool synthesize(const std::wstring& text, std::vector<uint8_t>& pcm, std::string& error) override
+    {
+        //Roughly SAPI's shape, a startup cost then about 25x faster than real time
+        const double speech_seconds = text.size() / 14.0;
+        std::this_thread::sleep_for(std::chrono::duration<double>(0.03 + speech_seconds / 25.0));
+        pcm.resize(pcm.size() + size_t(speech_seconds * 22050) * 2, 0);
+        return true;
+    }
+};
+
+#ifndef _WIN32
+class espeak_backend : public tts_backend
+{
+public:
+    explicit espeak_backend(const std::string& voice) : voice(voice) {}
+
+    bool synthesize(const std::wstring& text, std::vector<uint8_t>& pcm, std::string& error) override
+    {
+        int pipe_fds[2];
+        if (pipe(pipe_fds) != 0)
+        {
+            error = "pipe failed";
+            return false;
+        }
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, pipe_fds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, pipe_fds[0]);
+
+        const std::string utterance = narrow(text);
+        //-m reads SSML, so the segmenter's balanced tags reach the voice intact
+        std::vector<char*> argv = {
+            const_cast<char*>("espeak-ng"), const_cast<char*>("-m"), const_cast<char*>("--stdout"),
+            const_cast<char*>("-v"), const_cast<char*>(voice.c_str()), const_cast<char*>(utterance.c_str()), nullptr,
+        };
+
+        pid_t pid;
+        const int spawned = posix_spawnp(&pid, "espeak-ng", &actions, nullptr, argv.data(), environ);
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipe_fds[1]);
+
+        if (spawned != 0)
+        {
+            close(pipe_fds[0]);
+            error = "Unable to run espeak-ng, is it installed?";
+            return false;
+        }
+
+        std::vector<uint8_t> wav;
+        uint8_t buffer[65536];
+        ssize_t got;
+        while ((got = read(pipe_fds[0], buffer, sizeof(buffer))) > 0)
+        {
+            wav.insert(wav.end(), buffer, buffer + got);
+        }
+        close(pipe_fds[0]);
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        {
+            error = "espeak-ng failed";
+            return false;
+        }
+
+        //espeak-ng streams a 22050Hz 16 bit mono wav, keep what follows the data chunk header
+        for (size_t i = 12; i + 8 <= wav.size(); ++i)
+        {
+            if (memcmp(wav.data() + i, "data", 4) == 0)
+            {
+                pcm.insert(pcm.end(), wav.begin() + i + 8, wav.end());
+                return true;
+            }
+        }
+
+        error = "espeak-ng output has no data chunk";
+        return false;
+    }
+
+private:
+    std::string voice;
+};
+#endif
+
+static tts_backend_factory make_factory(const bench_options& options)
+{
+#ifndef _WIN32
+    if (options.backend == "espeak")
+    {
+        const std::string voice = options.voice;
+        return [voice](std::string& error) -> std::unique_ptr<tts_backend> {
+            return std::make_unique<espeak_backend>(voice);
+        };
+    }
+#endif
+    return [](std::string& error) -> std::unique_ptr<tts_backend> {
+        return std::make_unique<synthetic_backend>();
+    };
+}
+
+struct run_result
+{
+    double first_audio_ms = 0;
+    double total_ms = 0;
+    double audio_seconds = 0;
+};
+
+static double ms_since(bench_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(bench_clock::now() - start).count();
+}
+
+static bool run_single(const bench_options& options, run_result& result)
+{
+    std::string error;
+    const auto start = bench_clock::now();
+
+    auto backend = make_factory(options)(error);
+    std::vector<uint8_t> pcm;
+    if (!backend || !backend->synthesize(widen(options.text), pcm, error))
+    {
+        fprintf(stderr, "single call failed: %s\n", error.c_str());
+        return false;
+    }
+
+    //Nothing can play until the whole utterance exists
+    result.total_ms = ms_since(start);
+    result.first_audio_ms = result.total_ms;
+    result.audio_seconds = pcm.size() / 2 / 22050.0;
+    return true;
+}
+
+static bool run_segmented(const bench_options& options, tts_pipeline& pipeline, run_result& result, size_t& segment_count)
+{
+    std::string error;
+    const auto start = bench_clock::now();
+
+    const std::vector<std::wstring> segments = segment_tts_text(widen(options.text));
+    segment_count = segments.size();
+
+    size_t samples = 0;
+    const bool ok = pipeline.run(options.backend + ":" + options.voice, make_factory(options), segments, [&](size_t index, const std::vector<uint8_t>& pcm) {
+        if (index == 0) result.first_audio_ms = ms_since(start);
+        samples += pcm.size() / 2;
+    }, error);
+
+    if (!ok)
+    {
+        fprintf(stderr, "segmented failed: %s\n", error.c_str());
+        return false;
+    }
+
+    result.total_ms = ms_since(start);
+    result.audio_seconds = samples / 22050.0;
+    return true;
+}
+
+static double median(std::vector<double> values)
+{
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+static void report(const char* name, const std::vector<run_result>& results)
+{
+    std::vector<double> first;
+    std::vector<double> total;
+    for (const run_result& result : results)
+    {
+        first.push_back(result.first_audio_ms);
+        total.push_back(result.total_ms);
+    }
+
+    printf("  %-10s first audio %8.1fms   total %8.1fms   audio %6.2fs\n", name, median(first), median(total),
+        results.empty() ? 0.0 : results.front().audio_seconds);
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if (arg.rfind("--", 0) == 0) arg = arg.substr(2);
+
+        const size_t equals = arg.find('=');
+        const std::string key = arg.substr(0, equals);
+        const std::string value = equals == std::string::npos ? "" : arg.substr(equals + 1);
+
+        if (key == "backend") options.backend = value;
+        else if (key == "voice") options.voice = value;
+        else if (key == "text") options.text = value;
+        else if (key == "threads") options.threads = size_t(std::stoul(value));
+        else if (key == "runs") options.runs = std::max(1, std::stoi(value));
+    }
+
+#ifdef _WIN32
+    if (options.backend == "espeak") options.backend = "synthetic";
+#endif
+
+    //One pipeline for every run like the addon keeps, so the first run creates the voices and later runs reuse them
+    tts_pipeline pipeline(options.threads);
+    printf("%s backend, %zu characters, %zu threads, median of %d runs\n", options.backend.c_str(), options.text.size(),
+        pipeline.threads(), options.runs);
+
+    std::vector<run_result> single_results;
+    std::vector<run_result> segmented_results;
+    size_t segment_count = 0;
+
+    for (int run = 0; run < options.runs; ++run)
+    {
+        run_result single;
+        if (!run_single(options, single)) return 1;
+        single_results.push_back(single);
+
+        run_result segmented;
+        if (!run_segmented(options, pipeline, segmented, segment_count)) return 1;
+        segmented_results.push_back(segmented);
+    }
+
+    report("single", single_results);
+    report("segmented", segmented_results);
+    printf("  %zu segments\n", segment_count);
+    return 0;
+}
@@ -1,13 +1,28 @@
 {
+    "variables": {
+        # libopus comes from @discordjs/opus's gyp build of it rather than a second copy in this repo.
+        "discord_opus_dir": "<!(node -p \"require('path').dirname(require.resolve('@discordjs/opus/package.json'))\")",
+    },
     "targets": [
         {
             "target_name": "castmate-plugin-sound-native",
             "cflags!": [ "-fno-exceptions" ],
             "cflags_cc!": [ "-fno-exceptions" ],
-            "sources": [ "src/native-index.cc", "src/util.cc", "src/audio-interface.cc", "src/tts-interface.cc" ],
+            "cflags_cc": [ "-std=c++17" ],
+            "sources": [ "src/native-index.cc", "src/audio-interface.cc", "src/tts-interface.cc", "src/latency-histogram.cc", "src/latency-stats.cc", "src/tts-segmenter.cc", "src/tts-pipeline.cc", "src/time-stretch.cc", "src/time-stretch-bindings.cc", "src/voice-activity.cc", "src/power-spectrum.cc", "src/voice-activity-capture.cc", "src/audio-capture.cc", "src/audio-fingerprint.cc", "src/audio-fingerprint-bindings.cc", "src/mix-stream.cc", "src/mix-stream-bindings.cc", "src/endpoint-volume.cc", "src/endpoint-format.cc" ],
+            "dependencies": [
+                "<!(node -p \"require('castmate-native-core').gyp\")",
+                "<(discord_opus_dir)/deps/binding.gyp:libopus"
+            ],
             "include_dirs": [
-                "<!@(node -p \"require('node-addon-api').include\")"
+                "<!@(node -p \"require('node-addon-api').include\")",
+                "<(discord_opus_dir)/deps/opus/include"
             ],
+            "msvs_settings": {
+                "VCCLCompilerTool": {
+                    "AdditionalOptions": [ "/std:c++17", "/utf-8" ]
+                }
+            },
             "defines": [ "NAPI_DISABLE_CPP_EXCEPTIONS=1" ],
         }
     ]
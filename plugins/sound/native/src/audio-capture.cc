@@ -0,0 +1,223 @@
+#include "audio-capture.hh"
+#include "voice-activity.hh"
+#include "castmate-native/errors.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <comdef.h>
+#include <wrl.h>
+#include <mmdeviceapi.h>
+#include <audioclient.h>
+#include <mmreg.h>
+#include <ksmedia.h>
+
+using namespace Microsoft::WRL;
+
+//Shared mode buffer, the capture thread wakes on every device period well inside this
+static const REFERENCE_TIME capture_buffer_duration = 200 * 10000;
+
+enum class capture_sample_type
+{
+    float32,
+    int16,
+    int32,
+};
+
+static bool get_sample_type(const WAVEFORMATEX* format, capture_sample_type& type)
+{
+    WORD tag = format->wFormatTag;
+    if (tag == WAVE_FORMAT_EXTENSIBLE)
+    {
+        const WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(format);
+        if (IsEqualGUID(extensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT)) tag = WAVE_FORMAT_IEEE_FLOAT;
+        else if (IsEqualGUID(extensible->SubFormat, KSDATAFORMAT_SUBTYPE_PCM)) tag = WAVE_FORMAT_PCM;
+    }
+
+    if (tag == WAVE_FORMAT_IEEE_FLOAT && format->wBitsPerSample == 32)
+    {
+        type = capture_sample_type::float32;
+        return true;
+    }
+    if (tag == WAVE_FORMAT_PCM && format->wBitsPerSample == 16)
+    {
+        type = capture_sample_type::int16;
+        return true;
+    }
+    if (tag == WAVE_FORMAT_PCM && format->wBitsPerSample == 32)
+    {
+        //Also covers 24 bit samples in 32 bit containers, they're left aligned
+        type = capture_sample_type::int32;
+        return true;
+    }
+    return false;
+}
+
+audio_capture::audio_capture()
+{
+    stop_event = ::CreateEventW(nullptr, TRUE, FALSE, nullptr);
+}
+
+audio_capture::~audio_capture()
+{
+    stop();
+    if (stop_event)
+    {
+        ::CloseHandle(stop_event);
+    }
+}
+
+void audio_capture::start(const std::wstring& device, bool loopback, sink_function sink, error_function error)
+{
+    stop();
+
+    this->device = device;
+    this->loopback = loopback;
+    this->sink = std::move(sink);
+    this->error = std::move(error);
+
+    ::ResetEvent(stop_event);
+    capture_thread = std::thread(&audio_capture::capture_thread_main, this);
+}
+
+void audio_capture::stop()
+{
+    if (!capture_thread.joinable()) return;
+
+    ::SetEvent(stop_event);
+    capture_thread.join();
+}
+
+void audio_capture::capture_thread_main()
+{
+    HRESULT hr = ::CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    const bool needs_uninit = SUCCEEDED(hr);
+
+    //Everything COM is scoped in here so it's released before CoUninitialize
+    [&]()
+    {
+        ComPtr<IMMDeviceEnumerator> device_enum;
+        hr = ::CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(device_enum.ReleaseAndGetAddressOf()));
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to create enumerator"));
+
+        const EDataFlow flow = loopback ? eRender : eCapture;
+        ComPtr<IMMDevice> capture_device;
+        if (device == L"main")
+        {
+            hr = device_enum->GetDefaultAudioEndpoint(flow, eMultimedia, capture_device.ReleaseAndGetAddressOf());
+        }
+        else if (device == L"chat")
+        {
+            hr = device_enum->GetDefaultAudioEndpoint(flow, eCommunications, capture_device.ReleaseAndGetAddressOf());
+        }
+        else
+        {
+            hr = device_enum->GetDevice(device.c_str(), capture_device.ReleaseAndGetAddressOf());
+        }
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to find capture device"));
+
+        ComPtr<IAudioClient> audio_client;
+        hr = capture_device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)audio_client.ReleaseAndGetAddressOf());
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to activate capture device"));
+
+        WAVEFORMATEX* mix_format = nullptr;
+        hr = audio_client->GetMixFormat(&mix_format);
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to get capture format"));
+        std::unique_ptr<WAVEFORMATEX, decltype(&::CoTaskMemFree)> mix_format_owner(mix_format, &::CoTaskMemFree);
+
+        capture_sample_type sample_type;
+        if (!get_sample_type(mix_format, sample_type))
+        {
+            return error("Unsupported capture format");
+        }
+
+        DWORD stream_flags = AUDCLNT_STREAMFLAGS_EVENTCALLBACK;
+        if (loopback) stream_flags |= AUDCLNT_STREAMFLAGS_LOOPBACK;
+
+        hr = audio_client->Initialize(AUDCLNT_SHAREMODE_SHARED, stream_flags, capture_buffer_duration, 0, mix_format, nullptr);
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to initialize capture"));
+
+        HANDLE sample_event = ::CreateEventW(nullptr, FALSE, FALSE, nullptr);
+        std::unique_ptr<void, decltype(&::CloseHandle)> sample_event_owner(sample_event, &::CloseHandle);
+
+        hr = audio_client->SetEventHandle(sample_event);
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to set capture event"));
+
+        ComPtr<IAudioCaptureClient> capture_client;
+        hr = audio_client->GetService(IID_PPV_ARGS(capture_client.ReleaseAndGetAddressOf()));
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to get capture client"));
+
+        hr = audio_client->Start();
+        if (FAILED(hr)) return error(format_hresult(hr, "Unable to start capture"));
+
+        const uint32_t sample_rate = mix_format->nSamplesPerSec;
+        const uint32_t channels = mix_format->nChannels;
+
+        std::vector<float> interleaved;
+        std::vector<float> mono;
+
+        HANDLE wait_handles[] = { stop_event, sample_event };
+        while (true)
+        {
+            const DWORD waited = ::WaitForMultipleObjects(2, wait_handles, FALSE, INFINITE);
+            if (waited != WAIT_OBJECT_0 + 1) break;
+
+            UINT32 packet_frames = 0;
+            while (SUCCEEDED(hr = capture_client->GetNextPacketSize(&packet_frames)) && packet_frames > 0)
+            {
+                BYTE* data = nullptr;
+                UINT32 frames = 0;
+                DWORD flags = 0;
+                hr = capture_client->GetBuffer(&data, &frames, &flags, nullptr, nullptr);
+                if (FAILED(hr)) break;
+
+                const size_t sample_count = size_t(frames) * channels;
+                interleaved.resize(sample_count);
+                if (flags & AUDCLNT_BUFFERFLAGS_SILENT)
+                {
+                    std::fill(interleaved.begin(), interleaved.end(), 0.0f);
+                }
+                else if (sample_type == capture_sample_type::float32)
+                {
+                    memcpy(interleaved.data(), data, sample_count * sizeof(float));
+                }
+                else if (sample_type == capture_sample_type::int16)
+                {
+                    const int16_t* pcm = reinterpret_cast<const int16_t*>(data);
+                    for (size_t i = 0; i < sample_count; ++i) interleaved[i] = float(pcm[i]) / 32768.0f;
+                }
+                else
+                {
+                    const int32_t* pcm = reinterpret_cast<const int32_t*>(data);
+                    for (size_t i = 0; i < sample_count; ++i) interleaved[i] = float(pcm[i]) / 2147483648.0f;
+                }
+
+                capture_client->ReleaseBuffer(frames);
+
+                mono.resize(frames);
+                vad_downmix(interleaved.data(), frames, channels, mono.data());
+                sink(mono.data(), frames, sample_rate);
+            }
+
+            if (hr == AUDCLNT_E_DEVICE_INVALIDATED)
+            {
+                error("Capture device was removed");
+                break;
+            }
+            if (FAILED(hr))
+            {
+                error(format_hresult(hr, "Capture failed"));
+                break;
+            }
+        }
+
+        audio_client->Stop();
+    }();
+
+    if (needs_uninit)
+    {
+        ::CoUninitialize();
+    }
+}
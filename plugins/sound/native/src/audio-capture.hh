@@ -0,0 +1,36 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <thread>
+
+#include <windows.h>
+
+//Shared mode WASAPI capture on its own thread. Every packet is downmixed to mono float and handed to the sink on
+//that thread, so the sink should do its work quickly or hand it on.
+class audio_capture
+{
+public:
+    using sink_function = std::function<void(const float* mono, size_t frames, uint32_t sample_rate)>;
+    //Called on the capture thread, capture has stopped by the time it runs
+    using error_function = std::function<void(const std::string& message)>;
+
+    audio_capture();
+    ~audio_capture();
+
+    //device is "main", "chat" or a device id. With loopback it names an output and what it's playing is captured.
+    void start(const std::wstring& device, bool loopback, sink_function sink, error_function error);
+    void stop();
+    bool running() const { return capture_thread.joinable(); }
+
+private:
+    void capture_thread_main();
+
+    std::wstring device;
+    bool loopback = false;
+    sink_function sink;
+    error_function error;
+
+    std::thread capture_thread;
+    HANDLE stop_event = nullptr;
+};
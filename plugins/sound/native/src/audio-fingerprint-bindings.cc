@@ -0,0 +1,327 @@
+#include "audio-fingerprint-bindings.hh"
+#include "voice-activity.hh"
+#include "tts-pipeline.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+#include "castmate-native/trace.hh"
+
+struct fingerprint_event
+{
+    std::string clip_id;
+    float confidence;
+    double latency_ms;
+};
+
+//A clip can only match once per hop, this only fills if JS stalls for a long time
+static const size_t fingerprint_event_capacity = 64;
+
+static bool read_clip_wav(const std::string& path, std::vector<float>& mono, uint32_t& sample_rate, std::string& error)
+{
+    tts_audio_format format;
+    std::vector<uint8_t> pcm;
+    if (!read_wav_file(path, format, pcm, error)) return false;
+
+    if (format.bits_per_sample != 16 || format.channels == 0)
+    {
+        error = "Only 16 bit wav files can be fingerprinted";
+        return false;
+    }
+
+    const size_t frames = pcm.size() / 2 / format.channels;
+    std::vector<float> interleaved(frames * format.channels);
+    for (size_t i = 0; i < interleaved.size(); ++i)
+    {
+        const uint8_t* sample = pcm.data() + i * 2;
+        interleaved[i] = float(int16_t(sample[0] | (sample[1] << 8))) / 32768.0f;
+    }
+
+    mono.resize(frames);
+    vad_downmix(interleaved.data(), frames, format.channels, mono.data());
+    sample_rate = format.sample_rate;
+    return true;
+}
+
+//Reads and extracts every clip on the interface's work_pool, then builds the index in clip order
+class fingerprint_index_worker : public Napi::AsyncWorker
+{
+    fingerprint_interface* owner;
+    Napi::ObjectReference owner_ref;
+    std::shared_ptr<work_pool> pool;
+    std::vector<std::string> ids;
+    std::vector<std::string> files;
+    std::shared_ptr<fingerprint_index> index;
+public:
+    fingerprint_index_worker(fingerprint_interface* owner, const Napi::Object& owner_object, std::shared_ptr<work_pool> pool, std::vector<std::string> ids, std::vector<std::string> files, const Napi::Function& callback)
+        : AsyncWorker(callback)
+        , owner(owner)
+        , owner_ref(Napi::Persistent(owner_object))
+        , pool(std::move(pool))
+        , ids(std::move(ids))
+        , files(std::move(files))
+    {
+    }
+
+protected:
+    void Execute() override
+    {
+        TRACE_SCOPE("fingerprint index");
+
+        if (files.size() > fingerprint_index::max_clips)
+        {
+            SetError("Too many clips to fingerprint");
+            return;
+        }
+
+        std::vector<std::vector<fingerprint_landmark>> landmarks(files.size());
+        std::vector<uint32_t> frames(files.size());
+        std::vector<std::string> errors(files.size());
+
+        std::atomic<size_t> next_clip { 0 };
+        std::mutex mutex;
+        std::condition_variable finished;
+        size_t runners_left = std::min(pool->size(), files.size());
+
+        //One runner per worker pulling clips so each keeps its decode buffer, like tts_pipeline
+        auto runner = [&]() {
+            std::vector<float> mono;
+            for (size_t i = next_clip.fetch_add(1); i < files.size(); i = next_clip.fetch_add(1))
+            {
+                uint32_t sample_rate = 0;
+                if (!read_clip_wav(files[i], mono, sample_rate, errors[i])) continue;
+
+                landmarks[i] = fingerprint_extractor::extract(mono.data(), mono.size(), sample_rate);
+                frames[i] = uint32_t(uint64_t(mono.size()) * fingerprint_sample_rate / sample_rate / fingerprint_hop);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --runners_left;
+            }
+            finished.notify_all();
+        };
+
+        for (size_t r = 0, count = runners_left; r < count; ++r)
+        {
+            pool->submit(runner);
+        }
+
+        //Another setClips may share the pool, so wait on this build's runners rather than wait_idle
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&] { return runners_left == 0; });
+        }
+
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            if (!errors[i].empty())
+            {
+                SetError(files[i] + ": " + errors[i]);
+                return;
+            }
+        }
+
+        index = std::make_shared<fingerprint_index>();
+        for (size_t i = 0; i < files.size(); ++i)
+        {
+            index->add_clip(landmarks[i], frames[i]);
+        }
+        index->finish();
+    }
+
+    void OnOK() override
+    {
+        owner->set_index(Env(), index, std::move(ids));
+        Callback().Call({});
+    }
+};
+
+Napi::Object fingerprint_interface::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeAudioFingerprinter", {
+        InstanceMethod("setClips", &fingerprint_interface::set_clips),
+        InstanceMethod("start", &fingerprint_interface::start),
+        InstanceMethod("stop", &fingerprint_interface::stop),
+    });
+
+    exports.Set("NativeAudioFingerprinter", constructor);
+    return exports;
+}
+
+fingerprint_interface::fingerprint_interface(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<fingerprint_interface>(info)
+{
+    emit = Napi::Persistent(info[0].As<Napi::Function>());
+}
+
+fingerprint_interface::~fingerprint_interface()
+{
+    stop_capture();
+}
+
+void fingerprint_interface::Finalize(Napi::Env env)
+{
+    stop_capture();
+}
+
+Napi::Value fingerprint_interface::set_clips(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsArray() || !info[1].IsFunction())
+    {
+        Napi::Error::New(env, "setClips requires an array of clips and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    Napi::Array clips = info[0].As<Napi::Array>();
+    std::vector<std::string> ids;
+    std::vector<std::string> files;
+    for (uint32_t i = 0; i < clips.Length(); ++i)
+    {
+        Napi::Value value = clips.Get(i);
+        if (!value.IsObject())
+        {
+            Napi::Error::New(env, "Clips must be { id, file } objects.").ThrowAsJavaScriptException();
+            return env.Undefined();
+        }
+        Napi::Object clip = value.As<Napi::Object>();
+        ids.push_back(clip.Get("id").ToString().Utf8Value());
+        files.push_back(clip.Get("file").ToString().Utf8Value());
+    }
+
+    if (!index_pool)
+    {
+        index_pool = std::make_shared<work_pool>();
+    }
+
+    auto worker = new fingerprint_index_worker(this, info.This().As<Napi::Object>(), index_pool, std::move(ids), std::move(files), info[1].As<Napi::Function>());
+    worker->Queue();
+
+    return env.Undefined();
+}
+
+void fingerprint_interface::set_index(Napi::Env env, std::shared_ptr<const fingerprint_index> index, std::vector<std::string> clip_ids)
+{
+    this->index = std::move(index);
+    this->clip_ids = std::move(clip_ids);
+
+    if (listening)
+    {
+        stop_capture();
+        start_capture(env);
+    }
+}
+
+Napi::Value fingerprint_interface::start(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "start requires a device argument.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    stop_capture();
+
+    std::u16string device_str = info[0].As<Napi::String>().Utf16Value();
+    device = std::wstring(device_str.begin(), device_str.end());
+
+    loopback = false;
+    config = fingerprint_config();
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("loopback")) loopback = options.Get("loopback").ToBoolean().Value();
+        if (options.Has("minMatches")) config.min_matches = options.Get("minMatches").As<Napi::Number>().Uint32Value();
+    }
+
+    listening = true;
+    start_capture(env);
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value fingerprint_interface::stop(const Napi::CallbackInfo& info)
+{
+    listening = false;
+    stop_capture();
+    return info.Env().Undefined();
+}
+
+void fingerprint_interface::start_capture(Napi::Env env)
+{
+    //Nothing to listen for until setClips has finished
+    if (!index || index->clip_count() == 0) return;
+
+    capture_index = index;
+    capture_clip_ids = clip_ids;
+    worker.reset();
+    capture_rate = 0;
+    events.open(env, emit.Value(), "AudioFingerprintTSFN", fingerprint_event_capacity);
+
+    capture.start(device, loopback,
+        [this](const float* mono, size_t frames, uint32_t sample_rate) { process(mono, frames, sample_rate); },
+        [this](const std::string& message) { post_error(message); });
+}
+
+void fingerprint_interface::stop_capture()
+{
+    if (!capture.running()) return;
+
+    capture.stop();
+    //Joins the matching thread, nothing posts after this
+    worker.reset();
+    events.close();
+}
+
+void fingerprint_interface::process(const float* mono, size_t frames, uint32_t sample_rate)
+{
+    if (!worker)
+    {
+        capture_rate = sample_rate;
+        worker = std::make_unique<fingerprint_worker>(*capture_index, sample_rate, config,
+            [this](const fingerprint_match& match) { post_match(match); });
+    }
+
+    worker->push(mono, frames);
+}
+
+void fingerprint_interface::post_match(const fingerprint_match& match)
+{
+    fingerprint_event event;
+    event.clip_id = capture_clip_ids[match.clip];
+    event.confidence = match.confidence;
+    event.latency_ms = double(match.detected_sample - match.start_sample) * 1000.0 / capture_rate;
+
+    auto js_thread_callback = [event](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({
+            Napi::String::New(env, "match"),
+            Napi::String::New(env, event.clip_id),
+            Napi::Number::New(env, event.confidence),
+            Napi::Number::New(env, event.latency_ms),
+        });
+    };
+
+    events.post(js_thread_callback);
+}
+
+void fingerprint_interface::post_error(const std::string& message)
+{
+    auto js_thread_callback = [message](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({ Napi::String::New(env, "error"), Napi::String::New(env, message) });
+    };
+
+    events.post(js_thread_callback);
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "castmate-native/event-dispatcher.hh"
+#include "castmate-native/work-pool.hh"
+
+#include "audio-capture.hh"
+#include "audio-fingerprint.hh"
+
+//Listens to an input, or an output through loopback, for any of a set of registered clips.
+//The capture thread only copies into a fingerprint_worker, matches cross over to JS as:
+//  ("match", clipId, confidence, latencyMs) latencyMs is how far into the clip it was recognized
+//  ("error", message) after which capture has stopped
+class fingerprint_interface : public Napi::ObjectWrap<fingerprint_interface>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    fingerprint_interface(const Napi::CallbackInfo& info);
+    ~fingerprint_interface();
+
+    Napi::Value set_clips(const Napi::CallbackInfo& info);
+    Napi::Value start(const Napi::CallbackInfo& info);
+    Napi::Value stop(const Napi::CallbackInfo& info);
+
+    void Finalize(Napi::Env env) override;
+
+    //Swaps in a finished index, capture restarts on it if it's running
+    void set_index(Napi::Env env, std::shared_ptr<const fingerprint_index> index, std::vector<std::string> clip_ids);
+
+private:
+    void start_capture(Napi::Env env);
+    void stop_capture();
+    void process(const float* mono, size_t frames, uint32_t sample_rate);
+    void post_match(const fingerprint_match& match);
+    void post_error(const std::string& message);
+
+    Napi::FunctionReference emit;
+
+    std::shared_ptr<const fingerprint_index> index;
+    std::vector<std::string> clip_ids;
+
+    //Set between start and stop, capture waits for an index if there isn't one yet
+    bool listening = false;
+    std::wstring device;
+    bool loopback = false;
+    fingerprint_config config;
+
+    //The index the worker matches against, held for as long as capture runs
+    std::shared_ptr<const fingerprint_index> capture_index;
+    std::vector<std::string> capture_clip_ids;
+    //Only touched on the capture thread, made once the device's rate is known
+    std::unique_ptr<fingerprint_worker> worker;
+    uint32_t capture_rate = 0;
+
+    audio_capture capture;
+    js_call_dispatcher events;
+
+    //Extracts clips for setClips, made on first use and shared with index workers that may still be running
+    std::shared_ptr<work_pool> index_pool;
+};
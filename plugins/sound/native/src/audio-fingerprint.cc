@@ -0,0 +1,506 @@
+#include "audio-fingerprint.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define AUDIO_FINGERPRINT_SSE 1
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+//Resampler phases, the fractional position is rounded to one of these
+static const size_t resampler_phases = 64;
+
+//Bins searched for peaks, about 30Hz to 4kHz
+static const uint32_t min_peak_bin = 2;
+static const uint32_t max_peak_bin = 255;
+static const uint32_t max_peaks_per_frame = 5;
+//Natural log of power, quieter than about -80dBFS never makes a peak
+static const float peak_floor = -16.0f;
+//Natural log of power over the frame's median, about 15dB
+static const float peak_prominence = 3.5f;
+//Per frame fall of the threshold, about 14dB a second
+static const float threshold_decay = 0.05f;
+//Width in bins of the shadow a peak casts over its neighbours
+static const float threshold_spread_bins = 8.0f;
+
+//Pairing zone behind a peak
+static const uint32_t min_pair_frames = 1;
+static const uint32_t max_pair_frames = 32;
+static const int32_t max_pair_bins = 31;
+static const uint32_t pairs_per_peak = 3;
+
+//Matched landmarks have to cover this much of the clip, about 500ms
+static const uint32_t min_match_span_frames = 32;
+//Hashes shared by this many postings say nothing about which clip is playing
+static const size_t max_postings_per_hash = 64;
+//Index buckets are over the top 14 of the 20 hash bits
+static const uint32_t bucket_shift = 6;
+static const uint32_t hash_bits = 20;
+
+static float fingerprint_dot(const float* a, const float* b, size_t count)
+{
+    size_t i = 0;
+    float result = 0;
+
+#ifdef AUDIO_FINGERPRINT_SSE
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    result = _mm_cvtss_f32(sum);
+#endif
+
+    for (; i < count; ++i)
+    {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+static uint32_t landmark_hash(uint32_t anchor_bin, int32_t bin_delta, uint32_t frame_delta)
+{
+    return ((anchor_bin & 0xFF) << 12) | (uint32_t(bin_delta + 32) & 0x3F) << 6 | (frame_delta & 0x3F);
+}
+
+fingerprint_resampler::fingerprint_resampler(uint32_t input_rate)
+{
+    step = double(input_rate) / double(fingerprint_sample_rate);
+    if (input_rate == fingerprint_sample_rate)
+    {
+        taps = 0;
+        return;
+    }
+
+    //Cutoff just under the output Nyquist, or the input's if it's slower
+    const double cutoff = 0.45 / std::max(1.0, step);
+    const size_t half = size_t(std::ceil(4.0 * std::max(1.0, step))) + 4;
+    taps = half * 2;
+
+    table.resize((resampler_phases + 1) * taps);
+    for (size_t phase = 0; phase <= resampler_phases; ++phase)
+    {
+        const double fraction = double(phase) / double(resampler_phases);
+        float* row = table.data() + phase * taps;
+        double sum = 0;
+        for (size_t k = 0; k < taps; ++k)
+        {
+            const double x = double(k) - double(half - 1) - fraction;
+            const double sinc = x == 0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+            const double edge = x / double(half);
+            const double blackman = std::abs(edge) >= 1.0 ? 0.0 : 0.42 + 0.5 * std::cos(pi * edge) + 0.08 * std::cos(2.0 * pi * edge);
+            row[k] = float(sinc * blackman);
+            sum += row[k];
+        }
+        for (size_t k = 0; k < taps; ++k) row[k] = float(row[k] / sum);
+    }
+
+    //Zeros ahead of the first sample so the first output has history to filter
+    pending.assign(half - 1, 0.0f);
+    position = double(half - 1);
+}
+
+void fingerprint_resampler::process(const float* input, size_t count, std::vector<float>& output)
+{
+    if (taps == 0)
+    {
+        output.insert(output.end(), input, input + count);
+        return;
+    }
+
+    pending.insert(pending.end(), input, input + count);
+
+    const size_t half = taps / 2;
+    while (size_t(position) + half < pending.size())
+    {
+        const size_t whole = size_t(position);
+        const size_t phase = size_t((position - double(whole)) * resampler_phases + 0.5);
+        output.push_back(fingerprint_dot(pending.data() + whole - (half - 1), table.data() + phase * taps, taps));
+        position += step;
+    }
+
+    const size_t consumed = std::min(pending.size(), size_t(position) - (half - 1));
+    pending.erase(pending.begin(), pending.begin() + consumed);
+    position -= double(consumed);
+}
+
+fingerprint_extractor::fingerprint_extractor(uint32_t sample_rate)
+    : resampler(sample_rate)
+    , history(fingerprint_fft_size, 0.0f)
+    , spectrum(fingerprint_fft_size)
+    , window(hann_window(fingerprint_fft_size))
+    , level(fingerprint_fft_size / 2 + 1)
+    , threshold(fingerprint_fft_size / 2 + 1, peak_floor)
+{
+}
+
+std::vector<fingerprint_landmark> fingerprint_extractor::extract(const float* samples, size_t count, uint32_t sample_rate)
+{
+    fingerprint_extractor extractor(sample_rate);
+    std::vector<fingerprint_landmark> landmarks;
+    extractor.process(samples, count, landmarks);
+
+    //Let the tail through the resampler and the last window
+    const std::vector<float> silence(sample_rate / 8, 0.0f);
+    extractor.process(silence.data(), silence.size(), landmarks);
+    return landmarks;
+}
+
+void fingerprint_extractor::process(const float* samples, size_t count, std::vector<fingerprint_landmark>& landmarks)
+{
+    resampled.clear();
+    resampler.process(samples, count, resampled);
+
+    const float* input = resampled.data();
+    size_t remaining = resampled.size();
+    while (remaining > 0)
+    {
+        const size_t take = std::min(remaining, fingerprint_hop - hop_fill);
+
+        memmove(history.data(), history.data() + take, (fingerprint_fft_size - take) * sizeof(float));
+        memcpy(history.data() + fingerprint_fft_size - take, input, take * sizeof(float));
+
+        hop_fill += take;
+        input += take;
+        remaining -= take;
+
+        if (hop_fill == fingerprint_hop)
+        {
+            hop_fill = 0;
+            analyze_frame(landmarks);
+            ++frame_index;
+        }
+    }
+}
+
+void fingerprint_extractor::analyze_frame(std::vector<fingerprint_landmark>& landmarks)
+{
+    spectrum.compute(history.data(), window.data(), fingerprint_fft_size, level.data());
+
+    //Power relative to a full scale sine, so the floor is in dBFS
+    const float full_scale = std::log(float(fingerprint_fft_size) * float(fingerprint_fft_size) / 16.0f);
+    for (uint32_t bin = min_peak_bin - 1; bin <= max_peak_bin + 1; ++bin)
+    {
+        level[bin] = std::log(level[bin] + 1e-20f) - full_scale;
+    }
+
+    //Peaks have to stand out of the frame's own noise floor, the median is a cheap stand in for it
+    sorted_level.assign(level.begin() + min_peak_bin, level.begin() + max_peak_bin + 1);
+    std::nth_element(sorted_level.begin(), sorted_level.begin() + sorted_level.size() / 2, sorted_level.end());
+    const float floor = std::max(peak_floor, sorted_level[sorted_level.size() / 2] + peak_prominence);
+
+    candidates.clear();
+    for (uint32_t bin = min_peak_bin; bin <= max_peak_bin; ++bin)
+    {
+        threshold[bin] = std::max(peak_floor, threshold[bin] - threshold_decay);
+
+        const float value = level[bin];
+        if (value > threshold[bin] && value > floor && value > level[bin - 1] && value >= level[bin + 1])
+        {
+            candidates.push_back({ frame_index, bin, value });
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const peak& a, const peak& b) { return a.level > b.level; });
+
+    //Drop peaks too old to pair with
+    const uint32_t oldest = frame_index > max_pair_frames ? frame_index - max_pair_frames : 0;
+    recent.erase(recent.begin(), std::find_if(recent.begin(), recent.end(), [oldest](const peak& p) { return p.frame >= oldest; }));
+
+    const size_t paired_before = recent.size();
+    uint32_t accepted = 0;
+    for (const peak& candidate : candidates)
+    {
+        if (accepted >= max_peaks_per_frame) break;
+        //A louder peak this frame may have shadowed it
+        if (candidate.level <= threshold[candidate.bin]) continue;
+        ++accepted;
+
+        //Raise the threshold around it, a quadratic in log power is a gaussian shadow
+        for (uint32_t bin = min_peak_bin; bin <= max_peak_bin; ++bin)
+        {
+            const float distance = (float(bin) - float(candidate.bin)) / threshold_spread_bins;
+            threshold[bin] = std::max(threshold[bin], candidate.level - 0.5f * distance * distance);
+        }
+
+        //Pair with the loudest earlier peaks in the zone behind it, noise rarely outranks what it's covering
+        zone.clear();
+        for (size_t i = 0; i < paired_before; ++i)
+        {
+            const peak& anchor = recent[i];
+            const int32_t bin_delta = int32_t(candidate.bin) - int32_t(anchor.bin);
+            if (candidate.frame - anchor.frame < min_pair_frames) continue;
+            if (bin_delta > max_pair_bins || bin_delta < -max_pair_bins) continue;
+            zone.push_back(anchor);
+        }
+
+        const size_t pairs = std::min<size_t>(pairs_per_peak, zone.size());
+        std::partial_sort(zone.begin(), zone.begin() + pairs, zone.end(), [](const peak& a, const peak& b) { return a.level > b.level; });
+        for (size_t i = 0; i < pairs; ++i)
+        {
+            const peak& anchor = zone[i];
+            landmarks.push_back({ landmark_hash(anchor.bin, int32_t(candidate.bin) - int32_t(anchor.bin), candidate.frame - anchor.frame), anchor.frame });
+        }
+
+        recent.push_back(candidate);
+    }
+}
+
+uint32_t fingerprint_index::add_clip(const std::vector<fingerprint_landmark>& landmarks, uint32_t frames)
+{
+    const uint32_t clip = uint32_t(clip_frames.size());
+    clip_frames.push_back(frames);
+    clip_density.push_back(frames > 0 ? float(landmarks.size()) / float(frames) : 0.0f);
+
+    for (const fingerprint_landmark& landmark : landmarks)
+    {
+        hashes.push_back(landmark.hash);
+        postings.push_back((clip << 20) | (landmark.frame & 0xFFFFF));
+    }
+    return clip;
+}
+
+void fingerprint_index::finish()
+{
+    //Sort postings by hash through an order array, then rebuild both
+    std::vector<uint32_t> order(hashes.size());
+    for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+        return hashes[a] != hashes[b] ? hashes[a] < hashes[b] : postings[a] < postings[b];
+    });
+
+    std::vector<uint32_t> sorted_hashes(order.size());
+    std::vector<uint32_t> sorted_postings(order.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        sorted_hashes[i] = hashes[order[i]];
+        sorted_postings[i] = postings[order[i]];
+    }
+    hashes.swap(sorted_hashes);
+    postings.swap(sorted_postings);
+
+    const uint32_t bucket_count = 1u << (hash_bits - bucket_shift);
+    buckets.assign(bucket_count + 1, 0);
+    for (uint32_t hash : hashes)
+    {
+        ++buckets[(hash >> bucket_shift) + 1];
+    }
+    for (uint32_t i = 0; i < bucket_count; ++i)
+    {
+        buckets[i + 1] += buckets[i];
+    }
+}
+
+size_t fingerprint_index::memory_bytes() const
+{
+    return (hashes.capacity() + postings.capacity() + buckets.capacity() + clip_frames.capacity()) * sizeof(uint32_t)
+        + clip_density.capacity() * sizeof(float);
+}
+
+void fingerprint_index::lookup(uint32_t hash, const uint32_t*& begin, const uint32_t*& end) const
+{
+    begin = end = nullptr;
+    if (buckets.empty()) return;
+
+    const uint32_t bucket = hash >> bucket_shift;
+    const uint32_t* first = hashes.data() + buckets[bucket];
+    const uint32_t* last = hashes.data() + buckets[bucket + 1];
+    const auto range = std::equal_range(first, last, hash);
+
+    begin = postings.data() + (range.first - hashes.data());
+    end = postings.data() + (range.second - hashes.data());
+}
+
+fingerprint_matcher::fingerprint_matcher(const fingerprint_index& index, uint32_t sample_rate, const fingerprint_config& config)
+    : index(index)
+    , sample_rate(sample_rate)
+    , config(config)
+    , extractor(sample_rate)
+    , quiet_until(index.clip_count(), 0)
+{
+    vote_window_frames = uint32_t(uint64_t(config.vote_window_ms) * fingerprint_sample_rate / 1000 / fingerprint_hop);
+}
+
+void fingerprint_matcher::skip(size_t count)
+{
+    position += count;
+
+    //Start over past the gap, lined up on the stream's frame grid
+    extractor = fingerprint_extractor(sample_rate);
+    frame_base = uint32_t(position * fingerprint_sample_rate / sample_rate / fingerprint_hop);
+}
+
+void fingerprint_matcher::process(const float* samples, size_t count, std::vector<fingerprint_match>& matches)
+{
+    landmarks.clear();
+    extractor.process(samples, count, landmarks);
+    position += count;
+
+    const uint32_t min_matches = std::max<uint32_t>(2, config.min_matches);
+
+    for (const fingerprint_landmark& landmark : landmarks)
+    {
+        const uint32_t frame = frame_base + landmark.frame;
+
+        const uint32_t* begin;
+        const uint32_t* end;
+        index.lookup(landmark.hash, begin, end);
+        if (size_t(end - begin) > max_postings_per_hash) continue;
+
+        for (const uint32_t* posting = begin; posting != end; ++posting)
+        {
+            const uint32_t clip = fingerprint_index::posting_clip(*posting);
+            const uint32_t clip_frame = fingerprint_index::posting_frame(*posting);
+            if (frame < quiet_until[clip]) continue;
+
+            //Where the clip's first frame lands in the stream, the same for every landmark of one playback
+            const int32_t offset = int32_t(frame) - int32_t(clip_frame);
+            const uint64_t key = (uint64_t(clip) << 32) | uint32_t(offset);
+
+            vote& tally = votes[key];
+            if (tally.count == 0) tally.first_clip_frame = clip_frame;
+            ++tally.count;
+            tally.last_frame = frame;
+            tally.first_clip_frame = std::min(tally.first_clip_frame, clip_frame);
+            tally.last_clip_frame = std::max(tally.last_clip_frame, clip_frame);
+
+            if (tally.count * 2 < min_matches) continue;
+
+            //Frame grids of the clip and the stream don't line up exactly, so peaks land a frame either way
+            uint32_t score = tally.count;
+            uint32_t first_clip_frame = tally.first_clip_frame;
+            uint32_t last_clip_frame = tally.last_clip_frame;
+            for (int32_t neighbour : { offset - 1, offset + 1 })
+            {
+                const auto found = votes.find((uint64_t(clip) << 32) | uint32_t(neighbour));
+                if (found == votes.end()) continue;
+                score += found->second.count;
+                first_clip_frame = std::min(first_clip_frame, found->second.first_clip_frame);
+                last_clip_frame = std::max(last_clip_frame, found->second.last_clip_frame);
+            }
+            //Harmonics of one note change give a burst of landmarks at a single instant, a real playback agrees over time
+            if (score < min_matches || last_clip_frame - first_clip_frame < min_match_span_frames) continue;
+
+            const float expected = index.density_of(clip) * float(last_clip_frame - first_clip_frame + max_pair_frames);
+
+            fingerprint_match match;
+            match.clip = clip;
+            match.confidence = std::min(1.0f, float(score) / std::max(1.0f, expected));
+            match.start_sample = offset > 0 ? uint64_t(offset) * fingerprint_hop * sample_rate / fingerprint_sample_rate : 0;
+            match.detected_sample = position;
+            matches.push_back(match);
+
+            //One report per playback
+            quiet_until[clip] = uint32_t(std::max<int32_t>(0, offset + int32_t(index.frames_of(clip)) + int32_t(max_pair_frames)));
+        }
+    }
+
+    const uint32_t current = frame_base + extractor.frames();
+    if (current - last_prune >= 64)
+    {
+        last_prune = current;
+        for (auto it = votes.begin(); it != votes.end();)
+        {
+            if (it->second.last_frame + vote_window_frames < current) it = votes.erase(it);
+            else ++it;
+        }
+    }
+}
+
+fingerprint_worker::fingerprint_worker(const fingerprint_index& index, uint32_t sample_rate, const fingerprint_config& config, match_function on_match, uint32_t max_backlog_ms)
+    : matcher(index, sample_rate, config)
+    , on_match(std::move(on_match))
+    , max_backlog(size_t(uint64_t(sample_rate) * max_backlog_ms / 1000))
+{
+    thread = std::thread(&fingerprint_worker::thread_main, this);
+}
+
+fingerprint_worker::~fingerprint_worker()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void fingerprint_worker::push(const float* samples, size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (count > max_backlog)
+        {
+            pending_skip += queue.size() + count - max_backlog;
+            dropped += queue.size() + count - max_backlog;
+            queue.clear();
+            samples += count - max_backlog;
+            count = max_backlog;
+        }
+        else if (queue.size() + count > max_backlog)
+        {
+            const size_t excess = queue.size() + count - max_backlog;
+            queue.erase(queue.begin(), queue.begin() + excess);
+            pending_skip += excess;
+            dropped += excess;
+        }
+
+        queue.insert(queue.end(), samples, samples + count);
+    }
+    wake.notify_one();
+}
+
+void fingerprint_worker::drain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return (queue.empty() && !busy) || stopping; });
+}
+
+void fingerprint_worker::thread_main()
+{
+    std::vector<float> block;
+    std::vector<fingerprint_match> matches;
+
+    while (true)
+    {
+        size_t skip = 0;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) break;
+
+            block.swap(queue);
+            queue.clear();
+            skip = pending_skip;
+            pending_skip = 0;
+            busy = true;
+        }
+
+        if (skip > 0) matcher.skip(skip);
+
+        matches.clear();
+        matcher.process(block.data(), block.size(), matches);
+        for (const fingerprint_match& match : matches)
+        {
+            on_match(match);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busy = false;
+        }
+        idle.notify_all();
+    }
+
+    idle.notify_all();
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "power-spectrum.hh"
+
+//Landmark audio fingerprinting. Audio is resampled to 8kHz and every 16ms a 64ms FFT frame is searched for spectral
+//peaks against a decaying per bin threshold. Each peak is paired with a few earlier peaks close by in time and
+//frequency, and every pair is a landmark: a 20 bit hash of (anchor bin, bin delta, frame delta) at the anchor's frame.
+//The same extractor runs over the registered clips and the live stream, so a clip playing live produces the same
+//hashes at a constant frame offset. The matcher looks the hashes up and votes per (clip, offset).
+//
+//Peaks and pairing are causal, nothing waits on future frames, so a clip is reported as soon as enough landmarks agree.
+
+static const uint32_t fingerprint_sample_rate = 8000;
+static const size_t fingerprint_fft_size = 512;
+static const size_t fingerprint_hop = 128;
+
+struct fingerprint_landmark
+{
+    uint32_t hash;
+    uint32_t frame;
+};
+
+//Windowed sinc to 8kHz through a polyphase table, any input rate
+class fingerprint_resampler
+{
+public:
+    fingerprint_resampler(uint32_t input_rate);
+
+    void process(const float* input, size_t count, std::vector<float>& output);
+
+private:
+    double step;
+    size_t taps;
+    std::vector<float> table;
+    std::vector<float> pending;
+    double position = 0;
+};
+
+class fingerprint_extractor
+{
+public:
+    fingerprint_extractor(uint32_t sample_rate);
+
+    //Appends the landmarks completed by this block
+    void process(const float* samples, size_t count, std::vector<fingerprint_landmark>& landmarks);
+    uint32_t frames() const { return frame_index; }
+
+    static std::vector<fingerprint_landmark> extract(const float* samples, size_t count, uint32_t sample_rate);
+
+private:
+    struct peak
+    {
+        uint32_t frame;
+        uint32_t bin;
+        float level;
+    };
+
+    void analyze_frame(std::vector<fingerprint_landmark>& landmarks);
+
+    fingerprint_resampler resampler;
+    std::vector<float> resampled;
+    std::vector<float> history;
+    size_t hop_fill = 0;
+    uint32_t frame_index = 0;
+
+    power_spectrum spectrum;
+    std::vector<float> window;
+    std::vector<float> level;
+    std::vector<float> sorted_level;
+    std::vector<float> threshold;
+    std::vector<peak> candidates;
+    //Peaks still close enough to pair with, oldest first
+    std::vector<peak> recent;
+    std::vector<peak> zone;
+};
+
+//Landmarks of every registered clip, sorted by hash. A table over the top bits of the hash gives each lookup a short
+//range to search, postings pack the clip into the top 12 bits and the frame into the low 20.
+class fingerprint_index
+{
+public:
+    static const uint32_t max_clips = 4096;
+
+    //Returns the clip number
+    uint32_t add_clip(const std::vector<fingerprint_landmark>& landmarks, uint32_t frames);
+    void finish();
+
+    size_t clip_count() const { return clip_frames.size(); }
+    uint32_t frames_of(uint32_t clip) const { return clip_frames[clip]; }
+    //Landmarks per frame, what a clean match produces
+    float density_of(uint32_t clip) const { return clip_density[clip]; }
+    size_t landmark_count() const { return postings.size(); }
+    size_t memory_bytes() const;
+
+    //Postings for a hash, empty if none
+    void lookup(uint32_t hash, const uint32_t*& begin, const uint32_t*& end) const;
+
+    static uint32_t posting_clip(uint32_t posting) { return posting >> 20; }
+    static uint32_t posting_frame(uint32_t posting) { return posting & 0xFFFFF; }
+
+private:
+    std::vector<uint32_t> hashes;
+    std::vector<uint32_t> postings;
+    std::vector<uint32_t> buckets;
+    std::vector<uint32_t> clip_frames;
+    std::vector<float> clip_density;
+};
+
+struct fingerprint_config
+{
+    //Landmarks that have to agree on one offset before a clip is reported. Unrelated music with the same couple of
+    //notes as a clip reaches about 22, at 26 a match only waits a few more landmarks above 0dB.
+    uint32_t min_matches = 26;
+    //Votes older than this are dropped, a clip has to gather its matches inside it
+    uint32_t vote_window_ms = 4000;
+};
+
+struct fingerprint_match
+{
+    uint32_t clip;
+    //Matched landmarks over what the clip has over the same stretch, 0 to 1
+    float confidence;
+    //Stream sample where the clip started, and the stream sample it was recognized at
+    uint64_t start_sample;
+    uint64_t detected_sample;
+};
+
+class fingerprint_matcher
+{
+public:
+    fingerprint_matcher(const fingerprint_index& index, uint32_t sample_rate, const fingerprint_config& config = {});
+
+    void process(const float* samples, size_t count, std::vector<fingerprint_match>& matches);
+    //Keeps stream time right across audio that was dropped
+    void skip(size_t count);
+
+private:
+    struct vote
+    {
+        uint32_t count;
+        uint32_t last_frame;
+        uint32_t first_clip_frame;
+        uint32_t last_clip_frame;
+    };
+
+    const fingerprint_index& index;
+    uint32_t sample_rate;
+    fingerprint_config config;
+    uint32_t vote_window_frames;
+
+    fingerprint_extractor extractor;
+    std::vector<fingerprint_landmark> landmarks;
+    //(clip, offset) -> votes
+    std::unordered_map<uint64_t, vote> votes;
+    //Per clip, the stream frame its last report runs until
+    std::vector<uint32_t> quiet_until;
+    uint32_t last_prune = 0;
+    //Stream frame of the extractor's first frame, it restarts after dropped audio
+    uint32_t frame_base = 0;
+    uint64_t position = 0;
+};
+
+//Runs a matcher on its own thread so the capture thread only copies. If matching falls behind by more than
+//max_backlog_ms the oldest audio is dropped, that bounds how late a report can come.
+class fingerprint_worker
+{
+public:
+    using match_function = std::function<void(const fingerprint_match& match)>;
+
+    fingerprint_worker(const fingerprint_index& index, uint32_t sample_rate, const fingerprint_config& config, match_function on_match, uint32_t max_backlog_ms = 500);
+    ~fingerprint_worker();
+
+    void push(const float* samples, size_t count);
+    //Waits until everything pushed so far has been matched
+    void drain();
+    uint64_t dropped_samples() const { return dropped; }
+
+private:
+    void thread_main();
+
+    fingerprint_matcher matcher;
+    match_function on_match;
+    size_t max_backlog;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<float> queue;
+    //Dropped samples that were ahead of everything in the queue
+    size_t pending_skip = 0;
+    bool busy = false;
+    bool stopping = false;
+    uint64_t dropped = 0;
+    std::thread thread;
+};
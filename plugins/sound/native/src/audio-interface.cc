@@ -1,6 +1,8 @@
 #include "audio-interface.hh"
-#include "util.hh"
+#include "castmate-native/errors.hh"
+#include "castmate-native/trace.hh"
 
+#include <algorithm>
 #include <string>
 #include <sstream>
 #include <iomanip>
@@ -14,6 +16,14 @@ Napi::Object audio_device_interface::init(Napi::Env env, Napi::Object exports)
         InstanceMethod("getDevices", &audio_device_interface::get_devices),
         InstanceMethod("getDefaultOutput", &audio_device_interface::get_default_output),
         InstanceMethod("getDefaultInput", &audio_device_interface::get_default_input),
+        InstanceMethod("watchEndpoint", &audio_device_interface::watch_endpoint),
+        InstanceMethod("unwatchEndpoint", &audio_device_interface::unwatch_endpoint),
+        InstanceMethod("getEndpointVolume", &audio_device_interface::get_endpoint_volume),
+        InstanceMethod("setEndpointVolume", &audio_device_interface::set_endpoint_volume),
+        InstanceMethod("setEndpointMute", &audio_device_interface::set_endpoint_mute),
+        InstanceMethod("getEndpointPeak", &audio_device_interface::get_endpoint_peak),
+        InstanceMethod("getEndpointFormat", &audio_device_interface::get_endpoint_format),
+        InstanceMethod("getFormatStats", &audio_device_interface::get_format_stats),
     });
 
     exports.Set("NativeAudioDeviceInterface", constructor);
@@ -23,8 +33,8 @@ Napi::Object audio_device_interface::init(Napi::Env env, Napi::Object exports)
 audio_device_interface::audio_device_interface(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<audio_device_interface>(info)
 {
-    emit = info[0].As<Napi::Function>();
-    
+    emit = Napi::Persistent(info[0].As<Napi::Function>());
+
     Napi::Env env = info.Env();
     HRESULT hr;
     hr = ::CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(device_enum.ReleaseAndGetAddressOf()));
@@ -49,7 +59,7 @@ static HRESULT get_data_flow(IMMDevice* device, EDataFlow *data_flow)
     return S_OK;
 }
 
-static Napi::Value get_js_device(IMMDevice* device, Napi::Env env)
+static Napi::Value get_js_device(IMMDevice* device, Napi::Env env, endpoint_format_cache* formats)
 {
     if (device == nullptr) return env.Undefined();
 
@@ -120,6 +130,12 @@ static Napi::Value get_js_device(IMMDevice* device, Napi::Env env)
     device_obj.Set("state", state_str);
     device_obj.Set("name", Napi::String::New(env, std::u16string(wname.begin(), wname.end())));
     device_obj.Set("guid", Napi::String::New(env, std::u16string(wguid.begin(), wguid.end())));
+
+    endpoint_format format;
+    if (formats && formats->get(device, id, format))
+    {
+        device_obj.Set("format", make_js_endpoint_format(env, format));
+    }
     return device_obj;
 }
 
@@ -128,6 +144,8 @@ Napi::Value audio_device_interface::get_devices(const Napi::CallbackInfo& info)
     Napi::Env env = info.Env();
     HRESULT hr;
 
+    TRACE_SCOPE("audio get_devices");
+
     ComPtr<IMMDeviceCollection> devices;
     hr = device_enum->EnumAudioEndpoints(eAll, DEVICE_STATEMASK_ALL, devices.ReleaseAndGetAddressOf());
     if (error_handler(hr, "Unable to get audio device collection", env))
@@ -153,7 +171,7 @@ Napi::Value audio_device_interface::get_devices(const Napi::CallbackInfo& info)
             return env.Undefined();
         }
 
-        Napi::Value device_obj = get_js_device(device.Get(), env);
+        Napi::Value device_obj = get_js_device(device.Get(), env, &formats);
         if (device_obj.IsUndefined()) continue;
 
         result[result_count++] = device_obj;
@@ -191,7 +209,7 @@ Napi::Value audio_device_interface::get_default_output(const Napi::CallbackInfo&
         return env.Undefined();
     }
 
-    Napi::Value device_obj = get_js_device(device.Get(), env);
+    Napi::Value device_obj = get_js_device(device.Get(), env, &formats);
     return device_obj;
 }
 
@@ -224,7 +242,7 @@ Napi::Value audio_device_interface::get_default_input(const Napi::CallbackInfo&
         return env.Undefined();
     }
 
-    Napi::Value device_obj = get_js_device(device.Get(), env);
+    Napi::Value device_obj = get_js_device(device.Get(), env, &formats);
     return device_obj;
 }
 
@@ -262,30 +280,290 @@ HRESULT audio_device_interface::get_device_by_id(LPCWSTR id, IMMDevice** pDevice
     return NOERROR;
 }
 
+static std::wstring get_endpoint_id(const Napi::Value& value)
+{
+    std::u16string id = value.As<Napi::String>().Utf16Value();
+    return std::wstring(id.begin(), id.end());
+}
+
+static Napi::Value get_js_volume(IAudioEndpointVolume* volume, Napi::Env env)
+{
+    float level = 0.0f;
+    HRESULT hr = volume->GetMasterVolumeLevelScalar(&level);
+    if (error_handler(hr, "Unable to get endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    BOOL muted = FALSE;
+    hr = volume->GetMute(&muted);
+    if (error_handler(hr, "Unable to get endpoint mute", env))
+    {
+        return env.Undefined();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("volume", Napi::Number::New(env, level));
+    result.Set("muted", Napi::Boolean::New(env, muted != FALSE));
+    return result;
+}
+
+HRESULT audio_device_interface::get_endpoint_volume_control(const std::wstring& id, IAudioEndpointVolume** volume)
+{
+    (*volume) = nullptr;
+
+    auto watched = endpoints.find(id);
+    if (watched != endpoints.end())
+    {
+        (*volume) = watched->second.volume.Get();
+        (*volume)->AddRef();
+        return S_OK;
+    }
+
+    ComPtr<IMMDevice> device;
+    HRESULT hr = device_enum->GetDevice(id.c_str(), device.ReleaseAndGetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    return device->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, nullptr, (void**)volume);
+}
+
+Napi::Value audio_device_interface::watch_endpoint(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+    HRESULT hr;
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "watchEndpoint requires a device id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::wstring id = get_endpoint_id(info[0]);
+
+    auto existing = endpoints.find(id);
+    if (existing != endpoints.end())
+    {
+        return get_js_volume(existing->second.volume.Get(), env);
+    }
+
+    ComPtr<IMMDevice> device;
+    hr = device_enum->GetDevice(id.c_str(), device.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to find endpoint", env))
+    {
+        return env.Undefined();
+    }
+
+    endpoint_watch watch;
+    hr = device->Activate(__uuidof(IAudioEndpointVolume), CLSCTX_ALL, nullptr, (void**)watch.volume.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to activate endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    hr = device->Activate(__uuidof(IAudioMeterInformation), CLSCTX_ALL, nullptr, (void**)watch.meter.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to activate endpoint meter", env))
+    {
+        return env.Undefined();
+    }
+
+    (*watch.callback.GetAddressOf()) = new endpoint_volume_callback(env, emit.Value(), id);
+    watch.callback->AddRef();
+
+    hr = watch.volume->RegisterControlChangeNotify(watch.callback.Get());
+    if (error_handler(hr, "Unable to watch endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    Napi::Value result = get_js_volume(watch.volume.Get(), env);
+    endpoints.emplace(id, std::move(watch));
+    return result;
+}
+
+Napi::Value audio_device_interface::unwatch_endpoint(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "unwatchEndpoint requires a device id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto watched = endpoints.find(get_endpoint_id(info[0]));
+    if (watched == endpoints.end()) return env.Undefined();
+
+    watched->second.volume->UnregisterControlChangeNotify(watched->second.callback.Get());
+    endpoints.erase(watched);
+    return env.Undefined();
+}
+
+Napi::Value audio_device_interface::get_endpoint_volume(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "getEndpointVolume requires a device id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ComPtr<IAudioEndpointVolume> volume;
+    HRESULT hr = get_endpoint_volume_control(get_endpoint_id(info[0]), volume.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to get endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    return get_js_volume(volume.Get(), env);
+}
+
+Napi::Value audio_device_interface::set_endpoint_volume(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsNumber())
+    {
+        Napi::Error::New(env, "setEndpointVolume requires a device id and a volume.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ComPtr<IAudioEndpointVolume> volume;
+    HRESULT hr = get_endpoint_volume_control(get_endpoint_id(info[0]), volume.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to get endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    const float level = std::clamp(info[1].As<Napi::Number>().FloatValue(), 0.0f, 1.0f);
+    hr = volume->SetMasterVolumeLevelScalar(level, &castmate_volume_context);
+    if (error_handler(hr, "Unable to set endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value audio_device_interface::set_endpoint_mute(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsString() || !info[1].IsBoolean())
+    {
+        Napi::Error::New(env, "setEndpointMute requires a device id and a boolean.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    ComPtr<IAudioEndpointVolume> volume;
+    HRESULT hr = get_endpoint_volume_control(get_endpoint_id(info[0]), volume.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to get endpoint volume", env))
+    {
+        return env.Undefined();
+    }
+
+    hr = volume->SetMute(info[1].As<Napi::Boolean>().Value() ? TRUE : FALSE, &castmate_volume_context);
+    if (error_handler(hr, "Unable to set endpoint mute", env))
+    {
+        return env.Undefined();
+    }
+
+    return env.Undefined();
+}
+
+Napi::Value audio_device_interface::get_endpoint_peak(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "getEndpointPeak requires a device id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto watched = endpoints.find(get_endpoint_id(info[0]));
+    if (watched == endpoints.end())
+    {
+        Napi::Error::New(env, "getEndpointPeak requires a watched endpoint.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    endpoint_watch& watch = watched->second;
+    const auto now = std::chrono::steady_clock::now();
+    if (now - watch.peak_read >= peak_read_interval)
+    {
+        float peak = 0.0f;
+        HRESULT hr = watch.meter->GetPeakValue(&peak);
+        if (error_handler(hr, "Unable to read endpoint peak", env))
+        {
+            return env.Undefined();
+        }
+
+        watch.peak = peak;
+        watch.peak_read = now;
+    }
+
+    return Napi::Number::New(env, watch.peak);
+}
+
+//getEndpointFormat(deviceId) the endpoint's mix format, undefined if it isn't active
+Napi::Value audio_device_interface::get_endpoint_format(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "getEndpointFormat requires a device id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const std::wstring id = get_endpoint_id(info[0]);
+
+    ComPtr<IMMDevice> device;
+    HRESULT hr = device_enum->GetDevice(id.c_str(), device.ReleaseAndGetAddressOf());
+    if (error_handler(hr, "Unable to find audio device", env))
+    {
+        return env.Undefined();
+    }
+
+    endpoint_format format;
+    if (!formats.get(device.Get(), id, format))
+    {
+        return env.Undefined();
+    }
+
+    return make_js_endpoint_format(env, format);
+}
+
+Napi::Value audio_device_interface::get_format_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("hits", Napi::Number::New(env, double(formats.hits())));
+    result.Set("queries", Napi::Number::New(env, double(formats.queries())));
+    return result;
+}
+
 void audio_device_interface::Finalize(Napi::Env env)
 {
+    for (auto& [id, watch] : endpoints)
+    {
+        watch.volume->UnregisterControlChangeNotify(watch.callback.Get());
+    }
+    endpoints.clear();
+
     device_enum->UnregisterEndpointNotificationCallback(notifier.Get());
     notifier.Reset();
 }
 
-void audio_device_notifier::finalizer(Napi::Env env, void* data, audio_device_notifier* context)
-{
-    //Finally delete the context here now that both COM and v8 are done with it.
-    delete context;
-}
+//Device notifications are rare, this only fills if JS stalls through a storm of them
+static const size_t device_event_capacity = 256;
 
 audio_device_notifier::audio_device_notifier(Napi::Env env, audio_device_interface* device_interface)
-    : tsfn(Napi::ThreadSafeFunction::New(env,
-        device_interface->emit,
-        "AudioDeviceNotifierCallback",
-        0,
-        1,
-        this,
-        finalizer,
-        (void*)nullptr
-    ))
-    , device_interface(device_interface)
+    : device_interface(device_interface)
 {
+    events.open(env, device_interface->emit.Value(), "AudioDeviceNotifierCallback", device_event_capacity);
 }
 
 HRESULT audio_device_notifier::OnDefaultDeviceChanged(EDataFlow flow, ERole role, LPCWSTR pwstrDefaultDeviceId)
@@ -297,15 +575,13 @@ HRESULT audio_device_notifier::OnDefaultDeviceChanged(EDataFlow flow, ERole role
         return NOERROR;
     }
 
-    auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback, IMMDevice* device_ptr)
+    endpoint_format_cache* formats = &device_interface->formats;
+    auto js_thread_callback = [=](Napi::Env env, Napi::Function js_callback)
     {
-        //Use a smart pointer so we get auto-release
-        ComPtr<IMMDevice> device;
-        (*device.ReleaseAndGetAddressOf()) = device_ptr;
-
+        //env might be null if the tsfn is aborted
         if (env == nullptr || js_callback == nullptr) return;
 
-        Napi::Value js_device = get_js_device(device.Get(), env);
+        Napi::Value js_device = get_js_device(device.Get(), env, formats);
 
         Napi::String type_str;
 
@@ -332,8 +608,7 @@ HRESULT audio_device_notifier::OnDefaultDeviceChanged(EDataFlow flow, ERole role
         }
     };
 
-    device->AddRef();
-    tsfn.NonBlockingCall(device.Get(), js_thread_callback);
+    events.post(js_thread_callback);
 
     return NOERROR;
 }
@@ -347,46 +622,47 @@ HRESULT audio_device_notifier::OnDeviceAdded(LPCWSTR pwstrDeviceId)
         return NOERROR;
     }
 
-    auto js_thread_callback = [](Napi::Env env, Napi::Function js_callback, IMMDevice* device_ptr)
+    endpoint_format_cache* formats = &device_interface->formats;
+    //The ComPtr copy keeps the device alive until the callback has run
+    auto js_thread_callback = [formats, device](Napi::Env env, Napi::Function js_callback)
     {
-        //Use a smart pointer so we get auto-release
-        ComPtr<IMMDevice> device;
-        (*device.ReleaseAndGetAddressOf()) = device_ptr;
-
         //env might be null if the tsfn is aborted
         if (env == nullptr || js_callback == nullptr) return;
 
-        Napi::Value js_device = get_js_device(device.Get(), env);
+        Napi::Value js_device = get_js_device(device.Get(), env, formats);
 
         js_callback.Call({Napi::String::New(env, "device-added"), js_device});
 
     };
 
-    device->AddRef();
-    tsfn.NonBlockingCall(device.Get(), js_thread_callback);
+    events.post(js_thread_callback);
 
     return NOERROR;
 }
 
 HRESULT audio_device_notifier::OnDeviceRemoved(LPCWSTR pwstrDeviceId)
 {
-    std::wstring* id_str = new std::wstring(pwstrDeviceId);
+    device_interface->formats.invalidate(pwstrDeviceId);
 
-    auto js_thread_callback = [](Napi::Env env, Napi::Function js_callback, std::wstring* id_ptr)
+    std::wstring id(pwstrDeviceId);
+
+    auto js_thread_callback = [id](Napi::Env env, Napi::Function js_callback)
     {
-        std::unique_ptr<std::wstring> id(id_ptr);
         //env might be null if the tsfn is aborted
         if (env == nullptr || js_callback == nullptr) return;
 
-        js_callback.Call({Napi::String::New(env, "device-removed"), Napi::String::New(env, std::u16string(id->begin(), id->end()))});
+        js_callback.Call({Napi::String::New(env, "device-removed"), Napi::String::New(env, std::u16string(id.begin(), id.end()))});
     };
 
-    tsfn.NonBlockingCall(id_str, js_thread_callback);
+    events.post(js_thread_callback);
     return NOERROR;
 }
 
 HRESULT audio_device_notifier::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD dwNewState)
 {
+    //An endpoint coming back active may come back at a different format
+    device_interface->formats.invalidate(pwstrDeviceId);
+
     ComPtr<IMMDevice> device;
     device_interface->get_device_by_id(pwstrDeviceId, device.ReleaseAndGetAddressOf());
 
@@ -394,29 +670,34 @@ HRESULT audio_device_notifier::OnDeviceStateChanged(LPCWSTR pwstrDeviceId, DWORD
         return NOERROR;
     }
 
-     auto js_thread_callback = [](Napi::Env env, Napi::Function js_callback, IMMDevice* device_ptr)
+     endpoint_format_cache* formats = &device_interface->formats;
+    //The ComPtr copy keeps the device alive until the callback has run
+    auto js_thread_callback = [formats, device](Napi::Env env, Napi::Function js_callback)
     {
-        //Use a smart pointer so we get auto-release
-        ComPtr<IMMDevice> device;
-        (*device.ReleaseAndGetAddressOf()) = device_ptr;
-
         //env might be null if the tsfn is aborted
         if (env == nullptr || js_callback == nullptr) return;
 
-        Napi::Value js_device = get_js_device(device.Get(), env);
+        Napi::Value js_device = get_js_device(device.Get(), env, formats);
 
         js_callback.Call({Napi::String::New(env, "device-changed"), js_device});
     };
 
-    device->AddRef();
-    tsfn.NonBlockingCall(device.Get(), js_thread_callback);
+    events.post(js_thread_callback);
 
     return NOERROR;
 }
 
 HRESULT audio_device_notifier::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, const PROPERTYKEY key)
 {
-    if (key != PKEY_Device_FriendlyName && key != PKEY_Device_DeviceDesc) return NOERROR;
+    if (key == PKEY_AudioEngine_DeviceFormat)
+    {
+        //The user picked a new default format, the mix format follows it
+        device_interface->formats.invalidate(pwstrDeviceId);
+    }
+    else if (key != PKEY_Device_FriendlyName && key != PKEY_Device_DeviceDesc)
+    {
+        return NOERROR;
+    }
 
     ComPtr<IMMDevice> device;
     device_interface->get_device_by_id(pwstrDeviceId, device.ReleaseAndGetAddressOf());
@@ -425,22 +706,19 @@ HRESULT audio_device_notifier::OnPropertyValueChanged(LPCWSTR pwstrDeviceId, con
         return NOERROR;
     }
 
-    auto js_thread_callback = [](Napi::Env env, Napi::Function js_callback, IMMDevice* device_ptr)
+    endpoint_format_cache* formats = &device_interface->formats;
+    //The ComPtr copy keeps the device alive until the callback has run
+    auto js_thread_callback = [formats, device](Napi::Env env, Napi::Function js_callback)
     {
-        //Use a smart pointer so we get auto-release
-        ComPtr<IMMDevice> device;
-        (*device.ReleaseAndGetAddressOf()) = device_ptr;
-
         //env might be null if the tsfn is aborted
         if (env == nullptr || js_callback == nullptr) return;
 
-        Napi::Value js_device = get_js_device(device.Get(), env);
+        Napi::Value js_device = get_js_device(device.Get(), env, formats);
 
         js_callback.Call({Napi::String::New(env, "device-changed"), js_device});
     };
 
-    device->AddRef();
-    tsfn.NonBlockingCall(device.Get(), js_thread_callback);
+    events.post(js_thread_callback);
 
     return NOERROR;
 }
@@ -458,9 +736,9 @@ ULONG audio_device_notifier::Release()
     ULONG ulRefCount = InterlockedDecrement(&ref_count);
     if (0 == ref_count)
     {
-        //delete this;
-        //Instead of deleting here, tell the threaded system we're done with it.
-        tsfn.Release();
+        //Anything still queued keeps its own copy of what it needs, the dispatcher outlives us on its own
+        events.close();
+        delete this;
     }
     return ulRefCount;
 }
@@ -7,6 +7,14 @@
 #include <mmdeviceapi.h>
 #include <functiondiscoverykeys_devpkey.h>
 
+#include <map>
+#include <string>
+
+#include "castmate-native/event-dispatcher.hh"
+
+#include "endpoint-volume.hh"
+#include "endpoint-format.hh"
+
 class audio_device_interface;
 class audio_device_notifier : public IMMNotificationClient
 {
@@ -27,9 +35,8 @@ public:
     ULONG Release() override;
     HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **ppvObject) override;
 
-    Napi::ThreadSafeFunction tsfn;
-
-    static void finalizer(Napi::Env env, void* data, audio_device_notifier* context);
+    //Device changes come from COM's notification threads
+    js_call_dispatcher events;
 };
 
 class audio_device_interface : public Napi::ObjectWrap<audio_device_interface>
@@ -43,13 +50,29 @@ public:
     Napi::Value get_default_output(const Napi::CallbackInfo& info);
     Napi::Value get_default_input(const Napi::CallbackInfo& info);
 
+    Napi::Value watch_endpoint(const Napi::CallbackInfo& info);
+    Napi::Value unwatch_endpoint(const Napi::CallbackInfo& info);
+    Napi::Value get_endpoint_volume(const Napi::CallbackInfo& info);
+    Napi::Value set_endpoint_volume(const Napi::CallbackInfo& info);
+    Napi::Value set_endpoint_mute(const Napi::CallbackInfo& info);
+    Napi::Value get_endpoint_peak(const Napi::CallbackInfo& info);
+    Napi::Value get_endpoint_format(const Napi::CallbackInfo& info);
+    Napi::Value get_format_stats(const Napi::CallbackInfo& info);
+
     void Finalize(Napi::Env env) override;
 
     friend class audio_device_notifier;
 
     HRESULT get_device_by_id(LPCWSTR id, IMMDevice** pDevice);
 private:
-    Napi::Function emit;
+    //The watched endpoint's interface, or a new one for an endpoint that isn't watched
+    HRESULT get_endpoint_volume_control(const std::wstring& id, IAudioEndpointVolume** volume);
+
+    Napi::FunctionReference emit;
     Microsoft::WRL::ComPtr<IMMDeviceEnumerator> device_enum;
     Microsoft::WRL::ComPtr<audio_device_notifier> notifier;
+
+    std::map<std::wstring, endpoint_watch> endpoints;
+    //Also reached from the notifier's threads
+    endpoint_format_cache formats;
 };
@@ -0,0 +1,80 @@
+#include "endpoint-format.hh"
+
+#include <memory>
+
+#include <audioclient.h>
+#include <mmreg.h>
+#include <ksmedia.h>
+
+using namespace Microsoft::WRL;
+
+static HRESULT query_mix_format(IMMDevice* device, endpoint_format& format)
+{
+    ComPtr<IAudioClient> audio_client;
+    HRESULT hr = device->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr, (void**)audio_client.ReleaseAndGetAddressOf());
+    if (FAILED(hr)) return hr;
+
+    WAVEFORMATEX* mix_format = nullptr;
+    hr = audio_client->GetMixFormat(&mix_format);
+    if (FAILED(hr)) return hr;
+    std::unique_ptr<WAVEFORMATEX, decltype(&::CoTaskMemFree)> mix_format_owner(mix_format, &::CoTaskMemFree);
+
+    format.sample_rate = mix_format->nSamplesPerSec;
+    format.channels = mix_format->nChannels;
+    format.bits_per_sample = mix_format->wBitsPerSample;
+    format.channel_mask = 0;
+    format.is_float = mix_format->wFormatTag == WAVE_FORMAT_IEEE_FLOAT;
+
+    if (mix_format->wFormatTag == WAVE_FORMAT_EXTENSIBLE && mix_format->cbSize >= sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX))
+    {
+        const WAVEFORMATEXTENSIBLE* extensible = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(mix_format);
+        format.channel_mask = extensible->dwChannelMask;
+        format.is_float = IsEqualGUID(extensible->SubFormat, KSDATAFORMAT_SUBTYPE_IEEE_FLOAT) != FALSE;
+    }
+
+    return S_OK;
+}
+
+bool endpoint_format_cache::get(IMMDevice* device, const std::wstring& id, endpoint_format& format)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto cached = formats.find(id);
+        if (cached != formats.end())
+        {
+            ++hit_count;
+            format = cached->second;
+            return true;
+        }
+    }
+
+    DWORD state = 0;
+    if (FAILED(device->GetState(&state)) || state != DEVICE_STATE_ACTIVE) return false;
+
+    //Queried outside the lock, activating a client can block on the audio service
+    endpoint_format queried;
+    if (FAILED(query_mix_format(device, queried))) return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ++query_count;
+    formats[id] = queried;
+    format = queried;
+    return true;
+}
+
+void endpoint_format_cache::invalidate(const std::wstring& id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    formats.erase(id);
+}
+
+Napi::Object make_js_endpoint_format(Napi::Env env, const endpoint_format& format)
+{
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("sampleRate", Napi::Number::New(env, format.sample_rate));
+    result.Set("channels", Napi::Number::New(env, format.channels));
+    result.Set("bitsPerSample", Napi::Number::New(env, format.bits_per_sample));
+    result.Set("channelMask", Napi::Number::New(env, format.channel_mask));
+    result.Set("float", Napi::Boolean::New(env, format.is_float));
+    return result;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <napi.h>
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include <wrl.h>
+#include <mmdeviceapi.h>
+
+//The shared mode mix format of an endpoint, what the audio engine runs at and converts everything else to
+struct endpoint_format
+{
+    uint32_t sample_rate = 0;
+    uint16_t channels = 0;
+    uint16_t bits_per_sample = 0;
+    //Speaker positions, 0 if the format doesn't say
+    uint32_t channel_mask = 0;
+    bool is_float = false;
+};
+
+//Mix formats by endpoint id. Reading one activates an audio client, which is far too slow to repeat every time
+//the device list is built, so each endpoint is only asked once until it changes state or format.
+//Safe to use from any thread, the device notifier invalidates from a COM thread.
+class endpoint_format_cache
+{
+public:
+    //False if the endpoint isn't active or won't report a format
+    bool get(IMMDevice* device, const std::wstring& id, endpoint_format& format);
+    void invalidate(const std::wstring& id);
+
+    uint64_t hits() const { return hit_count; }
+    uint64_t queries() const { return query_count; }
+
+private:
+    std::mutex mutex;
+    std::map<std::wstring, endpoint_format> formats;
+    std::atomic<uint64_t> hit_count { 0 };
+    std::atomic<uint64_t> query_count { 0 };
+};
+
+Napi::Object make_js_endpoint_format(Napi::Env env, const endpoint_format& format);
@@ -0,0 +1,113 @@
+#include "endpoint-volume.hh"
+
+#include <memory>
+
+// {6C0F3A52-8E43-4B7A-9B0D-2F5C4E1A7D31}
+const GUID castmate_volume_context = { 0x6c0f3a52, 0x8e43, 0x4b7a, { 0x9b, 0x0d, 0x2f, 0x5c, 0x4e, 0x1a, 0x7d, 0x31 } };
+
+void endpoint_volume_callback::finalizer(Napi::Env env, void* data, endpoint_volume_callback* context)
+{
+    //Both COM and v8 are done with it once the tsfn finalizes
+    delete context;
+}
+
+endpoint_volume_callback::endpoint_volume_callback(Napi::Env env, Napi::Function emit, const std::wstring& device_id)
+    : device_id(device_id)
+    , tsfn(Napi::ThreadSafeFunction::New(env,
+        emit,
+        "EndpointVolumeCallback",
+        0,
+        1,
+        this,
+        finalizer,
+        (void*)nullptr
+    ))
+{
+}
+
+HRESULT endpoint_volume_callback::OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA data)
+{
+    if (data == nullptr) return E_INVALIDARG;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        volume = data->fMasterVolume;
+        muted = data->bMuted != FALSE;
+        from_castmate = IsEqualGUID(data->guidEventContext, castmate_volume_context) != FALSE;
+
+        //The post already queued will pick this state up
+        if (pending) return S_OK;
+        pending = true;
+    }
+
+    auto js_thread_callback = [](Napi::Env env, Napi::Function js_callback, endpoint_volume_callback* callback_ptr)
+    {
+        //Holds the reference taken when this was posted
+        Microsoft::WRL::ComPtr<endpoint_volume_callback> callback;
+        (*callback.ReleaseAndGetAddressOf()) = callback_ptr;
+
+        float volume;
+        bool muted;
+        bool from_castmate;
+        {
+            std::lock_guard<std::mutex> lock(callback->mutex);
+            volume = callback->volume;
+            muted = callback->muted;
+            from_castmate = callback->from_castmate;
+            callback->pending = false;
+        }
+
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({
+            Napi::String::New(env, "endpoint-volume-changed"),
+            Napi::String::New(env, std::u16string(callback->device_id.begin(), callback->device_id.end())),
+            Napi::Number::New(env, volume),
+            Napi::Boolean::New(env, muted),
+            Napi::Boolean::New(env, from_castmate),
+        });
+    };
+
+    AddRef();
+    if (tsfn.NonBlockingCall(this, js_thread_callback) != napi_ok)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = false;
+        }
+        Release();
+    }
+    return S_OK;
+}
+
+ULONG endpoint_volume_callback::AddRef()
+{
+    return InterlockedIncrement(&ref_count);
+}
+
+ULONG endpoint_volume_callback::Release()
+{
+    ULONG count = InterlockedDecrement(&ref_count);
+    if (count == 0)
+    {
+        //Deleted by the tsfn finalizer, v8 might still be holding the function
+        tsfn.Release();
+    }
+    return count;
+}
+
+HRESULT endpoint_volume_callback::QueryInterface(REFIID riid, void** ppvObject)
+{
+    if (!ppvObject)
+        return E_INVALIDARG;
+    *ppvObject = nullptr;
+
+    if (riid == IID_IUnknown || riid == __uuidof(IAudioEndpointVolumeCallback))
+    {
+        (*ppvObject) = static_cast<void*>(this);
+        AddRef();
+        return NOERROR;
+    }
+    return E_NOINTERFACE;
+}
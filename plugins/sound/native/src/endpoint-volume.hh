@@ -0,0 +1,58 @@
+#pragma once
+
+#include <napi.h>
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include <wrl.h>
+#include <mmdeviceapi.h>
+#include <endpointvolume.h>
+
+//Event context passed with volume and mute changes CastMate makes, so listeners can tell them from the user's
+extern const GUID castmate_volume_context;
+
+//Volume and mute notifications for one endpoint. Windows notifies on every step of a dragged slider, only the
+//latest state is kept and at most one post to JS is in flight per endpoint, that post reads whatever is newest.
+//  ("endpoint-volume-changed", deviceId, volume, muted, fromCastMate)
+class endpoint_volume_callback : public IAudioEndpointVolumeCallback
+{
+public:
+    endpoint_volume_callback(Napi::Env env, Napi::Function emit, const std::wstring& device_id);
+
+    //IAudioEndpointVolumeCallback
+    HRESULT STDMETHODCALLTYPE OnNotify(PAUDIO_VOLUME_NOTIFICATION_DATA data) override;
+
+    //IUNKNOWN
+    ULONG STDMETHODCALLTYPE AddRef() override;
+    ULONG STDMETHODCALLTYPE Release() override;
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void** ppvObject) override;
+
+    static void finalizer(Napi::Env env, void* data, endpoint_volume_callback* context);
+
+private:
+    long volatile ref_count = 0;
+    std::wstring device_id;
+    Napi::ThreadSafeFunction tsfn;
+
+    std::mutex mutex;
+    float volume = 0.0f;
+    bool muted = false;
+    bool from_castmate = false;
+    bool pending = false;
+};
+
+//An endpoint being tracked. The peak meter has no notification, reads are served from the last value until
+//peak_read_interval has passed so a UI can ask every animation frame without hitting the driver every time.
+struct endpoint_watch
+{
+    Microsoft::WRL::ComPtr<IAudioEndpointVolume> volume;
+    Microsoft::WRL::ComPtr<IAudioMeterInformation> meter;
+    Microsoft::WRL::ComPtr<endpoint_volume_callback> callback;
+
+    float peak = 0.0f;
+    std::chrono::steady_clock::time_point peak_read;
+};
+
+static const std::chrono::milliseconds peak_read_interval(33);
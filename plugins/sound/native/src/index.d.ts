@@ -7,6 +7,34 @@ declare namespace CastmatePluginSoundNative {
 		"device-changed": (device: AudioDevice) => void | Promise<void>
 		"default-input-changed": (type: "main" | "chat", device: AudioDevice) => void | Promise<void>
 		"default-output-changed": (type: "main" | "chat", device: AudioDevice) => void | Promise<void>
+		/** Only sent for watched endpoints, a burst of changes arrives as one event with the latest state */
+		"endpoint-volume-changed": (
+			deviceId: string,
+			volume: number,
+			muted: boolean,
+			fromCastMate: boolean
+		) => void | Promise<void>
+	}
+
+	interface EndpointVolume {
+		/** 0 to 1 */
+		volume: number
+		muted: boolean
+	}
+
+	/** The shared mode mix format the audio engine runs the endpoint at */
+	interface EndpointFormat {
+		sampleRate: number
+		channels: number
+		bitsPerSample: number
+		channelMask: number
+		float: boolean
+	}
+
+	interface EndpointFormatStats {
+		/** Lookups answered without opening an audio client */
+		hits: number
+		queries: number
 	}
 
 	interface AudioDevice {
@@ -15,6 +43,8 @@ declare namespace CastmatePluginSoundNative {
 		state: "active" | "disabled" | "not_present" | "unplugged" | "unknown"
 		name: string
 		guid: string
+		/** Only for active devices, cached until the device or its format changes */
+		format?: EndpointFormat
 	}
 
 	class AudioDeviceInterface extends Events.EventEmitter {
@@ -22,6 +52,19 @@ declare namespace CastmatePluginSoundNative {
 		getDefaultOutput(type: "main" | "chat"): AudioDevice | undefined
 		getDefaultInput(type: "main" | "chat"): AudioDevice | undefined
 
+		/** Starts endpoint-volume-changed events for the device and returns its current state */
+		watchEndpoint(deviceId: string): EndpointVolume
+		unwatchEndpoint(deviceId: string): void
+		getEndpointVolume(deviceId: string): EndpointVolume
+		/** 0 to 1 */
+		setEndpointVolume(deviceId: string, volume: number): void
+		setEndpointMute(deviceId: string, muted: boolean): void
+		/** Peak level 0 to 1 of a watched endpoint, the hardware meter is read at most every 33ms */
+		getEndpointPeak(deviceId: string): number
+		/** Undefined if the device isn't active */
+		getEndpointFormat(deviceId: string): EndpointFormat | undefined
+		getFormatStats(): EndpointFormatStats
+
 		on<U extends keyof AudioDeviceInterfaceEvents>(event: U, listener: AudioDeviceInterfaceEvents[U]): this
 
 		once<U extends keyof AudioDeviceInterfaceEvents>(event: U, listener: AudioDeviceInterfaceEvents[U]): this
@@ -34,15 +77,214 @@ declare namespace CastmatePluginSoundNative {
 		): boolean
 	}
 
+	interface VoiceActivityOptions {
+		/** Analysis hop, 10 to 20 */
+		frameMs?: number
+		/** How long speech has to hold before speech-start */
+		attackMs?: number
+		/** How long speech has to be gone before speech-end */
+		hangoverMs?: number
+		/** Per frame speech probability, 0 to 1 */
+		threshold?: number
+	}
+
+	interface VoiceActivityDetectorEvents {
+		/** Confidence is the mean frame probability over the attack */
+		"speech-start": (confidence: number) => void | Promise<void>
+		/** Confidence is the mean frame probability over the utterance */
+		"speech-end": (confidence: number, durationMs: number) => void | Promise<void>
+		/** Capture has stopped */
+		error: (message: string) => void | Promise<void>
+	}
+
+	class VoiceActivityDetector extends Events.EventEmitter {
+		/** Captures the device on a native thread, "main" and "chat" are the default inputs. Restarts if already running. */
+		start(device: "main" | "chat" | string, options?: VoiceActivityOptions): boolean
+		stop(): void
+
+		on<U extends keyof VoiceActivityDetectorEvents>(event: U, listener: VoiceActivityDetectorEvents[U]): this
+
+		once<U extends keyof VoiceActivityDetectorEvents>(event: U, listener: VoiceActivityDetectorEvents[U]): this
+
+		off<U extends keyof VoiceActivityDetectorEvents>(event: U, listener: VoiceActivityDetectorEvents[U]): this
+
+		emit<U extends keyof VoiceActivityDetectorEvents>(
+			event: U,
+			...args: Parameters<VoiceActivityDetectorEvents[U]>
+		): boolean
+	}
+
+	interface FingerprintClip {
+		id: string
+		/** 16 bit wav, any rate and channel count */
+		file: string
+	}
+
+	interface AudioFingerprinterOptions {
+		/** Capture what the output device is playing instead of an input */
+		loopback?: boolean
+		/** Landmarks that have to agree before a clip is reported, defaults to 26 */
+		minMatches?: number
+	}
+
+	interface AudioFingerprinterEvents {
+		/** Confidence is 0 to 1, latencyMs is how far into the clip it was recognized */
+		match: (clipId: string, confidence: number, latencyMs: number) => void | Promise<void>
+		/** Capture has stopped */
+		error: (message: string) => void | Promise<void>
+	}
+
+	class AudioFingerprinter extends Events.EventEmitter {
+		/** Fingerprints the clips off the main thread and swaps them in, a running capture restarts on them */
+		setClips(clips: FingerprintClip[]): Promise<void>
+		/**
+		 * Listens on a native thread, "main" and "chat" are the default devices. Nothing is captured until setClips
+		 * has finished with at least one clip. Restarts if already running.
+		 */
+		start(device: "main" | "chat" | string, options?: AudioFingerprinterOptions): boolean
+		stop(): void
+
+		on<U extends keyof AudioFingerprinterEvents>(event: U, listener: AudioFingerprinterEvents[U]): this
+
+		once<U extends keyof AudioFingerprinterEvents>(event: U, listener: AudioFingerprinterEvents[U]): this
+
+		off<U extends keyof AudioFingerprinterEvents>(event: U, listener: AudioFingerprinterEvents[U]): this
+
+		emit<U extends keyof AudioFingerprinterEvents>(
+			event: U,
+			...args: Parameters<AudioFingerprinterEvents[U]>
+		): boolean
+	}
+
+	interface MixStreamOptions {
+		/** Frame length, 5 to 60, 20 by default. Rounded down to 5, 10, 20, 40 or 60 so Opus can encode it. */
+		frameMs?: number
+	}
+
+	interface MixStreamStats {
+		running: boolean
+		/** Frames mixed, each is then encoded once per enabled codec */
+		framesEncoded: number
+		opusFrames: number
+		pcmFrames: number
+		/** Frames dropped because JS fell behind, since the stream started */
+		eventsDropped: number
+		/** False if the Opus encoder couldn't be created, Opus listeners are sent PCM frames instead */
+		opusAvailable: boolean
+	}
+
+	interface MixStreamEvents {
+		/**
+		 * One 48kHz stereo frame in one codec, encoded once for every listener: an 8 byte header of sequence (u32), frame
+		 * count (u16), channels (u8) and flags (u8, 1 = resync after idle, 2 = Opus), then one Opus packet, or
+		 * interleaved 16 bit little endian samples without the Opus flag. Both codecs share the sequence.
+		 */
+		frame: (frame: Buffer) => void | Promise<void>
+		/** The file played out, was cancelled, or the stream stopped */
+		"voice-end": (id: number) => void | Promise<void>
+		/** The Opus encoder couldn't be created, the stream falls back to PCM frames for Opus listeners */
+		"encode-error": (message: string) => void | Promise<void>
+	}
+
+	class MixStream extends Events.EventEmitter {
+		/** Starts the encoder thread, it sleeps whenever nothing is playing */
+		start(options?: MixStreamOptions): boolean
+		/** Ends everything playing */
+		stop(): void
+		/** Resolves once the file is playing. Only 48kHz 16 bit mono or stereo wav. Volume is 0 to 100. */
+		play(id: number, file: string, startSec: number, endSec: number, volume: number): Promise<void>
+		cancel(id: number): void
+		/** Which codecs frames are encoded in, Opus only by default. PCM is for players without an Opus decoder. */
+		setCodecs(opus: boolean, pcm: boolean): void
+		getStats(): MixStreamStats
+
+		on<U extends keyof MixStreamEvents>(event: U, listener: MixStreamEvents[U]): this
+
+		once<U extends keyof MixStreamEvents>(event: U, listener: MixStreamEvents[U]): this
+
+		off<U extends keyof MixStreamEvents>(event: U, listener: MixStreamEvents[U]): this
+
+		emit<U extends keyof MixStreamEvents>(event: U, ...args: Parameters<MixStreamEvents[U]>): boolean
+	}
+
 	interface OsTTSVoice {
 		id: string
 		name: string
 	}
 
+	type OsTTSSegmentedCallback = (
+		...args:
+			| [event: "segment", index: number, file: string]
+			| [event: "done", segmentCount: number, joinedFile: string]
+			| [event: "error", message: string]
+	) => any
+
 	class OsTTSInterface {
 		getVoices(): OsTTSVoice[]
 		speakToFile(message: string, filename: string, voiceId: string, callback: (err?: string) => any): boolean
+		/**
+		 * Splits the message on sentences and synthesizes them in parallel, each segment is written to
+		 * `${fileBase}-${index}.wav` and reported in order as soon as it and everything before it is ready.
+		 * The segments are also joined into `${fileBase}.wav`. A thread count of 0 picks one from the core count.
+		 */
+		speakSegmented(
+			message: string,
+			fileBase: string,
+			voiceId: string,
+			threads: number,
+			callback: OsTTSSegmentedCallback
+		): boolean
+	}
+
+	/**
+	 * Renders a rate and pitch variant of a 16 bit mono wav. Rate is a speed factor clamped to [0.25, 4],
+	 * pitch is in semitones clamped to +-12. Duration only follows rate.
+	 */
+	function stretchWav(
+		input: string,
+		output: string,
+		rate: number,
+		semitones: number,
+		callback: (err?: Error) => any
+	): void
+
+	interface WavFormat {
+		sampleRate: number
+		channels: number
+		bitsPerSample: number
 	}
+
+	/** Reads just the header of a PCM wav, undefined if the file isn't one */
+	function readWavFormat(file: string): WavFormat | undefined
+
+	interface LatencyStageStats {
+		count: number
+		/** Milliseconds */
+		p50: number
+		p90: number
+		p99: number
+		max: number
+		mean: number
+	}
+
+	/** output -> stage -> stats */
+	type LatencyStatsSnapshot = Record<string, Record<string, LatencyStageStats>>
+
+	class LatencyStats {
+		record(output: string, stage: string, ms: number): void
+		getStats(): LatencyStatsSnapshot
+		/** Clears a single output, or everything if none is given */
+		reset(output?: string): void
+	}
+
+	interface NativeTracer {
+		setTracingEnabled(enabled: boolean): void
+		/** Chrome trace event JSON of everything this addon recorded */
+		dumpTrace(): string
+		clearTrace(): void
+	}
+
+	const tracer: NativeTracer
 }
 
 export = CastmatePluginSoundNative
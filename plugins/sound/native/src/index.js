@@ -3,10 +3,19 @@ const EventEmitter = require("events")
 
 // console.log("Root?", __dirname)
 
-const { NativeAudioDeviceInterface, OsTTSInterface } = bindings({
+const native = bindings({
 	bindings: "castmate-plugin-sound-native",
 	// module_root: bindings.getRoot(import.meta.url),
 })
+const { NativeAudioDeviceInterface, OsTTSInterface, NativeLatencyStats, NativeVoiceActivity, NativeAudioFingerprinter, NativeMixStream, stretchWav, readWavFormat } =
+	native
+
+//Native tracing, see castmate-native-core/include/castmate-native/trace.hh
+const tracer = {
+	setTracingEnabled: native.setTracingEnabled,
+	dumpTrace: native.dumpTrace,
+	clearTrace: native.clearTrace,
+}
 
 class AudioDeviceInterface extends EventEmitter {
 	constructor() {
@@ -26,6 +35,134 @@ class AudioDeviceInterface extends EventEmitter {
 	getDefaultInput(type) {
 		return this._native.getDefaultInput(type)
 	}
+
+	watchEndpoint(deviceId) {
+		return this._native.watchEndpoint(deviceId)
+	}
+
+	unwatchEndpoint(deviceId) {
+		return this._native.unwatchEndpoint(deviceId)
+	}
+
+	getEndpointVolume(deviceId) {
+		return this._native.getEndpointVolume(deviceId)
+	}
+
+	setEndpointVolume(deviceId, volume) {
+		return this._native.setEndpointVolume(deviceId, volume)
+	}
+
+	setEndpointMute(deviceId, muted) {
+		return this._native.setEndpointMute(deviceId, muted)
+	}
+
+	getEndpointPeak(deviceId) {
+		return this._native.getEndpointPeak(deviceId)
+	}
+
+	getEndpointFormat(deviceId) {
+		return this._native.getEndpointFormat(deviceId)
+	}
+
+	getFormatStats() {
+		return this._native.getFormatStats()
+	}
+}
+
+class VoiceActivityDetector extends EventEmitter {
+	constructor() {
+		super()
+		const boundEmit = this.emit.bind(this)
+		this._native = new NativeVoiceActivity(boundEmit)
+	}
+
+	start(device, options) {
+		return this._native.start(device, options ?? {})
+	}
+
+	stop() {
+		return this._native.stop()
+	}
+}
+
+class AudioFingerprinter extends EventEmitter {
+	constructor() {
+		super()
+		const boundEmit = this.emit.bind(this)
+		this._native = new NativeAudioFingerprinter(boundEmit)
+	}
+
+	setClips(clips) {
+		return new Promise((resolve, reject) => {
+			this._native.setClips(clips, (err) => {
+				if (err) return reject(err)
+				resolve()
+			})
+		})
+	}
+
+	start(device, options) {
+		return this._native.start(device, options ?? {})
+	}
+
+	stop() {
+		return this._native.stop()
+	}
+}
+
+class MixStream extends EventEmitter {
+	constructor() {
+		super()
+		const boundEmit = this.emit.bind(this)
+		this._native = new NativeMixStream(boundEmit)
+	}
+
+	start(options) {
+		return this._native.start(options ?? {})
+	}
+
+	stop() {
+		return this._native.stop()
+	}
+
+	play(id, file, startSec, endSec, volume) {
+		return new Promise((resolve, reject) => {
+			this._native.play(id, file, startSec, endSec, volume, (err) => {
+				if (err) return reject(err)
+				resolve()
+			})
+		})
+	}
+
+	cancel(id) {
+		return this._native.cancel(id)
+	}
+
+	setCodecs(opus, pcm) {
+		return this._native.setCodecs(opus, pcm)
+	}
+
+	getStats() {
+		return this._native.getStats()
+	}
+}
+
+class LatencyStats {
+	constructor() {
+		this._native = new NativeLatencyStats()
+	}
+
+	record(output, stage, ms) {
+		return this._native.record(output, stage, ms)
+	}
+
+	getStats() {
+		return this._native.getStats()
+	}
+
+	reset(output) {
+		return this._native.reset(output)
+	}
 }
 
-module.exports = { AudioDeviceInterface, OsTTSInterface }
+module.exports = { AudioDeviceInterface, OsTTSInterface, VoiceActivityDetector, AudioFingerprinter, MixStream, LatencyStats, stretchWav, readWavFormat, tracer }
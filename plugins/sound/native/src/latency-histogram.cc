@@ -0,0 +1,80 @@
+#include "latency-histogram.hh"
+
+#include <algorithm>
+#include <cmath>
+
+static const int sub_bucket_bits = 5;
+static const uint64_t sub_bucket_count = 1 << sub_bucket_bits;
+//Up to 2^40us, about 12 days
+static const int max_exponent = 40;
+static const size_t bucket_count = (max_exponent - sub_bucket_bits + 2) * sub_bucket_count;
+
+static int highest_bit(uint64_t value)
+{
+    int bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+}
+
+latency_histogram::latency_histogram()
+    : counts(bucket_count, 0)
+{
+}
+
+size_t latency_histogram::bucket_index(uint64_t value)
+{
+    if (value < sub_bucket_count) return size_t(value);
+
+    const int exponent = std::min(highest_bit(value), max_exponent);
+    const uint64_t sub_bucket = (value >> (exponent - sub_bucket_bits)) & (sub_bucket_count - 1);
+    return size_t(exponent - sub_bucket_bits + 1) * sub_bucket_count + size_t(sub_bucket);
+}
+
+uint64_t latency_histogram::bucket_value(size_t index)
+{
+    if (index < sub_bucket_count) return index;
+
+    const int exponent = int(index / sub_bucket_count) + sub_bucket_bits - 1;
+    const uint64_t sub_bucket = index % sub_bucket_count;
+    const uint64_t width = uint64_t(1) << (exponent - sub_bucket_bits);
+
+    //Middle of the bucket
+    return (uint64_t(1) << exponent) + sub_bucket * width + width / 2;
+}
+
+void latency_histogram::record(uint64_t value_us)
+{
+    counts[std::min(bucket_index(value_us), bucket_count - 1)]++;
+    total++;
+    sum += value_us;
+    lowest = std::min(lowest, value_us);
+    highest = std::max(highest, value_us);
+}
+
+void latency_histogram::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    sum = 0;
+    lowest = UINT64_MAX;
+    highest = 0;
+}
+
+uint64_t latency_histogram::value_at_percentile(double percentile) const
+{
+    if (total == 0) return 0;
+
+    const uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(std::clamp(percentile, 0.0, 100.0) / 100.0 * total)));
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i)
+    {
+        seen += counts[i];
+        if (seen >= rank)
+        {
+            //Bucket midpoints can overshoot the real extremes
+            return std::clamp(bucket_value(i), lowest, highest);
+        }
+    }
+    return highest;
+}
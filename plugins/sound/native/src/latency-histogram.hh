@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//HDR style histogram of microsecond latencies. Values under 32us are exact, above that every power of two is split
+//into 32 linear buckets, so any reported value is within ~3% of the real one. Fixed size, recording is a couple of
+//shifts and an increment.
+class latency_histogram
+{
+public:
+    latency_histogram();
+
+    void record(uint64_t value_us);
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t max() const { return highest; }
+    uint64_t min() const { return total ? lowest : 0; }
+    double mean() const { return total ? double(sum) / total : 0; }
+
+    //percentile is 0-100
+    uint64_t value_at_percentile(double percentile) const;
+
+private:
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_value(size_t index);
+
+    std::vector<uint32_t> counts;
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t lowest = UINT64_MAX;
+    uint64_t highest = 0;
+};
@@ -0,0 +1,83 @@
+#include "latency-stats.hh"
+
+Napi::Object latency_stats::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeLatencyStats", {
+        InstanceMethod("record", &latency_stats::record),
+        InstanceMethod("getStats", &latency_stats::get_stats),
+        InstanceMethod("reset", &latency_stats::reset),
+    });
+
+    exports.Set("NativeLatencyStats", constructor);
+    return exports;
+}
+
+latency_stats::latency_stats(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<latency_stats>(info)
+{
+}
+
+//record(output, stage, milliseconds)
+Napi::Value latency_stats::record(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 3 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber())
+    {
+        Napi::Error::New(env, "record requires an output, a stage and a duration.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    const double ms = info[2].As<Napi::Number>().DoubleValue();
+    //Clock skew between processes can make a tiny stage come out negative
+    const uint64_t us = ms > 0 ? uint64_t(ms * 1000) : 0;
+
+    outputs[info[0].As<Napi::String>().Utf8Value()][info[1].As<Napi::String>().Utf8Value()].record(us);
+    return env.Undefined();
+}
+
+static Napi::Object histogram_to_js(Napi::Env env, const latency_histogram& histogram)
+{
+    Napi::Object stats = Napi::Object::New(env);
+    stats.Set("count", Napi::Number::New(env, double(histogram.count())));
+    stats.Set("p50", Napi::Number::New(env, histogram.value_at_percentile(50) / 1000.0));
+    stats.Set("p90", Napi::Number::New(env, histogram.value_at_percentile(90) / 1000.0));
+    stats.Set("p99", Napi::Number::New(env, histogram.value_at_percentile(99) / 1000.0));
+    stats.Set("max", Napi::Number::New(env, histogram.max() / 1000.0));
+    stats.Set("mean", Napi::Number::New(env, histogram.mean() / 1000.0));
+    return stats;
+}
+
+//getStats() -> { [output]: { [stage]: { count, p50, p90, p99, max, mean } } } in milliseconds
+Napi::Value latency_stats::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object result = Napi::Object::New(env);
+    for (const auto& output : outputs)
+    {
+        Napi::Object stages = Napi::Object::New(env);
+        for (const auto& stage : output.second)
+        {
+            stages.Set(stage.first, histogram_to_js(env, stage.second));
+        }
+        result.Set(output.first, stages);
+    }
+    return result;
+}
+
+//reset(output?) clears one output or everything
+Napi::Value latency_stats::reset(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() > 0 && info[0].IsString())
+    {
+        outputs.erase(info[0].As<Napi::String>().Utf8Value());
+    }
+    else
+    {
+        outputs.clear();
+    }
+    return env.Undefined();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <napi.h>
+
+#include <map>
+#include <string>
+
+#include "latency-histogram.hh"
+
+//Play latency broken down by stage, one set of histograms per sound output.
+class latency_stats : public Napi::ObjectWrap<latency_stats>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    latency_stats(const Napi::CallbackInfo& info);
+
+    Napi::Value record(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+    Napi::Value reset(const Napi::CallbackInfo& info);
+
+private:
+    //output -> stage -> histogram
+    std::map<std::string, std::map<std::string, latency_histogram>> outputs;
+};
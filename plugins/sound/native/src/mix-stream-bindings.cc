@@ -0,0 +1,321 @@
+#include "mix-stream-bindings.hh"
+#include "tts-pipeline.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "castmate-native/trace.hh"
+
+//About 600ms of 20ms frames with both codecs on
+static const size_t mix_stream_event_capacity = 64;
+
+//Reads a 48kHz 16 bit wav off the main thread, then plays it into the bus
+class mix_stream_load_worker : public Napi::AsyncWorker
+{
+    mix_stream_interface* owner;
+    Napi::ObjectReference owner_ref;
+    uint32_t id;
+    std::string file;
+    double start_sec;
+    double end_sec;
+    float gain;
+
+    std::shared_ptr<std::vector<int16_t>> pcm;
+    uint32_t channels = 0;
+public:
+    mix_stream_load_worker(mix_stream_interface* owner, const Napi::Object& owner_object, uint32_t id, const std::string& file, double start_sec, double end_sec, float gain, const Napi::Function& callback)
+        : AsyncWorker(callback)
+        , owner(owner)
+        , owner_ref(Napi::Persistent(owner_object))
+        , id(id)
+        , file(file)
+        , start_sec(start_sec)
+        , end_sec(end_sec)
+        , gain(gain)
+    {
+    }
+
+protected:
+    void Execute() override
+    {
+        TRACE_SCOPE("mix stream load");
+
+        tts_audio_format format;
+        std::vector<uint8_t> bytes;
+        std::string error;
+        if (!read_wav_file(file, format, bytes, error))
+        {
+            SetError(error);
+            return;
+        }
+
+        if (format.sample_rate != mix_stream_sample_rate || format.bits_per_sample != 16 || format.channels < 1 || format.channels > 2)
+        {
+            SetError("Only 48kHz 16 bit mono or stereo wav files can be streamed");
+            return;
+        }
+
+        //Samples are little endian on every platform CastMate runs on
+        pcm = std::make_shared<std::vector<int16_t>>(bytes.size() / 2);
+        memcpy(pcm->data(), bytes.data(), pcm->size() * 2);
+        channels = format.channels;
+    }
+
+    void OnOK() override
+    {
+        const size_t start = size_t(std::max(0.0, start_sec) * mix_stream_sample_rate);
+        //endSec is often Infinity for play to the end
+        const size_t end = std::isfinite(end_sec) ? size_t(std::max(0.0, end_sec) * mix_stream_sample_rate) : SIZE_MAX;
+
+        if (!owner->play_loaded(id, pcm, channels, start, end, gain))
+        {
+            Callback().Call({ Napi::Error::New(Env(), "The mix stream isn't running").Value() });
+            return;
+        }
+        Callback().Call({});
+    }
+};
+
+//readWavFormat(file) returns { sampleRate, channels, bitsPerSample } for a PCM wav, undefined for anything else.
+//Only the chunk headers are read so it's cheap enough to call before deciding whether a file needs decoding.
+static Napi::Value read_wav_format_js(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "readWavFormat requires a file.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    tts_audio_format format;
+    if (!read_wav_format(info[0].As<Napi::String>().Utf8Value(), format))
+    {
+        return env.Undefined();
+    }
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("sampleRate", Napi::Number::New(env, format.sample_rate));
+    result.Set("channels", Napi::Number::New(env, format.channels));
+    result.Set("bitsPerSample", Napi::Number::New(env, format.bits_per_sample));
+    return result;
+}
+
+Napi::Object mix_stream_interface::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeMixStream", {
+        InstanceMethod("start", &mix_stream_interface::start),
+        InstanceMethod("stop", &mix_stream_interface::stop),
+        InstanceMethod("play", &mix_stream_interface::play),
+        InstanceMethod("cancel", &mix_stream_interface::cancel),
+        InstanceMethod("setCodecs", &mix_stream_interface::set_codecs),
+        InstanceMethod("getStats", &mix_stream_interface::get_stats),
+    });
+
+    exports.Set("NativeMixStream", constructor);
+    exports.Set("readWavFormat", Napi::Function::New(env, read_wav_format_js, "readWavFormat"));
+    return exports;
+}
+
+//Runs on the JS thread after every delivered event
+static void deliver_notices(Napi::Env env, Napi::Function js_callback, mix_stream_notices& notices)
+{
+    std::vector<uint32_t> finished;
+    std::vector<std::string> errors;
+    {
+        std::lock_guard<std::mutex> lock(notices.mutex);
+        finished.swap(notices.finished);
+        errors.swap(notices.errors);
+    }
+
+    for (const std::string& error : errors)
+    {
+        js_callback.Call({ Napi::String::New(env, "encode-error"), Napi::String::New(env, error) });
+    }
+    for (uint32_t id : finished)
+    {
+        js_callback.Call({ Napi::String::New(env, "voice-end"), Napi::Number::New(env, id) });
+    }
+}
+
+mix_stream_interface::mix_stream_interface(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<mix_stream_interface>(info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsFunction())
+    {
+        Napi::Error::New(env, "NativeMixStream requires a callback.").ThrowAsJavaScriptException();
+        return;
+    }
+
+    emit = Napi::Persistent(info[0].As<Napi::Function>());
+}
+
+mix_stream_interface::~mix_stream_interface()
+{
+    stop_stream();
+}
+
+void mix_stream_interface::Finalize(Napi::Env env)
+{
+    stop_stream();
+}
+
+Napi::Value mix_stream_interface::start(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (stream) return Napi::Boolean::New(env, true);
+
+    uint32_t frame_ms = 20;
+    if (info.Length() > 0 && info[0].IsObject())
+    {
+        Napi::Object options = info[0].As<Napi::Object>();
+        if (options.Has("frameMs")) frame_ms = std::clamp<uint32_t>(options.Get("frameMs").As<Napi::Number>().Uint32Value(), 5, 60);
+    }
+
+    //Captures the notices rather than this, batches can still be delivered after the object is finalized
+    std::shared_ptr<mix_stream_notices> pending = notices;
+    events.open(env, emit.Value(), "MixStreamTSFN", mix_stream_event_capacity,
+        [pending](Napi::Env env, Napi::Function js_callback, std::unique_ptr<std::vector<uint8_t>>& frame) {
+            if (frame)
+            {
+                //Electron doesn't allow external buffers, this is the one copy, every socket is then sent this buffer
+                js_callback.Call({ Napi::String::New(env, "frame"), Napi::Buffer<uint8_t>::Copy(env, frame->data(), frame->size()) });
+                frame.reset();
+            }
+            deliver_notices(env, js_callback, *pending);
+        });
+
+    stream = std::make_unique<mix_stream>(
+        [this](std::unique_ptr<std::vector<uint8_t>> frame) { post_frame(std::move(frame)); },
+        [this](uint32_t id) { post_finished(id); },
+        [this](const std::string& message) { post_error(message); },
+        frame_ms);
+    stream->set_codecs(opus_enabled, pcm_enabled);
+
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value mix_stream_interface::stop(const Napi::CallbackInfo& info)
+{
+    stop_stream();
+    return info.Env().Undefined();
+}
+
+void mix_stream_interface::stop_stream()
+{
+    if (!stream) return;
+
+    //Whatever was still playing ends now, so nothing waits on it forever
+    stream->clear();
+    stream.reset();
+    events.close();
+}
+
+Napi::Value mix_stream_interface::play(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 6 || !info[0].IsNumber() || !info[1].IsString() || !info[2].IsNumber() || !info[3].IsNumber() || !info[4].IsNumber() || !info[5].IsFunction())
+    {
+        Napi::Error::New(env, "play requires an id, file, startSec, endSec, volume, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto worker = new mix_stream_load_worker(
+        this,
+        info.This().As<Napi::Object>(),
+        info[0].As<Napi::Number>().Uint32Value(),
+        info[1].As<Napi::String>().Utf8Value(),
+        info[2].As<Napi::Number>().DoubleValue(),
+        info[3].As<Napi::Number>().DoubleValue(),
+        //Volume is 0 to 100 like the other outputs
+        info[4].As<Napi::Number>().FloatValue() / 100.0f,
+        info[5].As<Napi::Function>()
+    );
+    worker->Queue();
+
+    return env.Undefined();
+}
+
+bool mix_stream_interface::play_loaded(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain)
+{
+    if (!stream) return false;
+
+    stream->play(id, std::move(pcm), channels, start, end, gain);
+    return true;
+}
+
+Napi::Value mix_stream_interface::cancel(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber())
+    {
+        Napi::Error::New(env, "cancel requires an id.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    if (stream) stream->cancel(info[0].As<Napi::Number>().Uint32Value());
+    return env.Undefined();
+}
+
+Napi::Value mix_stream_interface::set_codecs(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 2 || !info[0].IsBoolean() || !info[1].IsBoolean())
+    {
+        Napi::Error::New(env, "setCodecs requires opus and pcm flags.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    //Kept for the next start too, the stream only exists while someone listens
+    opus_enabled = info[0].As<Napi::Boolean>().Value();
+    pcm_enabled = info[1].As<Napi::Boolean>().Value();
+    if (stream) stream->set_codecs(opus_enabled, pcm_enabled);
+    return env.Undefined();
+}
+
+Napi::Value mix_stream_interface::get_stats(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    Napi::Object result = Napi::Object::New(env);
+    result.Set("running", Napi::Boolean::New(env, stream != nullptr));
+    result.Set("framesEncoded", Napi::Number::New(env, stream ? double(stream->frames_encoded()) : 0.0));
+    result.Set("opusFrames", Napi::Number::New(env, stream ? double(stream->opus_frames()) : 0.0));
+    result.Set("pcmFrames", Napi::Number::New(env, stream ? double(stream->pcm_frames()) : 0.0));
+    result.Set("eventsDropped", Napi::Number::New(env, double(events.dropped())));
+    result.Set("opusAvailable", Napi::Boolean::New(env, stream ? stream->opus_available() : true));
+    return result;
+}
+
+void mix_stream_interface::post_frame(std::unique_ptr<std::vector<uint8_t>> frame)
+{
+    events.post(std::move(frame));
+}
+
+void mix_stream_interface::post_finished(uint32_t id)
+{
+    {
+        std::lock_guard<std::mutex> lock(notices->mutex);
+        notices->finished.push_back(id);
+    }
+
+    //If the ring is full this is dropped, but then the events filling it hand the id over when they're delivered
+    events.post(nullptr);
+}
+
+void mix_stream_interface::post_error(const std::string& message)
+{
+    {
+        std::lock_guard<std::mutex> lock(notices->mutex);
+        notices->errors.push_back(message);
+    }
+    events.post(nullptr);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "mix-stream.hh"
+#include "castmate-native/event-dispatcher.hh"
+
+//What JS has to hear about even while frames are being dropped. Rather than taking ring slots that may not be free,
+//these wait here and whichever event the dispatcher delivers next hands them over.
+struct mix_stream_notices
+{
+    std::mutex mutex;
+    std::vector<uint32_t> finished;
+    std::vector<std::string> errors;
+};
+
+//A mix bus streamed as encoded frames. Files are played into it by id, the frames come back through emit:
+//  ("frame", buffer) one per frame and codec no matter how many listen, see mix_stream_header for the layout
+//  ("voice-end", id) when a file has played out or was cancelled
+//  ("encode-error", message) if the Opus encoder couldn't be created, Opus listeners get PCM frames instead
+class mix_stream_interface : public Napi::ObjectWrap<mix_stream_interface>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    mix_stream_interface(const Napi::CallbackInfo& info);
+    ~mix_stream_interface();
+
+    Napi::Value start(const Napi::CallbackInfo& info);
+    Napi::Value stop(const Napi::CallbackInfo& info);
+    Napi::Value play(const Napi::CallbackInfo& info);
+    Napi::Value cancel(const Napi::CallbackInfo& info);
+    Napi::Value set_codecs(const Napi::CallbackInfo& info);
+    Napi::Value get_stats(const Napi::CallbackInfo& info);
+
+    void Finalize(Napi::Env env) override;
+
+    //Called once a file has loaded, false if the stream stopped in the meantime
+    bool play_loaded(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain);
+
+private:
+    void stop_stream();
+    void post_frame(std::unique_ptr<std::vector<uint8_t>> frame);
+    void post_finished(uint32_t id);
+    void post_error(const std::string& message);
+
+    Napi::FunctionReference emit;
+
+    bool opus_enabled = true;
+    bool pcm_enabled = false;
+
+    std::unique_ptr<mix_stream> stream;
+    //Frames, a null frame only carries the notices. A frame that doesn't fit is dropped, a listener that late
+    //restarts its timeline on the sequence gap.
+    event_dispatcher<std::unique_ptr<std::vector<uint8_t>>> events;
+    std::shared_ptr<mix_stream_notices> notices = std::make_shared<mix_stream_notices>();
+};
@@ -0,0 +1,268 @@
+#include "mix-stream.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include <opus.h>
+
+#include "castmate-native/trace.hh"
+
+//5ms, short enough to feel instant and long enough not to click
+static const size_t cancel_fade_frames = mix_stream_sample_rate / 200;
+
+//If the thread wakes this late (a suspend, a debugger) the timeline restarts rather than bursting to catch up
+static const std::chrono::milliseconds max_frame_lateness(200);
+
+//Transparent for game audio and alerts, still only a tenth of the PCM stream
+static const opus_int32 opus_bitrate = 128000;
+//The largest packet opus_encode_float is given room for, per the libopus docs
+static const size_t max_opus_packet = 4000;
+
+static size_t opus_frame_size(uint32_t frame_ms)
+{
+    static const uint32_t lengths_ms[] = { 60, 40, 20, 10, 5 };
+    for (uint32_t length : lengths_ms)
+    {
+        if (frame_ms >= length) return size_t(mix_stream_sample_rate) * length / 1000;
+    }
+    return size_t(mix_stream_sample_rate) * 5 / 1000;
+}
+
+struct opus_encoder_deleter
+{
+    void operator()(OpusEncoder* encoder) const { opus_encoder_destroy(encoder); }
+};
+
+void mix_bus::add(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain)
+{
+    const size_t total = pcm->size() / channels;
+    end = std::min(end, total);
+    if (start >= end) return;
+
+    voices.push_back({ id, std::move(pcm), channels, start, end, gain });
+}
+
+bool mix_bus::cancel(uint32_t id)
+{
+    for (voice& v : voices)
+    {
+        if (v.id != id || v.fade > 0) continue;
+
+        v.fade = std::min(cancel_fade_frames, v.end - v.position);
+        v.end = v.position + v.fade;
+        return true;
+    }
+    return false;
+}
+
+void mix_bus::mix(float* mix, size_t frames, std::vector<uint32_t>& finished)
+{
+    for (auto it = voices.begin(); it != voices.end();)
+    {
+        voice& v = *it;
+        const int16_t* pcm = v.pcm->data();
+        const size_t count = std::min(frames, v.end - v.position);
+        const float scale = v.gain / 32768.0f;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            float gain = scale;
+            if (v.fade > 0)
+            {
+                gain *= float(v.end - v.position - i) / float(cancel_fade_frames);
+            }
+
+            const size_t frame = v.position + i;
+            if (v.channels == 1)
+            {
+                const float sample = float(pcm[frame]) * gain;
+                mix[i * 2] += sample;
+                mix[i * 2 + 1] += sample;
+            }
+            else
+            {
+                mix[i * 2] += float(pcm[frame * 2]) * gain;
+                mix[i * 2 + 1] += float(pcm[frame * 2 + 1]) * gain;
+            }
+        }
+
+        v.position += count;
+        if (v.position >= v.end)
+        {
+            finished.push_back(v.id);
+            it = voices.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void mix_bus::take_ids(std::vector<uint32_t>& ids)
+{
+    for (const voice& v : voices) ids.push_back(v.id);
+    voices.clear();
+}
+
+mix_stream::mix_stream(frame_function on_frame, finished_function on_finished, error_function on_error, uint32_t frame_ms)
+    : on_frame(std::move(on_frame))
+    , on_finished(std::move(on_finished))
+    , on_error(std::move(on_error))
+    , frame_size(opus_frame_size(frame_ms))
+{
+    thread = std::thread(&mix_stream::thread_main, this);
+}
+
+mix_stream::~mix_stream()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    thread.join();
+}
+
+void mix_stream::play(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bus.add(id, std::move(pcm), channels, start, end, gain);
+    }
+    wake.notify_one();
+}
+
+void mix_stream::cancel(uint32_t id)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    bus.cancel(id);
+}
+
+void mix_stream::clear()
+{
+    std::vector<uint32_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        bus.take_ids(ids);
+    }
+
+    for (uint32_t id : ids) on_finished(id);
+}
+
+void mix_stream::set_codecs(bool opus, bool pcm)
+{
+    opus_enabled = opus;
+    pcm_enabled = pcm;
+}
+
+void mix_stream::thread_main()
+{
+    using clock = std::chrono::steady_clock;
+    const auto frame_duration = std::chrono::microseconds(uint64_t(frame_size) * 1000000 / mix_stream_sample_rate);
+
+    std::vector<float> mix(frame_size * mix_stream_channels);
+    std::vector<uint32_t> finished;
+    bool resync = true;
+
+    //Created here so the encoder's state is only ever touched by this thread
+    int opus_error = OPUS_OK;
+    std::unique_ptr<OpusEncoder, opus_encoder_deleter> encoder(
+        opus_encoder_create(opus_int32(mix_stream_sample_rate), int(mix_stream_channels), OPUS_APPLICATION_AUDIO, &opus_error));
+    if (encoder)
+    {
+        opus_encoder_ctl(encoder.get(), OPUS_SET_BITRATE(opus_bitrate));
+    }
+    else
+    {
+        opus_ok = false;
+        on_error(std::string("Unable to create the Opus encoder, streaming PCM instead: ") + opus_strerror(opus_error));
+    }
+
+    clock::time_point next = clock::now();
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (bus.empty() && !stopping)
+            {
+                wake.wait(lock, [this] { return stopping || !bus.empty(); });
+                resync = true;
+                next = clock::now();
+            }
+            if (stopping) break;
+        }
+
+        if (clock::now() - next > max_frame_lateness)
+        {
+            resync = true;
+            next = clock::now();
+        }
+        std::this_thread::sleep_until(next);
+        next += frame_duration;
+
+        std::fill(mix.begin(), mix.end(), 0.0f);
+        finished.clear();
+        {
+            TRACE_SCOPE("mix stream frame");
+            std::lock_guard<std::mutex> lock(mutex);
+            bus.mix(mix.data(), frame_size, finished);
+        }
+
+        //Clipped here rather than by each encoder so both codecs carry the same mix
+        for (float& sample : mix) sample = std::clamp(sample, -1.0f, 1.0f);
+
+        mix_stream_header header;
+        header.sequence = sequence++;
+        header.frames = uint16_t(frame_size);
+        header.channels = uint8_t(mix_stream_channels);
+        header.flags = resync ? mix_stream_resync : 0;
+        resync = false;
+
+        //Without an encoder Opus listeners get PCM, the header's flags tell players which one a frame is
+        const bool encode_pcm = pcm_enabled || (opus_enabled && !encoder);
+
+        //Encoded once per codec, every listener of that codec gets this same buffer
+        if (opus_enabled && encoder)
+        {
+            TRACE_SCOPE("mix stream opus encode");
+
+            auto frame = std::make_unique<std::vector<uint8_t>>(sizeof(mix_stream_header) + max_opus_packet);
+            const opus_int32 bytes = opus_encode_float(encoder.get(), mix.data(), int(frame_size),
+                frame->data() + sizeof(header), opus_int32(max_opus_packet));
+            if (bytes > 0)
+            {
+                mix_stream_header opus_header = header;
+                opus_header.flags |= mix_stream_opus;
+                memcpy(frame->data(), &opus_header, sizeof(opus_header));
+                frame->resize(sizeof(opus_header) + size_t(bytes));
+
+                ++opus_encoded;
+                on_frame(std::move(frame));
+            }
+        }
+
+        if (encode_pcm)
+        {
+            auto frame = std::make_unique<std::vector<uint8_t>>(sizeof(mix_stream_header) + mix.size() * sizeof(int16_t));
+            memcpy(frame->data(), &header, sizeof(header));
+
+            //Samples are little endian on every platform CastMate runs on
+            int16_t* samples = reinterpret_cast<int16_t*>(frame->data() + sizeof(header));
+            for (size_t i = 0; i < mix.size(); ++i)
+            {
+                samples[i] = int16_t(std::clamp(std::lround(mix[i] * 32768.0f), -32768L, 32767L));
+            }
+
+            ++pcm_encoded;
+            on_frame(std::move(frame));
+        }
+
+        ++encoded;
+
+        for (uint32_t id : finished) on_finished(id);
+    }
+}
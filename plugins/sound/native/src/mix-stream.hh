@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//The stream's fixed format, sources are decoded to it before they're played
+static const uint32_t mix_stream_sample_rate = 48000;
+static const uint32_t mix_stream_channels = 2;
+
+//Every frame is this header followed by one Opus packet if flags has mix_stream_opus, otherwise by interleaved
+//16 bit little endian samples. PCM is only for players that can't decode Opus.
+struct mix_stream_header
+{
+    uint32_t sequence;
+    //Samples per channel, the same for both codecs
+    uint16_t frames;
+    uint8_t channels;
+    //mix_stream_resync on the first frame after the bus was idle, players restart their timeline on it
+    uint8_t flags;
+};
+static_assert(sizeof(mix_stream_header) == 8, "mix_stream_header is sent as is");
+
+static const uint8_t mix_stream_resync = 1;
+static const uint8_t mix_stream_opus = 2;
+
+//Sources playing into the bus. Only touched under mix_stream's lock.
+class mix_bus
+{
+public:
+    //pcm is 48kHz interleaved with 1 or 2 channels, start and end are in frames
+    void add(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain);
+    //Fades out over a few milliseconds rather than cutting off mid wave
+    bool cancel(uint32_t id);
+
+    //Adds frames of stereo into mix and appends the ids that ran out
+    void mix(float* mix, size_t frames, std::vector<uint32_t>& finished);
+
+    bool empty() const { return voices.empty(); }
+    void take_ids(std::vector<uint32_t>& ids);
+
+private:
+    struct voice
+    {
+        uint32_t id;
+        std::shared_ptr<const std::vector<int16_t>> pcm;
+        uint32_t channels;
+        size_t position;
+        size_t end;
+        float gain;
+        //Frames left in the fade out, 0 if not fading
+        size_t fade = 0;
+    };
+
+    std::vector<voice> voices;
+};
+
+//Mixes the bus on its own thread in real time and encodes each frame once per codec someone listens with. Frames
+//are handed out whole so every listener can be sent the same buffer. The thread sleeps while nothing is playing.
+class mix_stream
+{
+public:
+    using frame_function = std::function<void(std::unique_ptr<std::vector<uint8_t>> frame)>;
+    using finished_function = std::function<void(uint32_t id)>;
+    using error_function = std::function<void(const std::string& message)>;
+
+    //frame_ms is rounded down to a length Opus can encode: 5, 10, 20, 40 or 60. on_error runs on the stream's thread
+    //if the Opus encoder can't be created, Opus listeners are then sent PCM frames instead.
+    mix_stream(frame_function on_frame, finished_function on_finished, error_function on_error, uint32_t frame_ms = 20);
+    ~mix_stream();
+
+    void play(uint32_t id, std::shared_ptr<const std::vector<int16_t>> pcm, uint32_t channels, size_t start, size_t end, float gain);
+    void cancel(uint32_t id);
+    //Ends everything playing, on_finished runs for each on the calling thread
+    void clear();
+
+    //Which encodings are produced from the next frame on, Opus only by default
+    void set_codecs(bool opus, bool pcm);
+
+    uint64_t frames_encoded() const { return encoded; }
+    uint64_t opus_frames() const { return opus_encoded; }
+    uint64_t pcm_frames() const { return pcm_encoded; }
+    bool opus_available() const { return opus_ok; }
+
+private:
+    void thread_main();
+
+    frame_function on_frame;
+    finished_function on_finished;
+    error_function on_error;
+    size_t frame_size;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    mix_bus bus;
+    bool stopping = false;
+
+    std::atomic<bool> opus_enabled { true };
+    std::atomic<bool> pcm_enabled { false };
+    std::atomic<bool> opus_ok { true };
+
+    uint32_t sequence = 0;
+    std::atomic<uint64_t> encoded { 0 };
+    std::atomic<uint64_t> opus_encoded { 0 };
+    std::atomic<uint64_t> pcm_encoded { 0 };
+    std::thread thread;
+};
@@ -1,4 +1,5 @@
-#include "util.hh"
+#include "castmate-native/errors.hh"
+#include "castmate-native/trace-bindings.hh"
 
 #include <string>
 #include <sstream>
@@ -12,9 +13,13 @@
 #include <mmdeviceapi.h>
 #include <functiondiscoverykeys_devpkey.h>
 
-#include "util.hh"
 #include "audio-interface.hh"
 #include "tts-interface.hh"
+#include "latency-stats.hh"
+#include "time-stretch-bindings.hh"
+#include "voice-activity-capture.hh"
+#include "audio-fingerprint-bindings.hh"
+#include "mix-stream-bindings.hh"
 
 using namespace Microsoft::WRL;
 
@@ -59,6 +64,12 @@ Napi::Object Init(Napi::Env env, Napi::Object exports) {
 
     audio_device_interface::init(env, exports);
     os_tts_interface::init(env, exports);
+    latency_stats::init(env, exports);
+    time_stretch_init(env, exports);
+    voice_activity_interface::init(env, exports);
+    fingerprint_interface::init(env, exports);
+    mix_stream_interface::init(env, exports);
+    trace_init(env, exports);
 
     return exports;
 }
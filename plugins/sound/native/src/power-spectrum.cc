@@ -0,0 +1,120 @@
+#include "power-spectrum.hh"
+
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define POWER_SPECTRUM_SSE 1
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+std::vector<float> hann_window(size_t length)
+{
+    std::vector<float> window(length);
+    for (size_t i = 0; i < length; ++i)
+    {
+        window[i] = float(0.5 - 0.5 * std::cos(2.0 * pi * double(i) / double(length)));
+    }
+    return window;
+}
+
+power_spectrum::power_spectrum(size_t fft_size)
+    : fft_size(fft_size)
+    , re(fft_size)
+    , im(fft_size)
+{
+    //Stage with half size h keeps its twiddles at [h, 2h)
+    twiddle_re.resize(fft_size);
+    twiddle_im.resize(fft_size);
+    for (size_t half = 1; half < fft_size; half <<= 1)
+    {
+        for (size_t j = 0; j < half; ++j)
+        {
+            twiddle_re[half + j] = float(std::cos(-pi * double(j) / double(half)));
+            twiddle_im[half + j] = float(std::sin(-pi * double(j) / double(half)));
+        }
+    }
+
+    size_t bits = 0;
+    while ((size_t(1) << bits) < fft_size) ++bits;
+    bit_reverse.resize(fft_size);
+    for (size_t i = 0; i < fft_size; ++i)
+    {
+        uint32_t reversed = 0;
+        for (size_t b = 0; b < bits; ++b)
+        {
+            if (i & (size_t(1) << b)) reversed |= uint32_t(1) << (bits - 1 - b);
+        }
+        bit_reverse[i] = reversed;
+    }
+}
+
+void power_spectrum::compute(const float* samples, const float* window, size_t count, float* power)
+{
+    //Window into the real part, the FFT wants bit reversed input
+    for (size_t i = 0; i < fft_size; ++i)
+    {
+        const size_t source = bit_reverse[i];
+        re[i] = source < count ? samples[source] * window[source] : 0.0f;
+        im[i] = 0.0f;
+    }
+
+    float* r = re.data();
+    float* m = im.data();
+    for (size_t half = 1; half < fft_size; half <<= 1)
+    {
+        const float* wr = twiddle_re.data() + half;
+        const float* wi = twiddle_im.data() + half;
+
+        for (size_t start = 0; start < fft_size; start += half * 2)
+        {
+            size_t j = 0;
+#ifdef POWER_SPECTRUM_SSE
+            for (; j + 4 <= half; j += 4)
+            {
+                const size_t a = start + j;
+                const size_t b = a + half;
+                const __m128 twr = _mm_loadu_ps(wr + j);
+                const __m128 twi = _mm_loadu_ps(wi + j);
+                const __m128 br = _mm_loadu_ps(r + b);
+                const __m128 bi = _mm_loadu_ps(m + b);
+                const __m128 tr = _mm_sub_ps(_mm_mul_ps(br, twr), _mm_mul_ps(bi, twi));
+                const __m128 ti = _mm_add_ps(_mm_mul_ps(br, twi), _mm_mul_ps(bi, twr));
+                const __m128 ar = _mm_loadu_ps(r + a);
+                const __m128 ai = _mm_loadu_ps(m + a);
+                _mm_storeu_ps(r + b, _mm_sub_ps(ar, tr));
+                _mm_storeu_ps(m + b, _mm_sub_ps(ai, ti));
+                _mm_storeu_ps(r + a, _mm_add_ps(ar, tr));
+                _mm_storeu_ps(m + a, _mm_add_ps(ai, ti));
+            }
+#endif
+            for (; j < half; ++j)
+            {
+                const size_t a = start + j;
+                const size_t b = a + half;
+                const float tr = r[b] * wr[j] - m[b] * wi[j];
+                const float ti = r[b] * wi[j] + m[b] * wr[j];
+                r[b] = r[a] - tr;
+                m[b] = m[a] - ti;
+                r[a] += tr;
+                m[a] += ti;
+            }
+        }
+    }
+
+    const size_t bins = fft_size / 2 + 1;
+    size_t k = 0;
+#ifdef POWER_SPECTRUM_SSE
+    for (; k + 4 <= bins; k += 4)
+    {
+        const __m128 pr = _mm_loadu_ps(r + k);
+        const __m128 pi4 = _mm_loadu_ps(m + k);
+        _mm_storeu_ps(power + k, _mm_add_ps(_mm_mul_ps(pr, pr), _mm_mul_ps(pi4, pi4)));
+    }
+#endif
+    for (; k < bins; ++k)
+    {
+        power[k] = r[k] * r[k] + m[k] * m[k];
+    }
+}
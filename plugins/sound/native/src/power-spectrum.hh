@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Radix 2 FFT of a windowed real block, power only. Split real/imaginary buffers so the butterflies vectorize.
+class power_spectrum
+{
+public:
+    power_spectrum(size_t fft_size);
+
+    //Multiplies count samples by the window, zero pads to the FFT size, and writes fft_size / 2 + 1 powers.
+    void compute(const float* samples, const float* window, size_t count, float* power);
+
+    size_t size() const { return fft_size; }
+    size_t bins() const { return fft_size / 2 + 1; }
+
+private:
+    size_t fft_size;
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<float> twiddle_re;
+    std::vector<float> twiddle_im;
+    std::vector<uint32_t> bit_reverse;
+};
+
+//Periodic Hann window
+std::vector<float> hann_window(size_t length);
@@ -0,0 +1,132 @@
+#include "time-stretch-bindings.hh"
+#include "time-stretch.hh"
+#include "tts-pipeline.hh"
+
+#include <algorithm>
+#include <cmath>
+
+#include "castmate-native/trace.hh"
+
+//Samples per block pushed through the stretcher, keeps the float buffers small for long messages.
+static const size_t stretch_block_samples = 4096;
+
+class stretch_wav_worker : public Napi::AsyncWorker
+{
+    std::string input;
+    std::string output;
+    double rate;
+    double semitones;
+public:
+    stretch_wav_worker(const std::string& input, const std::string& output, double rate, double semitones, const Napi::Function& callback)
+        : AsyncWorker(callback)
+        , input(input)
+        , output(output)
+        , rate(rate)
+        , semitones(semitones)
+    {
+    }
+
+protected:
+    void Execute() override
+    {
+        TRACE_SCOPE("tts stretch");
+
+        tts_audio_format format;
+        std::vector<uint8_t> pcm;
+        std::string error;
+        if (!read_wav_file(input, format, pcm, error))
+        {
+            SetError(error);
+            return;
+        }
+
+        if (format.channels != 1 || format.bits_per_sample != 16)
+        {
+            SetError("Only 16 bit mono wav files can be stretched");
+            return;
+        }
+
+        time_stretch stretcher(format.sample_rate);
+        stretcher.set_rate(rate);
+        stretcher.set_pitch_semitones(semitones);
+
+        wav_writer writer;
+        if (!writer.open(output, format))
+        {
+            SetError("Unable to write stretched wav");
+            return;
+        }
+
+        const size_t sample_count = pcm.size() / 2;
+        std::vector<float> block;
+        std::vector<float> stretched;
+        std::vector<int16_t> samples;
+
+        for (size_t start = 0; start <= sample_count; start += stretch_block_samples)
+        {
+            stretched.clear();
+
+            if (start < sample_count)
+            {
+                const size_t count = std::min(stretch_block_samples, sample_count - start);
+                block.resize(count);
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const uint8_t* sample = pcm.data() + (start + i) * 2;
+                    block[i] = float(int16_t(sample[0] | (sample[1] << 8))) / 32768.0f;
+                }
+                stretcher.process(block.data(), count, stretched);
+            }
+
+            if (start + stretch_block_samples > sample_count)
+            {
+                stretcher.flush(stretched);
+            }
+
+            samples.resize(stretched.size());
+            for (size_t i = 0; i < stretched.size(); ++i)
+            {
+                samples[i] = int16_t(std::clamp(std::lround(stretched[i] * 32768.0f), -32768L, 32767L));
+            }
+
+            //Samples are little endian on every platform CastMate runs on
+            if (!writer.write(reinterpret_cast<const uint8_t*>(samples.data()), samples.size() * 2))
+            {
+                SetError("Unable to write stretched wav");
+                return;
+            }
+        }
+
+        if (!writer.close())
+        {
+            SetError("Unable to write stretched wav");
+        }
+    }
+};
+
+static Napi::Value stretch_wav(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5 || !info[0].IsString() || !info[1].IsString() || !info[2].IsNumber() || !info[3].IsNumber() || !info[4].IsFunction())
+    {
+        Napi::Error::New(env, "stretchWav requires an input, output, rate, semitones, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    auto worker = new stretch_wav_worker(
+        info[0].As<Napi::String>().Utf8Value(),
+        info[1].As<Napi::String>().Utf8Value(),
+        info[2].As<Napi::Number>().DoubleValue(),
+        info[3].As<Napi::Number>().DoubleValue(),
+        info[4].As<Napi::Function>()
+    );
+    worker->Queue();
+
+    return env.Undefined();
+}
+
+void time_stretch_init(Napi::Env env, Napi::Object exports)
+{
+    exports.Set("stretchWav", Napi::Function::New(env, stretch_wav, "stretchWav"));
+}
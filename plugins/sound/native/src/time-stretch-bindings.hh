@@ -0,0 +1,7 @@
+#pragma once
+
+#include <napi.h>
+
+//Adds stretchWav(input, output, rate, semitones, callback) to the exports. Renders a rate and pitch variant of a
+//16 bit wav off the main thread, so TTS only has to synthesize a message once at neutral settings.
+void time_stretch_init(Napi::Env env, Napi::Object exports);
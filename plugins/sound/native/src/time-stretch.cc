@@ -0,0 +1,249 @@
+#include "time-stretch.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TIME_STRETCH_SSE 1
+#endif
+
+//Tuned for speech, shorter sequences smear less but the search gets less to work with.
+static const double sequence_seconds = 0.040;
+static const double seek_seconds = 0.015;
+static const double overlap_seconds = 0.008;
+
+float time_stretch_dot(const float* a, const float* b, size_t count)
+{
+    size_t i = 0;
+    float result = 0;
+
+#ifdef TIME_STRETCH_SSE
+    //Two accumulators so consecutive adds don't wait on each other
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    result = _mm_cvtss_f32(sum);
+#endif
+
+    for (; i < count; ++i)
+    {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+void time_stretch_crossfade(const float* fade_out, const float* fade_in, size_t count, float* out)
+{
+    const float step = 1.0f / float(count);
+    size_t i = 0;
+
+#ifdef TIME_STRETCH_SSE
+    const __m128 lane_weights = _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step));
+    for (; i + 4 <= count; i += 4)
+    {
+        const __m128 weight = _mm_add_ps(_mm_set1_ps(float(i) * step), lane_weights);
+        const __m128 from = _mm_loadu_ps(fade_out + i);
+        const __m128 to = _mm_loadu_ps(fade_in + i);
+        _mm_storeu_ps(out + i, _mm_add_ps(from, _mm_mul_ps(_mm_sub_ps(to, from), weight)));
+    }
+#endif
+
+    for (; i < count; ++i)
+    {
+        const float weight = float(i) * step;
+        out[i] = fade_out[i] + (fade_in[i] - fade_out[i]) * weight;
+    }
+}
+
+time_stretch::time_stretch(uint32_t sample_rate)
+{
+    sequence_length = size_t(sample_rate * sequence_seconds);
+    seek_length = size_t(sample_rate * seek_seconds);
+    overlap_length = std::max<size_t>(8, size_t(sample_rate * overlap_seconds));
+}
+
+void time_stretch::set_rate(double new_rate)
+{
+    rate = std::clamp(new_rate, 0.25, 4.0);
+    tempo = rate / pitch_ratio;
+}
+
+void time_stretch::set_pitch_semitones(double semitones)
+{
+    pitch_ratio = std::pow(2.0, std::clamp(semitones, -12.0, 12.0) / 12.0);
+    tempo = rate / pitch_ratio;
+}
+
+void time_stretch::reset()
+{
+    stretch_input.clear();
+    stretch_read = 0;
+    overlap.clear();
+    primed = false;
+    skip_fraction = 0;
+    resample_input.clear();
+    resample_position = 0;
+    stretched.clear();
+    input_total = 0;
+    output_total = 0;
+}
+
+void time_stretch::process(const float* input, size_t count, std::vector<float>& output)
+{
+    input_total += count;
+
+    const size_t start = output.size();
+
+    if (tempo == 1.0 && !primed)
+    {
+        resample(input, count, output);
+    }
+    else
+    {
+        stretch_input.insert(stretch_input.end(), input, input + count);
+        stretch(stretched);
+        resample(stretched.data(), stretched.size(), output);
+        stretched.clear();
+    }
+
+    output_total += output.size() - start;
+}
+
+void time_stretch::flush(std::vector<float>& output)
+{
+    const uint64_t expected = uint64_t(double(input_total) / rate + 0.5);
+    const size_t start = output.size();
+
+    //Push silence through until the real tail has come out the other end
+    const std::vector<float> silence(seek_length + sequence_length, 0.0f);
+    const uint64_t real_input = input_total;
+    while (output_total < expected)
+    {
+        process(silence.data(), silence.size(), output);
+    }
+    input_total = real_input;
+
+    const size_t excess = size_t(std::min<uint64_t>(output_total - expected, output.size() - start));
+    output.resize(output.size() - excess);
+
+    reset();
+}
+
+size_t time_stretch::best_offset(const float* search) const
+{
+    double energy = 0;
+    for (size_t i = 0; i < overlap_length; ++i)
+    {
+        energy += double(search[i]) * search[i];
+    }
+
+    size_t best = 0;
+    double best_score = -1e30;
+
+    for (size_t offset = 0; offset < seek_length; ++offset)
+    {
+        const double correlation = time_stretch_dot(overlap.data(), search + offset, overlap_length);
+        const double score = correlation / std::sqrt(energy + 1e-9);
+        if (score > best_score)
+        {
+            best_score = score;
+            best = offset;
+        }
+
+        const double leaving = search[offset];
+        const double entering = search[offset + overlap_length];
+        energy = std::max(0.0, energy - leaving * leaving + entering * entering);
+    }
+
+    return best;
+}
+
+void time_stretch::stretch(std::vector<float>& output)
+{
+    const size_t step = sequence_length - overlap_length;
+
+    while (stretch_input.size() - stretch_read >= seek_length + sequence_length)
+    {
+        const float* search = stretch_input.data() + stretch_read;
+
+        if (!primed)
+        {
+            //Nothing to line up with yet, the first sequence is taken as is
+            output.insert(output.end(), search, search + step);
+            overlap.assign(search + step, search + sequence_length);
+            primed = true;
+        }
+        else
+        {
+            const float* sequence = search + best_offset(search);
+
+            const size_t at = output.size();
+            output.resize(at + step);
+            time_stretch_crossfade(overlap.data(), sequence, overlap_length, output.data() + at);
+            memcpy(output.data() + at + overlap_length, sequence + overlap_length, (step - overlap_length) * sizeof(float));
+
+            overlap.assign(sequence + step, sequence + sequence_length);
+        }
+
+        const double skip = tempo * double(step) + skip_fraction;
+        const size_t whole = size_t(skip);
+        skip_fraction = skip - double(whole);
+        stretch_read += whole;
+    }
+
+    //Drop consumed input once it's worth the move
+    if (stretch_read > 4 * sequence_length)
+    {
+        const size_t consumed = std::min(stretch_read, stretch_input.size());
+        stretch_input.erase(stretch_input.begin(), stretch_input.begin() + consumed);
+        stretch_read -= consumed;
+    }
+}
+
+void time_stretch::resample(const float* input, size_t count, std::vector<float>& output)
+{
+    if (pitch_ratio == 1.0 && resample_input.empty())
+    {
+        output.insert(output.end(), input, input + count);
+        return;
+    }
+
+    if (resample_input.empty())
+    {
+        //Catmull-Rom needs one sample of history before the first
+        resample_input.push_back(0.0f);
+        resample_position = 1.0;
+    }
+    resample_input.insert(resample_input.end(), input, input + count);
+
+    const float* x = resample_input.data();
+    while (resample_position + 2.0 < double(resample_input.size()))
+    {
+        const size_t i = size_t(resample_position);
+        const float t = float(resample_position - double(i));
+
+        const float a = x[i - 1];
+        const float b = x[i];
+        const float c = x[i + 1];
+        const float d = x[i + 2];
+
+        output.push_back(b + 0.5f * t * (c - a + t * (2.0f * a - 5.0f * b + 4.0f * c - d + t * (3.0f * (b - c) + d - a))));
+        resample_position += pitch_ratio;
+    }
+
+    const size_t consumed = size_t(resample_position) - 1;
+    if (consumed > 0)
+    {
+        resample_input.erase(resample_input.begin(), resample_input.begin() + consumed);
+        resample_position -= double(consumed);
+    }
+}
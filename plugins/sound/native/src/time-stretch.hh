@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+//Streaming rate and pitch change for mono float audio.
+//
+//Rate goes through WSOLA: the input is cut into overlapping sequences and each one is placed where its start best
+//lines up, by cross correlation, with the tail of the previous one. Skipping or repeating input between sequences
+//changes the tempo without touching the pitch.
+//Pitch is a resample after the stretch, the stretch is adjusted by the same ratio so the duration only follows rate.
+//
+//Blocks of any size can be pushed through process(), output comes out in steps of one WSOLA sequence.
+class time_stretch
+{
+public:
+    explicit time_stretch(uint32_t sample_rate);
+
+    //Speed factor, 2 is twice as fast. Clamped to [0.25, 4].
+    void set_rate(double rate);
+    //Clamped to +-12, the resampler has no anti aliasing filter and speech falls apart past an octave anyway.
+    void set_pitch_semitones(double semitones);
+
+    //Appends whatever output the new input completes.
+    void process(const float* input, size_t count, std::vector<float>& output);
+    //Drains the buffered tail, the total output is then input length / rate.
+    void flush(std::vector<float>& output);
+    void reset();
+
+private:
+    void stretch(std::vector<float>& output);
+    size_t best_offset(const float* search) const;
+    void resample(const float* input, size_t count, std::vector<float>& output);
+
+    size_t sequence_length;
+    size_t seek_length;
+    size_t overlap_length;
+
+    double rate = 1.0;
+    double pitch_ratio = 1.0;
+    double tempo = 1.0;
+
+    //WSOLA input not yet consumed starts at stretch_read
+    std::vector<float> stretch_input;
+    size_t stretch_read = 0;
+    std::vector<float> overlap;
+    bool primed = false;
+    double skip_fraction = 0;
+
+    //Resampler input, resample_position is relative to its start
+    std::vector<float> resample_input;
+    double resample_position = 0;
+
+    //Stretch output staged for the resampler
+    std::vector<float> stretched;
+
+    uint64_t input_total = 0;
+    uint64_t output_total = 0;
+};
+
+//SIMD kernels shared with the bench
+float time_stretch_dot(const float* a, const float* b, size_t count);
+//out[i] = fade_out[i] * (1 - i / count) + fade_in[i] * i / count
+void time_stretch_crossfade(const float* fade_out, const float* fade_in, size_t count, float* out);
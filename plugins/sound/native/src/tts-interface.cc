@@ -1,5 +1,7 @@
 #include "tts-interface.hh"
-#include "util.hh"
+#include "castmate-native/errors.hh"
+#include "castmate-native/trace.hh"
+#include "tts-segmenter.hh"
 #include <iostream>
 #include <sphelper.h>
 
@@ -18,6 +20,8 @@ void os_tts_worker::Execute()
     //Ensure COM is inited?
     ::CoInitialize(NULL);
 
+    TRACE_SCOPE("tts synthesize");
+
     HRESULT hr;
 
     Microsoft::WRL::ComPtr<ISpVoice> sp_voice;
@@ -73,6 +77,205 @@ bool os_tts_worker::handle_error(HRESULT hr, const std::string& message)
 
 ///////////
 
+const tts_audio_format sapi_tts_backend::format = { 22050, 1, 16 };
+
+sapi_tts_backend::sapi_tts_backend(Microsoft::WRL::ComPtr<ISpObjectToken> voice_token)
+    : voice_token(voice_token)
+{
+}
+
+sapi_tts_backend::~sapi_tts_backend()
+{
+    //The voice has to go before COM does
+    sp_voice.Reset();
+    if (needs_uninit)
+    {
+        ::CoUninitialize();
+    }
+}
+
+bool sapi_tts_backend::init(std::string& error)
+{
+    needs_uninit = SUCCEEDED(::CoInitializeEx(NULL, COINIT_MULTITHREADED));
+
+    HRESULT hr = ::CoCreateInstance(__uuidof(SpVoice), nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(sp_voice.ReleaseAndGetAddressOf()));
+    if (FAILED(hr))
+    {
+        error = "Unable to create voice interface";
+        return false;
+    }
+
+    hr = sp_voice->SetVoice(voice_token.Get());
+    if (FAILED(hr))
+    {
+        error = "Failed to set voice.";
+        return false;
+    }
+
+    return true;
+}
+
+bool sapi_tts_backend::synthesize(const std::wstring& text, std::vector<uint8_t>& pcm, std::string& error)
+{
+    HRESULT hr;
+
+    CSpStreamFormat fmt;
+    hr = fmt.AssignFormat(SPSF_22kHz16BitMono);
+    if (FAILED(hr))
+    {
+        error = "Failed to create format for tts output";
+        return false;
+    }
+
+    //Raw PCM into an HGLOBAL, the pipeline writes the wav files itself
+    ComPtr<IStream> memory_stream;
+    hr = ::CreateStreamOnHGlobal(NULL, TRUE, memory_stream.ReleaseAndGetAddressOf());
+    if (FAILED(hr))
+    {
+        error = "Failed to create memory stream for tts output";
+        return false;
+    }
+
+    ComPtr<ISpStream> sp_stream;
+    hr = ::CoCreateInstance(CLSID_SpStream, nullptr, CLSCTX_ALL, IID_PPV_ARGS(sp_stream.ReleaseAndGetAddressOf()));
+    if (SUCCEEDED(hr))
+    {
+        hr = sp_stream->SetBaseStream(memory_stream.Get(), fmt.FormatId(), fmt.WaveFormatExPtr());
+    }
+    if (FAILED(hr))
+    {
+        error = "Failed to create stream for output";
+        return false;
+    }
+
+    hr = sp_voice->SetOutput(sp_stream.Get(), TRUE);
+    if (FAILED(hr))
+    {
+        error = "Failed to set voice output";
+        return false;
+    }
+
+    hr = sp_voice->Speak(text.c_str(), SPF_DEFAULT, NULL);
+    if (FAILED(hr))
+    {
+        error = "Failed to speak";
+        return false;
+    }
+
+    STATSTG stat;
+    HGLOBAL memory = NULL;
+    if (FAILED(memory_stream->Stat(&stat, STATFLAG_NONAME)) || FAILED(::GetHGlobalFromStream(memory_stream.Get(), &memory)))
+    {
+        error = "Failed to read tts output";
+        return false;
+    }
+
+    const size_t size = size_t(stat.cbSize.QuadPart);
+    if (size > 0)
+    {
+        const uint8_t* data = static_cast<const uint8_t*>(::GlobalLock(memory));
+        pcm.insert(pcm.end(), data, data + size);
+        ::GlobalUnlock(memory);
+    }
+    return true;
+}
+
+///////////
+
+os_tts_segmented_worker::os_tts_segmented_worker(std::shared_ptr<tts_pipeline> pipeline, const std::string& voice_id, Microsoft::WRL::ComPtr<ISpObjectToken> voice_token, const std::wstring& message, const std::string& file_base, const Napi::Function &callback)
+    : AsyncProgressQueueWorker(callback)
+    , pipeline(std::move(pipeline))
+    , voice_id(voice_id)
+    , voice_token(voice_token)
+    , message(message)
+    , file_base(file_base)
+{
+}
+
+std::string os_tts_segmented_worker::segment_file(const std::string& file_base, uint32_t index)
+{
+    return file_base + "-" + std::to_string(index) + ".wav";
+}
+
+void os_tts_segmented_worker::Execute(const ExecutionProgress& progress)
+{
+    TRACE_SCOPE("tts synthesize segmented");
+
+    const std::vector<std::wstring> segments = segment_tts_text(message);
+    if (segments.empty())
+    {
+        SetError("Nothing to speak");
+        return;
+    }
+
+    wav_writer joined;
+    if (!joined.open(file_base + ".wav", sapi_tts_backend::format))
+    {
+        SetError("Failed to create tts output file");
+        return;
+    }
+
+    ComPtr<ISpObjectToken> token = voice_token;
+    auto factory = [token](std::string& error) -> std::unique_ptr<tts_backend> {
+        auto backend = std::make_unique<sapi_tts_backend>(token);
+        if (!backend->init(error)) return nullptr;
+        return backend;
+    };
+
+    bool written = true;
+    std::string error;
+    const bool synthesized = pipeline->run(voice_id, factory, segments, [&](size_t index, const std::vector<uint8_t>& pcm) {
+        written = wav_writer::write_file(segment_file(file_base, uint32_t(index)), sapi_tts_backend::format, pcm) && written;
+        written = joined.write(pcm.data(), pcm.size()) && written;
+
+        const uint32_t reported = uint32_t(index);
+        progress.Send(&reported, 1);
+    }, error);
+
+    written = joined.close() && written;
+    segment_count = uint32_t(segments.size());
+
+    if (!synthesized)
+    {
+        SetError(error);
+    }
+    else if (!written)
+    {
+        SetError("Failed to write tts output");
+    }
+}
+
+void os_tts_segmented_worker::OnProgress(const uint32_t* indices, size_t count)
+{
+    Napi::Env env = Env();
+    for (size_t i = 0; i < count; ++i)
+    {
+        Callback().Call({
+            Napi::String::New(env, "segment"),
+            Napi::Number::New(env, indices[i]),
+            Napi::String::New(env, segment_file(file_base, indices[i])),
+        });
+    }
+}
+
+void os_tts_segmented_worker::OnOK()
+{
+    Napi::Env env = Env();
+    Callback().Call({
+        Napi::String::New(env, "done"),
+        Napi::Number::New(env, segment_count),
+        Napi::String::New(env, file_base + ".wav"),
+    });
+}
+
+void os_tts_segmented_worker::OnError(const Napi::Error& error)
+{
+    Napi::Env env = Env();
+    Callback().Call({ Napi::String::New(env, "error"), Napi::String::New(env, error.Message()) });
+}
+
+///////////
+
 os_tts_interface::os_tts_interface(const Napi::CallbackInfo& info)
     : Napi::ObjectWrap<os_tts_interface>(info)
 {
@@ -172,11 +375,45 @@ Napi::Value os_tts_interface::speak_to_file(const Napi::CallbackInfo& info)
     return Napi::Boolean::From(env, true);
 }
 
+//speakSegmented(message, fileBase, voiceId, threads, callback) calls back ("segment", index, file) in order,
+//then ("done", count, joinedFile) or ("error", message)
+Napi::Value os_tts_interface::speak_segmented(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 5 || !info[0].IsString() || !info[1].IsString() || !info[2].IsString() || !info[4].IsFunction())
+    {
+        Napi::Error::New(env, "speakSegmented requires a message, file base, voice id, thread count, and a callback.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    std::u16string u16message = info[0].As<Napi::String>().Utf16Value();
+    std::wstring wmessage (u16message.begin(), u16message.end());
+
+    auto voice_i = voice_tokens.find(info[2].As<Napi::String>().Utf8Value());
+    if (voice_i == voice_tokens.end()) return Napi::Boolean::From(env, false);
+
+    size_t threads = info[3].IsNumber() ? info[3].As<Napi::Number>().Uint32Value() : 0;
+    if (threads == 0) threads = tts_pipeline::default_threads();
+
+    //Workers still running on the old pipeline keep it alive until they finish
+    if (!pipeline || pipeline->threads() != threads)
+    {
+        pipeline = std::make_shared<tts_pipeline>(threads);
+    }
+
+    auto worker = new os_tts_segmented_worker(pipeline, voice_i->first, voice_i->second, wmessage, info[1].As<Napi::String>().Utf8Value(), info[4].As<Napi::Function>());
+    worker->Queue();
+
+    return Napi::Boolean::From(env, true);
+}
+
 Napi::Object os_tts_interface::init(Napi::Env env, Napi::Object exports)
 {
     Napi::Function constructor = DefineClass(env, "OsTTSInterface", {
         InstanceMethod("getVoices", &os_tts_interface::get_voices),
         InstanceMethod("speakToFile", &os_tts_interface::speak_to_file),
+        InstanceMethod("speakSegmented", &os_tts_interface::speak_segmented),
     });
 
     exports.Set("OsTTSInterface", constructor);
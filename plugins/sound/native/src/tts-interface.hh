@@ -7,6 +7,8 @@
 #include <wrl.h>
 #include <sphelper.h>
 
+#include "tts-pipeline.hh"
+
 
 
 //ISpVoice can't be shared across threads, so this is a context that is created to be run on one thread.
@@ -25,6 +27,45 @@ private:
     bool handle_error(HRESULT hr, const std::string& message);
 };
 
+//A SAPI voice rendering into memory, one per pipeline worker thread.
+class sapi_tts_backend : public tts_backend
+{
+public:
+    sapi_tts_backend(Microsoft::WRL::ComPtr<ISpObjectToken> voice_token);
+    ~sapi_tts_backend();
+
+    bool init(std::string& error);
+    bool synthesize(const std::wstring& text, std::vector<uint8_t>& pcm, std::string& error) override;
+
+    static const tts_audio_format format;
+
+private:
+    Microsoft::WRL::ComPtr<ISpObjectToken> voice_token;
+    Microsoft::WRL::ComPtr<ISpVoice> sp_voice;
+    bool needs_uninit = false;
+};
+
+//Splits the message into sentences and synthesizes them in parallel. Segments are reported in order as
+//<file_base>-<index>.wav while later ones are still rendering, the whole message lands in <file_base>.wav.
+class os_tts_segmented_worker : public Napi::AsyncProgressQueueWorker<uint32_t>
+{
+    std::shared_ptr<tts_pipeline> pipeline;
+    std::string voice_id;
+    Microsoft::WRL::ComPtr<ISpObjectToken> voice_token;
+    std::wstring message;
+    std::string file_base;
+    uint32_t segment_count = 0;
+public:
+    os_tts_segmented_worker(std::shared_ptr<tts_pipeline> pipeline, const std::string& voice_id, Microsoft::WRL::ComPtr<ISpObjectToken> voice_token, const std::wstring& message, const std::string& file_base, const Napi::Function &callback);
+
+    static std::string segment_file(const std::string& file_base, uint32_t index);
+protected:
+    void Execute(const ExecutionProgress& progress) override;
+    void OnProgress(const uint32_t* indices, size_t count) override;
+    void OnOK() override;
+    void OnError(const Napi::Error& error) override;
+};
+
 class os_tts_interface : public Napi::ObjectWrap<os_tts_interface> 
 {
 public:
@@ -34,7 +75,10 @@ public:
 
     Napi::Value get_voices(const Napi::CallbackInfo& info);
     Napi::Value speak_to_file(const Napi::CallbackInfo& info);
+    Napi::Value speak_segmented(const Napi::CallbackInfo& info);
 private:
     Microsoft::WRL::ComPtr<ISpVoice> sp_voice;
     std::map<std::string, Microsoft::WRL::ComPtr<ISpObjectToken>> voice_tokens;
+    //Shared with in flight segmented workers, kept between messages so its workers keep their voices
+    std::shared_ptr<tts_pipeline> pipeline;
 };
\ No newline at end of file
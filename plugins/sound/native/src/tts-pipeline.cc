@@ -0,0 +1,340 @@
+#include "tts-pipeline.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <thread>
+
+#include "castmate-native/trace.hh"
+
+tts_pipeline::tts_pipeline(size_t threads)
+    : pool(threads > 0 ? threads : default_threads())
+{
+}
+
+size_t tts_pipeline::default_threads()
+{
+    const size_t cores = std::thread::hardware_concurrency();
+    return std::min<size_t>(4, std::max<size_t>(1, cores / 2));
+}
+
+//The voice held by the calling pool worker. Being thread local it's only touched from that worker and is destroyed
+//with the thread, which SAPI needs since COM was initialized on it for the voice.
+static tts_backend* worker_voice(const std::string& voice, const tts_backend_factory& factory, std::string& error)
+{
+    struct held_voice
+    {
+        std::string name;
+        std::unique_ptr<tts_backend> backend;
+    };
+    static thread_local held_voice held;
+
+    if (!held.backend || held.name != voice)
+    {
+        TRACE_SCOPE("tts voice create");
+        held.backend.reset();
+        held.backend = factory(error);
+        held.name = voice;
+    }
+    return held.backend.get();
+}
+
+bool tts_pipeline::run(const std::string& voice, const tts_backend_factory& factory,
+    const std::vector<std::wstring>& segments, const tts_segment_callback& on_segment, std::string& error)
+{
+    struct slot
+    {
+        std::vector<uint8_t> pcm;
+        std::string error;
+        bool done = false;
+        bool failed = false;
+    };
+
+    std::vector<slot> slots(segments.size());
+    std::atomic<size_t> next_segment { 0 };
+    std::atomic<bool> cancelled { false };
+
+    std::mutex mutex;
+    std::condition_variable segment_done;
+    size_t runners_left = 0;
+
+    //One runner per worker, each pulls segments until there are none left. Submitting a task per segment instead
+    //would have workers take their newest, and so the last segments, first.
+    auto runner = [&]() {
+        std::string backend_error;
+        tts_backend* backend = worker_voice(voice, factory, backend_error);
+
+        while (true)
+        {
+            const size_t index = next_segment.fetch_add(1);
+            if (index >= segments.size() || cancelled) break;
+
+            slot result;
+            if (!backend)
+            {
+                result.failed = true;
+                result.error = backend_error;
+            }
+            else
+            {
+                TRACE_SCOPE("tts segment");
+                result.failed = !backend->synthesize(segments[index], result.pcm, result.error);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                result.done = true;
+                slots[index] = std::move(result);
+            }
+            segment_done.notify_all();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            --runners_left;
+        }
+        segment_done.notify_all();
+    };
+
+    runners_left = std::min(pool.size(), segments.size());
+    for (size_t i = 0, count = runners_left; i < count; ++i)
+    {
+        pool.submit(runner);
+    }
+
+    bool ok = true;
+    for (size_t index = 0; index < segments.size(); ++index)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        segment_done.wait(lock, [&] { return slots[index].done; });
+
+        if (slots[index].failed)
+        {
+            error = slots[index].error;
+            ok = false;
+            cancelled = true;
+            break;
+        }
+
+        //Hand the audio out without holding up workers posting later segments
+        std::vector<uint8_t> pcm = std::move(slots[index].pcm);
+        lock.unlock();
+
+        on_segment(index, pcm);
+    }
+
+    //The runners reference this frame, other runs on the pool may still be going so wait_idle isn't enough
+    std::unique_lock<std::mutex> lock(mutex);
+    segment_done.wait(lock, [&] { return runners_left == 0; });
+    return ok;
+}
+
+///////////////////////////////WAV///////////////////////////////
+
+static void put_u16(uint8_t* data, uint16_t value)
+{
+    data[0] = uint8_t(value);
+    data[1] = uint8_t(value >> 8);
+}
+
+static void put_u32(uint8_t* data, uint32_t value)
+{
+    data[0] = uint8_t(value);
+    data[1] = uint8_t(value >> 8);
+    data[2] = uint8_t(value >> 16);
+    data[3] = uint8_t(value >> 24);
+}
+
+static uint16_t get_u16(const uint8_t* data)
+{
+    return uint16_t(data[0] | (data[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t* data)
+{
+    return uint32_t(data[0]) | (uint32_t(data[1]) << 8) | (uint32_t(data[2]) << 16) | (uint32_t(data[3]) << 24);
+}
+
+static const size_t wav_header_size = 44;
+
+wav_writer::~wav_writer()
+{
+    close();
+}
+
+bool wav_writer::open(const std::string& path, const tts_audio_format& format)
+{
+    close();
+
+#ifdef _WIN32
+    file = _wfopen(std::filesystem::u8path(path).c_str(), L"wb");
+#else
+    file = fopen(path.c_str(), "wb");
+#endif
+    if (!file) return false;
+
+    const uint16_t block_align = format.channels * format.bits_per_sample / 8;
+
+    uint8_t header[wav_header_size];
+    memcpy(header, "RIFF", 4);
+    put_u32(header + 4, 36);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    put_u32(header + 16, 16);
+    put_u16(header + 20, 1);
+    put_u16(header + 22, format.channels);
+    put_u32(header + 24, format.sample_rate);
+    put_u32(header + 28, format.sample_rate * block_align);
+    put_u16(header + 32, block_align);
+    put_u16(header + 34, format.bits_per_sample);
+    memcpy(header + 36, "data", 4);
+    put_u32(header + 40, 0);
+
+    data_size = 0;
+    return fwrite(header, 1, wav_header_size, file) == wav_header_size;
+}
+
+bool wav_writer::write(const uint8_t* data, size_t size)
+{
+    if (!file) return false;
+    data_size += uint32_t(size);
+    return fwrite(data, 1, size, file) == size;
+}
+
+bool wav_writer::close()
+{
+    if (!file) return true;
+
+    uint8_t size[4];
+    bool ok = true;
+
+    put_u32(size, 36 + data_size);
+    ok = ok && fseek(file, 4, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+
+    put_u32(size, data_size);
+    ok = ok && fseek(file, 40, SEEK_SET) == 0 && fwrite(size, 1, 4, file) == 4;
+
+    ok = fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool wav_writer::write_file(const std::string& path, const tts_audio_format& format, const std::vector<uint8_t>& pcm)
+{
+    wav_writer writer;
+    return writer.open(path, format) && writer.write(pcm.data(), pcm.size()) && writer.close();
+}
+
+bool read_wav_file(const std::string& path, tts_audio_format& format, std::vector<uint8_t>& pcm, std::string& error)
+{
+#ifdef _WIN32
+    FILE* file = _wfopen(std::filesystem::u8path(path).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+    if (!file)
+    {
+        error = "Unable to open wav";
+        return false;
+    }
+
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t got;
+    while ((got = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        data.insert(data.end(), buffer, buffer + got);
+    }
+    fclose(file);
+
+    if (data.size() < 12 || memcmp(data.data(), "RIFF", 4) != 0 || memcmp(data.data() + 8, "WAVE", 4) != 0)
+    {
+        error = "Not a wav file";
+        return false;
+    }
+
+    bool has_format = false;
+    size_t at = 12;
+    while (at + 8 <= data.size())
+    {
+        const uint32_t chunk_size = get_u32(data.data() + at + 4);
+        const uint8_t* chunk = data.data() + at + 8;
+        const size_t available = std::min<size_t>(chunk_size, data.size() - at - 8);
+
+        if (memcmp(data.data() + at, "fmt ", 4) == 0 && available >= 16)
+        {
+            //1 is PCM, 0xFFFE is WAVE_FORMAT_EXTENSIBLE which SAPI uses for some voices
+            const uint16_t tag = get_u16(chunk);
+            if (tag != 1 && tag != 0xFFFE)
+            {
+                error = "Only PCM wav files are supported";
+                return false;
+            }
+            format.channels = get_u16(chunk + 2);
+            format.sample_rate = get_u32(chunk + 4);
+            format.bits_per_sample = get_u16(chunk + 14);
+            has_format = true;
+        }
+        else if (memcmp(data.data() + at, "data", 4) == 0)
+        {
+            if (!has_format)
+            {
+                error = "wav data before format";
+                return false;
+            }
+            //Streamed wavs can leave the size at 0 or the max, trust the file length instead
+            const size_t size = chunk_size == 0 || chunk_size == 0xFFFFFFFF ? data.size() - at - 8 : available;
+            pcm.assign(chunk, chunk + size);
+            return true;
+        }
+
+        at += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    error = "wav has no data";
+    return false;
+}
+
+bool read_wav_format(const std::string& path, tts_audio_format& format)
+{
+#ifdef _WIN32
+    FILE* file = _wfopen(std::filesystem::u8path(path).c_str(), L"rb");
+#else
+    FILE* file = fopen(path.c_str(), "rb");
+#endif
+    if (!file) return false;
+
+    bool found = false;
+    uint8_t header[12];
+    if (fread(header, 1, 12, file) == 12 && memcmp(header, "RIFF", 4) == 0 && memcmp(header + 8, "WAVE", 4) == 0)
+    {
+        uint8_t chunk[16];
+        while (fread(chunk, 1, 8, file) == 8)
+        {
+            const uint32_t chunk_size = get_u32(chunk + 4);
+
+            if (memcmp(chunk, "fmt ", 4) == 0)
+            {
+                if (chunk_size < 16 || fread(chunk, 1, 16, file) != 16) break;
+
+                const uint16_t tag = get_u16(chunk);
+                if (tag != 1 && tag != 0xFFFE) break;
+
+                format.channels = get_u16(chunk + 2);
+                format.sample_rate = get_u32(chunk + 4);
+                format.bits_per_sample = get_u16(chunk + 14);
+                found = true;
+                break;
+            }
+
+            //The format comes before the data, anything else is skipped over
+            if (memcmp(chunk, "data", 4) == 0) break;
+            if (fseek(file, long(chunk_size + (chunk_size & 1)), SEEK_CUR) != 0) break;
+        }
+    }
+
+    fclose(file);
+    return found;
+}
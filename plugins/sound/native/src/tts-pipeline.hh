@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "castmate-native/work-pool.hh"
+
+struct tts_audio_format
+{
+    uint32_t sample_rate = 22050;
+    uint16_t channels = 1;
+    uint16_t bits_per_sample = 16;
+};
+
+//A voice instance. The pipeline keeps one per worker thread and only ever uses it from that thread,
+//SAPI voices can't be shared across threads.
+class tts_backend
+{
+public:
+    virtual ~tts_backend() = default;
+
+    //Appends raw PCM in the pipeline's format to pcm.
+    virtual bool synthesize(const std::wstring& text, std::vector<uint8_t>& pcm, std::string& error) = 0;
+};
+
+using tts_backend_factory = std::function<std::unique_ptr<tts_backend>(std::string& error)>;
+
+//Called on the pipeline's calling thread, strictly in segment order.
+using tts_segment_callback = std::function<void(size_t index, const std::vector<uint8_t>& pcm)>;
+
+//Synthesizes segments on a small pool of worker threads and hands them back in order as soon as the next one
+//is done. Workers take segments lowest index first so the first segment, and with it the first audio, is never
+//stuck behind a later one.
+//
+//The pool and its voices outlive a run, so only the first message in a voice pays for creating it. Each worker
+//keeps the last voice it used and makes a new one with factory when a run asks for a different one.
+class tts_pipeline
+{
+public:
+    //0 uses default_threads()
+    explicit tts_pipeline(size_t threads);
+
+    //voice names what factory creates, runs asking for the same name reuse the workers' voices.
+    bool run(const std::string& voice, const tts_backend_factory& factory, const std::vector<std::wstring>& segments,
+        const tts_segment_callback& on_segment, std::string& error);
+
+    size_t threads() const { return pool.size(); }
+
+    //Half the cores, at most 4. Voices are CPU heavy and the rest of CastMate still needs to run.
+    static size_t default_threads();
+
+private:
+    work_pool pool;
+};
+
+//PCM to a wav file. The header sizes are patched in on close, so segments can be appended as they arrive.
+class wav_writer
+{
+public:
+    ~wav_writer();
+
+    bool open(const std::string& path, const tts_audio_format& format);
+    bool write(const uint8_t* data, size_t size);
+    bool close();
+
+    static bool write_file(const std::string& path, const tts_audio_format& format, const std::vector<uint8_t>& pcm);
+
+private:
+    FILE* file = nullptr;
+    uint32_t data_size = 0;
+};
+
+//Reads a PCM wav, walking the chunks rather than assuming the 44 byte header SAPI writes.
+bool read_wav_file(const std::string& path, tts_audio_format& format, std::vector<uint8_t>& pcm, std::string& error);
+
+//Just the format of a PCM wav read_wav_file would accept, only the chunk headers are read.
+bool read_wav_format(const std::string& path, tts_audio_format& format);
@@ -0,0 +1,263 @@
+#include "tts-segmenter.hh"
+
+#include <cwctype>
+
+namespace
+{
+    struct open_tag
+    {
+        std::wstring name;
+        std::wstring text;
+    };
+
+    struct cut_point
+    {
+        //Index into text where the next segment starts
+        size_t position = 0;
+        //Visible characters in the segment up to here
+        size_t length = 0;
+        std::vector<open_tag> open;
+        bool valid = false;
+    };
+
+    //Escaped so the file reads the same in any codepage: ellipsis, then the CJK full stop, exclamation and question marks
+    bool is_sentence_end(wchar_t c)
+    {
+        return c == L'.' || c == L'!' || c == L'?' || c == L'\u2026' || c == L'\u3002' || c == L'\uFF01' || c == L'\uFF1F';
+    }
+
+    //Em and en dashes, then the CJK enumeration comma and full width comma
+    bool is_clause_end(wchar_t c)
+    {
+        return c == L',' || c == L';' || c == L':' || c == L'\u2014' || c == L'\u2013' || c == L'\u3001' || c == L'\uFF0C';
+    }
+
+    //Quotes and brackets that belong to the sentence they close, including curly quotes and the CJK corner bracket
+    bool is_closing_mark(wchar_t c)
+    {
+        return c == L'"' || c == L'\'' || c == L')' || c == L']' || c == L'\u201D' || c == L'\u2019' || c == L'\u300D';
+    }
+
+    //Returns the index one past the tag's '>', or npos if the '<' at start isn't a tag (a bare "<3" in chat).
+    size_t tag_end(const std::wstring& text, size_t start)
+    {
+        if (start + 1 >= text.size()) return std::wstring::npos;
+
+        const wchar_t next = text[start + 1];
+        if (!std::iswalpha(next) && next != L'/' && next != L'!' && next != L'?') return std::wstring::npos;
+
+        wchar_t quote = 0;
+        for (size_t i = start + 1; i < text.size(); ++i)
+        {
+            const wchar_t c = text[i];
+            if (quote)
+            {
+                if (c == quote) quote = 0;
+            }
+            else if (c == L'"' || c == L'\'')
+            {
+                quote = c;
+            }
+            else if (c == L'>')
+            {
+                return i + 1;
+            }
+            else if (c == L'<')
+            {
+                return std::wstring::npos;
+            }
+        }
+        return std::wstring::npos;
+    }
+
+    std::wstring tag_name(const std::wstring& tag)
+    {
+        size_t start = 1;
+        if (start < tag.size() && tag[start] == L'/') ++start;
+
+        size_t end = start;
+        while (end < tag.size() && !std::iswspace(tag[end]) && tag[end] != L'>' && tag[end] != L'/') ++end;
+        return tag.substr(start, end - start);
+    }
+
+    void trim(const std::wstring& text, size_t& start, size_t& end)
+    {
+        while (start < end && std::iswspace(text[start])) ++start;
+        while (end > start && std::iswspace(text[end - 1])) --end;
+    }
+
+    class segmenter
+    {
+    public:
+        segmenter(const std::wstring& text, const tts_segment_options& options)
+            : text(text), options(options)
+        {
+        }
+
+        std::vector<std::wstring> run()
+        {
+            size_t i = 0;
+            while (i < text.size())
+            {
+                const wchar_t c = text[i];
+
+                if (c == L'<')
+                {
+                    const size_t end = tag_end(text, i);
+                    if (end != std::wstring::npos)
+                    {
+                        apply_tag(text.substr(i, end - i));
+                        i = end;
+                        continue;
+                    }
+                }
+
+                if (std::iswspace(c))
+                {
+                    //Only ever cut on whitespace, so words and entities stay whole
+                    consider_cut(i);
+                }
+                else
+                {
+                    ++length;
+                }
+
+                ++i;
+
+                if (length > limit() && last_cut.valid)
+                {
+                    cut(last_cut);
+                }
+            }
+
+            finish();
+            return std::move(segments);
+        }
+
+    private:
+        size_t limit() const
+        {
+            return segments.empty() ? options.first_max_chars : options.max_chars;
+        }
+
+        void apply_tag(const std::wstring& tag)
+        {
+            if (tag.size() < 2 || tag[1] == L'!' || tag[1] == L'?') return;
+            //Self closing, nothing to balance
+            if (tag[tag.size() - 2] == L'/') return;
+
+            const std::wstring name = tag_name(tag);
+            if (tag[1] == L'/')
+            {
+                for (size_t i = open.size(); i > 0; --i)
+                {
+                    if (open[i - 1].name == name)
+                    {
+                        open.resize(i - 1);
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                open.push_back({ name, tag });
+            }
+        }
+
+        void consider_cut(size_t position)
+        {
+            //Step back over the whitespace run and any closing quotes to find the punctuation
+            size_t back = position;
+            while (back > segment_start && std::iswspace(text[back - 1])) --back;
+            while (back > segment_start && is_closing_mark(text[back - 1])) --back;
+            if (back == segment_start) return;
+
+            const wchar_t mark = text[back - 1];
+            const bool sentence = is_sentence_end(mark);
+            const bool clause = is_clause_end(mark);
+
+            cut_point point;
+            point.position = position;
+            point.length = length;
+            point.open = open;
+            point.valid = true;
+
+            if (sentence || (clause && segments.empty()))
+            {
+                if (length >= options.min_chars)
+                {
+                    cut(point);
+                    return;
+                }
+            }
+
+            //Fallbacks for when a sentence runs past the limit, a clause beats a plain space
+            if (clause || sentence)
+            {
+                last_cut = point;
+                last_is_clause = true;
+            }
+            else if (!last_is_clause || !last_cut.valid)
+            {
+                last_cut = point;
+                last_is_clause = false;
+            }
+        }
+
+        void cut(const cut_point& point)
+        {
+            emit(segment_start, point.position, point.open);
+
+            segment_start = point.position;
+            segment_open = point.open;
+            length -= point.length;
+            last_cut = cut_point();
+            last_is_clause = false;
+        }
+
+        void finish()
+        {
+            emit(segment_start, text.size(), open);
+        }
+
+        void emit(size_t start, size_t end, const std::vector<open_tag>& open_at_end)
+        {
+            trim(text, start, end);
+
+            //Tag only pieces (a lone <silence/>) are kept as long as something is there
+            if (start >= end) return;
+
+            std::wstring segment;
+            for (const open_tag& tag : segment_open)
+            {
+                segment += tag.text;
+            }
+            segment.append(text, start, end - start);
+            for (size_t i = open_at_end.size(); i > 0; --i)
+            {
+                segment += L"</" + open_at_end[i - 1].name + L">";
+            }
+
+            segments.push_back(std::move(segment));
+        }
+
+        const std::wstring& text;
+        const tts_segment_options& options;
+
+        std::vector<std::wstring> segments;
+
+        std::vector<open_tag> open;
+        //Tags that were open where the current segment started
+        std::vector<open_tag> segment_open;
+        size_t segment_start = 0;
+        size_t length = 0;
+
+        cut_point last_cut;
+        bool last_is_clause = false;
+    };
+}
+
+std::vector<std::wstring> segment_tts_text(const std::wstring& text, const tts_segment_options& options)
+{
+    return segmenter(text, options).run();
+}
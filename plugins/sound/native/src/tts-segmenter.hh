@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct tts_segment_options
+{
+    //Sentences shorter than this are merged with the next one, each segment pays the voice's startup cost.
+    size_t min_chars = 40;
+    //Longer sentences are split at a clause, then at a space.
+    size_t max_chars = 220;
+    //The first segment decides time to first audio, so it may also end at a clause past min_chars.
+    size_t first_max_chars = 90;
+};
+
+//Splits a TTS message at sentence and clause boundaries so the pieces can be synthesized in parallel.
+//
+//SAPI messages may carry XML. Tags are never split and every segment is balanced: tags still open at a cut
+//are closed at the end of the segment and reopened at the start of the next one, so a <rate> or <pitch>
+//around the whole message applies to every segment.
+std::vector<std::wstring> segment_tts_text(const std::wstring& text, const tts_segment_options& options = tts_segment_options());
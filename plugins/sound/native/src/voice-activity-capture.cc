@@ -0,0 +1,137 @@
+#include "voice-activity-capture.hh"
+
+struct voice_activity_event
+{
+    bool speech;
+    float confidence;
+    double duration_ms;
+};
+
+//Edges are debounced to a few a second at most, this only fills if JS stalls for a long time
+static const size_t voice_activity_event_capacity = 64;
+
+Napi::Object voice_activity_interface::init(Napi::Env env, Napi::Object exports)
+{
+    Napi::Function constructor = DefineClass(env, "NativeVoiceActivity", {
+        InstanceMethod("start", &voice_activity_interface::start),
+        InstanceMethod("stop", &voice_activity_interface::stop),
+    });
+
+    exports.Set("NativeVoiceActivity", constructor);
+    return exports;
+}
+
+voice_activity_interface::voice_activity_interface(const Napi::CallbackInfo& info)
+    : Napi::ObjectWrap<voice_activity_interface>(info)
+{
+    emit = Napi::Persistent(info[0].As<Napi::Function>());
+}
+
+voice_activity_interface::~voice_activity_interface()
+{
+    stop_capture();
+}
+
+void voice_activity_interface::Finalize(Napi::Env env)
+{
+    stop_capture();
+}
+
+Napi::Value voice_activity_interface::start(const Napi::CallbackInfo& info)
+{
+    Napi::Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsString())
+    {
+        Napi::Error::New(env, "start requires a device argument.").ThrowAsJavaScriptException();
+        return env.Undefined();
+    }
+
+    stop_capture();
+
+    std::u16string device_str = info[0].As<Napi::String>().Utf16Value();
+
+    config = vad_config();
+    if (info.Length() > 1 && info[1].IsObject())
+    {
+        Napi::Object options = info[1].As<Napi::Object>();
+        if (options.Has("frameMs")) config.frame_ms = options.Get("frameMs").As<Napi::Number>().Uint32Value();
+        if (options.Has("attackMs")) config.attack_ms = options.Get("attackMs").As<Napi::Number>().Uint32Value();
+        if (options.Has("hangoverMs")) config.hangover_ms = options.Get("hangoverMs").As<Napi::Number>().Uint32Value();
+        if (options.Has("threshold")) config.threshold = options.Get("threshold").As<Napi::Number>().FloatValue();
+    }
+
+    detector.reset();
+    speech_start_sample = 0;
+    events.open(env, emit.Value(), "VoiceActivityTSFN", voice_activity_event_capacity);
+
+    capture.start(std::wstring(device_str.begin(), device_str.end()), false,
+        [this](const float* mono, size_t frames, uint32_t sample_rate) { process(mono, frames, sample_rate); },
+        [this](const std::string& message) { post_error(message); });
+
+    return Napi::Boolean::New(env, true);
+}
+
+Napi::Value voice_activity_interface::stop(const Napi::CallbackInfo& info)
+{
+    stop_capture();
+    return info.Env().Undefined();
+}
+
+void voice_activity_interface::stop_capture()
+{
+    if (!capture.running()) return;
+
+    capture.stop();
+    events.close();
+}
+
+void voice_activity_interface::process(const float* mono, size_t frames, uint32_t sample_rate)
+{
+    if (!detector)
+    {
+        detector = std::make_unique<voice_activity_detector>(sample_rate, config);
+    }
+
+    edges.clear();
+    detector->process(mono, frames, edges);
+
+    for (const vad_edge& edge : edges)
+    {
+        voice_activity_event event;
+        event.speech = edge.speech;
+        event.confidence = edge.confidence;
+        event.duration_ms = edge.speech ? 0.0 : double(edge.sample - speech_start_sample) * 1000.0 / sample_rate;
+        if (edge.speech) speech_start_sample = edge.sample;
+
+        auto js_thread_callback = [event](Napi::Env env, Napi::Function js_callback)
+        {
+            //env might be null if the tsfn is aborted
+            if (env == nullptr || js_callback == nullptr) return;
+
+            if (event.speech)
+            {
+                js_callback.Call({ Napi::String::New(env, "speech-start"), Napi::Number::New(env, event.confidence) });
+            }
+            else
+            {
+                js_callback.Call({ Napi::String::New(env, "speech-end"), Napi::Number::New(env, event.confidence), Napi::Number::New(env, event.duration_ms) });
+            }
+        };
+
+        events.post(js_thread_callback);
+    }
+}
+
+void voice_activity_interface::post_error(const std::string& message)
+{
+    auto js_thread_callback = [message](Napi::Env env, Napi::Function js_callback)
+    {
+        //env might be null if the tsfn is aborted
+        if (env == nullptr || js_callback == nullptr) return;
+
+        js_callback.Call({ Napi::String::New(env, "error"), Napi::String::New(env, message) });
+    };
+
+    events.post(js_thread_callback);
+}
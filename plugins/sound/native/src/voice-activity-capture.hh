@@ -0,0 +1,47 @@
+#pragma once
+
+#include <napi.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "castmate-native/event-dispatcher.hh"
+
+#include "audio-capture.hh"
+#include "voice-activity.hh"
+
+//Runs the voice activity detector over an input device on the capture thread.
+//Only the debounced edges cross over to JS:
+//  ("speech-start", confidence)
+//  ("speech-end", confidence, durationMs)
+//  ("error", message) after which capture has stopped
+class voice_activity_interface : public Napi::ObjectWrap<voice_activity_interface>
+{
+public:
+    static Napi::Object init(Napi::Env env, Napi::Object exports);
+
+    voice_activity_interface(const Napi::CallbackInfo& info);
+    ~voice_activity_interface();
+
+    Napi::Value start(const Napi::CallbackInfo& info);
+    Napi::Value stop(const Napi::CallbackInfo& info);
+
+    void Finalize(Napi::Env env) override;
+
+private:
+    void stop_capture();
+    void process(const float* mono, size_t frames, uint32_t sample_rate);
+    void post_error(const std::string& message);
+
+    Napi::FunctionReference emit;
+
+    vad_config config;
+    //Only touched on the capture thread, made once the device's rate is known
+    std::unique_ptr<voice_activity_detector> detector;
+    std::vector<vad_edge> edges;
+    uint64_t speech_start_sample = 0;
+
+    audio_capture capture;
+    js_call_dispatcher events;
+};
@@ -0,0 +1,389 @@
+#include "voice-activity.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define VOICE_ACTIVITY_SSE 1
+#endif
+
+static const double pi = 3.14159265358979323846;
+
+static const float speech_band_low = 300.0f;
+static const float speech_band_high = 3400.0f;
+static const float total_band_low = 80.0f;
+static const float total_band_high = 8000.0f;
+
+//Speech needs nothing above 8kHz, 48kHz capture is decimated by 3
+static const uint32_t analysis_target_rate = 16000;
+static const double analysis_window_seconds = 0.032;
+//Flatness is taken over pieces this wide and averaged, so the tilt of the noise spectrum doesn't read as speech
+static const float flatness_band_hz = 500.0f;
+
+//Below this a frame is silence no matter what the noise floor says, digital silence has no floor to speak of
+static const float absolute_floor_db = -70.0f;
+//Bins within 6dB of the noise estimate are tracked, anything louder only nudges it up at this rate
+static const float noise_track_ratio = 4.0f;
+static const double noise_rise_db_per_second = 2.0;
+
+static float clamp01(float value)
+{
+    return std::min(1.0f, std::max(0.0f, value));
+}
+
+static float vad_dot(const float* a, const float* b, size_t count)
+{
+    size_t i = 0;
+    float result = 0;
+
+#ifdef VOICE_ACTIVITY_SSE
+    __m128 sum0 = _mm_setzero_ps();
+    __m128 sum1 = _mm_setzero_ps();
+    for (; i + 8 <= count; i += 8)
+    {
+        sum0 = _mm_add_ps(sum0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        sum1 = _mm_add_ps(sum1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(sum0, sum1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+    result = _mm_cvtss_f32(sum);
+#endif
+
+    for (; i < count; ++i)
+    {
+        result += a[i] * b[i];
+    }
+    return result;
+}
+
+voice_activity_detector::voice_activity_detector(uint32_t sample_rate, const vad_config& config)
+    : sample_rate(sample_rate)
+    , config(config)
+{
+    this->config.frame_ms = std::min<uint32_t>(20, std::max<uint32_t>(10, config.frame_ms));
+
+    decimation = std::max<uint32_t>(1, sample_rate / analysis_target_rate);
+    analysis_rate = sample_rate / decimation;
+
+    if (decimation > 1)
+    {
+        //Windowed sinc just under the new Nyquist
+        const size_t taps = 16 * decimation + 1;
+        const double cutoff = 0.45 / decimation;
+        const double middle = double(taps - 1) / 2.0;
+        lowpass.resize(taps);
+        double sum = 0;
+        for (size_t i = 0; i < taps; ++i)
+        {
+            const double x = double(i) - middle;
+            const double sinc = x == 0 ? 2.0 * cutoff : std::sin(2.0 * pi * cutoff * x) / (pi * x);
+            const double blackman = 0.42 - 0.5 * std::cos(2.0 * pi * i / (taps - 1)) + 0.08 * std::cos(4.0 * pi * i / (taps - 1));
+            lowpass[i] = float(sinc * blackman);
+            sum += lowpass[i];
+        }
+        for (float& tap : lowpass) tap = float(tap / sum);
+    }
+
+    hop_length = std::max<size_t>(16, size_t(analysis_rate) * this->config.frame_ms / 1000);
+    window_length = std::max(hop_length, size_t(analysis_rate * analysis_window_seconds));
+    size_t fft_size = 16;
+    while (fft_size < window_length) fft_size <<= 1;
+    spectrum = power_spectrum(fft_size);
+
+    window = hann_window(window_length);
+    history.assign(window_length, 0.0f);
+
+    power.resize(spectrum.bins());
+    smoothed.resize(power.size());
+    noise.resize(power.size());
+
+    const float bin_hz = float(analysis_rate) / float(fft_size);
+    const size_t nyquist_bin = fft_size / 2;
+    band_start = std::min(nyquist_bin, size_t(speech_band_low / bin_hz));
+    band_end = std::min(nyquist_bin, size_t(speech_band_high / bin_hz) + 1);
+    total_start = std::min(nyquist_bin, size_t(total_band_low / bin_hz));
+    total_end = std::min(nyquist_bin, size_t(total_band_high / bin_hz) + 1);
+    flatness_bins = std::max<size_t>(4, size_t(flatness_band_hz / bin_hz));
+
+    noise_rise = float(std::pow(10.0, noise_rise_db_per_second * this->config.frame_ms / 1000.0 / 10.0));
+
+    attack_frames = std::max<uint32_t>(1, config.attack_ms / this->config.frame_ms);
+    hangover_frames = std::max<uint32_t>(1, config.hangover_ms / this->config.frame_ms);
+}
+
+void voice_activity_detector::process(const float* samples, size_t count, std::vector<vad_edge>& edges)
+{
+    if (decimation == 1)
+    {
+        push_analysis(samples, count, edges);
+        position += count;
+        return;
+    }
+
+    pending.insert(pending.end(), samples, samples + count);
+
+    decimated.clear();
+    const size_t taps = lowpass.size();
+    while (pending_read + taps <= pending.size())
+    {
+        decimated.push_back(vad_dot(lowpass.data(), pending.data() + pending_read, taps));
+        pending_read += decimation;
+    }
+
+    //The read point can sit past the end until enough arrives for the next output
+    const size_t consumed = std::min(pending_read, pending.size());
+    pending.erase(pending.begin(), pending.begin() + consumed);
+    pending_read -= consumed;
+
+    push_analysis(decimated.data(), decimated.size(), edges);
+    position += count;
+}
+
+void voice_activity_detector::push_analysis(const float* samples, size_t count, std::vector<vad_edge>& edges)
+{
+    while (count > 0)
+    {
+        const size_t take = std::min(count, hop_length - hop_fill);
+
+        //Slide the window along, it's at most 32ms so a move is cheaper than ring indexing in the FFT input
+        memmove(history.data(), history.data() + take, (window_length - take) * sizeof(float));
+        memcpy(history.data() + window_length - take, samples, take * sizeof(float));
+
+        hop_fill += take;
+        analysis_position += take;
+        samples += take;
+        count -= take;
+
+        if (hop_fill == hop_length)
+        {
+            hop_fill = 0;
+            analyze_frame();
+            update_state(features.probability, edges);
+        }
+    }
+}
+
+void voice_activity_detector::analyze_frame()
+{
+    spectrum.compute(history.data(), window.data(), window_length, power.data());
+    const size_t bins = power.size();
+
+    if (!noise_primed)
+    {
+        smoothed = power;
+        noise = power;
+        noise_primed = true;
+    }
+    else
+    {
+        //About 40ms of smoothing so the per bin noise tracking isn't chasing periodogram variance
+        size_t i = 0;
+#ifdef VOICE_ACTIVITY_SSE
+        const __m128 keep = _mm_set1_ps(0.75f);
+        const __m128 take = _mm_set1_ps(0.25f);
+        for (; i + 4 <= bins; i += 4)
+        {
+            const __m128 previous = _mm_mul_ps(_mm_loadu_ps(smoothed.data() + i), keep);
+            _mm_storeu_ps(smoothed.data() + i, _mm_add_ps(previous, _mm_mul_ps(_mm_loadu_ps(power.data() + i), take)));
+        }
+#endif
+        for (; i < bins; ++i)
+        {
+            smoothed[i] = smoothed[i] * 0.75f + power[i] * 0.25f;
+        }
+    }
+
+    double total = 0;
+    double total_excess = 0;
+    for (size_t i = total_start; i < total_end; ++i)
+    {
+        total += power[i];
+        total_excess += std::max(0.0f, smoothed[i] - noise[i]);
+    }
+
+    double band = 0;
+    double band_noise = 0;
+    double band_excess = 0;
+    double flatness_sum = 0;
+    size_t flatness_pieces = 0;
+    for (size_t piece = band_start; piece < band_end; piece += flatness_bins)
+    {
+        const size_t piece_end = std::min(band_end, piece + flatness_bins);
+        double gamma_sum = 0;
+        double gamma_log = 0;
+        for (size_t i = piece; i < piece_end; ++i)
+        {
+            const double gamma = double(power[i]) / (double(noise[i]) + 1e-20);
+            band += power[i];
+            band_noise += noise[i];
+            band_excess += std::max(0.0f, smoothed[i] - noise[i]);
+            gamma_sum += gamma;
+            gamma_log += std::log(gamma + 1e-12);
+        }
+
+        const double count = double(piece_end - piece);
+        flatness_sum += std::exp(gamma_log / count) / (gamma_sum / count + 1e-12);
+        ++flatness_pieces;
+    }
+
+    //Power relative to a full scale sine through the same window, so the floor reads as dBFS
+    const double full_scale = double(window_length) * double(window_length) / 8.0;
+    features.energy_db = float(10.0 * std::log10(total / full_scale + 1e-12));
+
+    features.snr_db = float(10.0 * std::log10((band + 1e-20) / (band_noise + 1e-20)));
+    features.flatness = flatness_pieces > 0 ? float(flatness_sum / double(flatness_pieces)) : 1.0f;
+    features.band_share = total_excess > 0 ? float(band_excess / total_excess) : 0.0f;
+
+    if (features.energy_db < absolute_floor_db)
+    {
+        features.probability = 0;
+    }
+    else
+    {
+        const float snr_score = clamp01((features.snr_db - 2.0f) / 6.0f);
+        //A whitened Hann windowed periodogram of noise sits near 0.57, resolved harmonics pull it well under
+        const float tonal_score = clamp01((0.56f - features.flatness) / 0.1f);
+        const float band_score = clamp01((features.band_share - 0.3f) / 0.3f);
+        features.probability = snr_score * (0.4f + 0.6f * tonal_score) * (0.6f + 0.4f * band_score);
+    }
+
+    update_noise();
+}
+
+void voice_activity_detector::update_noise()
+{
+    //Bins near the estimate are noise and are followed, bins well above it are speech or a transient and only let it
+    //creep up, so a louder room is learned over a few seconds but a long monologue never is.
+    const size_t bins = noise.size();
+    for (size_t i = 0; i < bins; ++i)
+    {
+        const float level = std::max(smoothed[i], 1e-20f);
+        if (level < noise[i])
+        {
+            noise[i] = level;
+        }
+        else if (level < noise[i] * noise_track_ratio)
+        {
+            noise[i] = noise[i] * 0.95f + level * 0.05f;
+        }
+        else
+        {
+            noise[i] *= noise_rise;
+        }
+    }
+}
+
+void voice_activity_detector::update_state(float frame_probability, std::vector<vad_edge>& edges)
+{
+    const bool voiced = frame_probability >= config.threshold;
+    const uint64_t frame_start = (analysis_position - hop_length) * decimation;
+
+    switch (state)
+    {
+    case vad_state::silence:
+        if (!voiced) break;
+        state = vad_state::attack;
+        state_frames = 0;
+        attack_sum = 0;
+        edge_sample = frame_start;
+        [[fallthrough]];
+    case vad_state::attack:
+        if (!voiced)
+        {
+            //Too short to be speech
+            state = vad_state::silence;
+            break;
+        }
+
+        attack_sum += frame_probability;
+        if (++state_frames >= attack_frames)
+        {
+            vad_edge edge;
+            edge.speech = true;
+            edge.confidence = float(attack_sum / state_frames);
+            edge.sample = edge_sample;
+            edges.push_back(edge);
+
+            state = vad_state::speech;
+            utterance_sum = attack_sum;
+            utterance_frames = state_frames;
+        }
+        break;
+    case vad_state::speech:
+        if (voiced)
+        {
+            utterance_sum += frame_probability;
+            ++utterance_frames;
+        }
+        else
+        {
+            state = vad_state::hangover;
+            state_frames = 1;
+            edge_sample = frame_start;
+        }
+        break;
+    case vad_state::hangover:
+        if (voiced)
+        {
+            //Back to talking, the pause counts towards the utterance
+            state = vad_state::speech;
+            utterance_sum += frame_probability;
+            ++utterance_frames;
+            break;
+        }
+
+        if (++state_frames >= hangover_frames)
+        {
+            vad_edge edge;
+            edge.speech = false;
+            edge.confidence = float(utterance_sum / std::max<uint32_t>(1, utterance_frames));
+            edge.sample = edge_sample;
+            edges.push_back(edge);
+
+            state = vad_state::silence;
+        }
+        break;
+    }
+}
+
+void vad_downmix(const float* interleaved, size_t frames, uint32_t channels, float* mono)
+{
+    if (channels == 1)
+    {
+        memcpy(mono, interleaved, frames * sizeof(float));
+        return;
+    }
+
+    if (channels == 2)
+    {
+        size_t i = 0;
+#ifdef VOICE_ACTIVITY_SSE
+        const __m128 half = _mm_set1_ps(0.5f);
+        for (; i + 4 <= frames; i += 4)
+        {
+            const __m128 a = _mm_loadu_ps(interleaved + i * 2);
+            const __m128 b = _mm_loadu_ps(interleaved + i * 2 + 4);
+            //Left channels of both registers, then right
+            const __m128 left = _mm_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0));
+            const __m128 right = _mm_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1));
+            _mm_storeu_ps(mono + i, _mm_mul_ps(_mm_add_ps(left, right), half));
+        }
+#endif
+        for (; i < frames; ++i)
+        {
+            mono[i] = (interleaved[i * 2] + interleaved[i * 2 + 1]) * 0.5f;
+        }
+        return;
+    }
+
+    const float scale = 1.0f / float(channels);
+    for (size_t i = 0; i < frames; ++i)
+    {
+        float sum = 0;
+        for (uint32_t c = 0; c < channels; ++c) sum += interleaved[i * channels + c];
+        mono[i] = sum * scale;
+    }
+}
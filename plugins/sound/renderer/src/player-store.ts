@@ -8,10 +8,78 @@ interface PlayingSound {
 	audioElem: ExtendHTMLAudioElement
 }
 
+type ExtendAudioContext = AudioContext & { setSinkId(sinkId: string): Promise<void> }
+
+//TTS segments scheduled back to back on one context's clock, HTMLAudio elements would leave gaps between files
+interface PlayingSegments {
+	context: ExtendAudioContext
+	gain: GainNode
+	sources: Set<AudioBufferSourceNode>
+	//Context time the next segment starts at
+	nextStart: number
+	//Decodes finish out of order, scheduling is chained so segments keep their order
+	scheduling: Promise<void>
+	ended: boolean
+	aborted: boolean
+}
+
+//Lead time so the first segment isn't scheduled in the past while the context spins up
+const segmentScheduleLead = 0.02
+
 export const useSoundPlayerStore = defineStore("soundPlayer", () => {
 	const soundFinishedInRenderer = useIpcCaller<(id: string) => void>("sound", "soundFinishedInRenderer")
+	const soundStartedInRenderer = useIpcCaller<
+		(id: string, timings: { received: number; loaded: number; playRequested: number; playing: number }) => void
+	>("sound", "soundStartedInRenderer")
+
+	//Comparable with the main process's timestamps, see renderer-sound-player.ts
+	function preciseNow() {
+		return performance.timeOrigin + performance.now()
+	}
 
 	const playingSounds = ref<Record<string, PlayingSound>>({})
+	const playingSegments = new Map<string, PlayingSegments>()
+
+	function finishSegments(id: string) {
+		const playing = playingSegments.get(id)
+		if (!playing) return
+
+		playingSegments.delete(id)
+		for (const source of playing.sources) source.stop()
+		playing.context.close()
+		soundFinishedInRenderer(id)
+	}
+
+	function checkSegmentsFinished(id: string) {
+		const playing = playingSegments.get(id)
+		if (!playing) return
+		if (playing.ended && playing.sources.size == 0) finishSegments(id)
+	}
+
+	async function scheduleSegment(id: string, playing: PlayingSegments, file: string) {
+		const response = await fetch(`file://${file}`)
+		const buffer = await playing.context.decodeAudioData(await response.arrayBuffer())
+		if (playing.aborted) return
+
+		const source = playing.context.createBufferSource()
+		source.buffer = buffer
+		source.connect(playing.gain)
+
+		//If synthesis fell behind playback there's an unavoidable gap, start as soon as possible
+		const start = Math.max(playing.nextStart, playing.context.currentTime + segmentScheduleLead)
+		source.start(start)
+		playing.nextStart = start + buffer.duration
+		playing.sources.add(source)
+
+		source.addEventListener(
+			"ended",
+			() => {
+				playing.sources.delete(source)
+				checkSegmentsFinished(id)
+			},
+			{ once: true }
+		)
+	}
 
 	function initialize() {
 		handleIpcMessage("sound", "abortSoundInRenderer", (event, id: string) => {
@@ -21,12 +89,69 @@ export const useSoundPlayerStore = defineStore("soundPlayer", () => {
 				playing.audioElem.pause()
 				//delete playingSounds.value[id]
 			}
+
+			const segments = playingSegments.get(id)
+			if (segments) {
+				console.log("Aborting Segments", id)
+				segments.aborted = true
+				finishSegments(id)
+			}
+		})
+
+		handleIpcMessage(
+			"sound",
+			"startSegmentsInRenderer",
+			(event, id: string, volume: number, sinkId: string, sampleRate?: number) => {
+				//At the device's mix rate the engine takes the context's output as is instead of resampling it again
+				const context = new AudioContext(sampleRate ? { sampleRate } : undefined) as ExtendAudioContext
+				//AudioContext uses "" for the default device where media elements use "default"
+				context
+					.setSinkId(sinkId == "default" ? "" : sinkId)
+					.catch((err) => console.error("Unable to set sink", err))
+
+				const gain = context.createGain()
+				gain.gain.value = volume / 100
+				gain.connect(context.destination)
+
+				playingSegments.set(id, {
+					context,
+					gain,
+					sources: new Set(),
+					nextStart: 0,
+					scheduling: Promise.resolve(),
+					ended: false,
+					aborted: false,
+				})
+			}
+		)
+
+		handleIpcMessage("sound", "appendSegmentInRenderer", (event, id: string, file: string) => {
+			const playing = playingSegments.get(id)
+			if (!playing) return
+
+			playing.scheduling = playing.scheduling
+				.then(() => scheduleSegment(id, playing, file))
+				.catch((err) => console.error("Unable to play segment", file, err))
+		})
+
+		handleIpcMessage("sound", "endSegmentsInRenderer", (event, id: string) => {
+			const playing = playingSegments.get(id)
+			if (!playing) return
+
+			playing.scheduling.then(() => {
+				playing.ended = true
+				checkSegmentsFinished(id)
+			})
 		})
 
 		handleIpcMessage(
 			"sound",
 			"playSoundInRenderer",
 			(event, id: string, file: string, startSec: number, endSec: number, volume: number, sinkId: string) => {
+				const received = preciseNow()
+				let loaded = 0
+				let playRequested = 0
+
 				const audioElem: ExtendHTMLAudioElement = new Audio(`file://${file}`) as ExtendHTMLAudioElement
 				audioElem.volume = volume / 100
 				audioElem.setSinkId(sinkId)
@@ -36,11 +161,22 @@ export const useSoundPlayerStore = defineStore("soundPlayer", () => {
 					"canplaythrough",
 					(event) => {
 						console.log("Starting Sound", id)
+						loaded = preciseNow()
+						playRequested = loaded
 						audioElem.play()
 					},
 					{ once: true }
 				)
 
+				//"playing" fires once the output has started pulling samples
+				audioElem.addEventListener(
+					"playing",
+					() => {
+						soundStartedInRenderer(id, { received, loaded, playRequested, playing: preciseNow() })
+					},
+					{ once: true }
+				)
+
 				audioElem.addEventListener("timeupdate", () => {
 					if (audioElem.currentTime >= endSec) audioElem.pause()
 				})